@@ -931,6 +931,8 @@ __SYSCALL(__NR_lsm_set_self_attr, sys_lsm_set_self_attr)
 __SYSCALL(__NR_lsm_list_modules, sys_lsm_list_modules)
 #define __NR_mseal 462
 __SYSCALL(__NR_mseal, sys_mseal)
+#define __NR_futex_wakev 463
+__SYSCALL(__NR_futex_wakev, sys_futex_wakev)
 
 /*
  * Please add new compat syscalls above this comment and update
@@ -40,6 +40,11 @@ struct vdso_data *arch_get_vdso_data(void *vvar_page)
 
 unsigned int vclocks_used __read_mostly;
 
+#ifdef CONFIG_VDSO_GETRANDOM
+/* Written by the RNG, see drivers/char/random.c */
+DEFINE_VVAR_SINGLE(struct vdso_rng_data, _vdso_rng_data);
+#endif
+
 #if defined(CONFIG_X86_64)
 unsigned int __read_mostly vdso64_enabled = 1;
 #endif
@@ -1540,6 +1540,7 @@ struct kvm_vm_stat {
 	u64 nx_lpage_splits;
 	u64 max_mmu_page_hash_collisions;
 	u64 max_mmu_rmap_size;
+	atomic64_t eager_split_pending_pages;
 };
 
 struct kvm_vcpu_stat {
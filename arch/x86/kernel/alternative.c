@@ -1675,6 +1675,11 @@ void __init alternative_instructions(void)
 	 */
 	paravirt_set_cap();
 
+#ifdef CONFIG_NUMA_AWARE_SPINLOCKS
+	/* Pick the spinlock slow path before the pv_ops calls get patched. */
+	cna_configure_spin_lock_slowpath();
+#endif
+
 	__apply_fineibt(__retpoline_sites, __retpoline_sites_end,
 			__cfi_sites, __cfi_sites_end, true);
 
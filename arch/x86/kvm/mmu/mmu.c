@@ -48,6 +48,9 @@
 #include <linux/kstrtox.h>
 #include <linux/kthread.h>
 #include <linux/wordpart.h>
+#include <linux/memcontrol.h>
+#include <linux/sched/mm.h>
+#include <linux/workqueue.h>
 
 #include <asm/page.h>
 #include <asm/memtype.h>
@@ -96,6 +99,13 @@ __MODULE_PARM_TYPE(nx_huge_pages_recovery_period_ms, "uint");
 static bool __read_mostly force_flush_and_sync_on_reuse;
 module_param_named(flush_on_reuse, force_flush_and_sync_on_reuse, bool, 0644);
 
+/*
+ * Number of threads splitting the huge pages of a memslot in parallel when
+ * dirty logging gets enabled on it.
+ */
+static uint __read_mostly eager_page_split_threads = 1;
+module_param(eager_page_split_threads, uint, 0644);
+
 /*
  * When setting this variable to true it enables Two-Dimensional-Paging
  * where the hardware walks 2 page tables:
@@ -6720,6 +6730,108 @@ void kvm_mmu_try_split_huge_pages(struct kvm *kvm,
 	 */
 }
 
+/*
+ * The TDP MMU splits huge pages with mmu_lock held for read, so the memslot
+ * is cut into 1GiB chunks that any number of threads can claim and split
+ * concurrently.
+ */
+#define KVM_SPLIT_CHUNK_PAGES	KVM_PAGES_PER_HPAGE(PG_LEVEL_1G)
+
+struct kvm_tdp_mmu_split {
+	struct kvm *kvm;
+	const struct kvm_memory_slot *memslot;
+	int target_level;
+	/* First gfn of the next chunk to split */
+	atomic64_t next;
+	/* Memory cgroup to charge the page tables to */
+	struct mem_cgroup *memcg;
+};
+
+struct kvm_tdp_mmu_split_worker {
+	struct work_struct work;
+	struct kvm_tdp_mmu_split *split;
+};
+
+static void kvm_tdp_mmu_split_chunks(struct kvm_tdp_mmu_split *split)
+{
+	const struct kvm_memory_slot *memslot = split->memslot;
+	u64 end = memslot->base_gfn + memslot->npages;
+	struct kvm *kvm = split->kvm;
+	u64 start, chunk_end;
+
+	while ((start = atomic64_fetch_add(KVM_SPLIT_CHUNK_PAGES,
+					   &split->next)) < end) {
+		chunk_end = min(start + KVM_SPLIT_CHUNK_PAGES, end);
+		start = max(start, memslot->base_gfn);
+
+		read_lock(&kvm->mmu_lock);
+		kvm_tdp_mmu_try_split_huge_pages(kvm, memslot, start, chunk_end,
+						 split->target_level, true);
+		read_unlock(&kvm->mmu_lock);
+
+		atomic64_sub(chunk_end - start,
+			     &kvm->stat.eager_split_pending_pages);
+		cond_resched();
+	}
+}
+
+static void kvm_tdp_mmu_split_work(struct work_struct *work)
+{
+	struct kvm_tdp_mmu_split_worker *worker =
+		container_of(work, struct kvm_tdp_mmu_split_worker, work);
+	struct mem_cgroup *old_memcg;
+
+	old_memcg = set_active_memcg(worker->split->memcg);
+	kvm_tdp_mmu_split_chunks(worker->split);
+	set_active_memcg(old_memcg);
+}
+
+static void kvm_tdp_mmu_slot_split_huge_pages(struct kvm *kvm,
+					const struct kvm_memory_slot *memslot,
+					int target_level)
+{
+	struct kvm_tdp_mmu_split_worker *workers = NULL;
+	struct kvm_tdp_mmu_split split = {
+		.kvm = kvm,
+		.memslot = memslot,
+		.target_level = target_level,
+		.next = ATOMIC64_INIT(ALIGN_DOWN(memslot->base_gfn,
+						 KVM_SPLIT_CHUNK_PAGES)),
+	};
+	unsigned int nr_chunks, nr_workers, i;
+
+	nr_chunks = DIV_ROUND_UP(memslot->base_gfn + memslot->npages -
+				 atomic64_read(&split.next),
+				 KVM_SPLIT_CHUNK_PAGES);
+	nr_workers = min3(READ_ONCE(eager_page_split_threads),
+			  num_online_cpus(), nr_chunks);
+
+	atomic64_add(memslot->npages, &kvm->stat.eager_split_pending_pages);
+
+	/* The current thread takes its share of the chunks as well. */
+	if (nr_workers > 1)
+		workers = kcalloc(nr_workers - 1, sizeof(*workers),
+				  GFP_KERNEL_ACCOUNT);
+
+	if (workers) {
+		split.memcg = get_mem_cgroup_from_mm(kvm->mm);
+		for (i = 0; i < nr_workers - 1; i++) {
+			workers[i].split = &split;
+			INIT_WORK(&workers[i].work, kvm_tdp_mmu_split_work);
+			queue_work(system_unbound_wq, &workers[i].work);
+		}
+	}
+
+	kvm_tdp_mmu_split_chunks(&split);
+
+	if (workers) {
+		for (i = 0; i < nr_workers - 1; i++)
+			flush_work(&workers[i].work);
+		mem_cgroup_put(split.memcg);
+		kfree(workers);
+	}
+}
+
 void kvm_mmu_slot_try_split_huge_pages(struct kvm *kvm,
 					const struct kvm_memory_slot *memslot,
 					int target_level)
@@ -6736,9 +6848,7 @@ void kvm_mmu_slot_try_split_huge_pages(struct kvm *kvm,
 		write_unlock(&kvm->mmu_lock);
 	}
 
-	read_lock(&kvm->mmu_lock);
-	kvm_tdp_mmu_try_split_huge_pages(kvm, memslot, start, end, target_level, true);
-	read_unlock(&kvm->mmu_lock);
+	kvm_tdp_mmu_slot_split_huge_pages(kvm, memslot, target_level);
 
 	/*
 	 * No TLB flush is necessary here. KVM will flush TLBs after
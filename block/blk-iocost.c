@@ -251,6 +251,13 @@ enum {
 	VTIME_PER_USEC		= VTIME_PER_SEC / USEC_PER_SEC,
 	VTIME_PER_NSEC		= VTIME_PER_SEC / NSEC_PER_SEC,
 
+	/*
+	 * Charges of IOs well within budget are accumulated per-cpu and
+	 * folded into iocg->vtime and ->done_vtime once they exceed this or
+	 * at the start of each period.
+	 */
+	VTIME_PCPU_BATCH	= 32 * VTIME_PER_USEC,
+
 	/* bound vrate adjustments within two orders of magnitude */
 	VRATE_MIN_PPM		= 10000,	/* 1% */
 	VRATE_MAX_PPM		= 100000000,	/* 10000% */
@@ -449,6 +456,10 @@ struct ioc {
 
 struct iocg_pcpu_stat {
 	local64_t			abs_vusage;
+
+	/* batched charges not yet folded into vtime and done_vtime */
+	atomic64_t			vtime_pending;
+	atomic64_t			done_pending;
 };
 
 struct iocg_stat {
@@ -727,6 +738,48 @@ static void iocg_commit_bio(struct ioc_gq *iocg, struct bio *bio,
 	put_cpu_ptr(gcs);
 }
 
+/*
+ * Same as iocg_commit_bio() but the vtime charge is batched on this cpu
+ * instead of bouncing iocg->vtime's cacheline for every bio. Only for bios
+ * that leave the iocg well within its budget, as other cpus see a vtime
+ * that is behind by up to VTIME_PCPU_BATCH per cpu.
+ */
+static void iocg_commit_bio_pcpu(struct ioc_gq *iocg, struct bio *bio,
+				 u64 abs_cost, u64 cost)
+{
+	struct iocg_pcpu_stat *gcs;
+
+	bio->bi_iocost_cost = cost;
+
+	gcs = get_cpu_ptr(iocg->pcpu_stat);
+	local64_add(abs_cost, &gcs->abs_vusage);
+	if (atomic64_add_return(cost, &gcs->vtime_pending) >= VTIME_PCPU_BATCH)
+		atomic64_add(atomic64_xchg(&gcs->vtime_pending, 0),
+			     &iocg->vtime);
+	put_cpu_ptr(gcs);
+}
+
+/* fold the per-cpu batched charges into vtime and done_vtime */
+static void iocg_flush_pcpu_vtime(struct ioc_gq *iocg)
+{
+	u64 vtime = 0, vdone = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct iocg_pcpu_stat *gcs = per_cpu_ptr(iocg->pcpu_stat, cpu);
+
+		if (atomic64_read(&gcs->vtime_pending))
+			vtime += atomic64_xchg(&gcs->vtime_pending, 0);
+		if (atomic64_read(&gcs->done_pending))
+			vdone += atomic64_xchg(&gcs->done_pending, 0);
+	}
+
+	if (vtime)
+		atomic64_add(vtime, &iocg->vtime);
+	if (vdone)
+		atomic64_add(vdone, &iocg->done_vtime);
+}
+
 static void iocg_lock(struct ioc_gq *iocg, bool lock_ioc, unsigned long *flags)
 {
 	if (lock_ioc) {
@@ -2261,6 +2314,10 @@ static void ioc_timer_fn(struct timer_list *timer)
 		return;
 	}
 
+	/* bring vtime and done_vtime up-to-date before idle checks */
+	list_for_each_entry(iocg, &ioc->active_iocgs, active_list)
+		iocg_flush_pcpu_vtime(iocg);
+
 	nr_debtors = ioc_check_iocgs(ioc, &now);
 
 	/*
@@ -2311,7 +2368,7 @@ static void ioc_timer_fn(struct timer_list *timer)
 			u32 hwa, old_hwi, hwm, new_hwi, usage;
 			u64 usage_dur;
 
-			if (vdone != vtime) {
+			if (time_after64(vtime, vdone)) {
 				u64 inflight_us = DIV64_U64_ROUND_UP(
 					cost_to_abs_cost(vtime - vdone, hw_inuse),
 					ioc->vtime_base_rate);
@@ -2630,7 +2687,11 @@ static void ioc_rqos_throttle(struct rq_qos *rqos, struct bio *bio)
 	 */
 	if (!waitqueue_active(&iocg->waitq) && !iocg->abs_vdebt &&
 	    time_before_eq64(vtime + cost, now.vnow)) {
-		iocg_commit_bio(iocg, bio, abs_cost, cost);
+		if (time_before_eq64(vtime + cost + ioc->margins.low,
+				     now.vnow))
+			iocg_commit_bio_pcpu(iocg, bio, abs_cost, cost);
+		else
+			iocg_commit_bio(iocg, bio, abs_cost, cost);
 		return;
 	}
 
@@ -2793,9 +2854,17 @@ static void ioc_rqos_merge(struct rq_qos *rqos, struct request *rq,
 static void ioc_rqos_done_bio(struct rq_qos *rqos, struct bio *bio)
 {
 	struct ioc_gq *iocg = blkg_to_iocg(bio->bi_blkg);
+	struct iocg_pcpu_stat *gcs;
+	u64 cost = bio->bi_iocost_cost;
 
-	if (iocg && bio->bi_iocost_cost)
-		atomic64_add(bio->bi_iocost_cost, &iocg->done_vtime);
+	if (!iocg || !cost)
+		return;
+
+	gcs = get_cpu_ptr(iocg->pcpu_stat);
+	if (atomic64_add_return(cost, &gcs->done_pending) >= VTIME_PCPU_BATCH)
+		atomic64_add(atomic64_xchg(&gcs->done_pending, 0),
+			     &iocg->done_vtime);
+	put_cpu_ptr(gcs);
 }
 
 static void ioc_rqos_done(struct rq_qos *rqos, struct request *rq)
@@ -494,6 +494,48 @@ static int hctx_dispatch_busy_show(void *data, struct seq_file *m)
 	return 0;
 }
 
+static void hctx_stats_hist_show(struct seq_file *m, const char *name,
+				 const unsigned long *hist, unsigned int nr,
+				 const char *unit)
+{
+	unsigned int i;
+
+	seq_printf(m, "%s:\n", name);
+	for (i = 0; i < nr; i++) {
+		unsigned long long lo = i ? 1ULL << (i - 1) : 0;
+
+		if (i == nr - 1)
+			seq_printf(m, "%10llu+%s\t%lu\n", lo, unit,
+				   READ_ONCE(hist[i]));
+		else
+			seq_printf(m, "%10llu%s\t%lu\n", lo, unit,
+				   READ_ONCE(hist[i]));
+	}
+}
+
+static int hctx_batching_show(void *data, struct seq_file *m)
+{
+	struct blk_mq_hw_ctx *hctx = data;
+	struct blk_mq_hctx_stats *stats = &hctx->stats;
+
+	hctx_stats_hist_show(m, "dispatched", stats->dispatched,
+			     BLK_MQ_MAX_DISPATCH_ORDER, "");
+	hctx_stats_hist_show(m, "plugged", stats->plugged,
+			     BLK_MQ_MAX_DISPATCH_ORDER, "");
+	hctx_stats_hist_show(m, "completion_lat", stats->completion_lat,
+			     BLK_MQ_MAX_LAT_ORDER, "us");
+	return 0;
+}
+
+static ssize_t hctx_batching_write(void *data, const char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	struct blk_mq_hw_ctx *hctx = data;
+
+	memset(&hctx->stats, 0, sizeof(hctx->stats));
+	return count;
+}
+
 #define CTX_RQ_SEQ_OPS(name, type)					\
 static void *ctx_##name##_rq_list_start(struct seq_file *m, loff_t *pos) \
 	__acquires(&ctx->lock)						\
@@ -609,6 +651,7 @@ static const struct blk_mq_debugfs_attr blk_mq_debugfs_hctx_attrs[] = {
 	{"active", 0400, hctx_active_show},
 	{"dispatch_busy", 0400, hctx_dispatch_busy_show},
 	{"type", 0400, hctx_type_show},
+	{"batching", 0600, hctx_batching_show, hctx_batching_write},
 	{},
 };
 
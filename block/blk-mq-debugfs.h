@@ -4,6 +4,9 @@
 
 #ifdef CONFIG_BLK_DEBUG_FS
 
+#include <linux/blk-mq.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
 #include <linux/seq_file.h>
 
 struct blk_mq_hw_ctx;
@@ -35,6 +38,38 @@ void blk_mq_debugfs_unregister_sched_hctx(struct blk_mq_hw_ctx *hctx);
 
 void blk_mq_debugfs_register_rqos(struct rq_qos *rqos);
 void blk_mq_debugfs_unregister_rqos(struct rq_qos *rqos);
+
+static inline unsigned int blk_mq_stats_index(u64 val, unsigned int max)
+{
+	if (!val)
+		return 0;
+	return min_t(unsigned int, max - 1, ilog2(val) + 1);
+}
+
+static inline void blk_mq_debugfs_account_dispatch(struct blk_mq_hw_ctx *hctx,
+						   unsigned int queued)
+{
+	hctx->stats.dispatched[blk_mq_stats_index(queued,
+					BLK_MQ_MAX_DISPATCH_ORDER)]++;
+}
+
+static inline void blk_mq_debugfs_account_plug(struct blk_mq_hw_ctx *hctx,
+					       unsigned int depth)
+{
+	hctx->stats.plugged[blk_mq_stats_index(depth,
+					BLK_MQ_MAX_DISPATCH_ORDER)]++;
+}
+
+static inline void blk_mq_debugfs_account_done(struct request *rq, u64 now)
+{
+	u64 start = rq->io_start_time_ns;
+
+	if (!start || now <= start)
+		return;
+	rq->mq_hctx->stats.completion_lat[blk_mq_stats_index(
+			div_u64(now - start, NSEC_PER_USEC),
+			BLK_MQ_MAX_LAT_ORDER)]++;
+}
 #else
 static inline void blk_mq_debugfs_register(struct request_queue *q)
 {
@@ -81,6 +116,20 @@ static inline void blk_mq_debugfs_register_rqos(struct rq_qos *rqos)
 static inline void blk_mq_debugfs_unregister_rqos(struct rq_qos *rqos)
 {
 }
+
+static inline void blk_mq_debugfs_account_dispatch(struct blk_mq_hw_ctx *hctx,
+						   unsigned int queued)
+{
+}
+
+static inline void blk_mq_debugfs_account_plug(struct blk_mq_hw_ctx *hctx,
+					       unsigned int depth)
+{
+}
+
+static inline void blk_mq_debugfs_account_done(struct request *rq, u64 now)
+{
+}
 #endif
 
 #if defined(CONFIG_BLK_DEV_ZONED) && defined(CONFIG_BLK_DEBUG_FS)
@@ -1028,8 +1028,10 @@ static inline void blk_account_io_start(struct request *req)
 
 static inline void __blk_mq_end_request_acct(struct request *rq, u64 now)
 {
-	if (rq->rq_flags & RQF_STATS)
+	if (rq->rq_flags & RQF_STATS) {
 		blk_stat_add(rq, now);
+		blk_mq_debugfs_account_done(rq, now);
+	}
 
 	blk_mq_sched_completed_request(rq, now);
 	blk_account_io_done(rq, now);
@@ -2050,6 +2052,8 @@ bool blk_mq_dispatch_rq_list(struct blk_mq_hw_ctx *hctx, struct list_head *list,
 		}
 	} while (!list_empty(list));
 out:
+	blk_mq_debugfs_account_dispatch(hctx, queued);
+
 	/* If we didn't flush the entire list, we could have told the driver
 	 * there was more coming, but that turned out to be a lie.
 	 */
@@ -2674,6 +2678,7 @@ static void blk_mq_plug_issue_direct(struct blk_plug *plug)
 
 		if (hctx != rq->mq_hctx) {
 			if (hctx) {
+				blk_mq_debugfs_account_dispatch(hctx, queued);
 				blk_mq_commit_rqs(hctx, queued, false);
 				queued = 0;
 			}
@@ -2697,6 +2702,7 @@ static void blk_mq_plug_issue_direct(struct blk_plug *plug)
 	}
 
 out:
+	blk_mq_debugfs_account_dispatch(hctx, queued);
 	if (ret != BLK_STS_OK)
 		blk_mq_commit_rqs(hctx, queued, false);
 }
@@ -2737,6 +2743,7 @@ static void blk_mq_dispatch_plug_list(struct blk_plug *plug, bool from_sched)
 
 	plug->mq_list = requeue_list;
 	trace_block_unplug(this_hctx->queue, depth, !from_sched);
+	blk_mq_debugfs_account_plug(this_hctx, depth);
 
 	percpu_ref_get(&this_hctx->queue->q_usage_counter);
 	/* passthrough requests should never be issued to the I/O scheduler */
@@ -2757,7 +2764,9 @@ static void blk_mq_dispatch_plug_list(struct blk_plug *plug, bool from_sched)
 
 void blk_mq_flush_plug_list(struct blk_plug *plug, bool from_schedule)
 {
+	struct blk_mq_hw_ctx *hctx;
 	struct request *rq;
+	unsigned int count;
 
 	/*
 	 * We may have been called recursively midway through handling
@@ -2768,6 +2777,7 @@ void blk_mq_flush_plug_list(struct blk_plug *plug, bool from_schedule)
 	 */
 	if (plug->rq_count == 0)
 		return;
+	count = plug->rq_count;
 	plug->rq_count = 0;
 
 	if (!plug->multiple_queues && !plug->has_elevator && !from_schedule) {
@@ -2775,6 +2785,7 @@ void blk_mq_flush_plug_list(struct blk_plug *plug, bool from_schedule)
 
 		rq = rq_list_peek(&plug->mq_list);
 		q = rq->q;
+		hctx = rq->mq_hctx;
 
 		/*
 		 * Peek first request and see if we have a ->queue_rqs() hook.
@@ -2786,18 +2797,26 @@ void blk_mq_flush_plug_list(struct blk_plug *plug, bool from_schedule)
 			blk_mq_run_dispatch_ops(q,
 				__blk_mq_flush_plug_list(q, plug));
 			if (rq_list_empty(plug->mq_list))
-				return;
+				goto out_account;
 		}
 
 		blk_mq_run_dispatch_ops(q,
 				blk_mq_plug_issue_direct(plug));
 		if (rq_list_empty(plug->mq_list))
-			return;
+			goto out_account;
 	}
 
 	do {
 		blk_mq_dispatch_plug_list(plug, from_schedule);
 	} while (!rq_list_empty(plug->mq_list));
+	return;
+
+out_account:
+	/*
+	 * The whole plug went out in one go, account it to the first hctx.
+	 * Plugs that fall back to per-hctx dispatch are accounted there.
+	 */
+	blk_mq_debugfs_account_plug(hctx, count);
 }
 
 static void blk_mq_try_issue_list_directly(struct blk_mq_hw_ctx *hctx,
@@ -79,6 +79,17 @@ struct dd_per_prio {
 	struct io_stats_per_prio stats;
 };
 
+/*
+ * Per-CPU staging list for requests inserted while dd->lock is contended.
+ * Staged requests are moved into the sort and FIFO lists in one batch, with
+ * dd->lock held, by the next dispatch.
+ */
+struct dd_staging {
+	spinlock_t lock;
+	struct list_head at_head;
+	struct list_head at_tail;
+};
+
 struct deadline_data {
 	/*
 	 * run time data
@@ -102,6 +113,10 @@ struct deadline_data {
 	int prio_aging_expire;
 
 	spinlock_t lock;
+
+	struct dd_staging __percpu *staging;
+	/* CPUs that may have requests on their staging list. */
+	cpumask_var_t staged_cpus;
 };
 
 /* Maps an I/O priority class to a deadline scheduler priority. */
@@ -451,6 +466,9 @@ static struct request *dd_dispatch_prio_aged_requests(struct deadline_data *dd,
 	return NULL;
 }
 
+static void dd_insert_staged(struct blk_mq_hw_ctx *hctx,
+			     struct list_head *free);
+
 /*
  * Called from blk_mq_run_hw_queue() -> __blk_mq_sched_dispatch_requests().
  *
@@ -465,8 +483,10 @@ static struct request *dd_dispatch_request(struct blk_mq_hw_ctx *hctx)
 	const unsigned long now = jiffies;
 	struct request *rq;
 	enum dd_prio prio;
+	LIST_HEAD(free);
 
 	spin_lock(&dd->lock);
+	dd_insert_staged(hctx, &free);
 	rq = dd_dispatch_prio_aged_requests(dd, now);
 	if (rq)
 		goto unlock;
@@ -484,6 +504,8 @@ static struct request *dd_dispatch_request(struct blk_mq_hw_ctx *hctx)
 unlock:
 	spin_unlock(&dd->lock);
 
+	blk_mq_free_requests(&free);
+
 	return rq;
 }
 
@@ -529,6 +551,14 @@ static void dd_exit_sched(struct elevator_queue *e)
 {
 	struct deadline_data *dd = e->elevator_data;
 	enum dd_prio prio;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct dd_staging *staging = per_cpu_ptr(dd->staging, cpu);
+
+		WARN_ON_ONCE(!list_empty(&staging->at_head));
+		WARN_ON_ONCE(!list_empty(&staging->at_tail));
+	}
 
 	for (prio = 0; prio <= DD_PRIO_MAX; prio++) {
 		struct dd_per_prio *per_prio = &dd->per_prio[prio];
@@ -548,6 +578,8 @@ static void dd_exit_sched(struct elevator_queue *e)
 			  stats->dispatched, atomic_read(&stats->completed));
 	}
 
+	free_cpumask_var(dd->staged_cpus);
+	free_percpu(dd->staging);
 	kfree(dd);
 }
 
@@ -560,6 +592,7 @@ static int dd_init_sched(struct request_queue *q, struct elevator_type *e)
 	struct elevator_queue *eq;
 	enum dd_prio prio;
 	int ret = -ENOMEM;
+	int cpu;
 
 	eq = elevator_alloc(q, e);
 	if (!eq)
@@ -569,6 +602,20 @@ static int dd_init_sched(struct request_queue *q, struct elevator_type *e)
 	if (!dd)
 		goto put_eq;
 
+	dd->staging = alloc_percpu(struct dd_staging);
+	if (!dd->staging)
+		goto free_dd;
+	if (!zalloc_cpumask_var(&dd->staged_cpus, GFP_KERNEL))
+		goto free_staging;
+
+	for_each_possible_cpu(cpu) {
+		struct dd_staging *staging = per_cpu_ptr(dd->staging, cpu);
+
+		spin_lock_init(&staging->lock);
+		INIT_LIST_HEAD(&staging->at_head);
+		INIT_LIST_HEAD(&staging->at_tail);
+	}
+
 	eq->elevator_data = dd;
 
 	for (prio = 0; prio <= DD_PRIO_MAX; prio++) {
@@ -595,6 +642,10 @@ static int dd_init_sched(struct request_queue *q, struct elevator_type *e)
 	q->elevator = eq;
 	return 0;
 
+free_staging:
+	free_percpu(dd->staging);
+free_dd:
+	kfree(dd);
 put_eq:
 	kobject_put(&eq->kobj);
 	return ret;
@@ -704,6 +755,19 @@ static void dd_insert_request(struct blk_mq_hw_ctx *hctx, struct request *rq,
 	}
 }
 
+static void dd_insert_request_list(struct blk_mq_hw_ctx *hctx,
+				   struct list_head *list, blk_insert_t flags,
+				   struct list_head *free)
+{
+	while (!list_empty(list)) {
+		struct request *rq;
+
+		rq = list_first_entry(list, struct request, queuelist);
+		list_del_init(&rq->queuelist);
+		dd_insert_request(hctx, rq, flags, free);
+	}
+}
+
 /*
  * Called from blk_mq_insert_request() or blk_mq_dispatch_plug_list().
  */
@@ -713,21 +777,69 @@ static void dd_insert_requests(struct blk_mq_hw_ctx *hctx,
 {
 	struct request_queue *q = hctx->queue;
 	struct deadline_data *dd = q->elevator->elevator_data;
+	struct dd_staging *staging;
 	LIST_HEAD(free);
+	int cpu;
 
-	spin_lock(&dd->lock);
-	while (!list_empty(list)) {
-		struct request *rq;
-
-		rq = list_first_entry(list, struct request, queuelist);
-		list_del_init(&rq->queuelist);
-		dd_insert_request(hctx, rq, flags, &free);
+	/*
+	 * If another context holds dd->lock, park the requests on a per-CPU
+	 * staging list instead of waiting for it. Bios cannot be merged into
+	 * staged requests until the next dispatch inserts them for real.
+	 */
+	if (!spin_trylock(&dd->lock)) {
+		cpu = raw_smp_processor_id();
+		staging = per_cpu_ptr(dd->staging, cpu);
+
+		spin_lock(&staging->lock);
+		if (flags & BLK_MQ_INSERT_AT_HEAD)
+			list_splice_init(list, &staging->at_head);
+		else
+			list_splice_tail_init(list, &staging->at_tail);
+		cpumask_set_cpu(cpu, dd->staged_cpus);
+		spin_unlock(&staging->lock);
+		return;
 	}
+
+	dd_insert_request_list(hctx, list, flags, &free);
 	spin_unlock(&dd->lock);
 
 	blk_mq_free_requests(&free);
 }
 
+/*
+ * Move all staged requests into the sort and FIFO lists. Called with
+ * dd->lock held from dd_dispatch_request().
+ */
+static void dd_insert_staged(struct blk_mq_hw_ctx *hctx,
+			     struct list_head *free)
+{
+	struct deadline_data *dd = hctx->queue->elevator->elevator_data;
+	int cpu;
+
+	lockdep_assert_held(&dd->lock);
+
+	for_each_cpu(cpu, dd->staged_cpus) {
+		struct dd_staging *staging = per_cpu_ptr(dd->staging, cpu);
+		LIST_HEAD(at_head);
+		LIST_HEAD(at_tail);
+
+		/*
+		 * Clear the bit before taking the staging lock. An insert that
+		 * races with us sets it again after adding to the list.
+		 */
+		cpumask_clear_cpu(cpu, dd->staged_cpus);
+
+		spin_lock(&staging->lock);
+		list_splice_init(&staging->at_head, &at_head);
+		list_splice_init(&staging->at_tail, &at_tail);
+		spin_unlock(&staging->lock);
+
+		dd_insert_request_list(hctx, &at_head, BLK_MQ_INSERT_AT_HEAD,
+				       free);
+		dd_insert_request_list(hctx, &at_tail, 0, free);
+	}
+}
+
 /* Callback from inside blk_mq_rq_ctx_init(). */
 static void dd_prepare_request(struct request *rq)
 {
@@ -766,6 +878,9 @@ static bool dd_has_work(struct blk_mq_hw_ctx *hctx)
 	struct deadline_data *dd = hctx->queue->elevator->elevator_data;
 	enum dd_prio prio;
 
+	if (!cpumask_empty(dd->staged_cpus))
+		return true;
+
 	for (prio = 0; prio <= DD_PRIO_MAX; prio++)
 		if (dd_has_work_for_prio(&dd->per_prio[prio]))
 			return true;
@@ -53,8 +53,12 @@ static void lz4_exit(struct crypto_tfm *tfm)
 static int __lz4_compress_crypto(const u8 *src, unsigned int slen,
 				 u8 *dst, unsigned int *dlen, void *ctx)
 {
-	int out_len = LZ4_compress_default(src, dst,
-		slen, *dlen, ctx);
+	int out_len;
+
+	if (slen == PAGE_SIZE)
+		out_len = LZ4_compress_page(src, dst, *dlen, ctx);
+	else
+		out_len = LZ4_compress_default(src, dst, slen, *dlen, ctx);
 
 	if (!out_len)
 		return -EINVAL;
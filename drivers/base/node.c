@@ -11,6 +11,7 @@
 #include <linux/notifier.h>
 #include <linux/node.h>
 #include <linux/hugetlb.h>
+#include <linux/mempolicy.h>
 #include <linux/compaction.h>
 #include <linux/cpumask.h>
 #include <linux/topology.h>
@@ -214,6 +215,10 @@ void node_set_perf_attrs(unsigned int nid, struct access_coordinate *coord,
 			break;
 		}
 	}
+
+	/* Bandwidth as seen from the CPUs feeds weighted interleave. */
+	if (access == ACCESS_COORDINATE_CPU)
+		mempolicy_set_node_perf(nid, coord);
 }
 EXPORT_SYMBOL_GPL(node_set_perf_attrs);
 
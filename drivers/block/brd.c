@@ -30,6 +30,10 @@
 /*
  * Each block ramdisk device has a xarray brd_pages of pages that stores
  * the pages containing the block device's contents.
+ *
+ * With a non-zero brd_order each xarray entry is a compound page of
+ * 1 << brd_order pages, so that a 2M chunk costs a single xarray slot and
+ * can be mapped by a single TLB entry.
  */
 struct brd_device {
 	int			brd_number;
@@ -41,14 +45,62 @@ struct brd_device {
 	 */
 	struct xarray	        brd_pages;
 	u64			brd_nr_pages;
+
+	unsigned int		brd_order;
+	int			brd_node;
 };
 
+static unsigned int rd_order;
+module_param(rd_order, uint, 0444);
+MODULE_PARM_DESC(rd_order, "Page allocation order of the backing store (9 for 2M pages on x86).");
+
+static int rd_node = NUMA_NO_NODE;
+module_param(rd_node, int, 0444);
+MODULE_PARM_DESC(rd_node, "NUMA node to allocate the backing store on (-1 for the local node).");
+
+static bool rd_interleave;
+module_param(rd_interleave, bool, 0444);
+MODULE_PARM_DESC(rd_interleave, "Interleave the backing store across all memory nodes.");
+
+static inline sector_t brd_chunk_sectors(struct brd_device *brd)
+{
+	return PAGE_SECTORS << brd->brd_order;
+}
+
+static inline pgoff_t brd_chunk_index(struct brd_device *brd, sector_t sector)
+{
+	return sector >> (PAGE_SECTORS_SHIFT + brd->brd_order);
+}
+
 /*
  * Look up and return a brd's page for a given sector.
  */
 static struct page *brd_lookup_page(struct brd_device *brd, sector_t sector)
 {
-	return xa_load(&brd->brd_pages, sector >> PAGE_SECTORS_SHIFT);
+	struct page *page;
+
+	page = xa_load(&brd->brd_pages, brd_chunk_index(brd, sector));
+	if (!page || !brd->brd_order)
+		return page;
+	return nth_page(page, (sector >> PAGE_SECTORS_SHIFT) &
+			      ((1UL << brd->brd_order) - 1));
+}
+
+/*
+ * Pick the node for a new chunk: either the fixed rd_node, or the next
+ * memory node in turn when interleaving. The rotor is not serialised, an
+ * occasional pair of chunks landing on the same node is harmless.
+ */
+static int brd_alloc_node(struct brd_device *brd)
+{
+	int node;
+
+	if (!rd_interleave)
+		return brd->brd_node;
+
+	node = next_node_in(READ_ONCE(brd->brd_node), node_states[N_MEMORY]);
+	WRITE_ONCE(brd->brd_node, node);
+	return node;
 }
 
 /*
@@ -56,26 +108,29 @@ static struct page *brd_lookup_page(struct brd_device *brd, sector_t sector)
  */
 static int brd_insert_page(struct brd_device *brd, sector_t sector, gfp_t gfp)
 {
-	pgoff_t idx = sector >> PAGE_SECTORS_SHIFT;
+	pgoff_t idx = brd_chunk_index(brd, sector);
 	struct page *page;
 	int ret = 0;
 
-	page = brd_lookup_page(brd, sector);
+	page = xa_load(&brd->brd_pages, idx);
 	if (page)
 		return 0;
 
-	page = alloc_page(gfp | __GFP_ZERO | __GFP_HIGHMEM);
+	gfp |= __GFP_ZERO | __GFP_HIGHMEM;
+	if (brd->brd_order)
+		gfp |= __GFP_COMP | __GFP_NOWARN;
+	page = alloc_pages_node(brd_alloc_node(brd), gfp, brd->brd_order);
 	if (!page)
 		return -ENOMEM;
 
 	xa_lock(&brd->brd_pages);
 	ret = __xa_insert(&brd->brd_pages, idx, page, gfp);
 	if (!ret)
-		brd->brd_nr_pages++;
+		brd->brd_nr_pages += 1UL << brd->brd_order;
 	xa_unlock(&brd->brd_pages);
 
 	if (ret < 0) {
-		__free_page(page);
+		__free_pages(page, brd->brd_order);
 		if (ret == -EBUSY)
 			ret = 0;
 	}
@@ -92,7 +147,7 @@ static void brd_free_pages(struct brd_device *brd)
 	pgoff_t idx;
 
 	xa_for_each(&brd->brd_pages, idx, page) {
-		__free_page(page);
+		__free_pages(page, brd->brd_order);
 		cond_resched();
 	}
 
@@ -224,17 +279,24 @@ static int brd_do_bvec(struct brd_device *brd, struct page *page,
 
 static void brd_do_discard(struct brd_device *brd, sector_t sector, u32 size)
 {
-	sector_t aligned_sector = (sector + PAGE_SECTORS) & ~PAGE_SECTORS;
+	sector_t chunk_sectors = brd_chunk_sectors(brd);
+	sector_t aligned_sector = round_up(sector, chunk_sectors);
+	u32 chunk_size = chunk_sectors << SECTOR_SHIFT;
 	struct page *page;
 
+	if ((aligned_sector - sector) * SECTOR_SIZE >= size)
+		return;
 	size -= (aligned_sector - sector) * SECTOR_SIZE;
 	xa_lock(&brd->brd_pages);
-	while (size >= PAGE_SIZE && aligned_sector < rd_size * 2) {
-		page = __xa_erase(&brd->brd_pages, aligned_sector >> PAGE_SECTORS_SHIFT);
-		if (page)
-			__free_page(page);
-		aligned_sector += PAGE_SECTORS;
-		size -= PAGE_SIZE;
+	while (size >= chunk_size && aligned_sector < rd_size * 2) {
+		page = __xa_erase(&brd->brd_pages,
+				  brd_chunk_index(brd, aligned_sector));
+		if (page) {
+			__free_pages(page, brd->brd_order);
+			brd->brd_nr_pages -= 1UL << brd->brd_order;
+		}
+		aligned_sector += chunk_sectors;
+		size -= chunk_size;
 	}
 	xa_unlock(&brd->brd_pages);
 }
@@ -334,7 +396,7 @@ static int brd_alloc(int i)
 		.physical_block_size	= PAGE_SIZE,
 		.max_hw_discard_sectors	= UINT_MAX,
 		.max_discard_segments	= 1,
-		.discard_granularity	= PAGE_SIZE,
+		.discard_granularity	= PAGE_SIZE << rd_order,
 	};
 
 	list_for_each_entry(brd, &brd_devices, brd_list)
@@ -344,6 +406,8 @@ static int brd_alloc(int i)
 	if (!brd)
 		return -ENOMEM;
 	brd->brd_number		= i;
+	brd->brd_order		= rd_order;
+	brd->brd_node		= rd_node;
 	list_add_tail(&brd->brd_list, &brd_devices);
 
 	xa_init(&brd->brd_pages);
@@ -353,7 +417,7 @@ static int brd_alloc(int i)
 		debugfs_create_u64(buf, 0444, brd_debugfs_dir,
 				&brd->brd_nr_pages);
 
-	disk = brd->brd_disk = blk_alloc_disk(&lim, NUMA_NO_NODE);
+	disk = brd->brd_disk = blk_alloc_disk(&lim, rd_interleave ? NUMA_NO_NODE : rd_node);
 	if (IS_ERR(disk)) {
 		err = PTR_ERR(disk);
 		goto out_free_dev;
@@ -421,6 +485,20 @@ static inline void brd_check_and_reset_par(void)
 			DISK_MAX_PARTS, DISK_MAX_PARTS);
 		max_part = DISK_MAX_PARTS;
 	}
+
+	if (rd_order > MAX_PAGE_ORDER) {
+		pr_info("brd: rd_order can't be larger than %d, reset rd_order = 0.\n",
+			MAX_PAGE_ORDER);
+		rd_order = 0;
+	}
+
+	if (rd_node != NUMA_NO_NODE &&
+	    (rd_node < 0 || rd_node >= MAX_NUMNODES ||
+	     !node_state(rd_node, N_MEMORY))) {
+		pr_info("brd: rd_node %d has no memory, reset rd_node = -1.\n",
+			rd_node);
+		rd_node = NUMA_NO_NODE;
+	}
 }
 
 static int __init brd_init(void)
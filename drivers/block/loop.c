@@ -81,6 +81,8 @@ struct loop_device {
 struct loop_cmd {
 	struct list_head list_entry;
 	bool use_aio; /* use AIO interface to handle I/O */
+	bool nowait; /* issued from ->queue_rq with IOCB_NOWAIT */
+	bool no_nowait; /* got -EAGAIN, leave this request to the worker */
 	atomic_t ref; /* only for aio */
 	long ret;
 	struct kiocb iocb;
@@ -360,6 +362,17 @@ static void lo_complete_rq(struct request *rq)
 	struct loop_cmd *cmd = blk_mq_rq_to_pdu(rq);
 	blk_status_t ret = BLK_STS_OK;
 
+	/*
+	 * The backing file could not take the I/O without blocking after all,
+	 * send the request around again and let the worker issue it.
+	 */
+	if (cmd->nowait && cmd->ret == -EAGAIN) {
+		cmd->ret = 0;
+		cmd->no_nowait = true;
+		blk_mq_requeue_request(rq, true);
+		return;
+	}
+
 	if (!cmd->use_aio || cmd->ret < 0 || cmd->ret == blk_rq_bytes(rq) ||
 	    req_op(rq) != REQ_OP_READ) {
 		if (cmd->ret < 0)
@@ -386,6 +399,7 @@ static void lo_complete_rq(struct request *rq)
 		}
 		ret = BLK_STS_IOERR;
 end_io:
+		cmd->no_nowait = false;
 		blk_mq_end_request(rq, ret);
 	}
 }
@@ -430,9 +444,9 @@ static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
 	if (rq->bio != rq->biotail) {
 
 		bvec = kmalloc_array(nr_bvec, sizeof(struct bio_vec),
-				     GFP_NOIO);
+				     cmd->nowait ? GFP_NOWAIT : GFP_NOIO);
 		if (!bvec)
-			return -EIO;
+			return cmd->nowait ? -EAGAIN : -EIO;
 		cmd->bvec = bvec;
 
 		/*
@@ -465,6 +479,8 @@ static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
 	cmd->iocb.ki_filp = file;
 	cmd->iocb.ki_complete = lo_rw_aio_complete;
 	cmd->iocb.ki_flags = IOCB_DIRECT;
+	if (cmd->nowait)
+		cmd->iocb.ki_flags |= IOCB_NOWAIT;
 	cmd->iocb.ki_ioprio = IOPRIO_PRIO_VALUE(IOPRIO_CLASS_NONE, 0);
 
 	if (rw == ITER_SOURCE)
@@ -472,6 +488,12 @@ static int lo_rw_aio(struct loop_device *lo, struct loop_cmd *cmd,
 	else
 		ret = file->f_op->read_iter(&cmd->iocb, &iter);
 
+	if (cmd->nowait && ret == -EAGAIN) {
+		kfree(cmd->bvec);
+		cmd->bvec = NULL;
+		return -EAGAIN;
+	}
+
 	lo_rw_aio_do_completion(cmd);
 
 	if (ret != -EIOCBQUEUED)
@@ -1853,9 +1875,44 @@ static const struct kernel_param_ops loop_hw_qdepth_param_ops = {
 device_param_cb(hw_queue_depth, &loop_hw_qdepth_param_ops, &hw_queue_depth, 0444);
 MODULE_PARM_DESC(hw_queue_depth, "Queue depth for each hardware queue. Default: " __stringify(LOOP_DEFAULT_HW_Q_DEPTH));
 
+static bool nowait;
+module_param(nowait, bool, 0644);
+MODULE_PARM_DESC(nowait, "Issue direct I/O to backing files that support IOCB_NOWAIT from the submitting context");
+
 MODULE_LICENSE("GPL");
 MODULE_ALIAS_BLOCKDEV_MAJOR(LOOP_MAJOR);
 
+/*
+ * Try to issue a direct I/O read or write straight from ->queue_rq, which
+ * saves the hop through the worker. Returns false if the backing file
+ * would have blocked, in which case the caller queues the request to the
+ * worker as usual.
+ */
+static bool loop_try_nowait(struct loop_device *lo, struct loop_cmd *cmd)
+{
+	struct request *rq = blk_mq_rq_from_pdu(cmd);
+	loff_t pos = ((loff_t) blk_rq_pos(rq) << 9) + lo->lo_offset;
+	unsigned int noio_flags;
+	int ret;
+
+	if (!READ_ONCE(nowait) || !cmd->use_aio || cmd->no_nowait ||
+	    !(lo->lo_backing_file->f_mode & FMODE_NOWAIT))
+		return false;
+	if (req_op(rq) == REQ_OP_WRITE && (lo->lo_flags & LO_FLAGS_READ_ONLY))
+		return false;
+
+	cmd->nowait = true;
+	noio_flags = memalloc_noio_save();
+	ret = lo_rw_aio(lo, cmd, pos,
+			req_op(rq) == REQ_OP_WRITE ? ITER_SOURCE : ITER_DEST);
+	memalloc_noio_restore(noio_flags);
+	if (ret) {
+		cmd->nowait = false;
+		return false;
+	}
+	return true;
+}
+
 static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 		const struct blk_mq_queue_data *bd)
 {
@@ -1879,6 +1936,10 @@ static blk_status_t loop_queue_rq(struct blk_mq_hw_ctx *hctx,
 		break;
 	}
 
+	cmd->nowait = false;
+	if (loop_try_nowait(lo, cmd))
+		return BLK_STS_OK;
+
 	/* always use the first bio's css */
 	cmd->blkcg_css = NULL;
 	cmd->memcg_css = NULL;
@@ -0,0 +1,343 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Completion latency distributions for null_blk timer mode.
+ *
+ * A distribution is configured per operation type through the configfs
+ * read_latency and write_latency attributes, using one of:
+ *
+ *   fixed[:<nsec>]		constant delay, completion_nsec if omitted
+ *   uniform:<min>,<max>	uniform in [min, max]
+ *   exp:<mean>[,<min>]		min + exponential with the given mean
+ *   lognormal:<median>,<sigma>	log-normal, sigma in thousandths
+ *   hist:<nsec>:<weight>,...	buckets of ascending upper bounds, sampled
+ *				uniformly inside the selected bucket
+ *
+ * All values are in nanoseconds. A histogram can be loaded from a file
+ * by simply writing the file to the attribute.
+ */
+#include <linux/int_log.h>
+#include <linux/math64.h>
+#include <linux/random.h>
+#include <linux/string.h>
+#include <linux/sysfs.h>
+#include "null_blk.h"
+
+#define NULL_LAT_MAX_BUCKETS	64
+#define NULL_LAT_MAX_SIGMA	10000
+
+/* Cap on any sampled delay, to keep the long tail from wedging the queue. */
+#define NULL_LAT_MAX_NSEC	(10ULL * NSEC_PER_SEC)
+
+/* ln(2) and log2(e) in 8.24 fixed point. */
+#define NULL_LAT_LN2_FP		11629080ULL
+#define NULL_LAT_LOG2E_FP	24204406ULL
+
+static const char * const null_lat_names[] = {
+	[NULL_LAT_FIXED]	= "fixed",
+	[NULL_LAT_UNIFORM]	= "uniform",
+	[NULL_LAT_EXP]		= "exp",
+	[NULL_LAT_LOGNORMAL]	= "lognormal",
+	[NULL_LAT_HIST]		= "hist",
+};
+
+static u64 null_lat_rand_range(u64 lo, u64 hi)
+{
+	if (hi <= lo)
+		return lo;
+	return lo + mul_u64_u64_shr(get_random_u64(), hi - lo + 1, 64);
+}
+
+/* -ln(U) for U uniform in (0, 1], in 8.24 fixed point. */
+static u64 null_lat_neg_ln_uniform(void)
+{
+	u32 u = get_random_u32() | 1;
+
+	return (((32ULL << 24) - intlog2(u)) * NULL_LAT_LN2_FP) >> 24;
+}
+
+/*
+ * 2^x for x in 8.24 fixed point, returned in 8.24 fixed point. The
+ * fractional part uses a cubic fit that is good to about 1e-4, which is
+ * plenty for a synthetic delay.
+ */
+static u64 null_lat_exp2(s64 x)
+{
+	s64 ip = x >> 24;
+	u64 f = x & ((1 << 24) - 1);
+	u64 r;
+
+	/* 1 + 0.6951 f + 0.2262 f^2 + 0.0787 f^3 */
+	r = (1 << 24) + ((f * 11661843) >> 24);
+	r += (((f * f) >> 24) * 3795006) >> 24;
+	r += (((((f * f) >> 24) * f) >> 24) * 1320367) >> 24;
+
+	if (ip >= 0)
+		return ip >= 32 ? U64_MAX : r << ip;
+	return ip <= -32 ? 0 : r >> -ip;
+}
+
+/* Standard normal deviate via the Irwin-Hall sum of 12 uniforms. */
+static s64 null_lat_normal(void)
+{
+	s64 sum = 0;
+	int i;
+
+	for (i = 0; i < 12; i++)
+		sum += get_random_u32() >> 8;
+	return sum - (6LL << 24);
+}
+
+static u64 null_lat_sample_lognormal(const struct nullb_lat_dist *dist)
+{
+	s64 y = div_s64(null_lat_normal() * (s64)dist->p2, 1000);
+	u64 scale;
+
+	/* e^y = 2^(y * log2(e)) */
+	y = (y * (s64)NULL_LAT_LOG2E_FP) >> 24;
+	scale = null_lat_exp2(y);
+	if (scale == U64_MAX)
+		return NULL_LAT_MAX_NSEC;
+	return mul_u64_u64_shr(dist->p1, scale, 24);
+}
+
+static u64 null_lat_sample_hist(const struct nullb_lat_dist *dist)
+{
+	u32 r = get_random_u32_below(dist->total_weight);
+	u64 lo = 0;
+	unsigned int i;
+
+	for (i = 0; i < dist->nr_buckets; i++) {
+		const struct nullb_lat_bucket *b = &dist->buckets[i];
+
+		if (r < b->cum_weight)
+			return null_lat_rand_range(lo, b->nsec);
+		lo = b->nsec + 1;
+	}
+	return dist->buckets[dist->nr_buckets - 1].nsec;
+}
+
+/**
+ * null_lat_dist_sample - draw a completion delay from a distribution
+ * @dist: distribution, may be NULL
+ * @default_nsec: delay used for a missing or argument-less fixed distribution
+ *
+ * Return: the delay in nanoseconds.
+ */
+u64 null_lat_dist_sample(const struct nullb_lat_dist *dist, u64 default_nsec)
+{
+	u64 nsec;
+
+	if (!dist)
+		return default_nsec;
+
+	switch (dist->type) {
+	case NULL_LAT_FIXED:
+		nsec = dist->p1 ? dist->p1 : default_nsec;
+		break;
+	case NULL_LAT_UNIFORM:
+		nsec = null_lat_rand_range(dist->p1, dist->p2);
+		break;
+	case NULL_LAT_EXP:
+		nsec = dist->p2 + mul_u64_u64_shr(dist->p1,
+						  null_lat_neg_ln_uniform(), 24);
+		break;
+	case NULL_LAT_LOGNORMAL:
+		nsec = null_lat_sample_lognormal(dist);
+		break;
+	case NULL_LAT_HIST:
+		nsec = null_lat_sample_hist(dist);
+		break;
+	default:
+		nsec = default_nsec;
+		break;
+	}
+
+	return min(nsec, NULL_LAT_MAX_NSEC);
+}
+
+static int null_lat_parse_pair(char *args, u64 *a, u64 *b, bool b_optional)
+{
+	char *second;
+	int ret;
+
+	second = strchr(args, ',');
+	if (second)
+		*second++ = '\0';
+	else if (!b_optional)
+		return -EINVAL;
+
+	ret = kstrtou64(args, 0, a);
+	if (ret)
+		return ret;
+	if (second)
+		return kstrtou64(second, 0, b);
+	return 0;
+}
+
+static int null_lat_parse_hist(char *args, struct nullb_lat_dist *dist)
+{
+	u64 prev = 0, cum = 0;
+	char *tok;
+	int ret;
+
+	while ((tok = strsep(&args, ",\n")) != NULL) {
+		struct nullb_lat_bucket *b;
+		char *weight;
+		u64 nsec;
+		u32 w;
+
+		tok = strim(tok);
+		if (!*tok)
+			continue;
+		if (dist->nr_buckets == NULL_LAT_MAX_BUCKETS)
+			return -E2BIG;
+
+		weight = strchr(tok, ':');
+		if (!weight)
+			return -EINVAL;
+		*weight++ = '\0';
+
+		ret = kstrtou64(tok, 0, &nsec);
+		if (ret)
+			return ret;
+		ret = kstrtou32(weight, 0, &w);
+		if (ret)
+			return ret;
+		if (dist->nr_buckets && nsec <= prev)
+			return -EINVAL;
+
+		cum += w;
+		if (cum > U32_MAX)
+			return -ERANGE;
+
+		b = &dist->buckets[dist->nr_buckets++];
+		b->nsec = nsec;
+		b->cum_weight = cum;
+		prev = nsec;
+	}
+
+	if (!cum)
+		return -EINVAL;
+	dist->total_weight = cum;
+	return 0;
+}
+
+/**
+ * null_lat_dist_parse - parse a distribution written to configfs
+ * @page: user supplied buffer
+ * @count: length of @page
+ * @distp: on success, the newly allocated distribution
+ *
+ * Return: 0 on success, or a negative errno.
+ */
+int null_lat_dist_parse(const char *page, size_t count,
+			struct nullb_lat_dist **distp)
+{
+	struct nullb_lat_dist *dist;
+	char *orig, *buf, *args;
+	int type, ret;
+
+	orig = kstrndup(page, count, GFP_KERNEL);
+	if (!orig)
+		return -ENOMEM;
+
+	buf = strim(orig);
+	args = strchr(buf, ':');
+	if (args)
+		*args++ = '\0';
+
+	ret = -EINVAL;
+	type = match_string(null_lat_names, ARRAY_SIZE(null_lat_names), buf);
+	if (type < 0)
+		goto out;
+
+	ret = -ENOMEM;
+	dist = kzalloc(struct_size(dist, buckets,
+				   type == NULL_LAT_HIST ? NULL_LAT_MAX_BUCKETS : 0),
+		       GFP_KERNEL);
+	if (!dist)
+		goto out;
+	dist->type = type;
+
+	ret = -EINVAL;
+	switch (dist->type) {
+	case NULL_LAT_FIXED:
+		ret = args ? kstrtou64(args, 0, &dist->p1) : 0;
+		break;
+	case NULL_LAT_UNIFORM:
+		if (args)
+			ret = null_lat_parse_pair(args, &dist->p1, &dist->p2,
+						  false);
+		if (!ret && dist->p1 > dist->p2)
+			ret = -EINVAL;
+		break;
+	case NULL_LAT_EXP:
+		if (args)
+			ret = null_lat_parse_pair(args, &dist->p1, &dist->p2,
+						  true);
+		break;
+	case NULL_LAT_LOGNORMAL:
+		if (args)
+			ret = null_lat_parse_pair(args, &dist->p1, &dist->p2,
+						  false);
+		if (!ret && dist->p2 > NULL_LAT_MAX_SIGMA)
+			ret = -EINVAL;
+		break;
+	case NULL_LAT_HIST:
+		if (args)
+			ret = null_lat_parse_hist(args, dist);
+		break;
+	}
+
+	if (ret)
+		kfree(dist);
+	else
+		*distp = dist;
+out:
+	kfree(orig);
+	return ret;
+}
+
+/**
+ * null_lat_dist_show - format a distribution in the syntax it was set with
+ * @dist: distribution, NULL shows as the default fixed distribution
+ * @page: configfs output buffer
+ *
+ * Return: number of bytes written to @page.
+ */
+ssize_t null_lat_dist_show(const struct nullb_lat_dist *dist, char *page)
+{
+	ssize_t len;
+	unsigned int i;
+
+	if (!dist)
+		return sysfs_emit(page, "fixed\n");
+
+	len = sysfs_emit(page, "%s", null_lat_names[dist->type]);
+	switch (dist->type) {
+	case NULL_LAT_FIXED:
+		if (dist->p1)
+			len += sysfs_emit_at(page, len, ":%llu", dist->p1);
+		break;
+	case NULL_LAT_UNIFORM:
+	case NULL_LAT_EXP:
+	case NULL_LAT_LOGNORMAL:
+		len += sysfs_emit_at(page, len, ":%llu,%llu", dist->p1,
+				     dist->p2);
+		break;
+	case NULL_LAT_HIST:
+		for (i = 0; i < dist->nr_buckets; i++) {
+			u32 w = dist->buckets[i].cum_weight;
+
+			if (i)
+				w -= dist->buckets[i - 1].cum_weight;
+			len += sysfs_emit_at(page, len, "%c%llu:%u",
+					     i ? ',' : ':',
+					     dist->buckets[i].nsec, w);
+		}
+		break;
+	}
+	len += sysfs_emit_at(page, len, "\n");
+
+	return len;
+}
@@ -510,6 +510,67 @@ static ssize_t nullb_device_power_store(struct config_item *item,
 
 CONFIGFS_ATTR(nullb_device_, power);
 
+static ssize_t nullb_device_lat_dist_show(struct nullb_lat_dist __rcu **distp,
+					  char *page)
+{
+	ssize_t ret;
+
+	mutex_lock(&lock);
+	ret = null_lat_dist_show(rcu_dereference_protected(*distp,
+					lockdep_is_held(&lock)), page);
+	mutex_unlock(&lock);
+	return ret;
+}
+
+static ssize_t nullb_device_lat_dist_store(struct nullb_lat_dist __rcu **distp,
+					   const char *page, size_t count)
+{
+	struct nullb_lat_dist *dist, *old;
+	int ret;
+
+	ret = null_lat_dist_parse(page, count, &dist);
+	if (ret)
+		return ret;
+
+	/* May be changed while the device is up, the timer path uses RCU. */
+	mutex_lock(&lock);
+	old = rcu_replace_pointer(*distp, dist, lockdep_is_held(&lock));
+	mutex_unlock(&lock);
+	if (old)
+		kfree_rcu(old, rcu);
+	return count;
+}
+
+static ssize_t nullb_device_read_latency_show(struct config_item *item,
+					      char *page)
+{
+	return nullb_device_lat_dist_show(&to_nullb_device(item)->read_latency,
+					  page);
+}
+
+static ssize_t nullb_device_read_latency_store(struct config_item *item,
+					       const char *page, size_t count)
+{
+	return nullb_device_lat_dist_store(&to_nullb_device(item)->read_latency,
+					   page, count);
+}
+CONFIGFS_ATTR(nullb_device_, read_latency);
+
+static ssize_t nullb_device_write_latency_show(struct config_item *item,
+					       char *page)
+{
+	return nullb_device_lat_dist_show(&to_nullb_device(item)->write_latency,
+					  page);
+}
+
+static ssize_t nullb_device_write_latency_store(struct config_item *item,
+						const char *page, size_t count)
+{
+	return nullb_device_lat_dist_store(&to_nullb_device(item)->write_latency,
+					   page, count);
+}
+CONFIGFS_ATTR(nullb_device_, write_latency);
+
 static ssize_t nullb_device_badblocks_show(struct config_item *item, char *page)
 {
 	struct nullb_device *t_dev = to_nullb_device(item);
@@ -584,6 +645,8 @@ CONFIGFS_ATTR_WO(nullb_device_, zone_offline);
 static struct configfs_attribute *nullb_device_attrs[] = {
 	&nullb_device_attr_size,
 	&nullb_device_attr_completion_nsec,
+	&nullb_device_attr_read_latency,
+	&nullb_device_attr_write_latency,
 	&nullb_device_attr_submit_queues,
 	&nullb_device_attr_poll_queues,
 	&nullb_device_attr_home_node,
@@ -696,11 +759,12 @@ static ssize_t memb_group_features_show(struct config_item *item, char *page)
 			"badblocks,blocking,blocksize,cache_size,fua,"
 			"completion_nsec,discard,home_node,hw_queue_depth,"
 			"irqmode,max_sectors,mbps,memory_backed,no_sched,"
-			"poll_queues,power,queue_mode,shared_tag_bitmap,"
-			"shared_tags,size,submit_queues,use_per_node_hctx,"
-			"virt_boundary,zoned,zone_capacity,zone_max_active,"
-			"zone_max_open,zone_nr_conv,zone_offline,zone_readonly,"
-			"zone_size,zone_append_max_sectors\n");
+			"poll_queues,power,queue_mode,read_latency,"
+			"shared_tag_bitmap,shared_tags,size,submit_queues,"
+			"use_per_node_hctx,virt_boundary,write_latency,zoned,"
+			"zone_capacity,zone_max_active,zone_max_open,"
+			"zone_nr_conv,zone_offline,zone_readonly,zone_size,"
+			"zone_append_max_sectors\n");
 }
 
 CONFIGFS_ATTR_RO(memb_group_, features);
@@ -797,6 +861,8 @@ static void null_free_dev(struct nullb_device *dev)
 
 	null_free_zoned_dev(dev);
 	badblocks_exit(&dev->badblocks);
+	kfree(rcu_dereference_raw(dev->read_latency));
+	kfree(rcu_dereference_raw(dev->write_latency));
 	kfree(dev);
 }
 
@@ -810,7 +876,17 @@ static enum hrtimer_restart null_cmd_timer_expired(struct hrtimer *timer)
 
 static void null_cmd_end_timer(struct nullb_cmd *cmd)
 {
-	ktime_t kt = cmd->nq->dev->completion_nsec;
+	struct nullb_device *dev = cmd->nq->dev;
+	struct nullb_lat_dist *dist;
+	ktime_t kt;
+
+	rcu_read_lock();
+	if (op_is_write(req_op(blk_mq_rq_from_pdu(cmd))))
+		dist = rcu_dereference(dev->write_latency);
+	else
+		dist = rcu_dereference(dev->read_latency);
+	kt = null_lat_dist_sample(dist, dev->completion_nsec);
+	rcu_read_unlock();
 
 	hrtimer_start(&cmd->timer, kt, HRTIMER_MODE_REL);
 }
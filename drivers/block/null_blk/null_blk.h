@@ -30,6 +30,28 @@ struct nullb_queue {
 	spinlock_t poll_lock;
 };
 
+enum null_lat_type {
+	NULL_LAT_FIXED,
+	NULL_LAT_UNIFORM,
+	NULL_LAT_EXP,
+	NULL_LAT_LOGNORMAL,
+	NULL_LAT_HIST,
+};
+
+struct nullb_lat_bucket {
+	u64 nsec; /* upper bound of the bucket */
+	u32 cum_weight; /* sum of the weights up to and including this bucket */
+};
+
+struct nullb_lat_dist {
+	struct rcu_head rcu;
+	enum null_lat_type type;
+	u64 p1, p2; /* type specific parameters, see latency.c */
+	unsigned int nr_buckets;
+	u32 total_weight;
+	struct nullb_lat_bucket buckets[];
+};
+
 struct nullb_zone {
 	/*
 	 * Zone lock to prevent concurrent modification of a zone write
@@ -76,6 +98,8 @@ struct nullb_device {
 
 	unsigned long size; /* device size in MB */
 	unsigned long completion_nsec; /* time in ns to complete a request */
+	struct nullb_lat_dist __rcu *read_latency; /* read completion time distribution */
+	struct nullb_lat_dist __rcu *write_latency; /* write completion time distribution */
 	unsigned long cache_size; /* disk cache size in MB */
 	unsigned long zone_size; /* zone size in MB if device is zoned */
 	unsigned long zone_capacity; /* zone capacity in MB if device is zoned */
@@ -125,6 +149,11 @@ struct nullb {
 	char disk_name[DISK_NAME_LEN];
 };
 
+u64 null_lat_dist_sample(const struct nullb_lat_dist *dist, u64 default_nsec);
+int null_lat_dist_parse(const char *page, size_t count,
+			struct nullb_lat_dist **distp);
+ssize_t null_lat_dist_show(const struct nullb_lat_dist *dist, char *page);
+
 blk_status_t null_handle_discard(struct nullb_device *dev, sector_t sector,
 				 sector_t nr_sectors);
 blk_status_t null_process_cmd(struct nullb_cmd *cmd, enum req_op op,
@@ -4,15 +4,16 @@
 //!
 //! Supported features:
 //!
-//! - optional memory backing
+//! - optional memory backing, with configurable chunk size
 //! - blk-mq interface
 //! - direct completion
 //! - softirq completion
 //! - timer completion
+//! - polled completion
 //!
 //! The driver is configured at module load time by parameters
-//! `param_memory_backed`, `param_capacity_mib`, `param_irq_mode` and
-//! `param_completion_time_nsec!.
+//! `param_memory_backed`, `param_capacity_mib`, `param_irq_mode`,
+//! `param_chunk_order`, `param_poll_queues` and `param_completion_time_nsec!.
 
 use core::ops::Deref;
 
@@ -70,6 +71,16 @@
             permissions: 0,
             description: "Block size in bytes",
         },
+        param_chunk_order: u8 {
+            default: 0,
+            permissions: 0,
+            description: "Memory backing chunk order, pages per tree slot is 2^order (max 9)",
+        },
+        param_poll_queues: u32 {
+            default: 0,
+            permissions: 0,
+            description: "Number of IOPOLL submission queues",
+        },
     },
 }
 
@@ -103,11 +114,24 @@ struct NullBlkModule {
 impl kernel::Module for NullBlkModule {
     fn init(_module: &'static ThisModule) -> Result<Self> {
         pr_info!("Rust null_blk loaded\n");
-        let tagset = Arc::pin_init(TagSet::new(1, (), 256, 1), flags::GFP_KERNEL)?;
+
+        // Poll queues live in their own `HCTX_TYPE_POLL` map, which requires
+        // the tag set to carry all three map types.
+        let poll_queues = *param_poll_queues.read();
+        let nr_maps = if poll_queues > 0 { bindings::hctx_type_HCTX_MAX_TYPES } else { 1 };
+        let tagset = Arc::pin_init(
+            TagSet::new(SUBMIT_QUEUES + poll_queues, (), QUEUE_DEPTH, nr_maps),
+            flags::GFP_KERNEL,
+        )?;
 
         let irq_mode = (*param_irq_mode.read()).try_into()?;
         let block_size = *param_block_size.read();
 
+        let chunk_order = u32::from(*param_chunk_order.read());
+        if chunk_order > MAX_CHUNK_ORDER {
+            return Err(kernel::error::code::EINVAL);
+        }
+
         let queue_data = Box::pin_init(pin_init!(
             QueueData {
                 tree <- TreeContainer::new(),
@@ -115,6 +139,7 @@ fn init(_module: &'static ThisModule) -> Result<Self> {
                 irq_mode,
                 memory_backed: *param_memory_backed.read(),
                 block_size,
+                chunk_order,
             }),
             flags::GFP_KERNEL,
         )?;
@@ -141,8 +166,33 @@ fn drop(self: Pin<&mut Self>) {
 
 struct NullBlkDevice;
 
-type Tree = XArray<Box<Page>>;
+const SUBMIT_QUEUES: u32 = 1;
+const QUEUE_DEPTH: u32 = 256;
+// 2 MiB per tree slot with 4K pages.
+const MAX_CHUNK_ORDER: u32 = 9;
+
+/// A run of `1 << chunk_order` pages stored in a single tree slot.
+///
+/// Backing a slot with more than one page means that large sequential I/O
+/// only has to walk the tree once per chunk rather than once per page.
+struct Chunk {
+    pages: Vec<Page>,
+}
+
+impl Chunk {
+    fn new(order: u32) -> Result<Self> {
+        let nr_pages = 1usize << order;
+        let mut pages = Vec::with_capacity(nr_pages, flags::GFP_KERNEL)?;
+        for _ in 0..nr_pages {
+            pages.push(Page::new()?, flags::GFP_KERNEL)?;
+        }
+        Ok(Self { pages })
+    }
+}
+
+type Tree = XArray<Box<Chunk>>;
 type TreeRef<'a> = &'a Tree;
+type ChunkGuard<'a> = kernel::xarray::Guard<'a, Box<Chunk>>;
 
 #[pin_data]
 struct TreeContainer {
@@ -186,31 +236,81 @@ struct QueueData {
     irq_mode: IRQMode,
     memory_backed: bool,
     block_size: u16,
+    chunk_order: u32,
 }
 
-impl NullBlkDevice {
+/// Walks the tree for the segments of a single request.
+///
+/// The chunk that backs the previous segment is kept locked, so consecutive
+/// segments that land in the same chunk do not repeat the tree lookup.
+struct TreeCursor<'a> {
+    tree: TreeRef<'a>,
+    chunk_order: u32,
+    cached: Option<(usize, Option<ChunkGuard<'a>>)>,
+}
+
+impl<'a> TreeCursor<'a> {
+    fn new(tree: TreeRef<'a>, chunk_order: u32) -> Self {
+        Self {
+            tree,
+            chunk_order,
+            cached: None,
+        }
+    }
+
+    #[inline(always)]
+    fn split(&self, sector: usize) -> (usize, usize) {
+        let page_idx = sector >> bindings::PAGE_SECTORS_SHIFT;
+        (
+            page_idx >> self.chunk_order,
+            page_idx & ((1 << self.chunk_order) - 1),
+        )
+    }
+
+    /// Returns the chunk at `idx`, allocating it if `alloc` is set.
     #[inline(always)]
-    fn write(tree: TreeRef<'_>, sector: usize, segment: &Segment<'_>) -> Result {
-        let idx = sector >> bindings::PAGE_SECTORS_SHIFT;
-
-        let mut page = if let Some(page) = tree.get_locked(idx) {
-            page
-        } else {
-            tree.set(idx, Box::new(Page::new()?, flags::GFP_KERNEL)?)?;
-            tree.get_locked(idx).unwrap()
+    fn chunk(&mut self, idx: usize, alloc: bool) -> Result<Option<&mut ChunkGuard<'a>>> {
+        let hit = match &self.cached {
+            Some((cached, chunk)) => *cached == idx && (chunk.is_some() || !alloc),
+            None => false,
         };
 
-        segment.copy_to_page(&mut page)?;
+        if !hit {
+            // Drop the old guard first, its lock must not be held while we
+            // modify the tree.
+            self.cached = None;
+
+            let mut chunk = self.tree.get_locked(idx);
+            if chunk.is_none() && alloc {
+                self.tree
+                    .set(idx, Box::new(Chunk::new(self.chunk_order)?, flags::GFP_KERNEL)?)?;
+                chunk = self.tree.get_locked(idx);
+            }
+            self.cached = Some((idx, chunk));
+        }
+
+        Ok(self.cached.as_mut().and_then(|(_, chunk)| chunk.as_mut()))
+    }
+}
+
+impl NullBlkDevice {
+    #[inline(always)]
+    fn write(cursor: &mut TreeCursor<'_>, sector: usize, segment: &Segment<'_>) -> Result {
+        let (idx, page_idx) = cursor.split(sector);
+
+        if let Some(chunk) = cursor.chunk(idx, true)? {
+            segment.copy_to_page(&mut chunk.pages[page_idx])?;
+        }
 
         Ok(())
     }
 
     #[inline(always)]
-    fn read(tree: TreeRef<'_>, sector: usize, segment: &mut Segment<'_>) -> Result {
-        let idx = sector >> bindings::PAGE_SECTORS_SHIFT;
+    fn read(cursor: &mut TreeCursor<'_>, sector: usize, segment: &mut Segment<'_>) -> Result {
+        let (idx, page_idx) = cursor.split(sector);
 
-        if let Some(page) = tree.get_locked(idx) {
-            segment.copy_from_page(page.deref())?;
+        if let Some(chunk) = cursor.chunk(idx, false)? {
+            segment.copy_from_page(&chunk.pages[page_idx])?;
         }
 
         Ok(())
@@ -219,19 +319,43 @@ fn read(tree: TreeRef<'_>, sector: usize, segment: &mut Segment<'_>) -> Result {
     #[inline(never)]
     fn transfer(
         command: bindings::req_op,
-        tree: TreeRef<'_>,
+        cursor: &mut TreeCursor<'_>,
         sector: usize,
         segment: &mut Segment<'_>,
     ) -> Result {
         match command {
-            bindings::req_op_REQ_OP_WRITE => Self::write(tree, sector, segment)?,
-            bindings::req_op_REQ_OP_READ => Self::read(tree, sector, segment)?,
+            bindings::req_op_REQ_OP_WRITE => Self::write(cursor, sector, segment)?,
+            bindings::req_op_REQ_OP_READ => Self::read(cursor, sector, segment)?,
             _ => (),
         }
         Ok(())
     }
 }
 
+#[pin_data]
+struct HwQueueContext {
+    // Set for hardware queues backing the `HCTX_TYPE_POLL` map. Requests
+    // issued to such a queue are parked on `poll_list` and completed from
+    // `Operations::poll` instead of through `irq_mode`.
+    poll: bool,
+    #[pin]
+    poll_list: SpinLock<Vec<ARef<mq::Request<NullBlkDevice>>>>,
+}
+
+impl HwQueueContext {
+    fn new(poll: bool) -> Result<impl PinInit<Self>> {
+        // Size the list for a full queue, so that `queue_rq` never has to
+        // allocate while holding the lock.
+        let capacity = if poll { QUEUE_DEPTH as usize } else { 0 };
+        let list = Vec::with_capacity(capacity, flags::GFP_KERNEL)?;
+
+        Ok(pin_init!(HwQueueContext {
+            poll,
+            poll_list <- new_spinlock!(list, "rnullb:poll_list"),
+        }))
+    }
+}
+
 #[pin_data]
 struct Pdu {
     #[pin]
@@ -256,7 +380,7 @@ impl HasTimer<Self> for Pdu { self.timer }
 impl Operations for NullBlkDevice {
     type QueueData = Pin<Box<QueueData>>;
     type TagSetData = ();
-    type HwData = ();
+    type HwData = Pin<Box<HwQueueContext>>;
     type RequestData = Pdu;
 
     fn new_request_data(
@@ -269,7 +393,7 @@ fn new_request_data(
 
     #[inline(always)]
     fn queue_rq(
-        _hw_data: (),
+        hw_data: Pin<&HwQueueContext>,
         queue_data: &QueueData,
         rq: ARef<mq::Request<Self>>,
         _is_last: bool,
@@ -277,18 +401,25 @@ fn queue_rq(
         if queue_data.memory_backed {
             let guard = queue_data.tree.lock.lock();
             let tree = queue_data.tree.tree.deref();
+            let mut cursor = TreeCursor::new(tree, queue_data.chunk_order);
 
             let mut sector = rq.sector();
             for bio in rq.bio_iter() {
                 for mut segment in bio.segment_iter() {
-                    Self::transfer(rq.command(), tree, sector, &mut segment)?;
+                    Self::transfer(rq.command(), &mut cursor, sector, &mut segment)?;
                     sector += segment.len() >> bindings::SECTOR_SHIFT;
                 }
             }
 
+            drop(cursor);
             drop(guard);
         }
 
+        if hw_data.poll {
+            hw_data.poll_list.lock().push(rq, flags::GFP_ATOMIC)?;
+            return Ok(());
+        }
+
         match queue_data.irq_mode {
             IRQMode::None => mq::Request::end_ok(rq)
                 .map_err(|_e| kernel::error::code::EIO)
@@ -303,10 +434,45 @@ fn queue_rq(
         Ok(())
     }
 
-    fn commit_rqs(_hw_data: (), _queue_data: &QueueData) {}
+    fn commit_rqs(_hw_data: Pin<&HwQueueContext>, _queue_data: &QueueData) {}
 
-    fn init_hctx(_tagset_data: (), _hctx_idx: u32) -> Result {
-        Ok(())
+    fn init_hctx(_tagset_data: (), hctx_idx: u32) -> Result<Self::HwData> {
+        // `map_queues` places the poll queues after the submit queues.
+        let poll = hctx_idx >= SUBMIT_QUEUES;
+        Box::pin_init(HwQueueContext::new(poll)?, flags::GFP_KERNEL)
+    }
+
+    fn map_queues(tag_set: Pin<&mut TagSet<Self>>) {
+        let poll_queues = *param_poll_queues.read();
+
+        tag_set.update_maps(|mut qmap| {
+            let nr_queues = match qmap.kind() {
+                mq::QueueType::Default => SUBMIT_QUEUES,
+                mq::QueueType::Read => 0,
+                mq::QueueType::Poll => poll_queues,
+            };
+            qmap.set_queues(nr_queues);
+        });
+    }
+
+    fn poll(hw_data: Pin<&HwQueueContext>) -> i32 {
+        let mut list = core::mem::take(&mut *hw_data.poll_list.lock());
+        let nr = list.len();
+
+        for rq in list.drain(..) {
+            mq::Request::end_ok(rq)
+                .map_err(|_e| kernel::error::code::EIO)
+                .expect("Failed to complete request");
+        }
+
+        // Hand the now empty allocation back, so that `queue_rq` can keep
+        // pushing without allocating.
+        let mut guard = hw_data.poll_list.lock();
+        if guard.is_empty() {
+            core::mem::swap(&mut *guard, &mut list);
+        }
+
+        nr as i32
     }
 
     fn complete(rq: ARef<mq::Request<Self>>) {
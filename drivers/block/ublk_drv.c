@@ -1172,17 +1172,28 @@ static void ublk_rq_task_work_cb(struct io_uring_cmd *cmd, unsigned issue_flags)
 	ublk_forward_io_cmds(ubq, issue_flags);
 }
 
-static void ublk_queue_cmd(struct ublk_queue *ubq, struct request *rq)
+/*
+ * Add the chain @first..@last of requests to the queue's pending list,
+ * kicking the daemon through @rq's command if the list was empty.
+ */
+static void ublk_queue_cmd_list(struct ublk_queue *ubq, struct request *rq,
+				struct llist_node *first,
+				struct llist_node *last)
 {
-	struct ublk_rq_data *data = blk_mq_rq_to_pdu(rq);
-
-	if (llist_add(&data->node, &ubq->io_cmds)) {
+	if (llist_add_batch(first, last, &ubq->io_cmds)) {
 		struct ublk_io *io = &ubq->ios[rq->tag];
 
 		io_uring_cmd_complete_in_task(io->cmd, ublk_rq_task_work_cb);
 	}
 }
 
+static void ublk_queue_cmd(struct ublk_queue *ubq, struct request *rq)
+{
+	struct ublk_rq_data *data = blk_mq_rq_to_pdu(rq);
+
+	ublk_queue_cmd_list(ubq, rq, &data->node, &data->node);
+}
+
 static enum blk_eh_timer_return ublk_timeout(struct request *rq)
 {
 	struct ublk_queue *ubq = rq->mq_hctx->driver_data;
@@ -1224,11 +1235,8 @@ static enum blk_eh_timer_return ublk_timeout(struct request *rq)
 	return BLK_EH_RESET_TIMER;
 }
 
-static blk_status_t ublk_queue_rq(struct blk_mq_hw_ctx *hctx,
-		const struct blk_mq_queue_data *bd)
+static blk_status_t ublk_prep_req(struct ublk_queue *ubq, struct request *rq)
 {
-	struct ublk_queue *ubq = hctx->driver_data;
-	struct request *rq = bd->rq;
 	blk_status_t res;
 
 	/* fill iod to slot in io cmd buffer */
@@ -1248,6 +1256,20 @@ static blk_status_t ublk_queue_rq(struct blk_mq_hw_ctx *hctx,
 	if (ublk_queue_can_use_recovery(ubq) && unlikely(ubq->force_abort))
 		return BLK_STS_IOERR;
 
+	return BLK_STS_OK;
+}
+
+static blk_status_t ublk_queue_rq(struct blk_mq_hw_ctx *hctx,
+		const struct blk_mq_queue_data *bd)
+{
+	struct ublk_queue *ubq = hctx->driver_data;
+	struct request *rq = bd->rq;
+	blk_status_t res;
+
+	res = ublk_prep_req(ubq, rq);
+	if (res != BLK_STS_OK)
+		return res;
+
 	if (unlikely(ubq->canceling)) {
 		__ublk_abort_rq(ubq, rq);
 		return BLK_STS_OK;
@@ -1259,6 +1281,58 @@ static blk_status_t ublk_queue_rq(struct blk_mq_hw_ctx *hctx,
 	return BLK_STS_OK;
 }
 
+/*
+ * Queue a plugged list of requests, handing each run of requests for the
+ * same queue to the daemon with a single llist update and at most one
+ * task work kick. Requests that fail preparation are handed back to
+ * blk-mq, which issues them one by one through ->queue_rq().
+ */
+static void ublk_queue_rqs(struct request **rqlist)
+{
+	struct llist_node *first = NULL, *last = NULL;
+	struct request *requeue_list = NULL;
+	struct request *rq, *last_rq = NULL;
+	struct ublk_queue *ubq = NULL;
+
+	while ((rq = rq_list_pop(rqlist))) {
+		struct ublk_queue *this_q = rq->mq_hctx->driver_data;
+		struct ublk_rq_data *data = blk_mq_rq_to_pdu(rq);
+
+		if (ubq != this_q && first) {
+			ublk_queue_cmd_list(ubq, last_rq, first, last);
+			first = last = NULL;
+		}
+		ubq = this_q;
+
+		if (ublk_prep_req(ubq, rq) != BLK_STS_OK) {
+			rq_list_add(&requeue_list, rq);
+			continue;
+		}
+
+		if (unlikely(ubq->canceling)) {
+			__ublk_abort_rq(ubq, rq);
+			continue;
+		}
+
+		blk_mq_start_request(rq);
+
+		/*
+		 * Build the chain newest first, ublk_forward_io_cmds() reverses
+		 * it back into submission order.
+		 */
+		data->node.next = first;
+		first = &data->node;
+		if (!last)
+			last = first;
+		last_rq = rq;
+	}
+
+	if (first)
+		ublk_queue_cmd_list(ubq, last_rq, first, last);
+
+	*rqlist = requeue_list;
+}
+
 static int ublk_init_hctx(struct blk_mq_hw_ctx *hctx, void *driver_data,
 		unsigned int hctx_idx)
 {
@@ -1271,6 +1345,7 @@ static int ublk_init_hctx(struct blk_mq_hw_ctx *hctx, void *driver_data,
 
 static const struct blk_mq_ops ublk_mq_ops = {
 	.queue_rq       = ublk_queue_rq,
+	.queue_rqs	= ublk_queue_rqs,
 	.init_hctx	= ublk_init_hctx,
 	.timeout	= ublk_timeout,
 };
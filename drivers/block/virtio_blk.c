@@ -42,6 +42,14 @@ static unsigned int poll_queues;
 module_param(poll_queues, uint, 0644);
 MODULE_PARM_DESC(poll_queues, "The number of dedicated virtqueues for polling I/O");
 
+static unsigned int inline_sg_cnt = VIRTIO_BLK_INLINE_SG_CNT;
+module_param(inline_sg_cnt, uint, 0444);
+MODULE_PARM_DESC(inline_sg_cnt,
+		 "Scatterlist entries preallocated with each request; requests with "
+		 "more segments allocate their scatterlist. Values > "
+		 __stringify(SG_CHUNK_SIZE) " truncated to "
+		 __stringify(SG_CHUNK_SIZE) ".");
+
 static int major;
 static DEFINE_IDA(vd_index_ida);
 
@@ -82,6 +90,9 @@ struct virtio_blk {
 	int io_queues[HCTX_MAX_TYPES];
 	struct virtio_blk_vq *vqs;
 
+	/* Scatterlist entries preallocated in each virtblk_req */
+	unsigned int inline_sg_cnt;
+
 	/* For zoned device */
 	unsigned int zone_sectors;
 };
@@ -206,14 +217,16 @@ static int virtblk_setup_discard_write_zeroes_erase(struct request *req, bool un
 
 static void virtblk_unmap_data(struct request *req, struct virtblk_req *vbr)
 {
+	struct virtio_blk *vblk = req->q->queuedata;
+
 	if (blk_rq_nr_phys_segments(req))
-		sg_free_table_chained(&vbr->sg_table,
-				      VIRTIO_BLK_INLINE_SG_CNT);
+		sg_free_table_chained(&vbr->sg_table, vblk->inline_sg_cnt);
 }
 
 static int virtblk_map_data(struct blk_mq_hw_ctx *hctx, struct request *req,
 		struct virtblk_req *vbr)
 {
+	struct virtio_blk *vblk = hctx->queue->queuedata;
 	int err;
 
 	if (!blk_rq_nr_phys_segments(req))
@@ -223,7 +236,7 @@ static int virtblk_map_data(struct blk_mq_hw_ctx *hctx, struct request *req,
 	err = sg_alloc_table_chained(&vbr->sg_table,
 				     blk_rq_nr_phys_segments(req),
 				     vbr->sg_table.sgl,
-				     VIRTIO_BLK_INLINE_SG_CNT);
+				     vblk->inline_sg_cnt);
 	if (unlikely(err))
 		return -ENOMEM;
 
@@ -1490,6 +1503,13 @@ static int virtblk_probe(struct virtio_device *vdev)
 		queue_depth = virtblk_queue_depth;
 	}
 
+	/* Without sg chaining there is nowhere to continue an inline list. */
+	if (IS_ENABLED(CONFIG_ARCH_NO_SG_CHAIN))
+		vblk->inline_sg_cnt = 0;
+	else
+		vblk->inline_sg_cnt = min_t(unsigned int, inline_sg_cnt,
+					    SG_CHUNK_SIZE);
+
 	memset(&vblk->tag_set, 0, sizeof(vblk->tag_set));
 	vblk->tag_set.ops = &virtio_mq_ops;
 	vblk->tag_set.queue_depth = queue_depth;
@@ -1497,7 +1517,7 @@ static int virtblk_probe(struct virtio_device *vdev)
 	vblk->tag_set.flags = BLK_MQ_F_SHOULD_MERGE;
 	vblk->tag_set.cmd_size =
 		sizeof(struct virtblk_req) +
-		sizeof(struct scatterlist) * VIRTIO_BLK_INLINE_SG_CNT;
+		sizeof(struct scatterlist) * vblk->inline_sg_cnt;
 	vblk->tag_set.driver_data = vblk;
 	vblk->tag_set.nr_hw_queues = vblk->num_vqs;
 	vblk->tag_set.nr_maps = 1;
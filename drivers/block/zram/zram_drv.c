@@ -33,6 +33,9 @@
 #include <linux/debugfs.h>
 #include <linux/cpuhotplug.h>
 #include <linux/part_stat.h>
+#include <linux/workqueue.h>
+#include <linux/seq_file.h>
+#include <linux/sched/clock.h>
 
 #include "zram_drv.h"
 
@@ -51,6 +54,9 @@ static unsigned int num_devices = 1;
  */
 static size_t huge_class_size;
 
+/* Compresses chunks of large write bios in parallel, see zram_bio_write() */
+static struct workqueue_struct *zram_write_wq;
+
 static const struct block_device_operations zram_devops;
 
 static void zram_free_page(struct zram *zram, size_t index);
@@ -64,7 +70,20 @@ static int zram_slot_trylock(struct zram *zram, u32 index)
 
 static void zram_slot_lock(struct zram *zram, u32 index)
 {
-	bit_spin_lock(ZRAM_LOCK, &zram->table[index].flags);
+	unsigned long *lock = &zram->table[index].flags;
+#ifdef CONFIG_ZRAM_MEMORY_TRACKING
+	u64 start;
+
+	if (likely(bit_spin_trylock(ZRAM_LOCK, lock)))
+		return;
+
+	start = local_clock();
+	bit_spin_lock(ZRAM_LOCK, lock);
+	atomic64_inc(&zram->stats.slot_lock_contended);
+	atomic64_add(local_clock() - start, &zram->stats.slot_lock_wait_ns);
+#else
+	bit_spin_lock(ZRAM_LOCK, lock);
+#endif
 }
 
 static void zram_slot_unlock(struct zram *zram, u32 index)
@@ -586,17 +605,244 @@ static void read_from_bdev_async(struct zram *zram, struct page *page,
 #define IDLE_WRITEBACK			(1<<1)
 #define INCOMPRESSIBLE_WRITEBACK	(1<<2)
 
+/* Pages on contiguous backing device blocks are merged into one bio */
+#define ZRAM_WB_BIO_PAGES		32
+#define ZRAM_WB_DEFAULT_QUEUE_DEPTH	8
+#define ZRAM_WB_MAX_QUEUE_DEPTH		256
+
+struct zram_wb_ctl;
+
+struct zram_wb_req {
+	struct list_head entry;
+	struct zram_wb_ctl *ctl;
+	unsigned long blk_idx;	/* first backing device block of the bio */
+	unsigned int nr_pages;
+	u32 index[ZRAM_WB_BIO_PAGES];
+	struct page *pages[ZRAM_WB_BIO_PAGES];
+	struct bio_vec bvecs[ZRAM_WB_BIO_PAGES];
+	struct bio bio;
+};
+
+struct zram_wb_ctl {
+	struct list_head idle_reqs;
+	struct list_head done_reqs;
+	spinlock_t done_lock;
+	wait_queue_head_t done_wait;
+	atomic_t num_inflight;
+	/* pages handed to requests and not yet completed */
+	unsigned long nr_pending;
+};
+
+static void zram_wb_req_free(struct zram_wb_req *req)
+{
+	unsigned int i;
+
+	for (i = 0; i < ZRAM_WB_BIO_PAGES; i++)
+		if (req->pages[i])
+			__free_page(req->pages[i]);
+	kfree(req);
+}
+
+static void zram_wb_ctl_free(struct zram_wb_ctl *ctl)
+{
+	struct zram_wb_req *req, *tmp;
+
+	list_for_each_entry_safe(req, tmp, &ctl->idle_reqs, entry)
+		zram_wb_req_free(req);
+	kfree(ctl);
+}
+
+static struct zram_wb_ctl *zram_wb_ctl_alloc(unsigned int depth)
+{
+	struct zram_wb_ctl *ctl;
+	unsigned int i, j;
+
+	ctl = kzalloc(sizeof(*ctl), GFP_KERNEL);
+	if (!ctl)
+		return NULL;
+
+	INIT_LIST_HEAD(&ctl->idle_reqs);
+	INIT_LIST_HEAD(&ctl->done_reqs);
+	spin_lock_init(&ctl->done_lock);
+	init_waitqueue_head(&ctl->done_wait);
+	atomic_set(&ctl->num_inflight, 0);
+
+	for (i = 0; i < depth; i++) {
+		struct zram_wb_req *req;
+
+		req = kzalloc(sizeof(*req), GFP_KERNEL);
+		if (!req)
+			break;
+		req->ctl = ctl;
+		list_add(&req->entry, &ctl->idle_reqs);
+
+		for (j = 0; j < ZRAM_WB_BIO_PAGES; j++) {
+			req->pages[j] = alloc_page(GFP_KERNEL);
+			if (!req->pages[j])
+				goto err;
+		}
+	}
+
+	/* A shallower queue is still better than failing the writeback. */
+	if (!list_empty(&ctl->idle_reqs))
+		return ctl;
+err:
+	zram_wb_ctl_free(ctl);
+	return NULL;
+}
+
+static void zram_wb_endio(struct bio *bio)
+{
+	struct zram_wb_req *req = bio->bi_private;
+	struct zram_wb_ctl *ctl = req->ctl;
+	unsigned long flags;
+
+	/*
+	 * Everything happens under done_lock, writeback_store() frees ctl as
+	 * soon as it observes the last request completed.
+	 */
+	spin_lock_irqsave(&ctl->done_lock, flags);
+	list_add_tail(&req->entry, &ctl->done_reqs);
+	atomic_dec(&ctl->num_inflight);
+	wake_up(&ctl->done_wait);
+	spin_unlock_irqrestore(&ctl->done_lock, flags);
+}
+
+static void zram_wb_submit(struct zram *zram, struct zram_wb_req *req)
+{
+	unsigned int i;
+
+	bio_init(&req->bio, zram->bdev, req->bvecs, ZRAM_WB_BIO_PAGES,
+		 REQ_OP_WRITE);
+	req->bio.bi_iter.bi_sector = req->blk_idx * (PAGE_SIZE >> 9);
+	req->bio.bi_end_io = zram_wb_endio;
+	req->bio.bi_private = req;
+	for (i = 0; i < req->nr_pages; i++)
+		__bio_add_page(&req->bio, req->pages[i], PAGE_SIZE, 0);
+
+	atomic_inc(&req->ctl->num_inflight);
+	submit_bio(&req->bio);
+}
+
+/*
+ * Finish the slots of a completed writeback bio. Returns 0, or the error
+ * the bio failed with.
+ */
+static int zram_wb_complete(struct zram *zram, struct zram_wb_req *req)
+{
+	int err = blk_status_to_errno(req->bio.bi_status);
+	unsigned int i;
+
+	for (i = 0; i < req->nr_pages; i++) {
+		unsigned long blk_idx = req->blk_idx + i;
+		u32 index = req->index[i];
+
+		zram_slot_lock(zram, index);
+		/*
+		 * We released zram_slot_lock so need to check if the slot was
+		 * changed. If there is freeing for the slot, we can catch it
+		 * easily by zram_allocated.
+		 * A subtle case is the slot is freed/reallocated/marked as
+		 * ZRAM_IDLE again. To close the race, idle_store doesn't
+		 * mark ZRAM_IDLE once it found the slot was ZRAM_UNDER_WB.
+		 * Thus, we could close the race by checking ZRAM_IDLE bit.
+		 */
+		if (err || !zram_allocated(zram, index) ||
+		    !zram_test_flag(zram, index, ZRAM_IDLE)) {
+			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+			zram_clear_flag(zram, index, ZRAM_IDLE);
+			zram_slot_unlock(zram, index);
+			free_block_bdev(zram, blk_idx);
+			continue;
+		}
+
+		zram_free_page(zram, index);
+		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+		zram_set_flag(zram, index, ZRAM_WB);
+		zram_set_element(zram, index, blk_idx);
+		atomic64_inc(&zram->stats.pages_stored);
+		spin_lock(&zram->wb_limit_lock);
+		if (zram->wb_limit_enable && zram->bd_wb_limit > 0)
+			zram->bd_wb_limit -=  1UL << (PAGE_SHIFT - 12);
+		spin_unlock(&zram->wb_limit_lock);
+		zram_slot_unlock(zram, index);
+	}
+
+	if (!err)
+		atomic64_add(req->nr_pages, &zram->stats.bd_writes);
+	req->ctl->nr_pending -= req->nr_pages;
+	req->nr_pages = 0;
+	return err;
+}
+
+/*
+ * Complete the finished requests, waiting for at least one when @wait is
+ * set. BIO errors are not fatal, we continue and simply attempt to
+ * writeback the remaining objects (pages). At the same time we need to
+ * signal user-space that some writes (at least one, but also could be all
+ * of them) were not successful and we do so by returning the most recent
+ * BIO error through @ret.
+ */
+static void zram_wb_reap(struct zram *zram, struct zram_wb_ctl *ctl,
+			 bool wait, ssize_t *ret)
+{
+	struct zram_wb_req *req, *tmp;
+	LIST_HEAD(done);
+	int err;
+
+	if (wait)
+		wait_event(ctl->done_wait,
+			   !list_empty_careful(&ctl->done_reqs) ||
+			   !atomic_read(&ctl->num_inflight));
+
+	spin_lock_irq(&ctl->done_lock);
+	list_splice_init(&ctl->done_reqs, &done);
+	spin_unlock_irq(&ctl->done_lock);
+
+	list_for_each_entry_safe(req, tmp, &done, entry) {
+		err = zram_wb_complete(zram, req);
+		if (err)
+			*ret = err;
+		list_move(&req->entry, &ctl->idle_reqs);
+	}
+}
+
+static struct zram_wb_req *zram_wb_get_req(struct zram *zram,
+					   struct zram_wb_ctl *ctl,
+					   ssize_t *ret)
+{
+	struct zram_wb_req *req;
+
+	zram_wb_reap(zram, ctl, list_empty(&ctl->idle_reqs), ret);
+
+	req = list_first_entry(&ctl->idle_reqs, struct zram_wb_req, entry);
+	list_del(&req->entry);
+	return req;
+}
+
+/* Take the block that directly follows the ones already in @req, if free. */
+static unsigned long zram_wb_next_block(struct zram *zram,
+					struct zram_wb_req *req)
+{
+	unsigned long blk_idx = req->blk_idx + req->nr_pages;
+
+	if (blk_idx >= zram->nr_pages || test_and_set_bit(blk_idx, zram->bitmap))
+		return 0;
+
+	atomic64_inc(&zram->stats.bd_count);
+	return blk_idx;
+}
+
 static ssize_t writeback_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
 	struct zram *zram = dev_to_zram(dev);
 	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
 	unsigned long index = 0;
-	struct bio bio;
-	struct bio_vec bio_vec;
-	struct page *page;
+	struct zram_wb_ctl *ctl;
+	struct zram_wb_req *req = NULL;
 	ssize_t ret = len;
-	int mode, err;
+	int mode;
 	unsigned long blk_idx = 0;
 
 	if (sysfs_streq(buf, "idle"))
@@ -630,21 +876,37 @@ static ssize_t writeback_store(struct device *dev,
 		goto release_init_lock;
 	}
 
-	page = alloc_page(GFP_KERNEL);
-	if (!page) {
+	ctl = zram_wb_ctl_alloc(nr_pages == 1 ? 1 :
+				READ_ONCE(zram->wb_queue_depth));
+	if (!ctl) {
 		ret = -ENOMEM;
 		goto release_init_lock;
 	}
 
 	for (; nr_pages != 0; index++, nr_pages--) {
 		spin_lock(&zram->wb_limit_lock);
-		if (zram->wb_limit_enable && !zram->bd_wb_limit) {
+		if (zram->wb_limit_enable && zram->bd_wb_limit <=
+		    ((u64)ctl->nr_pending << (PAGE_SHIFT - 12))) {
 			spin_unlock(&zram->wb_limit_lock);
 			ret = -EIO;
 			break;
 		}
 		spin_unlock(&zram->wb_limit_lock);
 
+		/*
+		 * Keep a block reserved for the next page. Extend the current
+		 * bio while the blocks stay contiguous, otherwise send it off
+		 * and start a new one.
+		 */
+		if (!blk_idx && req && req->nr_pages) {
+			blk_idx = zram_wb_next_block(zram, req);
+			if (!blk_idx) {
+				zram_wb_submit(zram, req);
+				req = NULL;
+			}
+		}
+		if (!req)
+			req = zram_wb_get_req(zram, ctl, &ret);
 		if (!blk_idx) {
 			blk_idx = alloc_block_bdev(zram);
 			if (!blk_idx) {
@@ -680,7 +942,8 @@ static ssize_t writeback_store(struct device *dev,
 		/* Need for hugepage writeback racing */
 		zram_set_flag(zram, index, ZRAM_IDLE);
 		zram_slot_unlock(zram, index);
-		if (zram_read_page(zram, page, index, NULL)) {
+		if (zram_read_page(zram, req->pages[req->nr_pages], index,
+				   NULL)) {
 			zram_slot_lock(zram, index);
 			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
 			zram_clear_flag(zram, index, ZRAM_IDLE);
@@ -688,74 +951,61 @@ static ssize_t writeback_store(struct device *dev,
 			continue;
 		}
 
-		bio_init(&bio, zram->bdev, &bio_vec, 1,
-			 REQ_OP_WRITE | REQ_SYNC);
-		bio.bi_iter.bi_sector = blk_idx * (PAGE_SIZE >> 9);
-		__bio_add_page(&bio, page, PAGE_SIZE, 0);
-
-		/*
-		 * XXX: A single page IO would be inefficient for write
-		 * but it would be not bad as starter.
-		 */
-		err = submit_bio_wait(&bio);
-		if (err) {
-			zram_slot_lock(zram, index);
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			zram_slot_unlock(zram, index);
-			/*
-			 * BIO errors are not fatal, we continue and simply
-			 * attempt to writeback the remaining objects (pages).
-			 * At the same time we need to signal user-space that
-			 * some writes (at least one, but also could be all of
-			 * them) were not successful and we do so by returning
-			 * the most recent BIO error.
-			 */
-			ret = err;
-			continue;
-		}
+		if (!req->nr_pages)
+			req->blk_idx = blk_idx;
+		req->index[req->nr_pages++] = index;
+		ctl->nr_pending++;
+		blk_idx = 0;
 
-		atomic64_inc(&zram->stats.bd_writes);
-		/*
-		 * We released zram_slot_lock so need to check if the slot was
-		 * changed. If there is freeing for the slot, we can catch it
-		 * easily by zram_allocated.
-		 * A subtle case is the slot is freed/reallocated/marked as
-		 * ZRAM_IDLE again. To close the race, idle_store doesn't
-		 * mark ZRAM_IDLE once it found the slot was ZRAM_UNDER_WB.
-		 * Thus, we could close the race by checking ZRAM_IDLE bit.
-		 */
-		zram_slot_lock(zram, index);
-		if (!zram_allocated(zram, index) ||
-			  !zram_test_flag(zram, index, ZRAM_IDLE)) {
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			goto next;
+		if (req->nr_pages == ZRAM_WB_BIO_PAGES) {
+			zram_wb_submit(zram, req);
+			req = NULL;
 		}
-
-		zram_free_page(zram, index);
-		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-		zram_set_flag(zram, index, ZRAM_WB);
-		zram_set_element(zram, index, blk_idx);
-		blk_idx = 0;
-		atomic64_inc(&zram->stats.pages_stored);
-		spin_lock(&zram->wb_limit_lock);
-		if (zram->wb_limit_enable && zram->bd_wb_limit > 0)
-			zram->bd_wb_limit -=  1UL << (PAGE_SHIFT - 12);
-		spin_unlock(&zram->wb_limit_lock);
+		continue;
 next:
 		zram_slot_unlock(zram, index);
 	}
 
 	if (blk_idx)
 		free_block_bdev(zram, blk_idx);
-	__free_page(page);
+	if (req) {
+		if (req->nr_pages)
+			zram_wb_submit(zram, req);
+		else
+			list_add(&req->entry, &ctl->idle_reqs);
+	}
+	while (atomic_read(&ctl->num_inflight) ||
+	       !list_empty_careful(&ctl->done_reqs))
+		zram_wb_reap(zram, ctl, true, &ret);
+	zram_wb_ctl_free(ctl);
 release_init_lock:
 	up_read(&zram->init_lock);
 
 	return ret;
 }
 
+static ssize_t writeback_queue_depth_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	u32 val;
+
+	if (kstrtou32(buf, 10, &val) || !val || val > ZRAM_WB_MAX_QUEUE_DEPTH)
+		return -EINVAL;
+
+	WRITE_ONCE(zram->wb_queue_depth, val);
+	return len;
+}
+
+static ssize_t writeback_queue_depth_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n",
+			 READ_ONCE(zram->wb_queue_depth));
+}
+
 struct zram_work {
 	struct work_struct work;
 	struct zram *zram;
@@ -900,6 +1150,19 @@ static const struct file_operations proc_zram_block_state_op = {
 	.llseek = default_llseek,
 };
 
+static int lock_stat_show(struct seq_file *m, void *v)
+{
+	struct zram *zram = m->private;
+
+	seq_printf(m, "contended %llu\n",
+		   (u64)atomic64_read(&zram->stats.slot_lock_contended));
+	seq_printf(m, "wait_ns %llu\n",
+		   (u64)atomic64_read(&zram->stats.slot_lock_wait_ns));
+	seq_printf(m, "entry_size %zu\n", sizeof(struct zram_table_entry));
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(lock_stat);
+
 static void zram_debugfs_register(struct zram *zram)
 {
 	if (!zram_debugfs_root)
@@ -909,6 +1172,8 @@ static void zram_debugfs_register(struct zram *zram)
 						zram_debugfs_root);
 	debugfs_create_file("block_state", 0400, zram->debugfs_dir,
 				zram, &proc_zram_block_state_op);
+	debugfs_create_file("lock_stat", 0400, zram->debugfs_dir,
+				zram, &lock_stat_fops);
 }
 
 static void zram_debugfs_unregister(struct zram *zram)
@@ -943,6 +1208,28 @@ static ssize_t max_comp_streams_store(struct device *dev,
 	return len;
 }
 
+static ssize_t parallel_write_pages_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n",
+			 READ_ONCE(zram->parallel_write_pages));
+}
+
+static ssize_t parallel_write_pages_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	u32 val;
+
+	if (kstrtou32(buf, 10, &val) || val > BIO_MAX_VECS)
+		return -EINVAL;
+
+	WRITE_ONCE(zram->parallel_write_pages, val);
+	return len;
+}
+
 static void comp_algorithm_set(struct zram *zram, u32 prio, const char *alg)
 {
 	/* Do not free statically defined compression algorithms */
@@ -1905,11 +2192,13 @@ static void zram_bio_read(struct zram *zram, struct bio *bio)
 	bio_endio(bio);
 }
 
-static void zram_bio_write(struct zram *zram, struct bio *bio)
+/*
+ * Write the pages covered by @iter, returning false and marking @bio failed
+ * on the first error.
+ */
+static bool zram_bio_write_iter(struct zram *zram, struct bio *bio,
+				struct bvec_iter iter)
 {
-	unsigned long start_time = bio_start_io_acct(bio);
-	struct bvec_iter iter = bio->bi_iter;
-
 	do {
 		u32 index = iter.bi_sector >> SECTORS_PER_PAGE_SHIFT;
 		u32 offset = (iter.bi_sector & (SECTORS_PER_PAGE - 1)) <<
@@ -1921,7 +2210,7 @@ static void zram_bio_write(struct zram *zram, struct bio *bio)
 		if (zram_bvec_write(zram, &bv, index, offset, bio) < 0) {
 			atomic64_inc(&zram->stats.failed_writes);
 			bio->bi_status = BLK_STS_IOERR;
-			break;
+			return false;
 		}
 
 		zram_slot_lock(zram, index);
@@ -1931,6 +2220,105 @@ static void zram_bio_write(struct zram *zram, struct bio *bio)
 		bio_advance_iter_single(bio, &iter, bv.bv_len);
 	} while (iter.bi_size);
 
+	return true;
+}
+
+struct zram_write_chunk {
+	struct work_struct work;
+	struct zram_write_ctx *ctx;
+	struct bvec_iter iter;
+};
+
+/* A write bio whose pages are compressed by several workers at once */
+struct zram_write_ctx {
+	struct zram *zram;
+	struct bio *bio;
+	unsigned long start_time;
+	atomic_t pending;
+	struct zram_write_chunk chunks[];
+};
+
+static void zram_write_chunk_done(struct zram_write_ctx *ctx)
+{
+	struct bio *bio = ctx->bio;
+
+	if (!atomic_dec_and_test(&ctx->pending))
+		return;
+
+	bio_end_io_acct(bio, ctx->start_time);
+	bio_endio(bio);
+	kfree(ctx);
+}
+
+static void zram_write_chunk_fn(struct work_struct *work)
+{
+	struct zram_write_chunk *chunk =
+		container_of(work, struct zram_write_chunk, work);
+	struct zram_write_ctx *ctx = chunk->ctx;
+
+	zram_bio_write_iter(ctx->zram, ctx->bio, chunk->iter);
+	zram_write_chunk_done(ctx);
+}
+
+/*
+ * Split a large, page aligned write into chunks of @chunk_pages and
+ * compress them on zram_write_wq. The calling context compresses the
+ * first chunk itself, the bio is completed by whoever finishes last.
+ */
+static bool zram_bio_write_parallel(struct zram *zram, struct bio *bio,
+				    u32 chunk_pages)
+{
+	unsigned int chunk_size = chunk_pages << PAGE_SHIFT;
+	struct bvec_iter iter = bio->bi_iter;
+	struct zram_write_ctx *ctx;
+	unsigned int i, nr_chunks;
+
+	if (!IS_ALIGNED(iter.bi_sector, SECTORS_PER_PAGE) ||
+	    !PAGE_ALIGNED(iter.bi_size))
+		return false;
+
+	nr_chunks = DIV_ROUND_UP(iter.bi_size, chunk_size);
+	ctx = kmalloc(struct_size(ctx, chunks, nr_chunks),
+		      GFP_NOIO | __GFP_NOWARN);
+	if (!ctx)
+		return false;
+
+	ctx->zram = zram;
+	ctx->bio = bio;
+	ctx->start_time = bio_start_io_acct(bio);
+	atomic_set(&ctx->pending, nr_chunks);
+
+	for (i = 0; i < nr_chunks; i++) {
+		struct zram_write_chunk *chunk = &ctx->chunks[i];
+		unsigned int bytes = min(iter.bi_size, chunk_size);
+
+		chunk->ctx = ctx;
+		chunk->iter = iter;
+		chunk->iter.bi_size = bytes;
+		bio_advance_iter(bio, &iter, bytes);
+
+		if (i) {
+			INIT_WORK(&chunk->work, zram_write_chunk_fn);
+			queue_work(zram_write_wq, &chunk->work);
+		}
+	}
+
+	zram_bio_write_iter(zram, bio, ctx->chunks[0].iter);
+	zram_write_chunk_done(ctx);
+	return true;
+}
+
+static void zram_bio_write(struct zram *zram, struct bio *bio)
+{
+	u32 chunk_pages = READ_ONCE(zram->parallel_write_pages);
+	unsigned long start_time;
+
+	if (chunk_pages && bio->bi_iter.bi_size > (chunk_pages << PAGE_SHIFT) &&
+	    zram_bio_write_parallel(zram, bio, chunk_pages))
+		return;
+
+	start_time = bio_start_io_acct(bio);
+	zram_bio_write_iter(zram, bio, bio->bi_iter);
 	bio_end_io_acct(bio, start_time);
 	bio_endio(bio);
 }
@@ -2138,12 +2526,14 @@ static DEVICE_ATTR_WO(mem_limit);
 static DEVICE_ATTR_WO(mem_used_max);
 static DEVICE_ATTR_WO(idle);
 static DEVICE_ATTR_RW(max_comp_streams);
+static DEVICE_ATTR_RW(parallel_write_pages);
 static DEVICE_ATTR_RW(comp_algorithm);
 #ifdef CONFIG_ZRAM_WRITEBACK
 static DEVICE_ATTR_RW(backing_dev);
 static DEVICE_ATTR_WO(writeback);
 static DEVICE_ATTR_RW(writeback_limit);
 static DEVICE_ATTR_RW(writeback_limit_enable);
+static DEVICE_ATTR_RW(writeback_queue_depth);
 #endif
 #ifdef CONFIG_ZRAM_MULTI_COMP
 static DEVICE_ATTR_RW(recomp_algorithm);
@@ -2159,12 +2549,14 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_mem_used_max.attr,
 	&dev_attr_idle.attr,
 	&dev_attr_max_comp_streams.attr,
+	&dev_attr_parallel_write_pages.attr,
 	&dev_attr_comp_algorithm.attr,
 #ifdef CONFIG_ZRAM_WRITEBACK
 	&dev_attr_backing_dev.attr,
 	&dev_attr_writeback.attr,
 	&dev_attr_writeback_limit.attr,
 	&dev_attr_writeback_limit_enable.attr,
+	&dev_attr_writeback_queue_depth.attr,
 #endif
 	&dev_attr_io_stat.attr,
 	&dev_attr_mm_stat.attr,
@@ -2224,6 +2616,7 @@ static int zram_add(void)
 	init_rwsem(&zram->init_lock);
 #ifdef CONFIG_ZRAM_WRITEBACK
 	spin_lock_init(&zram->wb_limit_lock);
+	zram->wb_queue_depth = ZRAM_WB_DEFAULT_QUEUE_DEPTH;
 #endif
 
 	/* gendisk structure */
@@ -2398,6 +2791,7 @@ static void destroy_devices(void)
 	zram_debugfs_destroy();
 	idr_destroy(&zram_index_idr);
 	unregister_blkdev(zram_major, "zram");
+	destroy_workqueue(zram_write_wq);
 	cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
 }
 
@@ -2412,9 +2806,18 @@ static int __init zram_init(void)
 	if (ret < 0)
 		return ret;
 
+	/* Used for swap-out, so it needs a rescuer to make forward progress. */
+	zram_write_wq = alloc_workqueue("zram_write",
+					WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	if (!zram_write_wq) {
+		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+		return -ENOMEM;
+	}
+
 	ret = class_register(&zram_control_class);
 	if (ret) {
 		pr_err("Unable to register zram-control class\n");
+		destroy_workqueue(zram_write_wq);
 		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
 		return ret;
 	}
@@ -2424,6 +2827,7 @@ static int __init zram_init(void)
 	if (zram_major <= 0) {
 		pr_err("Unable to get major number\n");
 		class_unregister(&zram_control_class);
+		destroy_workqueue(zram_write_wq);
 		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
 		return -EBUSY;
 	}
@@ -62,7 +62,11 @@ enum zram_pageflags {
 
 /*-- Data structures */
 
-/* Allocated for each disk page */
+/*
+ * Allocated for each disk page. The slot lock lives in ->flags, so with
+ * CONFIG_ZRAM_SLOT_CACHELINE_ALIGN every entry gets its own cache line to
+ * keep CPUs working on neighbouring slots from bouncing it.
+ */
 struct zram_table_entry {
 	union {
 		unsigned long handle;
@@ -72,7 +76,11 @@ struct zram_table_entry {
 #ifdef CONFIG_ZRAM_TRACK_ENTRY_ACTIME
 	ktime_t ac_time;
 #endif
-};
+}
+#ifdef CONFIG_ZRAM_SLOT_CACHELINE_ALIGN
+____cacheline_aligned_in_smp
+#endif
+;
 
 struct zram_stats {
 	atomic64_t compr_data_size;	/* compressed size of pages stored */
@@ -86,6 +94,10 @@ struct zram_stats {
 	atomic_long_t max_used_pages;	/* no. of maximum pages stored */
 	atomic64_t writestall;		/* no. of write slow paths */
 	atomic64_t miss_free;		/* no. of missed free */
+#ifdef CONFIG_ZRAM_MEMORY_TRACKING
+	atomic64_t slot_lock_contended;	/* no. of slot lock acquisitions that spun */
+	atomic64_t slot_lock_wait_ns;	/* time spent spinning on slot locks */
+#endif
 #ifdef	CONFIG_ZRAM_WRITEBACK
 	atomic64_t bd_count;		/* no. of pages in backing device */
 	atomic64_t bd_reads;		/* no. of reads from backing device */
@@ -123,6 +135,11 @@ struct zram {
 	u64 disksize;	/* bytes */
 	const char *comp_algs[ZRAM_MAX_COMPS];
 	s8 num_active_comps;
+	/*
+	 * Writes larger than this many pages are split into chunks of this
+	 * size and compressed in parallel, 0 disables splitting.
+	 */
+	u32 parallel_write_pages;
 	/*
 	 * zram is claimed so open request will be failed
 	 */
@@ -132,6 +149,7 @@ struct zram {
 	spinlock_t wb_limit_lock;
 	bool wb_limit_enable;
 	u64 bd_wb_limit;
+	u32 wb_queue_depth; /* no. of writeback bios kept in flight */
 	struct block_device *bdev;
 	unsigned long *bitmap;
 	unsigned long nr_pages;
@@ -69,6 +69,28 @@ DEFINE_EVENT(drm_sched_job, drm_run_job,
 	    TP_ARGS(sched_job, entity)
 );
 
+TRACE_EVENT(drm_sched_job_latency,
+	    TP_PROTO(struct drm_sched_job *sched_job, struct drm_sched_entity *entity,
+		     u64 latency_ns),
+	    TP_ARGS(sched_job, entity, latency_ns),
+	    TP_STRUCT__entry(
+			     __field(struct drm_sched_entity *, entity)
+			     __string(name, sched_job->sched->name)
+			     __field(uint64_t, id)
+			     __field(u64, latency_ns)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->entity = entity;
+			   __assign_str(name);
+			   __entry->id = sched_job->id;
+			   __entry->latency_ns = latency_ns;
+			   ),
+	    TP_printk("entity=%p, id=%llu, ring=%s, latency=%llu ns",
+		      __entry->entity, __entry->id, __get_str(name),
+		      __entry->latency_ns)
+);
+
 TRACE_EVENT(drm_sched_process_job,
 	    TP_PROTO(struct drm_sched_fence *fence),
 	    TP_ARGS(fence),
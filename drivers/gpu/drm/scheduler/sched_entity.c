@@ -400,6 +400,28 @@ void drm_sched_entity_set_priority(struct drm_sched_entity *entity,
 }
 EXPORT_SYMBOL(drm_sched_entity_set_priority);
 
+/**
+ * drm_sched_entity_print_stats - print submission stats of an entity
+ * @entity: scheduler entity
+ * @p: printer to print to, e.g. from a driver's debugfs file
+ *
+ * Print how many jobs of @entity were run and the average and the worst
+ * time they took from being pushed to the entity until being run.
+ */
+void drm_sched_entity_print_stats(struct drm_sched_entity *entity,
+				  struct drm_printer *p)
+{
+	u64 jobs = READ_ONCE(entity->jobs_run);
+	u64 total = READ_ONCE(entity->submit_latency_ns);
+
+	drm_printf(p, "jobs run: %llu\n", jobs);
+	drm_printf(p, "avg submit latency: %llu ns\n",
+		   jobs ? div64_u64(total, jobs) : 0);
+	drm_printf(p, "max submit latency: %llu ns\n",
+		   READ_ONCE(entity->submit_latency_max_ns));
+}
+EXPORT_SYMBOL(drm_sched_entity_print_stats);
+
 /*
  * Add a callback to the current dependency of the entity to wake up the
  * scheduler when the entity becomes available.
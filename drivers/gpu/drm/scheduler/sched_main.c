@@ -99,6 +99,26 @@ int drm_sched_policy = DRM_SCHED_POLICY_FIFO;
 MODULE_PARM_DESC(sched_policy, "Specify the scheduling policy for entities on a run-queue, " __stringify(DRM_SCHED_POLICY_RR) " = Round Robin, " __stringify(DRM_SCHED_POLICY_FIFO) " = FIFO (default).");
 module_param_named(sched_policy, drm_sched_policy, int, 0444);
 
+static unsigned int drm_sched_run_job_batch = 4;
+
+/**
+ * DOC: run_job_batch (uint)
+ * Number of jobs the run-job work may hand to the hardware before it
+ * requeues itself to give other work on the submission workqueue a turn.
+ */
+MODULE_PARM_DESC(run_job_batch, "Max jobs to run per run-job work execution (default 4).");
+module_param_named(run_job_batch, drm_sched_run_job_batch, uint, 0644);
+
+static bool drm_sched_highpri_submit;
+
+/**
+ * DOC: highpri_submit (bool)
+ * Run the submission workqueue that the scheduler allocates for drivers
+ * which don't provide their own from the high priority worker pools.
+ */
+MODULE_PARM_DESC(highpri_submit, "Use high priority workers for scheduler allocated submission workqueues (default false).");
+module_param_named(highpri_submit, drm_sched_highpri_submit, bool, 0444);
+
 static u32 drm_sched_available_credits(struct drm_gpu_scheduler *sched)
 {
 	u32 credits;
@@ -1179,49 +1199,65 @@ static void drm_sched_run_job_work(struct work_struct *w)
 	struct dma_fence *fence;
 	struct drm_sched_fence *s_fence;
 	struct drm_sched_job *sched_job;
+	unsigned int budget = max(READ_ONCE(drm_sched_run_job_batch), 1U);
+	u64 latency;
 	int r;
 
-	if (READ_ONCE(sched->pause_submit))
-		return;
+	/*
+	 * Run up to @budget jobs before requeueing, which saves a workqueue
+	 * round trip per job for streams of small submissions.
+	 */
+	while (budget--) {
+		if (READ_ONCE(sched->pause_submit))
+			return;
+
+		/* Find entity with a ready job */
+		entity = drm_sched_select_entity(sched);
+		if (!entity)
+			return;	/* No more work */
+
+		sched_job = drm_sched_entity_pop_job(entity);
+		if (!sched_job) {
+			complete_all(&entity->entity_idle);
+			continue;
+		}
 
-	/* Find entity with a ready job */
-	entity = drm_sched_select_entity(sched);
-	if (!entity)
-		return;	/* No more work */
+		s_fence = sched_job->s_fence;
 
-	sched_job = drm_sched_entity_pop_job(entity);
-	if (!sched_job) {
-		complete_all(&entity->entity_idle);
-		drm_sched_run_job_queue(sched);
-		return;
-	}
+		latency = ktime_to_ns(ktime_sub(ktime_get(), sched_job->submit_ts));
+		WRITE_ONCE(entity->jobs_run, entity->jobs_run + 1);
+		WRITE_ONCE(entity->submit_latency_ns,
+			   entity->submit_latency_ns + latency);
+		if (latency > entity->submit_latency_max_ns)
+			WRITE_ONCE(entity->submit_latency_max_ns, latency);
+		trace_drm_sched_job_latency(sched_job, entity, latency);
 
-	s_fence = sched_job->s_fence;
+		atomic_add(sched_job->credits, &sched->credit_count);
+		drm_sched_job_begin(sched_job);
 
-	atomic_add(sched_job->credits, &sched->credit_count);
-	drm_sched_job_begin(sched_job);
+		trace_drm_run_job(sched_job, entity);
+		fence = sched->ops->run_job(sched_job);
+		complete_all(&entity->entity_idle);
+		drm_sched_fence_scheduled(s_fence, fence);
 
-	trace_drm_run_job(sched_job, entity);
-	fence = sched->ops->run_job(sched_job);
-	complete_all(&entity->entity_idle);
-	drm_sched_fence_scheduled(s_fence, fence);
+		if (!IS_ERR_OR_NULL(fence)) {
+			/* Drop for original kref_init of the fence */
+			dma_fence_put(fence);
 
-	if (!IS_ERR_OR_NULL(fence)) {
-		/* Drop for original kref_init of the fence */
-		dma_fence_put(fence);
+			r = dma_fence_add_callback(fence, &sched_job->cb,
+						   drm_sched_job_done_cb);
+			if (r == -ENOENT)
+				drm_sched_job_done(sched_job, fence->error);
+			else if (r)
+				DRM_DEV_ERROR(sched->dev, "fence add callback failed (%d)\n", r);
+		} else {
+			drm_sched_job_done(sched_job, IS_ERR(fence) ?
+					   PTR_ERR(fence) : 0);
+		}
 
-		r = dma_fence_add_callback(fence, &sched_job->cb,
-					   drm_sched_job_done_cb);
-		if (r == -ENOENT)
-			drm_sched_job_done(sched_job, fence->error);
-		else if (r)
-			DRM_DEV_ERROR(sched->dev, "fence add callback failed (%d)\n", r);
-	} else {
-		drm_sched_job_done(sched_job, IS_ERR(fence) ?
-				   PTR_ERR(fence) : 0);
+		wake_up(&sched->job_scheduled);
 	}
 
-	wake_up(&sched->job_scheduled);
 	drm_sched_run_job_queue(sched);
 }
 
@@ -1281,7 +1317,8 @@ int drm_sched_init(struct drm_gpu_scheduler *sched,
 		sched->submit_wq = submit_wq;
 		sched->own_submit_wq = false;
 	} else {
-		sched->submit_wq = alloc_ordered_workqueue(name, 0);
+		sched->submit_wq = alloc_ordered_workqueue(name,
+				drm_sched_highpri_submit ? WQ_HIGHPRI : 0);
 		if (!sched->submit_wq)
 			return -ENOMEM;
 
@@ -1672,6 +1672,20 @@ int dm_cache_commit(struct dm_cache_metadata *cmd, bool clean_shutdown)
 	return r;
 }
 
+void dm_cache_metadata_start_writeback(struct dm_cache_metadata *cmd)
+{
+	/*
+	 * The write lock keeps the checksums computed as the blocks are
+	 * queued for io in step with their contents.  Only shadowed blocks
+	 * of the open transaction are dirty, so nothing reachable from the
+	 * committed superblock gets overwritten.
+	 */
+	WRITE_LOCK_VOID(cmd);
+	if (cmd->changed)
+		dm_bm_write_dirty_async(cmd->bm);
+	WRITE_UNLOCK(cmd);
+}
+
 int dm_cache_get_free_metadata_block_count(struct dm_cache_metadata *cmd,
 					   dm_block_t *result)
 {
@@ -117,6 +117,13 @@ void dm_cache_metadata_set_stats(struct dm_cache_metadata *cmd,
 
 int dm_cache_commit(struct dm_cache_metadata *cmd, bool clean_shutdown);
 
+/*
+ * Starts writing the blocks dirtied by the current transaction, while it
+ * is still open, so that the next dm_cache_commit() mostly has to write
+ * the superblock.  'void' because the commit writes anything left over.
+ */
+void dm_cache_metadata_start_writeback(struct dm_cache_metadata *cmd);
+
 int dm_cache_get_free_metadata_block_count(struct dm_cache_metadata *cmd,
 					   dm_block_t *result);
 
@@ -859,6 +859,16 @@ struct smq_policy {
 
 	bool migrations_allowed:1;
 
+	/*
+	 * Promotions and demotions may move at most migration_bandwidth
+	 * sectors per second through the cache device (0 means no limit),
+	 * so that background copies can't saturate it.  migration_budget is
+	 * what's left of the current second.
+	 */
+	sector_t migration_bandwidth;
+	sector_t migration_budget;
+	unsigned long next_budget_period;
+
 	/*
 	 * If this is set the policy will try and clean the whole cache
 	 * even if the device is not idle.
@@ -1182,6 +1192,27 @@ static void clear_pending(struct smq_policy *mq, struct entry *e)
 	e->pending_work = false;
 }
 
+/*
+ * Charges one block copy against the migration bandwidth.  Returns false
+ * if this second's budget has been used up.
+ */
+static bool claim_migration_bandwidth(struct smq_policy *mq)
+{
+	if (!mq->migration_bandwidth)
+		return true;
+
+	if (time_after_eq(jiffies, mq->next_budget_period)) {
+		mq->migration_budget = mq->migration_bandwidth;
+		mq->next_budget_period = jiffies + HZ;
+	}
+
+	if (mq->migration_budget < mq->cache_block_size)
+		return false;
+
+	mq->migration_budget -= mq->cache_block_size;
+	return true;
+}
+
 static void queue_writeback(struct smq_policy *mq, bool idle)
 {
 	int r;
@@ -1221,6 +1252,9 @@ static void queue_demotion(struct smq_policy *mq)
 		return;
 	}
 
+	if (!claim_migration_bandwidth(mq))
+		return;
+
 	mark_pending(mq, e);
 	q_del(&mq->clean, e);
 
@@ -1257,6 +1291,9 @@ static void queue_promotion(struct smq_policy *mq, dm_oblock_t oblock,
 	if (btracker_promotion_already_present(mq->bg_work, oblock))
 		return;
 
+	if (!claim_migration_bandwidth(mq))
+		return;
+
 	/*
 	 * We allocate the entry now to reserve the cblock.  If the
 	 * background work is aborted we must remember to free it.
@@ -1645,15 +1682,56 @@ static void smq_allow_migrations(struct dm_cache_policy *p, bool allow)
 }
 
 /*
- * smq has no config values, but the old mq policy did.  To avoid breaking
- * software we continue to accept these configurables for the mq policy,
- * but they have no effect.
+ * migration_bandwidth is given in sectors per second.
+ */
+static int smq_set_config_value(struct dm_cache_policy *p,
+				const char *key, const char *value)
+{
+	struct smq_policy *mq = to_smq_policy(p);
+	unsigned long flags;
+	unsigned long long tmp;
+
+	if (strcasecmp(key, "migration_bandwidth"))
+		return -EINVAL;
+
+	if (kstrtoull(value, 10, &tmp))
+		return -EINVAL;
+
+	spin_lock_irqsave(&mq->lock, flags);
+	mq->migration_bandwidth = tmp;
+	mq->migration_budget = tmp;
+	mq->next_budget_period = jiffies + HZ;
+	spin_unlock_irqrestore(&mq->lock, flags);
+
+	return 0;
+}
+
+static int smq_emit_config_values(struct dm_cache_policy *p, char *result,
+				  unsigned int maxlen, ssize_t *sz_ptr)
+{
+	struct smq_policy *mq = to_smq_policy(p);
+	ssize_t sz = *sz_ptr;
+
+	DMEMIT("2 migration_bandwidth %llu ",
+	       (unsigned long long)mq->migration_bandwidth);
+
+	*sz_ptr = sz;
+	return 0;
+}
+
+/*
+ * smq has no config values apart from migration_bandwidth, but the old
+ * mq policy did.  To avoid breaking software we continue to accept these
+ * configurables for the mq policy, but they have no effect.
  */
 static int mq_set_config_value(struct dm_cache_policy *p,
 			       const char *key, const char *value)
 {
 	unsigned long tmp;
 
+	if (!strcasecmp(key, "migration_bandwidth"))
+		return smq_set_config_value(p, key, value);
+
 	if (kstrtoul(value, 10, &tmp))
 		return -EINVAL;
 
@@ -1672,13 +1750,16 @@ static int mq_set_config_value(struct dm_cache_policy *p,
 static int mq_emit_config_values(struct dm_cache_policy *p, char *result,
 				 unsigned int maxlen, ssize_t *sz_ptr)
 {
+	struct smq_policy *mq = to_smq_policy(p);
 	ssize_t sz = *sz_ptr;
 
-	DMEMIT("10 random_threshold 0 "
+	DMEMIT("12 random_threshold 0 "
 	       "sequential_threshold 0 "
 	       "discard_promote_adjustment 0 "
 	       "read_promote_adjustment 0 "
-	       "write_promote_adjustment 0 ");
+	       "write_promote_adjustment 0 "
+	       "migration_bandwidth %llu ",
+	       (unsigned long long)mq->migration_bandwidth);
 
 	*sz_ptr = sz;
 	return 0;
@@ -1704,6 +1785,9 @@ static void init_policy_functions(struct smq_policy *mq, bool mimic_mq)
 	if (mimic_mq) {
 		mq->policy.set_config_value = mq_set_config_value;
 		mq->policy.emit_config_values = mq_emit_config_values;
+	} else {
+		mq->policy.set_config_value = smq_set_config_value;
+		mq->policy.emit_config_values = smq_emit_config_values;
 	}
 }
 
@@ -1811,6 +1895,7 @@ __smq_create(dm_cblock_t cache_size, sector_t origin_size, sector_t cache_block_
 
 	mq->next_hotspot_period = jiffies;
 	mq->next_cache_period = jiffies;
+	mq->next_budget_period = jiffies;
 
 	mq->bg_work = btracker_create(4096); /* FIXME: hard coded value */
 	if (!mq->bg_work)
@@ -1865,7 +1950,7 @@ static struct dm_cache_policy *cleaner_create(dm_cblock_t cache_size,
 
 static struct dm_cache_policy_type smq_policy_type = {
 	.name = "smq",
-	.version = {2, 0, 0},
+	.version = {2, 1, 0},
 	.hint_size = 4,
 	.owner = THIS_MODULE,
 	.create = smq_create
@@ -1873,7 +1958,7 @@ static struct dm_cache_policy_type smq_policy_type = {
 
 static struct dm_cache_policy_type mq_policy_type = {
 	.name = "mq",
-	.version = {2, 0, 0},
+	.version = {2, 1, 0},
 	.hint_size = 4,
 	.owner = THIS_MODULE,
 	.create = mq_create,
@@ -1889,7 +1974,7 @@ static struct dm_cache_policy_type cleaner_policy_type = {
 
 static struct dm_cache_policy_type default_policy_type = {
 	.name = "default",
-	.version = {2, 0, 0},
+	.version = {2, 1, 0},
 	.hint_size = 4,
 	.owner = THIS_MODULE,
 	.create = smq_create,
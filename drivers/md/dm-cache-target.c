@@ -291,6 +291,10 @@ struct cache_stats {
 	atomic_t cache_cell_clash;
 	atomic_t commit_count;
 	atomic_t discard_count;
+
+	/* time spent in metadata commits and successful migrations */
+	atomic64_t commit_ns;
+	atomic64_t migration_ns;
 };
 
 struct cache {
@@ -370,6 +374,7 @@ struct cache {
 	struct work_struct migration_worker;
 	struct workqueue_struct *wq;
 	struct delayed_work waker;
+	struct delayed_work metadata_writeback;
 	struct dm_bio_prison_v2 *prison;
 
 	/*
@@ -425,6 +430,8 @@ struct dm_cache_migration {
 
 	dm_cblock_t invalidate_cblock;
 	dm_oblock_t invalidate_oblock;
+
+	u64 start_ns;
 };
 
 /*----------------------------------------------------------------*/
@@ -1171,8 +1178,11 @@ static void mg_complete(struct dm_cache_migration *mg, bool success)
 	struct policy_work *op = mg->op;
 	dm_cblock_t cblock = op->cblock;
 
-	if (success)
+	if (success) {
 		update_stats(&cache->stats, op->op);
+		atomic64_add(ktime_get_ns() - mg->start_ns,
+			     &cache->stats.migration_ns);
+	}
 
 	switch (op->op) {
 	case POLICY_PROMOTE:
@@ -1436,6 +1446,7 @@ static int mg_start(struct cache *cache, struct policy_work *op, struct bio *bio
 
 	mg->op = op;
 	mg->overwrite_bio = bio;
+	mg->start_ns = ktime_get_ns();
 
 	if (!bio)
 		inc_io_migrations(cache);
@@ -1739,12 +1750,15 @@ static bool process_bio(struct cache *cache, struct bio *bio)
 static int commit(struct cache *cache, bool clean_shutdown)
 {
 	int r;
+	u64 start;
 
 	if (get_cache_mode(cache) >= CM_READ_ONLY)
 		return -EINVAL;
 
 	atomic_inc(&cache->stats.commit_count);
+	start = ktime_get_ns();
 	r = dm_cache_commit(cache->cmd, clean_shutdown);
+	atomic64_add(ktime_get_ns() - start, &cache->stats.commit_ns);
 	if (r)
 		metadata_operation_failed(cache, "dm_cache_commit", r);
 
@@ -1865,6 +1879,22 @@ static void do_waker(struct work_struct *ws)
 	wake_migration_worker(cache);
 	schedule_commit(&cache->committer);
 	queue_delayed_work(cache->wq, &cache->waker, COMMIT_PERIOD);
+	queue_delayed_work(cache->wq, &cache->metadata_writeback,
+			   COMMIT_PERIOD / 2);
+}
+
+/*
+ * Half way through each commit period the blocks dirtied so far are
+ * written out in the background, so the periodic commit, which holds up
+ * the bios and migrations waiting on it, only has to write the rest.
+ */
+static void do_metadata_writeback(struct work_struct *ws)
+{
+	struct cache *cache = container_of(to_delayed_work(ws), struct cache,
+					   metadata_writeback);
+
+	if (get_cache_mode(cache) == CM_WRITE)
+		dm_cache_metadata_start_writeback(cache->cmd);
 }
 
 static void check_migrations(struct work_struct *ws)
@@ -1915,6 +1945,7 @@ static void destroy(struct cache *cache)
 		dm_bio_prison_destroy_v2(cache->prison);
 
 	cancel_delayed_work_sync(&cache->waker);
+	cancel_delayed_work_sync(&cache->metadata_writeback);
 	if (cache->wq)
 		destroy_workqueue(cache->wq);
 
@@ -2518,6 +2549,7 @@ static int cache_create(struct cache_args *ca, struct cache **result)
 	INIT_WORK(&cache->deferred_bio_worker, process_deferred_bios);
 	INIT_WORK(&cache->migration_worker, check_migrations);
 	INIT_DELAYED_WORK(&cache->waker, do_waker);
+	INIT_DELAYED_WORK(&cache->metadata_writeback, do_metadata_writeback);
 
 	cache->prison = dm_bio_prison_create_v2(cache->wq);
 	if (!cache->prison) {
@@ -2547,6 +2579,8 @@ static int cache_create(struct cache_args *ca, struct cache **result)
 	atomic_set(&cache->stats.cache_cell_clash, 0);
 	atomic_set(&cache->stats.commit_count, 0);
 	atomic_set(&cache->stats.discard_count, 0);
+	atomic64_set(&cache->stats.commit_ns, 0);
+	atomic64_set(&cache->stats.migration_ns, 0);
 
 	spin_lock_init(&cache->invalidation_lock);
 	INIT_LIST_HEAD(&cache->invalidation_requests);
@@ -2774,6 +2808,7 @@ static void cache_postsuspend(struct dm_target *ti)
 	BUG_ON(atomic_read(&cache->nr_io_migrations));
 
 	cancel_delayed_work_sync(&cache->waker);
+	cancel_delayed_work_sync(&cache->metadata_writeback);
 	drain_workqueue(cache->wq);
 	WARN_ON(cache->tracker.in_flight);
 
@@ -3060,6 +3095,7 @@ static void cache_status(struct dm_target *ti, status_type_t type,
 	char buf[BDEVNAME_SIZE];
 	struct cache *cache = ti->private;
 	dm_cblock_t residency;
+	unsigned int nr_migrations;
 	bool needs_check;
 
 	switch (type) {
@@ -3128,6 +3164,17 @@ static void cache_status(struct dm_target *ti, status_type_t type,
 		else
 			DMEMIT("- ");
 
+		/* average commit and migration latencies in microseconds */
+		nr_migrations = atomic_read(&cache->stats.promotion) +
+				atomic_read(&cache->stats.demotion) +
+				atomic_read(&cache->stats.writeback);
+		DMEMIT("%llu %llu",
+		       div64_u64(atomic64_read(&cache->stats.commit_ns),
+				 max(atomic_read(&cache->stats.commit_count), 1) *
+				 (u64)NSEC_PER_USEC),
+		       div64_u64(atomic64_read(&cache->stats.migration_ns),
+				 max(nr_migrations, 1u) * (u64)NSEC_PER_USEC));
+
 		break;
 
 	case STATUSTYPE_TABLE:
@@ -3429,7 +3476,7 @@ static void cache_io_hints(struct dm_target *ti, struct queue_limits *limits)
 
 static struct target_type cache_target = {
 	.name = "cache",
-	.version = {2, 2, 0},
+	.version = {2, 3, 0},
 	.module = THIS_MODULE,
 	.ctr = cache_ctr,
 	.dtr = cache_dtr,
@@ -152,6 +152,17 @@ enum cipher_flags {
 /*
  * The fields in here must be read only after initialization.
  */
+/*
+ * Encrypted writes are sorted and submitted by a thread per NUMA node, so
+ * that the write path of a device isn't bound to the memory and CPUs of a
+ * single node.
+ */
+struct crypt_write_queue {
+	spinlock_t lock;
+	struct task_struct *thread;
+	struct rb_root tree;
+} ____cacheline_aligned_in_smp;
+
 struct crypt_config {
 	struct dm_dev *dev;
 	sector_t start;
@@ -161,9 +172,7 @@ struct crypt_config {
 	struct workqueue_struct *io_queue;
 	struct workqueue_struct *crypt_queue;
 
-	spinlock_t write_thread_lock;
-	struct task_struct *write_thread;
-	struct rb_root write_tree;
+	struct crypt_write_queue *write_queues;	/* one per possible node */
 
 	char *cipher_string;
 	char *cipher_auth;
@@ -1944,22 +1953,22 @@ static void kcryptd_io_write(struct dm_crypt_io *io)
 
 static int dmcrypt_write(void *data)
 {
-	struct crypt_config *cc = data;
+	struct crypt_write_queue *wq = data;
 	struct dm_crypt_io *io;
 
 	while (1) {
 		struct rb_root write_tree;
 		struct blk_plug plug;
 
-		spin_lock_irq(&cc->write_thread_lock);
+		spin_lock_irq(&wq->lock);
 continue_locked:
 
-		if (!RB_EMPTY_ROOT(&cc->write_tree))
+		if (!RB_EMPTY_ROOT(&wq->tree))
 			goto pop_from_list;
 
 		set_current_state(TASK_INTERRUPTIBLE);
 
-		spin_unlock_irq(&cc->write_thread_lock);
+		spin_unlock_irq(&wq->lock);
 
 		if (unlikely(kthread_should_stop())) {
 			set_current_state(TASK_RUNNING);
@@ -1968,13 +1977,13 @@ static int dmcrypt_write(void *data)
 
 		schedule();
 
-		spin_lock_irq(&cc->write_thread_lock);
+		spin_lock_irq(&wq->lock);
 		goto continue_locked;
 
 pop_from_list:
-		write_tree = cc->write_tree;
-		cc->write_tree = RB_ROOT;
-		spin_unlock_irq(&cc->write_thread_lock);
+		write_tree = wq->tree;
+		wq->tree = RB_ROOT;
+		spin_unlock_irq(&wq->lock);
 
 		BUG_ON(rb_parent(write_tree.rb_node));
 
@@ -1998,6 +2007,7 @@ static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io, int async)
 {
 	struct bio *clone = io->ctx.bio_out;
 	struct crypt_config *cc = io->cc;
+	struct crypt_write_queue *wq;
 	unsigned long flags;
 	sector_t sector;
 	struct rb_node **rbp, *parent;
@@ -2020,10 +2030,11 @@ static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io, int async)
 		return;
 	}
 
-	spin_lock_irqsave(&cc->write_thread_lock, flags);
-	if (RB_EMPTY_ROOT(&cc->write_tree))
-		wake_up_process(cc->write_thread);
-	rbp = &cc->write_tree.rb_node;
+	wq = &cc->write_queues[numa_node_id()];
+	spin_lock_irqsave(&wq->lock, flags);
+	if (RB_EMPTY_ROOT(&wq->tree))
+		wake_up_process(wq->thread);
+	rbp = &wq->tree.rb_node;
 	parent = NULL;
 	sector = io->sector;
 	while (*rbp) {
@@ -2034,8 +2045,8 @@ static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io, int async)
 			rbp = &(*rbp)->rb_right;
 	}
 	rb_link_node(&io->rb_node, parent, rbp);
-	rb_insert_color(&io->rb_node, &cc->write_tree);
-	spin_unlock_irqrestore(&cc->write_thread_lock, flags);
+	rb_insert_color(&io->rb_node, &wq->tree);
+	spin_unlock_irqrestore(&wq->lock, flags);
 }
 
 static bool kcryptd_crypt_write_inline(struct crypt_config *cc,
@@ -2757,6 +2768,59 @@ static void crypt_page_free(void *page, void *pool_data)
 	percpu_counter_sub(&cc->n_allocated_pages, 1);
 }
 
+static void crypt_stop_write_threads(struct crypt_config *cc)
+{
+	int node;
+
+	if (!cc->write_queues)
+		return;
+
+	for_each_node(node)
+		if (cc->write_queues[node].thread)
+			kthread_stop(cc->write_queues[node].thread);
+	kfree(cc->write_queues);
+	cc->write_queues = NULL;
+}
+
+static int crypt_start_write_threads(struct crypt_config *cc,
+				     const char *devname)
+{
+	struct task_struct *thread;
+	int node;
+
+	cc->write_queues = kcalloc(nr_node_ids, sizeof(*cc->write_queues),
+				   GFP_KERNEL);
+	if (!cc->write_queues)
+		return -ENOMEM;
+
+	for_each_node(node) {
+		struct crypt_write_queue *wq = &cc->write_queues[node];
+		const struct cpumask *mask = cpumask_of_node(node);
+
+		spin_lock_init(&wq->lock);
+		wq->tree = RB_ROOT;
+
+		if (nr_node_ids == 1)
+			thread = kthread_create(dmcrypt_write, wq,
+						"dmcrypt_write/%s", devname);
+		else
+			thread = kthread_create_on_node(dmcrypt_write, wq, node,
+							"dmcrypt_write/%s/%d",
+							devname, node);
+		if (IS_ERR(thread))
+			return PTR_ERR(thread);
+
+		if (nr_node_ids > 1 && !cpumask_empty(mask))
+			set_cpus_allowed_ptr(thread, mask);
+		if (test_bit(DM_CRYPT_HIGH_PRIORITY, &cc->flags))
+			set_user_nice(thread, MIN_NICE);
+		wq->thread = thread;
+		wake_up_process(thread);
+	}
+
+	return 0;
+}
+
 static void crypt_dtr(struct dm_target *ti)
 {
 	struct crypt_config *cc = ti->private;
@@ -2766,8 +2830,7 @@ static void crypt_dtr(struct dm_target *ti)
 	if (!cc)
 		return;
 
-	if (cc->write_thread)
-		kthread_stop(cc->write_thread);
+	crypt_stop_write_threads(cc);
 
 	if (cc->io_queue)
 		destroy_workqueue(cc->io_queue);
@@ -3444,18 +3507,11 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		goto bad;
 	}
 
-	spin_lock_init(&cc->write_thread_lock);
-	cc->write_tree = RB_ROOT;
-
-	cc->write_thread = kthread_run(dmcrypt_write, cc, "dmcrypt_write/%s", devname);
-	if (IS_ERR(cc->write_thread)) {
-		ret = PTR_ERR(cc->write_thread);
-		cc->write_thread = NULL;
+	ret = crypt_start_write_threads(cc, devname);
+	if (ret) {
 		ti->error = "Couldn't spawn write thread";
 		goto bad;
 	}
-	if (test_bit(DM_CRYPT_HIGH_PRIORITY, &cc->flags))
-		set_user_nice(cc->write_thread, MIN_NICE);
 
 	ti->num_flush_bios = 1;
 	ti->limit_swap_bios = true;
@@ -10,6 +10,7 @@
 #include <linux/completion.h>
 #include <linux/err.h>
 #include <linux/kthread.h>
+#include <linux/ktime.h>
 #include <linux/percpu.h>
 
 #include "funnel-queue.h"
@@ -58,6 +59,14 @@ struct simple_work_queue {
 	/* Hack to reduce wakeup calls if the worker thread is running */
 	atomic_t idle;
 
+	/*
+	 * Load statistics. Only the enqueue count is written by other threads; the worker thread
+	 * alone updates the rest.
+	 */
+	atomic64_t enqueued ____cacheline_aligned;
+	u64 processed;
+	u64 busy_ns;
+
 	/* These are infrequently used so in terms of performance we don't care where they land. */
 	struct task_struct *thread;
 	/* Notify creator once worker has initialized */
@@ -121,6 +130,7 @@ static void enqueue_work_queue_completion(struct simple_work_queue *queue,
 		completion->priority = 0;
 
 	completion->my_queue = &queue->common;
+	atomic64_inc(&queue->enqueued);
 
 	/* Funnel queue handles the synchronization for the put. */
 	vdo_funnel_queue_put(queue->priority_lists[completion->priority],
@@ -236,6 +246,7 @@ static void service_work_queue(struct simple_work_queue *queue)
 
 	while (true) {
 		struct vdo_completion *completion = poll_for_completion(queue);
+		u64 start;
 
 		if (completion == NULL)
 			completion = wait_for_next_completion(queue);
@@ -245,7 +256,10 @@ static void service_work_queue(struct simple_work_queue *queue)
 			break;
 		}
 
+		start = ktime_get_ns();
 		process_completion(queue, completion);
+		WRITE_ONCE(queue->busy_ns, queue->busy_ns + ktime_get_ns() - start);
+		WRITE_ONCE(queue->processed, queue->processed + 1);
 
 		/*
 		 * Be friendly to a CPU that has other work to do, if the kernel has told us to.
@@ -491,6 +505,37 @@ static void dump_simple_work_queue(struct simple_work_queue *queue)
 	/* ->waiting_worker_threads wait queue status? anyone waiting? */
 }
 
+static void add_simple_work_queue_stats(struct simple_work_queue *queue,
+					struct vdo_work_queue_stats *stats)
+{
+	u64 processed = READ_ONCE(queue->processed);
+	u64 enqueued = atomic64_read(&queue->enqueued);
+
+	stats->processed += processed;
+	stats->queued += (enqueued > processed) ? (enqueued - processed) : 0;
+	stats->busy_ns += READ_ONCE(queue->busy_ns);
+}
+
+/*
+ * Get the load of a work queue, summed over all its threads for a round-robin queue. The counts
+ * are sampled without synchronization, so the queue depth is approximate.
+ */
+void vdo_get_work_queue_stats(struct vdo_work_queue *queue, struct vdo_work_queue_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->name = queue->name;
+
+	if (queue->round_robin_mode) {
+		struct round_robin_work_queue *round_robin = as_round_robin_work_queue(queue);
+		unsigned int i;
+
+		for (i = 0; i < round_robin->num_service_queues; i++)
+			add_simple_work_queue_stats(round_robin->service_queues[i], stats);
+	} else {
+		add_simple_work_queue_stats(as_simple_work_queue(queue), stats);
+	}
+}
+
 /*
  * Write to the buffer some info about the completion, for logging. Since the common use case is
  * dumping info about a lot of completions to syslog all at once, the format favors brevity over
@@ -21,6 +21,16 @@ struct vdo_work_queue_type {
 	enum vdo_completion_priority default_priority;
 };
 
+struct vdo_work_queue_stats {
+	char *name;
+	/* Completions waiting to be run */
+	u64 queued;
+	/* Completions run so far */
+	u64 processed;
+	/* Time spent running them */
+	u64 busy_ns;
+};
+
 struct vdo_completion;
 struct vdo_thread;
 struct vdo_work_queue;
@@ -38,6 +48,8 @@ void vdo_free_work_queue(struct vdo_work_queue *queue);
 
 void vdo_dump_work_queue(struct vdo_work_queue *queue);
 
+void vdo_get_work_queue_stats(struct vdo_work_queue *queue, struct vdo_work_queue_stats *stats);
+
 void vdo_dump_completion_to_buffer(struct vdo_completion *completion, char *buffer,
 				   size_t length);
 
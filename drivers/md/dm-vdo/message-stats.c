@@ -4,6 +4,7 @@
  */
 
 #include "dedupe.h"
+#include "funnel-workqueue.h"
 #include "logger.h"
 #include "memory-alloc.h"
 #include "message-stats.h"
@@ -430,3 +431,27 @@ int vdo_write_stats(struct vdo *vdo, char *buf, unsigned int maxlen)
 	vdo_free(stats);
 	return VDO_SUCCESS;
 }
+
+/*
+ * Write the load of each thread's work queue, so that the zone type which is the bottleneck can
+ * be found: the logical, physical, and hash zone queue names carry the zone number.
+ */
+int vdo_write_zone_stats(struct vdo *vdo, char *buf, unsigned int maxlen)
+{
+	thread_id_t id;
+
+	for (id = 0; id < vdo->thread_config.thread_count; id++) {
+		struct vdo_work_queue_stats stats;
+
+		if (vdo->threads[id].queue == NULL)
+			continue;
+
+		vdo_get_work_queue_stats(vdo->threads[id].queue, &stats);
+		write_string(NULL, stats.name, " : { ", &buf, &maxlen);
+		write_u64("queued : ", stats.queued, ", ", &buf, &maxlen);
+		write_u64("processed : ", stats.processed, ", ", &buf, &maxlen);
+		write_u64("busyMs : ", div_u64(stats.busy_ns, NSEC_PER_MSEC), " }\n", &buf, &maxlen);
+	}
+
+	return VDO_SUCCESS;
+}
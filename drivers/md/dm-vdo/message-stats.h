@@ -9,5 +9,6 @@
 #include "types.h"
 
 int vdo_write_stats(struct vdo *vdo, char *buf, unsigned int maxlen);
+int vdo_write_zone_stats(struct vdo *vdo, char *buf, unsigned int maxlen);
 
 #endif /* VDO_MESSAGE_STATS_H */
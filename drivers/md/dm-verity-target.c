@@ -11,6 +11,12 @@
  * hash device. Setting this greatly improves performance when data and hash
  * are on the same disk on different partitions on devices with poor random
  * access behavior.
+ *
+ * In "/sys/module/dm_verity/parameters/verify_split_blocks" you can set the
+ * largest number of data blocks a bio to a newly created target may carry.
+ * Larger bios are split, and the pieces are verified concurrently on the
+ * verify workqueue instead of block after block in one work item. 0 (the
+ * default) doesn't split.
  */
 
 #include "dm-verity.h"
@@ -46,6 +52,10 @@ static unsigned int dm_verity_prefetch_cluster = DM_VERITY_DEFAULT_PREFETCH_SIZE
 
 module_param_named(prefetch_cluster, dm_verity_prefetch_cluster, uint, 0644);
 
+static unsigned int dm_verity_split_blocks;
+
+module_param_named(verify_split_blocks, dm_verity_split_blocks, uint, 0644);
+
 static DEFINE_STATIC_KEY_FALSE(use_bh_wq_enabled);
 
 struct dm_verity_prefetch_work {
@@ -573,7 +583,9 @@ static int verity_verify_io(struct dm_verity_io *io)
 	struct bvec_iter *iter;
 	struct crypto_wait wait;
 	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_io_data_size);
-	unsigned int b;
+	unsigned int b, hashed = 0;
+	u64 hash_ns = 0, t;
+	int r;
 
 	if (static_branch_unlikely(&use_bh_wq_enabled) && io->in_bh) {
 		/*
@@ -586,7 +598,6 @@ static int verity_verify_io(struct dm_verity_io *io)
 		iter = &io->iter;
 
 	for (b = 0; b < io->n_blocks; b++) {
-		int r;
 		sector_t cur_block = io->block + b;
 		struct ahash_request *req = verity_io_hash_req(v, io);
 
@@ -600,7 +611,7 @@ static int verity_verify_io(struct dm_verity_io *io)
 					  verity_io_want_digest(v, io),
 					  &is_zero);
 		if (unlikely(r < 0))
-			return r;
+			goto out;
 
 		if (is_zero) {
 			/*
@@ -610,24 +621,27 @@ static int verity_verify_io(struct dm_verity_io *io)
 			r = verity_for_bv_block(v, io, iter,
 						verity_bv_zero);
 			if (unlikely(r < 0))
-				return r;
+				goto out;
 
 			continue;
 		}
 
+		t = ktime_get_ns();
 		r = verity_hash_init(v, req, &wait, !io->in_bh);
 		if (unlikely(r < 0))
-			return r;
+			goto out;
 
 		start = *iter;
 		r = verity_for_io_block(v, io, iter, &wait);
 		if (unlikely(r < 0))
-			return r;
+			goto out;
 
 		r = verity_hash_final(v, req, verity_io_real_digest(v, io),
 					&wait);
 		if (unlikely(r < 0))
-			return r;
+			goto out;
+		hash_ns += ktime_get_ns() - t;
+		hashed++;
 
 		if (likely(memcmp(verity_io_real_digest(v, io),
 				  verity_io_want_digest(v, io), v->digest_size) == 0)) {
@@ -639,7 +653,8 @@ static int verity_verify_io(struct dm_verity_io *io)
 			 * Error handling code (FEC included) cannot be run in a
 			 * tasklet since it may sleep, so fallback to work-queue.
 			 */
-			return -EAGAIN;
+			r = -EAGAIN;
+			goto out;
 		} else if (verity_recheck(v, io, start, cur_block) == 0) {
 			if (v->validated_blocks)
 				set_bit(cur_block, v->validated_blocks);
@@ -654,18 +669,25 @@ static int verity_verify_io(struct dm_verity_io *io)
 				/*
 				 * Error correction failed; Just return error
 				 */
-				return -EIO;
+				r = -EIO;
+				goto out;
 			}
 			if (verity_handle_err(v, DM_VERITY_BLOCK_TYPE_DATA,
 					      cur_block)) {
 				dm_audit_log_bio(DM_MSG_PREFIX, "verify-data",
 						 bio, cur_block, 0);
-				return -EIO;
+				r = -EIO;
+				goto out;
 			}
 		}
 	}
-
-	return 0;
+	r = 0;
+out:
+	if (hashed) {
+		atomic64_add(hashed, &v->hashed_blocks);
+		atomic64_add(hash_ns, &v->hash_ns);
+	}
+	return r;
 }
 
 /*
@@ -876,7 +898,10 @@ static void verity_status(struct dm_target *ti, status_type_t type,
 
 	switch (type) {
 	case STATUSTYPE_INFO:
-		DMEMIT("%c", v->hash_failed ? 'C' : 'V');
+		DMEMIT("%c %llu %llu", v->hash_failed ? 'C' : 'V',
+		       (unsigned long long)atomic64_read(&v->hashed_blocks),
+		       (unsigned long long)div_u64(atomic64_read(&v->hash_ns),
+						   NSEC_PER_USEC));
 		break;
 	case STATUSTYPE_TABLE:
 		DMEMIT("%u %s %s %u %u %llu %llu %s ",
@@ -1523,6 +1548,14 @@ static int verity_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	ti->per_io_data_size = roundup(ti->per_io_data_size,
 				       __alignof__(struct dm_verity_io));
 
+	num = READ_ONCE(dm_verity_split_blocks);
+	if (num) {
+		r = dm_set_target_max_io_len(ti, (sector_t)num <<
+				(v->data_dev_block_bits - SECTOR_SHIFT));
+		if (r)
+			goto bad;
+	}
+
 	verity_verify_sig_opts_cleanup(&verify_args);
 
 	dm_audit_log_ctr(DM_MSG_PREFIX, ti, 1);
@@ -1587,7 +1620,7 @@ int dm_verity_get_root_digest(struct dm_target *ti, u8 **root_digest, unsigned i
 static struct target_type verity_target = {
 	.name		= "verity",
 	.features	= DM_TARGET_SINGLETON | DM_TARGET_IMMUTABLE,
-	.version	= {1, 10, 0},
+	.version	= {1, 11, 0},
 	.module		= THIS_MODULE,
 	.ctr		= verity_ctr,
 	.dtr		= verity_dtr,
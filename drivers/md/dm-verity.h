@@ -72,6 +72,10 @@ struct dm_verity {
 
 	struct dm_io_client *io;
 	mempool_t recheck_pool;
+
+	/* data blocks hashed and the time it took, for the status line */
+	atomic64_t hashed_blocks;
+	atomic64_t hash_ns;
 };
 
 struct dm_verity_io {
@@ -90,8 +90,14 @@ __acquires(bitmap->lock)
 			return -ENOMEM;
 		/* failed - set the hijacked flag so that we can use the
 		 * pointer as a counter */
-		if (!bitmap->bp[page].map)
+		if (!bitmap->bp[page].map) {
 			bitmap->bp[page].hijacked = 1;
+			/*
+			 * The lockless lookup needs to see the flag before
+			 * any counter stored in the pointer.
+			 */
+			smp_wmb();
+		}
 	} else if (bitmap->bp[page].map ||
 		   bitmap->bp[page].hijacked) {
 		/* somebody beat us to getting the page */
@@ -100,18 +106,32 @@ __acquires(bitmap->lock)
 
 		/* no page was in place and we have one, so install it */
 
-		bitmap->bp[page].map = mappage;
+		WRITE_ONCE(bitmap->bp[page].map, mappage);
 		bitmap->missing_pages--;
 	}
 	return 0;
 }
 
+struct bitmap_page_free {
+	struct rcu_head rcu;
+	char *map;
+};
+
+static void md_bitmap_free_page_rcu(struct rcu_head *head)
+{
+	struct bitmap_page_free *f = container_of(head, struct bitmap_page_free,
+						  rcu);
+
+	kfree(f->map);
+	kfree(f);
+}
+
 /* if page is completely empty, put it back on the free list, or dealloc it */
 /* if page was hijacked, unmark the flag so it might get alloced next time */
 /* Note: lock should be held when calling this */
 static void md_bitmap_checkfree(struct bitmap_counts *bitmap, unsigned long page)
 {
-	char *ptr;
+	struct bitmap_page_free *f;
 
 	if (bitmap->bp[page].count) /* page is still busy */
 		return;
@@ -122,11 +142,18 @@ static void md_bitmap_checkfree(struct bitmap_counts *bitmap, unsigned long page
 		bitmap->bp[page].hijacked = 0;
 		bitmap->bp[page].map = NULL;
 	} else {
-		/* normal case, free the page */
-		ptr = bitmap->bp[page].map;
-		bitmap->bp[page].map = NULL;
+		/*
+		 * normal case, free the page once the lockless write paths
+		 * can no longer be looking at it.  If that can't be arranged
+		 * right now, the page stays; all its counters are zero.
+		 */
+		f = kmalloc(sizeof(*f), GFP_ATOMIC | __GFP_NOWARN);
+		if (!f)
+			return;
+		f->map = bitmap->bp[page].map;
+		WRITE_ONCE(bitmap->bp[page].map, NULL);
 		bitmap->missing_pages++;
-		kfree(ptr);
+		call_rcu(&f->rcu, md_bitmap_free_page_rcu);
 	}
 }
 
@@ -1461,6 +1488,92 @@ __acquires(bitmap->lock)
 			&(bitmap->bp[page].map[pageoff]);
 }
 
+/*
+ * Counters of chunks with writes in flight (COUNTER() >= 3) are also
+ * changed without counts.lock by the write fast paths below, so every
+ * change to such a counter has to go through this helper.  Counters are
+ * 16 bits wide; the update is done on the aligned 32-bit word holding
+ * it, which works for hijacked pointers as well.
+ */
+static bitmap_counter_t md_bitmap_counter_update(bitmap_counter_t *bmc,
+						 bitmap_counter_t clear,
+						 bitmap_counter_t set,
+						 int delta)
+{
+	u32 *word = (u32 *)((unsigned long)bmc & ~3UL);
+	unsigned int shift = ((unsigned long)bmc & 2) * BITS_PER_BYTE;
+	u32 old, new;
+	bitmap_counter_t val;
+
+	if (IS_ENABLED(CONFIG_CPU_BIG_ENDIAN))
+		shift = 16 - shift;
+
+	old = READ_ONCE(*word);
+	do {
+		val = (((bitmap_counter_t)(old >> shift) & ~clear) | set) +
+		      delta;
+		new = (old & ~(0xffffU << shift)) | ((u32)val << shift);
+	} while (!try_cmpxchg(word, &old, new));
+
+	return val;
+}
+
+/*
+ * Like md_bitmap_counter_update(), but only adds @delta if the counter
+ * stays at or above 3 and off COUNTER_MAX either side of the update,
+ * i.e. when none of the side effects handled under counts.lock (setting
+ * bits, marking pages pending, waking overflow waiters) is due.
+ */
+static bool md_bitmap_counter_try_add(bitmap_counter_t *bmc, int delta)
+{
+	u32 *word = (u32 *)((unsigned long)bmc & ~3UL);
+	unsigned int shift = ((unsigned long)bmc & 2) * BITS_PER_BYTE;
+	u32 old, new;
+	bitmap_counter_t val;
+
+	if (IS_ENABLED(CONFIG_CPU_BIG_ENDIAN))
+		shift = 16 - shift;
+
+	old = READ_ONCE(*word);
+	do {
+		val = old >> shift;
+		if (COUNTER(val) == COUNTER_MAX ||
+		    COUNTER(val) + delta < 3 ||
+		    COUNTER(val) + delta >= COUNTER_MAX)
+			return false;
+		new = old + ((u32)delta << shift);
+	} while (!try_cmpxchg(word, &old, new));
+
+	return true;
+}
+
+/*
+ * Lockless counterpart of md_bitmap_get_counter(create = 0) for the write
+ * fast paths; must be called under rcu_read_lock().  Pages are only freed
+ * after a grace period, and hijacked pages are left to the locked path.
+ */
+static bitmap_counter_t *md_bitmap_find_counter_rcu(struct bitmap_counts *bitmap,
+						    sector_t offset,
+						    sector_t *blocks)
+{
+	sector_t chunk = offset >> bitmap->chunkshift;
+	unsigned long page = chunk >> PAGE_COUNTER_SHIFT;
+	unsigned long pageoff = (chunk & PAGE_COUNTER_MASK) << COUNTER_BYTE_SHIFT;
+	sector_t csize = ((sector_t)1) << bitmap->chunkshift;
+	char *map;
+
+	if (page >= bitmap->pages)
+		return NULL;
+
+	map = READ_ONCE(bitmap->bp[page].map);
+	smp_rmb();	/* pairs with smp_wmb() in md_bitmap_checkpage() */
+	if (!map || bitmap->bp[page].hijacked)
+		return NULL;
+
+	*blocks = csize - (offset & (csize - 1));
+	return (bitmap_counter_t *)&map[pageoff];
+}
+
 int md_bitmap_startwrite(struct bitmap *bitmap, sector_t offset, unsigned long sectors, int behind)
 {
 	if (!bitmap)
@@ -1481,6 +1594,16 @@ int md_bitmap_startwrite(struct bitmap *bitmap, sector_t offset, unsigned long s
 		sector_t blocks;
 		bitmap_counter_t *bmc;
 
+		/* chunks that already have writers need no bit set */
+		rcu_read_lock();
+		bmc = md_bitmap_find_counter_rcu(&bitmap->counts, offset,
+						 &blocks);
+		if (bmc && md_bitmap_counter_try_add(bmc, 1)) {
+			rcu_read_unlock();
+			goto next;
+		}
+		rcu_read_unlock();
+
 		spin_lock_irq(&bitmap->counts.lock);
 		bmc = md_bitmap_get_counter(&bitmap->counts, offset, &blocks, 1);
 		if (!bmc) {
@@ -1511,10 +1634,10 @@ int md_bitmap_startwrite(struct bitmap *bitmap, sector_t offset, unsigned long s
 			*bmc = 2;
 		}
 
-		(*bmc)++;
+		md_bitmap_counter_update(bmc, 0, 0, 1);
 
 		spin_unlock_irq(&bitmap->counts.lock);
-
+next:
 		offset += blocks;
 		if (sectors > blocks)
 			sectors -= blocks;
@@ -1542,6 +1665,24 @@ void md_bitmap_endwrite(struct bitmap *bitmap, sector_t offset,
 		sector_t blocks;
 		unsigned long flags;
 		bitmap_counter_t *bmc;
+		bitmap_counter_t val;
+
+		/*
+		 * Dropping one of several writers needs the lock only to
+		 * note a failure or to advance events_cleared.
+		 */
+		if (success && (bitmap->mddev->degraded ||
+		    READ_ONCE(bitmap->events_cleared) >=
+		    READ_ONCE(bitmap->mddev->events))) {
+			rcu_read_lock();
+			bmc = md_bitmap_find_counter_rcu(&bitmap->counts,
+							 offset, &blocks);
+			if (bmc && md_bitmap_counter_try_add(bmc, -1)) {
+				rcu_read_unlock();
+				goto next;
+			}
+			rcu_read_unlock();
+		}
 
 		spin_lock_irqsave(&bitmap->counts.lock, flags);
 		bmc = md_bitmap_get_counter(&bitmap->counts, offset, &blocks, 0);
@@ -1557,18 +1698,17 @@ void md_bitmap_endwrite(struct bitmap *bitmap, sector_t offset,
 			sysfs_notify_dirent_safe(bitmap->sysfs_can_clear);
 		}
 
-		if (!success && !NEEDED(*bmc))
-			*bmc |= NEEDED_MASK;
-
 		if (COUNTER(*bmc) == COUNTER_MAX)
 			wake_up(&bitmap->overflow_wait);
 
-		(*bmc)--;
-		if (*bmc <= 2) {
+		val = md_bitmap_counter_update(bmc, 0,
+					       success ? 0 : NEEDED_MASK, -1);
+		if (val <= 2) {
 			md_bitmap_set_pending(&bitmap->counts, offset);
 			bitmap->allclean = 0;
 		}
 		spin_unlock_irqrestore(&bitmap->counts.lock, flags);
+next:
 		offset += blocks;
 		if (sectors > blocks)
 			sectors -= blocks;
@@ -1596,10 +1736,9 @@ static int __bitmap_start_sync(struct bitmap *bitmap, sector_t offset, sector_t
 			rv = 1;
 		else if (NEEDED(*bmc)) {
 			rv = 1;
-			if (!degraded) { /* don't set/clear bits if degraded */
-				*bmc |= RESYNC_MASK;
-				*bmc &= ~NEEDED_MASK;
-			}
+			if (!degraded) /* don't set/clear bits if degraded */
+				md_bitmap_counter_update(bmc, NEEDED_MASK,
+							 RESYNC_MASK, 0);
 		}
 	}
 	spin_unlock_irq(&bitmap->counts.lock);
@@ -1645,12 +1784,14 @@ void md_bitmap_end_sync(struct bitmap *bitmap, sector_t offset, sector_t *blocks
 		goto unlock;
 	/* locked */
 	if (RESYNC(*bmc)) {
-		*bmc &= ~RESYNC_MASK;
+		bitmap_counter_t val;
+
+		val = md_bitmap_counter_update(bmc, RESYNC_MASK, 0, 0);
 
-		if (!NEEDED(*bmc) && aborted)
-			*bmc |= NEEDED_MASK;
+		if (!NEEDED(val) && aborted)
+			md_bitmap_counter_update(bmc, 0, NEEDED_MASK, 0);
 		else {
-			if (*bmc <= 2) {
+			if (val <= 2) {
 				md_bitmap_set_pending(&bitmap->counts, offset);
 				bitmap->allclean = 0;
 			}
@@ -1751,7 +1892,7 @@ static void md_bitmap_set_memory_bits(struct bitmap *bitmap, sector_t offset, in
 		bitmap->allclean = 0;
 	}
 	if (needed)
-		*bmc |= NEEDED_MASK;
+		md_bitmap_counter_update(bmc, 0, NEEDED_MASK, 0);
 	spin_unlock_irq(&bitmap->counts.lock);
 }
 
@@ -1824,6 +1965,9 @@ void md_bitmap_free(struct bitmap *bitmap)
 	/* release the bitmap file  */
 	md_bitmap_file_unmap(&bitmap->storage);
 
+	/* counter pages released by md_bitmap_checkfree() */
+	rcu_barrier();
+
 	bp = bitmap->counts.bp;
 	pages = bitmap->counts.pages;
 
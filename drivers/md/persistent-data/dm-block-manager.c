@@ -622,6 +622,15 @@ int dm_bm_flush(struct dm_block_manager *bm)
 }
 EXPORT_SYMBOL_GPL(dm_bm_flush);
 
+void dm_bm_write_dirty_async(struct dm_block_manager *bm)
+{
+	if (dm_bm_is_read_only(bm))
+		return;
+
+	dm_bufio_write_dirty_buffers_async(bm->bufio);
+}
+EXPORT_SYMBOL_GPL(dm_bm_write_dirty_async);
+
 void dm_bm_prefetch(struct dm_block_manager *bm, dm_block_t b)
 {
 	dm_bufio_prefetch(bm->bufio, b, 1);
@@ -109,6 +109,13 @@ void dm_bm_unlock(struct dm_block *b);
  */
 int dm_bm_flush(struct dm_block_manager *bm);
 
+/*
+ * Starts writing out dirty blocks without waiting for them, so that a
+ * later dm_bm_flush() has less to do.  The caller must prevent any
+ * block from being modified while this runs.
+ */
+void dm_bm_write_dirty_async(struct dm_block_manager *bm);
+
 /*
  * Request data is prefetched into the cache.
  */
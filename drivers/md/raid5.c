@@ -426,7 +426,7 @@ static inline void remove_hash(struct stripe_head *sh)
 	pr_debug("remove_hash(), stripe %llu\n",
 		(unsigned long long)sh->sector);
 
-	hlist_del_init(&sh->hash);
+	hlist_del_init_rcu(&sh->hash);
 }
 
 static inline void insert_hash(struct r5conf *conf, struct stripe_head *sh)
@@ -436,7 +436,7 @@ static inline void insert_hash(struct r5conf *conf, struct stripe_head *sh)
 	pr_debug("insert_hash(), stripe %llu\n",
 		(unsigned long long)sh->sector);
 
-	hlist_add_head(&sh->hash, hp);
+	hlist_add_head_rcu(&sh->hash, hp);
 }
 
 /* find an idle stripe, make sure it is unhashed, and return it. */
@@ -671,6 +671,44 @@ static struct stripe_head *find_get_stripe(struct r5conf *conf,
 	return sh;
 }
 
+/*
+ * Lockless lookup for the common case of several requests hitting a stripe
+ * that is already active.  Stripes with no references sit on an lru list
+ * and have to be taken off it under the locks, so they are left to
+ * find_get_stripe().  The stripe cache is SLAB_TYPESAFE_BY_RCU: a stripe
+ * seen here can be released and reused for another sector at any time,
+ * which the checks made once we hold a reference catch.  A stripe only
+ * changes sector while its count is zero, so those checks are stable.
+ * Returning NULL just means the caller has to take the locked path.
+ */
+static struct stripe_head *find_get_active_stripe_rcu(struct r5conf *conf,
+		sector_t sector, short generation)
+{
+	struct stripe_head *sh;
+
+	rcu_read_lock();
+	hlist_for_each_entry_rcu(sh, stripe_hash(conf, sector), hash) {
+		if (READ_ONCE(sh->sector) != sector ||
+		    READ_ONCE(sh->generation) != generation)
+			continue;
+
+		if (!atomic_inc_not_zero(&sh->count))
+			break;
+
+		if (sh->sector == sector && sh->generation == generation &&
+		    !hlist_unhashed(&sh->hash)) {
+			rcu_read_unlock();
+			return sh;
+		}
+
+		raid5_release_stripe(sh);
+		break;
+	}
+	rcu_read_unlock();
+
+	return NULL;
+}
+
 /*
  * Need to check if array has failed when deciding whether to:
  *  - start an array
@@ -810,6 +848,13 @@ struct stripe_head *raid5_get_active_stripe(struct r5conf *conf,
 
 	pr_debug("get_stripe, sector %llu\n", (unsigned long long)sector);
 
+	if ((flags & R5_GAS_NOQUIESCE) || !READ_ONCE(conf->quiesce)) {
+		sh = find_get_active_stripe_rcu(conf, sector,
+				READ_ONCE(conf->generation) - previous);
+		if (sh)
+			return sh;
+	}
+
 	spin_lock_irq(conf->hash_locks + hash);
 
 	for (;;) {
@@ -2366,9 +2411,13 @@ static struct stripe_head *alloc_stripe(struct kmem_cache *sc, gfp_t gfp,
 		INIT_LIST_HEAD(&sh->lru);
 		INIT_LIST_HEAD(&sh->r5c);
 		INIT_LIST_HEAD(&sh->log_list);
-		atomic_set(&sh->count, 1);
 		sh->raid_conf = conf;
 		sh->log_start = MaxSector;
+		/*
+		 * Publish the reference last: find_get_active_stripe_rcu()
+		 * may get hold of and release a stripe being set up here.
+		 */
+		atomic_set_release(&sh->count, 1);
 
 		if (raid5_has_ppl(conf)) {
 			sh->ppl_page = alloc_page(gfp);
@@ -2426,7 +2475,7 @@ static int grow_stripes(struct r5conf *conf, int num)
 	conf->active_name = 0;
 	sc = kmem_cache_create(conf->cache_name[conf->active_name],
 			       struct_size_t(struct stripe_head, dev, devs),
-			       0, 0, NULL);
+			       0, SLAB_TYPESAFE_BY_RCU, NULL);
 	if (!sc)
 		return 1;
 	conf->slab_cache = sc;
@@ -2550,7 +2599,7 @@ static int resize_stripes(struct r5conf *conf, int newsize)
 	/* Step 1 */
 	sc = kmem_cache_create(conf->cache_name[1-conf->active_name],
 			       struct_size_t(struct stripe_head, dev, newsize),
-			       0, 0, NULL);
+			       0, SLAB_TYPESAFE_BY_RCU, NULL);
 	if (!sc)
 		return -ENOMEM;
 
@@ -6694,6 +6743,8 @@ static void raid5_do_work(struct work_struct *work)
 			conf->device_lock);
 	}
 	pr_debug("%d stripes handled\n", handled);
+	worker->nr_runs++;
+	worker->nr_handled += handled;
 
 	spin_unlock_irq(&conf->device_lock);
 
@@ -7178,11 +7229,51 @@ raid5_group_thread_cnt = __ATTR(group_thread_cnt, S_IRUGO | S_IWUSR,
 				raid5_show_group_thread_cnt,
 				raid5_store_group_thread_cnt);
 
+/*
+ * One line per group thread: group, worker, times it ran and stripes it
+ * handled since the groups were last set up.
+ */
+static ssize_t
+raid5_show_group_thread_stats(struct mddev *mddev, char *page)
+{
+	struct r5conf *conf;
+	ssize_t len = 0;
+	int i, j;
+
+	spin_lock(&mddev->lock);
+	conf = mddev->private;
+	if (!conf)
+		goto out;
+
+	/* the groups are only replaced under device_lock */
+	spin_lock_irq(&conf->device_lock);
+	for (i = 0; i < conf->group_cnt; i++) {
+		struct r5worker_group *group = &conf->worker_groups[i];
+
+		for (j = 0; j < conf->worker_cnt_per_group; j++) {
+			struct r5worker *worker = &group->workers[j];
+
+			len += scnprintf(page + len, PAGE_SIZE - len,
+					 "%d %d %lu %lu\n", i, j,
+					 worker->nr_runs, worker->nr_handled);
+		}
+	}
+	spin_unlock_irq(&conf->device_lock);
+out:
+	spin_unlock(&mddev->lock);
+	return len;
+}
+
+static struct md_sysfs_entry
+raid5_group_thread_stats = __ATTR(group_thread_stats, S_IRUGO,
+				  raid5_show_group_thread_stats, NULL);
+
 static struct attribute *raid5_attrs[] =  {
 	&raid5_stripecache_size.attr,
 	&raid5_stripecache_active.attr,
 	&raid5_preread_bypass_threshold.attr,
 	&raid5_group_thread_cnt.attr,
+	&raid5_group_thread_stats.attr,
 	&raid5_skip_copy.attr,
 	&raid5_rmw_level.attr,
 	&raid5_stripe_size.attr,
@@ -509,6 +509,10 @@ struct r5worker {
 	struct r5worker_group *group;
 	struct list_head temp_inactive_list[NR_STRIPE_HASH_LOCKS];
 	bool working;
+
+	/* how often the worker ran and how many stripes it handled */
+	unsigned long nr_runs;
+	unsigned long nr_handled;
 };
 
 struct r5worker_group {
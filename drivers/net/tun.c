@@ -491,7 +491,7 @@ static void tun_flow_update(struct tun_struct *tun, u32 rxhash,
 			WRITE_ONCE(e->queue_index, queue_index);
 		if (e->updated != jiffies)
 			e->updated = jiffies;
-		sock_rps_record_flow_hash(e->rps_rxhash);
+		sock_rps_record_flow_hash(dev_net(tun->dev), e->rps_rxhash);
 	} else {
 		spin_lock_bh(&tun->lock);
 		if (!tun_flow_find(head, rxhash) &&
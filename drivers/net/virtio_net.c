@@ -879,6 +879,23 @@ static void *virtnet_rq_alloc(struct receive_queue *rq, u32 size, gfp_t gfp)
 	void *buf, *head;
 	dma_addr_t addr;
 
+	/*
+	 * When the current page is used up and every buffer carved from it
+	 * has been freed, only our own and the dma reference are left: start
+	 * over on the same page and keep its mapping instead of unmapping it
+	 * and mapping a new one.
+	 */
+	dma = rq->last_dma;
+	if (dma && alloc_frag->offset + size > alloc_frag->size &&
+	    page_ref_count(alloc_frag->page) == 2 && dma->ref == 1) {
+		if (dma->need_sync)
+			virtqueue_dma_sync_single_range_for_device(rq->vq,
+								   dma->addr, 0,
+								   dma->len,
+								   DMA_FROM_DEVICE);
+		alloc_frag->offset = sizeof(*dma);
+	}
+
 	if (unlikely(!skb_page_frag_refill(size, alloc_frag, gfp)))
 		return NULL;
 
@@ -344,6 +344,12 @@ static void set_sock_opts(struct socket *sock)
 	sock->sk->sk_allocation = GFP_ATOMIC;
 	sock->sk->sk_sndbuf = INT_MAX;
 	sk_set_memalloc(sock->sk);
+	/* Let UDP GRO coalesce trains of same-sized packets from a peer, so
+	 * that they go through the IP and UDP receive paths as one skb. They
+	 * are segmented again right before wg_receive(), since the socket
+	 * does not accept GSO packets.
+	 */
+	udp_set_bit(GRO_ENABLED, sock->sk);
 }
 
 int wg_socket_init(struct wg_device *wg, u16 port)
@@ -41,6 +41,12 @@ static int max_iotlb_entries = 2048;
 module_param(max_iotlb_entries, int, 0444);
 MODULE_PARM_DESC(max_iotlb_entries,
 	"Maximum number of iotlb entries. (default: 2048)");
+static bool balance_workers;
+module_param(balance_workers, bool, 0644);
+MODULE_PARM_DESC(balance_workers,
+	"Move virtqueues from busy to idle workers of the same device. (default: N)");
+
+#define VHOST_BALANCE_PERIOD	(HZ / 10)
 
 enum {
 	VHOST_MEMORY_F_LOG = 0x1,
@@ -255,6 +261,7 @@ bool vhost_vq_work_queue(struct vhost_virtqueue *vq, struct vhost_work *work)
 	worker = rcu_dereference(vq->worker);
 	if (worker) {
 		queued = true;
+		atomic_inc(&vq->queued_works);
 		vhost_worker_queue(worker, work);
 	}
 	rcu_read_unlock();
@@ -396,6 +403,8 @@ static bool vhost_run_work_list(void *data)
 
 	node = llist_del_all(&worker->work_list);
 	if (node) {
+		u64 start = ktime_get_ns();
+
 		__set_current_state(TASK_RUNNING);
 
 		node = llist_reverse_order(node);
@@ -408,6 +417,8 @@ static bool vhost_run_work_list(void *data)
 			kcov_remote_stop();
 			cond_resched();
 		}
+		WRITE_ONCE(worker->busy_ns,
+			   worker->busy_ns + ktime_get_ns() - start);
 	}
 
 	return !!node;
@@ -530,6 +541,8 @@ static size_t vhost_get_desc_size(struct vhost_virtqueue *vq,
 	return sizeof(*vq->desc) * num;
 }
 
+static void vhost_balance_workers(struct work_struct *work);
+
 void vhost_dev_init(struct vhost_dev *dev,
 		    struct vhost_virtqueue **vqs, int nvqs,
 		    int iov_limit, int weight, int byte_weight,
@@ -557,6 +570,7 @@ void vhost_dev_init(struct vhost_dev *dev,
 	INIT_LIST_HEAD(&dev->pending_list);
 	spin_lock_init(&dev->iotlb_lock);
 	xa_init_flags(&dev->worker_xa, XA_FLAGS_ALLOC);
+	INIT_DELAYED_WORK(&dev->balance_work, vhost_balance_workers);
 
 	for (i = 0; i < dev->nvqs; ++i) {
 		vq = dev->vqs[i];
@@ -638,6 +652,8 @@ static void vhost_workers_free(struct vhost_dev *dev)
 	if (!dev->use_worker)
 		return;
 
+	cancel_delayed_work_sync(&dev->balance_work);
+
 	for (i = 0; i < dev->nvqs; i++)
 		rcu_assign_pointer(dev->vqs[i]->worker, NULL);
 	/*
@@ -778,6 +794,105 @@ static int vhost_vq_attach_worker(struct vhost_virtqueue *vq,
 	return 0;
 }
 
+/*
+ * Pick the vq of @busy whose share of the works queued on @busy since the
+ * last balancing is closest to half the gap between the two workers, as
+ * moving that one evens their loads out best.  Works are not timed per vq,
+ * so a vq's load is estimated from how many of the worker's works it got.
+ */
+static struct vhost_virtqueue *vhost_pick_vq_to_move(struct vhost_dev *dev,
+						     struct vhost_worker *busy,
+						     u64 busy_delta, u64 gap)
+{
+	struct vhost_virtqueue *vq, *best = NULL;
+	u64 total = 0, load, best_diff = U64_MAX;
+	int i;
+
+	for (i = 0; i < dev->nvqs; i++) {
+		vq = dev->vqs[i];
+		if (rcu_access_pointer(vq->worker) == busy)
+			total += vq->period_works;
+	}
+
+	if (!total)
+		return NULL;
+
+	for (i = 0; i < dev->nvqs; i++) {
+		vq = dev->vqs[i];
+		if (rcu_access_pointer(vq->worker) != busy || !vq->period_works)
+			continue;
+
+		load = div64_u64(busy_delta * vq->period_works, total);
+		if (abs_diff(load, gap / 2) < best_diff) {
+			best_diff = abs_diff(load, gap / 2);
+			best = vq;
+		}
+	}
+
+	return best;
+}
+
+/*
+ * Runs every VHOST_BALANCE_PERIOD while balance_workers is set and the
+ * device has more than one worker.  If one worker was saturated over the
+ * period and another one had less than half its load, one vq is moved from
+ * the former to the latter.
+ */
+static void vhost_balance_workers(struct work_struct *work)
+{
+	struct vhost_dev *dev = container_of(to_delayed_work(work),
+					     struct vhost_dev, balance_work);
+	struct vhost_worker *worker, *busy = NULL, *idle = NULL;
+	u64 delta, busy_delta = 0, idle_delta = U64_MAX;
+	u64 period_ns = jiffies_to_nsecs(VHOST_BALANCE_PERIOD);
+	struct vhost_virtqueue *vq;
+	unsigned long i;
+	int nr_workers = 0;
+
+	/* The cleanup path cancels us with the device mutex held. */
+	if (!mutex_trylock(&dev->mutex))
+		goto out;
+
+	for (i = 0; i < dev->nvqs; i++) {
+		vq = dev->vqs[i];
+		vq->period_works = atomic_read(&vq->queued_works) -
+				   vq->balanced_works;
+		vq->balanced_works += vq->period_works;
+	}
+
+	xa_for_each(&dev->worker_xa, i, worker) {
+		delta = READ_ONCE(worker->busy_ns) - worker->balanced_busy_ns;
+		worker->balanced_busy_ns += delta;
+		if (READ_ONCE(worker->killed))
+			continue;
+
+		nr_workers++;
+		if (delta > busy_delta && worker->attachment_cnt > 1) {
+			busy_delta = delta;
+			busy = worker;
+		}
+		if (delta < idle_delta) {
+			idle_delta = delta;
+			idle = worker;
+		}
+	}
+
+	if (busy && idle && busy != idle &&
+	    busy_delta > period_ns * 3 / 4 && idle_delta < busy_delta / 2) {
+		vq = vhost_pick_vq_to_move(dev, busy, busy_delta,
+					   busy_delta - idle_delta);
+		if (vq)
+			__vhost_vq_attach_worker(vq, idle);
+	}
+	mutex_unlock(&dev->mutex);
+
+	if (nr_workers < 2)
+		return;
+out:
+	if (READ_ONCE(balance_workers))
+		schedule_delayed_work(&dev->balance_work, VHOST_BALANCE_PERIOD);
+}
+
 /* Caller must have device mutex */
 static int vhost_new_worker(struct vhost_dev *dev,
 			    struct vhost_worker_state *info)
@@ -788,6 +903,9 @@ static int vhost_new_worker(struct vhost_dev *dev,
 	if (!worker)
 		return -ENOMEM;
 
+	if (READ_ONCE(balance_workers))
+		schedule_delayed_work(&dev->balance_work, VHOST_BALANCE_PERIOD);
+
 	info->worker_id = worker->id;
 	return 0;
 }
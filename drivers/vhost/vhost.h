@@ -36,6 +36,9 @@ struct vhost_worker {
 	u32			id;
 	int			attachment_cnt;
 	bool			killed;
+	/* Time spent running works, and its value at the last balancing */
+	u64			busy_ns;
+	u64			balanced_busy_ns;
 };
 
 /* Poll a file (eventfd or socket) */
@@ -81,6 +84,13 @@ struct vhost_vring_call {
 struct vhost_virtqueue {
 	struct vhost_dev *dev;
 	struct vhost_worker __rcu *worker;
+	/*
+	 * Works queued for this vq, its count at the last balancing and the
+	 * number queued over the last balancing period.
+	 */
+	atomic_t queued_works;
+	u32 balanced_works;
+	u32 period_works;
 
 	/* The actual ring of buffers. */
 	struct mutex mutex;
@@ -176,6 +186,7 @@ struct vhost_dev {
 	int byte_weight;
 	struct xarray worker_xa;
 	bool use_worker;
+	struct delayed_work balance_work;
 	int (*msg_handler)(struct vhost_dev *dev, u32 asid,
 			   struct vhost_iotlb_msg *msg);
 };
@@ -631,6 +631,14 @@ struct btree_transaction_stats {
 	char			*max_paths_text;
 };
 
+/* Per btree counters for bch2_btree_path_traverse_one() */
+struct btree_traverse_stats {
+	u64			traverses;
+	u64			node_descents;
+	u64			root_descents;
+	u64			restarts;
+};
+
 struct bch_fs_pcpu {
 	u64			sectors_available;
 };
@@ -848,6 +856,8 @@ struct bch_fs {
 	mempool_t		btree_trans_pool;
 	mempool_t		btree_trans_mem_pool;
 	struct btree_trans_buf  __percpu	*btree_trans_bufs;
+	/* indexed by btree id, for btrees < BTREE_ID_NR */
+	struct btree_traverse_stats __percpu	*btree_traverse_stats;
 
 	struct srcu_struct	btree_trans_barrier;
 	bool			btree_trans_barrier_initialized;
@@ -1125,6 +1125,12 @@ static inline unsigned btree_path_up_until_good_node(struct btree_trans *trans,
  * On error, caller (peek_node()/peek_key()) must return NULL; the error is
  * stashed in the iterator and returned from bch2_trans_exit().
  */
+#define btree_traverse_stat_inc(_c, _btree, _stat)			\
+do {									\
+	if ((_btree) < BTREE_ID_NR)					\
+		this_cpu_inc((_c)->btree_traverse_stats[_btree]._stat);	\
+} while (0)
+
 int bch2_btree_path_traverse_one(struct btree_trans *trans,
 				 btree_path_idx_t path_idx,
 				 unsigned flags,
@@ -1135,7 +1141,7 @@ int bch2_btree_path_traverse_one(struct btree_trans *trans,
 	int ret = -((int) trans->restarted);
 
 	if (unlikely(ret))
-		goto out;
+		goto out_restarted;
 
 	if (unlikely(!trans->srcu_held))
 		bch2_trans_srcu_lock(trans);
@@ -1159,6 +1165,8 @@ int bch2_btree_path_traverse_one(struct btree_trans *trans,
 	if (unlikely(path->level >= BTREE_MAX_DEPTH))
 		goto out_uptodate;
 
+	btree_traverse_stat_inc(trans->c, path->btree_id, traverses);
+
 	path->level = btree_path_up_until_good_node(trans, path, 0);
 	unsigned max_level = path->level;
 
@@ -1172,9 +1180,13 @@ int bch2_btree_path_traverse_one(struct btree_trans *trans,
 	 * btree_path_lock_root() comes next and that it can't fail
 	 */
 	while (path->level > depth_want) {
-		ret = btree_path_node(path, path->level)
-			? btree_path_down(trans, path, flags, trace_ip)
-			: btree_path_lock_root(trans, path, depth_want, trace_ip);
+		if (btree_path_node(path, path->level)) {
+			btree_traverse_stat_inc(trans->c, path->btree_id, node_descents);
+			ret = btree_path_down(trans, path, flags, trace_ip);
+		} else {
+			btree_traverse_stat_inc(trans->c, path->btree_id, root_descents);
+			ret = btree_path_lock_root(trans, path, depth_want, trace_ip);
+		}
 		if (unlikely(ret)) {
 			if (ret == 1) {
 				/*
@@ -1204,6 +1216,9 @@ int bch2_btree_path_traverse_one(struct btree_trans *trans,
 out_uptodate:
 	path->uptodate = BTREE_ITER_UPTODATE;
 out:
+	if (unlikely(trans->restarted))
+		btree_traverse_stat_inc(trans->c, path->btree_id, restarts);
+out_restarted:
 	if (bch2_err_matches(ret, BCH_ERR_transaction_restart) != !!trans->restarted)
 		panic("ret %s (%i) trans->restarted %s (%i)\n",
 		      bch2_err_str(ret), ret,
@@ -3369,6 +3384,37 @@ void bch2_btree_trans_to_text(struct printbuf *out, struct btree_trans *trans)
 	rcu_read_unlock();
 }
 
+void bch2_btree_traverse_stats_to_text(struct printbuf *out, struct bch_fs *c)
+{
+	printbuf_tabstop_push(out, 20);
+	printbuf_tabstop_push(out, 14);
+	printbuf_tabstop_push(out, 14);
+	printbuf_tabstop_push(out, 14);
+	printbuf_tabstop_push(out, 14);
+
+	prt_printf(out, "\ttraverses\tdescents\tfrom root\trestarts\n");
+
+	for (unsigned i = 0; i < BTREE_ID_NR; i++) {
+		struct btree_traverse_stats s = {};
+		int cpu;
+
+		for_each_possible_cpu(cpu) {
+			struct btree_traverse_stats *p =
+				per_cpu_ptr(c->btree_traverse_stats, cpu) + i;
+
+			s.traverses	+= p->traverses;
+			s.node_descents	+= p->node_descents;
+			s.root_descents	+= p->root_descents;
+			s.restarts	+= p->restarts;
+		}
+
+		prt_printf(out, "%s:\t%llu\t%llu\t%llu\t%llu\n",
+			   bch2_btree_id_str(i),
+			   s.traverses, s.node_descents,
+			   s.root_descents, s.restarts);
+	}
+}
+
 void bch2_fs_btree_iter_exit(struct bch_fs *c)
 {
 	struct btree_transaction_stats *s;
@@ -3388,6 +3434,7 @@ void bch2_fs_btree_iter_exit(struct bch_fs *c)
 			kfree(trans);
 		}
 	free_percpu(c->btree_trans_bufs);
+	free_percpu(c->btree_traverse_stats);
 
 	trans = list_first_entry_or_null(&c->btree_trans_list, struct btree_trans, list);
 	if (trans)
@@ -3432,6 +3479,12 @@ int bch2_fs_btree_iter_init(struct bch_fs *c)
 	if (!c->btree_trans_bufs)
 		return -ENOMEM;
 
+	c->btree_traverse_stats =
+		__alloc_percpu(sizeof(struct btree_traverse_stats) * BTREE_ID_NR,
+			       __alignof__(struct btree_traverse_stats));
+	if (!c->btree_traverse_stats)
+		return -ENOMEM;
+
 	ret   = mempool_init_kmalloc_pool(&c->btree_trans_pool, 1,
 					  sizeof(struct btree_trans)) ?:
 		mempool_init_kmalloc_pool(&c->btree_trans_mem_pool, 1,
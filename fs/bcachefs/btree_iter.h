@@ -888,6 +888,7 @@ unsigned bch2_trans_get_fn_idx(const char *);
 })
 
 void bch2_btree_trans_to_text(struct printbuf *, struct btree_trans *);
+void bch2_btree_traverse_stats_to_text(struct printbuf *, struct bch_fs *);
 
 void bch2_fs_btree_iter_exit(struct bch_fs *);
 void bch2_fs_btree_iter_init_early(struct bch_fs *);
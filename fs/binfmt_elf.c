@@ -494,6 +494,31 @@ static unsigned long maximum_alignment(struct elf_phdr *cmds, int nr)
 	return ELF_PAGEALIGN(alignment);
 }
 
+/*
+ * With the HUGE_TEXT personality, ask for PMD-sized folios on the executable
+ * segments and fault them in from the page cache up front, instead of taking
+ * a fault for each page of the text as it first runs.  Best effort: failing
+ * to do so only costs performance.
+ */
+static void elf_huge_text(struct elf_phdr *cmds, int nr,
+			  unsigned long load_bias)
+{
+	unsigned long start, end;
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		if (cmds[i].p_type != PT_LOAD || !(cmds[i].p_flags & PF_X) ||
+		    !cmds[i].p_filesz)
+			continue;
+
+		start = ELF_PAGESTART(load_bias + cmds[i].p_vaddr);
+		end = ELF_PAGEALIGN(load_bias + cmds[i].p_vaddr +
+				    cmds[i].p_filesz);
+		do_madvise(current->mm, start, end - start, MADV_HUGEPAGE);
+		do_madvise(current->mm, start, end - start, MADV_POPULATE_READ);
+	}
+}
+
 /**
  * load_elf_phdrs() - load ELF program headers
  * @elf_ex:   ELF header of the binary whose program headers should be loaded
@@ -1088,6 +1113,13 @@ static int load_elf_binary(struct linux_binprm *bprm)
 				if (current->flags & PF_RANDOMIZE)
 					load_bias += arch_mmap_rnd();
 				alignment = maximum_alignment(elf_phdata, elf_ex->e_phnum);
+				/*
+				 * Text can only be mapped by PMDs where its
+				 * address and file offset agree modulo PMD_SIZE.
+				 */
+				if (current->personality & HUGE_TEXT)
+					alignment = max_t(unsigned long, alignment,
+							  PMD_SIZE);
 				if (alignment)
 					load_bias &= ~(alignment - 1);
 				elf_flags |= MAP_FIXED_NOREPLACE;
@@ -1196,6 +1228,9 @@ static int load_elf_binary(struct linux_binprm *bprm)
 
 	current->mm->start_brk = current->mm->brk = ELF_PAGEALIGN(elf_brk);
 
+	if (current->personality & HUGE_TEXT)
+		elf_huge_text(elf_phdata, elf_ex->e_phnum, load_bias);
+
 	if (interpreter) {
 		elf_entry = load_elf_interp(interp_elf_ex,
 					    interpreter,
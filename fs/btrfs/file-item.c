@@ -739,20 +739,123 @@ int btrfs_lookup_csums_bitmap(struct btrfs_root *root, struct btrfs_path *path,
 /*
  * Calculate checksums of the data contained inside a bio.
  */
+/*
+ * Checksum the sectors of @bio covered by @start into @sums, one checksum per
+ * sector.  @start has to begin and end on a sector boundary.
+ */
+static void csum_bio_range(struct btrfs_fs_info *fs_info, struct bio *bio,
+			   struct bvec_iter start, u8 *sums)
+{
+	SHASH_DESC_ON_STACK(shash, fs_info->csum_shash);
+	struct bvec_iter iter;
+	struct bio_vec bvec;
+	unsigned int blockcount;
+	char *data;
+	int i;
+
+	shash->tfm = fs_info->csum_shash;
+
+	__bio_for_each_segment(bvec, bio, iter, start) {
+		blockcount = BTRFS_BYTES_TO_BLKS(fs_info,
+						 bvec.bv_len + fs_info->sectorsize
+						 - 1);
+
+		data = bvec_kmap_local(&bvec);
+		for (i = 0; i < blockcount; i++) {
+			crypto_shash_digest(shash,
+					    data + (i * fs_info->sectorsize),
+					    fs_info->sectorsize, sums);
+			sums += fs_info->csum_size;
+		}
+		kunmap_local(data);
+	}
+}
+
+/*
+ * Bios with at least twice this many sectors have their checksums computed by
+ * up to BTRFS_CSUM_MAX_BATCHES csum workers in parallel, unless the checksum
+ * implementation is fast enough to do it inline.
+ */
+#define BTRFS_CSUM_BATCH_SECTORS	64
+#define BTRFS_CSUM_MAX_BATCHES		8
+
+struct csum_batch {
+	struct work_struct work;
+	struct btrfs_fs_info *fs_info;
+	struct bio *bio;
+	struct bvec_iter iter;
+	u8 *sums;
+	atomic_t *pending;
+	struct completion *done;
+};
+
+static void csum_batch_work(struct work_struct *work)
+{
+	struct csum_batch *batch = container_of(work, struct csum_batch, work);
+
+	csum_bio_range(batch->fs_info, batch->bio, batch->iter, batch->sums);
+	if (atomic_dec_and_test(batch->pending))
+		complete(batch->done);
+}
+
+static bool csum_bio_parallel(struct btrfs_fs_info *fs_info, struct bio *bio,
+			      u8 *sums)
+{
+	const u32 nr_sectors = bio->bi_iter.bi_size >> fs_info->sectorsize_bits;
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct bvec_iter iter = bio->bi_iter;
+	struct csum_batch *batches;
+	u32 batch_sectors;
+	int nr_batches;
+	atomic_t pending;
+
+	if (test_bit(BTRFS_FS_CSUM_IMPL_FAST, &fs_info->flags) ||
+	    nr_sectors < 2 * BTRFS_CSUM_BATCH_SECTORS)
+		return false;
+
+	batch_sectors = max_t(u32, BTRFS_CSUM_BATCH_SECTORS,
+			      DIV_ROUND_UP(nr_sectors, BTRFS_CSUM_MAX_BATCHES));
+	nr_batches = DIV_ROUND_UP(nr_sectors, batch_sectors);
+
+	batches = kmalloc_array(nr_batches, sizeof(*batches), GFP_NOFS);
+	if (!batches)
+		return false;
+
+	atomic_set(&pending, nr_batches);
+	for (int i = 0; i < nr_batches; i++) {
+		struct csum_batch *batch = &batches[i];
+		u32 bytes = min(batch_sectors << fs_info->sectorsize_bits,
+				iter.bi_size);
+
+		INIT_WORK(&batch->work, csum_batch_work);
+		batch->fs_info = fs_info;
+		batch->bio = bio;
+		batch->iter = iter;
+		batch->iter.bi_size = bytes;
+		batch->sums = sums + i * batch_sectors * fs_info->csum_size;
+		batch->pending = &pending;
+		batch->done = &done;
+		bio_advance_iter(bio, &iter, bytes);
+
+		/* The submitter does the last batch itself. */
+		if (i == nr_batches - 1)
+			csum_batch_work(&batch->work);
+		else
+			queue_work(fs_info->csum_workers, &batch->work);
+	}
+
+	wait_for_completion(&done);
+	kfree(batches);
+	return true;
+}
+
 blk_status_t btrfs_csum_one_bio(struct btrfs_bio *bbio)
 {
 	struct btrfs_ordered_extent *ordered = bbio->ordered;
 	struct btrfs_inode *inode = bbio->inode;
 	struct btrfs_fs_info *fs_info = inode->root->fs_info;
-	SHASH_DESC_ON_STACK(shash, fs_info->csum_shash);
 	struct bio *bio = &bbio->bio;
 	struct btrfs_ordered_sum *sums;
-	char *data;
-	struct bvec_iter iter;
-	struct bio_vec bvec;
-	int index;
-	unsigned int blockcount;
-	int i;
 	unsigned nofs_flag;
 
 	nofs_flag = memalloc_nofs_save();
@@ -767,26 +870,9 @@ blk_status_t btrfs_csum_one_bio(struct btrfs_bio *bbio)
 	INIT_LIST_HEAD(&sums->list);
 
 	sums->logical = bio->bi_iter.bi_sector << SECTOR_SHIFT;
-	index = 0;
-
-	shash->tfm = fs_info->csum_shash;
-
-	bio_for_each_segment(bvec, bio, iter) {
-		blockcount = BTRFS_BYTES_TO_BLKS(fs_info,
-						 bvec.bv_len + fs_info->sectorsize
-						 - 1);
 
-		for (i = 0; i < blockcount; i++) {
-			data = bvec_kmap_local(&bvec);
-			crypto_shash_digest(shash,
-					    data + (i * fs_info->sectorsize),
-					    fs_info->sectorsize,
-					    sums->sums + index);
-			kunmap_local(data);
-			index += fs_info->csum_size;
-		}
-
-	}
+	if (!csum_bio_parallel(fs_info, bio, sums->sums))
+		csum_bio_range(fs_info, bio, bio->bi_iter, sums->sums);
 
 	bbio->sums = sums;
 	btrfs_add_ordered_sum(ordered, sums);
@@ -29,6 +29,7 @@ struct cachefiles_kiocb {
 	bool			was_async;
 	unsigned int		inval_counter;	/* Copy of cookie->inval_counter */
 	u64			b_writing;
+	u64			submit_time;	/* ktime_get_ns() at submission */
 };
 
 static inline void cachefiles_put_kiocb(struct cachefiles_kiocb *ki)
@@ -53,6 +54,8 @@ static void cachefiles_read_complete(struct kiocb *iocb, long ret)
 	if (ret < 0)
 		trace_cachefiles_io_error(ki->object, inode, ret,
 					  cachefiles_trace_read_error);
+	else
+		fscache_count_read_latency(ki->submit_time);
 
 	if (ki->term_func) {
 		if (ret >= 0) {
@@ -154,6 +157,7 @@ static int cachefiles_read(struct netfs_cache_resources *cres,
 	cachefiles_grab_object(object, cachefiles_obj_get_ioreq);
 
 	trace_cachefiles_read(object, file_inode(file), ki->iocb.ki_pos, len - skipped);
+	ki->submit_time = ktime_get_ns();
 	old_nofs = memalloc_nofs_save();
 	ret = cachefiles_inject_read_error();
 	if (ret == 0)
@@ -266,6 +270,8 @@ static void cachefiles_write_complete(struct kiocb *iocb, long ret)
 	if (ret < 0)
 		trace_cachefiles_io_error(object, inode, ret,
 					  cachefiles_trace_write_error);
+	else
+		fscache_count_write_latency(ki->submit_time);
 
 	atomic_long_sub(ki->b_writing, &object->volume->cache->b_writing);
 	set_bit(FSCACHE_COOKIE_HAVE_DATA, &object->cookie->flags);
@@ -325,6 +331,7 @@ int __cachefiles_write(struct cachefiles_object *object,
 	cachefiles_grab_object(object, cachefiles_obj_get_ioreq);
 
 	trace_cachefiles_write(object, file_inode(file), ki->iocb.ki_pos, len);
+	ki->submit_time = ktime_get_ns();
 	old_nofs = memalloc_nofs_save();
 	ret = cachefiles_inject_write_error();
 	if (ret == 0)
@@ -421,6 +428,14 @@ cachefiles_do_prepare_read(struct netfs_cache_resources *cres,
 	object = cachefiles_cres_object(cres);
 	cache = object->volume->cache;
 	cachefiles_begin_secure(cache, &saved_cred);
+
+	/* A request is typically split into several subrequests; if an earlier
+	 * one already found the data extent we're in, don't seek again.
+	 */
+	if (start >= cres->data_start && start < cres->data_end) {
+		to = cres->data_end;
+		goto have_data;
+	}
 retry:
 	off = cachefiles_inject_read_error();
 	if (off == 0)
@@ -459,6 +474,9 @@ cachefiles_do_prepare_read(struct netfs_cache_resources *cres,
 		goto out;
 	}
 
+	cres->data_start = start;
+	cres->data_end = to;
+have_data:
 	if (to < start + len) {
 		if (start + len >= i_size)
 			to = round_up(to, cache->bsize);
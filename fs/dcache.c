@@ -128,6 +128,31 @@ static DEFINE_PER_CPU(long, nr_dentry);
 static DEFINE_PER_CPU(long, nr_dentry_unused);
 static DEFINE_PER_CPU(long, nr_dentry_negative);
 
+/*
+ * Number of unused negative dentries a superblock may keep on its LRU
+ * before they are aged in the background; 0 means no limit.
+ */
+static unsigned long dentry_negative_limit __read_mostly;
+
+static inline void d_negative_inc(struct dentry *dentry)
+{
+	struct super_block *sb = dentry->d_sb;
+	unsigned long limit = READ_ONCE(dentry_negative_limit);
+
+	this_cpu_inc(nr_dentry_negative);
+	percpu_counter_inc(&sb->s_nr_dentry_negative);
+	if (unlikely(limit) &&
+	    percpu_counter_read_positive(&sb->s_nr_dentry_negative) > limit &&
+	    !work_pending(&sb->s_dentry_negative_work))
+		queue_work(system_unbound_wq, &sb->s_dentry_negative_work);
+}
+
+static inline void d_negative_dec(struct dentry *dentry)
+{
+	this_cpu_dec(nr_dentry_negative);
+	percpu_counter_dec(&dentry->d_sb->s_nr_dentry_negative);
+}
+
 #if defined(CONFIG_SYSCTL) && defined(CONFIG_PROC_FS)
 /* Statistics gathering. */
 static struct dentry_stat_t dentry_stat = {
@@ -191,6 +216,13 @@ static struct ctl_table fs_dcache_sysctls[] = {
 		.mode		= 0444,
 		.proc_handler	= proc_nr_dentry,
 	},
+	{
+		.procname	= "dentry-negative-limit",
+		.data		= &dentry_negative_limit,
+		.maxlen		= sizeof(dentry_negative_limit),
+		.mode		= 0644,
+		.proc_handler	= proc_doulongvec_minmax,
+	},
 };
 
 static int __init init_fs_dcache_sysctls(void)
@@ -360,7 +392,7 @@ static inline void __d_clear_type_and_inode(struct dentry *dentry)
 	 * d_lru is on another list.
 	 */
 	if ((flags & (DCACHE_LRU_LIST|DCACHE_SHRINK_LIST)) == DCACHE_LRU_LIST)
-		this_cpu_inc(nr_dentry_negative);
+		d_negative_inc(dentry);
 }
 
 static void dentry_free(struct dentry *dentry)
@@ -430,7 +462,7 @@ static void d_lru_add(struct dentry *dentry)
 	dentry->d_flags |= DCACHE_LRU_LIST;
 	this_cpu_inc(nr_dentry_unused);
 	if (d_is_negative(dentry))
-		this_cpu_inc(nr_dentry_negative);
+		d_negative_inc(dentry);
 	WARN_ON_ONCE(!list_lru_add_obj(
 			&dentry->d_sb->s_dentry_lru, &dentry->d_lru));
 }
@@ -441,7 +473,7 @@ static void d_lru_del(struct dentry *dentry)
 	dentry->d_flags &= ~DCACHE_LRU_LIST;
 	this_cpu_dec(nr_dentry_unused);
 	if (d_is_negative(dentry))
-		this_cpu_dec(nr_dentry_negative);
+		d_negative_dec(dentry);
 	WARN_ON_ONCE(!list_lru_del_obj(
 			&dentry->d_sb->s_dentry_lru, &dentry->d_lru));
 }
@@ -474,7 +506,7 @@ static void d_lru_isolate(struct list_lru_one *lru, struct dentry *dentry)
 	dentry->d_flags &= ~DCACHE_LRU_LIST;
 	this_cpu_dec(nr_dentry_unused);
 	if (d_is_negative(dentry))
-		this_cpu_dec(nr_dentry_negative);
+		d_negative_dec(dentry);
 	list_lru_isolate(lru, &dentry->d_lru);
 }
 
@@ -484,7 +516,7 @@ static void d_lru_shrink_move(struct list_lru_one *lru, struct dentry *dentry,
 	D_FLAG_VERIFY(dentry, DCACHE_LRU_LIST);
 	dentry->d_flags |= DCACHE_SHRINK_LIST;
 	if (d_is_negative(dentry))
-		this_cpu_dec(nr_dentry_negative);
+		d_negative_dec(dentry);
 	list_lru_isolate_move(lru, &dentry->d_lru, list);
 }
 
@@ -1182,6 +1214,80 @@ static enum lru_status dentry_lru_isolate_shrink(struct list_head *item,
 }
 
 
+static enum lru_status dentry_lru_isolate_negative(struct list_head *item,
+		struct list_lru_one *lru, spinlock_t *lru_lock, void *arg)
+{
+	struct list_head *freeable = arg;
+	struct dentry	*dentry = container_of(item, struct dentry, d_lru);
+
+	if (!spin_trylock(&dentry->d_lock))
+		return LRU_SKIP;
+
+	if (dentry->d_lockref.count) {
+		d_lru_isolate(lru, dentry);
+		spin_unlock(&dentry->d_lock);
+		return LRU_REMOVED;
+	}
+
+	/*
+	 * Positive dentries are rotated out of the way so that the next batch
+	 * of the walk gets to see new entries; negative ones that were used
+	 * since the last pass get another chance.
+	 */
+	if (!d_is_negative(dentry)) {
+		spin_unlock(&dentry->d_lock);
+		return LRU_ROTATE;
+	}
+	if (dentry->d_flags & DCACHE_REFERENCED) {
+		dentry->d_flags &= ~DCACHE_REFERENCED;
+		spin_unlock(&dentry->d_lock);
+		return LRU_ROTATE;
+	}
+
+	d_lru_shrink_move(lru, dentry, freeable);
+	spin_unlock(&dentry->d_lock);
+
+	return LRU_REMOVED;
+}
+
+/*
+ * Age the negative dentries of a superblock that went over
+ * dentry_negative_limit, down to 7/8 of the limit so that the worker isn't
+ * kicked again by the next few negative lookups. At most one pass over the
+ * LRU is done per run.
+ */
+void d_negative_age_work(struct work_struct *work)
+{
+	struct super_block *sb = container_of(work, struct super_block,
+					      s_dentry_negative_work);
+	unsigned long limit = READ_ONCE(dentry_negative_limit);
+	unsigned long walked = 0, total;
+	long target;
+
+	if (!limit)
+		return;
+	/* Umount holds s_umount exclusively and shrinks everything anyway */
+	if (!down_read_trylock(&sb->s_umount))
+		return;
+	if (!(sb->s_flags & SB_ACTIVE))
+		goto out;
+
+	target = limit - limit / 8;
+	total = list_lru_count(&sb->s_dentry_lru);
+	while (walked < total &&
+	       percpu_counter_sum(&sb->s_nr_dentry_negative) > target) {
+		LIST_HEAD(dispose);
+
+		walked += 1024;
+		list_lru_walk(&sb->s_dentry_lru, dentry_lru_isolate_negative,
+			      &dispose, 1024);
+		shrink_dentry_list(&dispose);
+		cond_resched();
+	}
+out:
+	up_read(&sb->s_umount);
+}
+
 /**
  * shrink_dcache_sb - shrink dcache for a superblock
  * @sb: superblock
@@ -1853,7 +1959,7 @@ static void __d_instantiate(struct dentry *dentry, struct inode *inode)
 	 */
 	if ((dentry->d_flags &
 	     (DCACHE_LRU_LIST|DCACHE_SHRINK_LIST)) == DCACHE_LRU_LIST)
-		this_cpu_dec(nr_dentry_negative);
+		d_negative_dec(dentry);
 	hlist_add_head(&dentry->d_u.d_alias, &inode->i_dentry);
 	raw_write_seqcount_begin(&dentry->d_seq);
 	__d_set_inode_and_type(dentry, inode, add_flags);
@@ -129,6 +129,10 @@ struct erofs_sb_info {
 	struct inode *managed_cache;
 
 	struct erofs_sb_lz4_info lz4;
+
+	/* pclusters decompressed and time spent on it, per algorithm */
+	atomic64_t decompress_count[Z_EROFS_COMPRESSION_MAX];
+	atomic64_t decompress_ns[Z_EROFS_COMPRESSION_MAX];
 #endif	/* CONFIG_EROFS_FS_ZIP */
 	struct inode *packed_inode;
 	struct erofs_dev_context *devs;
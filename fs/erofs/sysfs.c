@@ -7,11 +7,13 @@
 #include <linux/kobject.h>
 
 #include "internal.h"
+#include "compress.h"
 
 enum {
 	attr_feature,
 	attr_pointer_ui,
 	attr_pointer_bool,
+	attr_decompress_stats,
 };
 
 enum {
@@ -57,11 +59,13 @@ static struct erofs_attr erofs_attr_##_name = {			\
 
 #ifdef CONFIG_EROFS_FS_ZIP
 EROFS_ATTR_RW_UI(sync_decompress, erofs_mount_opts);
+EROFS_ATTR_FUNC(decompress_stats, 0444);
 #endif
 
 static struct attribute *erofs_attrs[] = {
 #ifdef CONFIG_EROFS_FS_ZIP
 	ATTR_LIST(sync_decompress),
+	ATTR_LIST(decompress_stats),
 #endif
 	NULL,
 };
@@ -123,6 +127,24 @@ static ssize_t erofs_attr_show(struct kobject *kobj,
 		if (!ptr)
 			return 0;
 		return sysfs_emit(buf, "%d\n", *(bool *)ptr);
+#ifdef CONFIG_EROFS_FS_ZIP
+	case attr_decompress_stats: {
+		/* algorithm, pclusters decompressed, total time in us */
+		int i, len = 0;
+
+		for (i = 0; i < Z_EROFS_COMPRESSION_MAX; ++i) {
+			if (!(sbi->available_compr_algs & BIT(i)) ||
+			    !erofs_decompressors[i].name)
+				continue;
+			len += sysfs_emit_at(buf, len, "%s %llu %llu\n",
+				erofs_decompressors[i].name,
+				atomic64_read(&sbi->decompress_count[i]),
+				div_u64(atomic64_read(&sbi->decompress_ns[i]),
+					NSEC_PER_USEC));
+		}
+		return len;
+	}
+#endif
 	}
 	return 0;
 }
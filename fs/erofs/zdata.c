@@ -1256,7 +1256,9 @@ static int z_erofs_decompress_pcluster(struct z_erofs_decompress_backend *be,
 	err2 = z_erofs_parse_in_bvecs(be, &overlapped);
 	if (err2)
 		err = err2;
-	if (!err)
+	if (!err) {
+		ktime_t start = ktime_get();
+
 		err = decomp->decompress(&(struct z_erofs_decompress_req) {
 					.sb = be->sb,
 					.in = be->compressed_pages,
@@ -1274,6 +1276,13 @@ static int z_erofs_decompress_pcluster(struct z_erofs_decompress_backend *be,
 						GFP_NOWAIT | __GFP_NORETRY
 				 }, be->pagepool);
 
+		if (pcl->algorithmformat < Z_EROFS_COMPRESSION_MAX) {
+			atomic64_inc(&sbi->decompress_count[pcl->algorithmformat]);
+			atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+				     &sbi->decompress_ns[pcl->algorithmformat]);
+		}
+	}
+
 	/* must handle all compressed pages before actual file pages */
 	if (z_erofs_is_inline_pcluster(pcl)) {
 		page = pcl->compressed_bvecs[0].page;
@@ -1350,6 +1359,77 @@ static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 	}
 }
 
+static void z_erofs_decompress_run_work(struct work_struct *work)
+{
+	struct z_erofs_decompressqueue *q =
+		container_of(work, struct z_erofs_decompressqueue, u.work);
+	struct page *pagepool = NULL;
+
+	z_erofs_decompress_queue(q, &pagepool);
+	erofs_release_pages(&pagepool);
+	kvfree(q);
+}
+
+/*
+ * Long queues are cut into runs of at least Z_EROFS_SPLIT_PCLUSTERS pclusters,
+ * and all runs but the first one are handed to other erofs workers so that up
+ * to Z_EROFS_MAX_SPLIT_WORKERS CPUs decompress the queue in parallel.  The
+ * first run stays in @io for the caller.
+ */
+#define Z_EROFS_SPLIT_PCLUSTERS		4
+#define Z_EROFS_MAX_SPLIT_WORKERS	8
+
+static void z_erofs_decompress_split(struct z_erofs_decompressqueue *io)
+{
+	struct z_erofs_decompressqueue *qs[Z_EROFS_MAX_SPLIT_WORKERS - 1];
+	z_erofs_next_pcluster_t owned = io->head;
+	struct z_erofs_pcluster *pcl;
+	unsigned int nr = 0, nrq, run, i, j;
+
+	while (owned != Z_EROFS_PCLUSTER_TAIL) {
+		owned = READ_ONCE(container_of(owned,
+				struct z_erofs_pcluster, next)->next);
+		++nr;
+	}
+
+	nrq = min3(nr / Z_EROFS_SPLIT_PCLUSTERS, num_online_cpus(),
+		   (unsigned int)Z_EROFS_MAX_SPLIT_WORKERS);
+	for (j = 0; j + 1 < nrq; ++j) {
+		qs[j] = kvzalloc(sizeof(*qs[j]), GFP_NOWAIT | __GFP_NOWARN);
+		if (!qs[j])
+			break;
+	}
+	nrq = j;
+	if (!nrq)
+		return;
+	run = DIV_ROUND_UP(nr, nrq + 1);
+
+	/*
+	 * Cut the whole chain before queueing anything, a worker resets the
+	 * ->next of each pcluster it has decompressed.
+	 */
+	owned = io->head;
+	for (i = 1, j = 0; owned != Z_EROFS_PCLUSTER_TAIL; ++i) {
+		pcl = container_of(owned, struct z_erofs_pcluster, next);
+		owned = READ_ONCE(pcl->next);
+		if (i % run || owned == Z_EROFS_PCLUSTER_TAIL)
+			continue;
+		WRITE_ONCE(pcl->next, Z_EROFS_PCLUSTER_TAIL);
+		qs[j]->sb = io->sb;
+		qs[j]->head = owned;
+		qs[j]->eio = io->eio;
+		INIT_WORK(&qs[j]->u.work, z_erofs_decompress_run_work);
+		++j;
+	}
+
+	for (i = 0; i < nrq; ++i) {
+		if (i < j)
+			queue_work(z_erofs_workqueue, &qs[i]->u.work);
+		else
+			kvfree(qs[i]);
+	}
+}
+
 static void z_erofs_decompressqueue_work(struct work_struct *work)
 {
 	struct z_erofs_decompressqueue *bgq =
@@ -1357,6 +1437,7 @@ static void z_erofs_decompressqueue_work(struct work_struct *work)
 	struct page *pagepool = NULL;
 
 	DBG_BUGON(bgq->head == Z_EROFS_PCLUSTER_TAIL);
+	z_erofs_decompress_split(bgq);
 	z_erofs_decompress_queue(bgq, &pagepool);
 	erofs_release_pages(&pagepool);
 	kvfree(bgq);
@@ -1732,6 +1813,7 @@ static void z_erofs_runqueue(struct z_erofs_decompress_frontend *f,
 	wait_for_completion_io(&io[JQ_SUBMIT].u.done);
 
 	/* handle synchronous decompress queue in the caller context */
+	z_erofs_decompress_split(&io[JQ_SUBMIT]);
 	z_erofs_decompress_queue(&io[JQ_SUBMIT], &f->pagepool);
 }
 
@@ -42,22 +42,23 @@
 
 /*
  * LOCKING:
- * There are three level of locking required by epoll :
+ * There are two level of locking required by epoll :
  *
  * 1) epnested_mutex (mutex)
  * 2) ep->mtx (mutex)
- * 3) ep->lock (rwlock)
  *
- * The acquire order is the one listed above, from 1 to 3.
- * We need a rwlock (ep->lock) because we manipulate objects
- * from inside the poll callback, that might be triggered from
- * a wake_up() that in turn might be called from IRQ context.
- * So we can't sleep inside the poll callback and hence we need
- * a spinlock. During the event transfer loop (from kernel to
+ * The acquire order is the one listed above, from 1 to 2.
+ * The poll callback, that might be triggered from a wake_up() that in
+ * turn might be called from IRQ context, takes no epoll lock at all: it
+ * chains the ready item on a per-CPU chain of the eventpoll, and the
+ * chains are moved to the ready list by whoever holds ep->mtx (see
+ * ep_merge_ready()). Wakeups from many CPUs thus neither share a lock
+ * nor a list head. During the event transfer loop (from kernel to
  * user space) we could end up sleeping due a copy_to_user(), so
  * we need a lock that will allow us to sleep. This lock is a
  * mutex (ep->mtx). It is acquired during the event transfer loop,
  * during epoll_ctl(EPOLL_CTL_DEL) and during eventpoll_release_file().
+ * It also protects the ready list, which is only read locklessly.
  * The epnested_mutex is acquired when inserting an epoll fd onto another
  * epoll fd. We do this so that we walk the epoll tree and ensure that this
  * insertion does not create a cycle of epoll file descriptors, which
@@ -75,7 +76,7 @@
  * of epoll file descriptors, we use the current recursion depth as
  * the lockdep subkey.
  * It is possible to drop the "ep->mtx" and to use the global
- * mutex "epnested_mutex" (together with "ep->lock") to have it working,
+ * mutex "epnested_mutex" to have it working,
  * but having "ep->mtx" will make the interface more scalable.
  * Events that require holding "epnested_mutex" are very rare, while for
  * normal operations the epoll private "ep->mtx" will guarantee
@@ -140,8 +141,8 @@ struct epitem {
 	struct list_head rdllink;
 
 	/*
-	 * Works together "struct eventpoll"->ovflist in keeping the
-	 * single linked chain of items.
+	 * Links the item on a "struct eventpoll"->pcpu_ready chain,
+	 * EP_UNACTIVE_PTR while it is not chained.
 	 */
 	struct epitem *next;
 
@@ -191,21 +192,22 @@ struct eventpoll {
 	/* Wait queue used by file->poll() */
 	wait_queue_head_t poll_wait;
 
-	/* List of ready file descriptors */
+	/* List of ready file descriptors, protected by mtx */
 	struct list_head rdllist;
 
-	/* Lock which protects rdllist and ovflist */
-	rwlock_t lock;
-
 	/* RB tree root used to store monitored fd structs */
 	struct rb_root_cached rbr;
 
 	/*
-	 * This is a single linked list that chains all the "struct epitem" that
-	 * happened while transferring ready events to userspace w/out
-	 * holding ->lock.
+	 * Per-CPU single linked chains of the "struct epitem" that the poll
+	 * callback found ready and that are not on rdllist yet.  The callback
+	 * only pushes to the chain of the CPU it runs on, ep_merge_ready()
+	 * steals them all.
 	 */
-	struct epitem *ovflist;
+	struct epitem * __percpu *pcpu_ready;
+
+	/* Set when one of the pcpu_ready chains may not be empty */
+	bool ready_pending;
 
 	/* wakeup_source used when ep_send_events or __ep_eventpoll_poll is running */
 	struct wakeup_source *ws;
@@ -389,7 +391,7 @@ static inline struct epitem *ep_item_from_wait(wait_queue_entry_t *p)
 static inline int ep_events_available(struct eventpoll *ep)
 {
 	return !list_empty_careful(&ep->rdllist) ||
-		READ_ONCE(ep->ovflist) != EP_UNACTIVE_PTR;
+		READ_ONCE(ep->ready_pending);
 }
 
 #ifdef CONFIG_NET_RX_BUSY_POLL
@@ -455,12 +457,26 @@ static bool ep_busy_loop(struct eventpoll *ep, int nonblock)
 		 * it back in when we have moved a socket with a valid NAPI
 		 * ID onto the ready list.
 		 */
+		if (prefer_busy_poll)
+			napi_resume_irqs(napi_id);
 		ep->napi_id = 0;
 		return false;
 	}
 	return false;
 }
 
+/*
+ * The application found events while preferring busy polling, so keep the
+ * device IRQs suspended for as long as it keeps coming back for more.
+ */
+static void ep_suspend_napi_irqs(struct eventpoll *ep)
+{
+	unsigned int napi_id = READ_ONCE(ep->napi_id);
+
+	if (napi_id >= MIN_NAPI_ID && READ_ONCE(ep->prefer_busy_poll))
+		napi_suspend_irqs(napi_id);
+}
+
 /*
  * Set epoll busy poll NAPI ID from sk.
  */
@@ -545,6 +561,10 @@ static inline bool ep_busy_loop(struct eventpoll *ep, int nonblock)
 	return false;
 }
 
+static inline void ep_suspend_napi_irqs(struct eventpoll *ep)
+{
+}
+
 static inline void ep_set_busy_poll_napi_id(struct epitem *epi)
 {
 }
@@ -697,6 +717,51 @@ static inline void ep_pm_stay_awake_rcu(struct epitem *epi)
 }
 
 
+/*
+ * Move the items that the poll callback chained on the per-CPU ready chains
+ * to the ready list. Must be called with "mtx" held.
+ */
+static void ep_merge_ready(struct eventpoll *ep)
+{
+	struct epitem *epi, *nepi;
+	LIST_HEAD(chain);
+	int cpu;
+
+	if (!READ_ONCE(ep->ready_pending))
+		return;
+
+	/*
+	 * Clear the flag before stealing the chains, so that an item chained
+	 * behind our back sets it again. Pairs with the full barrier of the
+	 * cmpxchg() publishing an item in ep_chain_ready().
+	 */
+	WRITE_ONCE(ep->ready_pending, false);
+	smp_mb();
+
+	for_each_possible_cpu(cpu) {
+		nepi = xchg(per_cpu_ptr(ep->pcpu_ready, cpu), NULL);
+		for (; (epi = nepi) != NULL; ) {
+			nepi = READ_ONCE(epi->next);
+			/* From now on the poll callback may chain epi again */
+			WRITE_ONCE(epi->next, EP_UNACTIVE_PTR);
+			/*
+			 * Items can be chained while they are already on the
+			 * ready list or on the txlist of a running scan, the
+			 * latter puts them back in ep_done_scan().
+			 */
+			if (!ep_is_linked(epi)) {
+				/*
+				 * The chains are LIFO, so we have to reverse
+				 * them in order to keep in FIFO.
+				 */
+				list_add(&epi->rdllink, &chain);
+				ep_pm_stay_awake(epi);
+			}
+		}
+		list_splice_tail_init(&chain, &ep->rdllist);
+	}
+}
+
 /*
  * ep->mutex needs to be held because we could be hit by
  * eventpoll_release_file() and epoll_ctl().
@@ -705,53 +770,24 @@ static void ep_start_scan(struct eventpoll *ep, struct list_head *txlist)
 {
 	/*
 	 * Steal the ready list, and re-init the original one to the
-	 * empty list. Also, set ep->ovflist to NULL so that events
-	 * happening while looping w/out locks, are not lost. We cannot
-	 * have the poll callback to queue directly on ep->rdllist,
-	 * because we want the "sproc" callback to be able to do it
-	 * in a lockless way.
+	 * empty list. Events happening while looping w/out locks are
+	 * chained per CPU by the poll callback, as always, and are not
+	 * lost: ep_done_scan() collects them.
 	 */
 	lockdep_assert_irqs_enabled();
-	write_lock_irq(&ep->lock);
+	ep_merge_ready(ep);
 	list_splice_init(&ep->rdllist, txlist);
-	WRITE_ONCE(ep->ovflist, NULL);
-	write_unlock_irq(&ep->lock);
 }
 
 static void ep_done_scan(struct eventpoll *ep,
 			 struct list_head *txlist)
 {
-	struct epitem *epi, *nepi;
-
-	write_lock_irq(&ep->lock);
 	/*
 	 * During the time we spent inside the "sproc" callback, some
 	 * other events might have been queued by the poll callback.
 	 * We re-insert them inside the main ready-list here.
 	 */
-	for (nepi = READ_ONCE(ep->ovflist); (epi = nepi) != NULL;
-	     nepi = epi->next, epi->next = EP_UNACTIVE_PTR) {
-		/*
-		 * We need to check if the item is already in the list.
-		 * During the "sproc" callback execution time, items are
-		 * queued into ->ovflist but the "txlist" might already
-		 * contain them, and the list_splice() below takes care of them.
-		 */
-		if (!ep_is_linked(epi)) {
-			/*
-			 * ->ovflist is LIFO, so we have to reverse it in order
-			 * to keep in FIFO.
-			 */
-			list_add(&epi->rdllink, &ep->rdllist);
-			ep_pm_stay_awake(epi);
-		}
-	}
-	/*
-	 * We need to set back ep->ovflist to EP_UNACTIVE_PTR, so that after
-	 * releasing the lock, events will be queued in the normal way inside
-	 * ep->rdllist.
-	 */
-	WRITE_ONCE(ep->ovflist, EP_UNACTIVE_PTR);
+	ep_merge_ready(ep);
 
 	/*
 	 * Quickly re-inject items left on "txlist".
@@ -760,11 +796,9 @@ static void ep_done_scan(struct eventpoll *ep,
 	__pm_relax(ep->ws);
 
 	if (!list_empty(&ep->rdllist)) {
-		if (waitqueue_active(&ep->wq))
+		if (wq_has_sleeper(&ep->wq))
 			wake_up(&ep->wq);
 	}
-
-	write_unlock_irq(&ep->lock);
 }
 
 static void ep_get(struct eventpoll *ep)
@@ -787,6 +821,7 @@ static bool ep_refcount_dec_and_test(struct eventpoll *ep)
 static void ep_free(struct eventpoll *ep)
 {
 	mutex_destroy(&ep->mtx);
+	free_percpu(ep->pcpu_ready);
 	free_uid(ep->user);
 	wakeup_source_unregister(ep->ws);
 	kfree(ep);
@@ -837,10 +872,14 @@ static bool __ep_remove(struct eventpoll *ep, struct epitem *epi, bool force)
 
 	rb_erase_cached(&epi->rbn, &ep->rbr);
 
-	write_lock_irq(&ep->lock);
+	/*
+	 * No poll callback can run for epi anymore, but an earlier one may
+	 * have left it on a per-CPU ready chain.
+	 */
+	if (READ_ONCE(epi->next) != EP_UNACTIVE_PTR)
+		ep_merge_ready(ep);
 	if (ep_is_linked(epi))
 		list_del_init(&epi->rdllink);
-	write_unlock_irq(&ep->lock);
 
 	wakeup_source_unregister(ep_wakeup_source(epi));
 	/*
@@ -953,6 +992,8 @@ static __poll_t __ep_eventpoll_poll(struct file *file, poll_table *wait, int dep
 
 	/* Insert inside our poll wait queue */
 	poll_wait(file, &ep->poll_wait, wait);
+	/* Pairs with smp_mb() in ep_poll_callback() */
+	smp_mb();
 
 	/*
 	 * Proceed to find out if wanted events are really available inside
@@ -1122,13 +1163,17 @@ static int ep_alloc(struct eventpoll **pep)
 	if (unlikely(!ep))
 		return -ENOMEM;
 
+	ep->pcpu_ready = alloc_percpu(struct epitem *);
+	if (unlikely(!ep->pcpu_ready)) {
+		kfree(ep);
+		return -ENOMEM;
+	}
+
 	mutex_init(&ep->mtx);
-	rwlock_init(&ep->lock);
 	init_waitqueue_head(&ep->wq);
 	init_waitqueue_head(&ep->poll_wait);
 	INIT_LIST_HEAD(&ep->rdllist);
 	ep->rbr = RB_ROOT_CACHED;
-	ep->ovflist = EP_UNACTIVE_PTR;
 	ep->user = get_current_user();
 	refcount_set(&ep->refcount, 1);
 
@@ -1211,78 +1256,34 @@ struct file *get_epoll_tfile_raw_ptr(struct file *file, int tfd,
 #endif /* CONFIG_KCMP */
 
 /*
- * Adds a new entry to the tail of the list in a lockless way, i.e.
- * multiple CPUs are allowed to call this function concurrently.
- *
- * Beware: it is necessary to prevent any other modifications of the
- *         existing list until all changes are completed, in other words
- *         concurrent list_add_tail_lockless() calls should be protected
- *         with a read lock, where write lock acts as a barrier which
- *         makes sure all list_add_tail_lockless() calls are fully
- *         completed.
- *
- *        Also an element can be locklessly added to the list only in one
- *        direction i.e. either to the tail or to the head, otherwise
- *        concurrent access will corrupt the list.
- *
- * Return: %false if element has been already added to the list, %true
- * otherwise.
- */
-static inline bool list_add_tail_lockless(struct list_head *new,
-					  struct list_head *head)
-{
-	struct list_head *prev;
-
-	/*
-	 * This is simple 'new->next = head' operation, but cmpxchg()
-	 * is used in order to detect that same element has been just
-	 * added to the list from another CPU: the winner observes
-	 * new->next == new.
-	 */
-	if (!try_cmpxchg(&new->next, &new, head))
-		return false;
-
-	/*
-	 * Initially ->next of a new element must be updated with the head
-	 * (we are inserting to the tail) and only then pointers are atomically
-	 * exchanged.  XCHG guarantees memory ordering, thus ->next should be
-	 * updated before pointers are actually swapped and pointers are
-	 * swapped before prev->next is updated.
-	 */
-
-	prev = xchg(&head->prev, new);
-
-	/*
-	 * It is safe to modify prev->next and new->prev, because a new element
-	 * is added only to the tail and new->next is updated before XCHG.
-	 */
-
-	prev->next = new;
-	new->prev = prev;
-
-	return true;
-}
-
-/*
- * Chains a new epi entry to the tail of the ep->ovflist in a lockless way,
- * i.e. multiple CPUs are allowed to call this function concurrently.
+ * Chains a new epi entry to the ready chain of the current CPU in a lockless
+ * way, i.e. multiple CPUs are allowed to call this function concurrently,
+ * also for the same epi.
  *
  * Return: %false if epi element has been already chained, %true otherwise.
  */
-static inline bool chain_epi_lockless(struct epitem *epi)
+static inline bool ep_chain_ready(struct epitem *epi)
 {
-	struct eventpoll *ep = epi->ep;
+	/* Any CPU's chain is fine, the local one just avoids bouncing */
+	struct epitem **head = raw_cpu_ptr(epi->ep->pcpu_ready);
+	struct epitem *first;
 
 	/* Fast preliminary check */
-	if (epi->next != EP_UNACTIVE_PTR)
+	if (READ_ONCE(epi->next) != EP_UNACTIVE_PTR)
 		return false;
 
 	/* Check that the same epi has not been just chained from another CPU */
 	if (cmpxchg(&epi->next, EP_UNACTIVE_PTR, NULL) != EP_UNACTIVE_PTR)
 		return false;
 
-	/* Atomically exchange tail */
-	epi->next = xchg(&ep->ovflist, epi);
+	/*
+	 * Only ep_merge_ready() competes for the head of our chain. The
+	 * successful cmpxchg() orders epi->next before publishing epi.
+	 */
+	first = READ_ONCE(*head);
+	do {
+		WRITE_ONCE(epi->next, first);
+	} while (!try_cmpxchg(head, &first, epi));
 
 	return true;
 }
@@ -1292,11 +1293,10 @@ static inline bool chain_epi_lockless(struct epitem *epi)
  * mechanism. It is called by the stored file descriptors when they
  * have events to report.
  *
- * This callback takes a read lock in order not to contend with concurrent
- * events from another file descriptor, thus all modifications to ->rdllist
- * or ->ovflist are lockless.  Read lock is paired with the write lock from
- * ep_start/done_scan(), which stops all list modifications and guarantees
- * that lists state is seen correctly.
+ * This callback takes no lock, in order not to contend with concurrent
+ * events from other file descriptors: the item is pushed to the per-CPU
+ * ready chain, which ep_merge_ready() moves to ->rdllist under ep->mtx,
+ * whether events are currently being transferred to userspace or not.
  *
  * Another thing worth to mention is that ep_poll_callback() can be called
  * concurrently for the same @epi from different CPUs if poll table was inited
@@ -1311,11 +1311,8 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 	struct epitem *epi = ep_item_from_wait(wait);
 	struct eventpoll *ep = epi->ep;
 	__poll_t pollflags = key_to_poll(key);
-	unsigned long flags;
 	int ewake = 0;
 
-	read_lock_irqsave(&ep->lock, flags);
-
 	ep_set_busy_poll_napi_id(epi);
 
 	/*
@@ -1325,7 +1322,7 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 	 * until the next EPOLL_CTL_MOD will be issued.
 	 */
 	if (!(epi->event.events & ~EP_PRIVATE_BITS))
-		goto out_unlock;
+		goto out;
 
 	/*
 	 * Check the events coming with the callback. At this stage, not
@@ -1334,22 +1331,20 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 	 * test for "key" != NULL before the event match test.
 	 */
 	if (pollflags && !(pollflags & epi->event.events))
-		goto out_unlock;
+		goto out;
+
+	if (ep_chain_ready(epi)) {
+		ep_pm_stay_awake_rcu(epi);
+		if (!READ_ONCE(ep->ready_pending))
+			WRITE_ONCE(ep->ready_pending, true);
+	}
 
 	/*
-	 * If we are transferring events to userspace, we can hold no locks
-	 * (because we're accessing user memory, and because of linux f_op->poll()
-	 * semantics). All the events that happen during that period of time are
-	 * chained in ep->ovflist and requeued later on.
+	 * Either the waiters see the chained item, or we see them: pairs with
+	 * set_current_state() after queueing on ep->wq in ep_poll() and with
+	 * the barrier after poll_wait() in __ep_eventpoll_poll().
 	 */
-	if (READ_ONCE(ep->ovflist) != EP_UNACTIVE_PTR) {
-		if (chain_epi_lockless(epi))
-			ep_pm_stay_awake_rcu(epi);
-	} else if (!ep_is_linked(epi)) {
-		/* In the usual case, add event to ready list. */
-		if (list_add_tail_lockless(&epi->rdllink, &ep->rdllist))
-			ep_pm_stay_awake_rcu(epi);
-	}
+	smp_mb();
 
 	/*
 	 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
@@ -1377,10 +1372,7 @@ static int ep_poll_callback(wait_queue_entry_t *wait, unsigned mode, int sync, v
 	if (waitqueue_active(&ep->poll_wait))
 		pwake++;
 
-out_unlock:
-	read_unlock_irqrestore(&ep->lock, flags);
-
-	/* We have to call this outside the lock */
+out:
 	if (pwake)
 		ep_poll_safewake(ep, epi, pollflags & EPOLL_URING_WAKE);
 
@@ -1711,9 +1703,6 @@ static int ep_insert(struct eventpoll *ep, const struct epoll_event *event,
 		return -ENOMEM;
 	}
 
-	/* We have to drop the new item inside our item list to keep track of it */
-	write_lock_irq(&ep->lock);
-
 	/* record NAPI ID of new item if present */
 	ep_set_busy_poll_napi_id(epi);
 
@@ -1723,15 +1712,12 @@ static int ep_insert(struct eventpoll *ep, const struct epoll_event *event,
 		ep_pm_stay_awake(epi);
 
 		/* Notify waiting tasks that events are available */
-		if (waitqueue_active(&ep->wq))
+		if (wq_has_sleeper(&ep->wq))
 			wake_up(&ep->wq);
 		if (waitqueue_active(&ep->poll_wait))
 			pwake++;
 	}
 
-	write_unlock_irq(&ep->lock);
-
-	/* We have to call this outside the lock */
 	if (pwake)
 		ep_poll_safewake(ep, NULL, 0);
 
@@ -1772,9 +1758,8 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi,
 	 * 1) Flush epi changes above to other CPUs.  This ensures
 	 *    we do not miss events from ep_poll_callback if an
 	 *    event occurs immediately after we call f_op->poll().
-	 *    We need this because we did not take ep->lock while
-	 *    changing epi above (but ep_poll_callback does take
-	 *    ep->lock).
+	 *    We need this because neither we nor ep_poll_callback
+	 *    take a lock around epi->event.
 	 *
 	 * 2) We also need to ensure we do not miss _past_ events
 	 *    when calling f_op->poll().  This barrier also
@@ -1792,22 +1777,17 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi,
 	 * If the item is "hot" and it is not registered inside the ready
 	 * list, push it inside.
 	 */
-	if (ep_item_poll(epi, &pt, 1)) {
-		write_lock_irq(&ep->lock);
-		if (!ep_is_linked(epi)) {
-			list_add_tail(&epi->rdllink, &ep->rdllist);
-			ep_pm_stay_awake(epi);
+	if (ep_item_poll(epi, &pt, 1) && !ep_is_linked(epi)) {
+		list_add_tail(&epi->rdllink, &ep->rdllist);
+		ep_pm_stay_awake(epi);
 
-			/* Notify waiting tasks that events are available */
-			if (waitqueue_active(&ep->wq))
-				wake_up(&ep->wq);
-			if (waitqueue_active(&ep->poll_wait))
-				pwake++;
-		}
-		write_unlock_irq(&ep->lock);
+		/* Notify waiting tasks that events are available */
+		if (wq_has_sleeper(&ep->wq))
+			wake_up(&ep->wq);
+		if (waitqueue_active(&ep->poll_wait))
+			pwake++;
 	}
 
-	/* We have to call this outside the lock */
 	if (pwake)
 		ep_poll_safewake(ep, NULL, 0);
 
@@ -1894,7 +1874,8 @@ static int ep_send_events(struct eventpoll *ep,
 			 * into ep->rdllist besides us. The epoll_ctl()
 			 * callers are locked out by
 			 * ep_send_events() holding "mtx" and the
-			 * poll callback will queue them in ep->ovflist.
+			 * poll callback only queues on the per-CPU
+			 * ready chains.
 			 */
 			list_add_tail(&epi->rdllink, &ep->rdllist);
 			ep_pm_stay_awake(epi);
@@ -2003,8 +1984,11 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 			 * trying again in search of more luck.
 			 */
 			res = ep_send_events(ep, events, maxevents);
-			if (res)
+			if (res) {
+				if (res > 0)
+					ep_suspend_napi_irqs(ep);
 				return res;
+			}
 		}
 
 		if (timed_out)
@@ -2025,8 +2009,7 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 		 * chance to harvest new event. Otherwise wakeup can be
 		 * lost. This is also good performance-wise, because on
 		 * normal wakeup path no need to call __remove_wait_queue()
-		 * explicitly, thus ep->lock is not taken, which halts the
-		 * event delivery.
+		 * explicitly, thus ep->wq.lock is not taken once more.
 		 *
 		 * In fact, we now use an even more aggressive function that
 		 * unconditionally removes, because we don't reuse the wait
@@ -2037,26 +2020,19 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 		init_wait(&wait);
 		wait.func = ep_autoremove_wake_function;
 
-		write_lock_irq(&ep->lock);
+		spin_lock_irq(&ep->wq.lock);
+		__add_wait_queue_exclusive(&ep->wq, &wait);
 		/*
-		 * Barrierless variant, waitqueue_active() is called under
-		 * the same lock on wakeup ep_poll_callback() side, so it
-		 * is safe to avoid an explicit barrier.
-		 */
-		__set_current_state(TASK_INTERRUPTIBLE);
-
-		/*
-		 * Do the final check under the lock. ep_start/done_scan()
-		 * plays with two lists (->rdllist and ->ovflist) and there
-		 * is always a race when both lists are empty for short
-		 * period of time although events are pending, so lock is
-		 * important.
+		 * The poll callback takes no lock, so do the final check
+		 * only once we are on the wait queue: set_current_state()
+		 * orders the two and pairs with the barrier between making
+		 * an item ready and waitqueue_active() on the wakeup side.
 		 */
+		set_current_state(TASK_INTERRUPTIBLE);
 		eavail = ep_events_available(ep);
-		if (!eavail)
-			__add_wait_queue_exclusive(&ep->wq, &wait);
-
-		write_unlock_irq(&ep->lock);
+		if (eavail)
+			list_del_init(&wait.entry);
+		spin_unlock_irq(&ep->wq.lock);
 
 		if (!eavail)
 			timed_out = !schedule_hrtimeout_range(to, slack,
@@ -2071,7 +2047,7 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 		eavail = 1;
 
 		if (!list_empty_careful(&wait.entry)) {
-			write_lock_irq(&ep->lock);
+			spin_lock_irq(&ep->wq.lock);
 			/*
 			 * If the thread timed out and is not on the wait queue,
 			 * it means that the thread was woken up after its
@@ -2082,7 +2058,7 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 			if (timed_out)
 				eavail = list_empty(&wait.entry);
 			__remove_wait_queue(&ep->wq, &wait);
-			write_unlock_irq(&ep->lock);
+			spin_unlock_irq(&ep->wq.lock);
 		}
 	}
 }
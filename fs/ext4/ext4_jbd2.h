@@ -410,6 +410,15 @@ static inline int ext4_journal_blocks_per_page(struct inode *inode)
 	return 0;
 }
 
+/* Blocks in the largest folio the page cache may use for @inode */
+static inline int ext4_journal_blocks_per_folio(struct inode *inode)
+{
+	if (EXT4_JOURNAL(inode) != NULL)
+		return mapping_max_folio_size(inode->i_mapping) >>
+			inode->i_blkbits;
+	return 0;
+}
+
 static inline int ext4_journal_force_commit(journal_t *journal)
 {
 	if (journal)
@@ -600,6 +600,14 @@ ext4_move_extents(struct file *o_filp, struct file *d_filp, __u64 orig_blk,
 		return -EOPNOTSUPP;
 	}
 
+	/* The folio swapping below only knows about single page folios */
+	if (mapping_large_folio_support(orig_inode->i_mapping) ||
+	    mapping_large_folio_support(donor_inode->i_mapping)) {
+		ext4_msg(orig_inode->i_sb, KERN_ERR,
+			 "Online defrag not supported with large folios");
+		return -EOPNOTSUPP;
+	}
+
 	/* Protect orig and donor inodes against a truncate */
 	lock_two_nondirectories(orig_inode, donor_inode);
 
@@ -519,6 +519,11 @@ static int stat_show(struct seq_file *s, void *v)
 			   si->gc_call_count[BACKGROUND] +
 			   si->gc_call_count[FOREGROUND],
 			   si->gc_call_count[BACKGROUND]);
+		seq_printf(s, "  - time : %u ms (BG: %u ms), peak: %u ms (BG: %u ms)\n",
+			   si->gc_time_ms[FG_GC] + si->gc_time_ms[BG_GC],
+			   si->gc_time_ms[BG_GC],
+			   max(si->gc_peak_time_ms[FG_GC], si->gc_peak_time_ms[BG_GC]),
+			   si->gc_peak_time_ms[BG_GC]);
 		if (__is_large_section(sbi)) {
 			seq_printf(s, "  - data sections : %d (BG: %d)\n",
 					si->gc_secs[DATA][BG_GC] + si->gc_secs[DATA][FG_GC],
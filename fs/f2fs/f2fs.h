@@ -3948,6 +3948,8 @@ struct f2fs_stat_info {
 	int prefree_count, free_segs, free_secs;
 	int cp_call_count[MAX_CALL_TYPE], cp_count;
 	int gc_call_count[MAX_CALL_TYPE];
+	unsigned int gc_time_ms[2];		/* time in f2fs_gc() by gc type */
+	unsigned int gc_peak_time_ms[2];
 	int gc_segs[2][2];
 	int gc_secs[2][2];
 	int tot_blks, data_blks, node_blks;
@@ -4060,6 +4062,14 @@ static inline struct f2fs_stat_info *F2FS_STAT(struct f2fs_sb_info *sbi)
 	} while (0)
 #define stat_inc_gc_call_count(sbi, foreground)				\
 		(F2FS_STAT(sbi)->gc_call_count[(foreground)]++)
+#define stat_update_gc_time(sbi, gc_type, ms)				\
+	do {								\
+		struct f2fs_stat_info *si = F2FS_STAT(sbi);		\
+		unsigned int __ms = (ms);				\
+		si->gc_time_ms[(gc_type)] += __ms;			\
+		if (__ms > si->gc_peak_time_ms[(gc_type)])		\
+			si->gc_peak_time_ms[(gc_type)] = __ms;		\
+	} while (0)
 #define stat_inc_gc_sec_count(sbi, type, gc_type)			\
 		(F2FS_STAT(sbi)->gc_secs[(type)][(gc_type)]++)
 #define stat_inc_gc_seg_count(sbi, type, gc_type)			\
@@ -4120,6 +4130,7 @@ void f2fs_update_sit_info(struct f2fs_sb_info *sbi);
 #define stat_inc_block_count(sbi, curseg)		do { } while (0)
 #define stat_inc_inplace_blocks(sbi)			do { } while (0)
 #define stat_inc_gc_call_count(sbi, foreground)		do { } while (0)
+#define stat_update_gc_time(sbi, gc_type, ms)		do { } while (0)
 #define stat_inc_gc_sec_count(sbi, type, gc_type)	do { } while (0)
 #define stat_inc_gc_seg_count(sbi, type, gc_type)	do { } while (0)
 #define stat_inc_tot_blk_count(si, blks)		do { } while (0)
@@ -1803,6 +1803,7 @@ int f2fs_gc(struct f2fs_sb_info *sbi, struct f2fs_gc_control *gc_control)
 	};
 	unsigned int skipped_round = 0, round = 0;
 	unsigned int upper_secs;
+	ktime_t start_time = ktime_get();
 
 	trace_f2fs_gc_begin(sbi->sb, gc_type, gc_control->no_bg_gc,
 				gc_control->nr_free_secs,
@@ -1931,6 +1932,8 @@ int f2fs_gc(struct f2fs_sb_info *sbi, struct f2fs_gc_control *gc_control)
 				reserved_segments(sbi),
 				prefree_segments(sbi));
 
+	stat_update_gc_time(sbi, gc_type, ktime_ms_delta(ktime_get(), start_time));
+
 	f2fs_up_write(&sbi->gc_lock);
 
 	put_gc_inode(&gc_list);
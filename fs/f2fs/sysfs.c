@@ -1041,6 +1041,10 @@ STAT_INFO_RO_ATTR(cp_foreground_calls, cp_call_count[FOREGROUND]);
 STAT_INFO_RO_ATTR(cp_background_calls, cp_call_count[BACKGROUND]);
 STAT_INFO_RO_ATTR(gc_foreground_calls, gc_call_count[FOREGROUND]);
 STAT_INFO_RO_ATTR(gc_background_calls, gc_call_count[BACKGROUND]);
+STAT_INFO_RO_ATTR(gc_foreground_time_ms, gc_time_ms[FG_GC]);
+STAT_INFO_RO_ATTR(gc_background_time_ms, gc_time_ms[BG_GC]);
+STAT_INFO_RO_ATTR(gc_foreground_peak_time_ms, gc_peak_time_ms[FG_GC]);
+STAT_INFO_RO_ATTR(gc_background_peak_time_ms, gc_peak_time_ms[BG_GC]);
 #endif
 
 /* FAULT_INFO ATTR */
@@ -1181,6 +1185,10 @@ static struct attribute *f2fs_attrs[] = {
 	ATTR_LIST(cp_background_calls),
 	ATTR_LIST(gc_foreground_calls),
 	ATTR_LIST(gc_background_calls),
+	ATTR_LIST(gc_foreground_time_ms),
+	ATTR_LIST(gc_background_time_ms),
+	ATTR_LIST(gc_foreground_peak_time_ms),
+	ATTR_LIST(gc_background_peak_time_ms),
 	ATTR_LIST(moved_blocks_foreground),
 	ATTR_LIST(moved_blocks_background),
 	ATTR_LIST(avg_vblocks),
@@ -1625,6 +1625,107 @@ static void requeue_inode(struct inode *inode, struct bdi_writeback *wb,
 	}
 }
 
+/*
+ * A large inode that the flusher is asked to write a lot of is split into up
+ * to WB_PARALLEL_MAX_WORKERS ranges of at least WB_PARALLEL_MIN_PAGES, which
+ * are written back concurrently, so that one flusher thread doesn't limit the
+ * writeback throughput of a single big file on a fast device.
+ */
+#define WB_PARALLEL_MAX_WORKERS	4
+#define WB_PARALLEL_MIN_PAGES	(SZ_16M >> PAGE_SHIFT)
+
+static struct workqueue_struct *wb_parallel_wq;
+
+struct wb_range_work {
+	struct work_struct	work;
+	struct address_space	*mapping;
+	struct writeback_control wbc;
+	int			ret;
+	atomic_t		*pending;
+	struct completion	*done;
+};
+
+static void wb_range_workfn(struct work_struct *work)
+{
+	struct wb_range_work *rw = container_of(work, struct wb_range_work, work);
+
+	rw->ret = do_writepages(rw->mapping, &rw->wbc);
+	if (atomic_dec_and_test(rw->pending))
+		complete(rw->done);
+}
+
+static int writeback_inode_pages(struct address_space *mapping,
+				 struct writeback_control *wbc)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct wb_range_work *works;
+	loff_t size = i_size_read(mapping->host), chunk;
+	unsigned long nr;
+	atomic_t pending;
+	long written = 0;
+	int i, ret = 0;
+
+	/*
+	 * Only periodic and background writeback is split: everybody else
+	 * asks for a specific range or runs on behalf of a caller that
+	 * expects the inode to be written in order.
+	 */
+	if (!wb_parallel_wq || !wbc->range_cyclic ||
+	    wbc->sync_mode != WB_SYNC_NONE)
+		return do_writepages(mapping, wbc);
+
+	nr = min3((unsigned long)WB_PARALLEL_MAX_WORKERS,
+		  (unsigned long)num_online_cpus(),
+		  min_t(unsigned long, wbc->nr_to_write, mapping->nrpages) /
+		  WB_PARALLEL_MIN_PAGES);
+	if (nr < 2 || !mapping_tagged(mapping, PAGECACHE_TAG_DIRTY))
+		return do_writepages(mapping, wbc);
+
+	works = kcalloc(nr, sizeof(*works), GFP_NOFS);
+	if (!works)
+		return do_writepages(mapping, wbc);
+
+	chunk = round_up(div_u64(size, nr), PAGE_SIZE);
+	atomic_set(&pending, nr);
+	for (i = 0; i < nr; i++) {
+		struct wb_range_work *rw = &works[i];
+
+		rw->mapping = mapping;
+		rw->wbc = *wbc;
+		rw->wbc.range_cyclic = 0;
+		rw->wbc.range_start = i * chunk;
+		rw->wbc.range_end = i == nr - 1 ? LLONG_MAX :
+				    (i + 1) * chunk - 1;
+		rw->wbc.nr_to_write = wbc->nr_to_write / nr;
+		rw->pending = &pending;
+		rw->done = &done;
+		INIT_WORK(&rw->work, wb_range_workfn);
+		/* Keep the first range to the flusher itself */
+		if (i)
+			queue_work(wb_parallel_wq, &rw->work);
+	}
+	wb_range_workfn(&works[0].work);
+	wait_for_completion(&done);
+
+	for (i = 0; i < nr; i++) {
+		written += wbc->nr_to_write / nr - works[i].wbc.nr_to_write;
+		wbc->pages_skipped += works[i].wbc.pages_skipped;
+		if (!ret)
+			ret = works[i].ret;
+	}
+	wbc->nr_to_write -= written;
+	kfree(works);
+	return ret;
+}
+
+static int __init wb_parallel_init(void)
+{
+	wb_parallel_wq = alloc_workqueue("writeback-range",
+					 WQ_MEM_RECLAIM | WQ_UNBOUND, 0);
+	return 0;
+}
+__initcall(wb_parallel_init);
+
 /*
  * Write out an inode and its dirty pages (or some of its dirty pages, depending
  * on @wbc->nr_to_write), and clear the relevant dirty flags from i_state.
@@ -1648,7 +1749,7 @@ __writeback_single_inode(struct inode *inode, struct writeback_control *wbc)
 
 	trace_writeback_single_inode_start(inode, wbc, nr_to_write);
 
-	ret = do_writepages(mapping, wbc);
+	ret = writeback_inode_pages(mapping, wbc);
 
 	/*
 	 * Make sure to wait on the data before writing out the metadata.
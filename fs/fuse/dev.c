@@ -7,6 +7,7 @@
 */
 
 #include "fuse_i.h"
+#include "dev_uring_i.h"
 
 #include <linux/init.h>
 #include <linux/module.h>
@@ -21,6 +22,7 @@
 #include <linux/swap.h>
 #include <linux/splice.h>
 #include <linux/sched.h>
+#include <linux/io_uring/cmd.h>
 
 MODULE_ALIAS_MISCDEV(FUSE_MINOR);
 MODULE_ALIAS("devname:fuse");
@@ -229,6 +231,10 @@ __releases(fiq->lock)
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		fuse_len_args(req->args->in_numargs,
 			      (struct fuse_arg *) req->args->in_args);
+	if (fuse_uring_queue_req(req->fm->fc, req)) {
+		spin_unlock(&fiq->lock);
+		return;
+	}
 	list_add_tail(&req->list, &fiq->pending);
 	fiq->ops->wake_pending_and_unlock(fiq);
 }
@@ -365,6 +371,7 @@ static void request_wait_answer(struct fuse_req *req)
 {
 	struct fuse_conn *fc = req->fm->fc;
 	struct fuse_iqueue *fiq = &fc->iq;
+	bool pending;
 	int err;
 
 	if (!fc->no_interrupt) {
@@ -389,9 +396,13 @@ static void request_wait_answer(struct fuse_req *req)
 			return;
 
 		spin_lock(&fiq->lock);
-		/* Request is not yet in userspace, bail out */
-		if (test_bit(FR_PENDING, &req->flags)) {
+		pending = test_bit(FR_PENDING, &req->flags);
+		if (pending && fuse_req_on_ring(req))
+			pending = fuse_uring_remove_pending(req);
+		else if (pending)
 			list_del(&req->list);
+		/* Request is not yet in userspace, bail out */
+		if (pending) {
 			spin_unlock(&fiq->lock);
 			__fuse_put_request(req);
 			req->out.h.error = -EINTR;
@@ -1192,14 +1203,98 @@ __releases(fiq->lock)
 		return fuse_read_batch_forget(fiq, cs, nbytes);
 }
 
+/*
+ * Copy @req, which was taken off a pending queue, to the buffer of @cs.  If
+ * there was an error during the copying then it's finished by calling
+ * fuse_request_end().  Otherwise add it to the processing list of @fud, and
+ * set the 'sent' flag.
+ */
+static ssize_t fuse_dev_copy_req(struct fuse_dev *fud,
+				 struct fuse_copy_state *cs,
+				 struct fuse_req *req)
+{
+	ssize_t err;
+	struct fuse_conn *fc = fud->fc;
+	struct fuse_pqueue *fpq = &fud->pq;
+	struct fuse_args *args = req->args;
+	unsigned reqsize = req->in.h.len;
+	unsigned int hash;
+
+	spin_lock(&fpq->lock);
+	/*
+	 *  Must not put request on fpq->io queue after having been shut down by
+	 *  fuse_abort_conn()
+	 */
+	if (!fpq->connected) {
+		req->out.h.error = err = -ECONNABORTED;
+		goto out_end;
+
+	}
+	list_add(&req->list, &fpq->io);
+	spin_unlock(&fpq->lock);
+	cs->req = req;
+	err = fuse_copy_one(cs, &req->in.h, sizeof(req->in.h));
+	if (!err)
+		err = fuse_copy_args(cs, args->in_numargs, args->in_pages,
+				     (struct fuse_arg *) args->in_args, 0);
+	fuse_copy_finish(cs);
+	spin_lock(&fpq->lock);
+	clear_bit(FR_LOCKED, &req->flags);
+	if (!fpq->connected) {
+		err = fc->aborted ? -ECONNABORTED : -ENODEV;
+		goto out_end;
+	}
+	if (err) {
+		req->out.h.error = -EIO;
+		goto out_end;
+	}
+	if (!test_bit(FR_ISREPLY, &req->flags)) {
+		err = reqsize;
+		goto out_end;
+	}
+	hash = fuse_req_hash(req->in.h.unique);
+	list_move_tail(&req->list, &fpq->processing[hash]);
+	__fuse_get_request(req);
+	set_bit(FR_SENT, &req->flags);
+	spin_unlock(&fpq->lock);
+	/* matches barrier in request_wait_answer() */
+	smp_mb__after_atomic();
+	if (test_bit(FR_INTERRUPTED, &req->flags))
+		queue_interrupt(req);
+	fuse_put_request(req);
+
+	return reqsize;
+
+out_end:
+	if (!test_bit(FR_PRIVATE, &req->flags))
+		list_del_init(&req->list);
+	spin_unlock(&fpq->lock);
+	fuse_request_end(req);
+	return err;
+}
+
+/*
+ * Check that @req fits into a buffer of @nbytes, reply with an error
+ * otherwise.
+ */
+static bool fuse_req_fits(struct fuse_req *req, size_t nbytes)
+{
+	if (nbytes >= req->in.h.len)
+		return true;
+
+	req->out.h.error = -EIO;
+	/* SETXATTR is special, since it may contain too large data */
+	if (req->args->opcode == FUSE_SETXATTR)
+		req->out.h.error = -E2BIG;
+	fuse_request_end(req);
+	return false;
+}
+
 /*
  * Read a single request into the userspace filesystem's buffer.  This
  * function waits until a request is available, then removes it from
- * the pending list and copies request data to userspace buffer.  If
- * no reply is needed (FORGET) or request has been aborted or there
- * was an error during the copying then it's finished by calling
- * fuse_request_end().  Otherwise add it to the processing list, and set
- * the 'sent' flag.
+ * the pending list and copies request data to userspace buffer with
+ * fuse_dev_copy_req().
  */
 static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 				struct fuse_copy_state *cs, size_t nbytes)
@@ -1207,11 +1302,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	ssize_t err;
 	struct fuse_conn *fc = fud->fc;
 	struct fuse_iqueue *fiq = &fc->iq;
-	struct fuse_pqueue *fpq = &fud->pq;
 	struct fuse_req *req;
-	struct fuse_args *args;
-	unsigned reqsize;
-	unsigned int hash;
 
 	/*
 	 * Require sane minimum read buffer - that has capacity for fixed part
@@ -1270,69 +1361,11 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	list_del_init(&req->list);
 	spin_unlock(&fiq->lock);
 
-	args = req->args;
-	reqsize = req->in.h.len;
-
 	/* If request is too large, reply with an error and restart the read */
-	if (nbytes < reqsize) {
-		req->out.h.error = -EIO;
-		/* SETXATTR is special, since it may contain too large data */
-		if (args->opcode == FUSE_SETXATTR)
-			req->out.h.error = -E2BIG;
-		fuse_request_end(req);
+	if (!fuse_req_fits(req, nbytes))
 		goto restart;
-	}
-	spin_lock(&fpq->lock);
-	/*
-	 *  Must not put request on fpq->io queue after having been shut down by
-	 *  fuse_abort_conn()
-	 */
-	if (!fpq->connected) {
-		req->out.h.error = err = -ECONNABORTED;
-		goto out_end;
 
-	}
-	list_add(&req->list, &fpq->io);
-	spin_unlock(&fpq->lock);
-	cs->req = req;
-	err = fuse_copy_one(cs, &req->in.h, sizeof(req->in.h));
-	if (!err)
-		err = fuse_copy_args(cs, args->in_numargs, args->in_pages,
-				     (struct fuse_arg *) args->in_args, 0);
-	fuse_copy_finish(cs);
-	spin_lock(&fpq->lock);
-	clear_bit(FR_LOCKED, &req->flags);
-	if (!fpq->connected) {
-		err = fc->aborted ? -ECONNABORTED : -ENODEV;
-		goto out_end;
-	}
-	if (err) {
-		req->out.h.error = -EIO;
-		goto out_end;
-	}
-	if (!test_bit(FR_ISREPLY, &req->flags)) {
-		err = reqsize;
-		goto out_end;
-	}
-	hash = fuse_req_hash(req->in.h.unique);
-	list_move_tail(&req->list, &fpq->processing[hash]);
-	__fuse_get_request(req);
-	set_bit(FR_SENT, &req->flags);
-	spin_unlock(&fpq->lock);
-	/* matches barrier in request_wait_answer() */
-	smp_mb__after_atomic();
-	if (test_bit(FR_INTERRUPTED, &req->flags))
-		queue_interrupt(req);
-	fuse_put_request(req);
-
-	return reqsize;
-
-out_end:
-	if (!test_bit(FR_PRIVATE, &req->flags))
-		list_del_init(&req->list);
-	spin_unlock(&fpq->lock);
-	fuse_request_end(req);
-	return err;
+	return fuse_dev_copy_req(fud, cs, req);
 
  err_unlock:
 	spin_unlock(&fiq->lock);
@@ -2003,6 +2036,30 @@ static ssize_t fuse_dev_do_write(struct fuse_dev *fud,
 	goto out;
 }
 
+#ifdef CONFIG_FUSE_IO_URING
+/* Send @req, taken off a ring queue, to the fetch buffer of @iter */
+ssize_t fuse_dev_send_iter(struct fuse_dev *fud, struct fuse_req *req,
+			   struct iov_iter *iter)
+{
+	struct fuse_copy_state cs;
+
+	if (!fuse_req_fits(req, iov_iter_count(iter)))
+		return -EIO;
+
+	fuse_copy_init(&cs, 1, iter);
+	return fuse_dev_copy_req(fud, &cs, req);
+}
+
+/* Hand the reply in @iter, committed through the ring, to its request */
+ssize_t fuse_dev_commit_iter(struct fuse_dev *fud, struct iov_iter *iter)
+{
+	struct fuse_copy_state cs;
+
+	fuse_copy_init(&cs, 0, iter);
+	return fuse_dev_do_write(fud, &cs, iov_iter_count(iter));
+}
+#endif
+
 static ssize_t fuse_dev_write(struct kiocb *iocb, struct iov_iter *from)
 {
 	struct fuse_copy_state cs;
@@ -2230,6 +2287,7 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		list_for_each_entry(req, &fiq->pending, list)
 			clear_bit(FR_PENDING, &req->flags);
 		list_splice_tail_init(&fiq->pending, &to_end);
+		fuse_uring_abort(fc, &to_end);
 		while (forget_pending(fiq))
 			kfree(fuse_dequeue_forget(fiq, 1, NULL));
 		wake_up_all(&fiq->waitq);
@@ -2397,6 +2455,19 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 	}
 }
 
+#ifdef CONFIG_FUSE_IO_URING
+static int fuse_dev_uring_cmd(struct io_uring_cmd *cmd,
+			      unsigned int issue_flags)
+{
+	struct fuse_dev *fud = fuse_get_dev(cmd->file);
+
+	if (!fud)
+		return -EPERM;
+
+	return fuse_uring_cmd(fud, cmd, issue_flags);
+}
+#endif
+
 const struct file_operations fuse_dev_operations = {
 	.owner		= THIS_MODULE,
 	.open		= fuse_dev_open,
@@ -2410,6 +2481,9 @@ const struct file_operations fuse_dev_operations = {
 	.fasync		= fuse_dev_fasync,
 	.unlocked_ioctl = fuse_dev_ioctl,
 	.compat_ioctl   = compat_ptr_ioctl,
+#ifdef CONFIG_FUSE_IO_URING
+	.uring_cmd	= fuse_dev_uring_cmd,
+#endif
 };
 EXPORT_SYMBOL_GPL(fuse_dev_operations);
 
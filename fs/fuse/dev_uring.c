@@ -0,0 +1,469 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * FUSE: io_uring transport
+ *
+ * Instead of reading requests from /dev/fuse and writing the replies back,
+ * the server can fetch requests with FUSE_IO_URING_CMD_REGISTER uring_cmds
+ * on /dev/fuse and reply with FUSE_IO_URING_CMD_COMMIT_AND_FETCH, which also
+ * fetches the next request into the same buffer.  A server can thus answer
+ * and fetch any number of requests with a single io_uring_enter().
+ *
+ * Requests are queued on the ring queue of the CPU they are submitted on, so
+ * a server with a thread per CPU, fetching from the queue of the CPU it runs
+ * on, handles them without bouncing requests or queue locks between CPUs.
+ *
+ * The buffer of a fetch receives what a read() of /dev/fuse would return; the
+ * reply is laid out like a write() to it.  Interrupts, forgets and requests
+ * submitted on CPUs without an active queue are still read from /dev/fuse.
+ */
+
+#include "fuse_i.h"
+#include "dev_uring_i.h"
+
+#include <linux/io_uring/cmd.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/uio.h>
+
+/* A fetch command, waiting for a request or being handed one */
+struct fuse_ring_ent {
+	/* On queue->ent_avail while waiting for a request */
+	struct list_head list;
+	struct fuse_ring_queue *queue;
+	struct fuse_dev *fud;
+	struct io_uring_cmd *cmd;
+	struct fuse_req *req;
+	void __user *buf;
+	u32 buf_len;
+};
+
+static struct fuse_ring_ent **fuse_uring_cmd_ent(struct io_uring_cmd *cmd)
+{
+	BUILD_BUG_ON(sizeof(struct fuse_ring_ent *) > sizeof(cmd->pdu));
+	return (struct fuse_ring_ent **)cmd->pdu;
+}
+
+static struct fuse_ring *fuse_uring_get_ring(struct fuse_conn *fc)
+{
+	struct fuse_ring *ring = smp_load_acquire(&fc->ring);
+
+	if (ring)
+		return ring;
+
+	ring = kzalloc(struct_size(ring, queues, nr_cpu_ids),
+		       GFP_KERNEL_ACCOUNT);
+	if (!ring)
+		return NULL;
+	ring->nr_queues = nr_cpu_ids;
+
+	spin_lock(&fc->lock);
+	if (fc->ring) {
+		kfree(ring);
+		ring = fc->ring;
+	} else {
+		smp_store_release(&fc->ring, ring);
+	}
+	spin_unlock(&fc->lock);
+
+	return ring;
+}
+
+static struct fuse_ring_queue *fuse_uring_get_queue(struct fuse_conn *fc,
+						    unsigned int qid)
+{
+	struct fuse_ring_queue *queue;
+	struct fuse_ring *ring;
+
+	ring = fuse_uring_get_ring(fc);
+	if (!ring)
+		return NULL;
+
+	queue = smp_load_acquire(&ring->queues[qid]);
+	if (queue)
+		return queue;
+
+	queue = kzalloc_node(sizeof(*queue), GFP_KERNEL_ACCOUNT,
+			     cpu_to_node(qid));
+	if (!queue)
+		return NULL;
+
+	spin_lock_init(&queue->lock);
+	queue->qid = qid;
+	INIT_LIST_HEAD(&queue->ent_avail);
+	INIT_LIST_HEAD(&queue->pending);
+
+	/* fuse_abort_conn() stops the queues under fc->lock */
+	spin_lock(&fc->lock);
+	if (ring->queues[qid]) {
+		kfree(queue);
+		queue = ring->queues[qid];
+	} else {
+		queue->stopped = !fc->connected;
+		smp_store_release(&ring->queues[qid], queue);
+	}
+	spin_unlock(&fc->lock);
+
+	return queue;
+}
+
+void fuse_uring_destruct(struct fuse_conn *fc)
+{
+	struct fuse_ring *ring = fc->ring;
+	unsigned int qid;
+
+	if (!ring)
+		return;
+
+	for (qid = 0; qid < ring->nr_queues; qid++) {
+		struct fuse_ring_queue *queue = ring->queues[qid];
+
+		if (!queue)
+			continue;
+
+		WARN_ON(!list_empty(&queue->ent_avail));
+		WARN_ON(!list_empty(&queue->pending));
+		kfree(queue);
+	}
+	kfree(ring);
+	fc->ring = NULL;
+}
+
+/*
+ * Put a request which was taken off a ring queue, but could not be copied to
+ * the server, back on the input queue.
+ */
+static void fuse_uring_requeue_req(struct fuse_conn *fc, struct fuse_req *req)
+{
+	struct fuse_iqueue *fiq = &fc->iq;
+
+	spin_lock(&fiq->lock);
+	if (!fiq->connected) {
+		spin_unlock(&fiq->lock);
+		req->out.h.error = -ECONNABORTED;
+		fuse_request_end(req);
+		return;
+	}
+	req->ring_queue = NULL;
+	set_bit(FR_PENDING, &req->flags);
+	list_add(&req->list, &fiq->pending);
+	fiq->ops->wake_pending_and_unlock(fiq);
+}
+
+static ssize_t fuse_uring_send(struct fuse_ring_ent *ent, struct fuse_req *req)
+{
+	struct iov_iter iter;
+	int err;
+
+	err = import_ubuf(ITER_DEST, ent->buf, ent->buf_len, &iter);
+	if (err) {
+		req->out.h.error = -EIO;
+		fuse_request_end(req);
+		return err;
+	}
+
+	return fuse_dev_send_iter(ent->fud, req, &iter);
+}
+
+static void fuse_uring_send_in_task(struct io_uring_cmd *cmd,
+				    unsigned int issue_flags)
+{
+	struct fuse_ring_ent *ent = *fuse_uring_cmd_ent(cmd);
+	struct fuse_req *req = ent->req;
+	ssize_t ret;
+
+	/* The server's memory is gone if this runs from the fallback work */
+	if (current->flags & (PF_EXITING | PF_KTHREAD)) {
+		fuse_uring_requeue_req(ent->fud->fc, req);
+		ret = -ECANCELED;
+	} else {
+		ret = fuse_uring_send(ent, req);
+	}
+
+	io_uring_cmd_done(cmd, ret, 0, issue_flags);
+	kfree(ent);
+}
+
+static void fuse_uring_stop_in_task(struct io_uring_cmd *cmd,
+				    unsigned int issue_flags)
+{
+	struct fuse_ring_ent *ent = *fuse_uring_cmd_ent(cmd);
+
+	io_uring_cmd_done(cmd, -ENOTCONN, 0, issue_flags);
+	kfree(ent);
+}
+
+/*
+ * Queue @req on the ring queue of the current CPU, if the server fetches from
+ * it.  Called with fiq->lock held; returns false if @req has to go on the
+ * input queue instead.
+ */
+bool fuse_uring_queue_req(struct fuse_conn *fc, struct fuse_req *req)
+{
+	struct fuse_ring *ring = smp_load_acquire(&fc->ring);
+	struct fuse_ring_queue *queue;
+	struct fuse_ring_ent *ent;
+
+	if (!ring)
+		return false;
+
+	queue = smp_load_acquire(&ring->queues[raw_smp_processor_id()]);
+	if (!queue)
+		return false;
+
+	spin_lock(&queue->lock);
+	if (!queue->active || queue->stopped) {
+		spin_unlock(&queue->lock);
+		return false;
+	}
+	req->ring_queue = queue;
+	ent = list_first_entry_or_null(&queue->ent_avail, struct fuse_ring_ent,
+				       list);
+	if (ent) {
+		list_del_init(&ent->list);
+		clear_bit(FR_PENDING, &req->flags);
+		ent->req = req;
+	} else {
+		list_add_tail(&req->list, &queue->pending);
+	}
+	spin_unlock(&queue->lock);
+
+	if (ent)
+		io_uring_cmd_complete_in_task(ent->cmd, fuse_uring_send_in_task);
+
+	return true;
+}
+
+/*
+ * Take a request which was interrupted before it was fetched by the server
+ * off its ring queue.  Called with fiq->lock held.
+ */
+bool fuse_uring_remove_pending(struct fuse_req *req)
+{
+	struct fuse_ring_queue *queue = req->ring_queue;
+	bool removed = false;
+
+	spin_lock(&queue->lock);
+	if (test_bit(FR_PENDING, &req->flags)) {
+		list_del(&req->list);
+		removed = true;
+	}
+	spin_unlock(&queue->lock);
+
+	return removed;
+}
+
+/*
+ * Stop all ring queues and move their pending requests to @to_end.  Called
+ * from fuse_abort_conn() with fc->lock and fiq->lock held.
+ */
+void fuse_uring_abort(struct fuse_conn *fc, struct list_head *to_end)
+{
+	struct fuse_ring *ring = fc->ring;
+	struct fuse_req *req;
+	unsigned int qid;
+
+	if (!ring)
+		return;
+
+	for (qid = 0; qid < ring->nr_queues; qid++) {
+		struct fuse_ring_queue *queue = ring->queues[qid];
+		struct fuse_ring_ent *ent;
+
+		if (!queue)
+			continue;
+
+		spin_lock(&queue->lock);
+		queue->stopped = true;
+		queue->active = false;
+		list_for_each_entry(req, &queue->pending, list)
+			clear_bit(FR_PENDING, &req->flags);
+		list_splice_tail_init(&queue->pending, to_end);
+		while ((ent = list_first_entry_or_null(&queue->ent_avail,
+						       struct fuse_ring_ent,
+						       list))) {
+			list_del_init(&ent->list);
+			io_uring_cmd_complete_in_task(ent->cmd,
+						      fuse_uring_stop_in_task);
+		}
+		spin_unlock(&queue->lock);
+	}
+}
+
+/* The io_uring the fetch was submitted to goes away */
+static void fuse_uring_cancel(struct io_uring_cmd *cmd,
+			      unsigned int issue_flags)
+{
+	struct fuse_ring_ent *ent = *fuse_uring_cmd_ent(cmd);
+	struct fuse_ring_queue *queue = ent->queue;
+	struct fuse_iqueue *fiq = &ent->fud->fc->iq;
+	struct fuse_req *req;
+	LIST_HEAD(requeue);
+	bool cancel;
+
+	spin_lock(&fiq->lock);
+	spin_lock(&queue->lock);
+	cancel = !list_empty(&ent->list);
+	if (cancel) {
+		list_del_init(&ent->list);
+		/*
+		 * Nobody fetches from the queue anymore, hand its requests
+		 * to the readers of /dev/fuse.
+		 */
+		if (list_empty(&queue->ent_avail)) {
+			queue->active = false;
+			list_splice_init(&queue->pending, &requeue);
+		}
+	}
+	spin_unlock(&queue->lock);
+
+	if (!list_empty(&requeue)) {
+		list_for_each_entry(req, &requeue, list)
+			req->ring_queue = NULL;
+		list_splice(&requeue, &fiq->pending);
+		fiq->ops->wake_pending_and_unlock(fiq);
+	} else {
+		spin_unlock(&fiq->lock);
+	}
+
+	if (cancel) {
+		io_uring_cmd_done(cmd, -ECANCELED, 0, issue_flags);
+		kfree(ent);
+	}
+}
+
+static int fuse_uring_fetch(struct fuse_dev *fud, struct io_uring_cmd *cmd,
+			    const struct fuse_uring_cmd_req *cmd_req,
+			    unsigned int issue_flags)
+{
+	struct fuse_conn *fc = fud->fc;
+	struct fuse_ring_queue *queue;
+	struct fuse_ring_ent *ent;
+	struct fuse_req *req;
+	struct iov_iter iter;
+	ssize_t ret;
+
+	/* Same sanity minimum as for read() of /dev/fuse */
+	if (cmd_req->buf_len < max_t(size_t, FUSE_MIN_READ_BUFFER,
+				     sizeof(struct fuse_in_header) +
+				     sizeof(struct fuse_write_in) +
+				     fc->max_write))
+		return -EINVAL;
+
+	ret = import_ubuf(ITER_DEST, u64_to_user_ptr(cmd_req->buf),
+			  cmd_req->buf_len, &iter);
+	if (ret)
+		return ret;
+
+	queue = fuse_uring_get_queue(fc, cmd_req->qid);
+	if (!queue)
+		return -ENOMEM;
+
+	ent = kmalloc(sizeof(*ent), GFP_KERNEL_ACCOUNT);
+	if (!ent)
+		return -ENOMEM;
+
+	INIT_LIST_HEAD(&ent->list);
+	ent->queue = queue;
+	ent->fud = fud;
+	ent->cmd = cmd;
+	ent->req = NULL;
+	ent->buf = u64_to_user_ptr(cmd_req->buf);
+	ent->buf_len = cmd_req->buf_len;
+	*fuse_uring_cmd_ent(cmd) = ent;
+
+	/* Before another CPU can complete the command */
+	io_uring_cmd_mark_cancelable(cmd, issue_flags);
+
+	spin_lock(&queue->lock);
+	if (queue->stopped) {
+		spin_unlock(&queue->lock);
+		ret = -ENOTCONN;
+		goto done;
+	}
+	queue->active = true;
+	req = list_first_entry_or_null(&queue->pending, struct fuse_req, list);
+	if (req) {
+		list_del_init(&req->list);
+		clear_bit(FR_PENDING, &req->flags);
+	} else {
+		list_add_tail(&ent->list, &queue->ent_avail);
+	}
+	spin_unlock(&queue->lock);
+
+	if (!req)
+		return -EIOCBQUEUED;
+
+	ret = fuse_uring_send(ent, req);
+done:
+	io_uring_cmd_done(cmd, ret, 0, issue_flags);
+	kfree(ent);
+	return -EIOCBQUEUED;
+}
+
+static int fuse_uring_commit(struct fuse_dev *fud,
+			     const struct fuse_uring_cmd_req *cmd_req)
+{
+	struct iov_iter iter;
+	ssize_t ret;
+
+	ret = import_ubuf(ITER_SOURCE, u64_to_user_ptr(cmd_req->buf),
+			  min(cmd_req->commit_len, cmd_req->buf_len), &iter);
+	if (ret)
+		return ret;
+
+	ret = fuse_dev_commit_iter(fud, &iter);
+	return ret < 0 ? ret : 0;
+}
+
+/*
+ * Entry point for uring_cmds on /dev/fuse.  The command completes with the
+ * size of the fetched request, or with a negative error, after which the
+ * buffer is no longer used by the kernel and a new fetch has to be
+ * registered for it.
+ */
+int fuse_uring_cmd(struct fuse_dev *fud, struct io_uring_cmd *cmd,
+		   unsigned int issue_flags)
+{
+	const struct fuse_uring_cmd_req *sqe_req;
+	struct fuse_uring_cmd_req cmd_req;
+	struct fuse_conn *fc = fud->fc;
+	int err;
+
+	if (issue_flags & IO_URING_F_CANCEL) {
+		fuse_uring_cancel(cmd, issue_flags);
+		return 0;
+	}
+
+	/* struct fuse_uring_cmd_req doesn't fit into a 64 byte SQE */
+	if (!(issue_flags & IO_URING_F_SQE128))
+		return -EINVAL;
+
+	sqe_req = io_uring_sqe_cmd(cmd->sqe);
+	cmd_req.buf = READ_ONCE(sqe_req->buf);
+	cmd_req.buf_len = READ_ONCE(sqe_req->buf_len);
+	cmd_req.commit_len = READ_ONCE(sqe_req->commit_len);
+	cmd_req.qid = READ_ONCE(sqe_req->qid);
+
+	if (cmd_req.qid >= nr_cpu_ids || !cpu_possible(cmd_req.qid))
+		return -EINVAL;
+
+	/* fc->max_write is only known after the INIT reply */
+	if (!fc->initialized)
+		return -EBUSY;
+	if (!fc->connected)
+		return -ENOTCONN;
+
+	switch (cmd->cmd_op) {
+	case FUSE_IO_URING_CMD_REGISTER:
+		break;
+	case FUSE_IO_URING_CMD_COMMIT_AND_FETCH:
+		err = fuse_uring_commit(fud, &cmd_req);
+		if (err)
+			return err;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return fuse_uring_fetch(fud, cmd, &cmd_req, issue_flags);
+}
@@ -0,0 +1,88 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * FUSE: io_uring transport
+ */
+#ifndef _FS_FUSE_DEV_URING_I_H
+#define _FS_FUSE_DEV_URING_I_H
+
+#include "fuse_i.h"
+
+#ifdef CONFIG_FUSE_IO_URING
+
+struct io_uring_cmd;
+
+/*
+ * A ring queue, there is one per possible CPU.  Requests submitted on a CPU
+ * are queued on the queue of that CPU once the server fetches from it.
+ */
+struct fuse_ring_queue {
+	spinlock_t lock;
+
+	/** CPU of the queue */
+	unsigned int qid;
+
+	/** The server fetches requests from this queue */
+	bool active;
+
+	/** The connection was aborted */
+	bool stopped;
+
+	/** Fetch commands waiting for a request */
+	struct list_head ent_avail;
+
+	/** Requests waiting for a fetch command */
+	struct list_head pending;
+};
+
+struct fuse_ring {
+	unsigned int nr_queues;
+	struct fuse_ring_queue *queues[] __counted_by(nr_queues);
+};
+
+int fuse_uring_cmd(struct fuse_dev *fud, struct io_uring_cmd *cmd,
+		   unsigned int issue_flags);
+bool fuse_uring_queue_req(struct fuse_conn *fc, struct fuse_req *req);
+bool fuse_uring_remove_pending(struct fuse_req *req);
+void fuse_uring_abort(struct fuse_conn *fc, struct list_head *to_end);
+void fuse_uring_destruct(struct fuse_conn *fc);
+
+/* dev.c */
+ssize_t fuse_dev_send_iter(struct fuse_dev *fud, struct fuse_req *req,
+			   struct iov_iter *iter);
+ssize_t fuse_dev_commit_iter(struct fuse_dev *fud, struct iov_iter *iter);
+
+static inline bool fuse_req_on_ring(struct fuse_req *req)
+{
+	return req->ring_queue;
+}
+
+#else
+
+static inline bool fuse_uring_queue_req(struct fuse_conn *fc,
+					struct fuse_req *req)
+{
+	return false;
+}
+
+static inline bool fuse_uring_remove_pending(struct fuse_req *req)
+{
+	return false;
+}
+
+static inline void fuse_uring_abort(struct fuse_conn *fc,
+				    struct list_head *to_end)
+{
+}
+
+static inline void fuse_uring_destruct(struct fuse_conn *fc)
+{
+}
+
+static inline bool fuse_req_on_ring(struct fuse_req *req)
+{
+	return false;
+}
+
+#endif /* CONFIG_FUSE_IO_URING */
+
+#endif /* _FS_FUSE_DEV_URING_I_H */
@@ -1314,6 +1314,10 @@ static int fuse_update_get_attr(struct inode *inode, struct file *file,
 	else
 		sync = time_before64(fi->i_time, get_jiffies_64());
 
+	if (sync && fuse_inode_backing_cached(fi) &&
+	    !fuse_passthrough_getattr(inode, stat, request_mask, flags))
+		return 0;
+
 	if (sync) {
 		forget_all_cached_acls(inode);
 		/* Try statx if BTIME is requested */
@@ -110,6 +110,9 @@ static void fuse_file_put(struct fuse_file *ff, bool sync)
 
 		if (!args) {
 			/* Do nothing when server does not implement 'open' */
+		} else if (ff->cached_open) {
+			/* Server did not see the open, so no release either */
+			fuse_release_end(ff->fm, args, 0);
 		} else if (sync) {
 			fuse_simple_request(ff->fm, args);
 			fuse_release_end(ff->fm, args, 0);
@@ -230,6 +233,48 @@ static void fuse_truncate_update_attr(struct inode *inode, struct file *file)
 	fuse_invalidate_attr_mask(inode, FUSE_STATX_MODSIZE);
 }
 
+/*
+ * Open an inode that an earlier FOPEN_PASSTHROUGH_INODE open bound to its
+ * backing file, without a round trip to the server.
+ *
+ * Only done if the kernel checks permissions, since the server could not
+ * deny the open, and not for O_TRUNC, which the server has to carry out.
+ */
+static int fuse_open_cached(struct inode *inode, struct file *file)
+{
+	struct fuse_mount *fm = get_fuse_mount(inode);
+	struct fuse_inode *fi = get_fuse_inode(inode);
+	struct fuse_file *ff;
+	u32 open_flags;
+	int err;
+
+	if (!IS_ENABLED(CONFIG_FUSE_PASSTHROUGH) ||
+	    !fm->fc->default_permissions || (file->f_flags & O_TRUNC) ||
+	    !fuse_inode_backing_cached(fi))
+		return -ENOENT;
+
+	open_flags = fuse_passthrough_cached_flags(fi);
+	if (!open_flags)
+		return -ENOENT;
+
+	ff = fuse_file_alloc(fm, true);
+	if (!ff)
+		return -ENOMEM;
+
+	ff->open_flags = open_flags;
+	ff->nodeid = get_node_id(inode);
+	ff->cached_open = true;
+	file->private_data = ff;
+
+	err = fuse_finish_open(inode, file);
+	if (err) {
+		fuse_sync_release(fi, ff, file->f_flags);
+		file->private_data = NULL;
+	}
+
+	return err;
+}
+
 static int fuse_open(struct inode *inode, struct file *file)
 {
 	struct fuse_mount *fm = get_fuse_mount(inode);
@@ -248,6 +293,10 @@ static int fuse_open(struct inode *inode, struct file *file)
 	if (err)
 		return err;
 
+	/* Fall back to the server if the inode is not (or no longer) bound */
+	if (!fuse_open_cached(inode, file))
+		return 0;
+
 	if (is_wb_truncate || dax_truncate)
 		inode_lock(inode);
 
@@ -192,6 +192,12 @@ struct fuse_inode {
 #ifdef CONFIG_FUSE_PASSTHROUGH
 	/** Reference to backing file in passthrough mode */
 	struct fuse_backing *fb;
+
+	/** Backing file kept for opens that skip the server */
+	struct fuse_backing *fb_cache;
+
+	/** FOPEN_* flags of the open that set @fb_cache */
+	u32 fb_cache_flags;
 #endif
 };
 
@@ -271,6 +277,9 @@ struct fuse_file {
 
 	/** Has flock been performed on this file? */
 	bool flock:1;
+
+	/** Opened from the inode backing file cache, unknown to the server */
+	bool cached_open:1;
 };
 
 /** One input argument of a request */
@@ -435,6 +444,11 @@ struct fuse_req {
 
 	/** fuse_mount this request belongs to */
 	struct fuse_mount *fm;
+
+#ifdef CONFIG_FUSE_IO_URING
+	/** Ring queue the request was queued on, protects ->list while pending */
+	struct fuse_ring_queue *ring_queue;
+#endif
 };
 
 struct fuse_iqueue;
@@ -917,6 +931,11 @@ struct fuse_conn {
 	/** IDR for backing files ids */
 	struct idr backing_files_map;
 #endif
+
+#ifdef CONFIG_FUSE_IO_URING
+	/** io_uring transport, set up by the first fetch command */
+	struct fuse_ring *ring;
+#endif
 };
 
 /*
@@ -1428,6 +1447,15 @@ static inline struct fuse_backing *fuse_inode_backing_set(struct fuse_inode *fi,
 #endif
 }
 
+static inline bool fuse_inode_backing_cached(struct fuse_inode *fi)
+{
+#ifdef CONFIG_FUSE_PASSTHROUGH
+	return READ_ONCE(fi->fb_cache);
+#else
+	return false;
+#endif
+}
+
 #ifdef CONFIG_FUSE_PASSTHROUGH
 struct fuse_backing *fuse_backing_get(struct fuse_backing *fb);
 void fuse_backing_put(struct fuse_backing *fb);
@@ -1451,7 +1479,15 @@ int fuse_backing_close(struct fuse_conn *fc, int backing_id);
 struct fuse_backing *fuse_passthrough_open(struct file *file,
 					   struct inode *inode,
 					   int backing_id);
+struct fuse_backing *fuse_passthrough_open_cached(struct file *file,
+						  struct inode *inode);
 void fuse_passthrough_release(struct fuse_file *ff, struct fuse_backing *fb);
+void fuse_passthrough_cache_inode(struct fuse_inode *fi,
+				  struct fuse_backing *fb, u32 open_flags);
+void fuse_passthrough_uncache_inode(struct fuse_inode *fi);
+u32 fuse_passthrough_cached_flags(struct fuse_inode *fi);
+int fuse_passthrough_getattr(struct inode *inode, struct kstat *stat,
+			     u32 request_mask, unsigned int flags);
 
 static inline struct file *fuse_file_passthrough(struct fuse_file *ff)
 {
@@ -65,6 +65,10 @@ int fuse_file_cached_io_open(struct inode *inode, struct fuse_file *ff)
 		fi->iocachectr++;
 	}
 	spin_unlock(&fi->lock);
+
+	/* Caching io mode unbinds the inode from its cached backing file */
+	if (fuse_inode_backing_cached(fi))
+		fuse_passthrough_uncache_inode(fi);
 	return 0;
 }
 
@@ -163,7 +167,7 @@ static void fuse_file_uncached_io_release(struct fuse_file *ff,
  */
 #define FOPEN_PASSTHROUGH_MASK \
 	(FOPEN_PASSTHROUGH | FOPEN_DIRECT_IO | FOPEN_PARALLEL_DIRECT_WRITES | \
-	 FOPEN_NOFLUSH)
+	 FOPEN_NOFLUSH | FOPEN_PASSTHROUGH_INODE)
 
 static int fuse_file_passthrough_open(struct inode *inode, struct file *file)
 {
@@ -177,15 +181,23 @@ static int fuse_file_passthrough_open(struct inode *inode, struct file *file)
 	    (ff->open_flags & ~FOPEN_PASSTHROUGH_MASK))
 		return -EINVAL;
 
-	fb = fuse_passthrough_open(file, inode,
-				   ff->args->open_outarg.backing_id);
+	if (ff->cached_open)
+		fb = fuse_passthrough_open_cached(file, inode);
+	else
+		fb = fuse_passthrough_open(file, inode,
+					   ff->args->open_outarg.backing_id);
 	if (IS_ERR(fb))
 		return PTR_ERR(fb);
 
 	/* First passthrough file open denies caching inode io mode */
 	err = fuse_file_uncached_io_open(inode, ff, fb);
-	if (!err)
+	if (!err) {
+		/* The inode holds a reference of fb while the file is open */
+		if (ff->open_flags & FOPEN_PASSTHROUGH_INODE)
+			fuse_passthrough_cache_inode(get_fuse_inode(inode), fb,
+						     ff->open_flags);
 		return 0;
+	}
 
 	fuse_passthrough_release(ff, fb);
 	fuse_backing_put(fb);
@@ -301,6 +301,22 @@ int fuse_backing_close(struct fuse_conn *fc, int backing_id)
  *
  * Returns an fb object with elevated refcount to be stored in fuse inode.
  */
+static int fuse_passthrough_setup(struct file *file, struct fuse_backing *fb)
+{
+	struct fuse_file *ff = file->private_data;
+	struct file *backing_file;
+
+	/* Allocate backing file per fuse file to store fuse path */
+	backing_file = backing_file_open(&file->f_path, file->f_flags,
+					 &fb->file->f_path, fb->cred);
+	if (IS_ERR(backing_file))
+		return PTR_ERR(backing_file);
+
+	ff->passthrough = backing_file;
+	ff->cred = get_cred(fb->cred);
+	return 0;
+}
+
 struct fuse_backing *fuse_passthrough_open(struct file *file,
 					   struct inode *inode,
 					   int backing_id)
@@ -308,7 +324,6 @@ struct fuse_backing *fuse_passthrough_open(struct file *file,
 	struct fuse_file *ff = file->private_data;
 	struct fuse_conn *fc = ff->fm->fc;
 	struct fuse_backing *fb = NULL;
-	struct file *backing_file;
 	int err;
 
 	err = -EINVAL;
@@ -324,18 +339,9 @@ struct fuse_backing *fuse_passthrough_open(struct file *file,
 	if (!fb)
 		goto out;
 
-	/* Allocate backing file per fuse file to store fuse path */
-	backing_file = backing_file_open(&file->f_path, file->f_flags,
-					 &fb->file->f_path, fb->cred);
-	err = PTR_ERR(backing_file);
-	if (IS_ERR(backing_file)) {
+	err = fuse_passthrough_setup(file, fb);
+	if (err)
 		fuse_backing_put(fb);
-		goto out;
-	}
-
-	err = 0;
-	ff->passthrough = backing_file;
-	ff->cred = get_cred(fb->cred);
 out:
 	pr_debug("%s: backing_id=%d, fb=0x%p, backing_file=0x%p, err=%i\n", __func__,
 		 backing_id, fb, ff->passthrough, err);
@@ -343,6 +349,45 @@ struct fuse_backing *fuse_passthrough_open(struct file *file,
 	return err ? ERR_PTR(err) : fb;
 }
 
+static struct fuse_backing *fuse_inode_backing_cache_get(struct fuse_inode *fi)
+{
+	struct fuse_backing *fb;
+
+	spin_lock(&fi->lock);
+	fb = fuse_backing_get(fi->fb_cache);
+	spin_unlock(&fi->lock);
+
+	return fb;
+}
+
+/*
+ * Setup passthrough to the backing file cached on the inode, for an open that
+ * was not sent to the server.
+ *
+ * Returns an fb object with elevated refcount to be stored in fuse inode.
+ */
+struct fuse_backing *fuse_passthrough_open_cached(struct file *file,
+						  struct inode *inode)
+{
+	struct fuse_file *ff = file->private_data;
+	struct fuse_backing *fb;
+	int err;
+
+	fb = fuse_inode_backing_cache_get(get_fuse_inode(inode));
+	err = -ENOENT;
+	if (!fb)
+		goto out;
+
+	err = fuse_passthrough_setup(file, fb);
+	if (err)
+		fuse_backing_put(fb);
+out:
+	pr_debug("%s: fb=0x%p, backing_file=0x%p, err=%i\n", __func__,
+		 fb, ff->passthrough, err);
+
+	return err ? ERR_PTR(err) : fb;
+}
+
 void fuse_passthrough_release(struct fuse_file *ff, struct fuse_backing *fb)
 {
 	pr_debug("%s: fb=0x%p, backing_file=0x%p\n", __func__,
@@ -353,3 +398,95 @@ void fuse_passthrough_release(struct fuse_file *ff, struct fuse_backing *fb)
 	put_cred(ff->cred);
 	ff->cred = NULL;
 }
+
+/*
+ * Keep the backing file of an FOPEN_PASSTHROUGH_INODE open beyond the last
+ * close of the inode, so that later opens do not need to ask the server.
+ */
+void fuse_passthrough_cache_inode(struct fuse_inode *fi,
+				  struct fuse_backing *fb, u32 open_flags)
+{
+	spin_lock(&fi->lock);
+	if (!fi->fb_cache) {
+		fi->fb_cache = fuse_backing_get(fb);
+		fi->fb_cache_flags = open_flags;
+	}
+	spin_unlock(&fi->lock);
+
+	pr_debug("%s: fb=0x%p, open_flags=0x%x\n", __func__, fb, open_flags);
+}
+
+void fuse_passthrough_uncache_inode(struct fuse_inode *fi)
+{
+	struct fuse_backing *fb;
+
+	spin_lock(&fi->lock);
+	fb = fi->fb_cache;
+	fi->fb_cache = NULL;
+	spin_unlock(&fi->lock);
+
+	fuse_backing_put(fb);
+}
+
+/* Returns the open flags to use for an open from the cache, or 0 */
+u32 fuse_passthrough_cached_flags(struct fuse_inode *fi)
+{
+	u32 open_flags = 0;
+
+	spin_lock(&fi->lock);
+	if (fi->fb_cache)
+		open_flags = fi->fb_cache_flags;
+	spin_unlock(&fi->lock);
+
+	return open_flags;
+}
+
+/*
+ * Serve getattr of an inode bound to its backing file from the backing inode.
+ *
+ * The server stays in charge of the identity of the inode (type, mode,
+ * owner, link count), the backing inode provides the attributes that
+ * passthrough io changes: size, block usage and timestamps.
+ */
+int fuse_passthrough_getattr(struct inode *inode, struct kstat *stat,
+			     u32 request_mask, unsigned int flags)
+{
+	struct fuse_inode *fi = get_fuse_inode(inode);
+	struct fuse_conn *fc = get_fuse_conn(inode);
+	const struct cred *old_cred;
+	struct fuse_backing *fb;
+	struct kstat bstat;
+	int err;
+
+	fb = fuse_inode_backing_cache_get(fi);
+	if (!fb)
+		return -ENOENT;
+
+	old_cred = override_creds(fb->cred);
+	err = vfs_getattr(&fb->file->f_path, &bstat, request_mask, flags);
+	revert_creds(old_cred);
+	fuse_backing_put(fb);
+	if (err)
+		return err;
+
+	spin_lock(&fi->lock);
+	fi->attr_version = atomic64_inc_return(&fc->attr_version);
+	i_size_write(inode, bstat.size);
+	inode->i_blocks = bstat.blocks;
+	inode_set_atime_to_ts(inode, bstat.atime);
+	inode_set_mtime_to_ts(inode, bstat.mtime);
+	inode_set_ctime_to_ts(inode, bstat.ctime);
+	if (stat) {
+		generic_fillattr(&nop_mnt_idmap, request_mask, inode, stat);
+		stat->mode = fi->orig_i_mode;
+		stat->ino = fi->orig_ino;
+		stat->blksize = bstat.blksize;
+		if (bstat.result_mask & STATX_BTIME) {
+			stat->btime = bstat.btime;
+			stat->result_mask |= STATX_BTIME;
+		}
+	}
+	spin_unlock(&fi->lock);
+
+	return 0;
+}
@@ -697,6 +697,26 @@ static void terminate_walk(struct nameidata *nd)
 	nd->path.dentry = NULL;
 }
 
+/*
+ * Why RCU-walk gave up, reported through the fs.rcu-walk-stats sysctl.
+ */
+enum {
+	RCU_WALK_UNLAZY,	/* switched to ref-walk in the middle of a walk */
+	RCU_WALK_FAIL_LINKS,	/* a symlink on the stack changed */
+	RCU_WALK_FAIL_PATH,	/* the current dentry or mount changed */
+	RCU_WALK_FAIL_DENTRY,	/* the next dentry changed */
+	RCU_WALK_FAIL_ROOT,	/* the root changed */
+	RCU_WALK_RESTART,	/* the whole walk was redone in ref-walk */
+	RCU_WALK_NR_STATS
+};
+
+static DEFINE_PER_CPU(unsigned long, rcu_walk_stats[RCU_WALK_NR_STATS]);
+
+static inline void rcu_walk_stat(int why)
+{
+	this_cpu_inc(rcu_walk_stats[why]);
+}
+
 /* path_put is needed afterwards regardless of success or failure */
 static bool __legitimize_path(struct path *path, unsigned seq, unsigned mseq)
 {
@@ -776,14 +796,21 @@ static bool try_to_unlazy(struct nameidata *nd)
 
 	BUG_ON(!(nd->flags & LOOKUP_RCU));
 
-	if (unlikely(!legitimize_links(nd)))
+	if (unlikely(!legitimize_links(nd))) {
+		rcu_walk_stat(RCU_WALK_FAIL_LINKS);
 		goto out1;
-	if (unlikely(!legitimize_path(nd, &nd->path, nd->seq)))
+	}
+	if (unlikely(!legitimize_path(nd, &nd->path, nd->seq))) {
+		rcu_walk_stat(RCU_WALK_FAIL_PATH);
 		goto out;
-	if (unlikely(!legitimize_root(nd)))
+	}
+	if (unlikely(!legitimize_root(nd))) {
+		rcu_walk_stat(RCU_WALK_FAIL_ROOT);
 		goto out;
+	}
 	leave_rcu(nd);
 	BUG_ON(nd->inode != parent->d_inode);
+	rcu_walk_stat(RCU_WALK_UNLAZY);
 	return true;
 
 out1:
@@ -811,16 +838,21 @@ static bool try_to_unlazy_next(struct nameidata *nd, struct dentry *dentry)
 	int res;
 	BUG_ON(!(nd->flags & LOOKUP_RCU));
 
-	if (unlikely(!legitimize_links(nd)))
+	if (unlikely(!legitimize_links(nd))) {
+		rcu_walk_stat(RCU_WALK_FAIL_LINKS);
 		goto out2;
+	}
 	res = __legitimize_mnt(nd->path.mnt, nd->m_seq);
 	if (unlikely(res)) {
+		rcu_walk_stat(RCU_WALK_FAIL_PATH);
 		if (res > 0)
 			goto out2;
 		goto out1;
 	}
-	if (unlikely(!lockref_get_not_dead(&nd->path.dentry->d_lockref)))
+	if (unlikely(!lockref_get_not_dead(&nd->path.dentry->d_lockref))) {
+		rcu_walk_stat(RCU_WALK_FAIL_PATH);
 		goto out1;
+	}
 
 	/*
 	 * We need to move both the parent and the dentry from the RCU domain
@@ -829,17 +861,24 @@ static bool try_to_unlazy_next(struct nameidata *nd, struct dentry *dentry)
 	 * number of the parent after we got the child sequence number. So we
 	 * know the parent must still be valid if the child sequence number is
 	 */
-	if (unlikely(!lockref_get_not_dead(&dentry->d_lockref)))
+	if (unlikely(!lockref_get_not_dead(&dentry->d_lockref))) {
+		rcu_walk_stat(RCU_WALK_FAIL_DENTRY);
 		goto out;
-	if (read_seqcount_retry(&dentry->d_seq, nd->next_seq))
+	}
+	if (read_seqcount_retry(&dentry->d_seq, nd->next_seq)) {
+		rcu_walk_stat(RCU_WALK_FAIL_DENTRY);
 		goto out_dput;
+	}
 	/*
 	 * Sequence counts matched. Now make sure that the root is
 	 * still valid and get it if required.
 	 */
-	if (unlikely(!legitimize_root(nd)))
+	if (unlikely(!legitimize_root(nd))) {
+		rcu_walk_stat(RCU_WALK_FAIL_ROOT);
 		goto out_dput;
+	}
 	leave_rcu(nd);
+	rcu_walk_stat(RCU_WALK_UNLAZY);
 	return true;
 
 out2:
@@ -1033,6 +1072,22 @@ static int sysctl_protected_fifos __read_mostly;
 static int sysctl_protected_regular __read_mostly;
 
 #ifdef CONFIG_SYSCTL
+static int proc_rcu_walk_stats(struct ctl_table *table, int write,
+			       void *buffer, size_t *lenp, loff_t *ppos)
+{
+	unsigned long stats[RCU_WALK_NR_STATS] = { };
+	struct ctl_table t = *table;
+	int cpu, i;
+
+	for_each_possible_cpu(cpu)
+		for (i = 0; i < RCU_WALK_NR_STATS; i++)
+			stats[i] += per_cpu(rcu_walk_stats[i], cpu);
+
+	t.data = stats;
+	t.maxlen = sizeof(stats);
+	return proc_doulongvec_minmax(&t, write, buffer, lenp, ppos);
+}
+
 static struct ctl_table namei_sysctls[] = {
 	{
 		.procname	= "protected_symlinks",
@@ -1070,6 +1125,13 @@ static struct ctl_table namei_sysctls[] = {
 		.extra1		= SYSCTL_ZERO,
 		.extra2		= SYSCTL_TWO,
 	},
+	{
+		/* unlazy links path dentry root restart */
+		.procname	= "rcu-walk-stats",
+		.maxlen		= RCU_WALK_NR_STATS * sizeof(unsigned long),
+		.mode		= 0444,
+		.proc_handler	= proc_rcu_walk_stats,
+	},
 };
 
 static int __init init_fs_namei_sysctls(void)
@@ -2520,8 +2582,10 @@ int filename_lookup(int dfd, struct filename *name, unsigned flags,
 		return PTR_ERR(name);
 	set_nameidata(&nd, dfd, name, root);
 	retval = path_lookupat(&nd, flags | LOOKUP_RCU, path);
-	if (unlikely(retval == -ECHILD))
+	if (unlikely(retval == -ECHILD)) {
+		rcu_walk_stat(RCU_WALK_RESTART);
 		retval = path_lookupat(&nd, flags, path);
+	}
 	if (unlikely(retval == -ESTALE))
 		retval = path_lookupat(&nd, flags | LOOKUP_REVAL, path);
 
@@ -2562,8 +2626,10 @@ static int __filename_parentat(int dfd, struct filename *name,
 		return PTR_ERR(name);
 	set_nameidata(&nd, dfd, name, root);
 	retval = path_parentat(&nd, flags | LOOKUP_RCU, parent);
-	if (unlikely(retval == -ECHILD))
+	if (unlikely(retval == -ECHILD)) {
+		rcu_walk_stat(RCU_WALK_RESTART);
 		retval = path_parentat(&nd, flags, parent);
+	}
 	if (unlikely(retval == -ESTALE))
 		retval = path_parentat(&nd, flags | LOOKUP_REVAL, parent);
 	if (likely(!retval)) {
@@ -3838,8 +3904,10 @@ struct file *do_filp_open(int dfd, struct filename *pathname,
 
 	set_nameidata(&nd, dfd, pathname, NULL);
 	filp = path_openat(&nd, op, flags | LOOKUP_RCU);
-	if (unlikely(filp == ERR_PTR(-ECHILD)))
+	if (unlikely(filp == ERR_PTR(-ECHILD))) {
+		rcu_walk_stat(RCU_WALK_RESTART);
 		filp = path_openat(&nd, op, flags);
+	}
 	if (unlikely(filp == ERR_PTR(-ESTALE)))
 		filp = path_openat(&nd, op, flags | LOOKUP_REVAL);
 	restore_nameidata();
@@ -3863,8 +3931,10 @@ struct file *do_file_open_root(const struct path *root,
 
 	set_nameidata(&nd, -1, filename, root);
 	file = path_openat(&nd, op, flags | LOOKUP_RCU);
-	if (unlikely(file == ERR_PTR(-ECHILD)))
+	if (unlikely(file == ERR_PTR(-ECHILD))) {
+		rcu_walk_stat(RCU_WALK_RESTART);
 		file = path_openat(&nd, op, flags);
+	}
 	if (unlikely(file == ERR_PTR(-ESTALE)))
 		file = path_openat(&nd, op, flags | LOOKUP_REVAL);
 	restore_nameidata();
@@ -82,6 +82,8 @@ static int fscache_begin_operation(struct netfs_cache_resources *cres,
 	cres->cache_priv2	= NULL;
 	cres->debug_id		= cookie->debug_id;
 	cres->inval_counter	= cookie->inval_counter;
+	cres->data_start	= 0;
+	cres->data_end		= 0;
 
 	if (!fscache_begin_cookie_access(cookie, why)) {
 		cres->cache_priv = NULL;
@@ -50,6 +50,25 @@ atomic_t fscache_n_culled;
 EXPORT_SYMBOL(fscache_n_culled);
 atomic_t fscache_n_dio_misfit;
 EXPORT_SYMBOL(fscache_n_dio_misfit);
+atomic_t fscache_n_read_lat[FSCACHE_IO_LAT_BUCKETS];
+EXPORT_SYMBOL(fscache_n_read_lat);
+atomic_t fscache_n_write_lat[FSCACHE_IO_LAT_BUCKETS];
+EXPORT_SYMBOL(fscache_n_write_lat);
+
+/*
+ * display a latency histogram, one "<bound>=<count>" pair per bucket
+ */
+static void fscache_show_latency(struct seq_file *m, const char *name,
+				 atomic_t *hist)
+{
+	int i;
+
+	seq_printf(m, "%s:", name);
+	for (i = 0; i < FSCACHE_IO_LAT_BUCKETS - 1; i++)
+		seq_printf(m, " <%uus=%u", 1U << i, atomic_read(&hist[i]));
+	seq_printf(m, " >=%uus=%u\n", 1U << (FSCACHE_IO_LAT_BUCKETS - 2),
+		   atomic_read(&hist[i]));
+}
 
 /*
  * display the general statistics
@@ -99,5 +118,8 @@ int fscache_stats_show(struct seq_file *m)
 		   atomic_read(&fscache_n_read),
 		   atomic_read(&fscache_n_write),
 		   atomic_read(&fscache_n_dio_misfit));
+
+	fscache_show_latency(m, "RdLat  ", fscache_n_read_lat);
+	fscache_show_latency(m, "WrLat  ", fscache_n_write_lat);
 	return 0;
 }
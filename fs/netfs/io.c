@@ -12,6 +12,7 @@
 #include <linux/pagemap.h>
 #include <linux/slab.h>
 #include <linux/uio.h>
+#include <linux/blkdev.h>
 #include <linux/sched/mm.h>
 #include <linux/task_io_accounting_ops.h>
 #include "internal.h"
@@ -568,6 +569,7 @@ static bool netfs_rreq_submit_slice(struct netfs_io_request *rreq,
 int netfs_begin_read(struct netfs_io_request *rreq, bool sync)
 {
 	struct iov_iter io_iter;
+	struct blk_plug plug;
 	int ret;
 
 	kenter("R=%x %llx-%llx",
@@ -587,11 +589,13 @@ int netfs_begin_read(struct netfs_io_request *rreq, bool sync)
 	INIT_WORK(&rreq->work, netfs_rreq_work);
 
 	/* Chop the read into slices according to what the cache and the netfs
-	 * want and submit each one.
+	 * want and submit each one.  The cache DIO for consecutive slices is
+	 * plugged so that it reaches the backing device as one batch.
 	 */
 	netfs_get_request(rreq, netfs_rreq_trace_get_for_outstanding);
 	atomic_set(&rreq->nr_outstanding, 1);
 	io_iter = rreq->io_iter;
+	blk_start_plug(&plug);
 	do {
 		kdebug("submit %llx + %llx >= %llx",
 		       rreq->start, rreq->submitted, rreq->i_size);
@@ -605,6 +609,7 @@ int netfs_begin_read(struct netfs_io_request *rreq, bool sync)
 			break;
 
 	} while (rreq->submitted < rreq->len);
+	blk_finish_plug(&plug);
 
 	if (!rreq->submitted) {
 		netfs_put_request(rreq, false, netfs_rreq_trace_put_no_submit);
@@ -140,6 +140,9 @@ struct nfsd_net {
 	struct svc_info nfsd_info;
 #define nfsd_serv nfsd_info.serv
 
+	/* adds threads to congested pools, see nfsd_max_threads */
+	struct work_struct nfsd_grow_work;
+
 
 	/*
 	 * clientid and stateid data for construction of net unique COPY
@@ -191,6 +194,9 @@ struct nfsd_net {
 
 	struct shrinker		*nfsd_reply_cache_shrinker;
 
+	/* trims expired entries off the lookup path */
+	struct delayed_work	drc_prune_work;
+
 	/* tracking server-to-server copy mounts */
 	spinlock_t              nfsd_ssc_lock;
 	struct list_head        nfsd_ssc_mount_list;
@@ -29,10 +29,14 @@
  */
 #define TARGET_BUCKET_SIZE	64
 
+/* How long expired entries may linger before the prune worker runs */
+#define NFSD_DRC_PRUNE_DELAY	(HZ / 10)
+
 struct nfsd_drc_bucket {
 	struct rb_root rb_head;
 	struct list_head lru_head;
 	spinlock_t cache_lock;
+	unsigned long contended;	/* under cache_lock */
 };
 
 static struct kmem_cache	*drc_slab;
@@ -42,6 +46,18 @@ static unsigned long nfsd_reply_cache_count(struct shrinker *shrink,
 					    struct shrink_control *sc);
 static unsigned long nfsd_reply_cache_scan(struct shrinker *shrink,
 					   struct shrink_control *sc);
+static void nfsd_reply_cache_prune_worker(struct work_struct *work);
+
+/*
+ * Take a bucket lock, counting the times it had to be waited for.
+ */
+static void nfsd_drc_bucket_lock(struct nfsd_drc_bucket *b)
+{
+	if (spin_trylock(&b->cache_lock))
+		return;
+	spin_lock(&b->cache_lock);
+	b->contended++;
+}
 
 /*
  * Put a cap on the size of the DRC based on the amount of available
@@ -158,7 +174,7 @@ static void
 nfsd_reply_cache_free(struct nfsd_drc_bucket *b, struct nfsd_cacherep *rp,
 			struct nfsd_net *nn)
 {
-	spin_lock(&b->cache_lock);
+	nfsd_drc_bucket_lock(b);
 	nfsd_cacherep_unlink_locked(nn, b, rp);
 	spin_unlock(&b->cache_lock);
 	nfsd_cacherep_free(rp);
@@ -207,6 +223,7 @@ int nfsd_reply_cache_init(struct nfsd_net *nn)
 		spin_lock_init(&nn->drc_hashtbl[i].cache_lock);
 	}
 	nn->drc_hashsize = hashsize;
+	INIT_DELAYED_WORK(&nn->drc_prune_work, nfsd_reply_cache_prune_worker);
 
 	return 0;
 out_shrinker:
@@ -221,6 +238,7 @@ void nfsd_reply_cache_shutdown(struct nfsd_net *nn)
 	unsigned int i;
 
 	shrinker_free(nn->nfsd_reply_cache_shrinker);
+	cancel_delayed_work_sync(&nn->drc_prune_work);
 
 	for (i = 0; i < nn->drc_hashsize; i++) {
 		struct list_head *head = &nn->drc_hashtbl[i].lru_head;
@@ -334,7 +352,7 @@ nfsd_reply_cache_scan(struct shrinker *shrink, struct shrink_control *sc)
 		if (list_empty(&b->lru_head))
 			continue;
 
-		spin_lock(&b->cache_lock);
+		nfsd_drc_bucket_lock(b);
 		nfsd_prune_bucket_locked(nn, b, 0, &dispose);
 		spin_unlock(&b->cache_lock);
 
@@ -345,6 +363,57 @@ nfsd_reply_cache_scan(struct shrinker *shrink, struct shrink_control *sc)
 	return freed;
 }
 
+/*
+ * Remove the expired entries from every bucket. Lookups only queue this
+ * instead of pruning their bucket themselves, so that the bucket lock is
+ * held just for the search and insert on the hot path.
+ */
+static void nfsd_reply_cache_prune_worker(struct work_struct *work)
+{
+	struct nfsd_net *nn = container_of(to_delayed_work(work),
+					   struct nfsd_net, drc_prune_work);
+	LIST_HEAD(dispose);
+	unsigned int i;
+
+	for (i = 0; i < nn->drc_hashsize; i++) {
+		struct nfsd_drc_bucket *b = &nn->drc_hashtbl[i];
+
+		if (list_empty(&b->lru_head))
+			continue;
+
+		nfsd_drc_bucket_lock(b);
+		nfsd_prune_bucket_locked(nn, b, 0, &dispose);
+		spin_unlock(&b->cache_lock);
+
+		nfsd_cacherep_dispose(&dispose);
+		cond_resched();
+	}
+}
+
+/*
+ * Called with the bucket lock held after an insert: defer the trimming of
+ * expired entries to the prune worker, unless the cache is over its size
+ * limit, in which case a few entries are freed right away.
+ */
+static void
+nfsd_prune_bucket_deferred(struct nfsd_net *nn, struct nfsd_drc_bucket *b,
+			   struct list_head *dispose)
+{
+	struct nfsd_cacherep *oldest;
+
+	if (atomic_read(&nn->num_drc_entries) > nn->max_drc_entries) {
+		nfsd_prune_bucket_locked(nn, b, 3, dispose);
+		return;
+	}
+
+	oldest = list_first_entry_or_null(&b->lru_head, struct nfsd_cacherep,
+					  c_lru);
+	if (oldest && time_before(oldest->c_timestamp, jiffies - RC_EXPIRE) &&
+	    !delayed_work_pending(&nn->drc_prune_work))
+		queue_delayed_work(system_unbound_wq, &nn->drc_prune_work,
+				   NFSD_DRC_PRUNE_DELAY);
+}
+
 /**
  * nfsd_cache_csum - Checksum incoming NFS Call arguments
  * @buf: buffer containing a whole RPC Call message
@@ -503,13 +572,13 @@ int nfsd_cache_lookup(struct svc_rqst *rqstp, unsigned int start,
 		goto out;
 
 	b = nfsd_cache_bucket_find(rqstp->rq_xid, nn);
-	spin_lock(&b->cache_lock);
+	nfsd_drc_bucket_lock(b);
 	found = nfsd_cache_insert(b, rp, nn);
 	if (found != rp)
 		goto found_entry;
 	*cacherep = rp;
 	rp->c_state = RC_INPROG;
-	nfsd_prune_bucket_locked(nn, b, 3, &dispose);
+	nfsd_prune_bucket_deferred(nn, b, &dispose);
 	spin_unlock(&b->cache_lock);
 
 	nfsd_cacherep_dispose(&dispose);
@@ -626,7 +695,7 @@ void nfsd_cache_update(struct svc_rqst *rqstp, struct nfsd_cacherep *rp,
 		nfsd_reply_cache_free(b, rp, nn);
 		return;
 	}
-	spin_lock(&b->cache_lock);
+	nfsd_drc_bucket_lock(b);
 	nfsd_stats_drc_mem_usage_add(nn, bufsize);
 	lru_put_end(b, rp);
 	rp->c_secure = test_bit(RQ_SECURE, &rqstp->rq_flags);
@@ -658,6 +727,18 @@ int nfsd_reply_cache_stats_show(struct seq_file *m, void *v)
 {
 	struct nfsd_net *nn = net_generic(file_inode(m->file)->i_sb->s_fs_info,
 					  nfsd_net_id);
+	unsigned long contended = 0, hottest = 0;
+	unsigned int i, hottest_bucket = 0;
+
+	for (i = 0; i < nn->drc_hashsize; i++) {
+		unsigned long c = READ_ONCE(nn->drc_hashtbl[i].contended);
+
+		contended += c;
+		if (c > hottest) {
+			hottest = c;
+			hottest_bucket = i;
+		}
+	}
 
 	seq_printf(m, "max entries:           %u\n", nn->max_drc_entries);
 	seq_printf(m, "num entries:           %u\n",
@@ -675,5 +756,7 @@ int nfsd_reply_cache_stats_show(struct seq_file *m, void *v)
 		   percpu_counter_sum_positive(&nn->counter[NFSD_STATS_PAYLOAD_MISSES]));
 	seq_printf(m, "longest chain len:     %u\n", nn->longest_chain);
 	seq_printf(m, "cachesize at longest:  %u\n", nn->longest_chain_cachesize);
+	seq_printf(m, "bucket contention:     %lu\n", contended);
+	seq_printf(m, "hottest bucket:        %u (%lu)\n", hottest_bucket, hottest);
 	return 0;
 }
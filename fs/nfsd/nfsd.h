@@ -113,6 +113,7 @@ int		nfsd_set_nrthreads(int n, int *, struct net *);
 int		nfsd_pool_stats_open(struct inode *, struct file *);
 int		nfsd_pool_stats_release(struct inode *, struct file *);
 void		nfsd_shutdown_threads(struct net *net);
+void		nfsd_grow_threads(struct work_struct *work);
 
 bool		i_am_nfsd(void);
 
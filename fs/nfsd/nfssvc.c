@@ -642,6 +642,73 @@ void nfsd_shutdown_threads(struct net *net)
 	mutex_unlock(&nfsd_mutex);
 }
 
+/*
+ * Upper bound on the number of threads a service may grow to on its own
+ * when requests queue up in a pool whose threads are all busy. Zero
+ * disables dynamic sizing, the thread count then only changes when it is
+ * set through the nfsd filesystem or netlink.
+ */
+static unsigned int nfsd_max_threads;
+module_param(nfsd_max_threads, uint, 0644);
+MODULE_PARM_DESC(nfsd_max_threads,
+		 "Maximum number of threads to grow to under load. Default: 0 (off)");
+
+/**
+ * nfsd_grow_threads - add a thread to each congested pool
+ * @work: the nfsd_net's nfsd_grow_work
+ *
+ * Threads added here are removed again the next time the thread count
+ * is set explicitly.
+ */
+void nfsd_grow_threads(struct work_struct *work)
+{
+	struct nfsd_net *nn = container_of(work, struct nfsd_net,
+					   nfsd_grow_work);
+	unsigned int max = min_t(unsigned int, READ_ONCE(nfsd_max_threads),
+				 NFSD_MAXSERVS);
+	struct svc_serv *serv;
+	unsigned int i;
+
+	mutex_lock(&nfsd_mutex);
+	serv = nn->nfsd_serv;
+	if (!serv || !serv->sv_nrthreads)
+		goto out;
+
+	for (i = 0; i < serv->sv_nrpools; i++) {
+		struct svc_pool *pool = &serv->sv_pools[i];
+
+		if (!test_and_clear_bit(SP_CONGESTED, &pool->sp_flags))
+			continue;
+		if (serv->sv_nrthreads >= max)
+			break;
+		if (svc_set_num_threads(serv, pool,
+					atomic_read(&pool->sp_nrthreads) + 1))
+			break;
+	}
+out:
+	mutex_unlock(&nfsd_mutex);
+}
+
+/*
+ * Called by an nfsd thread between requests: if transports are still
+ * waiting in its pool after every thread was found busy, ask for one
+ * more thread in that pool.
+ */
+static void nfsd_check_congestion(struct nfsd_net *nn, struct svc_rqst *rqstp)
+{
+	struct svc_pool *pool = rqstp->rq_pool;
+
+	if (!READ_ONCE(nfsd_max_threads) ||
+	    !test_bit(SP_CONGESTED, &pool->sp_flags))
+		return;
+	if (lwq_empty(&pool->sp_xprts)) {
+		clear_bit(SP_CONGESTED, &pool->sp_flags);
+		return;
+	}
+	if (rqstp->rq_server->sv_nrthreads < READ_ONCE(nfsd_max_threads))
+		queue_work(system_unbound_wq, &nn->nfsd_grow_work);
+}
+
 bool i_am_nfsd(void)
 {
 	return kthread_func(current) == nfsd;
@@ -937,6 +1004,7 @@ nfsd(void *vrqstp)
 		svc_recv(rqstp);
 
 		nfsd_file_net_dispose(nn);
+		nfsd_check_congestion(nn, rqstp);
 	}
 
 	atomic_dec(&nfsd_th_cnt);
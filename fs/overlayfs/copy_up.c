@@ -254,6 +254,8 @@ static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
 	loff_t data_pos = -1;
 	loff_t hole_len;
 	bool skip_hole = false;
+	bool try_offload;
+	u64 start_ns = ktime_get_ns();
 	int error = 0;
 
 	ovl_path_lowerdata(dentry, &datapath);
@@ -265,10 +267,14 @@ static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
 	if (IS_ERR(old_file))
 		return PTR_ERR(old_file);
 
+	atomic_long_inc(&ofs->copy_up_files);
+
 	/* Try to use clone_file_range to clone up within the same fs */
 	cloned = vfs_clone_file_range(old_file, 0, new_file, 0, len, 0);
-	if (cloned == len)
+	if (cloned == len) {
+		atomic64_add(len, &ofs->copy_up_cloned);
 		goto out_fput;
+	}
 
 	/* Couldn't clone, so now we try to copy the data */
 	error = rw_verify_area(READ, old_file, &old_pos, len);
@@ -281,6 +287,15 @@ static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
 	if (old_file->f_mode & FMODE_LSEEK)
 		skip_hole = true;
 
+	/*
+	 * Let a lower fs that can copy without moving the data through the
+	 * page cache, e.g. with a server side copy, do so. Anything else is
+	 * no better than splicing it ourselves.
+	 */
+	try_offload = old_file->f_op->copy_file_range &&
+		      old_file->f_op->copy_file_range ==
+		      new_file->f_op->copy_file_range;
+
 	while (len) {
 		size_t this_len = OVL_COPY_UP_CHUNK_SIZE;
 		ssize_t bytes;
@@ -331,6 +346,21 @@ static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
 		if (error)
 			break;
 
+		if (try_offload) {
+			bytes = vfs_copy_file_range(old_file, old_pos,
+						    new_file, new_pos,
+						    this_len, 0);
+			if (bytes > 0) {
+				old_pos += bytes;
+				new_pos += bytes;
+				len -= bytes;
+				atomic64_add(bytes, &ofs->copy_up_offloaded);
+				continue;
+			}
+			/* fall back to splice for the rest of the file */
+			try_offload = false;
+		}
+
 		bytes = do_splice_direct(old_file, &old_pos,
 					 new_file, &new_pos,
 					 this_len, SPLICE_F_MOVE);
@@ -341,10 +371,13 @@ static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
 		WARN_ON(old_pos != new_pos);
 
 		len -= bytes;
+		atomic64_add(bytes, &ofs->copy_up_spliced);
 	}
 	if (!error && ovl_should_sync(ofs))
 		error = vfs_fsync(new_file, 0);
 out_fput:
+	atomic64_add(div_u64(ktime_get_ns() - start_ns, NSEC_PER_USEC),
+		     &ofs->copy_up_time_us);
 	fput(old_file);
 	return error;
 }
@@ -627,8 +660,12 @@ static int ovl_copy_up_data(struct ovl_copy_up_ctx *c, const struct path *temp)
 	struct file *new_file;
 	int err;
 
-	if (!S_ISREG(c->stat.mode) || c->metacopy || !c->stat.size)
+	if (!S_ISREG(c->stat.mode) || !c->stat.size)
 		return 0;
+	if (c->metacopy) {
+		atomic_long_inc(&ofs->copy_up_metacopy);
+		return 0;
+	}
 
 	new_file = ovl_path_open(temp, O_LARGEFILE | O_WRONLY);
 	if (IS_ERR(new_file))
@@ -859,7 +896,9 @@ static int ovl_copy_up_tmpfile(struct ovl_copy_up_ctx *c)
 		return PTR_ERR(tmpfile);
 
 	temp = tmpfile->f_path.dentry;
-	if (!c->metacopy && c->stat.size) {
+	if (c->metacopy && c->stat.size) {
+		atomic_long_inc(&ofs->copy_up_metacopy);
+	} else if (c->stat.size) {
 		err = ovl_copy_up_file(ofs, c->dentry, tmpfile, c->stat.size);
 		if (err)
 			goto out_fput;
@@ -90,6 +90,13 @@ struct ovl_fs {
 	bool no_shared_whiteout;
 	/* r/o snapshot of upperdir sb's only taken on volatile mounts */
 	errseq_t errseq;
+	/* Data copy-up stats, shown in /proc/self/mountstats */
+	atomic_long_t copy_up_files;
+	atomic_long_t copy_up_metacopy;
+	atomic64_t copy_up_cloned;	/* bytes */
+	atomic64_t copy_up_offloaded;	/* bytes, by ->copy_file_range() */
+	atomic64_t copy_up_spliced;	/* bytes */
+	atomic64_t copy_up_time_us;
 };
 
 /* Number of lower layers, not including data-only layers */
@@ -264,6 +264,25 @@ static int ovl_statfs(struct dentry *dentry, struct kstatfs *buf)
 	return err;
 }
 
+static int ovl_show_stats(struct seq_file *m, struct dentry *dentry)
+{
+	struct ovl_fs *ofs = OVL_FS(dentry->d_sb);
+
+	seq_printf(m, "\n\tcopy_up_files: %lu\n",
+		   atomic_long_read(&ofs->copy_up_files));
+	seq_printf(m, "\tcopy_up_metacopy: %lu\n",
+		   atomic_long_read(&ofs->copy_up_metacopy));
+	seq_printf(m, "\tcopy_up_cloned_bytes: %lld\n",
+		   atomic64_read(&ofs->copy_up_cloned));
+	seq_printf(m, "\tcopy_up_offloaded_bytes: %lld\n",
+		   atomic64_read(&ofs->copy_up_offloaded));
+	seq_printf(m, "\tcopy_up_spliced_bytes: %lld\n",
+		   atomic64_read(&ofs->copy_up_spliced));
+	seq_printf(m, "\tcopy_up_time_us: %lld\n",
+		   atomic64_read(&ofs->copy_up_time_us));
+	return 0;
+}
+
 static const struct super_operations ovl_super_operations = {
 	.alloc_inode	= ovl_alloc_inode,
 	.free_inode	= ovl_free_inode,
@@ -273,6 +292,7 @@ static const struct super_operations ovl_super_operations = {
 	.sync_fs	= ovl_sync_fs,
 	.statfs		= ovl_statfs,
 	.show_options	= ovl_show_options,
+	.show_stats	= ovl_show_stats,
 };
 
 #define OVL_WORKDIR_NAME "work"
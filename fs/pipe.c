@@ -133,7 +133,8 @@ static bool anon_pipe_buf_try_steal(struct pipe_inode_info *pipe,
 {
 	struct page *page = buf->page;
 
-	if (page_count(page) != 1)
+	/* Stealers expect a single page, not a large pipe buffer */
+	if (page_count(page) != 1 || PageCompound(page))
 		return false;
 	memcg_kmem_uncharge_page(page, 0);
 	__SetPageLocked(page);
@@ -413,6 +414,36 @@ static inline int is_packetized(struct file *file)
 	return (file->f_flags & O_DIRECT) != 0;
 }
 
+/*
+ * Get a page for a new buffer of pipe_write(), a large one of the pipe's
+ * buffer order if the write can fill more than a single page.
+ */
+static struct page *pipe_alloc_buf_page(struct pipe_inode_info *pipe,
+					unsigned int order)
+{
+	struct page *page = pipe->tmp_page;
+
+	if (page) {
+		pipe->tmp_page = NULL;
+		if (compound_order(page) == order)
+			return page;
+		put_page(page);
+	}
+
+	if (order) {
+		/*
+		 * Large buffers come from lowmem, so that the consumers that
+		 * kmap the page of a buffer can reach all of its data.
+		 */
+		page = alloc_pages(GFP_USER | __GFP_ACCOUNT | __GFP_COMP |
+				   __GFP_NORETRY | __GFP_NOWARN, order);
+		if (page)
+			return page;
+	}
+
+	return alloc_page(GFP_HIGHUSER | __GFP_ACCOUNT);
+}
+
 /* Done while waiting without holding the pipe lock - thus the READ_ONCE() */
 static inline bool pipe_writable(const struct pipe_inode_info *pipe)
 {
@@ -466,18 +497,23 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 	 *
 	 * That naturally merges small writes, but it also
 	 * page-aligns the rest of the writes for large writes
-	 * spanning multiple pages.
+	 * spanning multiple pages. A large last buffer may
+	 * take all of the write.
 	 */
 	head = pipe->head;
 	was_empty = pipe_empty(head, pipe->tail);
 	chars = total_len & (PAGE_SIZE-1);
-	if (chars && !was_empty) {
+	if (!was_empty) {
 		unsigned int mask = pipe->ring_size - 1;
 		struct pipe_buffer *buf = &pipe->bufs[(head - 1) & mask];
 		int offset = buf->offset + buf->len;
 
 		if ((buf->flags & PIPE_BUF_FLAG_CAN_MERGE) &&
-		    offset + chars <= PAGE_SIZE) {
+		    offset + total_len <= page_size(buf->page))
+			chars = total_len;
+
+		if (chars && (buf->flags & PIPE_BUF_FLAG_CAN_MERGE) &&
+		    offset + chars <= page_size(buf->page)) {
 			ret = pipe_buf_confirm(pipe, buf);
 			if (ret)
 				goto out;
@@ -506,17 +542,20 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 		if (!pipe_full(head, pipe->tail, pipe->max_usage)) {
 			unsigned int mask = pipe->ring_size - 1;
 			struct pipe_buffer *buf;
-			struct page *page = pipe->tmp_page;
+			unsigned int order = 0;
+			struct page *page;
+			size_t size;
 			int copied;
 
-			if (!page) {
-				page = alloc_page(GFP_HIGHUSER | __GFP_ACCOUNT);
-				if (unlikely(!page)) {
-					ret = ret ? : -ENOMEM;
-					break;
-				}
-				pipe->tmp_page = page;
+			if (iov_iter_count(from) > PAGE_SIZE && !is_packetized(filp))
+				order = pipe->buf_order;
+
+			page = pipe_alloc_buf_page(pipe, order);
+			if (unlikely(!page)) {
+				ret = ret ? : -ENOMEM;
+				break;
 			}
+			size = page_size(page);
 
 			/* Allocate a slot in the ring in advance and attach an
 			 * empty buffer.  If we fault or otherwise fail to use
@@ -535,10 +574,9 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 				buf->flags = PIPE_BUF_FLAG_PACKET;
 			else
 				buf->flags = PIPE_BUF_FLAG_CAN_MERGE;
-			pipe->tmp_page = NULL;
 
-			copied = copy_page_from_iter(page, 0, PAGE_SIZE, from);
-			if (unlikely(copied < PAGE_SIZE && iov_iter_count(from))) {
+			copied = copy_page_from_iter(page, 0, size, from);
+			if (unlikely(copied < size && iov_iter_count(from))) {
 				if (!ret)
 					ret = -EFAULT;
 				break;
@@ -857,7 +895,7 @@ void free_pipe_info(struct pipe_inode_info *pipe)
 		put_watch_queue(pipe->watch_queue);
 #endif
 	if (pipe->tmp_page)
-		__free_page(pipe->tmp_page);
+		put_page(pipe->tmp_page);
 	kfree(pipe->bufs);
 	kfree(pipe);
 }
@@ -1255,6 +1293,14 @@ unsigned int round_pipe_size(unsigned int size)
 	return roundup_pow_of_two(size);
 }
 
+/* Largest buffer pipe_write() allocates, see F_SETPIPE_BUF_SZ */
+#define PIPE_MAX_BUF_SIZE	(64 * 1024)
+
+static unsigned int pipe_capacity(const struct pipe_inode_info *pipe)
+{
+	return pipe->max_usage << (PAGE_SHIFT + pipe->buf_order);
+}
+
 /*
  * Resize the pipe ring to a number of slots.
  *
@@ -1330,22 +1376,28 @@ int pipe_resize_ring(struct pipe_inode_info *pipe, unsigned int nr_slots)
 /*
  * Allocate a new array of pipe buffers and copy the info over. Returns the
  * pipe size if successful, or return -ERROR on error.
+ *
+ * With large buffers (@order > 0) a slot may hold up to PAGE_SIZE << @order
+ * bytes, the user is accounted for that many pages per slot.
  */
-static long pipe_set_size(struct pipe_inode_info *pipe, unsigned int arg)
+static long pipe_set_size(struct pipe_inode_info *pipe, unsigned int arg,
+			  unsigned int order)
 {
 	unsigned long user_bufs;
-	unsigned int nr_slots, size;
+	unsigned int nr_slots, nr_pages, size;
 	long ret = 0;
 
 	if (pipe_has_watch_queue(pipe))
 		return -EBUSY;
 
 	size = round_pipe_size(arg);
-	nr_slots = size >> PAGE_SHIFT;
-
-	if (!nr_slots)
+	if (!size)
 		return -EINVAL;
 
+	nr_slots = max(size >> (PAGE_SHIFT + order), 1U);
+	nr_pages = nr_slots << order;
+	size = nr_pages << PAGE_SHIFT;
+
 	/*
 	 * If trying to increase the pipe capacity, check that an
 	 * unprivileged user is not trying to exceed various limits
@@ -1353,13 +1405,13 @@ static long pipe_set_size(struct pipe_inode_info *pipe, unsigned int arg)
 	 * Decreasing the pipe capacity is always permitted, even
 	 * if the user is currently over a limit.
 	 */
-	if (nr_slots > pipe->max_usage &&
+	if (nr_pages > pipe->nr_accounted &&
 			size > pipe_max_size && !capable(CAP_SYS_RESOURCE))
 		return -EPERM;
 
-	user_bufs = account_pipe_buffers(pipe->user, pipe->nr_accounted, nr_slots);
+	user_bufs = account_pipe_buffers(pipe->user, pipe->nr_accounted, nr_pages);
 
-	if (nr_slots > pipe->max_usage &&
+	if (nr_pages > pipe->nr_accounted &&
 			(too_many_pipe_buffers_hard(user_bufs) ||
 			 too_many_pipe_buffers_soft(user_bufs)) &&
 			pipe_is_unprivileged_user()) {
@@ -1371,13 +1423,50 @@ static long pipe_set_size(struct pipe_inode_info *pipe, unsigned int arg)
 	if (ret < 0)
 		goto out_revert_acct;
 
-	return pipe->max_usage * PAGE_SIZE;
+	pipe->buf_order = order;
+	pipe->nr_accounted = nr_pages;
+	return pipe_capacity(pipe);
 
 out_revert_acct:
-	(void) account_pipe_buffers(pipe->user, nr_slots, pipe->nr_accounted);
+	(void) account_pipe_buffers(pipe->user, nr_pages, pipe->nr_accounted);
 	return ret;
 }
 
+/*
+ * Grow the internal pipe of splice_direct_to_actor() towards @size bytes,
+ * within the limits an unprivileged F_SETPIPE_SZ would get. The transfer
+ * just runs in more rounds if that fails.
+ */
+void pipe_grow_direct(struct pipe_inode_info *pipe, size_t size)
+{
+	size = min_t(size_t, size, READ_ONCE(pipe_max_size));
+	if (size <= pipe_capacity(pipe))
+		return;
+
+	(void) pipe_set_size(pipe, size, pipe->buf_order);
+}
+
+/*
+ * Set the size of the buffers that large writes allocate, keeping the pipe
+ * capacity: a pipe of 64K with 16K buffers has four slots. Buffers written
+ * before keep their size.
+ */
+static long pipe_set_buf_size(struct pipe_inode_info *pipe, unsigned int arg)
+{
+	unsigned int size;
+	long ret;
+
+	size = arg <= PAGE_SIZE ? PAGE_SIZE : roundup_pow_of_two(arg);
+	if (size > max_t(unsigned int, PIPE_MAX_BUF_SIZE, PAGE_SIZE))
+		return -EINVAL;
+
+	ret = pipe_set_size(pipe, pipe_capacity(pipe), ilog2(size) - PAGE_SHIFT);
+	if (ret < 0)
+		return ret;
+
+	return PAGE_SIZE << pipe->buf_order;
+}
+
 /*
  * Note that i_pipe and i_cdev share the same location, so checking ->i_pipe is
  * not enough to verify that this is a pipe.
@@ -1406,10 +1495,16 @@ long pipe_fcntl(struct file *file, unsigned int cmd, unsigned int arg)
 
 	switch (cmd) {
 	case F_SETPIPE_SZ:
-		ret = pipe_set_size(pipe, arg);
+		ret = pipe_set_size(pipe, arg, pipe->buf_order);
 		break;
 	case F_GETPIPE_SZ:
-		ret = pipe->max_usage * PAGE_SIZE;
+		ret = pipe_capacity(pipe);
+		break;
+	case F_SETPIPE_BUF_SZ:
+		ret = pipe_set_buf_size(pipe, arg);
+		break;
+	case F_GETPIPE_BUF_SZ:
+		ret = PAGE_SIZE << pipe->buf_order;
 		break;
 	default:
 		ret = -EINVAL;
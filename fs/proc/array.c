@@ -424,6 +424,11 @@ static inline void task_thp_status(struct seq_file *m, struct mm_struct *mm)
 	if (thp_enabled)
 		thp_enabled = !test_bit(MMF_DISABLE_THP, &mm->flags);
 	seq_printf(m, "THP_enabled:\t%d\n", thp_enabled);
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	seq_printf(m, "THP_collapse_prio:\t%d\n", READ_ONCE(mm->khugepaged_prio));
+	seq_printf(m, "THP_collapse_scanned:\t%lu\n", mm->khugepaged_scanned);
+	seq_printf(m, "THP_collapsed:\t%lu\n", mm->khugepaged_collapsed);
+#endif
 }
 
 static inline void task_untag_mask(struct seq_file *m, struct mm_struct *mm)
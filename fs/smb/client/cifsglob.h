@@ -702,6 +702,7 @@ struct TCP_Server_Info {
 	unsigned int max_credits; /* can override large 32000 default at mnt */
 	unsigned int in_flight;  /* number of requests on the wire to server */
 	unsigned int max_in_flight; /* max number of requests that were on wire */
+	atomic64_t in_flight_bytes; /* payload of async reads/writes on the wire */
 	spinlock_t req_lock;  /* protect the two values above */
 	struct mutex _srv_mutex;
 	unsigned int nofs_flag;
@@ -4505,6 +4505,8 @@ smb2_readv_callback(struct mid_q_entry *mid)
 	struct cifs_credits credits = { .value = 0, .instance = 0 };
 	struct smb_rqst rqst = { .rq_iov = &rdata->iov[1], .rq_nvec = 1 };
 
+	atomic64_sub(rdata->subreq.len, &server->in_flight_bytes);
+
 	if (rdata->got_bytes) {
 		rqst.rq_iter	  = rdata->subreq.io_iter;
 		rqst.rq_iter_size = iov_iter_count(&rdata->subreq.io_iter);
@@ -4654,11 +4656,14 @@ smb2_async_readv(struct cifs_io_subrequest *rdata)
 		flags |= CIFS_HAS_CREDITS;
 	}
 
+	/* Taken before sending, the callback may already have run after */
+	atomic64_add(rdata->subreq.len, &server->in_flight_bytes);
 	rc = cifs_call_async(server, &rqst,
 			     cifs_readv_receive, smb2_readv_callback,
 			     smb3_handle_read_data, rdata, flags,
 			     &rdata->credits);
 	if (rc) {
+		atomic64_sub(rdata->subreq.len, &server->in_flight_bytes);
 		cifs_stats_fail_inc(io_parms.tcon, SMB2_READ_HE);
 		trace_smb3_read_err(rdata->rreq->debug_id,
 				    rdata->subreq.debug_index,
@@ -4770,6 +4775,8 @@ smb2_writev_callback(struct mid_q_entry *mid)
 	ssize_t result = 0;
 	size_t written;
 
+	atomic64_sub(wdata->subreq.len, &server->in_flight_bytes);
+
 	WARN_ONCE(wdata->server != mid->server,
 		  "wdata server %p != mid server %p",
 		  wdata->server, mid->server);
@@ -4858,6 +4865,7 @@ smb2_async_writev(struct cifs_io_subrequest *wdata)
 	struct cifs_io_parms _io_parms;
 	struct cifs_io_parms *io_parms = NULL;
 	int credit_request;
+	size_t len;
 
 	if (!wdata->server || test_bit(NETFS_SREQ_RETRYING, &wdata->subreq.flags))
 		server = wdata->server = cifs_pick_channel(tcon->ses);
@@ -4979,10 +4987,14 @@ smb2_async_writev(struct cifs_io_subrequest *wdata)
 		flags |= CIFS_HAS_CREDITS;
 	}
 
+	/* Taken before sending, as the callback may run before we return */
+	len = wdata->subreq.len;
+	atomic64_add(len, &server->in_flight_bytes);
 	rc = cifs_call_async(server, &rqst, NULL, smb2_writev_callback, NULL,
 			     wdata, flags, &wdata->credits);
 	/* Can't touch wdata if rc == 0 */
 	if (rc) {
+		atomic64_sub(len, &server->in_flight_bytes);
 		trace_smb3_write_err(xid,
 				     io_parms->persistent_fid,
 				     io_parms->tcon->tid,
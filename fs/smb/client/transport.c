@@ -1024,6 +1024,7 @@ struct TCP_Server_Info *cifs_pick_channel(struct cifs_ses *ses)
 {
 	uint index = 0;
 	unsigned int min_in_flight = UINT_MAX, max_in_flight = 0;
+	s64 min_bytes = S64_MAX, max_bytes = 0;
 	struct TCP_Server_Info *server = NULL;
 	int i;
 
@@ -1032,6 +1033,8 @@ struct TCP_Server_Info *cifs_pick_channel(struct cifs_ses *ses)
 
 	spin_lock(&ses->chan_lock);
 	for (i = 0; i < ses->chan_count; i++) {
+		s64 bytes;
+
 		server = ses->chans[i].server;
 		if (!server || server->terminate)
 			continue;
@@ -1046,17 +1049,26 @@ struct TCP_Server_Info *cifs_pick_channel(struct cifs_ses *ses)
 		 * that we could use a channel that's not least loaded. Avoiding
 		 * taking the lock could help reduce wait time, which is
 		 * important for this function
+		 *
+		 * A few large reads or writes load a channel more than many
+		 * small requests, so go by the bytes in flight first and by
+		 * the number of requests among channels with equal bytes.
 		 */
-		if (server->in_flight < min_in_flight) {
+		bytes = atomic64_read(&server->in_flight_bytes);
+		if (bytes < min_bytes ||
+		    (bytes == min_bytes && server->in_flight < min_in_flight)) {
+			min_bytes = bytes;
 			min_in_flight = server->in_flight;
 			index = i;
 		}
+		if (bytes > max_bytes)
+			max_bytes = bytes;
 		if (server->in_flight > max_in_flight)
 			max_in_flight = server->in_flight;
 	}
 
 	/* if all channels are equally loaded, fall back to round-robin */
-	if (min_in_flight == max_in_flight) {
+	if (min_bytes == max_bytes && min_in_flight == max_in_flight) {
 		index = (uint)atomic_inc_return(&ses->chan_seq);
 		index %= ses->chan_count;
 	}
@@ -1082,6 +1082,13 @@ ssize_t splice_direct_to_actor(struct file *in, struct splice_desc *sd,
 
 	WARN_ON_ONCE(!pipe_empty(pipe->head, pipe->tail));
 
+	/*
+	 * Large transfers, e.g. sendfile() of a big file to a socket, take
+	 * fewer rounds through the actor with a bigger pipe.
+	 */
+	if (len > PIPE_DEF_BUFFERS * PAGE_SIZE)
+		pipe_grow_direct(pipe, len);
+
 	while (len) {
 		size_t read_len;
 		loff_t pos = sd->pos, prev_pos = pos;
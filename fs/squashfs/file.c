@@ -34,6 +34,7 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -529,6 +530,70 @@ static int squashfs_readahead_fragment(struct page **page,
 	return error;
 }
 
+/* Max number of blocks a readahead call decompresses in parallel */
+#define SQUASHFS_RA_MAX_BLOCKS	8
+
+struct squashfs_ra_block {
+	struct work_struct		work;
+	struct super_block		*sb;
+	struct squashfs_page_actor	*actor;
+	struct page			**pages;
+	unsigned int			nr_pages;
+	unsigned int			expected;
+	bool				file_end;
+	u64				block;
+	int				bsize;
+	int				res;
+};
+
+static void squashfs_ra_release_pages(struct page **pages,
+				      unsigned int nr_pages)
+{
+	int i;
+
+	for (i = 0; i < nr_pages; i++) {
+		unlock_page(pages[i]);
+		put_page(pages[i]);
+	}
+}
+
+static void squashfs_ra_read_block(struct work_struct *work)
+{
+	struct squashfs_ra_block *rb =
+		container_of(work, struct squashfs_ra_block, work);
+
+	rb->res = squashfs_read_data(rb->sb, rb->block, rb->bsize, NULL,
+				     rb->actor);
+}
+
+static void squashfs_ra_finish_block(struct squashfs_ra_block *rb)
+{
+	struct page *last_page = squashfs_page_actor_free(rb->actor);
+	int i;
+
+	if (rb->res == rb->expected) {
+		int bytes;
+
+		/* Last page (if present) may have trailing bytes not filled */
+		bytes = rb->res % PAGE_SIZE;
+		if (rb->file_end && bytes && last_page)
+			memzero_page(last_page, bytes, PAGE_SIZE - bytes);
+
+		for (i = 0; i < rb->nr_pages; i++) {
+			flush_dcache_page(rb->pages[i]);
+			SetPageUptodate(rb->pages[i]);
+		}
+	}
+
+	squashfs_ra_release_pages(rb->pages, rb->nr_pages);
+}
+
+/*
+ * Readahead reads and decompresses up to as many consecutive blocks at once
+ * as the decompressor has streams for: the first block is done by the
+ * caller and the others are handed to unbound workers, so that the I/O and
+ * decompression of the blocks overlap.
+ */
 static void squashfs_readahead(struct readahead_control *ractl)
 {
 	struct inode *inode = ractl->mapping->host;
@@ -537,96 +602,102 @@ static void squashfs_readahead(struct readahead_control *ractl)
 	unsigned short shift = msblk->block_log - PAGE_SHIFT;
 	loff_t start = readahead_pos(ractl) & ~mask;
 	size_t len = readahead_length(ractl) + readahead_pos(ractl) - start;
-	struct squashfs_page_actor *actor;
+	int nr_parallel = clamp(msblk->max_thread_num, 1, SQUASHFS_RA_MAX_BLOCKS);
+	struct squashfs_ra_block *rbs;
 	unsigned int nr_pages = 0;
 	struct page **pages;
-	int i;
+	int i, nr_blocks;
 	loff_t file_end = i_size_read(inode) >> msblk->block_log;
 	unsigned int max_pages = 1UL << shift;
+	bool done = false;
 
 	readahead_expand(ractl, start, (len | mask) + 1);
 
-	pages = kmalloc_array(max_pages, sizeof(void *), GFP_KERNEL);
-	if (!pages)
-		return;
-
-	for (;;) {
-		pgoff_t index;
-		int res, bsize;
-		u64 block = 0;
-		unsigned int expected;
-		struct page *last_page;
-
-		expected = start >> msblk->block_log == file_end ?
-			   (i_size_read(inode) & (msblk->block_size - 1)) :
-			    msblk->block_size;
-
-		max_pages = (expected + PAGE_SIZE - 1) >> PAGE_SHIFT;
-
-		nr_pages = __readahead_batch(ractl, pages, max_pages);
-		if (!nr_pages)
-			break;
-
-		if (readahead_pos(ractl) >= i_size_read(inode))
-			goto skip_pages;
-
-		index = pages[0]->index >> shift;
+	rbs = kcalloc(nr_parallel, sizeof(*rbs), GFP_KERNEL);
+	pages = kmalloc_array(nr_parallel * max_pages, sizeof(void *),
+			      GFP_KERNEL);
+	if (!rbs || !pages)
+		goto out;
 
-		if ((pages[nr_pages - 1]->index >> shift) != index)
-			goto skip_pages;
+	while (!done) {
+		nr_blocks = 0;
+
+		while (nr_blocks < nr_parallel) {
+			struct squashfs_ra_block *rb = &rbs[nr_blocks];
+			struct page **batch = pages + nr_blocks * max_pages;
+			pgoff_t index;
+			int res, bsize;
+			u64 block = 0;
+			unsigned int expected;
+
+			expected = start >> msblk->block_log == file_end ?
+				   (i_size_read(inode) & (msblk->block_size - 1)) :
+				    msblk->block_size;
+
+			nr_pages = __readahead_batch(ractl, batch,
+					(expected + PAGE_SIZE - 1) >> PAGE_SHIFT);
+			if (!nr_pages) {
+				done = true;
+				break;
+			}
 
-		if (index == file_end && squashfs_i(inode)->fragment_block !=
-						SQUASHFS_INVALID_BLK) {
-			res = squashfs_readahead_fragment(pages, nr_pages,
-							  expected);
-			if (res)
+			if (readahead_pos(ractl) >= i_size_read(inode))
 				goto skip_pages;
-			continue;
-		}
 
-		bsize = read_blocklist(inode, index, &block);
-		if (bsize == 0)
-			goto skip_pages;
+			index = batch[0]->index >> shift;
 
-		actor = squashfs_page_actor_init_special(msblk, pages, nr_pages,
-							 expected);
-		if (!actor)
-			goto skip_pages;
+			if ((batch[nr_pages - 1]->index >> shift) != index)
+				goto skip_pages;
 
-		res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
+			if (index == file_end && squashfs_i(inode)->fragment_block !=
+							SQUASHFS_INVALID_BLK) {
+				res = squashfs_readahead_fragment(batch, nr_pages,
+								  expected);
+				if (res)
+					goto skip_pages;
+				continue;
+			}
 
-		last_page = squashfs_page_actor_free(actor);
+			bsize = read_blocklist(inode, index, &block);
+			if (bsize == 0)
+				goto skip_pages;
 
-		if (res == expected) {
-			int bytes;
+			rb->actor = squashfs_page_actor_init_special(msblk, batch,
+							nr_pages, expected);
+			if (!rb->actor)
+				goto skip_pages;
 
-			/* Last page (if present) may have trailing bytes not filled */
-			bytes = res % PAGE_SIZE;
-			if (index == file_end && bytes && last_page)
-				memzero_page(last_page, bytes,
-					     PAGE_SIZE - bytes);
+			rb->sb = inode->i_sb;
+			rb->pages = batch;
+			rb->nr_pages = nr_pages;
+			rb->expected = expected;
+			rb->file_end = index == file_end;
+			rb->block = block;
+			rb->bsize = bsize;
+			INIT_WORK(&rb->work, squashfs_ra_read_block);
+			if (nr_blocks)
+				queue_work(system_unbound_wq, &rb->work);
+			nr_blocks++;
+			continue;
 
-			for (i = 0; i < nr_pages; i++) {
-				flush_dcache_page(pages[i]);
-				SetPageUptodate(pages[i]);
-			}
+skip_pages:
+			squashfs_ra_release_pages(batch, nr_pages);
+			done = true;
+			break;
 		}
 
-		for (i = 0; i < nr_pages; i++) {
-			unlock_page(pages[i]);
-			put_page(pages[i]);
+		if (nr_blocks)
+			squashfs_ra_read_block(&rbs[0].work);
+		for (i = 0; i < nr_blocks; i++) {
+			if (i)
+				flush_work(&rbs[i].work);
+			squashfs_ra_finish_block(&rbs[i]);
 		}
 	}
 
+out:
 	kfree(pages);
-	return;
-
-skip_pages:
-	for (i = 0; i < nr_pages; i++) {
-		unlock_page(pages[i]);
-		put_page(pages[i]);
-	}
-	kfree(pages);
+	kfree(rbs);
 }
 
 const struct address_space_operations squashfs_aops = {
@@ -1498,7 +1498,8 @@ static int userfaultfd_register(struct userfaultfd_ctx *ctx,
 
 		/* CONTINUE ioctl is only supported for MINOR ranges. */
 		if (!(uffdio_register.mode & UFFDIO_REGISTER_MODE_MINOR))
-			ioctls_out &= ~((__u64)1 << _UFFDIO_CONTINUE);
+			ioctls_out &= ~((__u64)1 << _UFFDIO_CONTINUE |
+					(__u64)1 << _UFFDIO_CONTINUE_VEC);
 
 		/*
 		 * Now that we scanned all vmas we can already tell
@@ -1909,6 +1910,105 @@ static int userfaultfd_continue(struct userfaultfd_ctx *ctx, unsigned long arg)
 	return ret;
 }
 
+/*
+ * Vectored UFFDIO_COPY and UFFDIO_CONTINUE, so that a batch of faults can be
+ * resolved with one call and, as long as the ranges share a vma, one vma
+ * lookup.
+ */
+static int userfaultfd_mfill_vec(struct userfaultfd_ctx *ctx,
+				 unsigned long arg, bool is_continue)
+{
+	__s64 ret;
+	struct uffdio_vec uffdio_vec;
+	struct uffdio_vec __user *user_uffdio_vec;
+	struct uffdio_iovec *iov;
+	struct userfaultfd_wake_range range;
+	uffd_flags_t flags = 0;
+	__u64 dontwake, wp, total = 0;
+	unsigned long i, done;
+
+	user_uffdio_vec = (struct uffdio_vec __user *)arg;
+
+	ret = -EAGAIN;
+	if (atomic_read(&ctx->mmap_changing))
+		goto out;
+
+	ret = -EFAULT;
+	if (copy_from_user(&uffdio_vec, user_uffdio_vec,
+			   /* don't copy "done" last field */
+			   sizeof(uffdio_vec) - sizeof(__s64)))
+		goto out;
+
+	if (is_continue) {
+		dontwake = UFFDIO_CONTINUE_MODE_DONTWAKE;
+		wp = UFFDIO_CONTINUE_MODE_WP;
+	} else {
+		dontwake = UFFDIO_COPY_MODE_DONTWAKE;
+		wp = UFFDIO_COPY_MODE_WP;
+	}
+
+	ret = -EINVAL;
+	if (uffdio_vec.mode & ~(dontwake | wp))
+		goto out;
+	if (!uffdio_vec.nr || uffdio_vec.nr > UFFDIO_VEC_MAX)
+		goto out;
+	if (uffdio_vec.mode & wp)
+		flags |= MFILL_ATOMIC_WP;
+
+	iov = memdup_array_user(u64_to_user_ptr(uffdio_vec.iov),
+				uffdio_vec.nr, sizeof(*iov));
+	if (IS_ERR(iov))
+		return PTR_ERR(iov);
+
+	for (i = 0; i < uffdio_vec.nr; i++) {
+		if (!is_continue) {
+			ret = validate_unaligned_range(ctx->mm, iov[i].src,
+						       iov[i].len);
+			if (ret)
+				goto out_free;
+		}
+		ret = validate_range(ctx->mm, iov[i].dst, iov[i].len);
+		if (ret)
+			goto out_free;
+		total += iov[i].len;
+	}
+
+	if (mmget_not_zero(ctx->mm)) {
+		if (is_continue)
+			ret = mfill_atomic_continue_vec(ctx, iov, uffdio_vec.nr,
+							flags);
+		else
+			ret = mfill_atomic_copy_vec(ctx, iov, uffdio_vec.nr,
+						    flags);
+		mmput(ctx->mm);
+	} else {
+		ret = -ESRCH;
+		goto out_free;
+	}
+	if (unlikely(put_user(ret, &user_uffdio_vec->done))) {
+		ret = -EFAULT;
+		goto out_free;
+	}
+	if (ret < 0)
+		goto out_free;
+
+	/* wake the filled part of every range, len == 0 would wake all */
+	BUG_ON(!ret);
+	done = ret;
+	for (i = 0; i < uffdio_vec.nr && done; i++) {
+		range.start = iov[i].dst;
+		range.len = min_t(unsigned long, iov[i].len, done);
+		done -= range.len;
+		if (!(uffdio_vec.mode & dontwake))
+			wake_userfault(ctx, &range);
+	}
+	ret = ret == total ? 0 : -EAGAIN;
+out_free:
+	kfree(iov);
+out:
+	return ret;
+}
+
 static inline int userfaultfd_poison(struct userfaultfd_ctx *ctx, unsigned long arg)
 {
 	__s64 ret;
@@ -2147,6 +2247,12 @@ static long userfaultfd_ioctl(struct file *file, unsigned cmd,
 	case UFFDIO_POISON:
 		ret = userfaultfd_poison(ctx, arg);
 		break;
+	case UFFDIO_COPY_VEC:
+		ret = userfaultfd_mfill_vec(ctx, arg, false);
+		break;
+	case UFFDIO_CONTINUE_VEC:
+		ret = userfaultfd_mfill_vec(ctx, arg, true);
+		break;
 	}
 	return ret;
 }
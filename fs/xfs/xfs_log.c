@@ -291,6 +291,8 @@ xlog_grant_head_wait(
 	int			need_bytes) __releases(&head->lock)
 					    __acquires(&head->lock)
 {
+	u64			start = ktime_get_ns();
+
 	list_add_tail(&tic->t_queue, &head->waiters);
 
 	do {
@@ -313,6 +315,8 @@ xlog_grant_head_wait(
 	} while (xlog_space_left(log, &head->grant) < need_bytes);
 
 	list_del_init(&tic->t_queue);
+	XFS_STATS_ADD(log->l_mp, xs_log_grant_wait_ns,
+			ktime_get_ns() - start);
 	return 0;
 shutdown:
 	list_del_init(&tic->t_queue);
@@ -643,6 +643,7 @@ xlog_cil_insert_items(
 		space_used = atomic_add_return(cilpcp->space_used + len,
 						&ctx->space_used);
 		cilpcp->space_used = 0;
+		XFS_STATS_INC(log->l_mp, xs_cil_pcp_fold);
 
 		/*
 		 * If we just transitioned over the soft limit, we need to
@@ -1431,9 +1432,14 @@ xlog_cil_push_background(
 	 * calling xlog_cil_over_hard_limit() in this context.
 	 */
 	if (xlog_cil_over_hard_limit(log, space_used)) {
+		u64	start = ktime_get_ns();
+
 		trace_xfs_log_cil_wait(log, cil->xc_ctx->ticket);
 		ASSERT(space_used < log->l_logsize);
 		xlog_wait(&cil->xc_push_wait, &cil->xc_push_lock);
+		XFS_STATS_INC(log->l_mp, xs_cil_throttle);
+		XFS_STATS_ADD(log->l_mp, xs_cil_throttle_ns,
+				ktime_get_ns() - start);
 		return;
 	}
 
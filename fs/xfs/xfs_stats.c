@@ -24,6 +24,10 @@ int xfs_stats_format(struct xfsstats __percpu *stats, char *buf)
 	uint64_t	xs_write_bytes = 0;
 	uint64_t	xs_read_bytes = 0;
 	uint64_t	defer_relog = 0;
+	uint64_t	log_grant_wait_ns = 0;
+	uint64_t	cil_pcp_fold = 0;
+	uint64_t	cil_throttle = 0;
+	uint64_t	cil_throttle_ns = 0;
 
 	static const struct xstats_entry {
 		char	*desc;
@@ -74,12 +78,22 @@ int xfs_stats_format(struct xfsstats __percpu *stats, char *buf)
 		xs_write_bytes += per_cpu_ptr(stats, i)->s.xs_write_bytes;
 		xs_read_bytes += per_cpu_ptr(stats, i)->s.xs_read_bytes;
 		defer_relog += per_cpu_ptr(stats, i)->s.defer_relog;
+		log_grant_wait_ns += per_cpu_ptr(stats, i)->s.xs_log_grant_wait_ns;
+		cil_pcp_fold += per_cpu_ptr(stats, i)->s.xs_cil_pcp_fold;
+		cil_throttle += per_cpu_ptr(stats, i)->s.xs_cil_throttle;
+		cil_throttle_ns += per_cpu_ptr(stats, i)->s.xs_cil_throttle_ns;
 	}
 
 	len += scnprintf(buf + len, PATH_MAX-len, "xpc %llu %llu %llu\n",
 			xs_xstrat_bytes, xs_write_bytes, xs_read_bytes);
 	len += scnprintf(buf + len, PATH_MAX-len, "defer_relog %llu\n",
 			defer_relog);
+	/* log space waits in microseconds */
+	len += scnprintf(buf + len, PATH_MAX-len, "log_wait %llu\n",
+			div_u64(log_grant_wait_ns, NSEC_PER_USEC));
+	len += scnprintf(buf + len, PATH_MAX-len, "cil %llu %llu %llu\n",
+			cil_pcp_fold, cil_throttle,
+			div_u64(cil_throttle_ns, NSEC_PER_USEC));
 	len += scnprintf(buf + len, PATH_MAX-len, "debug %u\n",
 #if defined(DEBUG)
 		1);
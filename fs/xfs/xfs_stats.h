@@ -140,6 +140,10 @@ struct __xfsstats {
 	uint64_t		xs_write_bytes;
 	uint64_t		xs_read_bytes;
 	uint64_t		defer_relog;
+	uint64_t		xs_log_grant_wait_ns;
+	uint64_t		xs_cil_pcp_fold;
+	uint64_t		xs_cil_throttle;
+	uint64_t		xs_cil_throttle_ns;
 };
 
 #define	xfsstats_offset(f)	(offsetof(struct __xfsstats, f)/sizeof(uint32_t))
@@ -11,7 +11,9 @@
 #include "xfs_log_format.h"
 #include "xfs_trans_resv.h"
 #include "xfs_mount.h"
+#include "xfs_inode.h"
 #include "xfs_trans.h"
+#include "xfs_inode_item.h"
 #include "xfs_trans_priv.h"
 #include "xfs_trace.h"
 #include "xfs_errortag.h"
@@ -392,7 +394,8 @@ xfsaild_resubmit_item(
 static inline uint
 xfsaild_push_item(
 	struct xfs_ail		*ailp,
-	struct xfs_log_item	*lip)
+	struct xfs_log_item	*lip,
+	struct list_head	*buffer_list)
 {
 	/*
 	 * If log item pinning is enabled, skip the push and track the item as
@@ -410,86 +413,90 @@ xfsaild_push_item(
 	if (!lip->li_ops->iop_push)
 		return XFS_ITEM_PINNED;
 	if (test_bit(XFS_LI_FAILED, &lip->li_flags))
-		return xfsaild_resubmit_item(lip, &ailp->ail_buf_list);
-	return lip->li_ops->iop_push(lip, &ailp->ail_buf_list);
+		return xfsaild_resubmit_item(lip, buffer_list);
+	return lip->li_ops->iop_push(lip, buffer_list);
 }
 
+/*
+ * Pick the lane that pushes @lip.  Inodes and buffers go to the lane of their
+ * AG, everything else is pushed by the first lane.  Called with the AIL lock
+ * held, which keeps the inode attached to an inode log item.
+ */
+static inline unsigned int
+xfsaild_item_lane(
+	struct xfs_ail		*ailp,
+	struct xfs_log_item	*lip)
+{
+	struct xfs_mount	*mp = ailp->ail_log->l_mp;
+	xfs_agnumber_t		agno;
+
+	if (ailp->ail_nr_lanes == 1)
+		return 0;
+
+	switch (lip->li_type) {
+	case XFS_LI_INODE:
+		agno = XFS_INO_TO_AGNO(mp, container_of(lip,
+				struct xfs_inode_log_item, ili_item)->ili_inode->i_ino);
+		break;
+	case XFS_LI_BUF:
+		agno = xfs_daddr_to_agno(mp, xfs_buf_daddr(lip->li_buf));
+		break;
+	default:
+		return 0;
+	}
+	return agno % ailp->ail_nr_lanes;
+}
+
+/*
+ * Push the items of one lane up to the lane's target.  Items of other lanes
+ * are skipped, but we still break the AIL lock while doing so to not hold off
+ * the other lanes and AIL insertions for the length of the whole list.
+ */
 static long
-xfsaild_push(
-	struct xfs_ail		*ailp)
+xfsaild_push_lane(
+	struct xfs_ail_lane	*lane)
 {
+	struct xfs_ail		*ailp = lane->ailp;
 	struct xfs_mount	*mp = ailp->ail_log->l_mp;
 	struct xfs_ail_cursor	cur;
 	struct xfs_log_item	*lip;
 	xfs_lsn_t		lsn;
-	xfs_lsn_t		target = NULLCOMMITLSN;
+	xfs_lsn_t		target = lane->target;
 	long			tout;
 	int			stuck = 0;
 	int			flushing = 0;
 	int			count = 0;
 
-	/*
-	 * If we encountered pinned items or did not finish writing out all
-	 * buffers the last time we ran, force a background CIL push to get the
-	 * items unpinned in the near future. We do not wait on the CIL push as
-	 * that could stall us for seconds if there is enough background IO
-	 * load. Stalling for that long when the tail of the log is pinned and
-	 * needs flushing will hard stop the transaction subsystem when log
-	 * space runs out.
-	 */
-	if (ailp->ail_log_flush && ailp->ail_last_pushed_lsn == 0 &&
-	    (!list_empty_careful(&ailp->ail_buf_list) ||
-	     xfs_ail_min_lsn(ailp))) {
-		ailp->ail_log_flush = 0;
-
-		XFS_STATS_INC(mp, xs_push_ail_flush);
-		xlog_cil_flush(ailp->ail_log);
-	}
-
 	spin_lock(&ailp->ail_lock);
 
-	/*
-	 * If we have a sync push waiter, we always have to push till the AIL is
-	 * empty. Update the target to point to the end of the AIL so that
-	 * capture updates that occur after the sync push waiter has gone to
-	 * sleep.
-	 */
-	if (waitqueue_active(&ailp->ail_empty)) {
-		lip = xfs_ail_max(ailp);
-		if (lip)
-			target = lip->li_lsn;
-	} else {
-		/* barrier matches the ail_target update in xfs_ail_push() */
-		smp_rmb();
-		target = ailp->ail_target;
-		ailp->ail_target_prev = target;
-	}
-
 	/* we're done if the AIL is empty or our push has reached the end */
-	lip = xfs_trans_ail_cursor_first(ailp, &cur, ailp->ail_last_pushed_lsn);
-	if (!lip)
+	lip = xfs_trans_ail_cursor_first(ailp, &cur, lane->last_pushed_lsn);
+	if (!lip || target == NULLCOMMITLSN)
 		goto out_done;
 
 	XFS_STATS_INC(mp, xs_push_ail);
 
-	ASSERT(target != NULLCOMMITLSN);
-
 	lsn = lip->li_lsn;
 	while ((XFS_LSN_CMP(lip->li_lsn, target) <= 0)) {
 		int	lock_result;
 
+		if (xfsaild_item_lane(ailp, lip) != lane->index) {
+			cond_resched_lock(&ailp->ail_lock);
+			goto next_item;
+		}
+
 		/*
 		 * Note that iop_push may unlock and reacquire the AIL lock.  We
 		 * rely on the AIL cursor implementation to be able to deal with
 		 * the dropped lock.
 		 */
-		lock_result = xfsaild_push_item(ailp, lip);
+		lock_result = xfsaild_push_item(ailp, lip, &lane->buf_list);
 		switch (lock_result) {
 		case XFS_ITEM_SUCCESS:
 			XFS_STATS_INC(mp, xs_push_ail_success);
 			trace_xfs_ail_push(lip);
 
-			ailp->ail_last_pushed_lsn = lsn;
+			lane->last_pushed_lsn = lsn;
 			break;
 
 		case XFS_ITEM_FLUSHING:
@@ -508,7 +515,7 @@ xfsaild_push(
 			trace_xfs_ail_flushing(lip);
 
 			flushing++;
-			ailp->ail_last_pushed_lsn = lsn;
+			lane->last_pushed_lsn = lsn;
 			break;
 
 		case XFS_ITEM_PINNED:
@@ -547,6 +554,7 @@ xfsaild_push(
 		if (stuck > 100)
 			break;
 
+next_item:
 		lip = xfs_trans_ail_cursor_next(ailp, &cur);
 		if (lip == NULL)
 			break;
@@ -557,8 +565,11 @@ xfsaild_push(
 	xfs_trans_ail_cursor_done(&cur);
 	spin_unlock(&ailp->ail_lock);
 
-	if (xfs_buf_delwri_submit_nowait(&ailp->ail_buf_list))
+	if (xfs_buf_delwri_submit_nowait(&lane->buf_list)) {
+		spin_lock(&ailp->ail_lock);
 		ailp->ail_log_flush++;
+		spin_unlock(&ailp->ail_lock);
+	}
 
 	if (!count || XFS_LSN_CMP(lsn, target) >= 0) {
 		/*
@@ -567,7 +578,7 @@ xfsaild_push(
 		 * AIL before we start the next scan from the start of the AIL.
 		 */
 		tout = 50;
-		ailp->ail_last_pushed_lsn = 0;
+		lane->last_pushed_lsn = 0;
 	} else if (((stuck + flushing) * 100) / count > 90) {
 		/*
 		 * Either there is a lot of contention on the AIL or we are
@@ -580,7 +591,7 @@ xfsaild_push(
 		 * the restart to issue a log force to unpin the stuck items.
 		 */
 		tout = 20;
-		ailp->ail_last_pushed_lsn = 0;
+		lane->last_pushed_lsn = 0;
 	} else {
 		/*
 		 * Assume we have more work to do in a short while.
@@ -591,6 +602,110 @@ xfsaild_push(
 	return tout;
 }
 
+static void
+xfsaild_push_worker(
+	struct work_struct	*work)
+{
+	struct xfs_ail_lane	*lane = container_of(work,
+					struct xfs_ail_lane, work);
+	unsigned int		noreclaim_flag;
+
+	noreclaim_flag = memalloc_noreclaim_save();
+	lane->tout = xfsaild_push_lane(lane);
+	memalloc_noreclaim_restore(noreclaim_flag);
+}
+
+/* Do any of the lanes still have buffers waiting for submission? */
+static bool
+xfsaild_bufs_queued(
+	struct xfs_ail		*ailp)
+{
+	unsigned int		i;
+
+	for (i = 0; i < ailp->ail_nr_lanes; i++) {
+		if (!list_empty_careful(&ailp->ail_lanes[i].buf_list))
+			return true;
+	}
+	return false;
+}
+
+/* Have all lanes restarted their scan from the start of the AIL? */
+static bool
+xfsaild_push_restarted(
+	struct xfs_ail		*ailp)
+{
+	unsigned int		i;
+
+	for (i = 0; i < ailp->ail_nr_lanes; i++) {
+		if (ailp->ail_lanes[i].last_pushed_lsn)
+			return false;
+	}
+	return true;
+}
+
+static long
+xfsaild_push(
+	struct xfs_ail		*ailp)
+{
+	struct xfs_mount	*mp = ailp->ail_log->l_mp;
+	struct xfs_log_item	*lip;
+	xfs_lsn_t		target = NULLCOMMITLSN;
+	long			tout;
+	unsigned int		i;
+
+	/*
+	 * If we encountered pinned items or did not finish writing out all
+	 * buffers the last time we ran, force a background CIL push to get the
+	 * items unpinned in the near future. We do not wait on the CIL push as
+	 * that could stall us for seconds if there is enough background IO
+	 * load. Stalling for that long when the tail of the log is pinned and
+	 * needs flushing will hard stop the transaction subsystem when log
+	 * space runs out.
+	 */
+	if (ailp->ail_log_flush && xfsaild_push_restarted(ailp) &&
+	    (xfsaild_bufs_queued(ailp) || xfs_ail_min_lsn(ailp))) {
+		ailp->ail_log_flush = 0;
+
+		XFS_STATS_INC(mp, xs_push_ail_flush);
+		xlog_cil_flush(ailp->ail_log);
+	}
+
+	spin_lock(&ailp->ail_lock);
+
+	/*
+	 * If we have a sync push waiter, we always have to push till the AIL is
+	 * empty. Update the target to point to the end of the AIL so that
+	 * capture updates that occur after the sync push waiter has gone to
+	 * sleep.
+	 */
+	if (waitqueue_active(&ailp->ail_empty)) {
+		lip = xfs_ail_max(ailp);
+		if (lip)
+			target = lip->li_lsn;
+	} else {
+		/* barrier matches the ail_target update in xfs_ail_push() */
+		smp_rmb();
+		target = ailp->ail_target;
+		ailp->ail_target_prev = target;
+	}
+	spin_unlock(&ailp->ail_lock);
+
+	for (i = 0; i < ailp->ail_nr_lanes; i++) {
+		ailp->ail_lanes[i].target = target;
+		if (i)
+			queue_work(ailp->ail_push_wq,
+					&ailp->ail_lanes[i].work);
+	}
+
+	tout = xfsaild_push_lane(&ailp->ail_lanes[0]);
+	for (i = 1; i < ailp->ail_nr_lanes; i++) {
+		flush_work(&ailp->ail_lanes[i].work);
+		tout = min(tout, ailp->ail_lanes[i].tout);
+	}
+
+	return tout;
+}
+
 static int
 xfsaild(
 	void		*data)
@@ -598,6 +713,7 @@ xfsaild(
 	struct xfs_ail	*ailp = data;
 	long		tout = 0;	/* milliseconds */
 	unsigned int	noreclaim_flag;
+	unsigned int	i;
 
 	noreclaim_flag = memalloc_noreclaim_save();
 	set_freezable();
@@ -633,9 +749,11 @@ xfsaild(
 			 * happen if we're shutting down, so this is the last
 			 * opportunity to release such buffers from the queue.
 			 */
-			ASSERT(list_empty(&ailp->ail_buf_list) ||
+			ASSERT(!xfsaild_bufs_queued(ailp) ||
 			       xlog_is_shutdown(ailp->ail_log));
-			xfs_buf_delwri_cancel(&ailp->ail_buf_list);
+			for (i = 0; i < ailp->ail_nr_lanes; i++)
+				xfs_buf_delwri_cancel(
+						&ailp->ail_lanes[i].buf_list);
 			break;
 		}
 
@@ -653,7 +771,7 @@ xfsaild(
 		smp_rmb();
 		if (!xfs_ail_min(ailp) &&
 		    ailp->ail_target == ailp->ail_target_prev &&
-		    list_empty(&ailp->ail_buf_list)) {
+		    !xfsaild_bufs_queued(ailp)) {
 			spin_unlock(&ailp->ail_lock);
 			schedule();
 			tout = 0;
@@ -900,6 +1018,7 @@ xfs_trans_ail_init(
 	xfs_mount_t	*mp)
 {
 	struct xfs_ail	*ailp;
+	unsigned int	i;
 
 	ailp = kzalloc(sizeof(struct xfs_ail),
 			GFP_KERNEL | __GFP_RETRY_MAYFAIL);
@@ -910,17 +1029,44 @@ xfs_trans_ail_init(
 	INIT_LIST_HEAD(&ailp->ail_head);
 	INIT_LIST_HEAD(&ailp->ail_cursors);
 	spin_lock_init(&ailp->ail_lock);
-	INIT_LIST_HEAD(&ailp->ail_buf_list);
 	init_waitqueue_head(&ailp->ail_empty);
 
+	/*
+	 * One lane per AG up to the number of CPUs that can push them.  The
+	 * lane count stays fixed if the file system is grown, new AGs are
+	 * spread over the existing lanes.
+	 */
+	ailp->ail_nr_lanes = max(1U, min3(mp->m_sb.sb_agcount,
+				num_online_cpus(), XFS_AIL_MAX_LANES));
+	for (i = 0; i < ailp->ail_nr_lanes; i++) {
+		struct xfs_ail_lane	*lane = &ailp->ail_lanes[i];
+
+		lane->ailp = ailp;
+		lane->index = i;
+		INIT_LIST_HEAD(&lane->buf_list);
+		INIT_WORK(&lane->work, xfsaild_push_worker);
+	}
+
+	if (ailp->ail_nr_lanes > 1) {
+		ailp->ail_push_wq = alloc_workqueue("xfs-ail/%s",
+				XFS_WQFLAGS(WQ_FREEZABLE | WQ_MEM_RECLAIM |
+					    WQ_UNBOUND),
+				ailp->ail_nr_lanes - 1, mp->m_super->s_id);
+		if (!ailp->ail_push_wq)
+			goto out_free_ailp;
+	}
+
 	ailp->ail_task = kthread_run(xfsaild, ailp, "xfsaild/%s",
 				mp->m_super->s_id);
 	if (IS_ERR(ailp->ail_task))
-		goto out_free_ailp;
+		goto out_destroy_wq;
 
 	mp->m_ail = ailp;
 	return 0;
 
+out_destroy_wq:
+	if (ailp->ail_push_wq)
+		destroy_workqueue(ailp->ail_push_wq);
 out_free_ailp:
 	kfree(ailp);
 	return -ENOMEM;
@@ -933,5 +1079,7 @@ xfs_trans_ail_destroy(
 	struct xfs_ail	*ailp = mp->m_ail;
 
 	kthread_stop(ailp->ail_task);
+	if (ailp->ail_push_wq)
+		destroy_workqueue(ailp->ail_push_wq);
 	kfree(ailp);
 }
@@ -46,6 +46,27 @@ struct xfs_ail_cursor {
 	struct xfs_log_item	*item;
 };
 
+/*
+ * AIL push lanes.
+ *
+ * Each lane pushes the log items belonging to a subset of the AGs and queues
+ * the backing buffers on its own delwri list, so that item flushing and buffer
+ * submission for different AGs run concurrently.  Lane 0 runs in xfsaild and
+ * also takes the items that don't belong to an AG, the others run from
+ * ail_push_wq while xfsaild waits for them.
+ */
+#define XFS_AIL_MAX_LANES	8
+
+struct xfs_ail_lane {
+	struct xfs_ail		*ailp;
+	unsigned int		index;
+	xfs_lsn_t		target;
+	xfs_lsn_t		last_pushed_lsn;
+	long			tout;
+	struct list_head	buf_list;
+	struct work_struct	work;
+};
+
 /*
  * Private AIL structures.
  *
@@ -59,10 +80,11 @@ struct xfs_ail {
 	xfs_lsn_t		ail_target_prev;
 	struct list_head	ail_cursors;
 	spinlock_t		ail_lock;
-	xfs_lsn_t		ail_last_pushed_lsn;
 	int			ail_log_flush;
-	struct list_head	ail_buf_list;
 	wait_queue_head_t	ail_empty;
+	struct workqueue_struct	*ail_push_wq;
+	unsigned int		ail_nr_lanes;
+	struct xfs_ail_lane	ail_lanes[XFS_AIL_MAX_LANES];
 };
 
 /*
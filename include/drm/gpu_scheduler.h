@@ -58,6 +58,7 @@ struct drm_gpu_scheduler;
 struct drm_sched_rq;
 
 struct drm_file;
+struct drm_printer;
 
 /* These are often used as an (initial) index
  * to an array, and as such should start at 0.
@@ -238,6 +239,29 @@ struct drm_sched_entity {
 	 */
 	struct rb_node			rb_tree_node;
 
+	/**
+	 * @jobs_run:
+	 *
+	 * Number of jobs of this entity handed to &drm_sched_backend_ops.run_job.
+	 * This and the latency stats below are only updated by the scheduler's
+	 * run-job work, see drm_sched_entity_print_stats().
+	 */
+	u64				jobs_run;
+
+	/**
+	 * @submit_latency_ns:
+	 *
+	 * Total time the jobs spent between drm_sched_entity_push_job() and
+	 * being run, dependency waits included.
+	 */
+	u64				submit_latency_ns;
+
+	/**
+	 * @submit_latency_max_ns:
+	 *
+	 * The longest of those times.
+	 */
+	u64				submit_latency_max_ns;
 };
 
 /**
@@ -610,6 +634,8 @@ void drm_sched_entity_set_priority(struct drm_sched_entity *entity,
 				   enum drm_sched_priority priority);
 bool drm_sched_entity_is_ready(struct drm_sched_entity *entity);
 int drm_sched_entity_error(struct drm_sched_entity *entity);
+void drm_sched_entity_print_stats(struct drm_sched_entity *entity,
+				  struct drm_printer *p);
 
 struct drm_sched_fence *drm_sched_fence_alloc(
 	struct drm_sched_entity *s_entity, void *owner);
@@ -281,6 +281,36 @@ enum blk_eh_timer_return {
 #define BLK_TAG_ALLOC_FIFO 0 /* allocate starting from 0 */
 #define BLK_TAG_ALLOC_RR 1 /* allocate starting from last allocated tag */
 
+#ifdef CONFIG_BLK_DEBUG_FS
+#define BLK_MQ_MAX_DISPATCH_ORDER	8
+#define BLK_MQ_MAX_LAT_ORDER		24
+
+/**
+ * struct blk_mq_hctx_stats - Debug statistics for a hardware queue
+ *
+ * All counters are updated without locking from the dispatch and completion
+ * paths, so concurrent updates may occasionally be lost.
+ */
+struct blk_mq_hctx_stats {
+	/**
+	 * @dispatched: Number of requests handed to the driver per dispatch
+	 * batch, bucketed by ilog2(batch) + 1.
+	 */
+	unsigned long		dispatched[BLK_MQ_MAX_DISPATCH_ORDER];
+	/**
+	 * @plugged: Number of requests per plug flush that were destined
+	 * for this hardware queue, bucketed like @dispatched.
+	 */
+	unsigned long		plugged[BLK_MQ_MAX_DISPATCH_ORDER];
+	/**
+	 * @completion_lat: Time from blk_mq_start_request() to completion,
+	 * bucketed by ilog2(usecs) + 1. Only requests started while queue
+	 * statistics are enabled are accounted.
+	 */
+	unsigned long		completion_lat[BLK_MQ_MAX_LAT_ORDER];
+};
+#endif
+
 /**
  * struct blk_mq_hw_ctx - State for a hardware queue facing the hardware
  * block device
@@ -419,6 +449,11 @@ struct blk_mq_hw_ctx {
 	struct dentry		*debugfs_dir;
 	/** @sched_debugfs_dir:	debugfs directory for the scheduler. */
 	struct dentry		*sched_debugfs_dir;
+	/**
+	 * @stats: Dispatch batch, plug and completion latency histograms,
+	 * exported through the "batching" debugfs attribute.
+	 */
+	struct blk_mq_hctx_stats stats;
 #endif
 
 	/**
@@ -659,6 +659,8 @@ struct bpf_id_pair {
 
 struct bpf_idmap {
 	u32 tmp_id_gen;
+	/* number of used entries in map[] */
+	u32 cnt;
 	struct bpf_id_pair map[BPF_ID_MAP_SIZE];
 };
 
@@ -726,6 +728,8 @@ struct bpf_verifier_env {
 	u32 prev_jmps_processed, jmps_processed;
 	/* total verification time */
 	u64 verification_time;
+	/* time spent in check_cfg() and in the main verification pass */
+	u64 cfg_time, check_time;
 	/* maximum number of verifier states kept in 'branching' instructions */
 	u32 max_states_per_insn;
 	/* total number of allocated verifier states */
@@ -737,6 +741,8 @@ struct bpf_verifier_env {
 	u32 peak_states;
 	/* longest register parentage chain walked for liveness marking */
 	u32 longest_mark_read_walk;
+	/* states_equal() calls at prune points, and how many of them pruned */
+	u32 states_compared, prune_hits;
 	bpfptr_t fd_array;
 
 	/* bit mask to keep track of whether a register has been accessed
@@ -503,6 +503,11 @@ struct ceph_connection {
 
 	struct timespec64 last_keepalive_ack; /* keepalive2 ack stamp */
 
+	/* counted under @mutex, shown in debugfs "connections" */
+	u64 in_msgs, in_bytes;
+	u64 out_msgs, out_bytes;	/* incl. resends after a reconnect */
+	unsigned long stats_start;	/* jiffies, when the counts began */
+
 	struct delayed_work work;	    /* send|recv work */
 	unsigned long       delay;          /* current delay interval */
 
@@ -38,6 +38,14 @@ struct poll_table_struct;
 #define MAX_CGROUP_ROOT_NAMELEN 64
 #define MAX_CFTYPE_NAME		64
 
+/*
+ * Number of rstat update trees: one for the base stats and bpf, and one
+ * for each of the first controllers implementing ->css_rstat_flush(); any
+ * further such controller shares the base tree.
+ */
+#define CGROUP_RSTAT_BASE_TREE	0
+#define CGROUP_RSTAT_NR_TREES	3
+
 /* define the enumeration of all cgroup subsystems */
 #define SUBSYS(_x) _x ## _cgrp_id,
 enum cgroup_subsys_id {
@@ -369,10 +377,12 @@ struct cgroup_rstat_cpu {
 	 * to the cgroup makes it unnecessary for each per-cpu struct to
 	 * point back to the associated cgroup.
 	 *
+	 * There is one such tree per rstat tree, see cgroup_subsys->rstat_tree.
+	 *
 	 * Protected by per-cpu cgroup_rstat_cpu_lock.
 	 */
-	struct cgroup *updated_children;	/* terminated by self cgroup */
-	struct cgroup *updated_next;		/* NULL iff not on the list */
+	struct cgroup *updated_children[CGROUP_RSTAT_NR_TREES];	/* terminated by self cgroup */
+	struct cgroup *updated_next[CGROUP_RSTAT_NR_TREES];	/* NULL iff not on the list */
 };
 
 struct cgroup_freezer_state {
@@ -508,7 +518,12 @@ struct cgroup {
 	 * This is a scratch field to be used exclusively by
 	 * cgroup_rstat_flush_locked() and protected by cgroup_rstat_lock.
 	 */
-	struct cgroup	*rstat_flush_next;
+	struct cgroup	*rstat_flush_next[CGROUP_RSTAT_NR_TREES];
+
+	/* rstat flushes of this subtree, and the time they took */
+	atomic64_t	rstat_flushes;
+	atomic64_t	rstat_flush_skips;
+	atomic64_t	rstat_flush_ns;
 
 	/* cgroup basic resource statistics */
 	struct cgroup_base_stat last_bstat;
@@ -741,6 +756,13 @@ struct cgroup_subsys {
 	int id;
 	const char *name;
 
+	/*
+	 * rstat tree the csses of a controller with ->css_rstat_flush() are
+	 * updated and flushed on, so that controllers don't contend with each
+	 * other on flushing.  Initialized automatically during boot.
+	 */
+	int rstat_tree;
+
 	/* optional, initialized automatically during boot if not set */
 	const char *legacy_name;
 
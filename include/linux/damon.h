@@ -422,12 +422,15 @@ struct damos {
  * @DAMON_OPS_FVADDR:	Monitoring operations for only fixed ranges of virtual
  *			address spaces
  * @DAMON_OPS_PADDR:	Monitoring operations for the physical address space
+ * @DAMON_OPS_PADDR_SAMPLED:	Monitoring operations for the physical address
+ *			space, driven by hardware sampled accesses
  * @NR_DAMON_OPS:	Number of monitoring operations implementations
  */
 enum damon_ops_id {
 	DAMON_OPS_VADDR,
 	DAMON_OPS_FVADDR,
 	DAMON_OPS_PADDR,
+	DAMON_OPS_PADDR_SAMPLED,
 	NR_DAMON_OPS,
 };
 
@@ -768,4 +771,12 @@ int damon_set_region_biggest_system_ram_default(struct damon_target *t,
 
 #endif	/* CONFIG_DAMON */
 
+#ifdef CONFIG_DAMON_PADDR
+void damon_report_access(unsigned long paddr);
+#else
+static inline void damon_report_access(unsigned long paddr)
+{
+}
+#endif
+
 #endif	/* _DAMON_H */
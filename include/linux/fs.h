@@ -31,6 +31,7 @@
 #include <linux/uidgid.h>
 #include <linux/lockdep.h>
 #include <linux/percpu-rwsem.h>
+#include <linux/percpu_counter.h>
 #include <linux/workqueue.h>
 #include <linux/delayed_call.h>
 #include <linux/uuid.h>
@@ -317,6 +318,8 @@ struct readahead_control;
 #define IOCB_SYNC		(__force int) RWF_SYNC
 #define IOCB_NOWAIT		(__force int) RWF_NOWAIT
 #define IOCB_APPEND		(__force int) RWF_APPEND
+/* drop cached folios once the I/O is done with them */
+#define IOCB_DONTCACHE		(__force int) RWF_DONTCACHE
 
 /* non-RWF related bits - start at 16 */
 #define IOCB_EVENTFD		(1 << 16)
@@ -357,7 +360,8 @@ struct readahead_control;
 	{ IOCB_WAITQ,		"WAITQ" }, \
 	{ IOCB_NOIO,		"NOIO" }, \
 	{ IOCB_ALLOC_CACHE,	"ALLOC_CACHE" }, \
-	{ IOCB_DIO_CALLER_COMP,	"CALLER_COMP" }
+	{ IOCB_DIO_CALLER_COMP,	"CALLER_COMP" }, \
+	{ IOCB_DONTCACHE,	"DONTCACHE" }
 
 struct kiocb {
 	struct file		*ki_filp;
@@ -956,6 +960,9 @@ struct fown_struct {
  * @ra_pages: Maximum size of a readahead request, copied from the bdi.
  * @mmap_miss: How many mmap accesses missed in the page cache.
  * @prev_pos: The last byte in the most recent read request.
+ * @stride: Pages between the end of the previous read and the start of the
+ *      most recent one, for strided reads.
+ * @stride_count: How many reads in a row were @stride apart.
  *
  * When this structure is passed to ->readahead(), the "most recent"
  * readahead means the current readahead.
@@ -967,6 +974,8 @@ struct file_ra_state {
 	unsigned int ra_pages;
 	unsigned int mmap_miss;
 	loff_t prev_pos;
+	unsigned int stride;
+	unsigned int stride_count;
 };
 
 /*
@@ -1325,6 +1334,8 @@ struct super_block {
 	 */
 	struct list_lru		s_dentry_lru;
 	struct list_lru		s_inode_lru;
+	struct percpu_counter	s_nr_dentry_negative;	/* on s_dentry_lru */
+	struct work_struct	s_dentry_negative_work;
 	struct rcu_head		rcu;
 	struct work_struct	destroy_work;
 
@@ -2051,6 +2062,10 @@ struct file_operations {
 #define FOP_DIO_PARALLEL_WRITE	((__force fop_flags_t)(1 << 3))
 /* Contains huge pages */
 #define FOP_HUGE_PAGES		((__force fop_flags_t)(1 << 4))
+/* Supports uncached buffered I/O (RWF_DONTCACHE) */
+#define FOP_DONTCACHE		((__force fop_flags_t)(1 << 5))
+/* Supports concurrent buffered writes to non-overlapping ranges */
+#define FOP_BUFFER_PARALLEL_WRITE ((__force fop_flags_t)(1 << 6))
 
 /* Wrap a directory iterator that needs exclusive inode access */
 int wrap_directory_iterator(struct file *, struct dir_context *,
@@ -2783,10 +2798,16 @@ static inline bool iocb_is_dsync(const struct kiocb *iocb)
 		IS_SYNC(iocb->ki_filp->f_mapping->host);
 }
 
+int filemap_fdatawrite_range_kick(struct address_space *mapping, loff_t start,
+		loff_t end);
+
 /*
  * Sync the bytes written if this was a synchronous write.  Expect ki_pos
  * to already be updated for the write, and will return either the amount
  * of bytes passed in, or an error if syncing the file failed.
+ *
+ * Uncached writes start writeback right away, the folios are dropped from
+ * the page cache once it completes.
  */
 static inline ssize_t generic_write_sync(struct kiocb *iocb, ssize_t count)
 {
@@ -2796,6 +2817,9 @@ static inline ssize_t generic_write_sync(struct kiocb *iocb, ssize_t count)
 				(iocb->ki_flags & IOCB_SYNC) ? 0 : 1);
 		if (ret)
 			return ret;
+	} else if (iocb->ki_flags & IOCB_DONTCACHE) {
+		filemap_fdatawrite_range_kick(iocb->ki_filp->f_mapping,
+				iocb->ki_pos - count, iocb->ki_pos - 1);
 	}
 
 	return count;
@@ -3422,6 +3446,14 @@ static inline int kiocb_set_rw_flags(struct kiocb *ki, rwf_t flags)
 			return -EOPNOTSUPP;
 		kiocb_flags |= IOCB_NOIO;
 	}
+	if (flags & RWF_DONTCACHE) {
+		/* The file system has to drop the folios after the I/O */
+		if (!(ki->ki_filp->f_op->fop_flags & FOP_DONTCACHE))
+			return -EOPNOTSUPP;
+		/* DAX has no page cache to bypass */
+		if (IS_DAX(ki->ki_filp->f_mapping->host))
+			return -EOPNOTSUPP;
+	}
 	kiocb_flags |= (__force int) (flags & RWF_SUPPORTED);
 	if (flags & RWF_SYNC)
 		kiocb_flags |= IOCB_DSYNC;
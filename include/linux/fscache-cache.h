@@ -15,6 +15,8 @@
 #define _LINUX_FSCACHE_CACHE_H
 
 #include <linux/fscache.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
 
 enum fscache_cache_trace;
 enum fscache_cookie_trace;
@@ -202,6 +204,26 @@ extern atomic_t fscache_n_dio_misfit;
 #define fscache_count_no_create_space() atomic_inc(&fscache_n_no_create_space)
 #define fscache_count_culled() atomic_inc(&fscache_n_culled)
 #define fscache_count_dio_misfit() atomic_inc(&fscache_n_dio_misfit)
+
+/*
+ * Cache I/O latency histograms; bucket n counts I/Os that took less than 2^n
+ * microseconds, the last bucket takes everything slower.
+ */
+#define FSCACHE_IO_LAT_BUCKETS 16
+extern atomic_t fscache_n_read_lat[FSCACHE_IO_LAT_BUCKETS];
+extern atomic_t fscache_n_write_lat[FSCACHE_IO_LAT_BUCKETS];
+
+static inline void fscache_count_io_latency(atomic_t *hist, u64 start_ns)
+{
+	u64 us = div_u64(ktime_get_ns() - start_ns, NSEC_PER_USEC);
+	unsigned int b = us ? ilog2(us) + 1 : 0;
+
+	atomic_inc(&hist[min(b, FSCACHE_IO_LAT_BUCKETS - 1)]);
+}
+#define fscache_count_read_latency(start_ns) \
+	fscache_count_io_latency(fscache_n_read_lat, start_ns)
+#define fscache_count_write_latency(start_ns) \
+	fscache_count_io_latency(fscache_n_write_lat, start_ns)
 #else
 #define fscache_count_read() do {} while(0)
 #define fscache_count_write() do {} while(0)
@@ -209,6 +231,8 @@ extern atomic_t fscache_n_dio_misfit;
 #define fscache_count_no_create_space() do {} while(0)
 #define fscache_count_culled() do {} while(0)
 #define fscache_count_dio_misfit() do {} while(0)
+#define fscache_count_read_latency(start_ns) do {} while(0)
+#define fscache_count_write_latency(start_ns) do {} while(0)
 #endif
 
 #endif /* _LINUX_FSCACHE_CACHE_H */
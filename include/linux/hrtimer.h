@@ -112,6 +112,21 @@ static inline void hrtimer_set_expires_range_ns(struct hrtimer *timer, ktime_t t
 	timer->node.expires = ktime_add_safe(time, ns_to_ktime(delta));
 }
 
+/**
+ * hrtimer_set_slack - set the default slack range of an hrtimer
+ * @timer:	the timer
+ * @slack_ns:	slack range in nanoseconds
+ *
+ * Opt-in coalescing for high rate kernel timers, the in-kernel counterpart to
+ * timerslack_ns: whenever @timer is started without an explicit range, it may
+ * expire up to @slack_ns after its expiry time. All timers of a CPU whose
+ * ranges overlap are then expired together by a single interrupt.
+ */
+static inline void hrtimer_set_slack(struct hrtimer *timer, u32 slack_ns)
+{
+	timer->slack_ns = slack_ns;
+}
+
 static inline void hrtimer_set_expires_tv64(struct hrtimer *timer, s64 tv64)
 {
 	timer->node.expires = tv64;
@@ -33,6 +33,8 @@ enum hrtimer_restart {
  * @is_soft:	Set if hrtimer will be expired in soft interrupt context.
  * @is_hard:	Set if hrtimer will be expired in hard interrupt context
  *		even on RT.
+ * @slack_ns:	Default slack range, used when the timer is started without
+ *		an explicit range. See hrtimer_set_slack().
  *
  * The hrtimer structure must be initialized by hrtimer_init()
  */
@@ -45,6 +47,7 @@ struct hrtimer {
 	u8				is_rel;
 	u8				is_soft;
 	u8				is_hard;
+	u32				slack_ns;
 };
 
 #endif /* _LINUX_HRTIMER_TYPES_H */
@@ -0,0 +1,98 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Hybrid R/W semaphores: a regular rwsem that switches its readers to
+ * per-CPU counts once they are observed to contend with each other, and
+ * falls back to the shared count on the next writer.
+ *
+ * Unlike an rwsem, whose readers all dirty the same count cacheline, and
+ * a percpu_rw_semaphore, whose writers always pay for a grace period, a
+ * hybrid rwsem only makes a writer wait for the per-CPU readers to drain
+ * when the lock was actually read-dominated since the previous writer.
+ *
+ * Since a reader may find the lock in the other mode by the time it
+ * releases it, hybrid_down_read() returns a cookie, to be handed back to
+ * hybrid_up_read(), that records how the read lock was taken.
+ */
+#ifndef _LINUX_HYBRID_RWSEM_H
+#define _LINUX_HYBRID_RWSEM_H
+
+#include <linux/atomic.h>
+#include <linux/percpu.h>
+#include <linux/rcuwait.h>
+#include <linux/rwsem.h>
+#include <linux/lockdep.h>
+
+enum hybrid_rwsem_mode {
+	HRWSEM_SHARED	= 0,	/* readers use rwsem */
+	HRWSEM_PERCPU	= 1,	/* readers use read_count */
+};
+
+struct hybrid_rw_semaphore {
+	struct rw_semaphore	rwsem;
+	int			mode;
+	atomic_t		contended;	/* contended reads since last writer */
+	unsigned int __percpu	*read_count;
+	struct rcuwait		writer;
+};
+
+#ifndef CONFIG_PREEMPT_RT
+
+extern int __hybrid_init_rwsem(struct hybrid_rw_semaphore *sem,
+			       const char *name, struct lock_class_key *key);
+extern void hybrid_free_rwsem(struct hybrid_rw_semaphore *sem);
+
+extern int hybrid_down_read(struct hybrid_rw_semaphore *sem);
+extern void hybrid_up_read(struct hybrid_rw_semaphore *sem, int cookie);
+extern void hybrid_down_write(struct hybrid_rw_semaphore *sem);
+extern void hybrid_up_write(struct hybrid_rw_semaphore *sem);
+
+#else /* !CONFIG_PREEMPT_RT */
+
+/*
+ * RT rwsems are rtmutex based and have no shared reader count to bounce;
+ * always stay in the shared mode.
+ */
+static inline int __hybrid_init_rwsem(struct hybrid_rw_semaphore *sem,
+				      const char *name,
+				      struct lock_class_key *key)
+{
+	__init_rwsem(&sem->rwsem, name, key);
+	sem->mode = HRWSEM_SHARED;
+	atomic_set(&sem->contended, 0);
+	sem->read_count = NULL;
+	rcuwait_init(&sem->writer);
+	return 0;
+}
+
+static inline void hybrid_free_rwsem(struct hybrid_rw_semaphore *sem) { }
+
+static inline int hybrid_down_read(struct hybrid_rw_semaphore *sem)
+{
+	down_read(&sem->rwsem);
+	return HRWSEM_SHARED;
+}
+
+static inline void hybrid_up_read(struct hybrid_rw_semaphore *sem, int cookie)
+{
+	up_read(&sem->rwsem);
+}
+
+static inline void hybrid_down_write(struct hybrid_rw_semaphore *sem)
+{
+	down_write(&sem->rwsem);
+}
+
+static inline void hybrid_up_write(struct hybrid_rw_semaphore *sem)
+{
+	up_write(&sem->rwsem);
+}
+
+#endif /* CONFIG_PREEMPT_RT */
+
+#define hybrid_init_rwsem(sem)					\
+({								\
+	static struct lock_class_key __key;			\
+	__hybrid_init_rwsem(sem, #sem, &__key);			\
+})
+
+#endif /* _LINUX_HYBRID_RWSEM_H */
@@ -286,6 +286,8 @@ struct io_ring_ctx {
 		 */
 		bool			poll_multi_queue;
 		struct io_wq_work_list	iopoll_list;
+		/* estimated service time of polled IO, for hybrid polling */
+		u64			hybrid_poll_time;
 
 		struct io_file_table	file_table;
 		struct io_mapped_ubuf	**user_bufs;
@@ -362,6 +364,12 @@ struct io_ring_ctx {
 	struct wait_queue_head	sqo_sq_wait;
 	struct list_head	sqd_list;
 
+	/* SQPOLL accounting and sharing state, see io_sq_update_vtime() */
+	u64			sq_work_time;	/* nsec spent on this ring */
+	u64			sq_submitted;	/* entries submitted */
+	u64			sq_vtime;	/* work time scaled by weight */
+	unsigned int		sq_weight;
+
 	unsigned int		file_alloc_start;
 	unsigned int		file_alloc_end;
 
@@ -402,6 +410,12 @@ struct io_ring_ctx {
 	/* io-wq management, e.g. thread count */
 	u32				iowq_limits[2];
 
+	/*
+	 * Protects the ring and sqe pointers and page arrays against
+	 * IORING_REGISTER_RESIZE_RINGS while they are being mmap'ed.
+	 */
+	struct mutex			resize_lock;
+
 	struct callback_head		poll_wq_task_work;
 	struct list_head		defer_list;
 
@@ -472,6 +486,7 @@ enum {
 	REQ_F_BL_EMPTY_BIT,
 	REQ_F_BL_NO_RECYCLE_BIT,
 	REQ_F_BUFFERS_COMMIT_BIT,
+	REQ_F_IOPOLL_STATE_BIT,
 
 	/* not a real bit, just to check we're not overflowing the space */
 	__REQ_F_LAST_BIT,
@@ -552,6 +567,8 @@ enum {
 	REQ_F_BL_NO_RECYCLE	= IO_REQ_FLAG(REQ_F_BL_NO_RECYCLE_BIT),
 	/* buffer ring head needs incrementing on put */
 	REQ_F_BUFFERS_COMMIT	= IO_REQ_FLAG(REQ_F_BUFFERS_COMMIT_BIT),
+	/* hybrid iopoll already slept for this request */
+	REQ_F_IOPOLL_STATE	= IO_REQ_FLAG(REQ_F_IOPOLL_STATE_BIT),
 };
 
 typedef void (*io_req_tw_func_t)(struct io_kiocb *req, struct io_tw_state *ts);
@@ -649,8 +666,12 @@ struct io_kiocb {
 	atomic_t			refs;
 	bool				cancel_seq_set;
 	struct io_task_work		io_task_work;
-	/* for polled requests, i.e. IORING_OP_POLL_ADD and async armed poll */
-	struct hlist_node		hash_node;
+	union {
+		/* for polled requests, i.e. IORING_OP_POLL_ADD and async armed poll */
+		struct hlist_node	hash_node;
+		/* issue time for IORING_SETUP_HYBRID_IOPOLL requests */
+		u64			iopoll_start;
+	};
 	/* internal polling, see IORING_FEAT_FAST_POLL */
 	struct async_poll		*apoll;
 	/* opcode allocated if it needs to store data for async defer */
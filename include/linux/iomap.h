@@ -178,6 +178,7 @@ struct iomap_folio_ops {
 #else
 #define IOMAP_DAX		0
 #endif /* CONFIG_FS_DAX */
+#define IOMAP_DONTCACHE		(1 << 9) /* uncached buffered write */
 
 struct iomap_ops {
 	/*
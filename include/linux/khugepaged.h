@@ -16,6 +16,8 @@ extern void khugepaged_enter_vma(struct vm_area_struct *vma,
 				 unsigned long vm_flags);
 extern void khugepaged_min_free_kbytes_update(void);
 extern bool current_is_khugepaged(void);
+extern int khugepaged_set_collapse_prio(struct mm_struct *mm,
+					unsigned long prio);
 #ifdef CONFIG_SHMEM
 extern int collapse_pte_mapped_thp(struct mm_struct *mm, unsigned long addr,
 				   bool install_pmd);
@@ -38,6 +40,19 @@ static inline void khugepaged_exit(struct mm_struct *mm)
 	if (test_bit(MMF_VM_HUGEPAGE, &mm->flags))
 		__khugepaged_exit(mm);
 }
+
+static inline void khugepaged_mm_init(struct mm_struct *mm,
+				      struct mm_struct *oldmm)
+{
+	mm->khugepaged_prio = oldmm ? oldmm->khugepaged_prio : false;
+	mm->khugepaged_scanned = 0;
+	mm->khugepaged_collapsed = 0;
+}
+
+static inline int khugepaged_get_collapse_prio(struct mm_struct *mm)
+{
+	return READ_ONCE(mm->khugepaged_prio);
+}
 #else /* CONFIG_TRANSPARENT_HUGEPAGE */
 static inline void khugepaged_fork(struct mm_struct *mm, struct mm_struct *oldmm)
 {
@@ -45,6 +60,19 @@ static inline void khugepaged_fork(struct mm_struct *mm, struct mm_struct *oldmm
 static inline void khugepaged_exit(struct mm_struct *mm)
 {
 }
+static inline void khugepaged_mm_init(struct mm_struct *mm,
+				      struct mm_struct *oldmm)
+{
+}
+static inline int khugepaged_set_collapse_prio(struct mm_struct *mm,
+					       unsigned long prio)
+{
+	return -EINVAL;
+}
+static inline int khugepaged_get_collapse_prio(struct mm_struct *mm)
+{
+	return -EINVAL;
+}
 static inline void khugepaged_enter_vma(struct vm_area_struct *vma,
 					unsigned long vm_flags)
 {
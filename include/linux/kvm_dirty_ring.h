@@ -27,6 +27,27 @@ struct kvm_dirty_ring {
 	int index;
 };
 
+/**
+ * kvm_dirty_ring_reset: state of a reset spanning the rings of all vCPUs
+ *
+ * @slot:        slot of the pending range
+ * @offset:      first gfn offset of the pending range
+ * @mask:        gfns of the pending range to write-protect again
+ * @memslot:     memslot looked up for @memslot_id
+ * @memslot_id:  slot id of @memslot
+ * @nr_masks:    number of ranges write-protected so far
+ * @locked:      mmu_lock is held
+ */
+struct kvm_dirty_ring_reset {
+	u32 slot;
+	u64 offset;
+	u64 mask;
+	struct kvm_memory_slot *memslot;
+	u32 memslot_id;
+	unsigned int nr_masks;
+	bool locked;
+};
+
 #ifndef CONFIG_HAVE_KVM_DIRTY_RING
 /*
  * If CONFIG_HAVE_HVM_DIRTY_RING not defined, kvm_dirty_ring.o should
@@ -48,12 +69,22 @@ static inline int kvm_dirty_ring_alloc(struct kvm_dirty_ring *ring,
 	return 0;
 }
 
+static inline void kvm_dirty_ring_reset_init(struct kvm_dirty_ring_reset *reset)
+{
+}
+
 static inline int kvm_dirty_ring_reset(struct kvm *kvm,
-				       struct kvm_dirty_ring *ring)
+				       struct kvm_dirty_ring *ring,
+				       struct kvm_dirty_ring_reset *reset)
 {
 	return 0;
 }
 
+static inline void kvm_dirty_ring_reset_finish(struct kvm *kvm,
+					struct kvm_dirty_ring_reset *reset)
+{
+}
+
 static inline void kvm_dirty_ring_push(struct kvm_vcpu *vcpu,
 				       u32 slot, u64 offset)
 {
@@ -79,9 +110,15 @@ int kvm_dirty_ring_alloc(struct kvm_dirty_ring *ring, int index, u32 size);
 
 /*
  * called with kvm->slots_lock held, returns the number of
- * processed pages.
+ * processed pages.  The rings of all vCPUs are reset under one
+ * @reset, which batches the write-protection of their entries;
+ * kvm_dirty_ring_reset_finish() must be called once they are done.
  */
-int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring);
+void kvm_dirty_ring_reset_init(struct kvm_dirty_ring_reset *reset);
+int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring,
+			 struct kvm_dirty_ring_reset *reset);
+void kvm_dirty_ring_reset_finish(struct kvm *kvm,
+				 struct kvm_dirty_ring_reset *reset);
 
 /*
  * returns =0: successfully pushed
@@ -80,6 +80,12 @@
 /* Two fragments for cross MMIO pages. */
 #define KVM_MAX_MMIO_FRAGMENTS	2
 
+/*
+ * Buckets of the recent halt histogram used by the adaptive halt-polling
+ * policy; bucket i holds halts shorter than 2^(i + 11) ns.
+ */
+#define KVM_HALT_RECENT_BUCKETS	20
+
 #ifndef KVM_MAX_NR_ADDRESS_SPACES
 #define KVM_MAX_NR_ADDRESS_SPACES	1
 #endif
@@ -347,6 +353,10 @@ struct kvm_vcpu {
 	sigset_t sigset;
 	unsigned int halt_poll_ns;
 	bool valid_wakeup;
+	/* Decaying histogram of recent halt durations, see kvm_vcpu_halt() */
+	u16 halt_recent[KVM_HALT_RECENT_BUCKETS];
+	u16 halt_recent_samples;
+	u64 halt_recent_ns;
 
 #ifdef CONFIG_HAS_IOMEM
 	int mmio_needed;
@@ -1953,7 +1963,11 @@ struct _kvm_stats_desc {
 			HALT_POLL_HIST_COUNT),				       \
 	STATS_DESC_LOGHIST_TIME_NSEC(VCPU_GENERIC, halt_wait_hist,	       \
 			HALT_POLL_HIST_COUNT),				       \
-	STATS_DESC_IBOOLEAN(VCPU_GENERIC, blocking)
+	STATS_DESC_IBOOLEAN(VCPU_GENERIC, blocking),			       \
+	STATS_DESC_LOGHIST_TIME_NSEC(VCPU_GENERIC, halt_hist,		       \
+			HALT_POLL_HIST_COUNT),				       \
+	STATS_DESC_INSTANT(VCPU_GENERIC, halt_poll_window_ns,		       \
+		KVM_STATS_UNIT_SECONDS, KVM_STATS_BASE_POW10, -9)
 
 extern struct dentry *kvm_debugfs_dir;
 
@@ -2199,6 +2213,7 @@ extern unsigned int halt_poll_ns;
 extern unsigned int halt_poll_ns_grow;
 extern unsigned int halt_poll_ns_grow_start;
 extern unsigned int halt_poll_ns_shrink;
+extern unsigned int halt_poll_ns_budget;
 
 struct kvm_device {
 	const struct kvm_device_ops *ops;
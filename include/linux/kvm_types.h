@@ -113,6 +113,8 @@ struct kvm_vcpu_stat_generic {
 	u64 halt_poll_fail_hist[HALT_POLL_HIST_COUNT];
 	u64 halt_wait_hist[HALT_POLL_HIST_COUNT];
 	u64 blocking;
+	u64 halt_hist[HALT_POLL_HIST_COUNT];
+	u64 halt_poll_window_ns;
 };
 
 #define KVM_STATS_NAME_SIZE	48
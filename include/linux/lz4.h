@@ -221,6 +221,28 @@ int LZ4_compress_default(const char *source, char *dest, int inputSize,
 int LZ4_compress_fast(const char *source, char *dest, int inputSize,
 	int maxOutputSize, int acceleration, void *wrkmem);
 
+/**
+ * LZ4_compress_page() - Compress exactly one page
+ * @source: source address of the page, PAGE_SIZE bytes
+ * @dest: output buffer address of the compressed data
+ * @maxOutputSize: full or partial size of buffer 'dest'
+ *	which must be already allocated
+ * @wrkmem: address of the working memory.
+ *	This requires 'workmem' of LZ4_MEM_COMPRESS.
+ *
+ * Same as LZ4_compress_default() with an inputSize of PAGE_SIZE, for the
+ * swap and zram paths that only ever compress pages. The input length is
+ * known at compile time and the hash table is sized for one page, so that
+ * only that much of 'wrkmem' has to be cleared and kept in cache. The
+ * output is a regular LZ4 block, but not necessarily the same bytes as
+ * LZ4_compress_default() produces.
+ *
+ * Return: Number of bytes written into buffer 'dest'
+ *	(necessarily <= maxOutputSize) or 0 if compression fails
+ */
+int LZ4_compress_page(const char *source, char *dest, int maxOutputSize,
+	void *wrkmem);
+
 /**
  * LZ4_compress_destSize() - Compress as much data as possible
  *	from source to dest
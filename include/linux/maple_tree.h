@@ -311,7 +311,18 @@ struct ma_topiary {
 	struct maple_tree *mtree;
 };
 
+/*
+ * A range and the entry to store in it, for mtree_store_ranges().
+ */
+struct maple_range {
+	unsigned long index;
+	unsigned long last;
+	void *entry;
+};
+
 void *mtree_load(struct maple_tree *mt, unsigned long index);
+void mtree_load_many(struct maple_tree *mt, const unsigned long *indices,
+		void **entries, unsigned long nr);
 
 int mtree_insert(struct maple_tree *mt, unsigned long index,
 		void *entry, gfp_t gfp);
@@ -331,6 +342,8 @@ int mtree_store_range(struct maple_tree *mt, unsigned long first,
 		      unsigned long last, void *entry, gfp_t gfp);
 int mtree_store(struct maple_tree *mt, unsigned long index,
 		void *entry, gfp_t gfp);
+int mtree_store_ranges(struct maple_tree *mt, const struct maple_range *ranges,
+		unsigned long nr, gfp_t gfp);
 void *mtree_erase(struct maple_tree *mt, unsigned long index);
 
 int mtree_dup(struct maple_tree *mt, struct maple_tree *new, gfp_t gfp);
@@ -314,6 +314,16 @@ struct mem_cgroup {
 	struct deferred_split deferred_split_queue;
 #endif
 
+#ifdef CONFIG_NUMA_BALANCING
+	/* memory.numa_promote_rate_limit, in pages per second */
+	unsigned long numa_promote_rate_limit;
+	/* memory.numa_hot_threshold_ms, 0 to use the system default */
+	unsigned int numa_hot_threshold;
+	/* start and candidates of the current rate limit period */
+	unsigned int numa_rl_start;
+	atomic_long_t numa_rl_nr_cand;
+#endif
+
 #ifdef CONFIG_LRU_GEN_WALKS_MMU
 	/* per-memcg mm_struct list */
 	struct lru_gen_mm_list mm_list;
@@ -696,7 +706,7 @@ int mem_cgroup_hugetlb_try_charge(struct mem_cgroup *memcg, gfp_t gfp,
 
 int mem_cgroup_swapin_charge_folio(struct folio *folio, struct mm_struct *mm,
 				  gfp_t gfp, swp_entry_t entry);
-void mem_cgroup_swapin_uncharge_swap(swp_entry_t entry);
+void mem_cgroup_swapin_uncharge_swap(swp_entry_t entry, unsigned int nr_pages);
 
 void __mem_cgroup_uncharge(struct folio *folio);
 
@@ -781,6 +791,8 @@ struct mem_cgroup *get_mem_cgroup_from_mm(struct mm_struct *mm);
 
 struct mem_cgroup *get_mem_cgroup_from_current(void);
 
+struct mem_cgroup *get_mem_cgroup_from_folio(struct folio *folio);
+
 struct lruvec *folio_lruvec_lock(struct folio *folio);
 struct lruvec *folio_lruvec_lock_irq(struct folio *folio);
 struct lruvec *folio_lruvec_lock_irqsave(struct folio *folio,
@@ -1242,7 +1254,8 @@ static inline int mem_cgroup_swapin_charge_folio(struct folio *folio,
 	return 0;
 }
 
-static inline void mem_cgroup_swapin_uncharge_swap(swp_entry_t entry)
+static inline void mem_cgroup_swapin_uncharge_swap(swp_entry_t entry,
+						    unsigned int nr_pages)
 {
 }
 
@@ -1306,6 +1319,11 @@ static inline struct mem_cgroup *get_mem_cgroup_from_current(void)
 	return NULL;
 }
 
+static inline struct mem_cgroup *get_mem_cgroup_from_folio(struct folio *folio)
+{
+	return NULL;
+}
+
 static inline
 struct mem_cgroup *mem_cgroup_from_css(struct cgroup_subsys_state *css)
 {
@@ -1932,4 +1950,19 @@ static inline bool mem_cgroup_zswap_writeback_enabled(struct mem_cgroup *memcg)
 }
 #endif
 
+#if defined(CONFIG_MEMCG) && defined(CONFIG_NUMA_BALANCING)
+unsigned int mem_cgroup_numa_hot_threshold(struct folio *folio);
+bool mem_cgroup_numa_promotion_rate_limit(struct folio *folio, int nr);
+#else
+static inline unsigned int mem_cgroup_numa_hot_threshold(struct folio *folio)
+{
+	return 0;
+}
+static inline bool mem_cgroup_numa_promotion_rate_limit(struct folio *folio,
+							int nr)
+{
+	return false;
+}
+#endif
+
 #endif /* _LINUX_MEMCONTROL_H */
@@ -178,6 +178,9 @@ static inline bool mpol_is_preferred_many(struct mempolicy *pol)
 
 extern bool apply_policy_zone(struct mempolicy *policy, enum zone_type zone);
 
+struct access_coordinate;
+int mempolicy_set_node_perf(unsigned int node, struct access_coordinate *coords);
+
 #else
 
 struct mempolicy {};
@@ -298,5 +301,12 @@ static inline bool mpol_is_preferred_many(struct mempolicy *pol)
 	return  false;
 }
 
+struct access_coordinate;
+static inline int mempolicy_set_node_perf(unsigned int node,
+					  struct access_coordinate *coords)
+{
+	return 0;
+}
+
 #endif /* CONFIG_NUMA */
 #endif
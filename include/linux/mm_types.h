@@ -733,6 +733,10 @@ struct vm_area_struct {
 #ifdef CONFIG_SWAP
 	atomic_long_t swap_readahead_info;
 #endif
+#ifdef CONFIG_MMU
+	/* Adaptive fault-around window, see do_fault_around() */
+	atomic_long_t fault_around_info;
+#endif
 #ifndef CONFIG_MMU
 	struct vm_region *vm_region;	/* NOMMU mapping region */
 #endif
@@ -760,6 +764,7 @@ struct mm_cid {
 
 struct kioctx_table;
 struct iommu_mm_data;
+struct futex_private_hash;
 struct mm_struct {
 	struct {
 		/*
@@ -947,6 +952,19 @@ struct mm_struct {
 
 		/* numa_scan_seq prevents two threads remapping PTEs. */
 		int numa_scan_seq;
+#endif
+#ifdef CONFIG_FUTEX
+		/* Hash table for private futexes, see PR_FUTEX_HASH. */
+		struct futex_private_hash *futex_phash;
+#endif
+#ifdef CONFIG_SMP
+		/*
+		 * A CPU in the LLC the threads of this mm are seen running on
+		 * most (-1 until there is one), and the votes that back it;
+		 * see task_tick_cache().
+		 */
+		int sched_llc_cpu;
+		int sched_llc_votes;
 #endif
 		/*
 		 * An operation with batched TLB flushing is going on. Anything
@@ -987,6 +1005,17 @@ struct mm_struct {
 		 */
 		atomic_long_t ksm_zero_pages;
 #endif /* CONFIG_KSM */
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+		/*
+		 * Scanned on khugepaged's priority queue, set through
+		 * PR_SET_THP_COLLAPSE_PRIO and inherited across fork and exec.
+		 */
+		bool khugepaged_prio;
+		/* PMD ranges of this mm that khugepaged scanned */
+		unsigned long khugepaged_scanned;
+		/* PMD ranges of this mm that khugepaged collapsed */
+		unsigned long khugepaged_collapsed;
+#endif /* CONFIG_TRANSPARENT_HUGEPAGE */
 #ifdef CONFIG_LRU_GEN_WALKS_MMU
 		struct {
 			/* this mm_struct is on lru_gen_mm_list */
@@ -489,6 +489,8 @@ struct lru_gen_mm_walk {
 	unsigned long seq;
 	/* the next address within an mm to scan */
 	unsigned long next_addr;
+	/* the end of the range of the mm to scan */
+	unsigned long end_addr;
 	/* to batch promoted pages */
 	int nr_pages[MAX_NR_GENS][ANON_AND_FILE][MAX_NR_ZONES];
 	/* to batch the mm stats */
@@ -686,6 +688,18 @@ enum zone_watermarks {
 #define	PCPF_PREV_FREE_HIGH_ORDER	BIT(0)
 #define	PCPF_FREE_HIGH_BATCH		BIT(1)
 
+#ifdef CONFIG_PCP_STATS
+/* Protected by per_cpu_pages.lock, shown in /proc/zoneinfo */
+struct per_cpu_pages_stats {
+	unsigned long hit;		/* allocations served from the lists */
+	unsigned long refill;		/* refills from the buddy allocator */
+	unsigned long refill_pages;	/* pages added by refills */
+	unsigned long drain;		/* drains to the buddy allocator */
+	unsigned long drain_pages;	/* pages returned by drains */
+	u64 drain_lock_ns;		/* zone->lock hold time of drains */
+};
+#endif
+
 struct per_cpu_pages {
 	spinlock_t lock;	/* Protects lists field */
 	int count;		/* number of pages in the list */
@@ -702,6 +716,9 @@ struct per_cpu_pages {
 
 	/* Lists of pages, one per migrate type stored on the pcp-lists */
 	struct list_head lists[NR_PCP_LISTS];
+#ifdef CONFIG_PCP_STATS
+	struct per_cpu_pages_stats stats;
+#endif
 } ____cacheline_aligned_in_smp;
 
 struct per_cpu_zonestat {
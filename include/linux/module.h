@@ -443,6 +443,12 @@ struct module {
 	const s32 *gpl_crcs;
 	bool using_gplonly_symbols;
 
+	/* Hash table nodes of all the exported symbols above */
+	struct mod_export_node *export_nodes;
+
+	/* Microseconds it took to load and initialize the module */
+	unsigned long load_time_us;
+
 #ifdef CONFIG_MODULE_SIG
 	/* Signature was verified. */
 	bool sig_ok;
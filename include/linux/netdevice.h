@@ -339,6 +339,9 @@ struct gro_list {
  * napi_struct::gro_bitmask
  */
 #define GRO_HASH_BUCKETS	8
+#define GRO_HASH_BUCKETS_MAX	BITS_PER_LONG
+
+struct gro_hash;
 
 /*
  * Structure for NAPI scheduling similar to tasklet but with weighting
@@ -354,8 +357,12 @@ struct napi_struct {
 
 	unsigned long		state;
 	int			weight;
-	int			defer_hard_irqs_count;
+	u32			defer_hard_irqs_count;
+	u32			defer_hard_irqs;
 	unsigned long		gro_bitmask;
+	unsigned int		gro_hash_mask;
+	unsigned long		gro_flush_timeout;
+	unsigned long		irq_suspend_timeout;
 	int			(*poll)(struct napi_struct *, int);
 #ifdef CONFIG_NETPOLL
 	/* CPU actively polling if netpoll is configured */
@@ -364,17 +371,28 @@ struct napi_struct {
 	/* CPU on which NAPI has been scheduled for processing */
 	int			list_owner;
 	struct net_device	*dev;
-	struct gro_list		gro_hash[GRO_HASH_BUCKETS];
+	struct gro_list		*gro_hash;
 	struct sk_buff		*skb;
 	struct list_head	rx_list; /* Pending GRO_NORMAL skbs */
 	int			rx_count; /* length of rx_list */
+	unsigned long		gro_packets; /* skbs offered to GRO */
+	unsigned long		gro_merged; /* skbs merged into a held skb */
+	unsigned long		gro_evicted; /* held skbs flushed early */
 	unsigned int		napi_id;
 	struct hrtimer		timer;
 	struct task_struct	*thread;
+	u32			thread_busy_poll_usecs; /* idle time before sleep */
+	u32			thread_busy_poll_budget; /* 0: use weight */
+	u64			thread_poll_ns; /* busy polling with work */
+	u64			thread_idle_ns; /* busy polling an idle queue */
+	unsigned long		thread_sleeps; /* busy poll periods ended */
 	/* control-path-only fields follow */
 	struct list_head	dev_list;
 	struct hlist_node	napi_hash_node;
 	int			irq;
+	struct gro_hash		*gro_hash_table; /* NULL if gro_hash_default */
+	struct gro_hash		*gro_hash_next; /* pending resize */
+	struct gro_list		gro_hash_default[GRO_HASH_BUCKETS];
 };
 
 enum {
@@ -2621,6 +2639,7 @@ static inline void netif_napi_set_irq(struct napi_struct *napi, int irq)
 
 void netif_napi_add_weight(struct net_device *dev, struct napi_struct *napi,
 			   int (*poll)(struct napi_struct *, int), int weight);
+void napi_init_for_gro(struct napi_struct *napi);
 
 /**
  * netif_napi_add() - initialize a NAPI context
@@ -3089,6 +3108,8 @@ u16 dev_pick_tx_cpu_id(struct net_device *dev, struct sk_buff *skb,
 
 int __dev_queue_xmit(struct sk_buff *skb, struct net_device *sb_dev);
 int __dev_direct_xmit(struct sk_buff *skb, u16 queue_id);
+int __dev_direct_xmit_bulk(struct net_device *dev, struct sk_buff **skbs,
+			   unsigned int n, u16 queue_id, unsigned int *sent);
 
 static inline int dev_queue_xmit(struct sk_buff *skb)
 {
@@ -3209,6 +3230,13 @@ struct softnet_data {
 #endif
 
 	unsigned int		received_rps;
+#ifdef CONFIG_RPS
+	unsigned int		rfs_steered;	/* steered to the flow's app CPU */
+	unsigned int		rfs_mismatch;	/* no sock flow table entry */
+	unsigned int		rfs_accel_steered; /* ndo_rx_flow_steer() done */
+#endif
+	unsigned int		skb_tx_cache_hit;  /* TX head reused from cache */
+	unsigned int		skb_tx_cache_miss; /* TX head taken from slab */
 	bool			in_net_rx_action;
 	bool			in_napi_threaded_poll;
 
@@ -38,6 +38,53 @@ static inline int nf_hook_ingress(struct sk_buff *skb)
 	return ret;
 }
 
+/* Packets stolen by ingress hooks (e.g. the flowtable fast path) while the
+ * receive path processes a list of skbs are transmitted in one go, once the
+ * whole list went through the hooks.
+ */
+struct nf_ingress_xmit_batch {
+	struct sk_buff	*head;
+	struct sk_buff	*tail;
+	unsigned int	count;
+	bool		active;
+};
+
+DECLARE_PER_CPU(struct nf_ingress_xmit_batch, nf_ingress_xmit_batch);
+
+void nf_ingress_xmit(struct sk_buff *skb, int neigh_table,
+		     const void *nexthop);
+void __nf_ingress_xmit_flush(struct nf_ingress_xmit_batch *b);
+
+/* caller must hold rcu_read_lock, with BH disabled */
+static inline bool nf_ingress_xmit_batch_begin(void)
+{
+	struct nf_ingress_xmit_batch *b;
+
+#ifdef CONFIG_JUMP_LABEL
+	if (!static_key_false(&nf_hooks_needed[NFPROTO_NETDEV][NF_NETDEV_INGRESS]))
+		return false;
+#endif
+	b = this_cpu_ptr(&nf_ingress_xmit_batch);
+	if (b->active)
+		return false;
+
+	b->active = true;
+	return true;
+}
+
+static inline void nf_ingress_xmit_batch_end(bool owner)
+{
+	struct nf_ingress_xmit_batch *b;
+
+	if (!owner)
+		return;
+
+	b = this_cpu_ptr(&nf_ingress_xmit_batch);
+	b->active = false;
+	if (b->head)
+		__nf_ingress_xmit_flush(b);
+}
+
 #else /* CONFIG_NETFILTER_INGRESS */
 static inline int nf_hook_ingress_active(struct sk_buff *skb)
 {
@@ -48,6 +95,15 @@ static inline int nf_hook_ingress(struct sk_buff *skb)
 {
 	return 0;
 }
+
+static inline bool nf_ingress_xmit_batch_begin(void)
+{
+	return false;
+}
+
+static inline void nf_ingress_xmit_batch_end(bool owner)
+{
+}
 #endif /* CONFIG_NETFILTER_INGRESS */
 
 #ifdef CONFIG_NETFILTER_EGRESS
@@ -163,6 +163,8 @@ struct netfs_cache_resources {
 	void				*cache_priv2;
 	unsigned int			debug_id;	/* Cookie debug ID */
 	unsigned int			inval_counter;	/* object->inval_counter at begin_op */
+	loff_t				data_start;	/* Last data extent found by prepare_read */
+	loff_t				data_end;
 };
 
 /*
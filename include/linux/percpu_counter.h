@@ -283,4 +283,124 @@ percpu_counter_sub_local(struct percpu_counter *fbc, s64 amount)
 	percpu_counter_add_local(fbc, -amount);
 }
 
+/*
+ * A percpu_node_counter is a percpu_counter with a level per NUMA node in
+ * between the per-cpu counts and the global count: a CPU whose count
+ * reaches the batch folds it into the count of its node, and only a node
+ * count that reaches the batch times the number of CPUs of the node is
+ * folded into the global count, under the global lock.  The global lock and
+ * cacheline are thus only touched once per node batch, and
+ * percpu_node_counter_read() adds up one count per node instead of one per
+ * CPU, with an error of at most the batch per online CPU.
+ */
+#if defined(CONFIG_SMP) && defined(CONFIG_NUMA)
+
+struct percpu_node_count {
+	atomic64_t count;
+} ____cacheline_aligned_in_smp;
+
+struct percpu_node_counter {
+	struct percpu_counter fbc;
+	struct percpu_node_count **nodes;
+};
+
+int __percpu_node_counter_init(struct percpu_node_counter *pnc, s64 amount,
+			       gfp_t gfp, struct lock_class_key *key);
+void percpu_node_counter_destroy(struct percpu_node_counter *pnc);
+void percpu_node_counter_add_batch(struct percpu_node_counter *pnc,
+				   s64 amount, s32 batch);
+s64 percpu_node_counter_read(struct percpu_node_counter *pnc);
+s64 percpu_node_counter_sum(struct percpu_node_counter *pnc);
+
+static inline void
+percpu_node_counter_add(struct percpu_node_counter *pnc, s64 amount)
+{
+	percpu_node_counter_add_batch(pnc, amount, percpu_counter_batch);
+}
+
+#else /* !(CONFIG_SMP && CONFIG_NUMA) */
+
+struct percpu_node_counter {
+	struct percpu_counter fbc;
+};
+
+#ifdef CONFIG_SMP
+static inline int __percpu_node_counter_init(struct percpu_node_counter *pnc,
+					     s64 amount, gfp_t gfp,
+					     struct lock_class_key *key)
+{
+	return __percpu_counter_init_many(&pnc->fbc, amount, gfp, 1, key);
+}
+#else
+static inline int __percpu_node_counter_init(struct percpu_node_counter *pnc,
+					     s64 amount, gfp_t gfp,
+					     struct lock_class_key *key)
+{
+	return percpu_counter_init(&pnc->fbc, amount, gfp);
+}
+#endif
+
+static inline void percpu_node_counter_destroy(struct percpu_node_counter *pnc)
+{
+	percpu_counter_destroy(&pnc->fbc);
+}
+
+static inline void
+percpu_node_counter_add_batch(struct percpu_node_counter *pnc, s64 amount,
+			      s32 batch)
+{
+	percpu_counter_add_batch(&pnc->fbc, amount, batch);
+}
+
+static inline void
+percpu_node_counter_add(struct percpu_node_counter *pnc, s64 amount)
+{
+	percpu_counter_add(&pnc->fbc, amount);
+}
+
+static inline s64 percpu_node_counter_read(struct percpu_node_counter *pnc)
+{
+	return percpu_counter_read(&pnc->fbc);
+}
+
+static inline s64 percpu_node_counter_sum(struct percpu_node_counter *pnc)
+{
+	return percpu_counter_sum(&pnc->fbc);
+}
+
+#endif /* CONFIG_SMP && CONFIG_NUMA */
+
+#define percpu_node_counter_init(pnc, value, gfp)			\
+	({								\
+		static struct lock_class_key __key;			\
+									\
+		__percpu_node_counter_init(pnc, value, gfp, &__key);	\
+	})
+
+static inline void percpu_node_counter_inc(struct percpu_node_counter *pnc)
+{
+	percpu_node_counter_add(pnc, 1);
+}
+
+static inline void percpu_node_counter_dec(struct percpu_node_counter *pnc)
+{
+	percpu_node_counter_add(pnc, -1);
+}
+
+static inline s64
+percpu_node_counter_read_positive(struct percpu_node_counter *pnc)
+{
+	s64 ret = percpu_node_counter_read(pnc);
+
+	return ret < 0 ? 0 : ret;
+}
+
+static inline s64
+percpu_node_counter_sum_positive(struct percpu_node_counter *pnc)
+{
+	s64 ret = percpu_node_counter_sum(pnc);
+
+	return ret < 0 ? 0 : ret;
+}
+
 #endif /* _LINUX_PERCPU_COUNTER_H */
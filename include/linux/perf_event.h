@@ -795,6 +795,9 @@ struct perf_event {
 	struct perf_addr_filter_range	*addr_filter_ranges;
 	unsigned long			addr_filters_gen;
 
+	/* per-cacheline counters for attr.aggr_addr events */
+	struct perf_addr_aggr		*addr_aggr;
+
 	/* for aux_output events */
 	struct perf_event		*aux_event;
 
@@ -42,6 +42,7 @@ struct pipe_buffer {
  *	@max_usage: The maximum number of slots that may be used in the ring
  *	@ring_size: total number of buffers (should be a power of 2)
  *	@nr_accounted: The amount this pipe accounts for in user->pipe_bufs
+ *	@buf_order: The page order of the buffers allocated for large writes
  *	@tmp_page: cached released page
  *	@readers: number of current readers of this pipe
  *	@writers: number of current writers of this pipe
@@ -63,6 +64,7 @@ struct pipe_inode_info {
 	unsigned int max_usage;
 	unsigned int ring_size;
 	unsigned int nr_accounted;
+	unsigned int buf_order;
 	unsigned int readers;
 	unsigned int writers;
 	unsigned int files;
@@ -283,8 +285,9 @@ bool too_many_pipe_buffers_soft(unsigned long user_bufs);
 bool too_many_pipe_buffers_hard(unsigned long user_bufs);
 bool pipe_is_unprivileged_user(void);
 
-/* for F_SETPIPE_SZ and F_GETPIPE_SZ */
+/* for F_SETPIPE_SZ, F_GETPIPE_SZ, F_SETPIPE_BUF_SZ and F_GETPIPE_BUF_SZ */
 int pipe_resize_ring(struct pipe_inode_info *pipe, unsigned int nr_slots);
+void pipe_grow_direct(struct pipe_inode_info *pipe, size_t size);
 long pipe_fcntl(struct file *, unsigned int, unsigned int arg);
 struct pipe_inode_info *get_pipe_info(struct file *file, bool for_splice);
 
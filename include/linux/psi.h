@@ -38,6 +38,7 @@ static inline struct psi_group *cgroup_psi(struct cgroup *cgrp)
 }
 
 int psi_cgroup_alloc(struct cgroup *cgrp);
+void psi_cgroup_release(struct cgroup *cgrp);
 void psi_cgroup_free(struct cgroup *cgrp);
 void cgroup_move_task(struct task_struct *p, struct css_set *to);
 void psi_cgroup_restart(struct psi_group *group);
@@ -55,6 +56,9 @@ static inline int psi_cgroup_alloc(struct cgroup *cgrp)
 {
 	return 0;
 }
+static inline void psi_cgroup_release(struct cgroup *cgrp)
+{
+}
 static inline void psi_cgroup_free(struct cgroup *cgrp)
 {
 }
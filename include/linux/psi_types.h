@@ -104,6 +104,14 @@ struct psi_group_cpu {
 	/* Delta detection against the sampling buckets */
 	u32 times_prev[NR_PSI_AGGREGATORS][NR_PSI_STATES]
 			____cacheline_aligned_in_smp;
+
+	/*
+	 * With psi_leaf_only, times the child groups propagated into this
+	 * group, and this group's own subtree times last propagated into
+	 * its parent.  Protected by psi_subtree_lock.
+	 */
+	u32 children_times[NR_PSI_STATES];
+	u32 pushed_times[NR_PSI_STATES];
 };
 
 /* PSI growth tracking window */
@@ -163,6 +171,9 @@ struct psi_group {
 	struct psi_group *parent;
 	bool enabled;
 
+	/* The cgroup of a cgroup's group, NULL for psi_system */
+	struct cgroup *cgroup;
+
 	/* Protects data used by the aggregator */
 	struct mutex avgs_lock;
 
@@ -25,6 +25,7 @@
 #include <linux/workqueue.h>
 #include <linux/rculist.h>
 #include <linux/bit_spinlock.h>
+#include <linux/prefetch.h>
 
 #include <linux/rhashtable-types.h>
 /*
@@ -586,44 +587,55 @@ static inline int rhashtable_compare(struct rhashtable_compare_arg *arg,
 }
 
 /* Internal function, do not use. */
-static inline struct rhash_head *__rhashtable_lookup(
-	struct rhashtable *ht, const void *key,
-	const struct rhashtable_params params)
+static inline struct rhash_head *__rhashtable_lookup_bucket(
+	struct rhashtable *ht, struct bucket_table *tbl,
+	struct rhash_lock_head __rcu *const *bkt, unsigned int hash,
+	const void *key, const struct rhashtable_params params)
 {
 	struct rhashtable_compare_arg arg = {
 		.ht = ht,
 		.key = key,
 	};
-	struct rhash_lock_head __rcu *const *bkt;
-	struct bucket_table *tbl;
 	struct rhash_head *he;
-	unsigned int hash;
 
-	tbl = rht_dereference_rcu(ht->tbl, ht);
-restart:
-	hash = rht_key_hashfn(ht, tbl, key, params);
-	bkt = rht_bucket(tbl, hash);
-	do {
-		rht_for_each_rcu_from(he, rht_ptr_rcu(bkt), tbl, hash) {
-			if (params.obj_cmpfn ?
-			    params.obj_cmpfn(&arg, rht_obj(ht, he)) :
-			    rhashtable_compare(&arg, rht_obj(ht, he)))
-				continue;
-			return he;
-		}
-		/* An object might have been moved to a different hash chain,
-		 * while we walk along it - better check and retry.
-		 */
-	} while (he != RHT_NULLS_MARKER(bkt));
+	for (;;) {
+		do {
+			rht_for_each_rcu_from(he, rht_ptr_rcu(bkt), tbl, hash) {
+				if (params.obj_cmpfn ?
+				    params.obj_cmpfn(&arg, rht_obj(ht, he)) :
+				    rhashtable_compare(&arg, rht_obj(ht, he)))
+					continue;
+				return he;
+			}
+			/* An object might have been moved to a different hash
+			 * chain, while we walk along it - better check and retry.
+			 */
+		} while (he != RHT_NULLS_MARKER(bkt));
 
-	/* Ensure we see any new tables. */
-	smp_rmb();
+		/* Ensure we see any new tables. */
+		smp_rmb();
 
-	tbl = rht_dereference_rcu(tbl->future_tbl, ht);
-	if (unlikely(tbl))
-		goto restart;
+		tbl = rht_dereference_rcu(tbl->future_tbl, ht);
+		if (likely(!tbl))
+			return NULL;
 
-	return NULL;
+		hash = rht_key_hashfn(ht, tbl, key, params);
+		bkt = rht_bucket(tbl, hash);
+	}
+}
+
+/* Internal function, do not use. */
+static inline struct rhash_head *__rhashtable_lookup(
+	struct rhashtable *ht, const void *key,
+	const struct rhashtable_params params)
+{
+	struct bucket_table *tbl;
+	unsigned int hash;
+
+	tbl = rht_dereference_rcu(ht->tbl, ht);
+	hash = rht_key_hashfn(ht, tbl, key, params);
+	return __rhashtable_lookup_bucket(ht, tbl, rht_bucket(tbl, hash), hash,
+					  key, params);
 }
 
 /**
@@ -675,6 +687,68 @@ static inline void *rhashtable_lookup_fast(
 	return obj;
 }
 
+/* Number of keys rhashtable_lookup_bulk() has cache misses in flight for */
+#define RHT_LOOKUP_BATCH	16
+
+/**
+ * rhashtable_lookup_bulk - search hash table for a number of keys
+ * @ht:		hash table
+ * @keys:	the pointers to the keys
+ * @objs:	array filled in with the first matching entry for each key
+ * @n:		number of keys
+ * @params:	hash table parameters
+ *
+ * Works through the keys RHT_LOOKUP_BATCH at a time: hashes all of them and
+ * prefetches their buckets, then prefetches the first entry of each chain,
+ * and only then walks the chains.  The cache misses of the keys of a batch
+ * are thus taken in parallel rather than one after the other, which is what
+ * a burst of packets being classified wants.  An entry of @objs is set to
+ * %NULL if there is no entry for its key.
+ *
+ * This must only be called under the RCU read lock.
+ *
+ * Returns the number of keys for which an entry was found.
+ */
+static inline unsigned int rhashtable_lookup_bulk(
+	struct rhashtable *ht, const void *const *keys, void **objs,
+	unsigned int n, const struct rhashtable_params params)
+{
+	struct rhash_lock_head __rcu *const *bkts[RHT_LOOKUP_BATCH];
+	unsigned int hashes[RHT_LOOKUP_BATCH];
+	struct bucket_table *tbl;
+	unsigned int i, j, nr, found = 0;
+
+	tbl = rht_dereference_rcu(ht->tbl, ht);
+	for (i = 0; i < n; i += nr) {
+		nr = min_t(unsigned int, n - i, RHT_LOOKUP_BATCH);
+
+		for (j = 0; j < nr; j++) {
+			hashes[j] = rht_key_hashfn(ht, tbl, keys[i + j], params);
+			bkts[j] = rht_bucket(tbl, hashes[j]);
+			prefetch(bkts[j]);
+		}
+
+		for (j = 0; j < nr; j++) {
+			struct rhash_head *he = rht_ptr_rcu(bkts[j]);
+
+			if (!rht_is_a_nulls(he))
+				prefetch(rht_obj(ht, he) + params.key_offset);
+		}
+
+		for (j = 0; j < nr; j++) {
+			struct rhash_head *he;
+
+			he = __rhashtable_lookup_bucket(ht, tbl, bkts[j],
+							hashes[j], keys[i + j],
+							params);
+			objs[i + j] = he ? rht_obj(ht, he) : NULL;
+			found += !!he;
+		}
+	}
+
+	return found;
+}
+
 /**
  * rhltable_lookup - search hash list table
  * @hlt:	hash table
@@ -0,0 +1,71 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * BPF extensible scheduler class: task and dispatch queue state.
+ *
+ * See kernel/sched/ext.c for the scheduler side.
+ */
+#ifndef _LINUX_SCHED_EXT_H
+#define _LINUX_SCHED_EXT_H
+
+#ifdef CONFIG_SCHED_CLASS_EXT
+
+#include <linux/list.h>
+#include <linux/rhashtable-types.h>
+#include <linux/spinlock_types.h>
+
+enum scx_public_consts {
+	SCX_OPS_NAME_LEN	= 128,
+	SCX_SLICE_DFL		= 20 * 1000000,	/* 20ms */
+};
+
+/*
+ * DSQ (dispatch queue) IDs are 64bit. Bit 63 is set for the built-in DSQs:
+ * SCX_DSQ_GLOBAL is shared by all CPUs and SCX_DSQ_LOCAL is the local DSQ of
+ * the CPU a task is enqueued on, which is where that CPU picks its next task
+ * from. IDs without bit 63 set are free for scx_bpf_create_dsq().
+ */
+enum scx_dsq_id_flags {
+	SCX_DSQ_FLAG_BUILTIN	= 1LLU << 63,
+
+	SCX_DSQ_INVALID		= SCX_DSQ_FLAG_BUILTIN | 0,
+	SCX_DSQ_GLOBAL		= SCX_DSQ_FLAG_BUILTIN | 1,
+	SCX_DSQ_LOCAL		= SCX_DSQ_FLAG_BUILTIN | 2,
+};
+
+/*
+ * A FIFO of runnable tasks. The local DSQ of a CPU is only touched with its
+ * rq lock held; the global and custom DSQs can be consumed by any CPU and
+ * @lock is what serializes them.
+ */
+struct scx_dispatch_q {
+	raw_spinlock_t		lock;
+	struct list_head	list;		/* tasks in dispatch order */
+	u32			nr;
+	u64			id;
+	struct rhash_head	hash_node;
+};
+
+/* sched_ext_entity.flags */
+enum scx_ent_flags {
+	SCX_TASK_QUEUED		= 1 << 0, /* on ext runqueue */
+	SCX_TASK_ENQ_LOCAL	= 1 << 1, /* next enqueue goes to the local DSQ */
+};
+
+/*
+ * The per-task state. @dsq is only set with the rq lock of the task held, but
+ * may be cleared by a CPU consuming the task off a shared DSQ; @holding_cpu
+ * then tells that CPU whether the task is still its to migrate once it has
+ * acquired the task's rq lock.
+ */
+struct sched_ext_entity {
+	struct scx_dispatch_q	*dsq;
+	struct list_head	dsq_node;	/* on @dsq->list */
+	struct list_head	runnable_node;	/* on rq->scx.runnable_list */
+	unsigned long		runnable_at;	/* jiffies, for the watchdog */
+	u32			flags;
+	s32			holding_cpu;
+	u64			slice;		/* ns left, refilled on dispatch */
+};
+
+#endif	/* CONFIG_SCHED_CLASS_EXT */
+#endif	/* _LINUX_SCHED_EXT_H */
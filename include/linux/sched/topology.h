@@ -82,6 +82,13 @@ struct sched_domain_shared {
 	atomic_t	nr_busy_cpus;
 	int		has_idle_cores;
 	int		nr_idle_scan;
+	/*
+	 * Idle CPUs and idle cores of the LLC, two cpumasks back to back,
+	 * maintained on idle entry and exit for select_idle_cpu().
+	 *
+	 * NOTE: this field is variable length, see sched_domain::span.
+	 */
+	unsigned long	idle_masks[];
 };
 
 struct sched_domain {
@@ -109,6 +116,15 @@ struct sched_domain {
 	u64 max_newidle_lb_cost;
 	unsigned long last_decay_max_lb_cost;
 
+	/* sched_balance_newidle() limits and counters */
+	u64 newidle_cost_cap;		/* max ns spent up to this domain, 0: none */
+	unsigned int newidle_failed;	/* consecutive passes that pulled nothing */
+	unsigned int newidle_backoff;	/* passes left to skip */
+	unsigned long newidle_attempts;
+	unsigned long newidle_success;
+	unsigned long newidle_skipped;
+	u64 newidle_time;		/* ns spent in passes over this domain */
+
 #ifdef CONFIG_SCHEDSTATS
 	/* sched_balance_rq() stats */
 	unsigned int lb_count[CPU_MAX_IDLE_TYPES];
@@ -139,6 +155,10 @@ struct sched_domain {
 	unsigned int ttwu_wake_remote;
 	unsigned int ttwu_move_affine;
 	unsigned int ttwu_move_balance;
+
+	/* select_idle_cpu() stats */
+	unsigned int sis_search;
+	unsigned int sis_scanned;
 #endif
 #ifdef CONFIG_SCHED_DEBUG
 	char *name;
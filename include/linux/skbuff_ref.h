@@ -17,6 +17,13 @@
  */
 static inline void __skb_frag_ref(skb_frag_t *frag)
 {
+	struct net_iov *niov = skb_frag_net_iov(frag);
+
+	if (niov) {
+		atomic_long_inc(&niov->pp_ref_count);
+		return;
+	}
+
 	get_page(skb_frag_page(frag));
 }
 
@@ -33,6 +40,7 @@ static inline void skb_frag_ref(struct sk_buff *skb, int f)
 }
 
 bool napi_pp_put_page(struct page *page);
+bool napi_pp_put_netmem(netmem_ref netmem);
 
 static inline void
 skb_page_unref(struct page *page, bool recycle)
@@ -44,6 +52,24 @@ skb_page_unref(struct page *page, bool recycle)
 	put_page(page);
 }
 
+static inline void
+skb_netmem_unref(netmem_ref netmem, bool recycle)
+{
+	if (!netmem_is_net_iov(netmem)) {
+		skb_page_unref(netmem_to_page(netmem), recycle);
+		return;
+	}
+
+#ifdef CONFIG_PAGE_POOL
+	if (recycle && napi_pp_put_netmem(netmem))
+		return;
+#endif
+	/* net_iovs only ever come from a page_pool and cannot be freed any
+	 * other way; leak rather than corrupt the provider's accounting.
+	 */
+	WARN_ON_ONCE(1);
+}
+
 /**
  * __skb_frag_unref - release a reference on a paged fragment.
  * @frag: the paged fragment
@@ -54,7 +80,7 @@ skb_page_unref(struct page *page, bool recycle)
  */
 static inline void __skb_frag_unref(skb_frag_t *frag, bool recycle)
 {
-	skb_page_unref(skb_frag_page(frag), recycle);
+	skb_netmem_unref(frag->netmem, recycle);
 }
 
 /**
@@ -56,6 +56,9 @@ enum _slab_flag_bits {
 #endif
 	_SLAB_OBJECT_POISON,
 	_SLAB_CMPXCHG_DOUBLE,
+#ifndef CONFIG_SLUB_TINY
+	_SLAB_SHEAVES,
+#endif
 #ifdef CONFIG_SLAB_OBJ_EXT
 	_SLAB_NO_OBJ_EXT,
 #endif
@@ -205,6 +208,17 @@ enum _slab_flag_bits {
 #endif
 #define SLAB_TEMPORARY		SLAB_RECLAIM_ACCOUNT	/* Objects are short-lived */
 
+/*
+ * Keep a per cpu array of freed objects in front of the slab freelists,
+ * refilled and flushed in batches. Meant for hot caches with a lot of
+ * objects freed on another cpu than they were allocated on.
+ */
+#ifndef CONFIG_SLUB_TINY
+#define SLAB_SHEAVES		__SLAB_FLAG_BIT(_SLAB_SHEAVES)
+#else
+#define SLAB_SHEAVES		__SLAB_FLAG_UNUSED
+#endif
+
 /* Slab created using create_boot_cache */
 #ifdef CONFIG_SLAB_OBJ_EXT
 #define SLAB_NO_OBJ_EXT		__SLAB_FLAG_BIT(_SLAB_NO_OBJ_EXT)
@@ -3,6 +3,8 @@
 #define _LINUX_SORT_H
 
 #include <linux/types.h>
+#include <linux/log2.h>
+#include <linux/minmax.h>
 
 void sort_r(void *base, size_t num, size_t size,
 	    cmp_r_func_t cmp_func,
@@ -13,4 +15,117 @@ void sort(void *base, size_t num, size_t size,
 	  cmp_func_t cmp_func,
 	  swap_func_t swap_func);
 
+/* Partitions at most this long are left to the insertion sort */
+#define SORT_INSERTION_THRESHOLD	16
+
+/**
+ * DEFINE_SORT - define an unstable sort for an array of a given type
+ * @name: name of the function to define
+ * @type: type of the array elements
+ * @less: function or macro taking two (const @type *) and returning true if
+ *        the first element sorts before the second one
+ *
+ * Defines "static void @name(@type *base, size_t num)", an introsort:
+ * a quicksort with median-of-three pivots that falls back to a heapsort
+ * if it recurses too deep, and leaves short partitions to an insertion
+ * sort.  As the comparison and the element moves are inlined for @type,
+ * this is quite a bit faster than sort(), which goes through function
+ * pointers for every comparison and swap, at the cost of a copy of the
+ * code per type.  Elements are moved by assignment, so @type must be
+ * something that can be copied that way.  Like sort(), it is not stable.
+ */
+#define DEFINE_SORT(name, type, less)					\
+static void name##_insertion(type *base, size_t num)			\
+{									\
+	size_t i, j;							\
+									\
+	for (i = 1; i < num; i++) {					\
+		type tmp = base[i];					\
+									\
+		for (j = i; j > 0 && less(&tmp, &base[j - 1]); j--)	\
+			base[j] = base[j - 1];				\
+		base[j] = tmp;						\
+	}								\
+}									\
+									\
+static void name##_sift_down(type *base, size_t root, size_t num)	\
+{									\
+	type tmp = base[root];						\
+	size_t child;							\
+									\
+	while ((child = 2 * root + 1) < num) {				\
+		if (child + 1 < num &&					\
+		    less(&base[child], &base[child + 1]))		\
+			child++;					\
+		if (!less(&tmp, &base[child]))				\
+			break;						\
+		base[root] = base[child];				\
+		root = child;						\
+	}								\
+	base[root] = tmp;						\
+}									\
+									\
+static void name##_heapsort(type *base, size_t num)			\
+{									\
+	size_t i;							\
+									\
+	for (i = num / 2; i > 0; i--)					\
+		name##_sift_down(base, i - 1, num);			\
+	for (i = num - 1; i > 0; i--) {					\
+		swap(base[0], base[i]);					\
+		name##_sift_down(base, 0, i);				\
+	}								\
+}									\
+									\
+static void name##_introsort(type *base, size_t num, unsigned int depth)\
+{									\
+	while (num > SORT_INSERTION_THRESHOLD) {			\
+		size_t mid = num / 2, i = 0, j = num - 1;		\
+		type pivot;						\
+									\
+		if (!depth--) {						\
+			name##_heapsort(base, num);			\
+			return;						\
+		}							\
+									\
+		/* base[0] <= base[mid] <= base[num - 1] */		\
+		if (less(&base[mid], &base[0]))				\
+			swap(base[mid], base[0]);			\
+		if (less(&base[num - 1], &base[mid])) {			\
+			swap(base[num - 1], base[mid]);			\
+			if (less(&base[mid], &base[0]))			\
+				swap(base[mid], base[0]);		\
+		}							\
+		pivot = base[mid];					\
+									\
+		/* The outer elements stop the scans from overrunning */\
+		for (;;) {						\
+			while (less(&base[++i], &pivot))		\
+				;					\
+			while (less(&pivot, &base[--j]))		\
+				;					\
+			if (i >= j)					\
+				break;					\
+			swap(base[i], base[j]);				\
+		}							\
+									\
+		/* Recurse into the smaller side, loop on the larger */	\
+		if (i < num - i) {					\
+			name##_introsort(base, i, depth);		\
+			base += i;					\
+			num -= i;					\
+		} else {						\
+			name##_introsort(base + i, num - i, depth);	\
+			num = i;					\
+		}							\
+	}								\
+	name##_insertion(base, num);					\
+}									\
+									\
+static void __maybe_unused name(type *base, size_t num)			\
+{									\
+	if (num > 1)							\
+		name##_introsort(base, num, 2 * ilog2(num));		\
+}
+
 #endif
@@ -385,6 +385,8 @@ struct tcp_sock {
 
 	u8	keepalive_probes; /* num of allowed keep alive probes	*/
 	u32	tcp_tx_delay;	/* delay (in usec) added to TX packets */
+	u32	ack_thin_bytes;	/* max bulk data held un-ACKed, 0 = route */
+	u32	tx_plug_us;	/* max time (in usec) sendmsg data is held */
 
 /* RTT measurement */
 	u32	mdev_max_us;	/* maximal mdev for the last rtt period	*/
@@ -42,6 +42,7 @@ enum {
 	UDP_FLAGS_ENCAP_ENABLED, /* This socket enabled encap */
 	UDP_FLAGS_UDPLITE_SEND_CC, /* set via udplite setsockopt */
 	UDP_FLAGS_UDPLITE_RECV_CC, /* set via udplite setsockopt */
+	UDP_FLAGS_GRO_SEGLENS,	/* Report GRO segment lengths */
 };
 
 struct udp_sock {
@@ -139,6 +140,8 @@ static inline bool udp_get_no_check6_rx(const struct sock *sk)
 	return udp_test_bit(NO_CHECK6_RX, sk);
 }
 
+void udp_cmsg_recv_seglens(struct msghdr *msg, struct sk_buff *skb);
+
 static inline void udp_cmsg_recv(struct msghdr *msg, struct sock *sk,
 				 struct sk_buff *skb)
 {
@@ -147,6 +150,8 @@ static inline void udp_cmsg_recv(struct msghdr *msg, struct sock *sk,
 	if (skb_shinfo(skb)->gso_type & SKB_GSO_UDP_L4) {
 		gso_size = skb_shinfo(skb)->gso_size;
 		put_cmsg(msg, SOL_UDP, UDP_GRO, sizeof(gso_size), &gso_size);
+		if (udp_test_bit(GRO_SEGLENS, sk))
+			udp_cmsg_recv_seglens(msg, skb);
 	}
 }
 
@@ -123,11 +123,18 @@ extern int mfill_atomic_install_pte(pmd_t *dst_pmd,
 extern ssize_t mfill_atomic_copy(struct userfaultfd_ctx *ctx, unsigned long dst_start,
 				 unsigned long src_start, unsigned long len,
 				 uffd_flags_t flags);
+extern ssize_t mfill_atomic_copy_vec(struct userfaultfd_ctx *ctx,
+				     const struct uffdio_iovec *iov,
+				     unsigned long nr_iov, uffd_flags_t flags);
 extern ssize_t mfill_atomic_zeropage(struct userfaultfd_ctx *ctx,
 				     unsigned long dst_start,
 				     unsigned long len);
 extern ssize_t mfill_atomic_continue(struct userfaultfd_ctx *ctx, unsigned long dst_start,
 				     unsigned long len, uffd_flags_t flags);
+extern ssize_t mfill_atomic_continue_vec(struct userfaultfd_ctx *ctx,
+					 const struct uffdio_iovec *iov,
+					 unsigned long nr_iov,
+					 uffd_flags_t flags);
 extern ssize_t mfill_atomic_poison(struct userfaultfd_ctx *ctx, unsigned long start,
 				   unsigned long len, uffd_flags_t flags);
 extern int mwriteprotect_range(struct userfaultfd_ctx *ctx, unsigned long start,
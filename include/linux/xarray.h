@@ -1536,6 +1536,8 @@ static inline bool xas_retry(struct xa_state *xas, const void *entry)
 void *xas_load(struct xa_state *);
 void *xas_store(struct xa_state *, void *entry);
 void *xas_find(struct xa_state *, unsigned long max);
+unsigned int xas_peek_batch(const struct xa_state *, unsigned long max,
+		void **entries, unsigned int nr);
 void *xas_find_conflict(struct xa_state *);
 
 bool xas_get_mark(const struct xa_state *, xa_mark_t);
@@ -21,6 +21,7 @@
  */
 
 /* ======   Dependency   ====== */
+#include <linux/list.h>
 #include <linux/types.h>
 #include <linux/zstd_errors.h>
 #include <linux/zstd_lib.h>
@@ -180,6 +181,126 @@ zstd_cctx *zstd_init_cctx(void *workspace, size_t workspace_size);
 size_t zstd_compress_cctx(zstd_cctx *cctx, void *dst, size_t dst_capacity,
 	const void *src, size_t src_size, const zstd_parameters *parameters);
 
+/* ======   Shared Compression Contexts   ====== */
+
+/**
+ * struct zstd_cctx_pool - a pool of compression contexts for one workspace size
+ *
+ * Compression workspaces are large (over a megabyte at the higher levels)
+ * and most users only keep them to have one at hand when they need it.  A
+ * pool is shared by all the users whose parameters need the same workspace
+ * size, and keeps its idle workspaces per NUMA node, on the memory of that
+ * node, growing up to one workspace per CPU of the node.
+ */
+struct zstd_cctx_pool;
+
+/**
+ * struct zstd_pool_cctx - a compression context taken from a zstd_cctx_pool
+ * @cctx: The context, initialized with zstd_init_cctx().
+ */
+struct zstd_pool_cctx {
+	zstd_cctx *cctx;
+	/* private: */
+	void *workspace;
+	struct list_head list;
+	int node;
+};
+
+/**
+ * zstd_cctx_pool_get() - get a reference to the pool for some parameters
+ * @parameters: The compression parameters to be used.
+ *
+ * Context:    May sleep.
+ * Return:     A pool holding workspaces large enough for @parameters, shared
+ *             with the other users of the same workspace size, or NULL if
+ *             out of memory.
+ */
+struct zstd_cctx_pool *zstd_cctx_pool_get(
+	const zstd_compression_parameters *parameters);
+
+/**
+ * zstd_cctx_pool_put() - drop a reference taken with zstd_cctx_pool_get()
+ * @pool: The pool. All its contexts must have been given back.
+ */
+void zstd_cctx_pool_put(struct zstd_cctx_pool *pool);
+
+/**
+ * zstd_cctx_pool_take() - take a compression context out of a pool
+ * @pool: The pool.
+ *
+ * Takes an idle context of the local node if there is one, allocates a new
+ * one on the local node if the node is below its limit, takes an idle
+ * context of another node otherwise, and finally waits for a context to be
+ * given back.
+ *
+ * Context: May sleep.
+ * Return:  A context, or NULL if the pool has none and none can be allocated.
+ */
+struct zstd_pool_cctx *zstd_cctx_pool_take(struct zstd_cctx_pool *pool);
+
+/**
+ * zstd_cctx_pool_give() - give back a context taken with zstd_cctx_pool_take()
+ * @pool: The pool.
+ * @pctx: The context.
+ */
+void zstd_cctx_pool_give(struct zstd_cctx_pool *pool,
+	struct zstd_pool_cctx *pctx);
+
+/* ======   Dictionary Compression   ====== */
+
+/**
+ * struct zstd_custom_mem - allocator for the objects zstd creates itself
+ * @customAlloc: Allocation function, called with @opaque and a size.
+ * @customFree:  Free function, called with @opaque and an address.
+ * @opaque:      Passed to both.
+ *
+ * See zstd_lib.h.
+ */
+typedef ZSTD_customMem zstd_custom_mem;
+
+typedef ZSTD_CDict zstd_cdict;
+
+/**
+ * zstd_create_cdict_byreference() - digest a dictionary for compression
+ * @dict:       The dictionary, either raw content or a trained zstd dictionary.
+ *              It is referenced, not copied, so it must outlive the cdict.
+ * @dict_size:  The size of @dict.
+ * @cparams:    The compression parameters the cdict will be used with.
+ * @custom_mem: The allocator for the cdict.
+ *
+ * A cdict can be shared by any number of contexts compressing at the same
+ * time.  Small inputs, such as 4K pages, compress much better against a
+ * dictionary trained on data of the same kind.
+ *
+ * Return:      The cdict, or NULL on error.
+ */
+zstd_cdict *zstd_create_cdict_byreference(const void *dict, size_t dict_size,
+	zstd_compression_parameters cparams, zstd_custom_mem custom_mem);
+
+/**
+ * zstd_free_cdict() - free a cdict created by zstd_create_cdict_byreference()
+ * @cdict: The cdict, may be NULL.
+ *
+ * Return: Always zero.
+ */
+size_t zstd_free_cdict(zstd_cdict *cdict);
+
+/**
+ * zstd_compress_using_cdict() - compress src into dst using a dictionary
+ * @cctx:         The context. Must have been initialized with zstd_init_cctx().
+ * @dst:          The buffer to compress src into.
+ * @dst_capacity: The size of the destination buffer.
+ * @src:          The data to compress.
+ * @src_size:     The size of the data to compress.
+ * @cdict:        The digested dictionary, which also sets the parameters.
+ *
+ * Return:        The compressed size or an error, which can be checked using
+ *                zstd_is_error().
+ */
+size_t zstd_compress_using_cdict(zstd_cctx *cctx, void *dst,
+	size_t dst_capacity, const void *src, size_t src_size,
+	const zstd_cdict *cdict);
+
 /* ======   Single-pass Decompression   ====== */
 
 typedef ZSTD_DCtx zstd_dctx;
@@ -220,6 +341,46 @@ zstd_dctx *zstd_init_dctx(void *workspace, size_t workspace_size);
 size_t zstd_decompress_dctx(zstd_dctx *dctx, void *dst, size_t dst_capacity,
 	const void *src, size_t src_size);
 
+/* ======   Dictionary Decompression   ====== */
+
+typedef ZSTD_DDict zstd_ddict;
+
+/**
+ * zstd_create_ddict_byreference() - digest a dictionary for decompression
+ * @dict:       The dictionary the data was compressed with. It is referenced,
+ *              not copied, so it must outlive the ddict.
+ * @dict_size:  The size of @dict.
+ * @custom_mem: The allocator for the ddict.
+ *
+ * Return:      The ddict, or NULL on error.
+ */
+zstd_ddict *zstd_create_ddict_byreference(const void *dict, size_t dict_size,
+	zstd_custom_mem custom_mem);
+
+/**
+ * zstd_free_ddict() - free a ddict created by zstd_create_ddict_byreference()
+ * @ddict: The ddict, may be NULL.
+ *
+ * Return: Always zero.
+ */
+size_t zstd_free_ddict(zstd_ddict *ddict);
+
+/**
+ * zstd_decompress_using_ddict() - decompress src into dst using a dictionary
+ * @dctx:         The decompression context.
+ * @dst:          The buffer to decompress src into.
+ * @dst_capacity: The size of the destination buffer.
+ * @src:          The zstd compressed data to decompress.
+ * @src_size:     The exact size of the data to decompress.
+ * @ddict:        The digested dictionary the data was compressed with.
+ *
+ * Return:        The decompressed size or an error, which can be checked using
+ *                zstd_is_error().
+ */
+size_t zstd_decompress_using_ddict(zstd_dctx *dctx, void *dst,
+	size_t dst_capacity, const void *src, size_t src_size,
+	const zstd_ddict *ddict);
+
 /* ======   Streaming Buffers   ====== */
 
 /**
@@ -359,6 +359,16 @@ void nf_ct_tmpl_free(struct nf_conn *tmpl);
 u32 nf_ct_get_id(const struct nf_conn *ct);
 u32 nf_conntrack_count(const struct net *net);
 
+struct nf_conntrack_gc_stats {
+	u64	passes;		/* completed scans of a shard */
+	u64	scanned;	/* entries visited */
+	u64	expired;	/* entries reaped or early dropped */
+	u64	time_ns;	/* time spent in gc workers */
+	u32	shards;
+};
+
+void nf_conntrack_gc_stats(struct nf_conntrack_gc_stats *st);
+
 static inline void
 nf_ct_set(struct sk_buff *skb, struct nf_conn *ct, enum ip_conntrack_info info)
 {
@@ -8,28 +8,70 @@
 #ifndef _NET_NETMEM_H
 #define _NET_NETMEM_H
 
+#include <linux/atomic.h>
+#include <linux/bug.h>
+#include <linux/types.h>
+
+struct page_pool;
+struct dmabuf_genpool_chunk_owner;
+
+/* net_iov is a chunk of memory that is not backed by a struct page, such as
+ * a page-sized piece of a dma-buf bound to an RX queue. The page_pool fields
+ * mirror their struct page counterparts.
+ */
+struct net_iov {
+	unsigned long __unused_padding;
+	unsigned long pp_magic;
+	struct page_pool *pp;
+	struct dmabuf_genpool_chunk_owner *owner;
+	unsigned long dma_addr;
+	atomic_long_t pp_ref_count;
+};
+
 /**
  * typedef netmem_ref - a nonexistent type marking a reference to generic
  * network memory.
  *
- * A netmem_ref currently is always a reference to a struct page. This
- * abstraction is introduced so support for new memory types can be added.
+ * A netmem_ref is either a reference to a struct page, or, with the NET_IOV
+ * bit set, a reference to a struct net_iov. Memory referenced by a net_iov
+ * may not be readable by the CPU at all.
  *
  * Use the supplied helpers to obtain the underlying memory pointer and fields.
  */
 typedef unsigned long __bitwise netmem_ref;
 
+#define NET_IOV 0x01UL
+
+static inline bool netmem_is_net_iov(const netmem_ref netmem)
+{
+	return (__force unsigned long)netmem & NET_IOV;
+}
+
 /* This conversion fails (returns NULL) if the netmem_ref is not struct page
  * backed.
- *
- * Currently struct page is the only possible netmem, and this helper never
- * fails.
  */
 static inline struct page *netmem_to_page(netmem_ref netmem)
 {
+	if (WARN_ON_ONCE(netmem_is_net_iov(netmem)))
+		return NULL;
+
 	return (__force struct page *)netmem;
 }
 
+static inline struct net_iov *netmem_to_net_iov(netmem_ref netmem)
+{
+	if (netmem_is_net_iov(netmem))
+		return (struct net_iov *)((__force unsigned long)netmem &
+					  ~NET_IOV);
+
+	return NULL;
+}
+
+static inline netmem_ref net_iov_to_netmem(struct net_iov *niov)
+{
+	return (__force netmem_ref)((unsigned long)niov | NET_IOV);
+}
+
 /* Converting from page to netmem is always safe, because a page can always be
  * a netmem.
  */
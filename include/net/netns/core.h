@@ -7,6 +7,7 @@
 struct ctl_table_header;
 struct prot_inuse;
 struct cpumask;
+struct rps_sock_flow_table;
 
 struct netns_core {
 	/* core sysctls */
@@ -23,6 +24,9 @@ struct netns_core {
 #if IS_ENABLED(CONFIG_RPS) && IS_ENABLED(CONFIG_SYSCTL)
 	struct cpumask *rps_default_mask;
 #endif
+#ifdef CONFIG_RPS
+	struct rps_sock_flow_table __rcu *rps_sock_flow_table;
+#endif
 };
 
 #endif
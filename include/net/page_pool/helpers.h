@@ -419,6 +419,37 @@ static inline void page_pool_dma_sync_for_cpu(const struct page_pool *pool,
 				      page_pool_get_dma_dir(pool));
 }
 
+/**
+ * page_pool_get_dma_addr_netmem() - Retrieve the stored DMA address.
+ * @netmem:	netmem allocated from a page pool
+ *
+ * Same as page_pool_get_dma_addr(), for any netmem, including net_iovs which
+ * are mapped by their memory provider.
+ */
+static inline dma_addr_t page_pool_get_dma_addr_netmem(netmem_ref netmem)
+{
+	struct net_iov *niov = netmem_to_net_iov(netmem);
+
+	if (niov)
+		return niov->dma_addr;
+
+	return page_pool_get_dma_addr(netmem_to_page(netmem));
+}
+
+/**
+ * page_pool_dev_alloc_netmem() - allocate a netmem from a page pool
+ * @pool: pool from which to allocate
+ *
+ * Get a netmem, plain page or net_iov depending on the memory provider
+ * configured for the pool. Returns 0 on failure.
+ */
+static inline netmem_ref page_pool_dev_alloc_netmem(struct page_pool *pool)
+{
+	gfp_t gfp = (GFP_ATOMIC | __GFP_NOWARN);
+
+	return page_pool_alloc_netmem(pool, gfp);
+}
+
 static inline bool page_pool_put(struct page_pool *pool)
 {
 	return refcount_dec_and_test(&pool->user_cnt);
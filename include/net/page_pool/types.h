@@ -6,6 +6,7 @@
 #include <linux/dma-direction.h>
 #include <linux/ptr_ring.h>
 #include <linux/types.h>
+#include <net/netmem.h>
 
 #define PP_FLAG_DMA_MAP		BIT(0) /* Should page_pool do the DMA
 					* map/unmap
@@ -19,8 +20,19 @@
 					* device driver responsibility
 					*/
 #define PP_FLAG_SYSTEM_POOL	BIT(2) /* Global system page_pool */
+
+/* Allow unreadable (net_iov backed) netmem in this page_pool. Drivers setting
+ * this must be able to support unreadable netmem, where netmem_address() would
+ * return NULL. This flag should not be set for header page_pools.
+ *
+ * If the driver sets PP_FLAG_ALLOW_UNREADABLE_NETMEM, it should also set
+ * page_pool_params.slow.queue_idx.
+ */
+#define PP_FLAG_ALLOW_UNREADABLE_NETMEM BIT(3)
+
 #define PP_FLAG_ALL		(PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV | \
-				 PP_FLAG_SYSTEM_POOL)
+				 PP_FLAG_SYSTEM_POOL | \
+				 PP_FLAG_ALLOW_UNREADABLE_NETMEM)
 
 /*
  * Fast allocation side cache array/stack
@@ -56,7 +68,9 @@ struct pp_alloc_cache {
  * @offset:	DMA sync address offset for PP_FLAG_DMA_SYNC_DEV
  * @slow:	params with slowpath access only (initialization and Netlink)
  * @netdev:	netdev this pool will serve (leave as NULL if none or multiple)
- * @flags:	PP_FLAG_DMA_MAP, PP_FLAG_DMA_SYNC_DEV, PP_FLAG_SYSTEM_POOL
+ * @queue_idx:	queue idx this page_pool is being created for.
+ * @flags:	PP_FLAG_DMA_MAP, PP_FLAG_DMA_SYNC_DEV, PP_FLAG_SYSTEM_POOL,
+ *		PP_FLAG_ALLOW_UNREADABLE_NETMEM.
  */
 struct page_pool_params {
 	struct_group_tagged(page_pool_params_fast, fast,
@@ -71,6 +85,7 @@ struct page_pool_params {
 	);
 	struct_group_tagged(page_pool_params_slow, slow,
 		struct net_device *netdev;
+		unsigned int queue_idx;
 		unsigned int	flags;
 /* private: used by test code only */
 		void (*init_callback)(struct page *page, void *arg);
@@ -88,6 +103,8 @@ struct page_pool_params {
  * @refill:	an allocation which triggered a refill of the cache
  * @waive:	pages obtained from the ptr ring that cannot be added to
  *		the cache due to a NUMA mismatch
+ * @nid_changed: pool moved to the NUMA node its consumer now runs on
+ * @cross_node:	slow path pages the page allocator placed on another node
  */
 struct page_pool_alloc_stats {
 	u64 fast;
@@ -96,6 +113,8 @@ struct page_pool_alloc_stats {
 	u64 empty;
 	u64 refill;
 	u64 waive;
+	u64 nid_changed;
+	u64 cross_node;
 };
 
 /**
@@ -105,6 +124,7 @@ struct page_pool_alloc_stats {
  * @ring:	page placed into the ptr ring
  * @ring_full:	page released from page pool because the ptr ring was full
  * @released_refcnt:	page released (and not recycled) because refcnt > 1
+ * @remote_node: page placed into the ptr ring from a CPU on another node
  */
 struct page_pool_recycle_stats {
 	u64 cached;
@@ -112,6 +132,7 @@ struct page_pool_recycle_stats {
 	u64 ring;
 	u64 ring_full;
 	u64 released_refcnt;
+	u64 remote_node;
 };
 
 /**
@@ -128,6 +149,10 @@ struct page_pool_stats {
 };
 #endif
 
+struct pp_memory_provider_params {
+	void *mp_priv;
+};
+
 struct page_pool {
 	struct page_pool_params_fast p;
 
@@ -208,6 +233,9 @@ struct page_pool {
 
 	u64 destroy_cnt;
 
+	/* Memory provider (dma-buf binding) the pool allocates net_iovs from */
+	void *mp_priv;
+
 	/* Slow/Control-path information follows */
 	struct page_pool_params_slow slow;
 	/* User-facing fields, protected by page_pools_lock */
@@ -255,6 +283,10 @@ void page_pool_put_unrefed_page(struct page_pool *pool, struct page *page,
 				unsigned int dma_sync_size,
 				bool allow_direct);
 
+netmem_ref page_pool_alloc_netmem(struct page_pool *pool, gfp_t gfp);
+void page_pool_put_full_netmem(struct page_pool *pool, netmem_ref netmem,
+			       bool allow_direct);
+
 static inline bool is_page_pool_compiled_in(void)
 {
 #ifdef CONFIG_PAGE_POOL
@@ -4,6 +4,7 @@
 
 #include <linux/types.h>
 #include <linux/static_key.h>
+#include <linux/hash.h>
 #include <net/sock.h>
 #include <net/hotdata.h>
 
@@ -55,9 +56,18 @@ struct rps_dev_flow_table {
  * possible CPUs : rps_cpu_mask = roundup_pow_of_two(nr_cpu_ids) - 1
  * For example, if 64 CPUs are possible, rps_cpu_mask = 0x3f,
  * meaning we use 32-6=26 bits for the hash.
+ *
+ * Every flow has two candidate entries: the one indexed by the low-order
+ * bits of its hash, and one derived from the hash mixed with a per-table
+ * random seed. A flow only displaces another one when both of its entries
+ * are taken, which keeps colliding flows from evicting each other.
+ *
+ * A network namespace may install its own table; otherwise the one in
+ * net_hotdata, sized through init_net, is used.
  */
 struct rps_sock_flow_table {
 	u32	mask;
+	u32	seed;
 
 	u32	ents[] ____cacheline_aligned_in_smp;
 };
@@ -65,11 +75,46 @@ struct rps_sock_flow_table {
 
 #define RPS_NO_CPU 0xffff
 
+static inline struct rps_sock_flow_table *
+rps_sock_flow_table_get(const struct net *net)
+{
+	struct rps_sock_flow_table *table;
+
+	table = rcu_dereference(net->core.rps_sock_flow_table);
+	if (!table)
+		table = rcu_dereference(net_hotdata.rps_sock_flow_table);
+	return table;
+}
+
+static inline unsigned int
+rps_sock_flow_alt_index(const struct rps_sock_flow_table *table, u32 hash)
+{
+	return ((u64)(hash ^ table->seed) * GOLDEN_RATIO_32 >> 32) & table->mask;
+}
+
+static inline bool rps_sock_flow_match(u32 ident, u32 hash)
+{
+	return !((ident ^ hash) & ~net_hotdata.rps_cpu_mask);
+}
+
 static inline void rps_record_sock_flow(struct rps_sock_flow_table *table,
 					u32 hash)
 {
 	unsigned int index = hash & table->mask;
 	u32 val = hash & ~net_hotdata.rps_cpu_mask;
+	u32 ent = READ_ONCE(table->ents[index]);
+
+	/* Prefer the entry already holding this flow, then a free one. */
+	if (!rps_sock_flow_match(ent, hash)) {
+		unsigned int alt = rps_sock_flow_alt_index(table, hash);
+		u32 alt_ent = READ_ONCE(table->ents[alt]);
+
+		if (rps_sock_flow_match(alt_ent, hash) ||
+		    (ent != RPS_NO_CPU && alt_ent == RPS_NO_CPU)) {
+			index = alt;
+			ent = alt_ent;
+		}
+	}
 
 	/* We only give a hint, preemption can change CPU under us */
 	val |= raw_smp_processor_id();
@@ -77,13 +122,13 @@ static inline void rps_record_sock_flow(struct rps_sock_flow_table *table,
 	/* The following WRITE_ONCE() is paired with the READ_ONCE()
 	 * here, and another one in get_rps_cpu().
 	 */
-	if (READ_ONCE(table->ents[index]) != val)
+	if (ent != val)
 		WRITE_ONCE(table->ents[index], val);
 }
 
 #endif /* CONFIG_RPS */
 
-static inline void sock_rps_record_flow_hash(__u32 hash)
+static inline void sock_rps_record_flow_hash(const struct net *net, __u32 hash)
 {
 #ifdef CONFIG_RPS
 	struct rps_sock_flow_table *sock_flow_table;
@@ -91,7 +136,7 @@ static inline void sock_rps_record_flow_hash(__u32 hash)
 	if (!hash)
 		return;
 	rcu_read_lock();
-	sock_flow_table = rcu_dereference(net_hotdata.rps_sock_flow_table);
+	sock_flow_table = rps_sock_flow_table_get(net);
 	if (sock_flow_table)
 		rps_record_sock_flow(sock_flow_table, hash);
 	rcu_read_unlock();
@@ -116,7 +161,8 @@ static inline void sock_rps_record_flow(const struct sock *sk)
 			/* This READ_ONCE() is paired with the WRITE_ONCE()
 			 * from sock_rps_save_rxhash() and sock_rps_reset_rxhash().
 			 */
-			sock_rps_record_flow_hash(READ_ONCE(sk->sk_rxhash));
+			sock_rps_record_flow_hash(sock_net(sk),
+						  READ_ONCE(sk->sk_rxhash));
 		}
 	}
 #endif
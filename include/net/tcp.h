@@ -134,6 +134,7 @@ void tcp_time_wait(struct sock *sk, int state, int timeo);
 #define TCP_FIN_TIMEOUT_MAX (120 * HZ) /* max TCP_LINGER2 value (two minutes) */
 
 #define TCP_DELACK_MAX	((unsigned)(HZ/5))	/* maximal time to delay before sending an ACK */
+#define TCP_TX_PLUG_MAX	(10 * USEC_PER_MSEC)	/* maximal TCP_TX_PLUG hold time */
 static_assert((1 << ATO_BITS) > TCP_DELACK_MAX);
 
 #if HZ >= 100
@@ -247,6 +247,10 @@ struct tls_context {
 			       */
 	unsigned long flags;
 
+	/* async decryption, under the rx reader lock, for sock_diag */
+	u32 rx_async_records;
+	u32 rx_async_inflight_max;
+
 	/* cache cold stuff */
 	struct proto *sk_proto;
 	struct sock *sk;
@@ -213,6 +213,7 @@ struct xdp_cpumap_stats {
 	unsigned int redirect;
 	unsigned int pass;
 	unsigned int drop;
+	unsigned int gro_merged; /* skbs coalesced by the kthread's GRO */
 };
 
 /* Clear kernel pointers in xdp_frame */
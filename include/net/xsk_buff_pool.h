@@ -89,6 +89,13 @@ struct xsk_buff_pool {
 	 * sockets share a single cq when the same netdev and queue id is shared.
 	 */
 	spinlock_t cq_lock;
+	/* Set when the fill ring is consumed by more than one pool. Points to
+	 * the pool that owns the fill ring and its fq_lock; the owner points
+	 * to itself.
+	 */
+	struct xsk_buff_pool *fq_pool;
+	/* Serializes consumers of a fill ring shared through XDP_SHARED_FILL. */
+	spinlock_t fq_lock;
 	struct xdp_buff_xsk *free_heads[];
 };
 
@@ -105,7 +112,7 @@ struct xsk_buff_pool *xp_create_and_assign_umem(struct xdp_sock *xs,
 int xp_assign_dev(struct xsk_buff_pool *pool, struct net_device *dev,
 		  u16 queue_id, u16 flags);
 int xp_assign_dev_shared(struct xsk_buff_pool *pool, struct xdp_sock *umem_xs,
-			 struct net_device *dev, u16 queue_id);
+			 struct net_device *dev, u16 queue_id, bool share_fq);
 int xp_alloc_tx_descs(struct xsk_buff_pool *pool, struct xdp_sock *xs);
 void xp_destroy(struct xsk_buff_pool *pool);
 void xp_get_pool(struct xsk_buff_pool *pool);
@@ -117,6 +124,18 @@ void xp_del_xsk(struct xsk_buff_pool *pool, struct xdp_sock *xs);
 /* AF_XDP, and XDP core. */
 void xp_free(struct xdp_buff_xsk *xskb);
 
+static inline void xp_fq_lock(struct xsk_buff_pool *pool)
+{
+	if (unlikely(pool->fq_pool))
+		spin_lock_bh(&pool->fq_pool->fq_lock);
+}
+
+static inline void xp_fq_unlock(struct xsk_buff_pool *pool)
+{
+	if (unlikely(pool->fq_pool))
+		spin_unlock_bh(&pool->fq_pool->fq_lock);
+}
+
 static inline void xp_init_xskb_addr(struct xdp_buff_xsk *xskb, struct xsk_buff_pool *pool,
 				     u64 addr)
 {
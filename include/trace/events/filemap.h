@@ -8,6 +8,7 @@
 #include <linux/types.h>
 #include <linux/tracepoint.h>
 #include <linux/mm.h>
+#include <linux/pagemap.h>
 #include <linux/memcontrol.h>
 #include <linux/device.h>
 #include <linux/kdev_t.h>
@@ -56,6 +57,106 @@ DEFINE_EVENT(mm_filemap_op_page_cache, mm_filemap_add_to_page_cache,
 	TP_ARGS(folio)
 	);
 
+/* A folio with an unconsumed readahead marker left the page cache */
+DEFINE_EVENT(mm_filemap_op_page_cache, mm_filemap_readahead_waste,
+	TP_PROTO(struct folio *folio),
+	TP_ARGS(folio)
+	);
+
+DECLARE_EVENT_CLASS(mm_filemap_readahead,
+
+	TP_PROTO(struct readahead_control *ractl, unsigned long req_count),
+
+	TP_ARGS(ractl, req_count),
+
+	TP_STRUCT__entry(
+		__field(unsigned long, i_ino)
+		__field(dev_t, s_dev)
+		__field(pgoff_t, index)
+		__field(unsigned long, req_count)
+		__field(pgoff_t, start)
+		__field(unsigned int, size)
+		__field(unsigned int, async_size)
+		__field(unsigned int, stride)
+	),
+
+	TP_fast_assign(
+		struct inode *inode = ractl->mapping->host;
+
+		__entry->i_ino = inode->i_ino;
+		if (inode->i_sb)
+			__entry->s_dev = inode->i_sb->s_dev;
+		else
+			__entry->s_dev = inode->i_rdev;
+		__entry->index = readahead_index(ractl);
+		__entry->req_count = req_count;
+		__entry->start = ractl->ra->start;
+		__entry->size = ractl->ra->size;
+		__entry->async_size = ractl->ra->async_size;
+		__entry->stride = ractl->ra->stride_count ? ractl->ra->stride : 0;
+	),
+
+	TP_printk("dev=%d:%d ino=%lx index=%lu req_count=%lu ra=%lu+%u async=%u stride=%u",
+		MAJOR(__entry->s_dev), MINOR(__entry->s_dev),
+		__entry->i_ino, __entry->index, __entry->req_count,
+		__entry->start, __entry->size, __entry->async_size,
+		__entry->stride)
+);
+
+/* Synchronous readahead, the pages were not in the page cache */
+DEFINE_EVENT(mm_filemap_readahead, mm_filemap_readahead_miss,
+	TP_PROTO(struct readahead_control *ractl, unsigned long req_count),
+	TP_ARGS(ractl, req_count)
+	);
+
+/* Asynchronous readahead, a readahead marker was hit */
+DEFINE_EVENT(mm_filemap_readahead, mm_filemap_readahead_hit,
+	TP_PROTO(struct readahead_control *ractl, unsigned long req_count),
+	TP_ARGS(ractl, req_count)
+	);
+
+/* Readahead of the next chunks of a strided read */
+DEFINE_EVENT(mm_filemap_readahead, mm_filemap_readahead_stride,
+	TP_PROTO(struct readahead_control *ractl, unsigned long req_count),
+	TP_ARGS(ractl, req_count)
+	);
+
+/*
+ * Fault-around: how many of the pages asked for were mapped by PTEs, a
+ * range that ended up mapped by a PMD reports none.
+ */
+TRACE_EVENT(mm_filemap_map_pages,
+
+	TP_PROTO(struct address_space *mapping, pgoff_t start, pgoff_t end,
+		 unsigned long mapped),
+
+	TP_ARGS(mapping, start, end, mapped),
+
+	TP_STRUCT__entry(
+		__field(unsigned long, i_ino)
+		__field(dev_t, s_dev)
+		__field(pgoff_t, start)
+		__field(pgoff_t, end)
+		__field(unsigned long, mapped)
+	),
+
+	TP_fast_assign(
+		__entry->i_ino = mapping->host->i_ino;
+		if (mapping->host->i_sb)
+			__entry->s_dev = mapping->host->i_sb->s_dev;
+		else
+			__entry->s_dev = mapping->host->i_rdev;
+		__entry->start = start;
+		__entry->end = end;
+		__entry->mapped = mapped;
+	),
+
+	TP_printk("dev=%d:%d ino=%lx index=%lu-%lu requested=%lu mapped=%lu",
+		MAJOR(__entry->s_dev), MINOR(__entry->s_dev),
+		__entry->i_ino, __entry->start, __entry->end,
+		__entry->end - __entry->start + 1, __entry->mapped)
+);
+
 TRACE_EVENT(filemap_set_wb_err,
 		TP_PROTO(struct address_space *mapping, errseq_t eseq),
 
@@ -194,6 +194,13 @@ DEFINE_EVENT(tmigr_cpugroup, tmigr_handle_remote_cpu,
 	TP_ARGS(tmc)
 );
 
+DEFINE_EVENT(tmigr_cpugroup, tmigr_cpu_idle_wakeup,
+
+	TP_PROTO(struct tmigr_cpu *tmc),
+
+	TP_ARGS(tmc)
+);
+
 DECLARE_EVENT_CLASS(tmigr_idle,
 
 	TP_PROTO(struct tmigr_cpu *tmc, u64 nextevt),
@@ -292,6 +299,28 @@ TRACE_EVENT(tmigr_handle_remote,
 		   __entry->group, __entry->lvl)
 );
 
+TRACE_EVENT(tmigr_handle_remote_walk,
+
+	TP_PROTO(struct tmigr_cpu *tmc, unsigned int depth, unsigned int expired),
+
+	TP_ARGS(tmc, depth, expired),
+
+	TP_STRUCT__entry(
+		__field( unsigned int ,	cpu	)
+		__field( unsigned int ,	depth	)
+		__field( unsigned int ,	expired	)
+	),
+
+	TP_fast_assign(
+		__entry->cpu		= tmc->cpuevt.cpu;
+		__entry->depth		= depth;
+		__entry->expired	= expired;
+	),
+
+	TP_printk("cpu=%d depth=%u expired=%u",
+		   __entry->cpu, __entry->depth, __entry->expired)
+);
+
 #endif /*  _TRACE_TIMER_MIGRATION_H */
 
 /* This part must be outside protection */
@@ -658,6 +658,13 @@ union bpf_iter_link_info {
  *			Look up the value of a spin-locked map without
  *			returning the lock. This must be specified if the
  *			elements contain a spinlock.
+ *		**BPF_F_PERCPU_SUM**
+ *			For **BPF_MAP_TYPE_PERCPU_HASH** and
+ *			**BPF_MAP_TYPE_LRU_PERCPU_HASH**, treat each value as
+ *			an array of **__u64** counters and return the sum over
+ *			all CPUs. The *values* buffer then only holds
+ *			*value_size* bytes per element. *value_size* must be
+ *			a multiple of 8.
  *
  *		On success, *count* elements from the map are copied into the
  *		user buffer, with the keys copied into *keys* and the values
@@ -1351,6 +1358,7 @@ enum {
 	BPF_NOEXIST	= 1, /* create new element if it didn't exist */
 	BPF_EXIST	= 2, /* update existing element */
 	BPF_F_LOCK	= 4, /* spin_lock-ed map_lookup/map_update */
+	BPF_F_PERCPU_SUM = 8, /* sum per-CPU values in map_lookup_batch */
 };
 
 /* flags for BPF_MAP_CREATE command */
@@ -1409,6 +1417,18 @@ enum {
 
 /* Do not translate kernel bpf_arena pointers to user pointers */
 	BPF_F_NO_USER_CONV	= (1U << 18),
+
+/* Start a hash map small and grow its bucket table as elements are added */
+	BPF_F_RESIZABLE		= (1U << 19),
+
+/* Give BPF_MAP_TYPE_RINGBUF one ring of max_entries bytes per possible CPU.
+ * The ring of CPU n is mmap()'ed at page offset n * (2 + 2 * max_entries /
+ * page size), with the same layout as a single ring.
+ */
+	BPF_F_RINGBUF_SHARDED	= (1U << 20),
+
+/* Spread the pages of a bpf_arena round-robin across memory nodes */
+	BPF_F_ARENA_INTERLEAVE	= (1U << 21),
 };
 
 /* Flags for BPF_PROG_QUERY. */
@@ -1483,6 +1503,10 @@ union bpf_attr {
 		 *
 		 * BPF_MAP_TYPE_ARENA - contains the address where user space
 		 * is going to mmap() the arena. It has to be page aligned.
+		 *
+		 * BPF_MAP_TYPE_LPM_TRIE - number of leading key bits (0, 8
+		 * or 16) resolved by a direct index table before walking
+		 * the trie. 0 disables the table.
 		 */
 		__u64	map_extra;
 
@@ -6581,6 +6605,9 @@ struct bpf_prog_info {
 	__u32 verified_insns;
 	__u32 attach_btf_obj_id;
 	__u32 attach_btf_id;
+	__u32 verified_states;
+	__u64 verification_time_ns;
+	__u32 verifier_prune_hits;
 } __attribute__((aligned(8)));
 
 struct bpf_map_info {
@@ -58,6 +58,12 @@
 #define F_GET_FILE_RW_HINT	(F_LINUX_SPECIFIC_BASE + 13)
 #define F_SET_FILE_RW_HINT	(F_LINUX_SPECIFIC_BASE + 14)
 
+/*
+ * Set and get the size of the buffers a pipe allocates for large writes
+ */
+#define F_SETPIPE_BUF_SZ	(F_LINUX_SPECIFIC_BASE + 15)
+#define F_GETPIPE_BUF_SZ	(F_LINUX_SPECIFIC_BASE + 16)
+
 /*
  * Valid hint values for F_{GET,SET}_RW_HINT. 0 is "not set", or can be
  * used to clear any hints previously set.
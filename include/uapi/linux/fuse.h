@@ -217,6 +217,11 @@
  *  - add backing_id to fuse_open_out, add FOPEN_PASSTHROUGH open flag
  *  - add FUSE_NO_EXPORT_SUPPORT init flag
  *  - add FUSE_NOTIFY_RESEND, add FUSE_HAS_RESEND init flag
+ *
+ *  7.41
+ *  - add FUSE_OVER_IO_URING init flag, add struct fuse_uring_cmd_req and
+ *    enum fuse_uring_cmd
+ *  - add FOPEN_PASSTHROUGH_INODE open flag
  */
 
 #ifndef _LINUX_FUSE_H
@@ -252,7 +257,7 @@
 #define FUSE_KERNEL_VERSION 7
 
 /** Minor version number of this interface */
-#define FUSE_KERNEL_MINOR_VERSION 40
+#define FUSE_KERNEL_MINOR_VERSION 41
 
 /** The node ID of the root inode */
 #define FUSE_ROOT_ID 1
@@ -360,6 +365,9 @@ struct fuse_file_lock {
  * FOPEN_NOFLUSH: don't flush data cache on close (unless FUSE_WRITEBACK_CACHE)
  * FOPEN_PARALLEL_DIRECT_WRITES: Allow concurrent direct writes on the same inode
  * FOPEN_PASSTHROUGH: passthrough read/write io for this open file
+ * FOPEN_PASSTHROUGH_INODE: bind the backing file to the inode, so that later
+ *	opens are served by the kernel without OPEN/RELEASE requests and
+ *	getattr takes size, blocks and timestamps from the backing inode
  */
 #define FOPEN_DIRECT_IO		(1 << 0)
 #define FOPEN_KEEP_CACHE	(1 << 1)
@@ -369,6 +377,7 @@ struct fuse_file_lock {
 #define FOPEN_NOFLUSH		(1 << 5)
 #define FOPEN_PARALLEL_DIRECT_WRITES	(1 << 6)
 #define FOPEN_PASSTHROUGH	(1 << 7)
+#define FOPEN_PASSTHROUGH_INODE	(1 << 8)
 
 /**
  * INIT request/reply flags
@@ -421,6 +430,8 @@ struct fuse_file_lock {
  * FUSE_NO_EXPORT_SUPPORT: explicitly disable export support
  * FUSE_HAS_RESEND: kernel supports resending pending requests, and the high bit
  *		    of the request ID indicates resend requests
+ * FUSE_OVER_IO_URING: kernel supports fetching requests and sending replies
+ *		       with io_uring commands on /dev/fuse
  */
 #define FUSE_ASYNC_READ		(1 << 0)
 #define FUSE_POSIX_LOCKS	(1 << 1)
@@ -463,6 +474,7 @@ struct fuse_file_lock {
 #define FUSE_PASSTHROUGH	(1ULL << 37)
 #define FUSE_NO_EXPORT_SUPPORT	(1ULL << 38)
 #define FUSE_HAS_RESEND		(1ULL << 39)
+#define FUSE_OVER_IO_URING	(1ULL << 40)
 
 /* Obsolete alias for FUSE_DIRECT_IO_ALLOW_MMAP */
 #define FUSE_DIRECT_IO_RELAX	FUSE_DIRECT_IO_ALLOW_MMAP
@@ -1086,6 +1098,30 @@ struct fuse_backing_map {
 					     struct fuse_backing_map)
 #define FUSE_DEV_IOC_BACKING_CLOSE	_IOW(FUSE_DEV_IOC_MAGIC, 2, uint32_t)
 
+/*
+ * io_uring commands on /dev/fuse, passed in the cmd_op field of the SQE.
+ *
+ * FUSE_IO_URING_CMD_REGISTER: fetch the next request submitted on CPU @qid
+ *	into @buf; completes with the size of the request
+ * FUSE_IO_URING_CMD_COMMIT_AND_FETCH: send the reply of @commit_len bytes in
+ *	@buf, laid out like a write() to /dev/fuse, then fetch like
+ *	FUSE_IO_URING_CMD_REGISTER
+ */
+enum fuse_uring_cmd {
+	FUSE_IO_URING_CMD_INVALID		= 0,
+	FUSE_IO_URING_CMD_REGISTER		= 1,
+	FUSE_IO_URING_CMD_COMMIT_AND_FETCH	= 2,
+};
+
+/* In the cmd area of a 128 byte SQE (IORING_SETUP_SQE128) */
+struct fuse_uring_cmd_req {
+	uint64_t	buf;
+	uint32_t	buf_len;
+	uint32_t	commit_len;
+	uint16_t	qid;
+	uint16_t	padding[3];
+};
+
 struct fuse_lseek_in {
 	uint64_t	fh;
 	uint64_t	offset;
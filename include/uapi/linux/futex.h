@@ -71,6 +71,13 @@
 
 #define FUTEX2_SIZE_MASK	0x03
 
+/*
+ * A FUTEX2_NUMA futex is followed by a word of the same size holding the NUMA
+ * node whose hash table the futex lives in. FUTEX_NO_NODE there gets replaced
+ * by the node of the first task to use the futex.
+ */
+#define FUTEX_NO_NODE		(-1)
+
 /* do not use */
 #define FUTEX_32		FUTEX2_SIZE_U32 /* historical accident :-( */
 
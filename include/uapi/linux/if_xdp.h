@@ -31,6 +31,13 @@
  * such frames will be dropped.
  */
 #define XDP_USE_SG	(1 << 4)
+/* Only valid together with XDP_SHARED_UMEM when binding to another queue
+ * id and/or device. Instead of registering a fill ring of its own, the
+ * socket pulls its Rx buffers from the fill ring of the socket it shares
+ * the umem with, so that a single fill ring can feed many queues. A
+ * completion ring is still required for each queue.
+ */
+#define XDP_SHARED_FILL	(1 << 5)
 
 /* Flags for xsk_umem_config flags */
 #define XDP_UMEM_UNALIGNED_CHUNK_FLAG	(1 << 0)
@@ -200,6 +200,9 @@ enum io_uring_sqe_flags_bit {
  */
 #define IORING_SETUP_NO_SQARRAY		(1U << 16)
 
+/* Use hybrid poll in iopoll process */
+#define IORING_SETUP_HYBRID_IOPOLL	(1U << 17)
+
 enum io_uring_op {
 	IORING_OP_NOP,
 	IORING_OP_READV,
@@ -353,9 +356,12 @@ enum io_uring_op {
  *				IORING_NOTIF_USAGE_ZC_COPIED if data was copied
  *				(at least partially).
  *
- * IORING_RECVSEND_BUNDLE	Used with IOSQE_BUFFER_SELECT. If set, send or
- *				recv will grab as many buffers from the buffer
- *				group ID given and send them all. The completion
+ * IORING_RECVSEND_BUNDLE	Used with IOSQE_BUFFER_SELECT. If set, send,
+ *				sendmsg or recv will grab as many buffers from
+ *				the buffer group ID given and send them all. For
+ *				sendmsg, the name and ancillary data come from
+ *				the msghdr and the latter is only sent with the
+ *				first set of buffers. The completion
  *				result 	will be the number of buffers send, with
  *				the starting buffer ID in cqe->flags as per
  *				usual for provided buffer usage. The buffers
@@ -389,6 +395,7 @@ enum io_uring_op {
 enum io_uring_msg_ring_flags {
 	IORING_MSG_DATA,	/* pass sqe->len as 'res' and off as user_data */
 	IORING_MSG_SEND_FD,	/* send a registered fd to another ring */
+	IORING_MSG_SEND_BUF,	/* move a registered buffer to another ring */
 };
 
 /*
@@ -540,6 +547,7 @@ struct io_uring_params {
 #define IORING_FEAT_LINKED_FILE		(1U << 12)
 #define IORING_FEAT_REG_REG_RING	(1U << 13)
 #define IORING_FEAT_RECVSEND_BUNDLE	(1U << 14)
+#define IORING_FEAT_BATCH_WAIT		(1U << 15)
 
 /*
  * io_uring_register(2) opcodes and arguments
@@ -593,6 +601,15 @@ enum io_uring_register_op {
 	IORING_REGISTER_NAPI			= 27,
 	IORING_UNREGISTER_NAPI			= 28,
 
+	/* copy registered buffers from source ring to current ring */
+	IORING_REGISTER_CLONE_BUFFERS		= 29,
+
+	/* resize CQ ring */
+	IORING_REGISTER_RESIZE_RINGS		= 30,
+
+	/* set share of a shared SQPOLL thread given to this ring */
+	IORING_REGISTER_SQPOLL_WEIGHT		= 31,
+
 	/* this goes last */
 	IORING_REGISTER_LAST,
 
@@ -756,7 +773,7 @@ enum io_uring_register_restriction_op {
 struct io_uring_getevents_arg {
 	__u64	sigmask;
 	__u32	sigmask_sz;
-	__u32	pad;
+	__u32	batch_wait_usec;
 	__u64	ts;
 };
 
@@ -783,6 +800,20 @@ struct io_uring_file_index_range {
 	__u64	resv;
 };
 
+enum {
+	/* src_fd is a registered ring fd, see IORING_REGISTER_RING_FDS */
+	IORING_REGISTER_SRC_REGISTERED	= (1U << 0),
+};
+
+/*
+ * Argument for IORING_REGISTER_CLONE_BUFFERS
+ */
+struct io_uring_clone_buffers {
+	__u32	src_fd;
+	__u32	flags;
+	__u32	pad[6];
+};
+
 struct io_uring_recvmsg_out {
 	__u32 namelen;
 	__u32 controllen;
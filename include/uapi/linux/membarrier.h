@@ -162,8 +162,25 @@ enum membarrier_cmd {
 	MEMBARRIER_CMD_SHARED			= MEMBARRIER_CMD_GLOBAL,
 };
 
+/**
+ * enum membarrier_cmd_flag - membarrier system call command flags
+ * @MEMBARRIER_CMD_FLAG_CPU:
+ *                          Only target the CPU indicated by @cpu_id.
+ *                          Valid with MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ.
+ * @MEMBARRIER_CMD_FLAG_CPUMASK:
+ *                          Only target the CPUs set in the mask pointed to
+ *                          by @cpumask, an array of __u64 words of
+ *                          @cpumask_size bytes in total, CPU 0 being bit 0
+ *                          of the first word. CPUs beyond the end of the
+ *                          mask are not targeted, bits of CPUs which do not
+ *                          exist are ignored. Valid with
+ *                          MEMBARRIER_CMD_PRIVATE_EXPEDITED,
+ *                          MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE and
+ *                          MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ.
+ */
 enum membarrier_cmd_flag {
 	MEMBARRIER_CMD_FLAG_CPU		= (1 << 0),
+	MEMBARRIER_CMD_FLAG_CPUMASK	= (1 << 1),
 };
 
 #endif /* _UAPI_LINUX_MEMBARRIER_H */
@@ -111,6 +111,9 @@ enum {
 	NETDEV_A_PAGE_POOL_STATS_RECYCLE_RING,
 	NETDEV_A_PAGE_POOL_STATS_RECYCLE_RING_FULL,
 	NETDEV_A_PAGE_POOL_STATS_RECYCLE_RELEASED_REFCNT,
+	NETDEV_A_PAGE_POOL_STATS_ALLOC_NID_CHANGED,
+	NETDEV_A_PAGE_POOL_STATS_ALLOC_CROSS_NODE,
+	NETDEV_A_PAGE_POOL_STATS_RECYCLE_REMOTE_NODE,
 
 	__NETDEV_A_PAGE_POOL_STATS_MAX,
 	NETDEV_A_PAGE_POOL_STATS_MAX = (__NETDEV_A_PAGE_POOL_STATS_MAX - 1)
@@ -121,6 +124,18 @@ enum {
 	NETDEV_A_NAPI_ID,
 	NETDEV_A_NAPI_IRQ,
 	NETDEV_A_NAPI_PID,
+	NETDEV_A_NAPI_DEFER_HARD_IRQS,
+	NETDEV_A_NAPI_GRO_FLUSH_TIMEOUT,
+	NETDEV_A_NAPI_IRQ_SUSPEND_TIMEOUT,
+	NETDEV_A_NAPI_GRO_HASH_BUCKETS,
+	NETDEV_A_NAPI_GRO_PACKETS,
+	NETDEV_A_NAPI_GRO_MERGED,
+	NETDEV_A_NAPI_GRO_EVICTED,
+	NETDEV_A_NAPI_THREADED_BUSY_POLL_USECS,
+	NETDEV_A_NAPI_THREADED_BUSY_POLL_BUDGET,
+	NETDEV_A_NAPI_THREAD_POLL_TIME,
+	NETDEV_A_NAPI_THREAD_IDLE_TIME,
+	NETDEV_A_NAPI_THREAD_SLEEPS,
 
 	__NETDEV_A_NAPI_MAX,
 	NETDEV_A_NAPI_MAX = (__NETDEV_A_NAPI_MAX - 1)
@@ -173,6 +188,16 @@ enum {
 	NETDEV_A_QSTATS_MAX = (__NETDEV_A_QSTATS_MAX - 1)
 };
 
+enum {
+	NETDEV_A_DMABUF_IFINDEX = 1,
+	NETDEV_A_DMABUF_QUEUES,
+	NETDEV_A_DMABUF_FD,
+	NETDEV_A_DMABUF_ID,
+
+	__NETDEV_A_DMABUF_MAX,
+	NETDEV_A_DMABUF_MAX = (__NETDEV_A_DMABUF_MAX - 1)
+};
+
 enum {
 	NETDEV_CMD_DEV_GET = 1,
 	NETDEV_CMD_DEV_ADD_NTF,
@@ -186,6 +211,8 @@ enum {
 	NETDEV_CMD_QUEUE_GET,
 	NETDEV_CMD_NAPI_GET,
 	NETDEV_CMD_QSTATS_GET,
+	NETDEV_CMD_NAPI_SET,
+	NETDEV_CMD_BIND_RX,
 
 	__NETDEV_CMD_MAX,
 	NETDEV_CMD_MAX = (__NETDEV_CMD_MAX - 1)
@@ -267,6 +267,12 @@ enum ctattr_stats_global {
 	CTA_STATS_GLOBAL_UNSPEC,
 	CTA_STATS_GLOBAL_ENTRIES,
 	CTA_STATS_GLOBAL_MAX_ENTRIES,
+	CTA_STATS_GLOBAL_PAD,
+	CTA_STATS_GLOBAL_GC_SHARDS,
+	CTA_STATS_GLOBAL_GC_PASSES,
+	CTA_STATS_GLOBAL_GC_SCANNED,
+	CTA_STATS_GLOBAL_GC_EXPIRED,
+	CTA_STATS_GLOBAL_GC_TIME,
 	__CTA_STATS_GLOBAL_MAX,
 };
 #define CTA_STATS_GLOBAL_MAX (__CTA_STATS_GLOBAL_MAX - 1)
@@ -460,7 +460,8 @@ struct perf_event_attr {
 				inherit_thread :  1, /* children only inherit if cloned with CLONE_THREAD */
 				remove_on_exec :  1, /* event is removed from task on exec */
 				sigtrap        :  1, /* send synchronous SIGTRAP on event */
-				__reserved_1   : 26;
+				aggr_addr      :  1, /* aggregate sampled data addresses per cacheline */
+				__reserved_1   : 25;
 
 	union {
 		__u32		wakeup_events;	  /* wakeup every n events */
@@ -545,6 +546,44 @@ struct perf_event_query_bpf {
 	__u32	ids[];
 };
 
+/*
+ * Per-cacheline counters of an event created with attr.aggr_addr, as
+ * returned by PERF_EVENT_IOC_READ_ADDR_AGGR. @addr is the address of the
+ * cacheline, @hitm counts samples whose data source reports a snoop hit
+ * on a modified line in another cache, @stores counts store samples.
+ */
+struct perf_addr_aggr_entry {
+	__u64	addr;
+	__u64	samples;
+	__u64	hitm;
+	__u64	stores;
+};
+
+/*
+ * Structure used by below PERF_EVENT_IOC_READ_ADDR_AGGR command.
+ */
+struct perf_addr_aggr_read {
+	/*
+	 * User provided array of struct perf_addr_aggr_entry
+	 */
+	__u64	entries;
+	/*
+	 * In: length of the entries array. Out: number of entries filled
+	 */
+	__u32	nr;
+	/*
+	 * PERF_ADDR_AGGR_RESET: zero the counters after reading them
+	 */
+	__u32	flags;
+	/*
+	 * Set by the kernel to the number of samples that found the
+	 * table full
+	 */
+	__u64	dropped;
+};
+
+#define PERF_ADDR_AGGR_RESET			(1U << 0)
+
 /*
  * Ioctls that can be done on a perf event fd:
  */
@@ -560,6 +599,7 @@ struct perf_event_query_bpf {
 #define PERF_EVENT_IOC_PAUSE_OUTPUT		_IOW('$', 9, __u32)
 #define PERF_EVENT_IOC_QUERY_BPF		_IOWR('$', 10, struct perf_event_query_bpf *)
 #define PERF_EVENT_IOC_MODIFY_ATTRIBUTES	_IOW('$', 11, struct perf_event_attr *)
+#define PERF_EVENT_IOC_READ_ADDR_AGGR		_IOWR('$', 12, struct perf_addr_aggr_read)
 
 enum perf_event_ioc_flags {
 	PERF_IOC_FLAG_GROUP		= 1U << 0,
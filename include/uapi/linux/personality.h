@@ -9,6 +9,7 @@
  * These occupy the top three bytes.
  */
 enum {
+	HUGE_TEXT =		0x0010000,	/* map ELF text with huge pages, prefaulted */
 	UNAME26	=               0x0020000,
 	ADDR_NO_RANDOMIZE = 	0x0040000,	/* disable randomization of VA space */
 	FDPIC_FUNCPTRS =	0x0080000,	/* userspace function ptrs point to descriptors
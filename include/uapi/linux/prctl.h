@@ -328,4 +328,13 @@ struct prctl_mm_map {
 # define PR_PPC_DEXCR_CTRL_CLEAR_ONEXEC	0x10 /* Clear the aspect on exec */
 # define PR_PPC_DEXCR_CTRL_MASK		0x1f
 
+/* Scan this process early and with its own budget in khugepaged */
+#define PR_SET_THP_COLLAPSE_PRIO	74
+#define PR_GET_THP_COLLAPSE_PRIO	75
+
+/* Give the private futexes of this process their own hash table */
+#define PR_FUTEX_HASH			76
+# define PR_FUTEX_HASH_SET_SLOTS	1
+# define PR_FUTEX_HASH_GET_SLOTS	2
+
 #endif /* _LINUX_PRCTL_H */
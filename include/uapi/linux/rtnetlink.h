@@ -497,6 +497,8 @@ enum {
 #define RTAX_CC_ALGO RTAX_CC_ALGO
 	RTAX_FASTOPEN_NO_COOKIE,
 #define RTAX_FASTOPEN_NO_COOKIE RTAX_FASTOPEN_NO_COOKIE
+	RTAX_ACK_THIN,
+#define RTAX_ACK_THIN RTAX_ACK_THIN
 	__RTAX_MAX
 };
 
@@ -302,6 +302,10 @@ enum
 	LINUX_MIB_TCPAOKEYNOTFOUND,		/* TCPAOKeyNotFound */
 	LINUX_MIB_TCPAOGOOD,			/* TCPAOGood */
 	LINUX_MIB_TCPAODROPPEDICMPS,		/* TCPAODroppedIcmps */
+	LINUX_MIB_TCPTXPLUG,			/* TCPTxPlug */
+	LINUX_MIB_CONNECTPORTSEARCH,		/* ConnectPortSearch */
+	LINUX_MIB_CONNECTPORTPROBES,		/* ConnectPortProbes */
+	LINUX_MIB_CONNECTPORTCACHEHIT,		/* ConnectPortCacheHit */
 	__LINUX_MIB_MAX
 };
 
@@ -136,6 +136,8 @@ enum {
 #define TCP_AO_REPAIR		42	/* Get/Set SNEs and ISNs */
 
 #define TCP_IS_MPTCP		43	/* Is MPTCP being used? */
+#define TCP_ACK_THIN		44	/* ACK at most every XX bytes of bulk data */
+#define TCP_TX_PLUG		45	/* Hold sendmsg data up to XX usec to batch */
 
 #define TCP_REPAIR_ON		1
 #define TCP_REPAIR_OFF		0
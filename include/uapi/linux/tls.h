@@ -194,6 +194,8 @@ enum {
 	TLS_INFO_RXCONF,
 	TLS_INFO_ZC_RO_TX,
 	TLS_INFO_RX_NO_PAD,
+	TLS_INFO_RX_ASYNC_RECORDS,	/* records decrypted asynchronously */
+	TLS_INFO_RX_ASYNC_INFLIGHT_MAX,	/* most such records at once */
 	__TLS_INFO_MAX,
 };
 #define TLS_INFO_MAX (__TLS_INFO_MAX - 1)
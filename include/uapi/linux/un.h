@@ -13,4 +13,7 @@ struct sockaddr_un {
 
 #define SIOCUNIXFILE (SIOCPROTOPRIVATE + 0) /* open a socket file with O_PATH */
 
+/* SOL_UNIX cmsg type of MSG_ZEROCOPY completions on MSG_ERRQUEUE */
+#define UNIX_RECVERR	1
+
 #endif /* _LINUX_UN_H */
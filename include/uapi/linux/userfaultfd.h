@@ -54,13 +54,17 @@
 	 (__u64)1 << _UFFDIO_MOVE |		\
 	 (__u64)1 << _UFFDIO_WRITEPROTECT |	\
 	 (__u64)1 << _UFFDIO_CONTINUE |		\
-	 (__u64)1 << _UFFDIO_POISON)
+	 (__u64)1 << _UFFDIO_POISON |		\
+	 (__u64)1 << _UFFDIO_COPY_VEC |		\
+	 (__u64)1 << _UFFDIO_CONTINUE_VEC)
 #define UFFD_API_RANGE_IOCTLS_BASIC		\
 	((__u64)1 << _UFFDIO_WAKE |		\
 	 (__u64)1 << _UFFDIO_COPY |		\
 	 (__u64)1 << _UFFDIO_WRITEPROTECT |	\
 	 (__u64)1 << _UFFDIO_CONTINUE |		\
-	 (__u64)1 << _UFFDIO_POISON)
+	 (__u64)1 << _UFFDIO_POISON |		\
+	 (__u64)1 << _UFFDIO_COPY_VEC |		\
+	 (__u64)1 << _UFFDIO_CONTINUE_VEC)
 
 /*
  * Valid ioctl command number range with this API is from 0x00 to
@@ -79,6 +83,8 @@
 #define _UFFDIO_WRITEPROTECT		(0x06)
 #define _UFFDIO_CONTINUE		(0x07)
 #define _UFFDIO_POISON			(0x08)
+#define _UFFDIO_COPY_VEC		(0x09)
+#define _UFFDIO_CONTINUE_VEC		(0x0A)
 #define _UFFDIO_API			(0x3F)
 
 /* userfaultfd ioctl ids */
@@ -103,6 +109,10 @@
 				      struct uffdio_continue)
 #define UFFDIO_POISON		_IOWR(UFFDIO, _UFFDIO_POISON, \
 				      struct uffdio_poison)
+#define UFFDIO_COPY_VEC		_IOWR(UFFDIO, _UFFDIO_COPY_VEC, \
+				      struct uffdio_vec)
+#define UFFDIO_CONTINUE_VEC	_IOWR(UFFDIO, _UFFDIO_CONTINUE_VEC, \
+				      struct uffdio_vec)
 
 /* read() structure */
 struct uffd_msg {
@@ -374,6 +384,35 @@ struct uffdio_move {
 	__s64 move;
 };
 
+struct uffdio_iovec {
+	__u64 dst;
+	/* ignored by UFFDIO_CONTINUE_VEC */
+	__u64 src;
+	__u64 len;
+};
+
+/*
+ * UFFDIO_COPY_VEC and UFFDIO_CONTINUE_VEC resolve up to UFFDIO_VEC_MAX
+ * ranges with one call, in the order given.  "mode" takes the
+ * UFFDIO_COPY_MODE_* or UFFDIO_CONTINUE_MODE_* flags respectively and
+ * applies to all ranges.
+ */
+#define UFFDIO_VEC_MAX				1024
+
+struct uffdio_vec {
+	/* userland pointer to an array of struct uffdio_iovec */
+	__u64 iov;
+	__u64 nr;
+	__u64 mode;
+
+	/*
+	 * "done" is written by the ioctl and must be at the end: the
+	 * copy_from_user will not read the last 8 bytes. It counts the
+	 * bytes filled in the leading ranges, or holds a negative error.
+	 */
+	__s64 done;
+};
+
 /*
  * Flags for the userfaultfd(2) system call itself.
  */
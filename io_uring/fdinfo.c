@@ -14,6 +14,7 @@
 #include "fdinfo.h"
 #include "cancel.h"
 #include "rsrc.h"
+#include "tctx.h"
 
 #ifdef CONFIG_PROC_FS
 static __cold int io_uring_show_cred(struct seq_file *m, unsigned int id,
@@ -66,6 +67,8 @@ __cold void io_uring_show_fdinfo(struct seq_file *m, struct file *file)
 	unsigned int sq_entries, cq_entries;
 	int sq_pid = -1, sq_cpu = -1;
 	u64 sq_total_time = 0, sq_work_time = 0;
+	u64 sq_ring_time = 0, sq_ring_entries = 0;
+	unsigned int sq_weight = 0;
 	bool has_lock;
 	unsigned int i;
 
@@ -159,12 +162,19 @@ __cold void io_uring_show_fdinfo(struct seq_file *m, struct file *file)
 					 + sq_usage.ru_stime.tv_usec);
 			sq_work_time = sq->work_time;
 		}
+		sq_ring_time = div_u64(READ_ONCE(ctx->sq_work_time),
+				       NSEC_PER_USEC);
+		sq_ring_entries = READ_ONCE(ctx->sq_submitted);
+		sq_weight = READ_ONCE(ctx->sq_weight);
 	}
 
 	seq_printf(m, "SqThread:\t%d\n", sq_pid);
 	seq_printf(m, "SqThreadCpu:\t%d\n", sq_cpu);
 	seq_printf(m, "SqTotalTime:\t%llu\n", sq_total_time);
 	seq_printf(m, "SqWorkTime:\t%llu\n", sq_work_time);
+	seq_printf(m, "SqRingTime:\t%llu\n", sq_ring_time);
+	seq_printf(m, "SqRingEntries:\t%llu\n", sq_ring_entries);
+	seq_printf(m, "SqWeight:\t%u\n", sq_weight);
 	seq_printf(m, "UserFiles:\t%u\n", ctx->nr_user_files);
 	for (i = 0; has_lock && i < ctx->nr_user_files; i++) {
 		struct file *f = io_file_from_index(&ctx->file_table, i);
@@ -181,6 +191,19 @@ __cold void io_uring_show_fdinfo(struct seq_file *m, struct file *file)
 
 		seq_printf(m, "%5u: 0x%llx/%u\n", i, buf->ubuf, len);
 	}
+	if (has_lock) {
+		struct io_tctx_node *node;
+
+		/* A node is removed before its task's io-wq goes away */
+		list_for_each_entry(node, &ctx->tctx_list, ctx_node) {
+			struct io_wq *wq = node->task->io_uring->io_wq;
+
+			if (!wq)
+				continue;
+			seq_printf(m, "IoWq:\tpid=%d\n", task_pid_nr(node->task));
+			io_wq_show_fdinfo(wq, m);
+		}
+	}
 	if (has_lock && !xa_empty(&ctx->personalities)) {
 		unsigned long index;
 		const struct cred *cred;
@@ -16,6 +16,7 @@
 #include <linux/task_work.h>
 #include <linux/audit.h>
 #include <linux/mmu_context.h>
+#include <linux/seq_file.h>
 #include <uapi/linux/io_uring.h>
 
 #include "io-wq.h"
@@ -76,6 +77,9 @@ struct io_worker {
 struct io_wq_acct {
 	unsigned nr_workers;
 	unsigned max_workers;
+	/* workers started, and failed to start, protected by wq->lock */
+	unsigned long nr_created;
+	unsigned long nr_create_failed;
 	int index;
 	atomic_t nr_running;
 	raw_spinlock_t lock;
@@ -735,6 +739,7 @@ static void io_init_new_worker(struct io_wq *wq, struct io_worker *worker,
 	hlist_nulls_add_head_rcu(&worker->nulls_node, &wq->free_list);
 	list_add_tail_rcu(&worker->all_list, &wq->all_list);
 	set_bit(IO_WORKER_F_FREE, &worker->flags);
+	io_wq_get_acct(worker)->nr_created++;
 	raw_spin_unlock(&wq->lock);
 	wake_up_new_task(tsk);
 }
@@ -784,6 +789,7 @@ static void create_worker_cont(struct callback_head *cb)
 		atomic_dec(&acct->nr_running);
 		raw_spin_lock(&wq->lock);
 		acct->nr_workers--;
+		acct->nr_create_failed++;
 		if (!acct->nr_workers) {
 			struct io_cb_cancel_data match = {
 				.fn		= io_wq_work_match_all,
@@ -829,6 +835,7 @@ static bool create_io_worker(struct io_wq *wq, int index)
 		atomic_dec(&acct->nr_running);
 		raw_spin_lock(&wq->lock);
 		acct->nr_workers--;
+		acct->nr_create_failed++;
 		raw_spin_unlock(&wq->lock);
 		io_worker_ref_put(wq);
 		return false;
@@ -985,6 +992,54 @@ void io_wq_hash_work(struct io_wq_work *work, void *val)
 	work->flags |= (IO_WQ_WORK_HASHED | (bit << IO_WQ_HASH_SHIFT));
 }
 
+/*
+ * Like io_wq_hash_work(), but only serialize against work for the same
+ * @range of @val, for files that can take writes to separate ranges in
+ * parallel.
+ */
+void io_wq_hash_range_work(struct io_wq_work *work, void *val,
+			   unsigned long range)
+{
+	unsigned int bit;
+
+	bit = hash_long((unsigned long)val ^ hash_long(range, BITS_PER_LONG),
+			IO_WQ_HASH_ORDER);
+	work->flags |= (IO_WQ_WORK_HASHED | (bit << IO_WQ_HASH_SHIFT));
+}
+
+void io_wq_show_fdinfo(struct io_wq *wq, struct seq_file *m)
+{
+	static const char * const names[IO_WQ_ACCT_NR] = {
+		[IO_WQ_ACCT_BOUND]	= "Bound",
+		[IO_WQ_ACCT_UNBOUND]	= "Unbound",
+	};
+	int i;
+
+	for (i = 0; i < IO_WQ_ACCT_NR; i++) {
+		struct io_wq_acct *acct = &wq->acct[i];
+		unsigned int workers, max_workers, queued = 0;
+		unsigned long created, failed;
+		struct io_wq_work_node *node;
+
+		raw_spin_lock(&wq->lock);
+		workers = acct->nr_workers;
+		max_workers = acct->max_workers;
+		created = acct->nr_created;
+		failed = acct->nr_create_failed;
+		raw_spin_unlock(&wq->lock);
+
+		raw_spin_lock(&acct->lock);
+		__wq_list_for_each(node, &acct->work_list)
+			queued++;
+		raw_spin_unlock(&acct->lock);
+
+		seq_printf(m, "  %s:\tworkers=%u max=%u running=%d queued=%u created=%lu failed=%lu\n",
+			   names[i], workers, max_workers,
+			   atomic_read(&acct->nr_running), queued, created,
+			   failed);
+	}
+}
+
 static bool __io_wq_worker_cancel(struct io_worker *worker,
 				  struct io_cb_cancel_data *match,
 				  struct io_wq_work *work)
@@ -49,6 +49,9 @@ void io_wq_put_and_exit(struct io_wq *wq);
 
 void io_wq_enqueue(struct io_wq *wq, struct io_wq_work *work);
 void io_wq_hash_work(struct io_wq_work *work, void *val);
+void io_wq_hash_range_work(struct io_wq_work *work, void *val,
+			   unsigned long range);
+void io_wq_show_fdinfo(struct io_wq *wq, struct seq_file *m);
 
 int io_wq_cpu_affinity(struct io_uring_task *tctx, cpumask_var_t mask);
 int io_wq_max_workers(struct io_wq *wq, int *new_count);
@@ -20,7 +20,10 @@
 
 struct io_msg {
 	struct file			*file;
-	struct file			*src_file;
+	union {
+		struct file		*src_file;
+		struct io_mapped_ubuf	*src_buf;
+	};
 	struct callback_head		tw;
 	u64 user_data;
 	u32 len;
@@ -59,6 +62,14 @@ void io_msg_ring_cleanup(struct io_kiocb *req)
 {
 	struct io_msg *msg = io_kiocb_to_cmd(req, struct io_msg);
 
+	if (msg->cmd == IORING_MSG_SEND_BUF) {
+		if (WARN_ON_ONCE(!msg->src_buf))
+			return;
+		io_rsrc_buf_release(req->ctx, msg->src_buf);
+		msg->src_buf = NULL;
+		return;
+	}
+
 	if (WARN_ON_ONCE(!msg->src_file))
 		return;
 
@@ -244,6 +255,90 @@ static int io_msg_send_fd(struct io_kiocb *req, unsigned int issue_flags)
 	return io_msg_install_complete(req, issue_flags);
 }
 
+static int io_msg_buf_complete(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_ring_ctx *target_ctx = req->file->private_data;
+	struct io_msg *msg = io_kiocb_to_cmd(req, struct io_msg);
+	struct io_mapped_ubuf *imu = msg->src_buf;
+	struct io_ring_ctx *ctx = req->ctx;
+	int ret;
+
+	if (unlikely(io_double_lock_ctx(target_ctx, issue_flags)))
+		return -EAGAIN;
+
+	ret = io_rsrc_buf_install(target_ctx, imu, msg->dst_fd);
+	if (ret < 0) {
+		io_double_unlock_ctx(target_ctx);
+		return ret;
+	}
+
+	msg->src_buf = NULL;
+	req->flags &= ~REQ_F_NEED_CLEANUP;
+
+	/* As with SEND_FD, an overflow still leaves the buffer transferred */
+	if (!(msg->flags & IORING_MSG_RING_CQE_SKIP) &&
+	    !io_post_aux_cqe(target_ctx, msg->user_data, ret, 0))
+		ret = -EOVERFLOW;
+	io_double_unlock_ctx(target_ctx);
+
+	/*
+	 * The target owns the buffer now, take it out of our own table. The
+	 * two ring locks are never held together here, see
+	 * io_double_lock_ctx().
+	 */
+	io_ring_submit_lock(ctx, issue_flags);
+	io_rsrc_buf_detach(ctx, msg->src_fd, imu);
+	io_ring_submit_unlock(ctx, issue_flags);
+	return ret;
+}
+
+static void io_msg_tw_buf_complete(struct callback_head *head)
+{
+	struct io_msg *msg = container_of(head, struct io_msg, tw);
+	struct io_kiocb *req = cmd_to_io_kiocb(msg);
+	int ret = -EOWNERDEAD;
+
+	if (!(current->flags & PF_EXITING))
+		ret = io_msg_buf_complete(req, IO_URING_F_UNLOCKED);
+	if (ret < 0)
+		req_set_fail(req);
+	io_req_queue_tw_complete(req, ret);
+}
+
+/*
+ * Move the registered buffer at index sqe->addr3 of this ring into slot
+ * sqe->file_index of the target ring, without copying or re-pinning it.
+ */
+static int io_msg_send_buf(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_ring_ctx *target_ctx = req->file->private_data;
+	struct io_msg *msg = io_kiocb_to_cmd(req, struct io_msg);
+	struct io_ring_ctx *ctx = req->ctx;
+
+	if (msg->len || msg->flags & IORING_MSG_RING_FLAGS_PASS)
+		return -EINVAL;
+	if (target_ctx == ctx)
+		return -EINVAL;
+	if (target_ctx->flags & IORING_SETUP_R_DISABLED)
+		return -EBADFD;
+	/* the pages stay accounted to the ring that registered them */
+	if (target_ctx->user != ctx->user ||
+	    target_ctx->mm_account != ctx->mm_account)
+		return -EPERM;
+	if (!msg->src_buf) {
+		io_ring_submit_lock(ctx, issue_flags);
+		msg->src_buf = io_rsrc_buf_grab(ctx, msg->src_fd);
+		io_ring_submit_unlock(ctx, issue_flags);
+		if (!msg->src_buf)
+			return -EFAULT;
+		req->flags |= REQ_F_NEED_CLEANUP;
+	}
+
+	if (io_msg_need_remote(target_ctx))
+		return io_msg_exec_remote(req, io_msg_tw_buf_complete);
+	return io_msg_buf_complete(req, issue_flags);
+}
+
 int io_msg_ring_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
 	struct io_msg *msg = io_kiocb_to_cmd(req, struct io_msg);
@@ -280,6 +375,9 @@ int io_msg_ring(struct io_kiocb *req, unsigned int issue_flags)
 	case IORING_MSG_SEND_FD:
 		ret = io_msg_send_fd(req, issue_flags);
 		break;
+	case IORING_MSG_SEND_BUF:
+		ret = io_msg_send_buf(req, issue_flags);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
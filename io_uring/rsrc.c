@@ -17,6 +17,7 @@
 #include "openclose.h"
 #include "rsrc.h"
 #include "memmap.h"
+#include "register.h"
 
 struct io_rsrc_update {
 	struct file			*file;
@@ -139,7 +140,7 @@ static void io_buffer_unmap(struct io_ring_ctx *ctx, struct io_mapped_ubuf **slo
 	struct io_mapped_ubuf *imu = *slot;
 	unsigned int i;
 
-	if (imu != &dummy_ubuf) {
+	if (imu != &dummy_ubuf && refcount_dec_and_test(&imu->refs)) {
 		for (i = 0; i < imu->nr_bvecs; i++)
 			unpin_user_page(imu->bvec[i].bv_page);
 		if (imu->acct_pages)
@@ -938,6 +939,7 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 	imu->ubuf = (unsigned long) iov->iov_base;
 	imu->ubuf_end = imu->ubuf + iov->iov_len;
 	imu->nr_bvecs = nr_pages;
+	refcount_set(&imu->refs, 1);
 	*pimu = imu;
 	ret = 0;
 
@@ -1020,6 +1022,200 @@ int io_sqe_buffers_register(struct io_ring_ctx *ctx, void __user *arg,
 	return ret;
 }
 
+static int io_clone_buffers(struct io_ring_ctx *ctx, struct io_ring_ctx *src_ctx)
+{
+	struct io_mapped_ubuf **user_bufs;
+	struct io_rsrc_data *data;
+	int i, ret, nbufs;
+
+	/*
+	 * Drop our own lock here. We'll setup the data we need and reference
+	 * the source buffers, then re-grab, check, and assign at the end.
+	 */
+	mutex_unlock(&ctx->uring_lock);
+
+	mutex_lock(&src_ctx->uring_lock);
+	ret = -ENXIO;
+	nbufs = src_ctx->nr_user_bufs;
+	if (!nbufs)
+		goto out_unlock;
+	ret = io_rsrc_data_alloc(ctx, IORING_RSRC_BUFFER, NULL, nbufs, &data);
+	if (ret)
+		goto out_unlock;
+
+	ret = -ENOMEM;
+	user_bufs = kcalloc(nbufs, sizeof(*ctx->user_bufs), GFP_KERNEL);
+	if (!user_bufs)
+		goto out_free_data;
+
+	for (i = 0; i < nbufs; i++) {
+		struct io_mapped_ubuf *src = src_ctx->user_bufs[i];
+
+		if (src != &dummy_ubuf)
+			refcount_inc(&src->refs);
+		user_bufs[i] = src;
+	}
+
+	/* Have a ref on the bufs now, drop src lock and re-grab our own lock */
+	mutex_unlock(&src_ctx->uring_lock);
+	mutex_lock(&ctx->uring_lock);
+	if (!ctx->user_bufs) {
+		ctx->user_bufs = user_bufs;
+		ctx->buf_data = data;
+		ctx->nr_user_bufs = nbufs;
+		return 0;
+	}
+
+	/* someone raced setting up buffers, dump ours */
+	for (i = 0; i < nbufs; i++)
+		io_buffer_unmap(ctx, &user_bufs[i]);
+	io_rsrc_data_free(data);
+	kfree(user_bufs);
+	return -EBUSY;
+out_free_data:
+	io_rsrc_data_free(data);
+out_unlock:
+	mutex_unlock(&src_ctx->uring_lock);
+	mutex_lock(&ctx->uring_lock);
+	return ret;
+}
+
+/*
+ * Look up the registered buffer at @idx and take a reference to it, for
+ * handing it over to another ring. Returns NULL for an empty slot.
+ */
+struct io_mapped_ubuf *io_rsrc_buf_grab(struct io_ring_ctx *ctx,
+					unsigned int idx)
+{
+	struct io_mapped_ubuf *imu;
+
+	lockdep_assert_held(&ctx->uring_lock);
+
+	if (unlikely(idx >= ctx->nr_user_bufs))
+		return NULL;
+	imu = ctx->user_bufs[array_index_nospec(idx, ctx->nr_user_bufs)];
+	if (imu == &dummy_ubuf)
+		return NULL;
+	refcount_inc(&imu->refs);
+	return imu;
+}
+
+void io_rsrc_buf_release(struct io_ring_ctx *ctx, struct io_mapped_ubuf *imu)
+{
+	io_buffer_unmap(ctx, &imu);
+}
+
+/*
+ * Install @imu, and the reference to it, into an empty buffer slot of @ctx.
+ * @slot is 1-based, or IORING_FILE_INDEX_ALLOC to pick the first free slot,
+ * in which case the index of that slot is returned.
+ */
+int io_rsrc_buf_install(struct io_ring_ctx *ctx, struct io_mapped_ubuf *imu,
+			unsigned int slot)
+{
+	bool alloc_slot = slot == IORING_FILE_INDEX_ALLOC;
+	unsigned int i;
+
+	lockdep_assert_held(&ctx->uring_lock);
+
+	if (!ctx->buf_data)
+		return -ENXIO;
+	if (alloc_slot) {
+		for (i = 0; i < ctx->nr_user_bufs; i++)
+			if (ctx->user_bufs[i] == &dummy_ubuf)
+				break;
+		if (i == ctx->nr_user_bufs)
+			return -ENFILE;
+	} else {
+		if (!slot || slot > ctx->nr_user_bufs)
+			return -EINVAL;
+		i = array_index_nospec(slot - 1, ctx->nr_user_bufs);
+		if (ctx->user_bufs[i] != &dummy_ubuf)
+			return -EBUSY;
+	}
+
+	ctx->user_bufs[i] = imu;
+	*io_get_tag_slot(ctx->buf_data, i) = 0;
+	return alloc_slot ? i : 0;
+}
+
+/*
+ * Drop the buffer at @idx from the table once it has been handed over to
+ * another ring, unless it was replaced in the meantime. Requests still
+ * using it hold off the put through the rsrc node, as for an update. If
+ * that node can't be allocated, the buffer stays registered here too.
+ */
+void io_rsrc_buf_detach(struct io_ring_ctx *ctx, unsigned int idx,
+			struct io_mapped_ubuf *imu)
+{
+	lockdep_assert_held(&ctx->uring_lock);
+
+	if (unlikely(idx >= ctx->nr_user_bufs))
+		return;
+	idx = array_index_nospec(idx, ctx->nr_user_bufs);
+	if (ctx->user_bufs[idx] != imu)
+		return;
+	if (io_queue_rsrc_removal(ctx->buf_data, idx, imu))
+		return;
+	ctx->user_bufs[idx] = (struct io_mapped_ubuf *)&dummy_ubuf;
+}
+
+/*
+ * Copy the registered buffers from the source ring whose file descriptor
+ * is given in the src_fd to the current ring. This is identical to registering
+ * the buffers with ctx, except faster as mappings already exist.
+ *
+ * Since the memory is already accounted once, don't account it again.
+ * The buffers are shared by reference and unpinned, and unaccounted, by
+ * whichever ring drops the last reference, so both rings must be charged
+ * to the same user and mm.
+ */
+int io_register_clone_buffers(struct io_ring_ctx *ctx, void __user *arg)
+{
+	struct io_uring_clone_buffers buf;
+	struct io_ring_ctx *src_ctx;
+	bool registered_src;
+	struct file *file;
+	int ret;
+
+	if (ctx->user_bufs || ctx->nr_user_bufs)
+		return -EBUSY;
+	if (copy_from_user(&buf, arg, sizeof(buf)))
+		return -EFAULT;
+	if (buf.flags & ~IORING_REGISTER_SRC_REGISTERED)
+		return -EINVAL;
+	if (memchr_inv(buf.pad, 0, sizeof(buf.pad)))
+		return -EINVAL;
+
+	registered_src = (buf.flags & IORING_REGISTER_SRC_REGISTERED) != 0;
+	file = io_uring_register_get_file(buf.src_fd, registered_src);
+	if (IS_ERR(file))
+		return PTR_ERR(file);
+
+	src_ctx = file->private_data;
+	if (src_ctx == ctx)
+		ret = -EINVAL;
+	else if (src_ctx->user != ctx->user ||
+		 src_ctx->mm_account != ctx->mm_account)
+		ret = -EPERM;
+	else
+		ret = io_clone_buffers(ctx, src_ctx);
+
+	if (!registered_src)
+		fput(file);
+	return ret;
+}
+
+static unsigned long io_fixed_nr_segs(const struct bio_vec *bvec,
+				      size_t offset, size_t len)
+{
+	size_t first = bvec->bv_len - offset;
+
+	if (len <= first)
+		return 1;
+	return 1 + DIV_ROUND_UP(len - first, PAGE_SIZE);
+}
+
 int io_import_fixed(int ddir, struct iov_iter *iter,
 			   struct io_mapped_ubuf *imu,
 			   u64 buf_addr, size_t len)
@@ -1084,5 +1280,14 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 		}
 	}
 
+	/*
+	 * Trim the segment count to the bvecs the request actually spans
+	 * rather than the rest of the registered buffer, so a bio built from
+	 * this iterator references exactly those entries and nothing walks
+	 * past the end of the I/O. Same assumptions as above: everything but
+	 * the first and last bvec is PAGE_SIZE.
+	 */
+	iter->nr_segs = min(iter->nr_segs,
+			    io_fixed_nr_segs(iter->bvec, iter->iov_offset, len));
 	return 0;
 }
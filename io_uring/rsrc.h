@@ -47,6 +47,7 @@ struct io_mapped_ubuf {
 	u64		ubuf_end;
 	unsigned int	nr_bvecs;
 	unsigned long	acct_pages;
+	refcount_t	refs;
 	struct bio_vec	bvec[] __counted_by(nr_bvecs);
 };
 
@@ -61,6 +62,14 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 
 void __io_sqe_buffers_unregister(struct io_ring_ctx *ctx);
 int io_sqe_buffers_unregister(struct io_ring_ctx *ctx);
+int io_register_clone_buffers(struct io_ring_ctx *ctx, void __user *arg);
+struct io_mapped_ubuf *io_rsrc_buf_grab(struct io_ring_ctx *ctx,
+					unsigned int idx);
+void io_rsrc_buf_release(struct io_ring_ctx *ctx, struct io_mapped_ubuf *imu);
+int io_rsrc_buf_install(struct io_ring_ctx *ctx, struct io_mapped_ubuf *imu,
+			unsigned int slot);
+void io_rsrc_buf_detach(struct io_ring_ctx *ctx, unsigned int idx,
+			struct io_mapped_ubuf *imu);
 int io_sqe_buffers_register(struct io_ring_ctx *ctx, void __user *arg,
 			    unsigned int nr_args, u64 __user *tags);
 void __io_sqe_files_unregister(struct io_ring_ctx *ctx);
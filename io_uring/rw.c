@@ -23,6 +23,12 @@
 #include "poll.h"
 #include "rw.h"
 
+/*
+ * Max number of extra ->iopoll() calls made in one io_do_iopoll() pass once
+ * completions have been found, when polling more than one queue.
+ */
+#define IO_IOPOLL_BATCH_POLLS	8
+
 struct io_rw {
 	/* NOTE: kiocb has the file as the first member, so don't do it here */
 	struct kiocb			kiocb;
@@ -281,6 +287,35 @@ int io_prep_read(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 	return io_prep_rw(req, sqe, ITER_DEST, true);
 }
 
+/*
+ * Writes to the same #IO_RW_HASH_RANGE_SHIFT sized range of a file are
+ * serialized in io-wq, see io_prep_async_work().  Returns false if the
+ * range isn't known before the write is issued.
+ */
+#define IO_RW_HASH_RANGE_SHIFT	22
+
+bool io_rw_hash_range(struct io_kiocb *req, unsigned long *range)
+{
+	struct io_rw *rw = io_kiocb_to_cmd(req, struct io_rw);
+
+	switch (req->opcode) {
+	case IORING_OP_WRITE:
+	case IORING_OP_WRITEV:
+	case IORING_OP_WRITE_FIXED:
+		break;
+	default:
+		return false;
+	}
+
+	/* Writes at the file position or appends could go anywhere */
+	if (rw->kiocb.ki_pos == -1 || (rw->flags & RWF_APPEND) ||
+	    (req->file->f_flags & O_APPEND))
+		return false;
+
+	*range = rw->kiocb.ki_pos >> IO_RW_HASH_RANGE_SHIFT;
+	return true;
+}
+
 int io_prep_write(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
 	return io_prep_rw(req, sqe, ITER_SOURCE, true);
@@ -1106,11 +1141,93 @@ void io_rw_fail(struct io_kiocb *req)
 	io_req_set_res(req, res, req->cqe.flags);
 }
 
+static int io_uring_classic_poll(struct io_kiocb *req, struct io_comp_batch *iob,
+				 unsigned int poll_flags)
+{
+	struct file *file = req->file;
+
+	if (req->opcode == IORING_OP_URING_CMD) {
+		struct io_uring_cmd *ioucmd;
+
+		ioucmd = io_kiocb_to_cmd(req, struct io_uring_cmd);
+		return file->f_op->uring_cmd_iopoll(ioucmd, iob, poll_flags);
+	} else {
+		struct io_rw *rw = io_kiocb_to_cmd(req, struct io_rw);
+
+		return file->f_op->iopoll(&rw->kiocb, iob, poll_flags);
+	}
+}
+
+/*
+ * Sleep for half of the expected service time before polling a request for
+ * the first time. Returns true if the request was put to sleep.
+ */
+static bool io_hybrid_iopoll_delay(struct io_ring_ctx *ctx,
+				   struct io_kiocb *req)
+{
+	struct hrtimer_sleeper timer;
+	enum hrtimer_mode mode = HRTIMER_MODE_REL;
+	u64 elapsed, sleep_time;
+
+	if (req->flags & REQ_F_IOPOLL_STATE)
+		return false;
+	req->flags |= REQ_F_IOPOLL_STATE;
+
+	if (ctx->hybrid_poll_time == LLONG_MAX)
+		return false;
+
+	sleep_time = ctx->hybrid_poll_time / 2;
+	elapsed = ktime_get_ns() - req->iopoll_start;
+	if (elapsed >= sleep_time)
+		return false;
+	sleep_time -= elapsed;
+
+	hrtimer_init_sleeper_on_stack(&timer, CLOCK_MONOTONIC, mode);
+	hrtimer_set_expires(&timer.timer, ns_to_ktime(sleep_time));
+	set_current_state(TASK_INTERRUPTIBLE);
+	hrtimer_sleeper_start_expires(&timer, mode);
+
+	if (timer.task)
+		io_schedule();
+
+	hrtimer_cancel(&timer.timer);
+	__set_current_state(TASK_RUNNING);
+	destroy_hrtimer_on_stack(&timer.timer);
+	return true;
+}
+
+static int io_uring_hybrid_poll(struct io_kiocb *req,
+				struct io_comp_batch *iob, unsigned int poll_flags)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+	u64 runtime;
+	int ret;
+
+	io_hybrid_iopoll_delay(ctx, req);
+	ret = io_uring_classic_poll(req, iob, poll_flags);
+	if (ret <= 0 && !READ_ONCE(req->iopoll_completed))
+		return ret;
+
+	/*
+	 * Track the service time of completed requests. Drop to any shorter
+	 * sample straight away, so that we never oversleep on the fastest of
+	 * several devices, and only creep back up slowly if the device gets
+	 * slower.
+	 */
+	runtime = ktime_get_ns() - req->iopoll_start;
+	if (runtime < ctx->hybrid_poll_time)
+		ctx->hybrid_poll_time = runtime;
+	else
+		ctx->hybrid_poll_time += (runtime - ctx->hybrid_poll_time) >> 3;
+	return ret;
+}
+
 int io_do_iopoll(struct io_ring_ctx *ctx, bool force_nonspin)
 {
 	struct io_wq_work_node *pos, *start, *prev;
 	unsigned int poll_flags = 0;
 	DEFINE_IO_COMP_BATCH(iob);
+	unsigned int batch_polls = 0;
 	int nr_events = 0;
 
 	/*
@@ -1122,7 +1239,6 @@ int io_do_iopoll(struct io_ring_ctx *ctx, bool force_nonspin)
 
 	wq_list_for_each(pos, start, &ctx->iopoll_list) {
 		struct io_kiocb *req = container_of(pos, struct io_kiocb, comp_list);
-		struct file *file = req->file;
 		int ret;
 
 		/*
@@ -1133,25 +1249,30 @@ int io_do_iopoll(struct io_ring_ctx *ctx, bool force_nonspin)
 		if (READ_ONCE(req->iopoll_completed))
 			break;
 
-		if (req->opcode == IORING_OP_URING_CMD) {
-			struct io_uring_cmd *ioucmd;
-
-			ioucmd = io_kiocb_to_cmd(req, struct io_uring_cmd);
-			ret = file->f_op->uring_cmd_iopoll(ioucmd, &iob,
-								poll_flags);
-		} else {
-			struct io_rw *rw = io_kiocb_to_cmd(req, struct io_rw);
-
-			ret = file->f_op->iopoll(&rw->kiocb, &iob, poll_flags);
-		}
+		if (ctx->flags & IORING_SETUP_HYBRID_IOPOLL)
+			ret = io_uring_hybrid_poll(req, &iob, poll_flags);
+		else
+			ret = io_uring_classic_poll(req, &iob, poll_flags);
 		if (unlikely(ret < 0))
 			return ret;
 		else if (ret)
 			poll_flags |= BLK_POLL_ONESHOT;
 
 		/* iopoll may have completed current req */
-		if (!rq_list_empty(iob.req_list) ||
-		    READ_ONCE(req->iopoll_completed))
+		if (READ_ONCE(req->iopoll_completed))
+			break;
+		if (rq_list_empty(iob.req_list))
+			continue;
+
+		/*
+		 * With requests spread over several queues, keep polling the
+		 * following entries so that completions from all of them end
+		 * up in the same batch and get freed and accounted together.
+		 * Bound the extra polls so that a long list of requests on
+		 * the same queue doesn't turn into a scan of the whole list.
+		 */
+		if (!ctx->poll_multi_queue ||
+		    ++batch_polls >= IO_IOPOLL_BATCH_POLLS)
 			break;
 	}
 
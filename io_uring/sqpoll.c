@@ -21,6 +21,10 @@
 #define IORING_SQPOLL_CAP_ENTRIES_VALUE 8
 #define IORING_TW_CAP_ENTRIES_VALUE	8
 
+/* how far, in weighted nsec, a ring may run ahead of the others */
+#define IORING_SQPOLL_SLICE_NSEC	(100 * NSEC_PER_USEC)
+#define IORING_SQPOLL_MAX_WEIGHT	64
+
 enum {
 	IO_SQ_THREAD_SHOULD_STOP = 0,
 	IO_SQ_THREAD_SHOULD_PARK,
@@ -173,8 +177,12 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 
 	to_submit = io_sqring_entries(ctx);
 	/* if we're handling multiple rings, cap submit size for fairness */
-	if (cap_entries && to_submit > IORING_SQPOLL_CAP_ENTRIES_VALUE)
-		to_submit = IORING_SQPOLL_CAP_ENTRIES_VALUE;
+	if (cap_entries) {
+		unsigned int cap = IORING_SQPOLL_CAP_ENTRIES_VALUE *
+				   READ_ONCE(ctx->sq_weight);
+
+		to_submit = min(to_submit, cap);
+	}
 
 	if (!wq_list_empty(&ctx->iopoll_list) || to_submit) {
 		const struct cred *creds = NULL;
@@ -194,6 +202,8 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 		    !(ctx->flags & IORING_SETUP_R_DISABLED))
 			ret = io_submit_sqes(ctx, to_submit);
 		mutex_unlock(&ctx->uring_lock);
+		if (ret > 0)
+			ctx->sq_submitted += ret;
 
 		if (io_napi(ctx))
 			ret += io_napi_sqpoll_busy_poll(ctx);
@@ -207,6 +217,58 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 	return ret;
 }
 
+static bool io_sq_ring_busy(struct io_ring_ctx *ctx)
+{
+	return io_sqring_entries(ctx) || !wq_list_empty(&ctx->iopoll_list);
+}
+
+/*
+ * Rings sharing an SQPOLL thread get its time in proportion to their
+ * weight. Each ring has a virtual time, the time spent on it divided by
+ * its weight. A ring that runs more than a slice ahead of the busy ring
+ * that is furthest behind is skipped until the others catch up. Idle and
+ * newly attached rings are pulled up to within a slice of the busy ones, so
+ * they can't build up credit and then starve everyone else.
+ */
+static u64 io_sq_update_vtime(struct io_sq_data *sqd)
+{
+	u64 min_vtime = U64_MAX, floor;
+	struct io_ring_ctx *ctx;
+
+	list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
+		if (io_sq_ring_busy(ctx))
+			min_vtime = min(min_vtime, ctx->sq_vtime);
+	}
+	if (min_vtime != U64_MAX && min_vtime > sqd->min_vtime)
+		sqd->min_vtime = min_vtime;
+
+	floor = sqd->min_vtime;
+	floor -= min(floor, IORING_SQPOLL_SLICE_NSEC);
+	list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
+		if (ctx->sq_vtime < floor)
+			ctx->sq_vtime = floor;
+	}
+	return sqd->min_vtime + IORING_SQPOLL_SLICE_NSEC;
+}
+
+static int io_sq_run_ctx(struct io_ring_ctx *ctx, bool shared, u64 max_vtime)
+{
+	u64 start, runtime;
+	int ret;
+
+	if (shared && ctx->sq_vtime > max_vtime)
+		return 0;
+
+	start = ktime_get_ns();
+	ret = __io_sq_thread(ctx, shared);
+	runtime = ktime_get_ns() - start;
+
+	ctx->sq_work_time += runtime;
+	if (shared)
+		ctx->sq_vtime += div_u64(runtime, READ_ONCE(ctx->sq_weight));
+	return ret;
+}
+
 static bool io_sqd_handle_event(struct io_sq_data *sqd)
 {
 	bool did_sig = false;
@@ -304,6 +366,7 @@ static int io_sq_thread(void *data)
 	mutex_lock(&sqd->lock);
 	while (1) {
 		bool cap_entries, sqt_spin = false;
+		u64 max_vtime = 0;
 
 		if (io_sqd_events_pending(sqd) || signal_pending(current)) {
 			if (io_sqd_handle_event(sqd))
@@ -312,11 +375,13 @@ static int io_sq_thread(void *data)
 		}
 
 		cap_entries = !list_is_singular(&sqd->ctx_list);
+		if (cap_entries)
+			max_vtime = io_sq_update_vtime(sqd);
 		getrusage(current, RUSAGE_SELF, &start);
 		list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
-			int ret = __io_sq_thread(ctx, cap_entries);
+			int ret = io_sq_run_ctx(ctx, cap_entries, max_vtime);
 
-			if (!sqt_spin && (ret > 0 || !wq_list_empty(&ctx->iopoll_list)))
+			if (!sqt_spin && (ret > 0 || io_sq_ring_busy(ctx)))
 				sqt_spin = true;
 		}
 		if (io_sq_tw(&retry_list, IORING_TW_CAP_ENTRIES_VALUE))
@@ -447,6 +512,8 @@ __cold int io_sq_offload_create(struct io_ring_ctx *ctx,
 		if (!ctx->sq_thread_idle)
 			ctx->sq_thread_idle = HZ;
 
+		ctx->sq_weight = 1;
+
 		io_sq_thread_park(sqd);
 		list_add(&ctx->sqd_list, &sqd->ctx_list);
 		io_sqd_update_thread_idle(sqd);
@@ -513,3 +580,18 @@ __cold int io_sqpoll_wq_cpu_affinity(struct io_ring_ctx *ctx,
 
 	return ret;
 }
+
+__cold int io_register_sqpoll_weight(struct io_ring_ctx *ctx, void __user *arg)
+{
+	__u32 weight;
+
+	if (!(ctx->flags & IORING_SETUP_SQPOLL) || !ctx->sq_data)
+		return -EINVAL;
+	if (copy_from_user(&weight, arg, sizeof(weight)))
+		return -EFAULT;
+	if (!weight || weight > IORING_SQPOLL_MAX_WEIGHT)
+		return -EINVAL;
+
+	WRITE_ONCE(ctx->sq_weight, weight);
+	return 0;
+}
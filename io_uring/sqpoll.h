@@ -17,6 +17,8 @@ struct io_sq_data {
 	pid_t			task_tgid;
 
 	u64			work_time;
+	/* virtual time of the ring furthest behind, see io_sq_update_vtime() */
+	u64			min_vtime;
 	unsigned long		state;
 	struct completion	exited;
 };
@@ -29,3 +31,4 @@ void io_sq_thread_unpark(struct io_sq_data *sqd);
 void io_put_sq_data(struct io_sq_data *sqd);
 void io_sqpoll_wait_sq(struct io_ring_ctx *ctx);
 int io_sqpoll_wq_cpu_affinity(struct io_ring_ctx *ctx, cpumask_var_t mask);
+int io_register_sqpoll_weight(struct io_ring_ctx *ctx, void __user *arg);
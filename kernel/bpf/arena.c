@@ -48,6 +48,7 @@ struct bpf_arena {
 	struct maple_tree mt;
 	struct list_head vma_list;
 	struct mutex lock;
+	int next_nid; /* last node used by BPF_F_ARENA_INTERLEAVE */
 };
 
 u64 bpf_arena_get_kern_vm_start(struct bpf_arena *arena)
@@ -102,7 +103,13 @@ static struct bpf_map *arena_map_alloc(union bpf_attr *attr)
 	    /* BPF_F_MMAPABLE must be set */
 	    !(attr->map_flags & BPF_F_MMAPABLE) ||
 	    /* No unsupported flags present */
-	    (attr->map_flags & ~(BPF_F_SEGV_ON_FAULT | BPF_F_MMAPABLE | BPF_F_NO_USER_CONV)))
+	    (attr->map_flags & ~(BPF_F_SEGV_ON_FAULT | BPF_F_MMAPABLE | BPF_F_NO_USER_CONV |
+				 BPF_F_NUMA_NODE | BPF_F_ARENA_INTERLEAVE)))
+		return ERR_PTR(-EINVAL);
+
+	if ((attr->map_flags & BPF_F_NUMA_NODE) &&
+	    (attr->map_flags & BPF_F_ARENA_INTERLEAVE))
+		/* A fixed node and interleaving are mutually exclusive */
 		return ERR_PTR(-EINVAL);
 
 	if (attr->map_extra & ~PAGE_MASK)
@@ -126,6 +133,7 @@ static struct bpf_map *arena_map_alloc(union bpf_attr *attr)
 		goto err;
 
 	arena->kern_vm = kern_vm;
+	arena->next_nid = NUMA_NO_NODE;
 	arena->user_vm_start = attr->map_extra;
 	if (arena->user_vm_start)
 		arena->user_vm_end = arena->user_vm_start + vm_range;
@@ -253,6 +261,37 @@ static void arena_vm_close(struct vm_area_struct *vma)
 
 #define MT_ENTRY ((void *)&arena_map_ops) /* unused. has to be valid pointer */
 
+/*
+ * Allocate zeroed pages backing the arena, called with arena->lock held.
+ * Unless a node is requested, pages come from the arena's numa_node, or
+ * round-robin from all memory nodes with BPF_F_ARENA_INTERLEAVE.
+ */
+static int arena_alloc_backing(struct bpf_arena *arena, int node_id,
+			       long page_cnt, struct page **pages)
+{
+	gfp_t gfp = GFP_KERNEL | __GFP_ZERO;
+	long i;
+	int ret;
+
+	if (node_id == NUMA_NO_NODE)
+		node_id = arena->map.numa_node;
+
+	if (node_id != NUMA_NO_NODE ||
+	    !(arena->map.map_flags & BPF_F_ARENA_INTERLEAVE))
+		return bpf_map_alloc_pages(&arena->map, gfp, node_id, page_cnt, pages);
+
+	for (i = 0; i < page_cnt; i++) {
+		arena->next_nid = next_node_in(arena->next_nid, node_states[N_MEMORY]);
+		ret = bpf_map_alloc_pages(&arena->map, gfp, arena->next_nid, 1, &pages[i]);
+		if (ret) {
+			while (i--)
+				__free_page(pages[i]);
+			return ret;
+		}
+	}
+	return 0;
+}
+
 static vm_fault_t arena_vm_fault(struct vm_fault *vmf)
 {
 	struct bpf_map *map = vmf->vma->vm_file->private_data;
@@ -279,7 +318,7 @@ static vm_fault_t arena_vm_fault(struct vm_fault *vmf)
 		return VM_FAULT_SIGSEGV;
 
 	/* Account into memcg of the process that created bpf_arena */
-	ret = bpf_map_alloc_pages(map, GFP_KERNEL | __GFP_ZERO, NUMA_NO_NODE, 1, &page);
+	ret = arena_alloc_backing(arena, NUMA_NO_NODE, 1, &page);
 	if (ret) {
 		mtree_erase(&arena->mt, vmf->pgoff);
 		return VM_FAULT_SIGSEGV;
@@ -428,6 +467,10 @@ static long arena_alloc_pages(struct bpf_arena *arena, long uaddr, long page_cnt
 	if (page_cnt > page_cnt_max)
 		return 0;
 
+	if (node_id != NUMA_NO_NODE &&
+	    (node_id < 0 || node_id >= nr_node_ids || !node_online(node_id)))
+		return 0;
+
 	if (uaddr) {
 		if (uaddr & ~PAGE_MASK)
 			return 0;
@@ -453,8 +496,7 @@ static long arena_alloc_pages(struct bpf_arena *arena, long uaddr, long page_cnt
 	if (ret)
 		goto out_free_pages;
 
-	ret = bpf_map_alloc_pages(&arena->map, GFP_KERNEL | __GFP_ZERO,
-				  node_id, page_cnt, pages);
+	ret = arena_alloc_backing(arena, node_id, page_cnt, pages);
 	if (ret)
 		goto out;
 
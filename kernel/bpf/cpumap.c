@@ -24,6 +24,7 @@
 #include <linux/filter.h>
 #include <linux/ptr_ring.h>
 #include <net/xdp.h>
+#include <net/gro.h>
 #include <net/hotdata.h>
 
 #include <linux/sched.h>
@@ -44,6 +45,8 @@
  */
 
 #define CPU_MAP_BULK_SIZE 8  /* 8 == one cacheline on 64-bit archs */
+/* Packets the kthread hands to GRO before flushing it, like a NAPI budget */
+#define CPU_MAP_GRO_BUDGET NAPI_POLL_WEIGHT
 struct bpf_cpu_map_entry;
 struct bpf_cpu_map;
 
@@ -69,6 +72,9 @@ struct bpf_cpu_map_entry {
 	struct bpf_cpumap_val value;
 	struct bpf_prog *prog;
 
+	/* GRO context of the kthread, never scheduled as a real NAPI */
+	struct napi_struct napi;
+
 	struct completion kthread_running;
 	struct rcu_work free_work;
 };
@@ -264,6 +270,7 @@ static int cpu_map_kthread_run(void *data)
 {
 	struct bpf_cpu_map_entry *rcpu = data;
 	unsigned long last_qs = jiffies;
+	unsigned int gro_pkts = 0;
 
 	complete(&rcpu->kthread_running);
 	set_current_state(TASK_INTERRUPTIBLE);
@@ -280,6 +287,8 @@ static int cpu_map_kthread_run(void *data)
 		int i, n, m, nframes, xdp_n;
 		void *frames[CPUMAP_BATCH];
 		void *skbs[CPUMAP_BATCH];
+		struct sk_buff *gro_skb, *tmp;
+		unsigned long merged;
 		LIST_HEAD(list);
 
 		/* Release CPU reschedule checks */
@@ -353,7 +362,23 @@ static int cpu_map_kthread_run(void *data)
 
 			list_add_tail(&skb->list, &list);
 		}
-		netif_receive_skb_list(&list);
+
+		/* Coalesce like the NAPI poll of a real device would, flushing
+		 * held packets once the budget was used or the ring ran dry.
+		 */
+		merged = rcpu->napi.gro_merged;
+		list_for_each_entry_safe(gro_skb, tmp, &list, list) {
+			skb_list_del_init(gro_skb);
+			napi_gro_receive(&rcpu->napi, gro_skb);
+			gro_pkts++;
+		}
+		if (gro_pkts >= CPU_MAP_GRO_BUDGET ||
+		    __ptr_ring_empty(rcpu->queue)) {
+			napi_gro_flush(&rcpu->napi, false);
+			gro_pkts = 0;
+		}
+		gro_normal_list(&rcpu->napi);
+		stats.gro_merged = rcpu->napi.gro_merged - merged;
 
 		/* Feedback loop via tracepoint */
 		trace_xdp_cpumap_kthread(rcpu->map_id, n, kmem_alloc_drops,
@@ -363,6 +388,9 @@ static int cpu_map_kthread_run(void *data)
 	}
 	__set_current_state(TASK_RUNNING);
 
+	/* The ring is empty, so GRO was flushed by the last iteration */
+	WARN_ON_ONCE(rcpu->napi.gro_bitmask || rcpu->napi.rx_count);
+
 	return 0;
 }
 
@@ -427,6 +455,7 @@ __cpu_map_entry_alloc(struct bpf_map *map, struct bpf_cpumap_val *value,
 	rcpu->cpu    = cpu;
 	rcpu->map_id = map->id;
 	rcpu->value.qsize  = value->qsize;
+	napi_init_for_gro(&rcpu->napi);
 
 	if (fd > 0 && __cpu_map_load_bpf_program(rcpu, map, fd))
 		goto free_ptr_ring;
@@ -9,6 +9,8 @@
 #include <linux/rculist_nulls.h>
 #include <linux/rcupdate_wait.h>
 #include <linux/random.h>
+#include <linux/irq_work.h>
+#include <linux/workqueue.h>
 #include <uapi/linux/btf.h>
 #include <linux/rcupdate_trace.h>
 #include <linux/btf_ids.h>
@@ -19,7 +21,7 @@
 
 #define HTAB_CREATE_FLAG_MASK						\
 	(BPF_F_NO_PREALLOC | BPF_F_NO_COMMON_LRU | BPF_F_NUMA_NODE |	\
-	 BPF_F_ACCESS_MASK | BPF_F_ZERO_SEED)
+	 BPF_F_ACCESS_MASK | BPF_F_ZERO_SEED | BPF_F_RESIZABLE)
 
 #define BATCH_OPS(_name)			\
 	.map_lookup_batch =			\
@@ -79,11 +81,27 @@
 struct bucket {
 	struct hlist_nulls_head head;
 	raw_spinlock_t raw_lock;
+	/* BPF_F_RESIZABLE: elements were moved to htab->future_buckets */
+	bool moved;
+};
+
+/* Bucket arrays carry their own size, so that a reader of a resizable map
+ * gets a consistent pointer and size from a single load.
+ */
+struct htab_buckets {
+	u32 n_buckets;
+	struct bucket buckets[];
 };
 
 #define HASHTAB_MAP_LOCK_COUNT 8
 #define HASHTAB_MAP_LOCK_MASK (HASHTAB_MAP_LOCK_COUNT - 1)
 
+/* Initial table size of a BPF_F_RESIZABLE map. It must stay a multiple of
+ * HASHTAB_MAP_LOCK_COUNT so that a bucket and the two buckets its elements
+ * move to share a map_locked slot.
+ */
+#define HTAB_RESIZE_MIN_BUCKETS 64
+
 struct bpf_htab {
 	struct bpf_map map;
 	struct bpf_mem_alloc ma;
@@ -106,6 +124,14 @@ struct bpf_htab {
 	u32 hashrnd;
 	struct lock_class_key lockdep_key;
 	int __percpu *map_locked[HASHTAB_MAP_LOCK_COUNT];
+	/* BPF_F_RESIZABLE: the twice as large table htab_resize_work() is
+	 * moving elements into, NULL when no resize is in progress.
+	 */
+	struct bucket *future_buckets;
+	u32 future_n_buckets;
+	u32 max_buckets;
+	struct irq_work resize_irq_work;
+	struct work_struct resize_work;
 };
 
 /* each htab element is struct htab_elem + key + value */
@@ -134,17 +160,53 @@ static inline bool htab_is_prealloc(const struct bpf_htab *htab)
 	return !(htab->map.map_flags & BPF_F_NO_PREALLOC);
 }
 
-static void htab_init_buckets(struct bpf_htab *htab)
+static inline bool htab_is_resizable(const struct bpf_htab *htab)
 {
+	return htab->map.map_flags & BPF_F_RESIZABLE;
+}
+
+static inline u32 htab_n_buckets(const struct bucket *buckets)
+{
+	return container_of(buckets, struct htab_buckets, buckets[0])->n_buckets;
+}
+
+/* The nulls value of a resizable map also encodes the table size, so that
+ * a lookup which followed an element into the other table restarts.
+ */
+static inline u32 htab_nulls_value(const struct bpf_htab *htab,
+				   u32 n_buckets, u32 i)
+{
+	return htab_is_resizable(htab) ? n_buckets + i : i;
+}
+
+static struct bucket *htab_alloc_buckets(struct bpf_htab *htab, u32 n_buckets)
+{
+	struct htab_buckets *tbl;
 	unsigned int i;
 
-	for (i = 0; i < htab->n_buckets; i++) {
-		INIT_HLIST_NULLS_HEAD(&htab->buckets[i].head, i);
-		raw_spin_lock_init(&htab->buckets[i].raw_lock);
-		lockdep_set_class(&htab->buckets[i].raw_lock,
+	tbl = bpf_map_area_alloc(struct_size(tbl, buckets, n_buckets),
+				 htab->map.numa_node);
+	if (!tbl)
+		return NULL;
+
+	tbl->n_buckets = n_buckets;
+	for (i = 0; i < n_buckets; i++) {
+		INIT_HLIST_NULLS_HEAD(&tbl->buckets[i].head,
+				      htab_nulls_value(htab, n_buckets, i));
+		raw_spin_lock_init(&tbl->buckets[i].raw_lock);
+		lockdep_set_class(&tbl->buckets[i].raw_lock,
 					  &htab->lockdep_key);
 		cond_resched();
 	}
+
+	return tbl->buckets;
+}
+
+static void htab_free_buckets(struct bucket *buckets)
+{
+	if (buckets)
+		bpf_map_area_free(container_of(buckets, struct htab_buckets,
+					       buckets[0]));
 }
 
 static inline int htab_lock_bucket(const struct bpf_htab *htab,
@@ -182,6 +244,8 @@ static inline void htab_unlock_bucket(const struct bpf_htab *htab,
 }
 
 static bool htab_lru_map_delete_node(void *arg, struct bpf_lru_node *node);
+static void htab_resize_work(struct work_struct *work);
+static void htab_resize_irq_work(struct irq_work *work);
 
 static bool htab_is_lru(const struct bpf_htab *htab)
 {
@@ -425,6 +489,7 @@ static int htab_map_alloc_check(union bpf_attr *attr)
 	bool percpu_lru = (attr->map_flags & BPF_F_NO_COMMON_LRU);
 	bool prealloc = !(attr->map_flags & BPF_F_NO_PREALLOC);
 	bool zero_seed = (attr->map_flags & BPF_F_ZERO_SEED);
+	bool resizable = (attr->map_flags & BPF_F_RESIZABLE);
 	int numa_node = bpf_map_attr_numa_node(attr);
 
 	BUILD_BUG_ON(offsetof(struct htab_elem, fnode.next) !=
@@ -447,6 +512,15 @@ static int htab_map_alloc_check(union bpf_attr *attr)
 	if (numa_node != NUMA_NO_NODE && (percpu || percpu_lru))
 		return -EINVAL;
 
+	/* Only the plain, non-preallocated hash map can move its elements
+	 * between tables; the nulls value of a table of 2^30 buckets still
+	 * fits on 32-bit.
+	 */
+	if (resizable && (attr->map_type != BPF_MAP_TYPE_HASH || prealloc))
+		return -EINVAL;
+	if (resizable && attr->max_entries > 1UL << 30)
+		return -E2BIG;
+
 	/* check sanity of attributes.
 	 * value_size == 0 may be allowed in the future to use map as a set
 	 */
@@ -510,6 +584,10 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 		goto free_htab;
 
 	htab->n_buckets = roundup_pow_of_two(htab->map.max_entries);
+	htab->max_buckets = htab->n_buckets;
+	if (htab_is_resizable(htab))
+		htab->n_buckets = min_t(u32, htab->n_buckets,
+					HTAB_RESIZE_MIN_BUCKETS);
 
 	htab->elem_size = sizeof(struct htab_elem) +
 			  round_up(htab->map.key_size, 8);
@@ -519,7 +597,7 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 		htab->elem_size += round_up(htab->map.value_size, 8);
 
 	/* check for u32 overflow */
-	if (htab->n_buckets > U32_MAX / sizeof(struct bucket))
+	if (htab->max_buckets > U32_MAX / sizeof(struct bucket))
 		goto free_htab;
 
 	err = bpf_map_init_elem_count(&htab->map);
@@ -527,9 +605,7 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 		goto free_htab;
 
 	err = -ENOMEM;
-	htab->buckets = bpf_map_area_alloc(htab->n_buckets *
-					   sizeof(struct bucket),
-					   htab->map.numa_node);
+	htab->buckets = htab_alloc_buckets(htab, htab->n_buckets);
 	if (!htab->buckets)
 		goto free_elem_count;
 
@@ -547,7 +623,8 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 	else
 		htab->hashrnd = get_random_u32();
 
-	htab_init_buckets(htab);
+	init_irq_work(&htab->resize_irq_work, htab_resize_irq_work);
+	INIT_WORK(&htab->resize_work, htab_resize_work);
 
 /* compute_batch_value() computes batch value as num_online_cpus() * 2
  * and __percpu_counter_compare() needs
@@ -606,7 +683,7 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 		percpu_counter_destroy(&htab->pcount);
 	for (i = 0; i < HASHTAB_MAP_LOCK_COUNT; i++)
 		free_percpu(htab->map_locked[i]);
-	bpf_map_area_free(htab->buckets);
+	htab_free_buckets(htab->buckets);
 	bpf_mem_alloc_destroy(&htab->pcpu_ma);
 	bpf_mem_alloc_destroy(&htab->ma);
 free_elem_count:
@@ -670,6 +747,207 @@ static struct htab_elem *lookup_nulls_elem_raw(struct hlist_nulls_head *head,
 	return NULL;
 }
 
+/* Lookup in a resizable map. Elements are moved from a bucket of the current
+ * table to the future one before they are unlinked from the old bucket, so
+ * searching the current table and then the future one cannot miss an element
+ * that was in the map all along. A walk that ended up in a chain of another
+ * bucket or table restarts from the current table. If @vidx is set, it
+ * returns the index of the bucket the element was found in, as seen by
+ * htab_iter_bucket().
+ */
+static struct htab_elem *htab_resizable_lookup(struct bpf_htab *htab,
+					       u32 hash, void *key,
+					       u32 key_size, u32 *vidx)
+{
+	struct hlist_nulls_node *n;
+	struct bucket *buckets;
+	struct htab_elem *l;
+	u32 n_buckets, idx;
+	u32 base;
+
+again:
+	buckets = smp_load_acquire(&htab->buckets);
+	base = 0;
+next_table:
+	n_buckets = htab_n_buckets(buckets);
+	idx = hash & (n_buckets - 1);
+	hlist_nulls_for_each_entry_rcu(l, n, &buckets[idx].head, hash_node)
+		if (l->hash == hash && !memcmp(&l->key, key, key_size)) {
+			if (vidx)
+				*vidx = base + idx;
+			return l;
+		}
+
+	if (unlikely(get_nulls_value(n) != n_buckets + idx))
+		goto again;
+
+	if (!base) {
+		base = n_buckets;
+		buckets = smp_load_acquire(&htab->future_buckets);
+		if (unlikely(buckets))
+			goto next_table;
+	}
+
+	return NULL;
+}
+
+/* Lock the bucket @hash belongs to. A bucket of a resizable map which was
+ * already moved is empty and stays so, its elements have to be looked for
+ * in the future table under that bucket's lock.
+ */
+static struct bucket *htab_lock_hash(struct bpf_htab *htab, u32 hash,
+				     unsigned long *pflags)
+{
+	struct bucket *buckets, *b;
+	int ret;
+
+	if (!htab_is_resizable(htab)) {
+		b = __select_bucket(htab, hash);
+		ret = htab_lock_bucket(htab, b, hash, pflags);
+		return ret ? ERR_PTR(ret) : b;
+	}
+
+	buckets = smp_load_acquire(&htab->buckets);
+	b = &buckets[hash & (htab_n_buckets(buckets) - 1)];
+	ret = htab_lock_bucket(htab, b, hash, pflags);
+	if (ret)
+		return ERR_PTR(ret);
+	if (likely(!b->moved))
+		return b;
+	htab_unlock_bucket(htab, b, hash, *pflags);
+
+	/* future_buckets is set before the first bucket is moved and only
+	 * cleared a grace period after the tables were swapped.
+	 */
+	buckets = READ_ONCE(htab->future_buckets);
+	b = &buckets[hash & (htab_n_buckets(buckets) - 1)];
+	ret = htab_lock_bucket(htab, b, hash, pflags);
+	return ret ? ERR_PTR(ret) : b;
+}
+
+/* Iterators see a resizable map as its current table followed by the table
+ * being filled, if any. An element moved while the map is being walked can
+ * be skipped or returned twice, as with any other concurrent update.
+ */
+static u32 htab_iter_n_buckets(const struct bpf_htab *htab)
+{
+	return READ_ONCE(htab->n_buckets) + READ_ONCE(htab->future_n_buckets);
+}
+
+/* must be called under rcu_read_lock() */
+static struct bucket *htab_iter_bucket(const struct bpf_htab *htab, u32 i)
+{
+	struct bucket *buckets = smp_load_acquire(&htab->buckets);
+	u32 n_buckets = htab_n_buckets(buckets);
+
+	if (i < n_buckets)
+		return &buckets[i];
+
+	buckets = smp_load_acquire(&htab->future_buckets);
+	if (buckets && i - n_buckets < htab_n_buckets(buckets))
+		return &buckets[i - n_buckets];
+
+	return NULL;
+}
+
+static u32 htab_elem_count(struct bpf_htab *htab)
+{
+	if (htab->use_percpu_counter)
+		return percpu_counter_read_positive(&htab->pcount);
+	return atomic_read(&htab->count);
+}
+
+static bool htab_needs_resize(struct bpf_htab *htab)
+{
+	u32 n_buckets = READ_ONCE(htab->n_buckets);
+
+	return n_buckets < htab->max_buckets &&
+	       htab_elem_count(htab) > n_buckets;
+}
+
+/* Move all elements of @ob to their buckets in @buckets. Called with @ob
+ * locked, so only readers and writers of already moved buckets run
+ * concurrently.
+ */
+static void htab_move_bucket(struct bucket *ob, struct bucket *buckets,
+			     u32 n_buckets)
+{
+	struct hlist_nulls_node *first, *next;
+	struct htab_elem *l;
+	struct bucket *nb;
+
+	while (!is_a_nulls(first = ob->head.first)) {
+		l = container_of(first, struct htab_elem, hash_node);
+		nb = &buckets[l->hash & (n_buckets - 1)];
+		next = first->next;
+
+		raw_spin_lock_nested(&nb->raw_lock, SINGLE_DEPTH_NESTING);
+		/* A reader on @first now continues into the new chain and
+		 * restarts at its nulls value.
+		 */
+		hlist_nulls_add_head_rcu(first, &nb->head);
+		rcu_assign_pointer(hlist_nulls_first_rcu(&ob->head), next);
+		if (!is_a_nulls(next))
+			WRITE_ONCE(next->pprev, &ob->head.first);
+		raw_spin_unlock(&nb->raw_lock);
+	}
+	ob->moved = true;
+}
+
+static void htab_resize_work(struct work_struct *work)
+{
+	struct bpf_htab *htab = container_of(work, struct bpf_htab, resize_work);
+	struct bucket *old = htab->buckets, *new;
+	u32 n_buckets = htab->n_buckets, i;
+	unsigned long flags;
+
+	if (!htab_needs_resize(htab))
+		return;
+
+	new = htab_alloc_buckets(htab, n_buckets * 2);
+	if (!new)
+		return;
+
+	WRITE_ONCE(htab->future_n_buckets, n_buckets * 2);
+	smp_store_release(&htab->future_buckets, new);
+
+	for (i = 0; i < n_buckets; i++) {
+		/* map_locked can only be held by a program interrupting
+		 * us on this CPU, so this does not spin for long.
+		 */
+		while (htab_lock_bucket(htab, &old[i], i, &flags))
+			cpu_relax();
+		htab_move_bucket(&old[i], new, n_buckets * 2);
+		htab_unlock_bucket(htab, &old[i], i, flags);
+		cond_resched();
+	}
+
+	smp_store_release(&htab->buckets, new);
+	WRITE_ONCE(htab->n_buckets, n_buckets * 2);
+	WRITE_ONCE(htab->future_n_buckets, 0);
+
+	/* Wait for readers and writers which may still walk the old table,
+	 * including sleepable programs.
+	 */
+	synchronize_rcu_mult(call_rcu, call_rcu_tasks_trace);
+	WRITE_ONCE(htab->future_buckets, NULL);
+	htab_free_buckets(old);
+
+	if (htab_needs_resize(htab))
+		queue_work(system_unbound_wq, &htab->resize_work);
+}
+
+/* Updates can run in any context, including NMI, so kick the resize work
+ * from irq_work.
+ */
+static void htab_resize_irq_work(struct irq_work *work)
+{
+	struct bpf_htab *htab = container_of(work, struct bpf_htab,
+					     resize_irq_work);
+
+	queue_work(system_unbound_wq, &htab->resize_work);
+}
+
 /* Called from syscall or from eBPF program directly, so
  * arguments have to match bpf_map_lookup_elem() exactly.
  * The return value is adjusted by BPF instructions
@@ -689,6 +967,9 @@ static void *__htab_map_lookup_elem(struct bpf_map *map, void *key)
 
 	hash = htab_map_hash(key, key_size, htab->hashrnd);
 
+	if (htab_is_resizable(htab))
+		return htab_resizable_lookup(htab, hash, key, key_size, NULL);
+
 	head = select_bucket(htab, hash);
 
 	l = lookup_nulls_elem_raw(head, hash, key, key_size, htab->n_buckets);
@@ -838,7 +1119,8 @@ static int htab_map_get_next_key(struct bpf_map *map, void *key, void *next_key)
 	struct hlist_nulls_head *head;
 	struct htab_elem *l, *next_l;
 	u32 hash, key_size;
-	int i = 0;
+	struct bucket *b;
+	u32 i = 0;
 
 	WARN_ON_ONCE(!rcu_read_lock_held());
 
@@ -849,13 +1131,20 @@ static int htab_map_get_next_key(struct bpf_map *map, void *key, void *next_key)
 
 	hash = htab_map_hash(key, key_size, htab->hashrnd);
 
-	head = select_bucket(htab, hash);
-
 	/* lookup the key */
-	l = lookup_nulls_elem_raw(head, hash, key, key_size, htab->n_buckets);
+	if (htab_is_resizable(htab)) {
+		l = htab_resizable_lookup(htab, hash, key, key_size, &i);
+	} else {
+		head = select_bucket(htab, hash);
+		l = lookup_nulls_elem_raw(head, hash, key, key_size,
+					  htab->n_buckets);
+		i = hash & (htab->n_buckets - 1);
+	}
 
-	if (!l)
+	if (!l) {
+		i = 0;
 		goto find_first_elem;
+	}
 
 	/* key was found, get next key in the same bucket */
 	next_l = hlist_nulls_entry_safe(rcu_dereference_raw(hlist_nulls_next_rcu(&l->hash_node)),
@@ -868,13 +1157,12 @@ static int htab_map_get_next_key(struct bpf_map *map, void *key, void *next_key)
 	}
 
 	/* no more elements in this hash list, go to the next bucket */
-	i = hash & (htab->n_buckets - 1);
 	i++;
 
 find_first_elem:
 	/* iterate over buckets */
-	for (; i < htab->n_buckets; i++) {
-		head = select_bucket(htab, i);
+	for (; (b = htab_iter_bucket(htab, i)); i++) {
+		head = &b->head;
 
 		/* pick first element in the bucket */
 		next_l = hlist_nulls_entry_safe(rcu_dereference_raw(hlist_nulls_first_rcu(head)),
@@ -1116,15 +1404,17 @@ static long htab_map_update_elem(struct bpf_map *map, void *key, void *value,
 
 	hash = htab_map_hash(key, key_size, htab->hashrnd);
 
-	b = __select_bucket(htab, hash);
-	head = &b->head;
-
 	if (unlikely(map_flags & BPF_F_LOCK)) {
 		if (unlikely(!btf_record_has_field(map->record, BPF_SPIN_LOCK)))
 			return -EINVAL;
 		/* find an element without taking the bucket lock */
-		l_old = lookup_nulls_elem_raw(head, hash, key, key_size,
-					      htab->n_buckets);
+		if (htab_is_resizable(htab))
+			l_old = htab_resizable_lookup(htab, hash, key,
+						      key_size, NULL);
+		else
+			l_old = lookup_nulls_elem_raw(select_bucket(htab, hash),
+						      hash, key, key_size,
+						      htab->n_buckets);
 		ret = check_flags(htab, l_old, map_flags);
 		if (ret)
 			return ret;
@@ -1141,9 +1431,10 @@ static long htab_map_update_elem(struct bpf_map *map, void *key, void *value,
 		 */
 	}
 
-	ret = htab_lock_bucket(htab, b, hash, &flags);
-	if (ret)
-		return ret;
+	b = htab_lock_hash(htab, hash, &flags);
+	if (IS_ERR(b))
+		return PTR_ERR(b);
+	head = &b->head;
 
 	l_old = lookup_elem_raw(head, hash, key, key_size);
 
@@ -1187,6 +1478,9 @@ static long htab_map_update_elem(struct bpf_map *map, void *key, void *value,
 	ret = 0;
 err:
 	htab_unlock_bucket(htab, b, hash, flags);
+	if (!ret && !l_old && htab_is_resizable(htab) &&
+	    unlikely(htab_needs_resize(htab)))
+		irq_work_queue(&htab->resize_irq_work);
 	return ret;
 }
 
@@ -1420,12 +1714,11 @@ static long htab_map_delete_elem(struct bpf_map *map, void *key)
 	key_size = map->key_size;
 
 	hash = htab_map_hash(key, key_size, htab->hashrnd);
-	b = __select_bucket(htab, hash);
+	b = htab_lock_hash(htab, hash, &flags);
+	if (IS_ERR(b))
+		return PTR_ERR(b);
 	head = &b->head;
-
-	ret = htab_lock_bucket(htab, b, hash, &flags);
-	if (ret)
-		return ret;
+	ret = 0;
 
 	l = lookup_elem_raw(head, hash, key, key_size);
 
@@ -1502,9 +1795,11 @@ static void htab_free_malloced_timers_and_wq(struct bpf_htab *htab)
 {
 	int i;
 
+	struct bucket *b;
+
 	rcu_read_lock();
-	for (i = 0; i < htab->n_buckets; i++) {
-		struct hlist_nulls_head *head = select_bucket(htab, i);
+	for (i = 0; (b = htab_iter_bucket(htab, i)); i++) {
+		struct hlist_nulls_head *head = &b->head;
 		struct hlist_nulls_node *n;
 		struct htab_elem *l;
 
@@ -1544,7 +1839,12 @@ static void htab_map_free(struct bpf_map *map)
 	/* bpf_free_used_maps() or close(map_fd) will trigger this map_free callback.
 	 * bpf_free_used_maps() is called after bpf prog is no longer executing.
 	 * There is no need to synchronize_rcu() here to protect map elements.
+	 * A pending resize still has to finish before the table is torn down.
 	 */
+	if (htab_is_resizable(htab)) {
+		irq_work_sync(&htab->resize_irq_work);
+		cancel_work_sync(&htab->resize_work);
+	}
 
 	/* htab no longer uses call_rcu() directly. bpf_mem_alloc does it
 	 * underneath and is responsible for waiting for callbacks to finish
@@ -1559,7 +1859,7 @@ static void htab_map_free(struct bpf_map *map)
 
 	bpf_map_free_elem_count(map);
 	free_percpu(htab->extra_elems);
-	bpf_map_area_free(htab->buckets);
+	htab_free_buckets(htab->buckets);
 	bpf_mem_alloc_destroy(&htab->pcpu_ma);
 	bpf_mem_alloc_destroy(&htab->ma);
 	if (htab->use_percpu_counter)
@@ -1606,12 +1906,11 @@ static int __htab_map_lookup_and_delete_elem(struct bpf_map *map, void *key,
 	key_size = map->key_size;
 
 	hash = htab_map_hash(key, key_size, htab->hashrnd);
-	b = __select_bucket(htab, hash);
+	b = htab_lock_hash(htab, hash, &bflags);
+	if (IS_ERR(b))
+		return PTR_ERR(b);
 	head = &b->head;
-
-	ret = htab_lock_bucket(htab, b, hash, &bflags);
-	if (ret)
-		return ret;
+	ret = 0;
 
 	l = lookup_elem_raw(head, hash, key, key_size);
 	if (!l) {
@@ -1685,6 +1984,24 @@ static int htab_lru_percpu_map_lookup_and_delete_elem(struct bpf_map *map,
 						 flags);
 }
 
+/* BPF_F_PERCPU_SUM: fold the per-CPU counters of an element, so that an
+ * exporter copies value_size bytes per key instead of one value per CPU.
+ */
+static void htab_percpu_sum(void *dst, void __percpu *pptr, u32 value_size)
+{
+	u32 i, n = value_size / sizeof(u64);
+	u64 *sum = dst;
+	int cpu;
+
+	memset(sum, 0, value_size);
+	for_each_possible_cpu(cpu) {
+		const u64 *val = per_cpu_ptr(pptr, cpu);
+
+		for (i = 0; i < n; i++)
+			sum[i] += READ_ONCE(val[i]);
+	}
+}
+
 static int
 __htab_map_lookup_and_delete_batch(struct bpf_map *map,
 				   const union bpf_attr *attr,
@@ -1710,10 +2027,16 @@ __htab_map_lookup_and_delete_batch(struct bpf_map *map,
 	int ret = 0;
 
 	elem_map_flags = attr->batch.elem_flags;
-	if ((elem_map_flags & ~BPF_F_LOCK) ||
+	if ((elem_map_flags & ~(BPF_F_LOCK | BPF_F_PERCPU_SUM)) ||
 	    ((elem_map_flags & BPF_F_LOCK) && !btf_record_has_field(map->record, BPF_SPIN_LOCK)))
 		return -EINVAL;
 
+	/* summing is only defined for plain u64 counters */
+	if ((elem_map_flags & BPF_F_PERCPU_SUM) &&
+	    (!is_percpu || !IS_ALIGNED(map->value_size, sizeof(u64)) ||
+	     !IS_ERR_OR_NULL(map->record)))
+		return -EINVAL;
+
 	map_flags = attr->batch.flags;
 	if (map_flags)
 		return -EINVAL;
@@ -1729,14 +2052,14 @@ __htab_map_lookup_and_delete_batch(struct bpf_map *map,
 	if (ubatch && copy_from_user(&batch, ubatch, sizeof(batch)))
 		return -EFAULT;
 
-	if (batch >= htab->n_buckets)
+	if (batch >= htab_iter_n_buckets(htab))
 		return -ENOENT;
 
 	key_size = htab->map.key_size;
 	roundup_key_size = round_up(htab->map.key_size, 8);
 	value_size = htab->map.value_size;
 	size = round_up(value_size, 8);
-	if (is_percpu)
+	if (is_percpu && !(elem_map_flags & BPF_F_PERCPU_SUM))
 		value_size = size * num_possible_cpus();
 	total = 0;
 	/* while experimenting with hash tables with sizes ranging from 10 to
@@ -1761,7 +2084,15 @@ __htab_map_lookup_and_delete_batch(struct bpf_map *map,
 again_nocopy:
 	dst_key = keys;
 	dst_val = values;
-	b = &htab->buckets[batch];
+	b = htab_iter_bucket(htab, batch);
+	if (!b) {
+		/* a resize finished and the map got fewer buckets to walk */
+		rcu_read_unlock();
+		bpf_enable_instrumentation();
+		locked = false;
+		ret = -ENOENT;
+		goto after_loop;
+	}
 	head = &b->head;
 	/* do not grab the lock unless need it (bucket_cnt > 0). */
 	if (locked) {
@@ -1819,6 +2150,10 @@ __htab_map_lookup_and_delete_batch(struct bpf_map *map,
 			void __percpu *pptr;
 
 			pptr = htab_elem_get_ptr(l, map->key_size);
+			if (elem_map_flags & BPF_F_PERCPU_SUM) {
+				htab_percpu_sum(dst_val, pptr, value_size);
+				goto next_elem;
+			}
 			for_each_possible_cpu(cpu) {
 				copy_map_value_long(&htab->map, dst_val + off, per_cpu_ptr(pptr, cpu));
 				check_and_init_map_value(&htab->map, dst_val + off);
@@ -1842,6 +2177,7 @@ __htab_map_lookup_and_delete_batch(struct bpf_map *map,
 			/* Zeroing special fields in the temp buffer */
 			check_and_init_map_value(map, dst_val);
 		}
+next_elem:
 		if (do_delete) {
 			hlist_nulls_del_rcu(&l->hash_node);
 
@@ -1874,7 +2210,7 @@ __htab_map_lookup_and_delete_batch(struct bpf_map *map,
 	/* If we are not copying data, we can go to next bucket and avoid
 	 * unlocking the rcu.
 	 */
-	if (!bucket_cnt && (batch + 1 < htab->n_buckets)) {
+	if (!bucket_cnt && (batch + 1 < htab_iter_n_buckets(htab))) {
 		batch++;
 		goto again_nocopy;
 	}
@@ -1891,7 +2227,7 @@ __htab_map_lookup_and_delete_batch(struct bpf_map *map,
 
 	total += bucket_cnt;
 	batch++;
-	if (batch >= htab->n_buckets) {
+	if (batch >= htab_iter_n_buckets(htab)) {
 		ret = -ENOENT;
 		goto after_loop;
 	}
@@ -2003,7 +2339,7 @@ bpf_hash_map_seq_find_next(struct bpf_iter_seq_hash_map_info *info,
 	struct bucket *b;
 	u32 i, count;
 
-	if (bucket_id >= htab->n_buckets)
+	if (bucket_id >= htab_iter_n_buckets(htab))
 		return NULL;
 
 	/* try to find next elem in the same bucket */
@@ -2017,14 +2353,18 @@ bpf_hash_map_seq_find_next(struct bpf_iter_seq_hash_map_info *info,
 			return elem;
 
 		/* not found, unlock and go to the next bucket */
-		b = &htab->buckets[bucket_id++];
+		bucket_id++;
 		rcu_read_unlock();
 		skip_elems = 0;
 	}
 
-	for (i = bucket_id; i < htab->n_buckets; i++) {
-		b = &htab->buckets[i];
+	for (i = bucket_id; ; i++) {
 		rcu_read_lock();
+		b = htab_iter_bucket(htab, i);
+		if (!b) {
+			rcu_read_unlock();
+			break;
+		}
 
 		count = 0;
 		head = &b->head;
@@ -2193,9 +2533,13 @@ static long bpf_for_each_hash_elem(struct bpf_map *map, bpf_callback_t callback_
 	 */
 	if (is_percpu)
 		migrate_disable();
-	for (i = 0; i < htab->n_buckets; i++) {
-		b = &htab->buckets[i];
+	for (i = 0; ; i++) {
 		rcu_read_lock();
+		b = htab_iter_bucket(htab, i);
+		if (!b) {
+			rcu_read_unlock();
+			break;
+		}
 		head = &b->head;
 		hlist_nulls_for_each_entry_rcu(elem, n, head, hash_node) {
 			key = elem->key;
@@ -2233,7 +2577,7 @@ static u64 htab_map_mem_usage(const struct bpf_map *map)
 	u64 num_entries;
 	u64 usage = sizeof(struct bpf_htab);
 
-	usage += sizeof(struct bucket) * htab->n_buckets;
+	usage += sizeof(struct bucket) * htab_iter_n_buckets(htab);
 	usage += sizeof(int) * num_possible_cpus() * HASHTAB_MAP_LOCK_COUNT;
 	if (prealloc) {
 		num_entries = map->max_entries;
@@ -29,9 +29,17 @@ struct lpm_trie_node {
 	u8				data[];
 };
 
+/* Entry of the optional direct index table, see lpm_stride_fill() */
+struct lpm_trie_stride {
+	struct lpm_trie_node __rcu	*best;
+	struct lpm_trie_node __rcu	*next;
+};
+
 struct lpm_trie {
 	struct bpf_map			map;
 	struct lpm_trie_node __rcu	*root;
+	struct lpm_trie_stride		*stride;
+	u32				stride_bits;
 	size_t				n_entries;
 	size_t				max_prefixlen;
 	size_t				data_size;
@@ -232,6 +240,110 @@ static size_t longest_prefix_match(const struct lpm_trie *trie,
 	return __longest_prefix_match(trie, node, key);
 }
 
+/* When map_extra is set, the leading @stride_bits bits of a key index a
+ * table that remembers, for every possible value of those bits, the best
+ * match so far (@best) and the node to resume the walk from (@next): the
+ * first node on the path with a prefix length >= @stride_bits. Nodes
+ * above that depth are never visited by lookups.
+ *
+ * The table is rebuilt under trie->lock for the range of indexes an
+ * update can affect, and the nodes it points to are freed after an RCU
+ * grace period like any other node. A lookup racing with an update may
+ * combine @best and @next from either side of it.
+ */
+static u32 lpm_stride_index(const struct lpm_trie *trie, const u8 *data)
+{
+	if (trie->stride_bits == 16)
+		return (data[0] << 8) | data[1];
+	return data[0];
+}
+
+/* Mask selecting the leading @bits bits of a stride index */
+static u32 lpm_stride_mask(const struct lpm_trie *trie, u32 bits)
+{
+	u32 k = trie->stride_bits;
+
+	if (!bits)
+		return 0;
+	return (~0U << (k - bits)) & (BIT(k) - 1);
+}
+
+static void lpm_stride_set(struct lpm_trie *trie, u32 base, u32 bits,
+			   struct lpm_trie_node *best,
+			   struct lpm_trie_node *next)
+{
+	u32 i, n = BIT(trie->stride_bits - bits);
+
+	for (i = 0; i < n; i++) {
+		rcu_assign_pointer(trie->stride[base + i].best, best);
+		rcu_assign_pointer(trie->stride[base + i].next, next);
+	}
+}
+
+/* Fill table entries [@base, @base + 2^(stride_bits - @bits)), all sharing
+ * their leading @bits bits, walking down from @node with @best as current
+ * match. Recursion depth is bounded by stride_bits.
+ */
+static void lpm_stride_fill(struct lpm_trie *trie, struct lpm_trie_node *node,
+			    struct lpm_trie_node *best, u32 base, u32 bits)
+{
+	u32 k = trie->stride_bits;
+
+	while (node && node->prefixlen < k) {
+		u32 plen = node->prefixlen;
+		u32 top = lpm_stride_index(trie, node->data);
+
+		if ((top ^ base) & lpm_stride_mask(trie, min(plen, bits))) {
+			node = NULL;
+			break;
+		}
+
+		if (plen > bits) {
+			/* Only part of the range goes through @node */
+			lpm_stride_set(trie, base, bits, best, NULL);
+			base = top & lpm_stride_mask(trie, plen);
+			bits = plen;
+		}
+
+		if (!(node->flags & LPM_TREE_NODE_FLAG_IM))
+			best = node;
+
+		if (plen == bits) {
+			/* Next bit splits the range between both children */
+			lpm_stride_fill(trie,
+					rcu_dereference_protected(node->child[0],
+						lockdep_is_held(&trie->lock)),
+					best, base, bits + 1);
+			base |= BIT(k - bits - 1);
+			bits++;
+			node = rcu_dereference_protected(node->child[1],
+						lockdep_is_held(&trie->lock));
+		} else {
+			node = rcu_dereference_protected(
+				node->child[(base >> (k - plen - 1)) & 1],
+				lockdep_is_held(&trie->lock));
+		}
+	}
+
+	lpm_stride_set(trie, base, bits, best, node);
+}
+
+/* Rebuild the table entries sharing the leading @bits bits of @data */
+static void lpm_stride_rebuild(struct lpm_trie *trie, const u8 *data, u32 bits)
+{
+	struct lpm_trie_node *root;
+
+	if (!trie->stride)
+		return;
+
+	bits = min(bits, trie->stride_bits);
+	root = rcu_dereference_protected(trie->root,
+					 lockdep_is_held(&trie->lock));
+	lpm_stride_fill(trie, root, NULL,
+			lpm_stride_index(trie, data) & lpm_stride_mask(trie, bits),
+			bits);
+}
+
 /* Called from syscall or from eBPF program */
 static void *trie_lookup_elem(struct bpf_map *map, void *_key)
 {
@@ -242,10 +354,20 @@ static void *trie_lookup_elem(struct bpf_map *map, void *_key)
 	if (key->prefixlen > trie->max_prefixlen)
 		return NULL;
 
-	/* Start walking the trie from the root node ... */
+	/* Start walking the trie from the root node, or from where the
+	 * stride table tells us to.
+	 */
+	if (trie->stride && key->prefixlen >= trie->stride_bits) {
+		const struct lpm_trie_stride *s;
+
+		s = &trie->stride[lpm_stride_index(trie, key->data)];
+		found = rcu_dereference_check(s->best, rcu_read_lock_bh_held());
+		node = rcu_dereference_check(s->next, rcu_read_lock_bh_held());
+	} else {
+		node = rcu_dereference_check(trie->root, rcu_read_lock_bh_held());
+	}
 
-	for (node = rcu_dereference_check(trie->root, rcu_read_lock_bh_held());
-	     node;) {
+	while (node) {
 		unsigned int next_bit;
 		size_t matchlen;
 
@@ -322,6 +444,7 @@ static long trie_update_elem(struct bpf_map *map,
 	unsigned long irq_flags;
 	unsigned int next_bit;
 	size_t matchlen = 0;
+	u32 stride_bits = 0;
 	int ret = 0;
 
 	if (unlikely(flags > BPF_EXIST))
@@ -370,6 +493,8 @@ static long trie_update_elem(struct bpf_map *map,
 
 		next_bit = extract_bit(key->data, node->prefixlen);
 		slot = &node->child[next_bit];
+		/* Only keys going through *slot can be affected */
+		stride_bits = node->prefixlen + 1;
 	}
 
 	/* If the slot is empty (a free child pointer or an empty root),
@@ -435,6 +560,8 @@ static long trie_update_elem(struct bpf_map *map,
 
 		kfree(new_node);
 		kfree(im_node);
+	} else {
+		lpm_stride_rebuild(trie, key->data, stride_bits);
 	}
 
 	spin_unlock_irqrestore(&trie->lock, irq_flags);
@@ -451,6 +578,7 @@ static long trie_delete_elem(struct bpf_map *map, void *_key)
 	struct bpf_lpm_trie_key_u8 *key = _key;
 	struct lpm_trie_node __rcu **trim, **trim2;
 	struct lpm_trie_node *node, *parent;
+	u32 trim_bits = 0, trim2_bits = 0;
 	unsigned long irq_flags;
 	unsigned int next_bit;
 	size_t matchlen = 0;
@@ -480,8 +608,10 @@ static long trie_delete_elem(struct bpf_map *map, void *_key)
 
 		parent = node;
 		trim2 = trim;
+		trim2_bits = trim_bits;
 		next_bit = extract_bit(key->data, node->prefixlen);
 		trim = &node->child[next_bit];
+		trim_bits = node->prefixlen + 1;
 	}
 
 	if (!node || node->prefixlen != key->prefixlen ||
@@ -499,6 +629,7 @@ static long trie_delete_elem(struct bpf_map *map, void *_key)
 	if (rcu_access_pointer(node->child[0]) &&
 	    rcu_access_pointer(node->child[1])) {
 		node->flags |= LPM_TREE_NODE_FLAG_IM;
+		lpm_stride_rebuild(trie, key->data, trim_bits);
 		goto out;
 	}
 
@@ -519,6 +650,7 @@ static long trie_delete_elem(struct bpf_map *map, void *_key)
 				*trim2, rcu_access_pointer(parent->child[0]));
 		free_parent = parent;
 		free_node = node;
+		lpm_stride_rebuild(trie, key->data, trim2_bits);
 		goto out;
 	}
 
@@ -533,6 +665,7 @@ static long trie_delete_elem(struct bpf_map *map, void *_key)
 	else
 		RCU_INIT_POINTER(*trim, NULL);
 	free_node = node;
+	lpm_stride_rebuild(trie, key->data, trim_bits);
 
 out:
 	spin_unlock_irqrestore(&trie->lock, irq_flags);
@@ -571,6 +704,13 @@ static struct bpf_map *trie_alloc(union bpf_attr *attr)
 	    attr->value_size > LPM_VAL_SIZE_MAX)
 		return ERR_PTR(-EINVAL);
 
+	if (attr->map_extra != 0 && attr->map_extra != 8 &&
+	    attr->map_extra != 16)
+		return ERR_PTR(-EINVAL);
+	if (attr->map_extra >
+	    (attr->key_size - offsetof(struct bpf_lpm_trie_key_u8, data)) * 8)
+		return ERR_PTR(-EINVAL);
+
 	trie = bpf_map_area_alloc(sizeof(*trie), NUMA_NO_NODE);
 	if (!trie)
 		return ERR_PTR(-ENOMEM);
@@ -583,6 +723,17 @@ static struct bpf_map *trie_alloc(union bpf_attr *attr)
 
 	spin_lock_init(&trie->lock);
 
+	trie->stride_bits = attr->map_extra;
+	if (trie->stride_bits) {
+		trie->stride = bpf_map_area_alloc(sizeof(*trie->stride) <<
+						  trie->stride_bits,
+						  trie->map.numa_node);
+		if (!trie->stride) {
+			bpf_map_area_free(trie);
+			return ERR_PTR(-ENOMEM);
+		}
+	}
+
 	return &trie->map;
 }
 
@@ -622,6 +773,7 @@ static void trie_free(struct bpf_map *map)
 	}
 
 out:
+	bpf_map_area_free(trie->stride);
 	bpf_map_area_free(trie);
 }
 
@@ -740,7 +892,8 @@ static u64 trie_mem_usage(const struct bpf_map *map)
 
 	elem_size = sizeof(struct lpm_trie_node) + trie->data_size +
 			    trie->map.value_size;
-	return elem_size * READ_ONCE(trie->n_entries);
+	return elem_size * READ_ONCE(trie->n_entries) +
+	       ((u64)sizeof(*trie->stride) << trie->stride_bits);
 }
 
 BTF_ID_LIST_SINGLE(trie_map_btf_ids, struct, lpm_trie)
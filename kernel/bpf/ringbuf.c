@@ -12,7 +12,7 @@
 #include <uapi/linux/btf.h>
 #include <linux/btf_ids.h>
 
-#define RINGBUF_CREATE_FLAG_MASK (BPF_F_NUMA_NODE)
+#define RINGBUF_CREATE_FLAG_MASK (BPF_F_NUMA_NODE | BPF_F_RINGBUF_SHARDED)
 
 /* non-mmap()'able part of bpf_ringbuf (everything up to consumer page) */
 #define RINGBUF_PGOFF \
@@ -20,11 +20,16 @@
 /* consumer page and producer page */
 #define RINGBUF_POS_PAGES 2
 #define RINGBUF_NR_META_PAGES (RINGBUF_PGOFF + RINGBUF_POS_PAGES)
+/* mmap()'able pages of one ring: the position pages and twice the data */
+#define RINGBUF_MMAP_PAGES(data_sz) \
+	(RINGBUF_POS_PAGES + 2 * ((data_sz) >> PAGE_SHIFT))
 
 #define RINGBUF_MAX_RECORD_SZ (UINT_MAX/4)
 
 struct bpf_ringbuf {
 	wait_queue_head_t waitq;
+	/* waitq woken up by work, the first shard's for a sharded map */
+	wait_queue_head_t *notify_waitq;
 	struct irq_work work;
 	u64 mask;
 	struct page **pages;
@@ -78,6 +83,10 @@ struct bpf_ringbuf {
 struct bpf_ringbuf_map {
 	struct bpf_map map;
 	struct bpf_ringbuf *rb;
+	/* BPF_F_RINGBUF_SHARDED: one ring per possible CPU, indexed by CPU
+	 * id. rb points to the first one, which owns the poll waitq.
+	 */
+	struct bpf_ringbuf **shards;
 };
 
 /* 8-byte ring buffer record header structure */
@@ -151,7 +160,7 @@ static void bpf_ringbuf_notify(struct irq_work *work)
 {
 	struct bpf_ringbuf *rb = container_of(work, struct bpf_ringbuf, work);
 
-	wake_up_all(&rb->waitq);
+	wake_up_all(rb->notify_waitq);
 }
 
 /* Maximum size of ring buffer area is limited by 32-bit page offset within
@@ -176,6 +185,7 @@ static struct bpf_ringbuf *bpf_ringbuf_alloc(size_t data_sz, int numa_node)
 	spin_lock_init(&rb->spinlock);
 	atomic_set(&rb->busy, 0);
 	init_waitqueue_head(&rb->waitq);
+	rb->notify_waitq = &rb->waitq;
 	init_irq_work(&rb->work, bpf_ringbuf_notify);
 
 	rb->mask = data_sz - 1;
@@ -186,6 +196,58 @@ static struct bpf_ringbuf *bpf_ringbuf_alloc(size_t data_sz, int numa_node)
 	return rb;
 }
 
+static void bpf_ringbuf_free(struct bpf_ringbuf *rb);
+
+static void ringbuf_map_free_shards(struct bpf_ringbuf_map *rb_map)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		if (rb_map->shards[cpu])
+			bpf_ringbuf_free(rb_map->shards[cpu]);
+	bpf_map_area_free(rb_map->shards);
+}
+
+/* Sharded rings are placed on the node of their CPU, unless the map asked
+ * for a specific one. Producers only ever take the lock of the ring of the
+ * CPU they run on, so they do not contend with each other.
+ */
+static int ringbuf_map_alloc_shards(struct bpf_ringbuf_map *rb_map,
+				    size_t data_sz)
+{
+	int cpu, numa_node;
+
+	rb_map->shards = bpf_map_area_alloc(nr_cpu_ids * sizeof(*rb_map->shards),
+					    NUMA_NO_NODE);
+	if (!rb_map->shards)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		numa_node = rb_map->map.numa_node;
+		if (numa_node == NUMA_NO_NODE)
+			numa_node = cpu_to_node(cpu);
+		rb_map->shards[cpu] = bpf_ringbuf_alloc(data_sz, numa_node);
+		if (!rb_map->shards[cpu]) {
+			ringbuf_map_free_shards(rb_map);
+			return -ENOMEM;
+		}
+	}
+
+	rb_map->rb = rb_map->shards[cpumask_first(cpu_possible_mask)];
+	for_each_possible_cpu(cpu)
+		rb_map->shards[cpu]->notify_waitq = &rb_map->rb->waitq;
+
+	return 0;
+}
+
+/* Ring a BPF program running on this CPU produces into */
+static struct bpf_ringbuf *ringbuf_map_rb(struct bpf_ringbuf_map *rb_map)
+{
+	if (rb_map->shards)
+		return rb_map->shards[raw_smp_processor_id()];
+	return rb_map->rb;
+}
+
 static struct bpf_map *ringbuf_map_alloc(union bpf_attr *attr)
 {
 	struct bpf_ringbuf_map *rb_map;
@@ -193,6 +255,11 @@ static struct bpf_map *ringbuf_map_alloc(union bpf_attr *attr)
 	if (attr->map_flags & ~RINGBUF_CREATE_FLAG_MASK)
 		return ERR_PTR(-EINVAL);
 
+	/* only kernel producers benefit from per-CPU rings */
+	if ((attr->map_flags & BPF_F_RINGBUF_SHARDED) &&
+	    attr->map_type != BPF_MAP_TYPE_RINGBUF)
+		return ERR_PTR(-EINVAL);
+
 	if (attr->key_size || attr->value_size ||
 	    !is_power_of_2(attr->max_entries) ||
 	    !PAGE_ALIGNED(attr->max_entries))
@@ -204,6 +271,14 @@ static struct bpf_map *ringbuf_map_alloc(union bpf_attr *attr)
 
 	bpf_map_init_from_attr(&rb_map->map, attr);
 
+	if (attr->map_flags & BPF_F_RINGBUF_SHARDED) {
+		if (ringbuf_map_alloc_shards(rb_map, attr->max_entries)) {
+			bpf_map_area_free(rb_map);
+			return ERR_PTR(-ENOMEM);
+		}
+		return &rb_map->map;
+	}
+
 	rb_map->rb = bpf_ringbuf_alloc(attr->max_entries, rb_map->map.numa_node);
 	if (!rb_map->rb) {
 		bpf_map_area_free(rb_map);
@@ -232,7 +307,10 @@ static void ringbuf_map_free(struct bpf_map *map)
 	struct bpf_ringbuf_map *rb_map;
 
 	rb_map = container_of(map, struct bpf_ringbuf_map, map);
-	bpf_ringbuf_free(rb_map->rb);
+	if (rb_map->shards)
+		ringbuf_map_free_shards(rb_map);
+	else
+		bpf_ringbuf_free(rb_map->rb);
 	bpf_map_area_free(rb_map);
 }
 
@@ -261,19 +339,31 @@ static int ringbuf_map_get_next_key(struct bpf_map *map, void *key,
 static int ringbuf_map_mmap_kern(struct bpf_map *map, struct vm_area_struct *vma)
 {
 	struct bpf_ringbuf_map *rb_map;
+	unsigned long pgoff = vma->vm_pgoff;
+	struct bpf_ringbuf *rb;
 
 	rb_map = container_of(map, struct bpf_ringbuf_map, map);
+	rb = rb_map->rb;
+
+	if (rb_map->shards) {
+		unsigned long span = RINGBUF_MMAP_PAGES(map->max_entries);
+		unsigned long cpu = pgoff / span;
+
+		if (cpu >= nr_cpu_ids || !cpu_possible(cpu))
+			return -EINVAL;
+		rb = rb_map->shards[cpu];
+		pgoff %= span;
+	}
 
 	if (vma->vm_flags & VM_WRITE) {
 		/* allow writable mapping for the consumer_pos only */
-		if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start != PAGE_SIZE)
+		if (pgoff != 0 || vma->vm_end - vma->vm_start != PAGE_SIZE)
 			return -EPERM;
 	} else {
 		vm_flags_clear(vma, VM_MAYWRITE);
 	}
 	/* remap_vmalloc_range() checks size and offset constraints */
-	return remap_vmalloc_range(vma, rb_map->rb,
-				   vma->vm_pgoff + RINGBUF_PGOFF);
+	return remap_vmalloc_range(vma, rb, pgoff + RINGBUF_PGOFF);
 }
 
 static int ringbuf_map_mmap_user(struct bpf_map *map, struct vm_area_struct *vma)
@@ -318,6 +408,15 @@ static __poll_t ringbuf_map_poll_kern(struct bpf_map *map, struct file *filp,
 	rb_map = container_of(map, struct bpf_ringbuf_map, map);
 	poll_wait(filp, &rb_map->rb->waitq, pts);
 
+	if (rb_map->shards) {
+		int cpu;
+
+		for_each_possible_cpu(cpu)
+			if (ringbuf_avail_data_sz(rb_map->shards[cpu]))
+				return EPOLLIN | EPOLLRDNORM;
+		return 0;
+	}
+
 	if (ringbuf_avail_data_sz(rb_map->rb))
 		return EPOLLIN | EPOLLRDNORM;
 	return 0;
@@ -342,12 +441,18 @@ static u64 ringbuf_map_mem_usage(const struct bpf_map *map)
 	int nr_data_pages;
 	int nr_meta_pages;
 	u64 usage = sizeof(struct bpf_ringbuf_map);
+	u64 nr_rings = 1;
 
 	rb = container_of(map, struct bpf_ringbuf_map, map)->rb;
-	usage += (u64)rb->nr_pages << PAGE_SHIFT;
+	if (map->map_flags & BPF_F_RINGBUF_SHARDED) {
+		nr_rings = num_possible_cpus();
+		usage += nr_cpu_ids * sizeof(struct bpf_ringbuf *);
+	}
 	nr_meta_pages = RINGBUF_NR_META_PAGES;
 	nr_data_pages = map->max_entries >> PAGE_SHIFT;
-	usage += (nr_meta_pages + 2 * nr_data_pages) * sizeof(struct page *);
+	usage += nr_rings * ((u64)rb->nr_pages << PAGE_SHIFT);
+	usage += nr_rings * (nr_meta_pages + 2 * nr_data_pages) *
+		 sizeof(struct page *);
 	return usage;
 }
 
@@ -475,7 +580,7 @@ BPF_CALL_3(bpf_ringbuf_reserve, struct bpf_map *, map, u64, size, u64, flags)
 		return 0;
 
 	rb_map = container_of(map, struct bpf_ringbuf_map, map);
-	return (unsigned long)__bpf_ringbuf_reserve(rb_map->rb, size);
+	return (unsigned long)__bpf_ringbuf_reserve(ringbuf_map_rb(rb_map), size);
 }
 
 const struct bpf_func_proto bpf_ringbuf_reserve_proto = {
@@ -550,7 +655,7 @@ BPF_CALL_4(bpf_ringbuf_output, struct bpf_map *, map, void *, data, u64, size,
 		return -EINVAL;
 
 	rb_map = container_of(map, struct bpf_ringbuf_map, map);
-	rec = __bpf_ringbuf_reserve(rb_map->rb, size);
+	rec = __bpf_ringbuf_reserve(ringbuf_map_rb(rb_map), size);
 	if (!rec)
 		return -EAGAIN;
 
@@ -572,7 +677,8 @@ BPF_CALL_2(bpf_ringbuf_query, struct bpf_map *, map, u64, flags)
 {
 	struct bpf_ringbuf *rb;
 
-	rb = container_of(map, struct bpf_ringbuf_map, map)->rb;
+	/* a sharded map reports the ring of the current CPU */
+	rb = ringbuf_map_rb(container_of(map, struct bpf_ringbuf_map, map));
 
 	switch (flags) {
 	case BPF_RB_AVAIL_DATA:
@@ -615,7 +721,7 @@ BPF_CALL_4(bpf_ringbuf_reserve_dynptr, struct bpf_map *, map, u32, size, u64, fl
 
 	rb_map = container_of(map, struct bpf_ringbuf_map, map);
 
-	sample = __bpf_ringbuf_reserve(rb_map->rb, size);
+	sample = __bpf_ringbuf_reserve(ringbuf_map_rb(rb_map), size);
 	if (!sample) {
 		bpf_dynptr_set_null(ptr);
 		return -EINVAL;
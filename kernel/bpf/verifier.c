@@ -16561,21 +16561,20 @@ static bool check_ids(u32 old_id, u32 cur_id, struct bpf_idmap *idmap)
 	if (old_id == 0) /* cur_id == 0 as well */
 		return true;
 
-	for (i = 0; i < BPF_ID_MAP_SIZE; i++) {
-		if (!map[i].old) {
-			/* Reached an empty slot; haven't seen this id before */
-			map[i].old = old_id;
-			map[i].cur = cur_id;
-			return true;
-		}
+	for (i = 0; i < idmap->cnt; i++) {
 		if (map[i].old == old_id)
 			return map[i].cur == cur_id;
 		if (map[i].cur == cur_id)
 			return false;
 	}
 	/* We ran out of idmap slots, which should be impossible */
-	WARN_ON_ONCE(1);
-	return false;
+	if (WARN_ON_ONCE(i == BPF_ID_MAP_SIZE))
+		return false;
+	/* Haven't seen this id before */
+	map[i].old = old_id;
+	map[i].cur = cur_id;
+	idmap->cnt++;
+	return true;
 }
 
 /* Similar to check_ids(), but allocate a unique temporary ID
@@ -17049,8 +17048,9 @@ static bool func_states_equal(struct bpf_verifier_env *env, struct bpf_func_stat
 
 static void reset_idmap_scratch(struct bpf_verifier_env *env)
 {
+	/* check_ids() only looks at the first cnt entries, no need to clear */
 	env->idmap_scratch.tmp_id_gen = env->id_gen;
-	memset(&env->idmap_scratch.map, 0, sizeof(env->idmap_scratch.map));
+	env->idmap_scratch.cnt = 0;
 }
 
 static bool states_equal(struct bpf_verifier_env *env,
@@ -17060,11 +17060,11 @@ static bool states_equal(struct bpf_verifier_env *env,
 {
 	int i;
 
+	env->states_compared++;
+
 	if (old->curframe != cur->curframe)
 		return false;
 
-	reset_idmap_scratch(env);
-
 	/* Verification state from speculative execution simulation
 	 * must never prune a non-speculative execution one.
 	 */
@@ -17080,10 +17080,6 @@ static bool states_equal(struct bpf_verifier_env *env,
 	if (!!old->active_lock.id != !!cur->active_lock.id)
 		return false;
 
-	if (old->active_lock.id &&
-	    !check_ids(old->active_lock.id, cur->active_lock.id, &env->idmap_scratch))
-		return false;
-
 	if (old->active_rcu_lock != cur->active_rcu_lock)
 		return false;
 
@@ -17093,12 +17089,26 @@ static bool states_equal(struct bpf_verifier_env *env,
 	if (old->in_sleepable != cur->in_sleepable)
 		return false;
 
-	/* for states to be equal callsites have to be the same
-	 * and all frame states need to be equivalent
+	/* for states to be equal callsites have to be the same.
+	 * Check all frames before walking any registers and stack slots,
+	 * most states at a prune point differ in their call chain or
+	 * callback depth and can be rejected cheaply.
 	 */
 	for (i = 0; i <= old->curframe; i++) {
 		if (old->frame[i]->callsite != cur->frame[i]->callsite)
 			return false;
+		if (old->frame[i]->callback_depth > cur->frame[i]->callback_depth)
+			return false;
+	}
+
+	reset_idmap_scratch(env);
+
+	if (old->active_lock.id &&
+	    !check_ids(old->active_lock.id, cur->active_lock.id, &env->idmap_scratch))
+		return false;
+
+	/* and all frame states need to be equivalent */
+	for (i = 0; i <= old->curframe; i++) {
 		if (!func_states_equal(env, old->frame[i], cur->frame[i], exact))
 			return false;
 	}
@@ -17536,6 +17546,7 @@ static int is_state_visited(struct bpf_verifier_env *env, int insn_idx)
 				update_loop_entry(cur, loop_entry);
 hit:
 			sl->hit_cnt++;
+			env->prune_hits++;
 			/* reached equivalent register/stack state,
 			 * prune the search.
 			 * Registers read by the continuation are read by us.
@@ -21007,6 +21018,11 @@ static void print_verification_stats(struct bpf_verifier_env *env)
 	if (env->log.level & BPF_LOG_STATS) {
 		verbose(env, "verification time %lld usec\n",
 			div_u64(env->verification_time, 1000));
+		verbose(env, "cfg time %lld usec check time %lld usec\n",
+			div_u64(env->cfg_time, 1000),
+			div_u64(env->check_time, 1000));
+		verbose(env, "states compared %u prune hits %u\n",
+			env->states_compared, env->prune_hits);
 		verbose(env, "stack depth ");
 		for (i = 0; i < env->subprog_cnt; i++) {
 			u32 depth = env->subprog_info[i].stack_depth;
@@ -21551,7 +21567,7 @@ struct btf *bpf_get_btf_vmlinux(void)
 
 int bpf_check(struct bpf_prog **prog, union bpf_attr *attr, bpfptr_t uattr, __u32 uattr_size)
 {
-	u64 start_time = ktime_get_ns();
+	u64 start_time = ktime_get_ns(), phase_start;
 	struct bpf_verifier_env *env;
 	int i, len, ret = -EINVAL, err;
 	u32 log_true_size;
@@ -21659,12 +21675,16 @@ int bpf_check(struct bpf_prog **prog, union bpf_attr *attr, bpfptr_t uattr, __u3
 			goto skip_full_check;
 	}
 
+	phase_start = ktime_get_ns();
 	ret = check_cfg(env);
+	env->cfg_time = ktime_get_ns() - phase_start;
 	if (ret < 0)
 		goto skip_full_check;
 
+	phase_start = ktime_get_ns();
 	ret = do_check_main(env);
 	ret = ret ?: do_check_subprogs(env);
+	env->check_time = ktime_get_ns() - phase_start;
 
 	if (ret == 0 && bpf_prog_is_offloaded(env->prog->aux))
 		ret = bpf_prog_offload_finalize(env);
@@ -21713,6 +21733,9 @@ int bpf_check(struct bpf_prog **prog, union bpf_attr *attr, bpfptr_t uattr, __u3
 	env->verification_time = ktime_get_ns() - start_time;
 	print_verification_stats(env);
 	env->prog->aux->verified_insns = env->insn_processed;
+	env->prog->aux->verified_states = env->total_states;
+	env->prog->aux->verifier_prune_hits = env->prune_hits;
+	env->prog->aux->verification_time = env->verification_time;
 
 	/* preserve original error even if log finalization is successful */
 	err = bpf_vlog_finalize(&env->log, &log_true_size);
@@ -270,6 +270,8 @@ int cgroup_task_count(const struct cgroup *cgrp);
 int cgroup_rstat_init(struct cgroup *cgrp);
 void cgroup_rstat_exit(struct cgroup *cgrp);
 void cgroup_rstat_boot(void);
+void cgroup_rstat_init_subsys(struct cgroup_subsys *ss);
+void cgroup_rstat_stat_show(struct seq_file *seq, struct cgroup *cgrp);
 void cgroup_base_stat_cputime_show(struct seq_file *seq);
 
 /*
@@ -3659,6 +3659,7 @@ static int cgroup_stat_show(struct seq_file *seq, void *v)
 		   cgroup->nr_descendants);
 	seq_printf(seq, "nr_dying_descendants %d\n",
 		   cgroup->nr_dying_descendants);
+	cgroup_rstat_stat_show(seq, cgroup);
 
 	return 0;
 }
@@ -5411,7 +5412,7 @@ static void css_release_work_fn(struct work_struct *work)
 	if (ss) {
 		/* css release path */
 		if (!list_empty(&css->rstat_css_node)) {
-			cgroup_rstat_flush(cgrp);
+			css_rstat_flush(css);
 			list_del_rcu(&css->rstat_css_node);
 		}
 
@@ -5425,6 +5426,7 @@ static void css_release_work_fn(struct work_struct *work)
 		TRACE_CGROUP_PATH(release, cgrp);
 
 		cgroup_rstat_flush(cgrp);
+		psi_cgroup_release(cgrp);
 
 		spin_lock_irq(&css_set_lock);
 		for (tcgrp = cgroup_parent(cgrp); tcgrp;
@@ -5986,6 +5988,7 @@ static void __init cgroup_init_subsys(struct cgroup_subsys *ss, bool early)
 
 	idr_init(&ss->css_idr);
 	INIT_LIST_HEAD(&ss->cfts);
+	cgroup_rstat_init_subsys(ss);
 
 	/* Create the root cgroup state for this subsystem */
 	ss->root = &cgrp_dfl_root;
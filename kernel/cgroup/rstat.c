@@ -9,8 +9,19 @@
 
 #include <trace/events/cgroup.h>
 
-static DEFINE_SPINLOCK(cgroup_rstat_lock);
-static DEFINE_PER_CPU(raw_spinlock_t, cgroup_rstat_cpu_lock);
+/*
+ * Each rstat tree has its own locks, so that e.g. flushing memcg stats
+ * doesn't wait for blkcg flushers and the other way round.
+ */
+static spinlock_t cgroup_rstat_lock[CGROUP_RSTAT_NR_TREES] = {
+	[0 ... CGROUP_RSTAT_NR_TREES - 1] =
+		__SPIN_LOCK_UNLOCKED(cgroup_rstat_lock),
+};
+static DEFINE_PER_CPU(raw_spinlock_t [CGROUP_RSTAT_NR_TREES],
+		      cgroup_rstat_cpu_lock);
+
+/* next rstat tree to hand out to a controller, see cgroup_rstat_init_subsys() */
+static int cgroup_rstat_next_tree __initdata = CGROUP_RSTAT_BASE_TREE + 1;
 
 static void cgroup_base_stat_flush(struct cgroup *cgrp, int cpu);
 
@@ -73,18 +84,9 @@ void _cgroup_rstat_cpu_unlock(raw_spinlock_t *cpu_lock, int cpu,
 	raw_spin_unlock_irqrestore(cpu_lock, flags);
 }
 
-/**
- * cgroup_rstat_updated - keep track of updated rstat_cpu
- * @cgrp: target cgroup
- * @cpu: cpu on which rstat_cpu was updated
- *
- * @cgrp's rstat_cpu on @cpu was updated.  Put it on the parent's matching
- * rstat_cpu->updated_children list.  See the comment on top of
- * cgroup_rstat_cpu definition for details.
- */
-__bpf_kfunc void cgroup_rstat_updated(struct cgroup *cgrp, int cpu)
+static void __cgroup_rstat_updated(struct cgroup *cgrp, int cpu, int tree)
 {
-	raw_spinlock_t *cpu_lock = per_cpu_ptr(&cgroup_rstat_cpu_lock, cpu);
+	raw_spinlock_t *cpu_lock = per_cpu_ptr(&cgroup_rstat_cpu_lock[tree], cpu);
 	unsigned long flags;
 
 	/*
@@ -95,7 +97,7 @@ __bpf_kfunc void cgroup_rstat_updated(struct cgroup *cgrp, int cpu)
 	 * instead of NULL, we can tell whether @cgrp is on the list by
 	 * testing the next pointer for NULL.
 	 */
-	if (data_race(cgroup_rstat_cpu(cgrp, cpu)->updated_next))
+	if (data_race(cgroup_rstat_cpu(cgrp, cpu)->updated_next[tree]))
 		return;
 
 	flags = _cgroup_rstat_cpu_lock(cpu_lock, cpu, cgrp, true);
@@ -110,18 +112,18 @@ __bpf_kfunc void cgroup_rstat_updated(struct cgroup *cgrp, int cpu)
 		 * Both additions and removals are bottom-up.  If a cgroup
 		 * is already in the tree, all ancestors are.
 		 */
-		if (rstatc->updated_next)
+		if (rstatc->updated_next[tree])
 			break;
 
 		/* Root has no parent to link it to, but mark it busy */
 		if (!parent) {
-			rstatc->updated_next = cgrp;
+			rstatc->updated_next[tree] = cgrp;
 			break;
 		}
 
 		prstatc = cgroup_rstat_cpu(parent, cpu);
-		rstatc->updated_next = prstatc->updated_children;
-		prstatc->updated_children = cgrp;
+		rstatc->updated_next[tree] = prstatc->updated_children[tree];
+		prstatc->updated_children[tree] = cgrp;
 
 		cgrp = parent;
 	}
@@ -129,6 +131,33 @@ __bpf_kfunc void cgroup_rstat_updated(struct cgroup *cgrp, int cpu)
 	_cgroup_rstat_cpu_unlock(cpu_lock, cpu, cgrp, flags, true);
 }
 
+/**
+ * cgroup_rstat_updated - keep track of updated rstat_cpu
+ * @cgrp: target cgroup
+ * @cpu: cpu on which rstat_cpu was updated
+ *
+ * @cgrp's rstat_cpu on @cpu was updated.  Put it on the parent's matching
+ * rstat_cpu->updated_children list of the base tree.  See the comment on
+ * top of cgroup_rstat_cpu definition for details.
+ */
+__bpf_kfunc void cgroup_rstat_updated(struct cgroup *cgrp, int cpu)
+{
+	__cgroup_rstat_updated(cgrp, cpu, CGROUP_RSTAT_BASE_TREE);
+}
+
+/**
+ * css_rstat_updated - keep track of updated controller stats
+ * @css: target css
+ * @cpu: cpu on which the stats of @css were updated
+ *
+ * Like cgroup_rstat_updated(), but only puts the cgroup on the rstat tree
+ * of @css's controller, which css_rstat_flush() walks.
+ */
+void css_rstat_updated(struct cgroup_subsys_state *css, int cpu)
+{
+	__cgroup_rstat_updated(css->cgroup, cpu, css->ss->rstat_tree);
+}
+
 /**
  * cgroup_rstat_push_children - push children cgroups into the given list
  * @head: current head of the list (= subtree root)
@@ -142,35 +171,36 @@ __bpf_kfunc void cgroup_rstat_updated(struct cgroup *cgrp, int cpu)
  * cgroups into a stack. The root is pushed by the caller.
  */
 static struct cgroup *cgroup_rstat_push_children(struct cgroup *head,
-						 struct cgroup *child, int cpu)
+						 struct cgroup *child, int cpu,
+						 int tree)
 {
 	struct cgroup *chead = child;	/* Head of child cgroup level */
 	struct cgroup *ghead = NULL;	/* Head of grandchild cgroup level */
 	struct cgroup *parent, *grandchild;
 	struct cgroup_rstat_cpu *crstatc;
 
-	child->rstat_flush_next = NULL;
+	child->rstat_flush_next[tree] = NULL;
 
 next_level:
 	while (chead) {
 		child = chead;
-		chead = child->rstat_flush_next;
+		chead = child->rstat_flush_next[tree];
 		parent = cgroup_parent(child);
 
 		/* updated_next is parent cgroup terminated */
 		while (child != parent) {
-			child->rstat_flush_next = head;
+			child->rstat_flush_next[tree] = head;
 			head = child;
 			crstatc = cgroup_rstat_cpu(child, cpu);
-			grandchild = crstatc->updated_children;
+			grandchild = crstatc->updated_children[tree];
 			if (grandchild != child) {
 				/* Push the grand child to the next level */
-				crstatc->updated_children = child;
-				grandchild->rstat_flush_next = ghead;
+				crstatc->updated_children[tree] = child;
+				grandchild->rstat_flush_next[tree] = ghead;
 				ghead = grandchild;
 			}
-			child = crstatc->updated_next;
-			crstatc->updated_next = NULL;
+			child = crstatc->updated_next[tree];
+			crstatc->updated_next[tree] = NULL;
 		}
 	}
 
@@ -200,9 +230,10 @@ static struct cgroup *cgroup_rstat_push_children(struct cgroup *head,
  * within the children list and terminated by the parent cgroup. An exception
  * here is the cgroup root whose updated_next can be self terminated.
  */
-static struct cgroup *cgroup_rstat_updated_list(struct cgroup *root, int cpu)
+static struct cgroup *cgroup_rstat_updated_list(struct cgroup *root, int cpu,
+						int tree)
 {
-	raw_spinlock_t *cpu_lock = per_cpu_ptr(&cgroup_rstat_cpu_lock, cpu);
+	raw_spinlock_t *cpu_lock = per_cpu_ptr(&cgroup_rstat_cpu_lock[tree], cpu);
 	struct cgroup_rstat_cpu *rstatc = cgroup_rstat_cpu(root, cpu);
 	struct cgroup *head = NULL, *parent, *child;
 	unsigned long flags;
@@ -210,7 +241,7 @@ static struct cgroup *cgroup_rstat_updated_list(struct cgroup *root, int cpu)
 	flags = _cgroup_rstat_cpu_lock(cpu_lock, cpu, root, false);
 
 	/* Return NULL if this subtree is not on-list */
-	if (!rstatc->updated_next)
+	if (!rstatc->updated_next[tree])
 		goto unlock_ret;
 
 	/*
@@ -223,26 +254,26 @@ static struct cgroup *cgroup_rstat_updated_list(struct cgroup *root, int cpu)
 		struct cgroup **nextp;
 
 		prstatc = cgroup_rstat_cpu(parent, cpu);
-		nextp = &prstatc->updated_children;
+		nextp = &prstatc->updated_children[tree];
 		while (*nextp != root) {
 			struct cgroup_rstat_cpu *nrstatc;
 
 			nrstatc = cgroup_rstat_cpu(*nextp, cpu);
 			WARN_ON_ONCE(*nextp == parent);
-			nextp = &nrstatc->updated_next;
+			nextp = &nrstatc->updated_next[tree];
 		}
-		*nextp = rstatc->updated_next;
+		*nextp = rstatc->updated_next[tree];
 	}
 
-	rstatc->updated_next = NULL;
+	rstatc->updated_next[tree] = NULL;
 
 	/* Push @root to the list first before pushing the children */
 	head = root;
-	root->rstat_flush_next = NULL;
-	child = rstatc->updated_children;
-	rstatc->updated_children = root;
+	root->rstat_flush_next[tree] = NULL;
+	child = rstatc->updated_children[tree];
+	rstatc->updated_children[tree] = root;
 	if (child != root)
-		head = cgroup_rstat_push_children(head, child, cpu);
+		head = cgroup_rstat_push_children(head, child, cpu, tree);
 unlock_ret:
 	_cgroup_rstat_cpu_unlock(cpu_lock, cpu, root, flags, false);
 	return head;
@@ -279,60 +310,102 @@ __bpf_hook_end();
  * value -1 is used when obtaining the main lock else this is the CPU
  * number processed last.
  */
-static inline void __cgroup_rstat_lock(struct cgroup *cgrp, int cpu_in_loop)
-	__acquires(&cgroup_rstat_lock)
+static inline void __cgroup_rstat_lock(struct cgroup *cgrp, int cpu_in_loop,
+				       int tree)
+	__acquires(&cgroup_rstat_lock[tree])
 {
 	bool contended;
 
-	contended = !spin_trylock_irq(&cgroup_rstat_lock);
+	contended = !spin_trylock_irq(&cgroup_rstat_lock[tree]);
 	if (contended) {
 		trace_cgroup_rstat_lock_contended(cgrp, cpu_in_loop, contended);
-		spin_lock_irq(&cgroup_rstat_lock);
+		spin_lock_irq(&cgroup_rstat_lock[tree]);
 	}
 	trace_cgroup_rstat_locked(cgrp, cpu_in_loop, contended);
 }
 
-static inline void __cgroup_rstat_unlock(struct cgroup *cgrp, int cpu_in_loop)
-	__releases(&cgroup_rstat_lock)
+static inline void __cgroup_rstat_unlock(struct cgroup *cgrp, int cpu_in_loop,
+					 int tree)
+	__releases(&cgroup_rstat_lock[tree])
 {
 	trace_cgroup_rstat_unlock(cgrp, cpu_in_loop, false);
-	spin_unlock_irq(&cgroup_rstat_lock);
+	spin_unlock_irq(&cgroup_rstat_lock[tree]);
 }
 
 /* see cgroup_rstat_flush() */
-static void cgroup_rstat_flush_locked(struct cgroup *cgrp)
-	__releases(&cgroup_rstat_lock) __acquires(&cgroup_rstat_lock)
+static void cgroup_rstat_flush_locked(struct cgroup *cgrp, int tree)
+	__releases(&cgroup_rstat_lock[tree]) __acquires(&cgroup_rstat_lock[tree])
 {
 	int cpu;
 
-	lockdep_assert_held(&cgroup_rstat_lock);
+	lockdep_assert_held(&cgroup_rstat_lock[tree]);
 
 	for_each_possible_cpu(cpu) {
-		struct cgroup *pos = cgroup_rstat_updated_list(cgrp, cpu);
+		struct cgroup *pos = cgroup_rstat_updated_list(cgrp, cpu, tree);
 
-		for (; pos; pos = pos->rstat_flush_next) {
+		for (; pos; pos = pos->rstat_flush_next[tree]) {
 			struct cgroup_subsys_state *css;
 
-			cgroup_base_stat_flush(pos, cpu);
-			bpf_rstat_flush(pos, cgroup_parent(pos), cpu);
+			if (tree == CGROUP_RSTAT_BASE_TREE) {
+				cgroup_base_stat_flush(pos, cpu);
+				bpf_rstat_flush(pos, cgroup_parent(pos), cpu);
+			}
 
 			rcu_read_lock();
 			list_for_each_entry_rcu(css, &pos->rstat_css_list,
 						rstat_css_node)
-				css->ss->css_rstat_flush(css, cpu);
+				if (css->ss->rstat_tree == tree)
+					css->ss->css_rstat_flush(css, cpu);
 			rcu_read_unlock();
 		}
 
 		/* play nice and yield if necessary */
-		if (need_resched() || spin_needbreak(&cgroup_rstat_lock)) {
-			__cgroup_rstat_unlock(cgrp, cpu);
+		if (need_resched() || spin_needbreak(&cgroup_rstat_lock[tree])) {
+			__cgroup_rstat_unlock(cgrp, cpu, tree);
 			if (!cond_resched())
 				cpu_relax();
-			__cgroup_rstat_lock(cgrp, cpu);
+			__cgroup_rstat_lock(cgrp, cpu, tree);
 		}
 	}
 }
 
+/*
+ * Whether @cgrp's subtree may have stats to flush on @tree.  If @cgrp isn't
+ * on any CPU's updated tree and nobody is flushing, there is nothing to
+ * collect and the flush can be skipped without taking cgroup_rstat_lock.
+ */
+static bool cgroup_rstat_need_flush(struct cgroup *cgrp, int tree)
+{
+	int cpu;
+
+	if (spin_is_locked(&cgroup_rstat_lock[tree]))
+		return true;
+
+	for_each_possible_cpu(cpu)
+		if (data_race(cgroup_rstat_cpu(cgrp, cpu)->updated_next[tree]))
+			return true;
+
+	return false;
+}
+
+static void __cgroup_rstat_flush(struct cgroup *cgrp, int tree)
+{
+	u64 start;
+
+	if (!cgroup_rstat_need_flush(cgrp, tree)) {
+		atomic64_inc(&cgrp->rstat_flush_skips);
+		return;
+	}
+
+	start = ktime_get_ns();
+	__cgroup_rstat_lock(cgrp, -1, tree);
+	cgroup_rstat_flush_locked(cgrp, tree);
+	__cgroup_rstat_unlock(cgrp, -1, tree);
+
+	atomic64_inc(&cgrp->rstat_flushes);
+	atomic64_add(ktime_get_ns() - start, &cgrp->rstat_flush_ns);
+}
+
 /**
  * cgroup_rstat_flush - flush stats in @cgrp's subtree
  * @cgrp: target cgroup
@@ -348,11 +421,28 @@ static void cgroup_rstat_flush_locked(struct cgroup *cgrp)
  */
 __bpf_kfunc void cgroup_rstat_flush(struct cgroup *cgrp)
 {
+	int tree;
+
 	might_sleep();
 
-	__cgroup_rstat_lock(cgrp, -1);
-	cgroup_rstat_flush_locked(cgrp);
-	__cgroup_rstat_unlock(cgrp, -1);
+	for (tree = 0; tree < CGROUP_RSTAT_NR_TREES; tree++)
+		__cgroup_rstat_flush(cgrp, tree);
+}
+
+/**
+ * css_rstat_flush - flush the controller stats in @css's subtree
+ * @css: target css
+ *
+ * Like cgroup_rstat_flush(), but only flushes the rstat tree of @css's
+ * controller, without waiting for flushers of the other trees.
+ *
+ * This function may block.
+ */
+void css_rstat_flush(struct cgroup_subsys_state *css)
+{
+	might_sleep();
+
+	__cgroup_rstat_flush(css->cgroup, css->ss->rstat_tree);
 }
 
 /**
@@ -365,11 +455,11 @@ __bpf_kfunc void cgroup_rstat_flush(struct cgroup *cgrp)
  * This function may block.
  */
 void cgroup_rstat_flush_hold(struct cgroup *cgrp)
-	__acquires(&cgroup_rstat_lock)
+	__acquires(&cgroup_rstat_lock[CGROUP_RSTAT_BASE_TREE])
 {
 	might_sleep();
-	__cgroup_rstat_lock(cgrp, -1);
-	cgroup_rstat_flush_locked(cgrp);
+	__cgroup_rstat_lock(cgrp, -1, CGROUP_RSTAT_BASE_TREE);
+	cgroup_rstat_flush_locked(cgrp, CGROUP_RSTAT_BASE_TREE);
 }
 
 /**
@@ -377,14 +467,14 @@ void cgroup_rstat_flush_hold(struct cgroup *cgrp)
  * @cgrp: cgroup used by tracepoint
  */
 void cgroup_rstat_flush_release(struct cgroup *cgrp)
-	__releases(&cgroup_rstat_lock)
+	__releases(&cgroup_rstat_lock[CGROUP_RSTAT_BASE_TREE])
 {
-	__cgroup_rstat_unlock(cgrp, -1);
+	__cgroup_rstat_unlock(cgrp, -1, CGROUP_RSTAT_BASE_TREE);
 }
 
 int cgroup_rstat_init(struct cgroup *cgrp)
 {
-	int cpu;
+	int cpu, tree;
 
 	/* the root cgrp has rstat_cpu preallocated */
 	if (!cgrp->rstat_cpu) {
@@ -397,7 +487,8 @@ int cgroup_rstat_init(struct cgroup *cgrp)
 	for_each_possible_cpu(cpu) {
 		struct cgroup_rstat_cpu *rstatc = cgroup_rstat_cpu(cgrp, cpu);
 
-		rstatc->updated_children = cgrp;
+		for (tree = 0; tree < CGROUP_RSTAT_NR_TREES; tree++)
+			rstatc->updated_children[tree] = cgrp;
 		u64_stats_init(&rstatc->bsync);
 	}
 
@@ -406,7 +497,7 @@ int cgroup_rstat_init(struct cgroup *cgrp)
 
 void cgroup_rstat_exit(struct cgroup *cgrp)
 {
-	int cpu;
+	int cpu, tree;
 
 	cgroup_rstat_flush(cgrp);
 
@@ -414,9 +505,11 @@ void cgroup_rstat_exit(struct cgroup *cgrp)
 	for_each_possible_cpu(cpu) {
 		struct cgroup_rstat_cpu *rstatc = cgroup_rstat_cpu(cgrp, cpu);
 
-		if (WARN_ON_ONCE(rstatc->updated_children != cgrp) ||
-		    WARN_ON_ONCE(rstatc->updated_next))
-			return;
+		for (tree = 0; tree < CGROUP_RSTAT_NR_TREES; tree++) {
+			if (WARN_ON_ONCE(rstatc->updated_children[tree] != cgrp) ||
+			    WARN_ON_ONCE(rstatc->updated_next[tree]))
+				return;
+		}
 	}
 
 	free_percpu(cgrp->rstat_cpu);
@@ -425,10 +518,31 @@ void cgroup_rstat_exit(struct cgroup *cgrp)
 
 void __init cgroup_rstat_boot(void)
 {
-	int cpu;
+	int cpu, tree;
 
 	for_each_possible_cpu(cpu)
-		raw_spin_lock_init(per_cpu_ptr(&cgroup_rstat_cpu_lock, cpu));
+		for (tree = 0; tree < CGROUP_RSTAT_NR_TREES; tree++)
+			raw_spin_lock_init(per_cpu_ptr(&cgroup_rstat_cpu_lock[tree],
+						       cpu));
+}
+
+/* Give @ss its own rstat tree if one is left, see CGROUP_RSTAT_NR_TREES */
+void __init cgroup_rstat_init_subsys(struct cgroup_subsys *ss)
+{
+	if (ss->css_rstat_flush && cgroup_rstat_next_tree < CGROUP_RSTAT_NR_TREES)
+		ss->rstat_tree = cgroup_rstat_next_tree++;
+	else
+		ss->rstat_tree = CGROUP_RSTAT_BASE_TREE;
+}
+
+void cgroup_rstat_stat_show(struct seq_file *seq, struct cgroup *cgrp)
+{
+	seq_printf(seq, "rstat_flushes %lld\n",
+		   atomic64_read(&cgrp->rstat_flushes));
+	seq_printf(seq, "rstat_flush_skips %lld\n",
+		   atomic64_read(&cgrp->rstat_flush_skips));
+	seq_printf(seq, "rstat_flush_usec %lld\n",
+		   div_s64(atomic64_read(&cgrp->rstat_flush_ns), NSEC_PER_USEC));
 }
 
 /*
@@ -5237,6 +5237,7 @@ static void _free_event(struct perf_event *event)
 	perf_event_free_bpf_prog(event);
 	perf_addr_filters_splice(event, NULL);
 	kfree(event->addr_filter_ranges);
+	kvfree(event->addr_aggr);
 
 	if (event->destroy)
 		event->destroy(event);
@@ -5996,6 +5997,9 @@ static long _perf_ioctl(struct perf_event *event, unsigned int cmd, unsigned lon
 	case PERF_EVENT_IOC_QUERY_BPF:
 		return perf_event_query_prog_array(event, (void __user *)arg);
 
+	case PERF_EVENT_IOC_READ_ADDR_AGGR:
+		return perf_event_read_addr_aggr(event, (void __user *)arg);
+
 	case PERF_EVENT_IOC_MODIFY_ATTRIBUTES: {
 		struct perf_event_attr new_attr;
 		int err = perf_copy_attr((struct perf_event_attr __user *)arg,
@@ -7934,6 +7938,135 @@ perf_event_output(struct perf_event *event,
 	return __perf_event_output(event, data, regs, perf_output_begin);
 }
 
+/*
+ * In-kernel aggregation of sampled data addresses (attr.aggr_addr).
+ *
+ * Instead of writing every sample to the ring buffer, the overflow handler
+ * accounts it to the cacheline of PERF_SAMPLE_ADDR in a bounded, lock-free
+ * open-addressing table that userspace reads (and optionally resets) with
+ * PERF_EVENT_IOC_READ_ADDR_AGGR. Slots are claimed with cmpxchg() and
+ * never move; a sample whose cacheline isn't found within
+ * PERF_ADDR_AGGR_PROBES slots of its hash is counted as dropped.
+ */
+#define PERF_ADDR_AGGR_BITS	12
+#define PERF_ADDR_AGGR_SLOTS	(1U << PERF_ADDR_AGGR_BITS)
+#define PERF_ADDR_AGGR_PROBES	16
+
+struct perf_addr_aggr_slot {
+	unsigned long		key;	/* cacheline address | 1, 0 if free */
+	atomic64_t		samples;
+	atomic64_t		hitm;
+	atomic64_t		stores;
+};
+
+struct perf_addr_aggr {
+	atomic64_t			dropped;
+	struct perf_addr_aggr_slot	slots[PERF_ADDR_AGGR_SLOTS];
+};
+
+static void perf_event_addr_aggr_output(struct perf_event *event,
+					struct perf_sample_data *data,
+					struct pt_regs *regs)
+{
+	struct perf_addr_aggr *aggr = READ_ONCE(event->addr_aggr);
+	struct perf_addr_aggr_slot *slot;
+	unsigned long key, old;
+	unsigned int i, idx;
+
+	if (!aggr || !(data->sample_flags & PERF_SAMPLE_ADDR) || !data->addr)
+		return;
+
+	key = (data->addr & ~((unsigned long)L1_CACHE_BYTES - 1)) | 1;
+	idx = hash_long(key, PERF_ADDR_AGGR_BITS);
+
+	for (i = 0; i < PERF_ADDR_AGGR_PROBES; i++) {
+		slot = &aggr->slots[(idx + i) & (PERF_ADDR_AGGR_SLOTS - 1)];
+		old = READ_ONCE(slot->key);
+		if (!old)
+			old = cmpxchg(&slot->key, 0, key) ?: key;
+		if (old == key)
+			goto found;
+	}
+
+	atomic64_inc(&aggr->dropped);
+	return;
+
+found:
+	atomic64_inc(&slot->samples);
+	if (data->sample_flags & PERF_SAMPLE_DATA_SRC) {
+		if (data->data_src.mem_snoop & PERF_MEM_SNOOP_HITM)
+			atomic64_inc(&slot->hitm);
+		if (data->data_src.mem_op & PERF_MEM_OP_STORE)
+			atomic64_inc(&slot->stores);
+	}
+}
+
+static int perf_event_read_addr_aggr(struct perf_event *event,
+				     struct perf_addr_aggr_read __user *uread)
+{
+	struct perf_addr_aggr *aggr = event->addr_aggr;
+	struct perf_addr_aggr_entry __user *uentries;
+	struct perf_addr_aggr_read read;
+	struct perf_addr_aggr_entry entry;
+	bool reset;
+	u32 i, n = 0;
+
+	if (!aggr)
+		return -EINVAL;
+
+	if (copy_from_user(&read, uread, sizeof(read)))
+		return -EFAULT;
+
+	if (read.flags & ~PERF_ADDR_AGGR_RESET)
+		return -EINVAL;
+
+	reset = read.flags & PERF_ADDR_AGGR_RESET;
+	uentries = u64_to_user_ptr(read.entries);
+
+	for (i = 0; i < PERF_ADDR_AGGR_SLOTS && n < read.nr; i++) {
+		struct perf_addr_aggr_slot *slot = &aggr->slots[i];
+		unsigned long key = READ_ONCE(slot->key);
+
+		if (!key)
+			continue;
+
+		entry.addr = key & ~1UL;
+		if (reset) {
+			/*
+			 * Free the slot first so that the table doesn't fill
+			 * up with stale cachelines; samples racing with this
+			 * may still be accounted to the old line.
+			 */
+			WRITE_ONCE(slot->key, 0);
+			entry.samples = atomic64_xchg(&slot->samples, 0);
+			entry.hitm = atomic64_xchg(&slot->hitm, 0);
+			entry.stores = atomic64_xchg(&slot->stores, 0);
+		} else {
+			entry.samples = atomic64_read(&slot->samples);
+			entry.hitm = atomic64_read(&slot->hitm);
+			entry.stores = atomic64_read(&slot->stores);
+		}
+
+		if (!entry.samples)
+			continue;
+
+		if (copy_to_user(&uentries[n], &entry, sizeof(entry)))
+			return -EFAULT;
+		n++;
+	}
+
+	read.nr = n;
+	if (reset)
+		read.dropped = atomic64_xchg(&aggr->dropped, 0);
+	else
+		read.dropped = atomic64_read(&aggr->dropped);
+
+	if (copy_to_user(uread, &read, sizeof(read)))
+		return -EFAULT;
+
+	return 0;
+}
+
 /*
  * read event_id
  */
@@ -12013,6 +12146,9 @@ perf_event_alloc(struct perf_event_attr *attr, int cpu,
 	if (overflow_handler) {
 		event->overflow_handler	= overflow_handler;
 		event->overflow_handler_context = context;
+	} else if (attr->aggr_addr) {
+		event->overflow_handler = perf_event_addr_aggr_output;
+		event->overflow_handler_context = NULL;
 	} else if (is_write_backward(event)){
 		event->overflow_handler = perf_event_output_backward;
 		event->overflow_handler_context = NULL;
@@ -12110,15 +12246,26 @@ perf_event_alloc(struct perf_event_attr *attr, int cpu,
 		}
 	}
 
+	if (event->overflow_handler == perf_event_addr_aggr_output) {
+		event->addr_aggr = kvzalloc(sizeof(*event->addr_aggr),
+					    GFP_KERNEL);
+		if (!event->addr_aggr) {
+			err = -ENOMEM;
+			goto err_callchain_buffer;
+		}
+	}
+
 	err = security_perf_event_alloc(event);
 	if (err)
-		goto err_callchain_buffer;
+		goto err_addr_aggr;
 
 	/* symmetric to unaccount_event() in _free_event() */
 	account_event(event);
 
 	return event;
 
+err_addr_aggr:
+	kvfree(event->addr_aggr);
 err_callchain_buffer:
 	if (!event->parent) {
 		if (event->attr.sample_type & PERF_SAMPLE_CALLCHAIN)
@@ -12261,6 +12408,15 @@ static int perf_copy_attr(struct perf_event_attr __user *uattr,
 	if (attr->sigtrap && !attr->remove_on_exec)
 		return -EINVAL;
 
+	/*
+	 * Aggregation needs sampled data addresses, and only the parent
+	 * event's table can be read back.
+	 */
+	if (attr->aggr_addr &&
+	    (!attr->sample_period || attr->inherit ||
+	     !(attr->sample_type & PERF_SAMPLE_ADDR)))
+		return -EINVAL;
+
 out:
 	return ret;
 
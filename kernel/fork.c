@@ -1263,6 +1263,13 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p,
 	INIT_LIST_HEAD(&mm->mmlist);
 #ifdef CONFIG_PER_VMA_LOCK
 	mm->mm_lock_seq = 0;
+#endif
+#ifdef CONFIG_FUTEX
+	mm->futex_phash = NULL;
+#endif
+#ifdef CONFIG_SMP
+	mm->sched_llc_cpu = -1;
+	mm->sched_llc_votes = 0;
 #endif
 	mm_pgtables_bytes_init(mm);
 	mm->map_count = 0;
@@ -1291,6 +1298,7 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p,
 		mm->flags = default_dump_filter;
 		mm->def_flags = 0;
 	}
+	khugepaged_mm_init(mm, current->mm);
 
 	if (mm_alloc_pgd(mm))
 		goto fail_nopgd;
@@ -1354,6 +1362,7 @@ static inline void __mmput(struct mm_struct *mm)
 	if (mm->binfmt)
 		module_put(mm->binfmt->module);
 	lru_gen_del_mm(mm);
+	futex_hash_free(mm);
 	mmdrop(mm);
 }
 
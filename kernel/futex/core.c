@@ -38,21 +38,38 @@
 #include <linux/memblock.h>
 #include <linux/fault-inject.h>
 #include <linux/slab.h>
+#include <linux/prctl.h>
+#include <linux/nodemask.h>
 
 #include "futex.h"
 #include "../locking/rtmutex_common.h"
 
 /*
- * The base of the bucket array and its size are always used together
- * (after initialization only in futex_hash()), so ensure that they
- * reside in the same cacheline.
+ * The global hash is split into one table per node, each allocated on its
+ * node. The bucket mask and its shift are always used together with the
+ * tables (after initialization only in futex_hash()), so keep them first.
  */
 static struct {
-	struct futex_hash_bucket *queues;
-	unsigned long            hashsize;
+	unsigned long            hashmask;
+	unsigned int             hashshift;
+	struct futex_hash_bucket *queues[MAX_NUMNODES];
 } __futex_data __read_mostly __aligned(2*sizeof(long));
-#define futex_queues   (__futex_data.queues)
-#define futex_hashsize (__futex_data.hashsize)
+#define futex_hashmask  (__futex_data.hashmask)
+#define futex_hashshift (__futex_data.hashshift)
+#define futex_queues    (__futex_data.queues)
+
+/*
+ * A process can have its private futexes hashed into a table of its own,
+ * allocated on the node of the thread that asked for it. Set up while the
+ * process is still single threaded and then left alone until its mm goes
+ * away, so no futex can ever be queued in two different tables.
+ */
+struct futex_private_hash {
+	unsigned int			hash_mask;
+	struct futex_hash_bucket	queues[];
+};
+
+#define FUTEX_PRIVATE_HASH_MAX	(1U << 16)
 
 
 /*
@@ -106,19 +123,46 @@ late_initcall(fail_futex_debugfs);
 
 #endif /* CONFIG_FAIL_FUTEX */
 
+static inline struct futex_private_hash *futex_private_hash(union futex_key *key)
+{
+	if (key->both.offset & (FUT_OFF_INODE | FUT_OFF_MMSHARED))
+		return NULL;
+
+	if (!key->private.mm)
+		return NULL;
+
+	return READ_ONCE(key->private.mm->futex_phash);
+}
+
 /**
  * futex_hash - Return the hash bucket in the global hash
  * @key:	Pointer to the futex key for which the hash is calculated
  *
  * We hash on the keys returned from get_futex_key (see below) and return the
- * corresponding hash bucket in the global hash.
+ * corresponding hash bucket: in the process' own table for private futexes
+ * of a process that has one, in the table of the key's node for FUTEX2_NUMA
+ * futexes, and in a node picked by the hash otherwise.
  */
 struct futex_hash_bucket *futex_hash(union futex_key *key)
 {
 	u32 hash = jhash2((u32 *)key, offsetof(typeof(*key), both.offset) / 4,
 			  key->both.offset);
+	struct futex_private_hash *fph;
+	int node = key->both.node;
+
+	fph = futex_private_hash(key);
+	if (fph)
+		return &fph->queues[hash & fph->hash_mask];
+
+	if (node == FUTEX_NO_NODE) {
+		/* Spread over the nodes with the bits not used for the bucket. */
+		node = (hash >> futex_hashshift) % nr_node_ids;
+		if (!node_possible(node))
+			node = find_next_bit_wrap(node_possible_map.bits,
+						  nr_node_ids, node);
+	}
 
-	return &futex_queues[hash & (futex_hashsize - 1)];
+	return &futex_queues[node][hash & futex_hashmask];
 }
 
 
@@ -191,6 +235,46 @@ static u64 get_inode_sequence_number(struct inode *inode)
 	}
 }
 
+/*
+ * Read the node word of a FUTEX2_NUMA futex, claiming it for the current node
+ * if it is still FUTEX_NO_NODE. The cmpxchg makes all users agree on one node
+ * and thereby one hash bucket.
+ */
+static int futex_key_node(u32 __user *uaddr, unsigned int flags, int *node)
+{
+	u32 __user *naddr = (void __user *)uaddr + futex_size(flags);
+	u32 val, cur;
+	int ret;
+
+	if (get_user(val, naddr))
+		return -EFAULT;
+
+	while ((int)val == FUTEX_NO_NODE) {
+		u32 new = numa_node_id();
+
+		ret = futex_cmpxchg_value_locked(&cur, naddr, val, new);
+		if (ret == -EFAULT) {
+			if (fault_in_user_writeable(naddr))
+				return -EFAULT;
+			continue;
+		}
+		if (ret == -EAGAIN) {
+			cond_resched();
+			continue;
+		}
+		if (ret)
+			return ret;
+
+		val = cur == val ? new : cur;
+	}
+
+	if (val >= MAX_NUMNODES || !node_possible(val))
+		return -EINVAL;
+
+	*node = val;
+	return 0;
+}
+
 /**
  * get_futex_key() - Get parameters which are the keys for a futex
  * @uaddr:	virtual address of the futex
@@ -223,6 +307,7 @@ int get_futex_key(u32 __user *uaddr, unsigned int flags, union futex_key *key,
 {
 	unsigned long address = (unsigned long)uaddr;
 	struct mm_struct *mm = current->mm;
+	unsigned int size = futex_size(flags);
 	struct page *page;
 	struct folio *folio;
 	struct address_space *mapping;
@@ -231,20 +316,31 @@ int get_futex_key(u32 __user *uaddr, unsigned int flags, union futex_key *key,
 
 	fshared = flags & FLAGS_SHARED;
 
+	/* The node word follows the futex and is covered by the alignment. */
+	if (flags & FLAGS_NUMA)
+		size *= 2;
+
 	/*
 	 * The futex address must be "naturally" aligned.
 	 */
 	key->both.offset = address % PAGE_SIZE;
-	if (unlikely((address % sizeof(u32)) != 0))
+	if (unlikely((address % size) != 0))
 		return -EINVAL;
 	address -= key->both.offset;
 
-	if (unlikely(!access_ok(uaddr, sizeof(u32))))
+	if (unlikely(!access_ok(uaddr, size)))
 		return -EFAULT;
 
 	if (unlikely(should_fail_futex(fshared)))
 		return -EFAULT;
 
+	key->both.node = FUTEX_NO_NODE;
+	if (flags & FLAGS_NUMA) {
+		err = futex_key_node(uaddr, flags, &key->both.node);
+		if (err)
+			return err;
+	}
+
 	/*
 	 * PROCESS_PRIVATE futexes are fast.
 	 * As the mm cannot disappear under us and the 'key' only needs
@@ -1145,29 +1241,107 @@ void futex_exit_release(struct task_struct *tsk)
 	futex_cleanup_end(tsk, FUTEX_STATE_DEAD);
 }
 
-static int __init futex_init(void)
+static void futex_hash_bucket_init(struct futex_hash_bucket *hb)
+{
+	atomic_set(&hb->waiters, 0);
+	plist_head_init(&hb->chain);
+	spin_lock_init(&hb->lock);
+}
+
+static int futex_hash_allocate(unsigned long slots)
 {
-	unsigned int futex_shift;
+	struct mm_struct *mm = current->mm;
+	struct futex_private_hash *fph;
 	unsigned long i;
 
+	if (!IS_ENABLED(CONFIG_MMU) || !mm)
+		return -EINVAL;
+
+	if (slots < 2 || slots > FUTEX_PRIVATE_HASH_MAX || !is_power_of_2(slots))
+		return -EINVAL;
+
+	/*
+	 * Only while nobody else can be using the mm: futexes queued in the
+	 * global hash would never be found again otherwise.
+	 */
+	if (mm->futex_phash || atomic_read(&mm->mm_users) != 1)
+		return -EBUSY;
+
+	fph = kvzalloc_node(struct_size(fph, queues, slots), GFP_KERNEL_ACCOUNT,
+			    numa_node_id());
+	if (!fph)
+		return -ENOMEM;
+
+	fph->hash_mask = slots - 1;
+	for (i = 0; i < slots; i++)
+		futex_hash_bucket_init(&fph->queues[i]);
+
+	WRITE_ONCE(mm->futex_phash, fph);
+	return 0;
+}
+
+int futex_hash_prctl(unsigned long arg2, unsigned long arg3, unsigned long arg4)
+{
+	struct futex_private_hash *fph;
+
+	if (arg4)
+		return -EINVAL;
+
+	switch (arg2) {
+	case PR_FUTEX_HASH_SET_SLOTS:
+		return futex_hash_allocate(arg3);
+
+	case PR_FUTEX_HASH_GET_SLOTS:
+		if (arg3)
+			return -EINVAL;
+		fph = current->mm ? READ_ONCE(current->mm->futex_phash) : NULL;
+		return fph ? fph->hash_mask + 1 : 0;
+	}
+
+	return -EINVAL;
+}
+
+/* Called once the last user of @mm is gone, nothing can be queued anymore. */
+void futex_hash_free(struct mm_struct *mm)
+{
+	kvfree(mm->futex_phash);
+	mm->futex_phash = NULL;
+}
+
+static int __init futex_init(void)
+{
+	unsigned long hashsize, i;
+	int node;
+
 #ifdef CONFIG_BASE_SMALL
-	futex_hashsize = 16;
+	hashsize = 16;
 #else
-	futex_hashsize = roundup_pow_of_two(256 * num_possible_cpus());
+	hashsize = 256 * num_possible_cpus();
+	hashsize /= num_possible_nodes();
+	hashsize = roundup_pow_of_two(max(hashsize, 16UL));
 #endif
 
-	futex_queues = alloc_large_system_hash("futex", sizeof(*futex_queues),
-					       futex_hashsize, 0, 0,
-					       &futex_shift, NULL,
-					       futex_hashsize, futex_hashsize);
-	futex_hashsize = 1UL << futex_shift;
+	futex_hashmask = hashsize - 1;
+	futex_hashshift = ilog2(hashsize);
 
-	for (i = 0; i < futex_hashsize; i++) {
-		atomic_set(&futex_queues[i].waiters, 0);
-		plist_head_init(&futex_queues[i].chain);
-		spin_lock_init(&futex_queues[i].lock);
+	for_each_node(node) {
+		struct futex_hash_bucket *table;
+
+		table = kvcalloc_node(hashsize, sizeof(*table), GFP_KERNEL,
+				      node_state(node, N_MEMORY) ? node : NUMA_NO_NODE);
+		if (!table)
+			panic("futex: failed to allocate the hash table for node %d\n",
+			      node);
+
+		for (i = 0; i < hashsize; i++)
+			futex_hash_bucket_init(&table[i]);
+
+		futex_queues[node] = table;
 	}
 
+	pr_info("futex hash table entries: %lu (%u nodes)\n",
+		hashsize, num_possible_nodes());
+
 	return 0;
 }
 core_initcall(futex_init);
@@ -354,6 +354,72 @@ SYSCALL_DEFINE4(futex_wake,
 	return futex_wake(uaddr, FLAGS_STRICT | flags, nr, mask);
 }
 
+/*
+ * sys_futex_wakev - Wake waiters on a list of futexes
+ * @waiters:    List of futexes to wake
+ * @nr_futexes: Length of the list
+ * @flags:      unused
+ *
+ * Given an array of `struct futex_waitv`, wake up to @val waiters on each
+ * uaddr, with the per-entry FUTEX2 flags describing the futex. All woken tasks
+ * are collected on one wake_q and only woken once every hash bucket lock has
+ * been dropped, so a thread pool or condition variable broadcast costs one
+ * syscall and one burst of wakeups rather than one of each per futex.
+ *
+ * Returns the total number of woken waiters. If an entry is invalid, the
+ * entries before it have still been processed; the error is returned only if
+ * nothing was woken.
+ */
+
+SYSCALL_DEFINE3(futex_wakev,
+		struct futex_waitv __user *, waiters,
+		unsigned int, nr_futexes,
+		unsigned int, flags)
+{
+	struct futex_waitv aux;
+	DEFINE_WAKE_Q(wake_q);
+	unsigned int i;
+	int ret = 0, woken = 0;
+
+	if (flags)
+		return -EINVAL;
+
+	if (!nr_futexes || nr_futexes > FUTEX_WAITV_MAX || !waiters)
+		return -EINVAL;
+
+	for (i = 0; i < nr_futexes; i++) {
+		unsigned int fflags;
+
+		if (copy_from_user(&aux, &waiters[i], sizeof(aux))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		if ((aux.flags & ~FUTEX2_VALID_MASK) || aux.__reserved ||
+		    aux.val > INT_MAX) {
+			ret = -EINVAL;
+			break;
+		}
+
+		fflags = futex2_to_flags(aux.flags);
+		if (!futex_flags_valid(fflags)) {
+			ret = -EINVAL;
+			break;
+		}
+
+		ret = __futex_wake(u64_to_user_ptr(aux.uaddr),
+				   FLAGS_STRICT | fflags, aux.val,
+				   FUTEX_BITSET_MATCH_ANY, &wake_q);
+		if (ret < 0)
+			break;
+		woken += ret;
+	}
+
+	wake_up_q(&wake_q);
+
+	return woken ? woken : min(ret, 0);
+}
+
 /*
  * sys_futex_wait - Wait on a futex
  * @uaddr:	Address of the futex to wait on
@@ -150,14 +150,16 @@ void futex_wake_mark(struct wake_q_head *wake_q, struct futex_q *q)
 }
 
 /*
- * Wake up waiters matching bitset queued on this futex (uaddr).
+ * Mark up to @nr_wake waiters matching bitset queued on this futex (uaddr)
+ * for wakeup on @wake_q. The caller does the wake_up_q(), which lets several
+ * futexes be woken with a single pass over the collected tasks.
  */
-int futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
+int __futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake,
+		 u32 bitset, struct wake_q_head *wake_q)
 {
 	struct futex_hash_bucket *hb;
 	struct futex_q *this, *next;
 	union futex_key key = FUTEX_KEY_INIT;
-	DEFINE_WAKE_Q(wake_q);
 	int ret;
 
 	if (!bitset)
@@ -189,13 +191,25 @@ int futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 			if (!(this->bitset & bitset))
 				continue;
 
-			this->wake(&wake_q, this);
+			this->wake(wake_q, this);
 			if (++ret >= nr_wake)
 				break;
 		}
 	}
 
 	spin_unlock(&hb->lock);
+	return ret;
+}
+
+/*
+ * Wake up waiters matching bitset queued on this futex (uaddr).
+ */
+int futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
+{
+	DEFINE_WAKE_Q(wake_q);
+	int ret;
+
+	ret = __futex_wake(uaddr, flags, nr_wake, bitset, &wake_q);
 	wake_up_q(&wake_q);
 	return ret;
 }
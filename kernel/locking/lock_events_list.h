@@ -35,6 +35,16 @@ LOCK_EVENT(pv_wait_head)	/* # of vCPU wait's at the queue head	   */
 LOCK_EVENT(pv_wait_node)	/* # of vCPU wait's at non-head queue node */
 #endif /* CONFIG_PARAVIRT_SPINLOCKS */
 
+#ifdef CONFIG_NUMA_AWARE_SPINLOCKS
+/*
+ * Locking events for NUMA-aware (CNA) qspinlock.
+ */
+LOCK_EVENT(cna_intra_node)	/* # of handoffs keeping a secondary queue */
+LOCK_EVENT(cna_splice_next)	/* # of remote waiters moved to secondary  */
+LOCK_EVENT(cna_flush_threshold)	/* # of secondary flushes by fairness	   */
+LOCK_EVENT(cna_flush_empty)	/* # of secondary flushes by empty primary */
+#endif /* CONFIG_NUMA_AWARE_SPINLOCKS */
+
 /*
  * Locking events for qspinlock
  *
@@ -67,3 +77,11 @@ LOCK_EVENT(rwsem_rlock_handoff)	/* # of read lock handoffs		*/
 LOCK_EVENT(rwsem_wlock)		/* # of write locks acquired		*/
 LOCK_EVENT(rwsem_wlock_fail)	/* # of failed write lock acquisitions	*/
 LOCK_EVENT(rwsem_wlock_handoff)	/* # of write lock handoffs		*/
+
+/*
+ * Locking events for hybrid rwsem
+ */
+LOCK_EVENT(hrwsem_rlock_percpu)	/* # of read locks on per-CPU counts	*/
+LOCK_EVENT(hrwsem_rlock_shared)	/* # of read locks on the rwsem		*/
+LOCK_EVENT(hrwsem_to_percpu)	/* # of switches to per-CPU readers	*/
+LOCK_EVENT(hrwsem_to_shared)	/* # of switches back by a writer	*/
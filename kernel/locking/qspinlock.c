@@ -78,6 +78,9 @@
  * to have more than 2 levels of slowpath nesting in actual use. We don't
  * want to penalize pvqspinlocks to optimize for a rare case in native
  * qspinlocks.
+ *
+ * The NUMA-aware variant (CNA), which depends on PARAVIRT_SPINLOCKS, keeps
+ * its per-node state in the same padding.
  */
 struct qnode {
 	struct mcs_spinlock mcs;
@@ -276,6 +279,22 @@ static __always_inline u32  __pv_wait_head_or_lock(struct qspinlock *lock,
 						   struct mcs_spinlock *node)
 						   { return 0; }
 
+/*
+ * The MCS queue handoff steps, which the NUMA-aware slowpath replaces to
+ * keep remote waiters on a secondary queue.
+ */
+static __always_inline bool __try_clear_tail(struct qspinlock *lock, u32 val,
+					     struct mcs_spinlock *node)
+{
+	return atomic_try_cmpxchg_relaxed(&lock->val, &val, _Q_LOCKED_VAL);
+}
+
+static __always_inline void __mcs_lock_handoff(struct mcs_spinlock *node,
+					       struct mcs_spinlock *next)
+{
+	arch_mcs_spin_unlock_contended(&next->locked);
+}
+
 #define pv_enabled()		false
 
 #define pv_init_node		__pv_init_node
@@ -283,6 +302,9 @@ static __always_inline u32  __pv_wait_head_or_lock(struct qspinlock *lock,
 #define pv_kick_node		__pv_kick_node
 #define pv_wait_head_or_lock	__pv_wait_head_or_lock
 
+#define try_clear_tail		__try_clear_tail
+#define mcs_lock_handoff	__mcs_lock_handoff
+
 #ifdef CONFIG_PARAVIRT_SPINLOCKS
 #define queued_spin_lock_slowpath	native_queued_spin_lock_slowpath
 #endif
@@ -533,7 +555,7 @@ void __lockfunc queued_spin_lock_slowpath(struct qspinlock *lock, u32 val)
 	 *       PENDING will make the uncontended transition fail.
 	 */
 	if ((val & _Q_TAIL_MASK) == tail) {
-		if (atomic_try_cmpxchg_relaxed(&lock->val, &val, _Q_LOCKED_VAL))
+		if (try_clear_tail(lock, val, node))
 			goto release; /* No contention */
 	}
 
@@ -550,7 +572,7 @@ void __lockfunc queued_spin_lock_slowpath(struct qspinlock *lock, u32 val)
 	if (!next)
 		next = smp_cond_load_relaxed(&node->next, (VAL));
 
-	arch_mcs_spin_unlock_contended(&next->locked);
+	mcs_lock_handoff(node, next);
 	pv_kick_node(lock, next);
 
 release:
@@ -591,3 +613,39 @@ static __init int parse_nopvspin(char *arg)
 }
 early_param("nopvspin", parse_nopvspin);
 #endif
+
+/*
+ * Generate the NUMA-aware code for queued_spin_lock_slowpath(). This is done
+ * from within the paravirt pass so that the common code above is not emitted
+ * again; reset every hook back to its native version first.
+ */
+#if defined(_GEN_PV_LOCK_SLOWPATH) && !defined(_GEN_CNA_LOCK_SLOWPATH) && \
+    defined(CONFIG_NUMA_AWARE_SPINLOCKS)
+#define _GEN_CNA_LOCK_SLOWPATH
+
+#undef  pv_enabled
+#define pv_enabled()		false
+
+#undef  pv_init_node
+#define pv_init_node		cna_init_node
+#undef  pv_wait_node
+#define pv_wait_node		__pv_wait_node
+#undef  pv_kick_node
+#define pv_kick_node		__pv_kick_node
+#undef  pv_wait_head_or_lock
+#define pv_wait_head_or_lock	cna_wait_head_or_lock
+
+#undef  try_clear_tail
+#define try_clear_tail		cna_try_clear_tail
+#undef  mcs_lock_handoff
+#define mcs_lock_handoff	cna_lock_handoff
+
+/* Back to the regular trylock, see qspinlock_paravirt.h */
+#undef  queued_spin_trylock
+
+#undef  queued_spin_lock_slowpath
+#define queued_spin_lock_slowpath	__cna_queued_spin_lock_slowpath
+
+#include "qspinlock_cna.h"
+#include "qspinlock.c"
+#endif
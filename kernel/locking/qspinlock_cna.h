@@ -0,0 +1,329 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _GEN_CNA_LOCK_SLOWPATH
+#error "do not include this file"
+#endif
+
+#include <linux/moduleparam.h>
+#include <linux/sched/clock.h>
+#include <linux/topology.h>
+
+/*
+ * Implement a NUMA-aware version of MCS (aka CNA, or compact NUMA-aware lock).
+ *
+ * In CNA, spinning threads are organized in two queues, a primary queue for
+ * threads running on the same NUMA node as the current lock holder, and a
+ * secondary queue for threads running on other nodes. Schematically, it
+ * looks like this:
+ *
+ *    cna_node
+ *   +----------+     +--------+         +--------+
+ *   |mcs:next  | --> |mcs:next| --> ... |mcs:next| --> NULL  [Primary queue]
+ *   |mcs:locked| -.  +--------+         +--------+
+ *   +----------+  |
+ *                 `----------------------.
+ *                                        v
+ *                 +--------+         +--------+
+ *                 |mcs:next| --> ... |mcs:next|            [Secondary queue]
+ *                 +--------+         +--------+
+ *                     ^                    |
+ *                     `--------------------'
+ *
+ * N.B. locked := 1 if secondary queue is absent. Otherwise, it contains the
+ * encoded pointer to the tail of the secondary queue, which is organized as a
+ * circular list.
+ *
+ * While the queue head waits for the lock owner to go away, it moves waiters
+ * from other nodes off the primary queue, so that the lock is handed to a
+ * waiter on the same node whenever there is one. The secondary queue is put
+ * back in front of the primary queue when the latter runs empty, or when the
+ * lock has stayed on one node for numa_spinlock_threshold_ns, which bounds
+ * the unfairness towards the remote waiters.
+ *
+ * For more details, see https://arxiv.org/abs/1810.05600.
+ */
+
+struct cna_node {
+	struct mcs_spinlock	mcs;
+	u16			numa_node;	/* node the primary queue prefers */
+	u16			real_numa_node;
+	u32			encoded_tail;	/* self */
+	u64			start_time;	/* of the current local period */
+};
+
+/* A start_time telling the lock holder to flush the secondary queue */
+#define CNA_FLUSH_SECONDARY	U64_MAX
+
+/*
+ * Controls how long the lock may stay on one NUMA node while there are
+ * waiters from other nodes.
+ */
+static ulong numa_spinlock_threshold_ns = 1000000;	/* 1ms */
+module_param(numa_spinlock_threshold_ns, ulong, 0644);
+
+static void __init cna_init_nodes(void)
+{
+	int cpu, idx;
+
+	BUILD_BUG_ON(sizeof(struct cna_node) > sizeof(struct qnode));
+
+	for_each_possible_cpu(cpu) {
+		for (idx = 0; idx < MAX_NODES; idx++) {
+			struct cna_node *cn = (struct cna_node *)
+				grab_mcs_node(per_cpu_ptr(&qnodes[0].mcs, cpu), idx);
+
+			cn->real_numa_node = cpu_to_node(cpu);
+			cn->encoded_tail = encode_tail(cpu, idx);
+			/*
+			 * @encoded_tail is stored in mcs.locked and has to be
+			 * told apart from a plain locked value of 1.
+			 */
+			WARN_ON(cn->encoded_tail <= 1);
+		}
+	}
+}
+
+/* mcs.locked is an int, an encoded tail can have the sign bit set */
+static __always_inline bool cna_has_secondary(struct mcs_spinlock *node)
+{
+	return (u32)node->locked > 1;
+}
+
+static __always_inline void cna_init_node(struct mcs_spinlock *node)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+
+	cn->numa_node = cn->real_numa_node;
+	cn->start_time = 0;
+}
+
+/*
+ * cna_splice_head -- splice the entire secondary queue onto the head of the
+ * primary queue.
+ *
+ * Returns the new primary head node or NULL on failure.
+ */
+static struct mcs_spinlock *
+cna_splice_head(struct qspinlock *lock, u32 val,
+		struct mcs_spinlock *node, struct mcs_spinlock *next)
+{
+	struct mcs_spinlock *head_2nd, *tail_2nd;
+	u32 new;
+
+	tail_2nd = decode_tail(node->locked);
+	head_2nd = tail_2nd->next;
+
+	if (next) {
+		/*
+		 * If the primary queue is not empty, the primary tail doesn't
+		 * need to change and we can simply link the secondary tail to
+		 * the old primary head.
+		 */
+		tail_2nd->next = next;
+	} else {
+		/*
+		 * When the primary queue is empty, the secondary tail becomes
+		 * the primary tail. Speculatively break the circular link
+		 * such that it all works out if the cmpxchg() succeeds; then
+		 * no new waiter can be linking itself to @tail_2nd yet.
+		 */
+		tail_2nd->next = NULL;
+
+		new = ((struct cna_node *)tail_2nd)->encoded_tail |
+			_Q_LOCKED_VAL;
+		if (!atomic_try_cmpxchg_release(&lock->val, &val, new)) {
+			/* Restore the secondary queue's circular link. */
+			tail_2nd->next = head_2nd;
+			return NULL;
+		}
+	}
+
+	/* The primary queue head now is what was the secondary queue head. */
+	return head_2nd;
+}
+
+static inline bool cna_try_clear_tail(struct qspinlock *lock, u32 val,
+				      struct mcs_spinlock *node)
+{
+	struct mcs_spinlock *next;
+
+	/* Both queues are empty. Do what MCS does. */
+	if (!cna_has_secondary(node))
+		return __try_clear_tail(lock, val, node);
+
+	/*
+	 * The primary queue is empty but there are remote waiters; move them
+	 * back onto the primary queue and let them rip.
+	 */
+	next = cna_splice_head(lock, val, node, NULL);
+	if (!next)
+		return false;
+
+	lockevent_inc(cna_flush_empty);
+	smp_store_release(&next->locked, 1);
+	return true;
+}
+
+/*
+ * cna_splice_next -- splice the next node from the primary queue onto
+ * the secondary queue.
+ */
+static void cna_splice_next(struct mcs_spinlock *node,
+			    struct mcs_spinlock *next,
+			    struct mcs_spinlock *nnext)
+{
+	/* remove @next from the primary queue */
+	node->next = nnext;
+
+	if (!cna_has_secondary(node)) {
+		/* create the secondary queue */
+		next->next = next;
+	} else {
+		/* add to the tail of the secondary queue */
+		struct mcs_spinlock *tail_2nd = decode_tail(node->locked);
+		struct mcs_spinlock *head_2nd = tail_2nd->next;
+
+		tail_2nd->next = next;
+		next->next = head_2nd;
+	}
+
+	node->locked = ((struct cna_node *)next)->encoded_tail;
+	lockevent_inc(cna_splice_next);
+}
+
+/*
+ * cna_order_queue - check whether the next waiter in the primary queue is on
+ * the same NUMA node as the lock holder; if not, and it has a waiter behind
+ * it in the primary queue, move the former onto the secondary queue.
+ *
+ * Returns true if the next waiter runs on the same NUMA node.
+ */
+static bool cna_order_queue(struct mcs_spinlock *node)
+{
+	struct mcs_spinlock *next = READ_ONCE(node->next);
+	struct mcs_spinlock *nnext;
+
+	if (!next)
+		return false;
+
+	if (((struct cna_node *)next)->numa_node ==
+	    ((struct cna_node *)node)->numa_node)
+		return true;
+
+	/* The primary tail can't be moved, the lock word points at it. */
+	nnext = READ_ONCE(next->next);
+	if (nnext)
+		cna_splice_next(node, next, nnext);
+
+	return false;
+}
+
+#define LOCK_IS_BUSY(lock) (atomic_read(&(lock)->val) & _Q_LOCKED_PENDING_MASK)
+
+/* Abuse the pv_wait_head_or_lock() hook to get some work done */
+static __always_inline u32 cna_wait_head_or_lock(struct qspinlock *lock,
+						 struct mcs_spinlock *node)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+	u64 now = local_clock();
+
+	if (!cn->start_time)
+		cn->start_time = now;
+
+	if (cna_has_secondary(node) &&
+	    (s64)(now - cn->start_time) >= (s64)numa_spinlock_threshold_ns) {
+		cn->start_time = CNA_FLUSH_SECONDARY;
+		return 0;
+	}
+
+	/*
+	 * Try and put the time otherwise spent spin waiting on
+	 * _Q_LOCKED_PENDING_MASK to use by sorting our lists.
+	 */
+	while (LOCK_IS_BUSY(lock) && !cna_order_queue(node))
+		cpu_relax();
+
+	return 0; /* we lied; we didn't wait, go do so now */
+}
+
+static inline void cna_lock_handoff(struct mcs_spinlock *node,
+				    struct mcs_spinlock *next)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+	u32 val = 1;
+
+	if (cna_has_secondary(node)) {
+		/* @next may have been moved away by cna_order_queue() */
+		next = READ_ONCE(node->next);
+
+		if (cn->start_time == CNA_FLUSH_SECONDARY) {
+			/*
+			 * Splice the secondary queue onto the primary queue
+			 * and pass the lock to the longest waiting remote
+			 * waiter.
+			 */
+			next = cna_splice_head(NULL, 0, node, next);
+			lockevent_inc(cna_flush_threshold);
+		} else {
+			/*
+			 * Preserve the secondary queue and pass on the
+			 * preferred node and the start of the local period,
+			 * even if @next turns out to be a remote waiter.
+			 */
+			val = node->locked;
+			((struct cna_node *)next)->numa_node = cn->numa_node;
+			((struct cna_node *)next)->start_time = cn->start_time;
+			lockevent_inc(cna_intra_node);
+		}
+	}
+
+	smp_store_release(&next->locked, val);
+}
+
+enum {
+	NUMA_LOCKS_AUTO,
+	NUMA_LOCKS_ON,
+	NUMA_LOCKS_OFF,
+};
+
+static int numa_spinlock_flag __initdata = NUMA_LOCKS_AUTO;
+
+static __init int numa_spinlock_setup(char *str)
+{
+	if (!str)
+		return -EINVAL;
+
+	if (!strcmp(str, "auto"))
+		numa_spinlock_flag = NUMA_LOCKS_AUTO;
+	else if (!strcmp(str, "on"))
+		numa_spinlock_flag = NUMA_LOCKS_ON;
+	else if (!strcmp(str, "off"))
+		numa_spinlock_flag = NUMA_LOCKS_OFF;
+	else
+		return -EINVAL;
+
+	return 0;
+}
+early_param("numa_spinlock", numa_spinlock_setup);
+
+/*
+ * Switch to the NUMA-friendly slow path for spinlocks when we have
+ * multiple NUMA nodes in native environment, unless the user has
+ * overridden this default behavior by setting the numa_spinlock flag.
+ */
+void __init cna_configure_spin_lock_slowpath(void)
+{
+	if (numa_spinlock_flag == NUMA_LOCKS_OFF ||
+	    (numa_spinlock_flag == NUMA_LOCKS_AUTO && nr_node_ids == 1))
+		return;
+
+	/* Leave a paravirt slowpath installed by the hypervisor alone. */
+	if (pv_ops.lock.queued_spin_lock_slowpath !=
+	    native_queued_spin_lock_slowpath)
+		return;
+
+	cna_init_nodes();
+
+	pv_ops.lock.queued_spin_lock_slowpath = __cna_queued_spin_lock_slowpath;
+
+	pr_info("Enabling CNA spinlock\n");
+}
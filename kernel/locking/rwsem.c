@@ -26,6 +26,7 @@
 #include <linux/sched/clock.h>
 #include <linux/export.h>
 #include <linux/rwsem.h>
+#include <linux/hybrid-rwsem.h>
 #include <linux/atomic.h>
 #include <trace/events/lock.h>
 
@@ -1401,6 +1402,158 @@ static inline void __downgrade_write(struct rw_semaphore *sem)
 	preempt_enable();
 }
 
+/*
+ * Hybrid rwsem: switch to per-CPU reader counts after this many read
+ * acquisitions found other readers holding the lock, since the last writer.
+ */
+#define HRWSEM_CONTENDED_THRESHOLD	64
+
+int __hybrid_init_rwsem(struct hybrid_rw_semaphore *sem,
+			const char *name, struct lock_class_key *key)
+{
+	sem->read_count = alloc_percpu(unsigned int);
+	if (unlikely(!sem->read_count))
+		return -ENOMEM;
+
+	__init_rwsem(&sem->rwsem, name, key);
+	sem->mode = HRWSEM_SHARED;
+	atomic_set(&sem->contended, 0);
+	rcuwait_init(&sem->writer);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(__hybrid_init_rwsem);
+
+void hybrid_free_rwsem(struct hybrid_rw_semaphore *sem)
+{
+	if (!sem->read_count)
+		return;
+
+	free_percpu(sem->read_count);
+	sem->read_count = NULL;
+}
+EXPORT_SYMBOL_GPL(hybrid_free_rwsem);
+
+static bool hybrid_readers_drained(struct hybrid_rw_semaphore *sem)
+{
+	unsigned int sum = 0;
+	int cpu;
+
+	/*
+	 * A reader may increment on one CPU and decrement on another, only
+	 * the sum is meaningful.
+	 */
+	for_each_possible_cpu(cpu)
+		sum += per_cpu(*sem->read_count, cpu);
+
+	if (sum)
+		return false;
+
+	smp_mb(); /* C matches B, see the critical sections of the readers */
+	return true;
+}
+
+/*
+ * Returns the cookie to pass to hybrid_up_read().
+ */
+int hybrid_down_read(struct hybrid_rw_semaphore *sem)
+{
+	long count;
+
+	might_sleep();
+
+	preempt_disable();
+	if (READ_ONCE(sem->mode) == HRWSEM_PERCPU) {
+		this_cpu_inc(*sem->read_count);
+		/*
+		 * Either the writer sees our increment when it sums the
+		 * counts, or we see it moving the lock back to the shared
+		 * mode.
+		 */
+		smp_mb(); /* A matches D */
+		if (likely(READ_ONCE(sem->mode) == HRWSEM_PERCPU)) {
+			preempt_enable();
+			rwsem_acquire_read(&sem->rwsem.dep_map, 0, 0, _RET_IP_);
+			lockevent_inc(hrwsem_rlock_percpu);
+			return HRWSEM_PERCPU;
+		}
+		this_cpu_dec(*sem->read_count);
+		rcuwait_wake_up(&sem->writer);
+	}
+	preempt_enable();
+
+	down_read(&sem->rwsem);
+	lockevent_inc(hrwsem_rlock_shared);
+
+	/*
+	 * Readers contending with each other all bounce the count cacheline;
+	 * once that happened often enough since the last writer, let the
+	 * following readers use the per-CPU counts. No writer can be
+	 * draining them while we hold the rwsem for reading.
+	 */
+	count = atomic_long_read(&sem->rwsem.count);
+	if ((count >> RWSEM_READER_SHIFT) > 1 &&
+	    atomic_inc_return(&sem->contended) == HRWSEM_CONTENDED_THRESHOLD) {
+		WRITE_ONCE(sem->mode, HRWSEM_PERCPU);
+		lockevent_inc(hrwsem_to_percpu);
+	}
+
+	return HRWSEM_SHARED;
+}
+EXPORT_SYMBOL_GPL(hybrid_down_read);
+
+void hybrid_up_read(struct hybrid_rw_semaphore *sem, int cookie)
+{
+	if (cookie == HRWSEM_SHARED) {
+		up_read(&sem->rwsem);
+		return;
+	}
+
+	rwsem_release(&sem->rwsem.dep_map, _RET_IP_);
+
+	preempt_disable();
+	smp_mb(); /* B matches C */
+	this_cpu_dec(*sem->read_count);
+	/*
+	 * Order the decrement against reading the mode: a writer that moved
+	 * the lock back to the shared mode either sees the decrement or is
+	 * woken by us.
+	 */
+	smp_mb();
+	if (READ_ONCE(sem->mode) != HRWSEM_PERCPU)
+		rcuwait_wake_up(&sem->writer);
+	preempt_enable();
+}
+EXPORT_SYMBOL_GPL(hybrid_up_read);
+
+void hybrid_down_write(struct hybrid_rw_semaphore *sem)
+{
+	down_write(&sem->rwsem);
+
+	/* Reads have to contend again before the next switch. */
+	atomic_set(&sem->contended, 0);
+
+	if (READ_ONCE(sem->mode) != HRWSEM_PERCPU)
+		return;
+
+	/*
+	 * New readers now queue up on the rwsem, wait for the ones that
+	 * took the per-CPU path to leave.
+	 */
+	WRITE_ONCE(sem->mode, HRWSEM_SHARED);
+	smp_mb(); /* D matches A */
+	lockevent_inc(hrwsem_to_shared);
+
+	rcuwait_wait_event(&sem->writer, hybrid_readers_drained(sem),
+			   TASK_UNINTERRUPTIBLE);
+}
+EXPORT_SYMBOL_GPL(hybrid_down_write);
+
+void hybrid_up_write(struct hybrid_rw_semaphore *sem)
+{
+	up_write(&sem->rwsem);
+}
+EXPORT_SYMBOL_GPL(hybrid_up_write);
+
 #else /* !CONFIG_PREEMPT_RT */
 
 #define RT_MUTEX_BUILD_MUTEX
@@ -53,6 +53,8 @@
 #include <linux/jump_label.h>
 #include <linux/pfn.h>
 #include <linux/bsearch.h>
+#include <linux/hashtable.h>
+#include <linux/stringhash.h>
 #include <linux/dynamic_debug.h>
 #include <linux/audit.h>
 #include <linux/cfi.h>
@@ -297,6 +299,88 @@ static bool find_exported_symbol_in_section(const struct symsearch *syms,
 	return true;
 }
 
+/*
+ * The exported symbols of all formed modules, hashed by name, so that
+ * resolving a symbol does not have to bsearch the exports of each loaded
+ * module in turn.  Names are unique, verify_exported_symbols() makes sure
+ * of it.  Updated under module_mutex, walked under RCU.
+ */
+#define MOD_EXPORT_HASH_BITS	12
+static DEFINE_HASHTABLE(mod_export_hash, MOD_EXPORT_HASH_BITS);
+
+struct mod_export_node {
+	struct hlist_node node;
+	struct module *owner;
+	const struct kernel_symbol *sym;
+	const s32 *crc;
+	enum mod_license license;
+};
+
+static u32 mod_export_hashfn(const char *name)
+{
+	return full_name_hash(NULL, name, strlen(name));
+}
+
+static void mod_export_node_add(struct mod_export_node *node,
+				struct module *mod,
+				const struct kernel_symbol *sym,
+				const s32 *crc, enum mod_license license)
+{
+	node->owner = mod;
+	node->sym = sym;
+	node->crc = crc;
+	node->license = license;
+	hash_add_rcu(mod_export_hash, &node->node,
+		     mod_export_hashfn(kernel_symbol_name(sym)));
+}
+
+/* Must be called with module_mutex held */
+static int mod_export_hash_add(struct module *mod)
+{
+	unsigned int nr = mod->num_syms + mod->num_gpl_syms;
+	struct mod_export_node *nodes;
+	unsigned int i;
+
+	if (!nr)
+		return 0;
+
+	nodes = kmalloc_array(nr, sizeof(*nodes), GFP_KERNEL);
+	if (!nodes)
+		return -ENOMEM;
+
+	for (i = 0; i < mod->num_syms; i++)
+		mod_export_node_add(&nodes[i], mod, &mod->syms[i],
+				    symversion(mod->crcs, i), NOT_GPL_ONLY);
+	for (i = 0; i < mod->num_gpl_syms; i++)
+		mod_export_node_add(&nodes[mod->num_syms + i], mod,
+				    &mod->gpl_syms[i],
+				    symversion(mod->gpl_crcs, i), GPL_ONLY);
+
+	mod->export_nodes = nodes;
+	return 0;
+}
+
+/*
+ * Must be called with module_mutex held, the nodes can be freed with
+ * mod_export_hash_free() after a grace period.
+ */
+static void mod_export_hash_del(struct module *mod)
+{
+	unsigned int i;
+
+	if (!mod->export_nodes)
+		return;
+
+	for (i = 0; i < mod->num_syms + mod->num_gpl_syms; i++)
+		hash_del_rcu(&mod->export_nodes[i].node);
+}
+
+static void mod_export_hash_free(struct module *mod)
+{
+	kfree(mod->export_nodes);
+	mod->export_nodes = NULL;
+}
+
 /*
  * Find an exported symbol and return it, along with, (optional) crc and
  * (optional) module which owns it.  Needs preempt disabled or module_mutex.
@@ -310,7 +394,7 @@ bool find_symbol(struct find_symbol_arg *fsa)
 		  __start___kcrctab_gpl,
 		  GPL_ONLY },
 	};
-	struct module *mod;
+	struct mod_export_node *node;
 	unsigned int i;
 
 	module_assert_mutex_or_preempt();
@@ -319,22 +403,21 @@ bool find_symbol(struct find_symbol_arg *fsa)
 		if (find_exported_symbol_in_section(&arr[i], NULL, fsa))
 			return true;
 
-	list_for_each_entry_rcu(mod, &modules, list,
-				lockdep_is_held(&module_mutex)) {
-		struct symsearch arr[] = {
-			{ mod->syms, mod->syms + mod->num_syms, mod->crcs,
-			  NOT_GPL_ONLY },
-			{ mod->gpl_syms, mod->gpl_syms + mod->num_gpl_syms,
-			  mod->gpl_crcs,
-			  GPL_ONLY },
-		};
-
-		if (mod->state == MODULE_STATE_UNFORMED)
+	hash_for_each_possible_rcu(mod_export_hash, node, node,
+				   mod_export_hashfn(fsa->name),
+				   lockdep_is_held(&module_mutex)) {
+		if (node->owner->state == MODULE_STATE_UNFORMED)
+			continue;
+		if (!fsa->gplok && node->license == GPL_ONLY)
+			continue;
+		if (strcmp(fsa->name, kernel_symbol_name(node->sym)))
 			continue;
 
-		for (i = 0; i < ARRAY_SIZE(arr); i++)
-			if (find_exported_symbol_in_section(&arr[i], mod, fsa))
-				return true;
+		fsa->owner = node->owner;
+		fsa->crc = node->crc;
+		fsa->sym = node->sym;
+		fsa->license = node->license;
+		return true;
 	}
 
 	pr_debug("Failed to find symbol %s\n", fsa->name);
@@ -978,6 +1061,15 @@ static ssize_t show_taint(struct module_attribute *mattr,
 static struct module_attribute modinfo_taint =
 	__ATTR(taint, 0444, show_taint, NULL);
 
+static ssize_t show_load_time_us(struct module_attribute *mattr,
+				 struct module_kobject *mk, char *buffer)
+{
+	return sprintf(buffer, "%lu\n", mk->mod->load_time_us);
+}
+
+static struct module_attribute modinfo_load_time_us =
+	__ATTR(load_time_us, 0444, show_load_time_us, NULL);
+
 struct module_attribute *modinfo_attrs[] = {
 	&module_uevent,
 	&modinfo_version,
@@ -989,6 +1081,7 @@ struct module_attribute *modinfo_attrs[] = {
 #endif
 	&modinfo_initsize,
 	&modinfo_taint,
+	&modinfo_load_time_us,
 #ifdef CONFIG_MODULE_UNLOAD
 	&modinfo_refcnt,
 #endif
@@ -1293,6 +1386,7 @@ static void free_module(struct module *mod)
 	mutex_lock(&module_mutex);
 	/* Unlink carefully: kallsyms could be walking list. */
 	list_del_rcu(&mod->list);
+	mod_export_hash_del(mod);
 	mod_tree_remove(mod);
 	/* Remove this module from bug list, this uses list_del_rcu */
 	module_bug_cleanup(mod);
@@ -1302,6 +1396,7 @@ static void free_module(struct module *mod)
 		pr_err("%s: adding tainted module to the unloaded tainted modules list failed.\n",
 		       mod->name);
 	mutex_unlock(&module_mutex);
+	mod_export_hash_free(mod);
 
 	/* This may be empty, but that's OK */
 	module_arch_freeing_init(mod);
@@ -2509,7 +2604,7 @@ module_param(async_probe, bool, 0644);
  * Keep it uninlined to provide a reliable breakpoint target, e.g. for the gdb
  * helper command 'lx-symbols'.
  */
-static noinline int do_init_module(struct module *mod)
+static noinline int do_init_module(struct module *mod, ktime_t load_start)
 {
 	int ret = 0;
 	struct mod_initfree *freeinit;
@@ -2550,6 +2645,9 @@ static noinline int do_init_module(struct module *mod)
 		dump_stack();
 	}
 
+	mod->load_time_us = ktime_us_delta(ktime_get(), load_start);
+	pr_debug("%s: loaded in %lu us\n", mod->name, mod->load_time_us);
+
 	/* Now it's a first class citizen! */
 	mod->state = MODULE_STATE_LIVE;
 	blocking_notifier_call_chain(&module_notify_list,
@@ -2758,6 +2856,10 @@ static int complete_formation(struct module *mod, struct load_info *info)
 	if (err)
 		goto out_strict_rwx;
 
+	err = mod_export_hash_add(mod);
+	if (err)
+		goto out_strict_rwx;
+
 	/*
 	 * Mark state as coming so strong_try_module_get() ignores us,
 	 * but kallsyms etc. can see us.
@@ -2853,6 +2955,7 @@ static int load_module(struct load_info *info, const char __user *uargs,
 {
 	struct module *mod;
 	bool module_allocated = false;
+	ktime_t load_start = ktime_get();
 	long err = 0;
 	char *after_dashes;
 
@@ -3003,7 +3106,7 @@ static int load_module(struct load_info *info, const char __user *uargs,
 	/* Done! */
 	trace_module_load(mod);
 
-	return do_init_module(mod);
+	return do_init_module(mod, load_start);
 
  sysfs_cleanup:
 	mod_sysfs_teardown(mod);
@@ -3034,11 +3137,13 @@ static int load_module(struct load_info *info, const char __user *uargs,
 	mutex_lock(&module_mutex);
 	/* Unlink carefully: kallsyms could be walking list. */
 	list_del_rcu(&mod->list);
+	mod_export_hash_del(mod);
 	mod_tree_remove(mod);
 	wake_up_all(&module_wq);
 	/* Wait for RCU-sched synchronizing before releasing mod->list. */
 	synchronize_rcu();
 	mutex_unlock(&module_mutex);
+	mod_export_hash_free(mod);
  free_module:
 	mod_stat_bump_invalid(info, flags);
 	/* Free lock-classes; relies on the preceding sync_rcu() */
@@ -668,6 +668,145 @@ void __rcu_irq_enter_check_tick(void)
 NOKPROBE_SYMBOL(__rcu_irq_enter_check_tick);
 #endif /* CONFIG_NO_HZ_FULL */
 
+#ifdef CONFIG_RCU_LAZY
+/*
+ * LAZY_FLUSH_JIFFIES decides the maximum amount of time that
+ * can elapse before lazy callbacks are flushed. Lazy callbacks
+ * could be flushed much earlier for a number of other reasons
+ * however, LAZY_FLUSH_JIFFIES will ensure no lazy callbacks are
+ * left unsubmitted to RCU after those many jiffies.
+ */
+#define LAZY_FLUSH_JIFFIES (10 * HZ)
+static unsigned long jiffies_lazy_flush = LAZY_FLUSH_JIFFIES;
+
+// To be called only from test code.
+void rcu_set_jiffies_lazy_flush(unsigned long jif)
+{
+	jiffies_lazy_flush = jif;
+}
+EXPORT_SYMBOL(rcu_set_jiffies_lazy_flush);
+
+unsigned long rcu_get_jiffies_lazy_flush(void)
+{
+	return jiffies_lazy_flush;
+}
+EXPORT_SYMBOL(rcu_get_jiffies_lazy_flush);
+
+/*
+ * Non-offloaded CPUs have no bypass list, so lazy callbacks are queued
+ * on ->cblist as usual, but as long as the not-yet-assigned callbacks
+ * are all lazy, this CPU neither asks for a grace period for them nor
+ * keeps the scheduling-clock tick on their behalf.  They ride along with
+ * the next grace period requested for any other reason, and are flushed
+ * (made to request one) on timeout, once there are qhimark of them, on
+ * any rcu_barrier(), and under memory pressure.
+ *
+ * ->lazy_next is only accessed by its CPU with interrupts disabled.
+ */
+static bool rcu_lazy_defer(struct rcu_data *rdp)
+{
+	return rdp->lazy_next && !rcu_rdp_is_offloaded(rdp) &&
+	       rdp->lazy_next == rcu_segcblist_get_seglen(&rdp->cblist, RCU_NEXT_TAIL);
+}
+
+/* The callbacks have been assigned a grace period, or will be shortly. */
+static void rcu_lazy_reset(struct rcu_data *rdp)
+{
+	rdp->lazy_next = 0;
+}
+
+static void rcu_lazy_flush(struct rcu_data *rdp)
+{
+	lockdep_assert_irqs_disabled();
+	if (!rdp->lazy_next)
+		return;
+	rcu_lazy_reset(rdp);
+	if (!rcu_rdp_is_offloaded(rdp))
+		invoke_rcu_core();
+}
+
+static void rcu_lazy_enqueue(struct rcu_data *rdp)
+{
+	if (rcu_rdp_is_offloaded(rdp))
+		return;
+	if (!rdp->lazy_next++)
+		mod_timer(&rdp->lazy_timer, jiffies + rcu_get_jiffies_lazy_flush());
+	else if (rdp->lazy_next >= qhimark)
+		rcu_lazy_flush(rdp);
+}
+
+static void rcu_lazy_timer_fn(struct timer_list *t)
+{
+	struct rcu_data *rdp = from_timer(rdp, t, lazy_timer);
+	unsigned long flags;
+
+	local_irq_save(flags);
+	// Migrated away from an outgoing CPU, whose callbacks moved as well.
+	if (rdp == this_cpu_ptr(&rcu_data))
+		rcu_lazy_flush(rdp);
+	local_irq_restore(flags);
+}
+
+static void rcu_lazy_flush_ipi(void *unused)
+{
+	rcu_lazy_flush(this_cpu_ptr(&rcu_data));
+}
+
+static unsigned long
+rcu_lazy_shrink_count(struct shrinker *shrink, struct shrink_control *sc)
+{
+	int cpu;
+	unsigned long count = 0;
+
+	for_each_online_cpu(cpu)
+		count += READ_ONCE(per_cpu_ptr(&rcu_data, cpu)->lazy_next);
+
+	return count ? count : SHRINK_EMPTY;
+}
+
+static unsigned long
+rcu_lazy_shrink_scan(struct shrinker *shrink, struct shrink_control *sc)
+{
+	int cpu;
+	unsigned long count = 0;
+
+	cpus_read_lock();
+	for_each_online_cpu(cpu) {
+		long _count = READ_ONCE(per_cpu_ptr(&rcu_data, cpu)->lazy_next);
+
+		if (!_count)
+			continue;
+		smp_call_function_single(cpu, rcu_lazy_flush_ipi, NULL, 0);
+		sc->nr_to_scan -= _count;
+		count += _count;
+		if (sc->nr_to_scan <= 0)
+			break;
+	}
+	cpus_read_unlock();
+
+	return count ? count : SHRINK_STOP;
+}
+
+static void __init rcu_lazy_shrinker_init(void)
+{
+	struct shrinker *lazy_shrinker;
+
+	lazy_shrinker = shrinker_alloc(0, "rcu-lazy-core");
+	if (!lazy_shrinker) {
+		pr_err("Failed to allocate non-offloaded lazy_rcu shrinker!\n");
+		return;
+	}
+	lazy_shrinker->count_objects = rcu_lazy_shrink_count;
+	lazy_shrinker->scan_objects = rcu_lazy_shrink_scan;
+	shrinker_register(lazy_shrinker);
+}
+#else /* #ifdef CONFIG_RCU_LAZY */
+static bool rcu_lazy_defer(struct rcu_data *rdp) { return false; }
+static void rcu_lazy_reset(struct rcu_data *rdp) { }
+static void rcu_lazy_enqueue(struct rcu_data *rdp) { }
+static void __init rcu_lazy_shrinker_init(void) { }
+#endif /* #else #ifdef CONFIG_RCU_LAZY */
+
 /*
  * Check to see if any future non-offloaded RCU-related work will need
  * to be done by the current CPU, even if none need be done immediately,
@@ -677,12 +816,16 @@ NOKPROBE_SYMBOL(__rcu_irq_enter_check_tick);
  * scheduler-clock interrupt.
  *
  * Just check whether or not this CPU has non-offloaded RCU callbacks
- * queued.
+ * queued, other than lazy ones that are not asking for a grace period.
  */
 int rcu_needs_cpu(void)
 {
-	return !rcu_segcblist_empty(&this_cpu_ptr(&rcu_data)->cblist) &&
-		!rcu_rdp_is_offloaded(this_cpu_ptr(&rcu_data));
+	struct rcu_data *rdp = this_cpu_ptr(&rcu_data);
+
+	if (rcu_segcblist_empty(&rdp->cblist) || rcu_rdp_is_offloaded(rdp))
+		return 0;
+	return !rcu_lazy_defer(rdp) ||
+	       rcu_segcblist_n_cbs(&rdp->cblist) != rdp->lazy_next;
 }
 
 /*
@@ -1120,6 +1263,10 @@ static bool rcu_accelerate_cbs(struct rcu_node *rnp, struct rcu_data *rdp)
 	if (!rcu_segcblist_pend_cbs(&rdp->cblist))
 		return false;
 
+	/* Don't ask for a grace period on behalf of lazy callbacks only. */
+	if (rcu_lazy_defer(rdp))
+		return false;
+
 	trace_rcu_segcb_stats(&rdp->cblist, TPS("SegCbPreAcc"));
 
 	/*
@@ -1135,6 +1282,7 @@ static bool rcu_accelerate_cbs(struct rcu_node *rnp, struct rcu_data *rdp)
 	gp_seq_req = rcu_seq_snap(&rcu_state.gp_seq);
 	if (rcu_segcblist_accelerate(&rdp->cblist, gp_seq_req))
 		ret = rcu_start_this_gp(rnp, rdp, gp_seq_req);
+	rcu_lazy_reset(rdp);
 
 	/* Trace depending on how much we were able to accelerate. */
 	if (rcu_segcblist_restempty(&rdp->cblist, RCU_WAIT_TAIL))
@@ -1165,6 +1313,7 @@ static void rcu_accelerate_cbs_unlocked(struct rcu_node *rnp,
 	if (!READ_ONCE(rdp->gpwrap) && ULONG_CMP_GE(rdp->gp_seq_needed, c)) {
 		/* Old request still live, so mark recent callbacks. */
 		(void)rcu_segcblist_accelerate(&rdp->cblist, c);
+		rcu_lazy_reset(rdp);
 		return;
 	}
 	raw_spin_lock_rcu_node(rnp); /* irqs already disabled. */
@@ -2952,9 +3101,15 @@ static void rcutree_enqueue(struct rcu_data *rdp, struct rcu_head *head, rcu_cal
  * Handle any core-RCU processing required by a call_rcu() invocation.
  */
 static void call_rcu_core(struct rcu_data *rdp, struct rcu_head *head,
-			  rcu_callback_t func, unsigned long flags)
+			  rcu_callback_t func, unsigned long flags, bool lazy)
 {
 	rcutree_enqueue(rdp, head, func);
+	if (lazy) {
+		rcu_lazy_enqueue(rdp);
+		if (rcu_lazy_defer(rdp))
+			return;
+	}
+
 	/*
 	 * If called from an extended quiescent state, invoke the RCU
 	 * core in order to force a re-evaluation of RCU's idleness.
@@ -3090,7 +3245,7 @@ __call_rcu_common(struct rcu_head *head, rcu_callback_t func, bool lazy_in)
 	if (unlikely(rcu_rdp_is_offloaded(rdp)))
 		call_rcu_nocb(rdp, head, func, flags, lazy);
 	else
-		call_rcu_core(rdp, head, func, flags);
+		call_rcu_core(rdp, head, func, flags, lazy);
 	local_irq_restore(flags);
 }
 
@@ -4329,7 +4484,8 @@ static int rcu_pending(int user)
 	/* Has RCU gone idle with this CPU needing another grace period? */
 	if (!gp_in_progress && rcu_segcblist_is_enabled(&rdp->cblist) &&
 	    !rcu_rdp_is_offloaded(rdp) &&
-	    !rcu_segcblist_restempty(&rdp->cblist, RCU_NEXT_READY_TAIL))
+	    !rcu_segcblist_restempty(&rdp->cblist, RCU_NEXT_READY_TAIL) &&
+	    !rcu_lazy_defer(rdp))
 		return 1;
 
 	/* Have RCU grace period completed or started?  */
@@ -4397,6 +4553,8 @@ static void rcu_barrier_entrain(struct rcu_data *rdp)
 	 */
 	was_alldone = rcu_rdp_is_offloaded(rdp) && !rcu_segcblist_pend_cbs(&rdp->cblist);
 	WARN_ON_ONCE(!rcu_nocb_flush_bypass(rdp, NULL, jiffies, false));
+	// The barrier callback is not lazy and will get the lazy ones a GP.
+	rcu_lazy_reset(rdp);
 	wake_nocb = was_alldone && rcu_segcblist_pend_cbs(&rdp->cblist);
 	if (rcu_segcblist_entrain(&rdp->cblist, &rdp->barrier_head)) {
 		atomic_inc(&rcu_state.barrier_cpu_count);
@@ -4775,6 +4933,9 @@ rcu_boot_init_percpu_data(int cpu)
 	rdp->rcu_onl_gp_state = RCU_GP_CLEANED;
 	rdp->last_sched_clock = jiffies;
 	rdp->cpu = cpu;
+#ifdef CONFIG_RCU_LAZY
+	timer_setup(&rdp->lazy_timer, rcu_lazy_timer_fn, TIMER_PINNED);
+#endif
 	rcu_boot_init_nocb_percpu_data(rdp);
 }
 
@@ -5117,6 +5278,7 @@ void rcutree_migrate_callbacks(int cpu)
 	raw_spin_lock_irqsave(&rcu_state.barrier_lock, flags);
 	WARN_ON_ONCE(rcu_rdp_cpu_online(rdp));
 	rcu_barrier_entrain(rdp);
+	rcu_lazy_reset(rdp);
 	my_rdp = this_cpu_ptr(&rcu_data);
 	my_rnp = my_rdp->mynode;
 	rcu_nocb_lock(my_rdp); /* irqs already disabled. */
@@ -5582,6 +5744,7 @@ void __init rcu_init(void)
 	rcu_early_boot_tests();
 
 	kfree_rcu_batch_init();
+	rcu_lazy_shrinker_init();
 	rcu_bootup_announce();
 	sanitize_kthread_prio();
 	rcu_init_geometry();
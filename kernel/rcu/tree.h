@@ -282,6 +282,11 @@ struct rcu_data {
 					    /* the first RCU stall timeout */
 
 	long lazy_len;			/* Length of buffered lazy callbacks. */
+#ifdef CONFIG_RCU_LAZY
+	long lazy_next;			/* # lazy CBs not requesting a GP on */
+					/*  a non-offloaded CPU. */
+	struct timer_list lazy_timer;	/* Flushes them after a delay. */
+#endif
 	int cpu;
 };
 
@@ -256,31 +256,6 @@ static bool wake_nocb_gp(struct rcu_data *rdp, bool force)
 	return __wake_nocb_gp(rdp_gp, rdp, force, flags);
 }
 
-#ifdef CONFIG_RCU_LAZY
-/*
- * LAZY_FLUSH_JIFFIES decides the maximum amount of time that
- * can elapse before lazy callbacks are flushed. Lazy callbacks
- * could be flushed much earlier for a number of other reasons
- * however, LAZY_FLUSH_JIFFIES will ensure no lazy callbacks are
- * left unsubmitted to RCU after those many jiffies.
- */
-#define LAZY_FLUSH_JIFFIES (10 * HZ)
-static unsigned long jiffies_lazy_flush = LAZY_FLUSH_JIFFIES;
-
-// To be called only from test code.
-void rcu_set_jiffies_lazy_flush(unsigned long jif)
-{
-	jiffies_lazy_flush = jif;
-}
-EXPORT_SYMBOL(rcu_set_jiffies_lazy_flush);
-
-unsigned long rcu_get_jiffies_lazy_flush(void)
-{
-	return jiffies_lazy_flush;
-}
-EXPORT_SYMBOL(rcu_get_jiffies_lazy_flush);
-#endif
-
 /*
  * Arrange to wake the GP kthread for this NOCB group at some future
  * time when it is safe to do so.
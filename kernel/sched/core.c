@@ -95,6 +95,9 @@
 #include "../workqueue_internal.h"
 #include "../../io_uring/io-wq.h"
 #include "../smpboot.h"
+#ifdef CONFIG_SCHED_PROXY_EXEC
+#include "../locking/mutex.h"
+#endif
 
 EXPORT_TRACEPOINT_SYMBOL_GPL(ipi_send_cpu);
 EXPORT_TRACEPOINT_SYMBOL_GPL(ipi_send_cpumask);
@@ -2220,9 +2223,9 @@ inline int task_curr(const struct task_struct *p)
  * this means any call to check_class_changed() must be followed by a call to
  * balance_callback().
  */
-static inline void check_class_changed(struct rq *rq, struct task_struct *p,
-				       const struct sched_class *prev_class,
-				       int oldprio)
+void check_class_changed(struct rq *rq, struct task_struct *p,
+			 const struct sched_class *prev_class,
+			 int oldprio)
 {
 	if (prev_class != p->sched_class) {
 		if (prev_class->switched_from)
@@ -2233,6 +2236,41 @@ static inline void check_class_changed(struct rq *rq, struct task_struct *p,
 		p->sched_class->prio_changed(rq, p, oldprio);
 }
 
+#ifdef CONFIG_SCHED_CLASS_EXT
+void sched_deq_and_put_task(struct task_struct *p, int queue_flags,
+			    struct sched_enq_and_set_ctx *ctx)
+{
+	struct rq *rq = task_rq(p);
+
+	lockdep_assert_rq_held(rq);
+
+	*ctx = (struct sched_enq_and_set_ctx){
+		.p = p,
+		.queue_flags = queue_flags,
+		.queued = task_on_rq_queued(p),
+		.running = task_current(rq, p),
+	};
+
+	update_rq_clock(rq);
+	if (ctx->queued)
+		dequeue_task(rq, p, queue_flags | DEQUEUE_NOCLOCK);
+	if (ctx->running)
+		put_prev_task(rq, p);
+}
+
+void sched_enq_and_set_task(struct sched_enq_and_set_ctx *ctx)
+{
+	struct rq *rq = task_rq(ctx->p);
+
+	lockdep_assert_rq_held(rq);
+
+	if (ctx->queued)
+		enqueue_task(rq, ctx->p, ctx->queue_flags | ENQUEUE_NOCLOCK);
+	if (ctx->running)
+		set_next_task(rq, ctx->p);
+}
+#endif /* CONFIG_SCHED_CLASS_EXT */
+
 void wakeup_preempt(struct rq *rq, struct task_struct *p, int flags)
 {
 	if (p->sched_class == rq->curr->sched_class)
@@ -4552,6 +4590,10 @@ static void __sched_fork(unsigned long clone_flags, struct task_struct *p)
 	p->rt.on_rq		= 0;
 	p->rt.on_list		= 0;
 
+#ifdef CONFIG_SCHED_CLASS_EXT
+	init_scx_entity(&p->scx);
+#endif
+
 #ifdef CONFIG_PREEMPT_NOTIFIERS
 	INIT_HLIST_HEAD(&p->preempt_notifiers);
 #endif
@@ -4794,6 +4836,10 @@ int sched_fork(unsigned long clone_flags, struct task_struct *p)
 		return -EAGAIN;
 	else if (rt_prio(p->prio))
 		p->sched_class = &rt_sched_class;
+#ifdef CONFIG_SCHED_CLASS_EXT
+	else if (task_should_scx(p))
+		p->sched_class = &ext_sched_class;
+#endif
 	else
 		p->sched_class = &fair_sched_class;
 
@@ -4847,6 +4893,7 @@ void sched_cgroup_fork(struct task_struct *p, struct kernel_clone_args *kargs)
 void sched_post_fork(struct task_struct *p)
 {
 	uclamp_post_fork(p);
+	scx_post_fork(p);
 }
 
 unsigned long to_ratio(u64 period, u64 runtime)
@@ -5992,7 +6039,18 @@ static void put_prev_task_balance(struct rq *rq, struct task_struct *prev,
 				  struct rq_flags *rf)
 {
 #ifdef CONFIG_SMP
+	const struct sched_class *start_class = prev->sched_class;
 	const struct sched_class *class;
+
+#ifdef CONFIG_SCHED_CLASS_EXT
+	/*
+	 * The ext class fills the local DSQ from ->balance(), it must run
+	 * before every pick, including when @prev is the idle task.
+	 */
+	if (scx_enabled() && sched_class_above(&ext_sched_class, start_class))
+		start_class = &ext_sched_class;
+#endif
+
 	/*
 	 * We must do the balancing pass before put_prev_task(), such
 	 * that when we release the rq->lock the task is in the same
@@ -6001,7 +6059,7 @@ static void put_prev_task_balance(struct rq *rq, struct task_struct *prev,
 	 * We can terminate the balance pass as soon as we know there is
 	 * a runnable task of @class priority or higher.
 	 */
-	for_class_range(class, prev->sched_class, &idle_sched_class) {
+	for_class_range(class, start_class, &idle_sched_class) {
 		if (class->balance(rq, prev, rf))
 			break;
 	}
@@ -6019,6 +6077,10 @@ __pick_next_task(struct rq *rq, struct task_struct *prev, struct rq_flags *rf)
 	const struct sched_class *class;
 	struct task_struct *p;
 
+	/* ext tasks may be waiting on a shared DSQ without counting here */
+	if (scx_enabled())
+		goto restart;
+
 	/*
 	 * Optimization: we know that if all tasks are in the fair class we can
 	 * call that function directly, but only if the @prev task wasn't of a
@@ -6557,6 +6619,106 @@ pick_next_task(struct rq *rq, struct task_struct *prev, struct rq_flags *rf)
 
 #endif /* CONFIG_SCHED_CORE */
 
+#ifdef CONFIG_SCHED_PROXY_EXEC
+/*
+ * Proxy execution: a fair task blocking on a mutex whose owner is queued on
+ * the same runqueue stays queued itself. Whenever it gets picked, the owner
+ * runs in its place, so a preempted low weight owner gets the waiter's turns
+ * instead of the waiter sitting out the owner's slice.
+ *
+ * Only the owner chain within this runqueue is followed; when it leads
+ * elsewhere the waiter blocks as it would without proxying. A waiter picked
+ * after its owner moved away just runs, goes round its mutex_lock() loop once
+ * and blocks properly then.
+ *
+ * The owner keeps its own scheduling context and is charged for the time it
+ * runs; it merely gets picked more often.
+ */
+static inline bool task_is_blocked(struct task_struct *p)
+{
+	return READ_ONCE(p->blocked_mutex) &&
+	       READ_ONCE(p->__state) != TASK_RUNNING &&
+	       p->sched_class == &fair_sched_class && !p->in_iowait;
+}
+
+/*
+ * Follows the blocked_mutex chain from @p. Returns the first task on it that
+ * can run, provided it and everything on the way is queued on @rq, NULL
+ * otherwise. Nothing on @rq but @rq->curr can run meanwhile, so the chain is
+ * stable for as long as we hold the rq lock.
+ */
+static struct task_struct *proxy_owner(struct rq *rq, struct task_struct *p)
+{
+	struct task_struct *owner;
+	unsigned int depth = 0;
+
+	lockdep_assert_rq_held(rq);
+
+	while (task_is_blocked(p)) {
+		owner = __mutex_owner(p->blocked_mutex);
+		/* Released or handed off to @p, let it retry. */
+		if (!owner || owner == p)
+			break;
+
+		if (task_cpu(owner) != cpu_of(rq) || !task_on_rq_queued(owner) ||
+		    owner->sched_class != &fair_sched_class)
+			return NULL;
+
+		/* A cycle is a deadlock; leave reporting it to lockdep. */
+		if (++depth > rq->nr_running)
+			return NULL;
+
+		p = owner;
+	}
+
+	return p;
+}
+
+/* Should @prev, blocking on a mutex, stay queued to proxy for its owner? */
+static inline bool proxy_keep_queued(struct rq *rq, struct task_struct *prev)
+{
+	return task_is_blocked(prev) && proxy_owner(rq, prev);
+}
+
+/*
+ * @next was picked; if it is waiting for a mutex whose owner is here, switch
+ * over to running the owner.
+ */
+static struct task_struct *find_proxy_task(struct rq *rq, struct task_struct *next)
+{
+	struct task_struct *owner;
+
+	if (!task_is_blocked(next))
+		return next;
+
+	owner = proxy_owner(rq, next);
+	if (!owner || owner == next)
+		return next;
+
+	next->sched_class->put_prev_task(rq, next);
+	owner->sched_class->set_next_task(rq, owner, true);
+
+	/* A fair server pick keeps charging the server. */
+	owner->dl_server = next->dl_server;
+	next->dl_server = NULL;
+
+	return owner;
+}
+
+#else /* !CONFIG_SCHED_PROXY_EXEC */
+
+static inline bool proxy_keep_queued(struct rq *rq, struct task_struct *prev)
+{
+	return false;
+}
+
+static inline struct task_struct *find_proxy_task(struct rq *rq, struct task_struct *next)
+{
+	return next;
+}
+
+#endif /* CONFIG_SCHED_PROXY_EXEC */
+
 /*
  * Constants for the sched_mode argument of __schedule().
  *
@@ -6670,7 +6832,7 @@ static void __sched notrace __schedule(unsigned int sched_mode)
 	if (!(sched_mode & SM_MASK_PREEMPT) && prev_state) {
 		if (signal_pending_state(prev_state, prev)) {
 			WRITE_ONCE(prev->__state, TASK_RUNNING);
-		} else {
+		} else if (!proxy_keep_queued(rq, prev)) {
 			prev->sched_contributes_to_load =
 				(prev_state & TASK_UNINTERRUPTIBLE) &&
 				!(prev_state & TASK_NOLOAD) &&
@@ -6701,6 +6863,7 @@ static void __sched notrace __schedule(unsigned int sched_mode)
 	}
 
 	next = pick_next_task(rq, prev, &rf);
+	next = find_proxy_task(rq, next);
 	clear_tsk_need_resched(prev);
 	clear_preempt_need_resched();
 #ifdef CONFIG_SCHED_DEBUG
@@ -7083,12 +7246,16 @@ int default_wake_function(wait_queue_entry_t *curr, unsigned mode, int wake_flag
 }
 EXPORT_SYMBOL(default_wake_function);
 
-static void __setscheduler_prio(struct task_struct *p, int prio)
+void __setscheduler_prio(struct task_struct *p, int prio)
 {
 	if (dl_prio(prio))
 		p->sched_class = &dl_sched_class;
 	else if (rt_prio(prio))
 		p->sched_class = &rt_sched_class;
+#ifdef CONFIG_SCHED_CLASS_EXT
+	else if (task_should_scx(p))
+		p->sched_class = &ext_sched_class;
+#endif
 	else
 		p->sched_class = &fair_sched_class;
 
@@ -9069,6 +9236,7 @@ SYSCALL_DEFINE1(sched_get_priority_max, int, policy)
 	case SCHED_NORMAL:
 	case SCHED_BATCH:
 	case SCHED_IDLE:
+	case SCHED_EXT:
 		ret = 0;
 		break;
 	}
@@ -9096,6 +9264,7 @@ SYSCALL_DEFINE1(sched_get_priority_min, int, policy)
 	case SCHED_NORMAL:
 	case SCHED_BATCH:
 	case SCHED_IDLE:
+	case SCHED_EXT:
 		ret = 0;
 	}
 	return ret;
@@ -9926,9 +10095,14 @@ void __init sched_init(void)
 	int i;
 
 	/* Make sure the linker didn't screw up */
-	BUG_ON(&idle_sched_class != &fair_sched_class + 1 ||
-	       &fair_sched_class != &rt_sched_class + 1 ||
+	BUG_ON(&fair_sched_class != &rt_sched_class + 1 ||
 	       &rt_sched_class   != &dl_sched_class + 1);
+#ifdef CONFIG_SCHED_CLASS_EXT
+	BUG_ON(&ext_sched_class  != &fair_sched_class + 1 ||
+	       &idle_sched_class != &ext_sched_class + 1);
+#else
+	BUG_ON(&idle_sched_class != &fair_sched_class + 1);
+#endif
 #ifdef CONFIG_SMP
 	BUG_ON(&dl_sched_class != &stop_sched_class + 1);
 #endif
@@ -10099,6 +10273,7 @@ void __init sched_init(void)
 	balance_push_set(smp_processor_id(), false);
 #endif
 	init_sched_fair_class();
+	init_sched_ext_class();
 
 	psi_init();
 
@@ -355,6 +355,8 @@ static __init int sched_init_debug(void)
 #ifdef CONFIG_SMP
 	debugfs_create_file("tunable_scaling", 0644, debugfs_sched, NULL, &sched_scaling_fops);
 	debugfs_create_u32("migration_cost_ns", 0644, debugfs_sched, &sysctl_sched_migration_cost);
+	debugfs_create_u32("newidle_cost_cap_ns", 0644, debugfs_sched, &sysctl_sched_newidle_cost_cap);
+	debugfs_create_u32("newidle_backoff_max", 0644, debugfs_sched, &sysctl_sched_newidle_backoff_max);
 	debugfs_create_u32("nr_migrate", 0644, debugfs_sched, &sysctl_sched_nr_migrate);
 
 	mutex_lock(&sched_domains_mutex);
@@ -416,6 +418,11 @@ static void register_sd(struct sched_domain *sd, struct dentry *parent)
 	SDM(ulong, 0644, min_interval);
 	SDM(ulong, 0644, max_interval);
 	SDM(u64,   0644, max_newidle_lb_cost);
+	SDM(u64,   0644, newidle_cost_cap);
+	SDM(ulong, 0444, newidle_attempts);
+	SDM(ulong, 0444, newidle_success);
+	SDM(ulong, 0444, newidle_skipped);
+	SDM(u64,   0444, newidle_time);
 	SDM(u32,   0644, busy_factor);
 	SDM(u32,   0644, imbalance_pct);
 	SDM(u32,   0644, cache_nice_tries);
@@ -811,6 +818,9 @@ do {									\
 		P(sched_goidle);
 		P(ttwu_count);
 		P(ttwu_local);
+		P(blocked_updates);
+		P(blocked_cfs_walked);
+		P(blocked_cfs_skipped);
 	}
 #undef P
 
@@ -0,0 +1,1302 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * BPF extensible scheduler class
+ *
+ * Placement, ordering and CPU selection of the tasks in this class are
+ * decided by a BPF program implementing struct sched_ext_ops, attached as a
+ * struct_ops map. Runnable tasks sit on dispatch queues (DSQs): every CPU has
+ * a local DSQ it picks its next task from, there is one global DSQ and the
+ * BPF scheduler can create custom ones.
+ *
+ * ops.enqueue() dispatches each task it is handed to a DSQ with
+ * scx_bpf_dispatch(). When a CPU's local DSQ runs empty, the global DSQ is
+ * consumed first and then ops.dispatch() gets to move tasks off the custom
+ * DSQs with scx_bpf_consume(); tasks queued on another CPU are migrated over.
+ *
+ * While a BPF scheduler is loaded, SCHED_EXT tasks -- or, with
+ * SCX_OPS_SWITCH_ALL, all SCHED_NORMAL and SCHED_BATCH tasks -- run in this
+ * class, below fair and above idle. An error, a runnable task that didn't
+ * get to run within ops.timeout_ms or unloading the program disables the BPF
+ * scheduler and moves all of its tasks back to the fair class. Disabling is
+ * done by an RT kthread so that it makes progress however broken the BPF
+ * scheduler is.
+ */
+
+enum scx_consts {
+	SCX_EXIT_MSG_LEN		= 1024,
+	SCX_WATCHDOG_MAX_TIMEOUT	= 30 * HZ,
+};
+
+enum scx_exit_kind {
+	SCX_EXIT_NONE,
+	SCX_EXIT_DONE,
+
+	SCX_EXIT_UNREG = 64,	/* BPF unregistration */
+
+	SCX_EXIT_ERROR = 1024,	/* runtime error, @msg has the details */
+	SCX_EXIT_ERROR_BPF,	/* ERROR but through scx_bpf_error() */
+	SCX_EXIT_ERROR_STALL,	/* watchdog detected a stalled task */
+};
+
+/* Passed to ops.exit() to describe why the BPF scheduler is going away. */
+struct scx_exit_info {
+	enum scx_exit_kind	kind;
+	const char		*reason;
+	char			*msg;
+};
+
+enum scx_ops_flags {
+	/* run all SCHED_NORMAL and SCHED_BATCH tasks, not just SCHED_EXT */
+	SCX_OPS_SWITCH_ALL	= 1LLU << 0,
+
+	SCX_OPS_ALL_FLAGS	= SCX_OPS_SWITCH_ALL,
+};
+
+enum scx_enq_flags {
+	/* core enqueue flags passed through to ops.enqueue() */
+	SCX_ENQ_WAKEUP		= ENQUEUE_WAKEUP,
+
+	/* scx_bpf_dispatch() flag: queue at the head of the DSQ */
+	SCX_ENQ_HEAD		= 1LLU << 32,
+};
+
+enum scx_deq_flags {
+	/* core dequeue flags passed through to ops.dequeue() */
+	SCX_DEQ_SLEEP		= DEQUEUE_SLEEP,
+};
+
+enum scx_kick_flags {
+	/* make the current ext task on the CPU give up its slice */
+	SCX_KICK_PREEMPT	= 1LLU << 0,
+};
+
+/**
+ * struct sched_ext_ops - operation table for BPF scheduler implementation
+ *
+ * All callbacks but @init and @exit are invoked with the rq lock held and
+ * must not sleep.
+ */
+struct sched_ext_ops {
+	/**
+	 * @select_cpu: Pick the CPU @p is woken up on. Defaults to
+	 * scx_bpf_select_cpu_dfl().
+	 */
+	s32 (*select_cpu)(struct task_struct *p, s32 prev_cpu, u64 wake_flags);
+
+	/**
+	 * @enqueue: @p became runnable or used up its slice. Must dispatch it
+	 * with scx_bpf_dispatch(). Defaults to FIFO on the global DSQ.
+	 */
+	void (*enqueue)(struct task_struct *p, u64 enq_flags);
+
+	/** @dequeue: @p is no longer runnable or leaves the class */
+	void (*dequeue)(struct task_struct *p, u64 deq_flags);
+
+	/**
+	 * @dispatch: The local DSQ of @cpu and the global DSQ are empty. Move
+	 * tasks to the local DSQ with scx_bpf_consume(). @prev is the ext task
+	 * which was running on @cpu, if any.
+	 */
+	void (*dispatch)(s32 cpu, struct task_struct *prev);
+
+	/** @running: @p starts running on its CPU */
+	void (*running)(struct task_struct *p);
+
+	/** @stopping: @p stops running, @runnable if it's still queued */
+	void (*stopping)(struct task_struct *p, bool runnable);
+
+	/**
+	 * @init: Initialize the BPF scheduler, e.g. create custom DSQs.
+	 * Sleepable. A non-zero return fails loading.
+	 */
+	s32 (*init)(void);
+
+	/** @exit: The BPF scheduler has been disabled. Sleepable. */
+	void (*exit)(struct scx_exit_info *info);
+
+	/** @flags: %SCX_OPS_* flags */
+	u64 flags;
+
+	/**
+	 * @timeout_ms: A runnable task that doesn't get to run for this long
+	 * triggers an error. 0 picks the maximum of 30s.
+	 */
+	u32 timeout_ms;
+
+	/** @name: BPF scheduler's name */
+	char name[SCX_OPS_NAME_LEN];
+};
+
+enum scx_ops_enable_state {
+	SCX_OPS_DISABLED,
+	SCX_OPS_ENABLED,
+	SCX_OPS_DISABLING,
+};
+
+/*
+ * What ops.enqueue() decided through scx_bpf_dispatch(), and the rq
+ * ops.dispatch() is filling for scx_bpf_consume(). Both callbacks run with
+ * the rq lock held and IRQs disabled, a per-CPU copy is enough.
+ */
+struct scx_dsp_ctx {
+	struct rq		*rq;
+	struct task_struct	*enq_task;
+	bool			dispatched;
+	u64			dsq_id;
+	u64			slice;
+	u64			enq_flags;
+};
+
+static DEFINE_PER_CPU(struct scx_dsp_ctx, scx_dsp_ctx);
+
+DEFINE_STATIC_KEY_FALSE(__scx_ops_enabled);
+
+/* Protects loading and unloading, and everything below up to scx_dsq_hash. */
+static DEFINE_MUTEX(scx_ops_enable_mutex);
+static int scx_ops_enable_state_var = SCX_OPS_DISABLED;
+static struct sched_ext_ops scx_ops;
+static void *scx_ops_kdata;
+static unsigned long scx_watchdog_timeout;
+static struct rhashtable scx_dsq_hash;
+
+static const struct rhashtable_params scx_dsq_hash_params = {
+	.key_len		= sizeof_field(struct scx_dispatch_q, id),
+	.key_offset		= offsetof(struct scx_dispatch_q, id),
+	.head_offset		= offsetof(struct scx_dispatch_q, hash_node),
+};
+
+static struct scx_dispatch_q scx_dsq_global;
+
+/* The first error wins, until the next load errors are ignored. */
+static atomic_t scx_exit_kind = ATOMIC_INIT(SCX_EXIT_DONE);
+static char scx_exit_msg[SCX_EXIT_MSG_LEN];
+static struct scx_exit_info scx_exit_info;
+
+static struct kthread_worker *scx_ops_helper;
+
+#define SCX_HAS_OP(op)	(scx_enabled() && scx_ops.op)
+
+static void scx_ops_disable_workfn(struct kthread_work *work);
+static DEFINE_KTHREAD_WORK(scx_ops_disable_work, scx_ops_disable_workfn);
+
+static void scx_watchdog_workfn(struct kthread_work *work);
+static DEFINE_KTHREAD_DELAYED_WORK(scx_watchdog_work, scx_watchdog_workfn);
+
+static void scx_ops_error_irq_workfn(struct irq_work *irq_work)
+{
+	kthread_queue_work(scx_ops_helper, &scx_ops_disable_work);
+}
+
+static DEFINE_IRQ_WORK(scx_ops_error_irq_work, scx_ops_error_irq_workfn);
+
+/*
+ * Record the error and kick off disabling. Can be called from any context,
+ * including with rq locks held, hence the irq_work bounce.
+ */
+static __printf(2, 3) void scx_ops_error_kind(enum scx_exit_kind kind,
+					      const char *fmt, ...)
+{
+	int none = SCX_EXIT_NONE;
+	va_list args;
+
+	if (!atomic_try_cmpxchg(&scx_exit_kind, &none, kind))
+		return;
+
+	va_start(args, fmt);
+	vscnprintf(scx_exit_msg, SCX_EXIT_MSG_LEN, fmt, args);
+	va_end(args);
+
+	irq_work_queue(&scx_ops_error_irq_work);
+}
+
+#define scx_ops_error(fmt, args...)					\
+	scx_ops_error_kind(SCX_EXIT_ERROR, fmt, ##args)
+
+static const char *scx_exit_reason(enum scx_exit_kind kind)
+{
+	switch (kind) {
+	case SCX_EXIT_UNREG:
+		return "BPF scheduler unregistered";
+	case SCX_EXIT_ERROR:
+		return "runtime error";
+	case SCX_EXIT_ERROR_BPF:
+		return "scx_bpf_error";
+	case SCX_EXIT_ERROR_STALL:
+		return "runnable task stall";
+	default:
+		return "<UNKNOWN>";
+	}
+}
+
+static bool ops_cpu_valid(s32 cpu)
+{
+	if (likely(cpu >= 0 && cpu < nr_cpu_ids && cpu_possible(cpu)))
+		return true;
+
+	scx_ops_error("invalid CPU %d", cpu);
+	return false;
+}
+
+/*
+ * Dispatch queues
+ */
+
+static void init_dsq(struct scx_dispatch_q *dsq, u64 dsq_id)
+{
+	memset(dsq, 0, sizeof(*dsq));
+	raw_spin_lock_init(&dsq->lock);
+	INIT_LIST_HEAD(&dsq->list);
+	dsq->id = dsq_id;
+}
+
+static void free_dsq(void *ptr, void *arg)
+{
+	struct scx_dispatch_q *dsq = ptr;
+
+	WARN_ON_ONCE(dsq->nr);
+	kfree(dsq);
+}
+
+static struct scx_dispatch_q *find_user_dsq(u64 dsq_id)
+{
+	if (dsq_id & SCX_DSQ_FLAG_BUILTIN)
+		return NULL;
+
+	return rhashtable_lookup_fast(&scx_dsq_hash, &dsq_id,
+				      scx_dsq_hash_params);
+}
+
+static struct scx_dispatch_q *find_dsq_for_dispatch(struct rq *rq, u64 dsq_id)
+{
+	struct scx_dispatch_q *dsq;
+
+	if (dsq_id == SCX_DSQ_LOCAL)
+		return &rq->scx.local_dsq;
+	if (dsq_id == SCX_DSQ_GLOBAL)
+		return &scx_dsq_global;
+
+	dsq = find_user_dsq(dsq_id);
+	if (unlikely(!dsq)) {
+		scx_ops_error("non-existent DSQ 0x%llx", dsq_id);
+		return &scx_dsq_global;
+	}
+
+	return dsq;
+}
+
+static void dispatch_enqueue(struct scx_dispatch_q *dsq, struct task_struct *p,
+			     u64 enq_flags)
+{
+	raw_spin_lock(&dsq->lock);
+	if (enq_flags & SCX_ENQ_HEAD)
+		list_add(&p->scx.dsq_node, &dsq->list);
+	else
+		list_add_tail(&p->scx.dsq_node, &dsq->list);
+	WRITE_ONCE(dsq->nr, dsq->nr + 1);
+	p->scx.dsq = dsq;
+	raw_spin_unlock(&dsq->lock);
+}
+
+static void task_unlink_from_dsq(struct task_struct *p,
+				 struct scx_dispatch_q *dsq)
+{
+	lockdep_assert_held(&dsq->lock);
+
+	list_del_init(&p->scx.dsq_node);
+	WRITE_ONCE(dsq->nr, dsq->nr - 1);
+}
+
+/*
+ * Take @p, which is queued on its rq whose lock we hold, off whatever DSQ
+ * it's on. If a remote CPU already unlinked it in consume_remote_task(),
+ * resetting @holding_cpu tells that CPU to leave @p alone.
+ */
+static void dispatch_dequeue(struct task_struct *p)
+{
+	struct scx_dispatch_q *dsq = smp_load_acquire(&p->scx.dsq);
+
+	if (!dsq) {
+		p->scx.holding_cpu = -1;
+		return;
+	}
+
+	raw_spin_lock(&dsq->lock);
+	if (p->scx.dsq == dsq) {
+		task_unlink_from_dsq(p, dsq);
+		p->scx.dsq = NULL;
+	}
+	p->scx.holding_cpu = -1;
+	raw_spin_unlock(&dsq->lock);
+}
+
+static bool task_can_run_on_remote_rq(struct task_struct *p, struct rq *rq)
+{
+	int cpu = cpu_of(rq);
+
+	return !is_migration_disabled(p) &&
+	       cpumask_test_cpu(cpu, p->cpus_ptr) && cpu_active(cpu);
+}
+
+/*
+ * Move @p, found on @dsq but queued on @src_rq, to the local DSQ of @rq.
+ * Called with @rq locked but unpinned, drops @dsq->lock. @rq's lock may be
+ * dropped too while the two rq locks are taken in order.
+ */
+static bool consume_remote_task(struct rq *rq, struct scx_dispatch_q *dsq,
+				struct task_struct *p, struct rq *src_rq)
+{
+	int cpu = cpu_of(rq);
+	bool moved = false;
+
+	task_unlink_from_dsq(p, dsq);
+	p->scx.holding_cpu = cpu;
+	/* pairs with smp_load_acquire() in dispatch_dequeue() */
+	smp_store_release(&p->scx.dsq, NULL);
+	get_task_struct(p);
+	raw_spin_unlock(&dsq->lock);
+
+	double_lock_balance(rq, src_rq);
+
+	/* anybody dequeueing @p in the meantime cleared @holding_cpu */
+	if (likely(p->scx.holding_cpu == cpu)) {
+		p->scx.holding_cpu = -1;
+		p->scx.flags |= SCX_TASK_ENQ_LOCAL;
+		deactivate_task(src_rq, p, 0);
+		set_task_cpu(p, cpu);
+		activate_task(rq, p, 0);
+		moved = true;
+	}
+
+	double_unlock_balance(rq, src_rq);
+	put_task_struct(p);
+
+	return moved;
+}
+
+/* Move the first task on @dsq which can run on @rq to @rq's local DSQ. */
+static bool consume_dispatch_q(struct rq *rq, struct scx_dispatch_q *dsq)
+{
+	struct task_struct *p;
+
+	if (!READ_ONCE(dsq->nr))
+		return false;
+
+	raw_spin_lock(&dsq->lock);
+
+	list_for_each_entry(p, &dsq->list, scx.dsq_node) {
+		struct rq *task_rq = task_rq(p);
+
+		if (rq == task_rq) {
+			task_unlink_from_dsq(p, dsq);
+			p->scx.dsq = NULL;
+			raw_spin_unlock(&dsq->lock);
+			dispatch_enqueue(&rq->scx.local_dsq, p, 0);
+			return true;
+		}
+
+		if (task_can_run_on_remote_rq(p, rq))
+			return consume_remote_task(rq, dsq, p, task_rq);
+	}
+
+	raw_spin_unlock(&dsq->lock);
+	return false;
+}
+
+/*
+ * Scheduling class operations
+ */
+
+bool task_should_scx(struct task_struct *p)
+{
+	if (READ_ONCE(scx_ops_enable_state_var) != SCX_OPS_ENABLED)
+		return false;
+	if (p->policy == SCHED_EXT)
+		return true;
+	return (scx_ops.flags & SCX_OPS_SWITCH_ALL) &&
+	       (p->policy == SCHED_NORMAL || p->policy == SCHED_BATCH);
+}
+
+static void update_curr_scx(struct rq *rq)
+{
+	struct task_struct *curr = rq->curr;
+	s64 delta_exec;
+
+	delta_exec = update_curr_common(rq);
+	if (unlikely(delta_exec <= 0))
+		return;
+
+	curr->scx.slice -= min_t(u64, curr->scx.slice, delta_exec);
+}
+
+static void do_enqueue_task(struct rq *rq, struct task_struct *p, u64 enq_flags)
+{
+	struct scx_dsp_ctx *dspc = this_cpu_ptr(&scx_dsp_ctx);
+
+	if (!SCX_HAS_OP(enqueue)) {
+		p->scx.slice = SCX_SLICE_DFL;
+		dispatch_enqueue(&scx_dsq_global, p, 0);
+		return;
+	}
+
+	dspc->enq_task = p;
+	dspc->dispatched = false;
+	scx_ops.enqueue(p, enq_flags);
+	dspc->enq_task = NULL;
+
+	if (unlikely(!dspc->dispatched)) {
+		scx_ops_error("%s[%d] not dispatched by ops.enqueue()",
+			      p->comm, p->pid);
+		p->scx.slice = SCX_SLICE_DFL;
+		dispatch_enqueue(&scx_dsq_global, p, 0);
+		return;
+	}
+
+	p->scx.slice = dspc->slice ?: SCX_SLICE_DFL;
+	dispatch_enqueue(find_dsq_for_dispatch(rq, dspc->dsq_id), p,
+			 dspc->enq_flags);
+}
+
+static void enqueue_task_scx(struct rq *rq, struct task_struct *p, int enq_flags)
+{
+	if (WARN_ON_ONCE(p->scx.flags & SCX_TASK_QUEUED))
+		return;
+
+	p->scx.flags |= SCX_TASK_QUEUED;
+	rq->scx.nr_running++;
+	add_nr_running(rq, 1);
+
+	/* sched_enq_and_set_task() is about to set_next_task() it */
+	if (task_current(rq, p))
+		return;
+
+	if (!(enq_flags & ENQUEUE_RESTORE))
+		p->scx.runnable_at = jiffies;
+	list_add_tail(&p->scx.runnable_node, &rq->scx.runnable_list);
+
+	if (p->scx.flags & SCX_TASK_ENQ_LOCAL) {
+		p->scx.flags &= ~SCX_TASK_ENQ_LOCAL;
+		dispatch_enqueue(&rq->scx.local_dsq, p, 0);
+		return;
+	}
+
+	do_enqueue_task(rq, p, enq_flags);
+}
+
+static void dequeue_task_scx(struct rq *rq, struct task_struct *p, int deq_flags)
+{
+	if (!(p->scx.flags & SCX_TASK_QUEUED))
+		return;
+
+	/* a migration by consume_remote_task() isn't visible to the BPF side */
+	if (!(p->scx.flags & SCX_TASK_ENQ_LOCAL) && SCX_HAS_OP(dequeue))
+		scx_ops.dequeue(p, deq_flags);
+
+	dispatch_dequeue(p);
+	list_del_init(&p->scx.runnable_node);
+
+	p->scx.flags &= ~SCX_TASK_QUEUED;
+	rq->scx.nr_running--;
+	sub_nr_running(rq, 1);
+}
+
+static void yield_task_scx(struct rq *rq)
+{
+	rq->curr->scx.slice = 0;
+}
+
+static void wakeup_preempt_scx(struct rq *rq, struct task_struct *p, int wake_flags)
+{
+}
+
+static void set_next_task_scx(struct rq *rq, struct task_struct *p, bool first)
+{
+	if (p->scx.flags & SCX_TASK_QUEUED) {
+		dispatch_dequeue(p);
+		list_del_init(&p->scx.runnable_node);
+	}
+
+	p->se.exec_start = rq_clock_task(rq);
+
+	if (SCX_HAS_OP(running))
+		scx_ops.running(p);
+}
+
+static void put_prev_task_scx(struct rq *rq, struct task_struct *p)
+{
+	bool queued = p->scx.flags & SCX_TASK_QUEUED;
+
+	update_curr_scx(rq);
+
+	if (SCX_HAS_OP(stopping))
+		scx_ops.stopping(p, queued);
+
+	if (!queued)
+		return;
+
+	p->scx.runnable_at = jiffies;
+	list_add_tail(&p->scx.runnable_node, &rq->scx.runnable_list);
+
+	/*
+	 * Preempted by a higher class, or kept running by balance_scx() as
+	 * nothing else was there: keep going at the head of the local DSQ.
+	 */
+	if (p->scx.slice) {
+		dispatch_enqueue(&rq->scx.local_dsq, p, SCX_ENQ_HEAD);
+		return;
+	}
+
+	do_enqueue_task(rq, p, 0);
+}
+
+static struct task_struct *pick_task_scx(struct rq *rq)
+{
+	return list_first_entry_or_null(&rq->scx.local_dsq.list,
+					struct task_struct, scx.dsq_node);
+}
+
+static struct task_struct *pick_next_task_scx(struct rq *rq)
+{
+	struct task_struct *p = pick_task_scx(rq);
+
+	if (p)
+		set_next_task_scx(rq, p, true);
+
+	return p;
+}
+
+static int balance_scx(struct rq *rq, struct task_struct *prev,
+		       struct rq_flags *rf)
+{
+	struct scx_dsp_ctx *dspc = this_cpu_ptr(&scx_dsp_ctx);
+	bool prev_on_scx = prev->sched_class == &ext_sched_class;
+
+	lockdep_assert_rq_held(rq);
+
+	if (prev_on_scx) {
+		update_curr_scx(rq);
+		/* put_prev_task_scx() keeps it at the head of the local DSQ */
+		if ((prev->scx.flags & SCX_TASK_QUEUED) && prev->scx.slice)
+			return 1;
+	}
+
+	if (rq->scx.local_dsq.nr)
+		return 1;
+
+	if (!scx_enabled())
+		return 0;
+
+	rq_unpin_lock(rq, rf);
+
+	if (!consume_dispatch_q(rq, &scx_dsq_global) && SCX_HAS_OP(dispatch)) {
+		dspc->rq = rq;
+		scx_ops.dispatch(cpu_of(rq), prev_on_scx ? prev : NULL);
+		dspc->rq = NULL;
+	}
+
+	rq_repin_lock(rq, rf);
+
+	if (rq->scx.local_dsq.nr)
+		return 1;
+
+	/* nothing else to run here, let @prev go on rather than idle */
+	if (prev_on_scx && (prev->scx.flags & SCX_TASK_QUEUED)) {
+		prev->scx.slice = SCX_SLICE_DFL;
+		return 1;
+	}
+
+	return 0;
+}
+
+static s32 scx_select_cpu_dfl(struct task_struct *p, s32 prev_cpu,
+			      u64 wake_flags)
+{
+	s32 cpu;
+
+	if (available_idle_cpu(prev_cpu))
+		return prev_cpu;
+
+	/* an idle CPU sharing the LLC with @prev_cpu, then any idle CPU */
+	for_each_cpu_and(cpu, p->cpus_ptr, cpu_online_mask) {
+		if (cpus_share_cache(cpu, prev_cpu) && available_idle_cpu(cpu))
+			return cpu;
+	}
+
+	for_each_cpu_and(cpu, p->cpus_ptr, cpu_online_mask) {
+		if (available_idle_cpu(cpu))
+			return cpu;
+	}
+
+	return prev_cpu;
+}
+
+static int select_task_rq_scx(struct task_struct *p, int prev_cpu,
+			      int wake_flags)
+{
+	s32 cpu;
+
+	if (!SCX_HAS_OP(select_cpu))
+		return scx_select_cpu_dfl(p, prev_cpu, wake_flags);
+
+	/* select_task_rq() falls back for CPUs @p isn't allowed on */
+	cpu = scx_ops.select_cpu(p, prev_cpu, wake_flags);
+	if (!ops_cpu_valid(cpu))
+		return prev_cpu;
+
+	return cpu;
+}
+
+static void task_tick_scx(struct rq *rq, struct task_struct *curr, int queued)
+{
+	update_curr_scx(rq);
+
+	if (!curr->scx.slice)
+		resched_curr(rq);
+}
+
+static void switched_to_scx(struct rq *rq, struct task_struct *p)
+{
+	if (task_on_rq_queued(p) && !task_current(rq, p))
+		wakeup_preempt(rq, p, 0);
+}
+
+static void prio_changed_scx(struct rq *rq, struct task_struct *p, int oldprio)
+{
+}
+
+DEFINE_SCHED_CLASS(ext) = {
+	.enqueue_task		= enqueue_task_scx,
+	.dequeue_task		= dequeue_task_scx,
+	.yield_task		= yield_task_scx,
+
+	.wakeup_preempt		= wakeup_preempt_scx,
+
+	.pick_next_task		= pick_next_task_scx,
+	.put_prev_task		= put_prev_task_scx,
+	.set_next_task		= set_next_task_scx,
+
+#ifdef CONFIG_SMP
+	.balance		= balance_scx,
+	.pick_task		= pick_task_scx,
+	.select_task_rq		= select_task_rq_scx,
+	.set_cpus_allowed	= set_cpus_allowed_common,
+#endif
+
+	.task_tick		= task_tick_scx,
+
+	.prio_changed		= prio_changed_scx,
+	.switched_to		= switched_to_scx,
+
+	.update_curr		= update_curr_scx,
+};
+
+/*
+ * Loading and unloading
+ */
+
+/* Move @p in or out of the ext class as task_should_scx() says. */
+static void scx_task_switch_class(struct task_struct *p)
+{
+	const struct sched_class *old_class;
+	struct sched_enq_and_set_ctx ctx;
+	struct rq_flags rf;
+	struct rq *rq;
+
+	rq = task_rq_lock(p, &rf);
+
+	old_class = p->sched_class;
+	if ((old_class != &fair_sched_class && old_class != &ext_sched_class) ||
+	    task_should_scx(p) == (old_class == &ext_sched_class))
+		goto out_unlock;
+
+	/* not attached to either class yet, wake_up_new_task() does that */
+	if (READ_ONCE(p->__state) == TASK_NEW) {
+		__setscheduler_prio(p, p->prio);
+		goto out_unlock;
+	}
+
+	sched_deq_and_put_task(p, DEQUEUE_SAVE | DEQUEUE_MOVE, &ctx);
+	__setscheduler_prio(p, p->prio);
+	sched_enq_and_set_task(&ctx);
+	check_class_changed(rq, p, old_class, p->prio);
+
+out_unlock:
+	task_rq_unlock(rq, p, &rf);
+}
+
+/*
+ * sched_fork() may have picked the class before a BPF scheduler was loaded or
+ * unloaded, when the task wasn't on the tasklist yet for the switch to see.
+ * tasklist_lock orders the switch against the fork making @p visible, so
+ * looking again once it's visible catches those.
+ */
+void scx_post_fork(struct task_struct *p)
+{
+	if (READ_ONCE(scx_ops_enable_state_var) == SCX_OPS_DISABLED &&
+	    p->sched_class != &ext_sched_class)
+		return;
+
+	scx_task_switch_class(p);
+}
+
+static void scx_switch_all_tasks(void)
+{
+	struct task_struct *g, *p;
+
+	read_lock(&tasklist_lock);
+	for_each_process_thread(g, p)
+		scx_task_switch_class(p);
+	read_unlock(&tasklist_lock);
+}
+
+static void scx_watchdog_workfn(struct kthread_work *work)
+{
+	unsigned long now = jiffies;
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		struct rq *rq = cpu_rq(cpu);
+		struct task_struct *p;
+		unsigned long flags;
+
+		raw_spin_rq_lock_irqsave(rq, flags);
+		list_for_each_entry(p, &rq->scx.runnable_list, scx.runnable_node) {
+			unsigned long waited = now - p->scx.runnable_at;
+
+			if (unlikely(time_after(now, p->scx.runnable_at +
+						scx_watchdog_timeout))) {
+				u32 ms = jiffies_to_msecs(waited);
+
+				scx_ops_error_kind(SCX_EXIT_ERROR_STALL,
+						   "%s[%d] failed to run for %u.%03us",
+						   p->comm, p->pid,
+						   ms / 1000, ms % 1000);
+				break;
+			}
+		}
+		raw_spin_rq_unlock_irqrestore(rq, flags);
+
+		cond_resched();
+	}
+
+	kthread_queue_delayed_work(scx_ops_helper, &scx_watchdog_work,
+				   scx_watchdog_timeout / 2);
+}
+
+static void scx_ops_disable_locked(void)
+{
+	struct scx_exit_info *ei = &scx_exit_info;
+
+	lockdep_assert_held(&scx_ops_enable_mutex);
+
+	if (READ_ONCE(scx_ops_enable_state_var) != SCX_OPS_ENABLED)
+		return;
+
+	/* task_should_scx() now says no, move everybody back to fair */
+	WRITE_ONCE(scx_ops_enable_state_var, SCX_OPS_DISABLING);
+	kthread_cancel_delayed_work_sync(&scx_watchdog_work);
+	scx_switch_all_tasks();
+
+	/* no ops callback can be running or start after this */
+	static_branch_disable(&__scx_ops_enabled);
+	synchronize_rcu();
+
+	ei->kind = atomic_read(&scx_exit_kind);
+	ei->reason = scx_exit_reason(ei->kind);
+	ei->msg = scx_exit_msg;
+
+	if (ei->kind >= SCX_EXIT_ERROR)
+		pr_err("sched_ext: BPF scheduler \"%s\" errored, disabling (%s)\n%s\n",
+		       scx_ops.name, ei->reason, ei->msg);
+	else
+		pr_info("sched_ext: BPF scheduler \"%s\" disabled (%s)\n",
+			scx_ops.name, ei->reason);
+
+	if (scx_ops.exit)
+		scx_ops.exit(ei);
+
+	rhashtable_free_and_destroy(&scx_dsq_hash, free_dsq, NULL);
+	memset(&scx_ops, 0, sizeof(scx_ops));
+	scx_ops_kdata = NULL;
+
+	atomic_set(&scx_exit_kind, SCX_EXIT_DONE);
+	WRITE_ONCE(scx_ops_enable_state_var, SCX_OPS_DISABLED);
+}
+
+static void scx_ops_disable_workfn(struct kthread_work *work)
+{
+	mutex_lock(&scx_ops_enable_mutex);
+	scx_ops_disable_locked();
+	mutex_unlock(&scx_ops_enable_mutex);
+}
+
+static int scx_ops_enable(struct sched_ext_ops *ops)
+{
+	int ret;
+
+	mutex_lock(&scx_ops_enable_mutex);
+
+	if (READ_ONCE(scx_ops_enable_state_var) != SCX_OPS_DISABLED) {
+		ret = -EBUSY;
+		goto err_unlock;
+	}
+
+	ret = rhashtable_init(&scx_dsq_hash, &scx_dsq_hash_params);
+	if (ret)
+		goto err_unlock;
+
+	scx_ops = *ops;
+	scx_ops_kdata = ops;
+	scx_exit_msg[0] = '\0';
+	atomic_set(&scx_exit_kind, SCX_EXIT_NONE);
+
+	if (scx_ops.init) {
+		ret = scx_ops.init();
+		if (ret)
+			goto err_destroy;
+	}
+
+	/* errors from ops.init() only disable once we're up, fail instead */
+	if (atomic_read(&scx_exit_kind) != SCX_EXIT_NONE) {
+		ret = -EINVAL;
+		goto err_destroy;
+	}
+
+	scx_watchdog_timeout = SCX_WATCHDOG_MAX_TIMEOUT;
+	if (scx_ops.timeout_ms)
+		scx_watchdog_timeout = max(msecs_to_jiffies(scx_ops.timeout_ms), 2UL);
+
+	/*
+	 * The callbacks must be live before the first task joins, which it
+	 * can from sched_setscheduler() as soon as the state says so.
+	 */
+	static_branch_enable(&__scx_ops_enabled);
+	WRITE_ONCE(scx_ops_enable_state_var, SCX_OPS_ENABLED);
+
+	kthread_queue_delayed_work(scx_ops_helper, &scx_watchdog_work,
+				   scx_watchdog_timeout / 2);
+	scx_switch_all_tasks();
+
+	pr_info("sched_ext: BPF scheduler \"%s\" enabled\n", scx_ops.name);
+	mutex_unlock(&scx_ops_enable_mutex);
+	return 0;
+
+err_destroy:
+	rhashtable_free_and_destroy(&scx_dsq_hash, free_dsq, NULL);
+	memset(&scx_ops, 0, sizeof(scx_ops));
+	scx_ops_kdata = NULL;
+	atomic_set(&scx_exit_kind, SCX_EXIT_DONE);
+err_unlock:
+	mutex_unlock(&scx_ops_enable_mutex);
+	return ret;
+}
+
+/*
+ * kfuncs
+ */
+
+__bpf_kfunc_start_defs();
+
+/**
+ * scx_bpf_dispatch - Dispatch the task being enqueued to a DSQ
+ * @p: task passed to ops.enqueue()
+ * @dsq_id: DSQ to dispatch to, %SCX_DSQ_LOCAL, %SCX_DSQ_GLOBAL or custom
+ * @slice: duration @p can run for in ns, 0 for %SCX_SLICE_DFL
+ * @enq_flags: %SCX_ENQ_HEAD to queue at the head of the DSQ
+ *
+ * Only allowed from ops.enqueue(), once per call.
+ */
+__bpf_kfunc void scx_bpf_dispatch(struct task_struct *p, u64 dsq_id, u64 slice,
+				  u64 enq_flags)
+{
+	struct scx_dsp_ctx *dspc = this_cpu_ptr(&scx_dsp_ctx);
+
+	if (unlikely(dspc->enq_task != p)) {
+		scx_ops_error("scx_bpf_dispatch() on %s[%d] outside its ops.enqueue()",
+			      p->comm, p->pid);
+		return;
+	}
+
+	if (unlikely(dspc->dispatched)) {
+		scx_ops_error("%s[%d] dispatched twice", p->comm, p->pid);
+		return;
+	}
+
+	dspc->dispatched = true;
+	dspc->dsq_id = dsq_id;
+	dspc->slice = slice;
+	dspc->enq_flags = enq_flags & SCX_ENQ_HEAD;
+}
+
+/**
+ * scx_bpf_consume - Move a task from a DSQ to the current CPU's local DSQ
+ * @dsq_id: %SCX_DSQ_GLOBAL or a custom DSQ
+ *
+ * Only allowed from ops.dispatch(). Takes the first task on @dsq_id which can
+ * run on the current CPU, migrating it if needed. Returns %true if a task was
+ * moved.
+ */
+__bpf_kfunc bool scx_bpf_consume(u64 dsq_id)
+{
+	struct scx_dsp_ctx *dspc = this_cpu_ptr(&scx_dsp_ctx);
+	struct scx_dispatch_q *dsq;
+
+	if (unlikely(!dspc->rq)) {
+		scx_ops_error("scx_bpf_consume() outside ops.dispatch()");
+		return false;
+	}
+
+	if (dsq_id == SCX_DSQ_GLOBAL)
+		dsq = &scx_dsq_global;
+	else
+		dsq = find_user_dsq(dsq_id);
+
+	if (unlikely(!dsq)) {
+		scx_ops_error("consuming non-existent DSQ 0x%llx", dsq_id);
+		return false;
+	}
+
+	return consume_dispatch_q(dspc->rq, dsq);
+}
+
+/**
+ * scx_bpf_create_dsq - Create a custom DSQ
+ * @dsq_id: DSQ to create, bit 63 must be clear
+ * @node: NUMA node to allocate from, or %NUMA_NO_NODE
+ *
+ * Sleepable, for ops.init(). Custom DSQs live until the BPF scheduler is
+ * unloaded.
+ */
+__bpf_kfunc s32 scx_bpf_create_dsq(u64 dsq_id, s32 node)
+{
+	struct scx_dispatch_q *dsq;
+	int ret;
+
+	if (dsq_id & SCX_DSQ_FLAG_BUILTIN)
+		return -EINVAL;
+
+	if (unlikely(node >= (int)nr_node_ids ||
+		     (node < 0 && node != NUMA_NO_NODE)))
+		return -EINVAL;
+
+	dsq = kmalloc_node(sizeof(*dsq), GFP_KERNEL, node);
+	if (!dsq)
+		return -ENOMEM;
+
+	init_dsq(dsq, dsq_id);
+
+	ret = rhashtable_lookup_insert_fast(&scx_dsq_hash, &dsq->hash_node,
+					    scx_dsq_hash_params);
+	if (ret)
+		kfree(dsq);
+
+	return ret;
+}
+
+/**
+ * scx_bpf_dsq_nr_queued - Number of tasks on a DSQ
+ * @dsq_id: %SCX_DSQ_LOCAL for the current CPU's, %SCX_DSQ_GLOBAL or custom
+ *
+ * Returns -%ENOENT for a non-existent DSQ.
+ */
+__bpf_kfunc s32 scx_bpf_dsq_nr_queued(u64 dsq_id)
+{
+	struct scx_dispatch_q *dsq;
+
+	if (dsq_id == SCX_DSQ_LOCAL)
+		return READ_ONCE(this_rq()->scx.local_dsq.nr);
+	if (dsq_id == SCX_DSQ_GLOBAL)
+		return READ_ONCE(scx_dsq_global.nr);
+
+	dsq = find_user_dsq(dsq_id);
+	if (!dsq)
+		return -ENOENT;
+
+	return READ_ONCE(dsq->nr);
+}
+
+/**
+ * scx_bpf_kick_cpu - Make a CPU go through the scheduler
+ * @cpu: CPU to kick
+ * @flags: %SCX_KICK_PREEMPT to also end the slice of its current ext task
+ *
+ * Typically used to wake an idle CPU after dispatching to a shared DSQ. The
+ * kick itself is done from irq_work, the caller may hold an rq lock.
+ */
+__bpf_kfunc void scx_bpf_kick_cpu(s32 cpu, u64 flags)
+{
+	unsigned long irq_flags;
+	struct rq *this_rq;
+
+	if (!ops_cpu_valid(cpu))
+		return;
+
+	local_irq_save(irq_flags);
+
+	this_rq = this_rq();
+	cpumask_set_cpu(cpu, this_rq->scx.cpus_to_kick);
+	if (flags & SCX_KICK_PREEMPT)
+		cpumask_set_cpu(cpu, this_rq->scx.cpus_to_preempt);
+	irq_work_queue(&this_rq->scx.kick_cpus_irq_work);
+
+	local_irq_restore(irq_flags);
+}
+
+/**
+ * scx_bpf_select_cpu_dfl - The default ops.select_cpu()
+ * @p: task being woken up
+ * @prev_cpu: CPU @p last ran on
+ * @wake_flags: %WF_* flags
+ *
+ * Prefers @prev_cpu if idle, then an idle CPU sharing its LLC, then any idle
+ * CPU @p may run on.
+ */
+__bpf_kfunc s32 scx_bpf_select_cpu_dfl(struct task_struct *p, s32 prev_cpu,
+				       u64 wake_flags)
+{
+	if (!ops_cpu_valid(prev_cpu))
+		return prev_cpu;
+
+	return scx_select_cpu_dfl(p, prev_cpu, wake_flags);
+}
+
+/**
+ * scx_bpf_error - Disable the BPF scheduler with an error
+ * @msg__str: message to report
+ */
+__bpf_kfunc void scx_bpf_error(const char *msg__str)
+{
+	scx_ops_error_kind(SCX_EXIT_ERROR_BPF, "%s", msg__str);
+}
+
+__bpf_kfunc_end_defs();
+
+BTF_KFUNCS_START(scx_kfunc_ids)
+BTF_ID_FLAGS(func, scx_bpf_dispatch, KF_RCU)
+BTF_ID_FLAGS(func, scx_bpf_consume)
+BTF_ID_FLAGS(func, scx_bpf_create_dsq, KF_SLEEPABLE)
+BTF_ID_FLAGS(func, scx_bpf_dsq_nr_queued)
+BTF_ID_FLAGS(func, scx_bpf_kick_cpu)
+BTF_ID_FLAGS(func, scx_bpf_select_cpu_dfl, KF_RCU)
+BTF_ID_FLAGS(func, scx_bpf_error)
+BTF_KFUNCS_END(scx_kfunc_ids)
+
+BTF_ID_LIST_SINGLE(scx_ops_btf_ids, struct, sched_ext_ops)
+
+/* The kfuncs are registered for all of struct_ops, keep them to ours. */
+static int scx_kfunc_filter(const struct bpf_prog *prog, u32 kfunc_id)
+{
+	if (!btf_id_set8_contains(&scx_kfunc_ids, kfunc_id))
+		return 0;
+
+	if (!prog->aux->attach_btf || btf_is_module(prog->aux->attach_btf) ||
+	    prog->aux->attach_btf_id != scx_ops_btf_ids[0])
+		return -EACCES;
+
+	return 0;
+}
+
+static const struct btf_kfunc_id_set scx_kfunc_set = {
+	.owner	= THIS_MODULE,
+	.set	= &scx_kfunc_ids,
+	.filter	= scx_kfunc_filter,
+};
+
+/*
+ * struct_ops
+ */
+
+static struct bpf_struct_ops bpf_sched_ext_ops;
+
+static const struct bpf_verifier_ops bpf_scx_verifier_ops = {
+	.get_func_proto		= bpf_base_func_proto,
+	.is_valid_access	= bpf_tracing_btf_ctx_access,
+};
+
+static int bpf_scx_init_member(const struct btf_type *t,
+			       const struct btf_member *member,
+			       void *kdata, const void *udata)
+{
+	const struct sched_ext_ops *uops = udata;
+	struct sched_ext_ops *ops = kdata;
+	u32 moff = __btf_member_bit_offset(t, member) / 8;
+
+	switch (moff) {
+	case offsetof(struct sched_ext_ops, flags):
+		if (uops->flags & ~SCX_OPS_ALL_FLAGS)
+			return -EINVAL;
+		ops->flags = uops->flags;
+		return 1;
+	case offsetof(struct sched_ext_ops, timeout_ms):
+		if (msecs_to_jiffies(uops->timeout_ms) > SCX_WATCHDOG_MAX_TIMEOUT)
+			return -E2BIG;
+		ops->timeout_ms = uops->timeout_ms;
+		return 1;
+	case offsetof(struct sched_ext_ops, name):
+		if (bpf_obj_name_cpy(ops->name, uops->name,
+				     sizeof(ops->name)) <= 0)
+			return -EINVAL;
+		return 1;
+	}
+
+	return 0;
+}
+
+static int bpf_scx_check_member(const struct btf_type *t,
+				const struct btf_member *member,
+				const struct bpf_prog *prog)
+{
+	u32 moff = __btf_member_bit_offset(t, member) / 8;
+
+	switch (moff) {
+	case offsetof(struct sched_ext_ops, init):
+	case offsetof(struct sched_ext_ops, exit):
+		break;
+	default:
+		if (prog->sleepable)
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int bpf_scx_reg(void *kdata)
+{
+	return scx_ops_enable(kdata);
+}
+
+static void bpf_scx_unreg(void *kdata)
+{
+	mutex_lock(&scx_ops_enable_mutex);
+	/* an error may have disabled it already and another one loaded */
+	if (scx_ops_kdata == kdata) {
+		int none = SCX_EXIT_NONE;
+
+		atomic_try_cmpxchg(&scx_exit_kind, &none, SCX_EXIT_UNREG);
+		scx_ops_disable_locked();
+	}
+	mutex_unlock(&scx_ops_enable_mutex);
+}
+
+static int bpf_scx_init(struct btf *btf)
+{
+	return 0;
+}
+
+static s32 select_cpu_stub(struct task_struct *p, s32 prev_cpu, u64 wake_flags)
+{
+	return -EINVAL;
+}
+
+static void enqueue_stub(struct task_struct *p, u64 enq_flags)
+{
+}
+
+static void dequeue_stub(struct task_struct *p, u64 deq_flags)
+{
+}
+
+static void dispatch_stub(s32 cpu, struct task_struct *prev__nullable)
+{
+}
+
+static void running_stub(struct task_struct *p)
+{
+}
+
+static void stopping_stub(struct task_struct *p, bool runnable)
+{
+}
+
+static s32 init_stub(void)
+{
+	return -EINVAL;
+}
+
+static void exit_stub(struct scx_exit_info *info)
+{
+}
+
+static struct sched_ext_ops __bpf_ops_sched_ext_ops = {
+	.select_cpu	= select_cpu_stub,
+	.enqueue	= enqueue_stub,
+	.dequeue	= dequeue_stub,
+	.dispatch	= dispatch_stub,
+	.running	= running_stub,
+	.stopping	= stopping_stub,
+	.init		= init_stub,
+	.exit		= exit_stub,
+};
+
+static struct bpf_struct_ops bpf_sched_ext_ops = {
+	.verifier_ops	= &bpf_scx_verifier_ops,
+	.reg		= bpf_scx_reg,
+	.unreg		= bpf_scx_unreg,
+	.check_member	= bpf_scx_check_member,
+	.init_member	= bpf_scx_init_member,
+	.init		= bpf_scx_init,
+	.name		= "sched_ext_ops",
+	.cfi_stubs	= &__bpf_ops_sched_ext_ops,
+	.owner		= THIS_MODULE,
+};
+
+/*
+ * Initialization
+ */
+
+static void kick_cpus_irq_workfn(struct irq_work *irq_work)
+{
+	struct rq *this_rq = this_rq();
+	s32 cpu;
+
+	for_each_cpu(cpu, this_rq->scx.cpus_to_kick) {
+		struct rq *rq = cpu_rq(cpu);
+		unsigned long flags;
+
+		raw_spin_rq_lock_irqsave(rq, flags);
+		if (cpu_online(cpu)) {
+			if (cpumask_test_cpu(cpu, this_rq->scx.cpus_to_preempt) &&
+			    rq->curr->sched_class == &ext_sched_class)
+				rq->curr->scx.slice = 0;
+			resched_curr(rq);
+		}
+		raw_spin_rq_unlock_irqrestore(rq, flags);
+
+		cpumask_clear_cpu(cpu, this_rq->scx.cpus_to_kick);
+		cpumask_clear_cpu(cpu, this_rq->scx.cpus_to_preempt);
+	}
+}
+
+void __init init_sched_ext_class(void)
+{
+	int cpu;
+
+	init_dsq(&scx_dsq_global, SCX_DSQ_GLOBAL);
+
+	for_each_possible_cpu(cpu) {
+		struct rq *rq = cpu_rq(cpu);
+		int n = cpu_to_node(cpu);
+
+		init_dsq(&rq->scx.local_dsq, SCX_DSQ_LOCAL);
+		INIT_LIST_HEAD(&rq->scx.runnable_list);
+
+		BUG_ON(!zalloc_cpumask_var_node(&rq->scx.cpus_to_kick, GFP_KERNEL, n));
+		BUG_ON(!zalloc_cpumask_var_node(&rq->scx.cpus_to_preempt, GFP_KERNEL, n));
+		rq->scx.kick_cpus_irq_work = IRQ_WORK_INIT_HARD(kick_cpus_irq_workfn);
+	}
+}
+
+static int __init scx_init(void)
+{
+	int ret;
+
+	scx_ops_helper = kthread_create_worker(0, "scx_ops_helper");
+	if (IS_ERR(scx_ops_helper))
+		return PTR_ERR(scx_ops_helper);
+	sched_set_fifo(scx_ops_helper->task);
+
+	ret = register_btf_kfunc_id_set(BPF_PROG_TYPE_STRUCT_OPS, &scx_kfunc_set);
+	ret = ret ?: register_bpf_struct_ops(&bpf_sched_ext_ops, sched_ext_ops);
+
+	return ret;
+}
+late_initcall(scx_init);
@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * BPF extensible scheduler class, see ext.c.
+ */
+#ifndef _KERNEL_SCHED_EXT_H
+#define _KERNEL_SCHED_EXT_H
+
+#ifdef CONFIG_SCHED_CLASS_EXT
+
+DECLARE_STATIC_KEY_FALSE(__scx_ops_enabled);
+#define scx_enabled()		static_branch_unlikely(&__scx_ops_enabled)
+
+static inline void init_scx_entity(struct sched_ext_entity *scx)
+{
+	scx->dsq = NULL;
+	INIT_LIST_HEAD(&scx->dsq_node);
+	INIT_LIST_HEAD(&scx->runnable_node);
+	scx->runnable_at = 0;
+	scx->flags = 0;
+	scx->holding_cpu = -1;
+	scx->slice = SCX_SLICE_DFL;
+}
+
+bool task_should_scx(struct task_struct *p);
+void scx_post_fork(struct task_struct *p);
+void init_sched_ext_class(void);
+
+#else /* !CONFIG_SCHED_CLASS_EXT */
+
+#define scx_enabled()		false
+
+static inline bool task_should_scx(struct task_struct *p) { return false; }
+static inline void scx_post_fork(struct task_struct *p) { }
+static inline void init_sched_ext_class(void) { }
+
+#endif /* CONFIG_SCHED_CLASS_EXT */
+#endif /* _KERNEL_SCHED_EXT_H */
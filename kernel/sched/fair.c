@@ -40,6 +40,7 @@
 
 #include <linux/cpuidle.h>
 #include <linux/interrupt.h>
+#include <linux/memcontrol.h>
 #include <linux/memory-tiers.h>
 #include <linux/mempolicy.h>
 #include <linux/mutex_api.h>
@@ -78,6 +79,16 @@ static unsigned int normalized_sysctl_sched_base_slice	= 750000ULL;
 
 const_debug unsigned int sysctl_sched_migration_cost	= 500000UL;
 
+/*
+ * Newidle balancing: the default for sched_domain::newidle_cost_cap, the
+ * most a newidle pass may cost up to and including a domain (0: no cap), and
+ * the most newidle passes a domain that keeps failing to pull is skipped for.
+ *
+ * (default: no cap, 8 passes; units: nanoseconds, passes)
+ */
+const_debug unsigned int sysctl_sched_newidle_cost_cap		= 0;
+const_debug unsigned int sysctl_sched_newidle_backoff_max	= 8;
+
 static int __init setup_sched_thermal_decay_shift(char *str)
 {
 	pr_warn("Ignoring the deprecated sched_thermal_decay_shift= option\n");
@@ -1858,11 +1869,17 @@ bool should_numa_migrate_memory(struct task_struct *p, struct folio *folio,
 			(20 - PAGE_SHIFT);
 		numa_promotion_adjust_threshold(pgdat, rate_limit, def_th);
 
-		th = pgdat->nbp_threshold ? : def_th;
+		th = mem_cgroup_numa_hot_threshold(folio) ? :
+			pgdat->nbp_threshold ? : def_th;
 		latency = numa_hint_fault_latency(folio);
 		if (latency >= th)
 			return false;
 
+		/* the cgroup budgets are checked before the node-wide one */
+		if (mem_cgroup_numa_promotion_rate_limit(folio,
+							 folio_nr_pages(folio)))
+			return false;
+
 		return !numa_promotion_rate_limit(pgdat, rate_limit,
 						  folio_nr_pages(folio));
 	}
@@ -7266,6 +7283,68 @@ static inline int __select_idle_cpu(int cpu, struct task_struct *p)
 	return -1;
 }
 
+/*
+ * Keep sd_llc_shared's idle masks in step with the idle task being switched
+ * in and out. Bits are tested before they are flipped so that a CPU going in
+ * and out of idle doesn't write the shared line when nothing changed.
+ *
+ * A core is marked idle by the last of its siblings to go idle and cleared by
+ * the first to leave. This races with siblings doing the same, so both masks
+ * are hints: select_idle_cpu() still checks every candidate and clears the
+ * ones it finds busy.
+ */
+void update_idle_cpumask(struct rq *rq, bool idle)
+{
+	struct sched_domain_shared *sds;
+	int cpu = cpu_of(rq);
+	int sibling;
+
+	rcu_read_lock();
+	sds = rcu_dereference(per_cpu(sd_llc_shared, cpu));
+	if (!sds)
+		goto unlock;
+
+	if (idle) {
+		if (!cpumask_test_cpu(cpu, sds_idle_cpus(sds)))
+			cpumask_set_cpu(cpu, sds_idle_cpus(sds));
+	} else {
+		if (cpumask_test_cpu(cpu, sds_idle_cpus(sds)))
+			cpumask_clear_cpu(cpu, sds_idle_cpus(sds));
+	}
+
+#ifdef CONFIG_SCHED_SMT
+	if (!static_branch_unlikely(&sched_smt_present))
+		goto unlock;
+
+	if (idle && !cpumask_subset(cpu_smt_mask(cpu), sds_idle_cpus(sds)))
+		goto unlock;
+
+	for_each_cpu(sibling, cpu_smt_mask(cpu)) {
+		if (cpumask_test_cpu(sibling, sds_idle_cores(sds)) == idle)
+			continue;
+		if (idle)
+			cpumask_set_cpu(sibling, sds_idle_cores(sds));
+		else
+			cpumask_clear_cpu(sibling, sds_idle_cores(sds));
+	}
+#endif
+unlock:
+	rcu_read_unlock();
+}
+
+/*
+ * @cpu was picked out of the idle mask but turned out not to be usable; drop
+ * it if it is running something, its next idle entry will set it again.
+ */
+static inline void sis_clear_busy(struct sched_domain_shared *sds, int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+
+	if (sds && rq->curr != rq->idle &&
+	    cpumask_test_cpu(cpu, sds_idle_cpus(sds)))
+		cpumask_clear_cpu(cpu, sds_idle_cpus(sds));
+}
+
 #ifdef CONFIG_SCHED_SMT
 DEFINE_STATIC_KEY_FALSE(sched_smt_present);
 EXPORT_SYMBOL_GPL(sched_smt_present);
@@ -7375,6 +7454,22 @@ static int select_idle_smt(struct task_struct *p, struct sched_domain *sd, int t
 	return -1;
 }
 
+/*
+ * Same for a core picked out of the idle cores mask that isn't idle after all.
+ */
+static inline void sis_clear_core(struct sched_domain_shared *sds, int core)
+{
+	int cpu;
+
+	if (!sds)
+		return;
+
+	for_each_cpu(cpu, cpu_smt_mask(core)) {
+		if (cpumask_test_cpu(cpu, sds_idle_cores(sds)))
+			cpumask_clear_cpu(cpu, sds_idle_cores(sds));
+	}
+}
+
 #else /* CONFIG_SCHED_SMT */
 
 static inline void set_idle_cores(int cpu, int val)
@@ -7396,6 +7491,10 @@ static inline int select_idle_smt(struct task_struct *p, struct sched_domain *sd
 	return -1;
 }
 
+static inline void sis_clear_core(struct sched_domain_shared *sds, int core)
+{
+}
+
 #endif /* CONFIG_SCHED_SMT */
 
 /*
@@ -7407,8 +7506,9 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 {
 	struct cpumask *cpus = this_cpu_cpumask_var_ptr(select_rq_mask);
 	int i, cpu, idle_cpu = -1, nr = INT_MAX;
-	struct sched_domain_shared *sd_share;
+	struct sched_domain_shared *sd_share, *sd_mask = NULL;
 
+	schedstat_inc(sd->sis_search);
 	cpumask_and(cpus, sched_domain_span(sd), p->cpus_ptr);
 
 	if (sched_feat(SIS_UTIL)) {
@@ -7422,6 +7522,24 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 		}
 	}
 
+	/*
+	 * Only look at what the LLC's idle masks claim is idle; when there is
+	 * supposed to be an idle core but none is in the mask, go straight to
+	 * looking for an idle CPU.
+	 */
+	if (sched_feat(SIS_IDLE_MASK)) {
+		sd_mask = rcu_dereference(per_cpu(sd_llc_shared, target));
+		if (sd_mask) {
+			if (has_idle_core &&
+			    !cpumask_intersects(cpus, sds_idle_cores(sd_mask))) {
+				set_idle_cores(target, false);
+				has_idle_core = false;
+			}
+			cpumask_and(cpus, cpus, has_idle_core ?
+				    sds_idle_cores(sd_mask) : sds_idle_cpus(sd_mask));
+		}
+	}
+
 	if (static_branch_unlikely(&sched_cluster_active)) {
 		struct sched_group *sg = sd->groups;
 
@@ -7430,16 +7548,19 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 				if (!cpumask_test_cpu(cpu, cpus))
 					continue;
 
+				schedstat_inc(sd->sis_scanned);
 				if (has_idle_core) {
 					i = select_idle_core(p, cpu, cpus, &idle_cpu);
 					if ((unsigned int)i < nr_cpumask_bits)
 						return i;
+					sis_clear_core(sd_mask, cpu);
 				} else {
 					if (--nr <= 0)
 						return -1;
 					idle_cpu = __select_idle_cpu(cpu, p);
 					if ((unsigned int)idle_cpu < nr_cpumask_bits)
 						return idle_cpu;
+					sis_clear_busy(sd_mask, cpu);
 				}
 			}
 			cpumask_andnot(cpus, cpus, sched_group_span(sg));
@@ -7447,10 +7568,12 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 	}
 
 	for_each_cpu_wrap(cpu, cpus, target + 1) {
+		schedstat_inc(sd->sis_scanned);
 		if (has_idle_core) {
 			i = select_idle_core(p, cpu, cpus, &idle_cpu);
 			if ((unsigned int)i < nr_cpumask_bits)
 				return i;
+			sis_clear_core(sd_mask, cpu);
 
 		} else {
 			if (--nr <= 0)
@@ -7458,6 +7581,7 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 			idle_cpu = __select_idle_cpu(cpu, p);
 			if ((unsigned int)idle_cpu < nr_cpumask_bits)
 				break;
+			sis_clear_busy(sd_mask, cpu);
 		}
 	}
 
@@ -8174,6 +8298,93 @@ static int find_energy_efficient_cpu(struct task_struct *p, int prev_cpu)
 	return target;
 }
 
+/*
+ * Cache aware placement: threads of one mm are likely to share data, so on
+ * machines with several LLCs per node try to keep them together in the LLC
+ * they are seen running on most.
+ *
+ * That LLC is picked by majority vote over the ticks of the mm's threads: a
+ * tick taken in the preferred LLC adds a vote, a tick elsewhere takes one
+ * away, and once the votes run out the LLC of the tick takes over. Threads
+ * race on the update, which is fine for a hint.
+ */
+#define SCHED_CACHE_VOTES	64
+
+static void task_tick_cache(struct rq *rq, struct task_struct *p)
+{
+	struct mm_struct *mm = p->mm;
+	int cpu = cpu_of(rq);
+	int pref, votes;
+
+	if (!sched_feat(SCHED_CACHE) || !mm || (p->flags & PF_KTHREAD))
+		return;
+
+	if (atomic_read(&mm->mm_users) <= 1)
+		return;
+
+	pref = READ_ONCE(mm->sched_llc_cpu);
+	votes = READ_ONCE(mm->sched_llc_votes);
+
+	if (pref >= 0 && cpus_share_cache(cpu, pref)) {
+		if (votes < SCHED_CACHE_VOTES)
+			WRITE_ONCE(mm->sched_llc_votes, votes + 1);
+	} else if (votes > 0) {
+		WRITE_ONCE(mm->sched_llc_votes, votes - 1);
+	} else {
+		WRITE_ONCE(mm->sched_llc_cpu, cpu);
+		WRITE_ONCE(mm->sched_llc_votes, 1);
+	}
+}
+
+/*
+ * Returns a CPU in the preferred LLC of @p's mm, or -1 if there is none worth
+ * steering to: the vote is not settled yet, or the mm has more users than the
+ * LLC has CPUs, at which point packing it would only overload that LLC.
+ */
+static int task_cache_cpu(struct task_struct *p)
+{
+	struct mm_struct *mm = p->mm;
+	int pref;
+
+	if (!sched_feat(SCHED_CACHE) || !mm || (p->flags & PF_KTHREAD))
+		return -1;
+
+	pref = READ_ONCE(mm->sched_llc_cpu);
+	if (pref < 0 || READ_ONCE(mm->sched_llc_votes) < SCHED_CACHE_VOTES / 2)
+		return -1;
+
+	if (atomic_read(&mm->mm_users) > per_cpu(sd_llc_size, pref))
+		return -1;
+
+	return pref;
+}
+
+/*
+ * Move a wakeup to the preferred LLC, on the same node only and only if that
+ * LLC has an idle CPU @p may run on; otherwise leave @target alone.
+ */
+static int select_cache_cpu(struct task_struct *p, int target)
+{
+	struct sched_domain *sd;
+	int pref, cpu;
+
+	pref = task_cache_cpu(p);
+	if (pref < 0 || cpus_share_cache(target, pref) ||
+	    cpu_to_node(target) != cpu_to_node(pref))
+		return target;
+
+	sd = rcu_dereference(per_cpu(sd_llc, pref));
+	if (!sd || !sd->shared)
+		return target;
+
+	cpu = cpumask_first_and_and(sds_idle_cpus(sd->shared),
+				    sched_domain_span(sd), p->cpus_ptr);
+	if (cpu >= nr_cpu_ids || !available_idle_cpu(cpu))
+		return target;
+
+	return cpu;
+}
+
 /*
  * select_task_rq_fair: Select target runqueue for the waking task in domains
  * that have the relevant SD flag set. In practice, this is SD_BALANCE_WAKE,
@@ -8247,6 +8458,7 @@ select_task_rq_fair(struct task_struct *p, int prev_cpu, int wake_flags)
 		new_cpu = sched_balance_find_dst_cpu(sd, p, cpu, prev_cpu, sd_flag);
 	} else if (wake_flags & WF_TTWU) { /* XXX always ? */
 		/* Fast path */
+		new_cpu = select_cache_cpu(p, new_cpu);
 		new_cpu = select_idle_sibling(p, prev_cpu, new_cpu);
 	}
 	rcu_read_unlock();
@@ -8330,6 +8542,7 @@ balance_fair(struct rq *rq, struct task_struct *prev, struct rq_flags *rf)
 }
 #else
 static inline void set_task_max_allowed_capacity(struct task_struct *p) {}
+static inline void task_tick_cache(struct rq *rq, struct task_struct *p) {}
 #endif /* CONFIG_SMP */
 
 static void set_next_buddy(struct sched_entity *se)
@@ -8979,6 +9192,32 @@ static inline int migrate_degrades_locality(struct task_struct *p,
 }
 #endif
 
+/*
+ * Same as migrate_degrades_locality(), for the preferred LLC of @p's mm
+ * between the LLCs of a node.
+ */
+static int migrate_degrades_cache(struct task_struct *p, struct lb_env *env)
+{
+	int pref;
+
+	if (env->sd->flags & (SD_SHARE_LLC | SD_NUMA))
+		return -1;
+
+	pref = task_cache_cpu(p);
+	if (pref < 0 || cpus_share_cache(env->src_cpu, env->dst_cpu))
+		return -1;
+
+	/* Leaving the preferred LLC is bad, unless it leaves a CPU idle. */
+	if (cpus_share_cache(env->src_cpu, pref))
+		return env->idle == __CPU_NOT_IDLE ? 1 : -1;
+
+	/* Encourage migration to the preferred LLC. */
+	if (cpus_share_cache(env->dst_cpu, pref))
+		return 0;
+
+	return -1;
+}
+
 /*
  * can_migrate_task - may task p from runqueue rq be migrated to this_cpu?
  */
@@ -9047,7 +9286,7 @@ int can_migrate_task(struct task_struct *p, struct lb_env *env)
 	/*
 	 * Aggressive migration if:
 	 * 1) active balance
-	 * 2) destination numa is preferred
+	 * 2) destination numa or LLC is preferred
 	 * 3) task is cache cold, or
 	 * 4) too many balance attempts have failed.
 	 */
@@ -9055,6 +9294,8 @@ int can_migrate_task(struct task_struct *p, struct lb_env *env)
 		return 1;
 
 	tsk_cache_hot = migrate_degrades_locality(p, env);
+	if (tsk_cache_hot == -1)
+		tsk_cache_hot = migrate_degrades_cache(p, env);
 	if (tsk_cache_hot == -1)
 		tsk_cache_hot = task_hot(p, env);
 
@@ -9374,6 +9615,32 @@ static bool __update_blocked_others(struct rq *rq, bool *done)
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
 
+/*
+ * PELT decays in closed form over however many periods have passed since the
+ * last update, so an idle group cfs_rq with nothing to propagate loses
+ * nothing but a little freshness of its tg's load_avg by being left alone
+ * for a while. Bound that to a few periods.
+ */
+#define LAZY_BLOCKED_DECAY_NS	(8 * 1024 * 1024)
+
+static inline bool cfs_rq_lazy_decay(struct cfs_rq *cfs_rq, u64 now)
+{
+	struct rq *rq = rq_of(cfs_rq);
+
+	if (!sched_feat(LAZY_BLOCKED_DECAY))
+		return false;
+
+	/* The root is what cpufreq and load balancing look at. */
+	if (cfs_rq == &rq->cfs)
+		return false;
+
+	if (cfs_rq->nr_running || cfs_rq->propagate ||
+	    READ_ONCE(cfs_rq->removed.nr))
+		return false;
+
+	return now - cfs_rq->avg.last_update_time < LAZY_BLOCKED_DECAY_NS;
+}
+
 static bool __update_blocked_fair(struct rq *rq, bool *done)
 {
 	struct cfs_rq *cfs_rq, *pos;
@@ -9385,9 +9652,18 @@ static bool __update_blocked_fair(struct rq *rq, bool *done)
 	 * list_add_leaf_cfs_rq() for details.
 	 */
 	for_each_leaf_cfs_rq_safe(rq, cfs_rq, pos) {
+		u64 now = cfs_rq_clock_pelt(cfs_rq);
 		struct sched_entity *se;
 
-		if (update_cfs_rq_load_avg(cfs_rq_clock_pelt(cfs_rq), cfs_rq)) {
+		if (cfs_rq_lazy_decay(cfs_rq, now)) {
+			schedstat_inc(rq->blocked_cfs_skipped);
+			if (cfs_rq_has_blocked(cfs_rq))
+				*done = false;
+			continue;
+		}
+		schedstat_inc(rq->blocked_cfs_walked);
+
+		if (update_cfs_rq_load_avg(now, cfs_rq)) {
 			update_tg_load_avg(cfs_rq);
 
 			if (cfs_rq->nr_running == 0)
@@ -9491,6 +9767,7 @@ static void sched_balance_update_blocked_averages(int cpu)
 	rq_lock_irqsave(rq, &rf);
 	update_blocked_load_tick(rq);
 	update_rq_clock(rq);
+	schedstat_inc(rq->blocked_updates);
 
 	decayed |= __update_blocked_others(rq, &done);
 	decayed |= __update_blocked_fair(rq, &done);
@@ -12414,7 +12691,22 @@ static int sched_balance_newidle(struct rq *this_rq, struct rq_flags *rf)
 		if (this_rq->avg_idle < curr_cost + sd->max_newidle_lb_cost)
 			break;
 
+		if (sd->newidle_cost_cap &&
+		    curr_cost + sd->max_newidle_lb_cost > sd->newidle_cost_cap) {
+			sd->newidle_skipped++;
+			break;
+		}
+
 		if (sd->flags & SD_BALANCE_NEWIDLE) {
+			/*
+			 * Back off a domain that keeps coming up empty: skip it
+			 * for 2^failures - 1 passes, up to the backoff max.
+			 */
+			if (sd->newidle_backoff) {
+				sd->newidle_backoff--;
+				sd->newidle_skipped++;
+				continue;
+			}
 
 			pulled_task = sched_balance_rq(this_cpu, this_rq,
 						   sd, CPU_NEWLY_IDLE,
@@ -12424,6 +12716,18 @@ static int sched_balance_newidle(struct rq *this_rq, struct rq_flags *rf)
 			domain_cost = t1 - t0;
 			update_newidle_cost(sd, domain_cost);
 
+			sd->newidle_attempts++;
+			sd->newidle_time += domain_cost;
+			if (pulled_task) {
+				sd->newidle_success++;
+				sd->newidle_failed = 0;
+			} else {
+				if (sd->newidle_failed < 16)
+					sd->newidle_failed++;
+				sd->newidle_backoff = min((1U << sd->newidle_failed) - 1,
+							  sysctl_sched_newidle_backoff_max);
+			}
+
 			curr_cost += domain_cost;
 			t0 = t1;
 		}
@@ -12683,6 +12987,7 @@ static void task_tick_fair(struct rq *rq, struct task_struct *curr, int queued)
 	if (static_branch_unlikely(&sched_numa_balancing))
 		task_tick_numa(rq, curr);
 
+	task_tick_cache(rq, curr);
 	update_misfit_status(curr, rq);
 	check_update_overutilized_status(task_rq(curr));
 
@@ -51,6 +51,18 @@ SCHED_FEAT(TTWU_QUEUE, true)
  */
 SCHED_FEAT(SIS_UTIL, true)
 
+/*
+ * Restrict the LLC scan to the CPUs (or cores) the per-LLC idle masks
+ * claim are idle.
+ */
+SCHED_FEAT(SIS_IDLE_MASK, true)
+
+/*
+ * Steer the threads of a process towards the LLC they mostly run on, on
+ * wakeup and against busy load balancing within a node.
+ */
+SCHED_FEAT(SCHED_CACHE, false)
+
 /*
  * Issue a WARN when we do multiple update_rq_clock() calls
  * in a single rq->lock section. Default disabled because the
@@ -75,6 +87,12 @@ SCHED_FEAT(RT_RUNTIME_SHARE, false)
 SCHED_FEAT(LB_MIN, false)
 SCHED_FEAT(ATTACH_AGE_LOAD, true)
 
+/*
+ * Let update_blocked_averages() skip idle group cfs_rqs that were updated
+ * recently; their decay is caught up on in one go the next time round.
+ */
+SCHED_FEAT(LAZY_BLOCKED_DECAY, true)
+
 SCHED_FEAT(WA_IDLE, true)
 SCHED_FEAT(WA_WEIGHT, true)
 SCHED_FEAT(WA_BIAS, true)
@@ -311,7 +311,8 @@ static int membarrier_global_expedited(void)
 	return 0;
 }
 
-static int membarrier_private_expedited(int flags, int cpu_id)
+static int membarrier_private_expedited(int flags, int cpu_id,
+					const struct cpumask *cpumask)
 {
 	cpumask_var_t tmpmask;
 	struct mm_struct *mm = current->mm;
@@ -375,7 +376,7 @@ static int membarrier_private_expedited(int flags, int cpu_id)
 		int cpu;
 
 		rcu_read_lock();
-		for_each_online_cpu(cpu) {
+		for_each_cpu_and(cpu, cpumask, cpu_online_mask) {
 			struct task_struct *p;
 
 			p = rcu_dereference(cpu_rq(cpu)->curr);
@@ -586,17 +587,68 @@ static int membarrier_get_registrations(void)
 	return registrations_mask;
 }
 
+/*
+ * Copy the MEMBARRIER_CMD_FLAG_CPUMASK mask in from user space. It is made of
+ * u64 words so that its layout does not depend on the ABI of the caller.
+ */
+static int membarrier_get_user_cpumask(const u64 __user *umask,
+				       unsigned int size, struct cpumask *mask)
+{
+	unsigned int nbits;
+	u64 *buf;
+
+	if (!size || size % sizeof(u64))
+		return -EINVAL;
+
+	nbits = min_t(unsigned int, size * BITS_PER_BYTE, nr_cpu_ids);
+	size = BITS_TO_U64(nbits) * sizeof(u64);
+
+	buf = memdup_user(umask, size);
+	if (IS_ERR(buf))
+		return PTR_ERR(buf);
+
+	cpumask_clear(mask);
+	bitmap_from_arr64(cpumask_bits(mask), buf, nbits);
+	kfree(buf);
+	return 0;
+}
+
+static int membarrier_private_expedited_mask(int flags,
+					     const u64 __user *umask,
+					     unsigned int size)
+{
+	cpumask_var_t cpumask;
+	int ret;
+
+	if (!alloc_cpumask_var(&cpumask, GFP_KERNEL))
+		return -ENOMEM;
+
+	ret = membarrier_get_user_cpumask(umask, size, cpumask);
+	if (!ret)
+		ret = membarrier_private_expedited(flags, -1, cpumask);
+
+	free_cpumask_var(cpumask);
+	return ret;
+}
+
 /**
  * sys_membarrier - issue memory barriers on a set of threads
  * @cmd:    Takes command values defined in enum membarrier_cmd.
  * @flags:  Currently needs to be 0 for all commands other than
- *          MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ: in the latter
- *          case it can be MEMBARRIER_CMD_FLAG_CPU, indicating that @cpu_id
- *          contains the CPU on which to interrupt (= restart)
- *          the RSEQ critical section.
+ *          MEMBARRIER_CMD_PRIVATE_EXPEDITED, ..._SYNC_CORE and ..._RSEQ.
+ *          Those can take MEMBARRIER_CMD_FLAG_CPUMASK, indicating that
+ *          @cpumask contains the CPUs to target. For
+ *          MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ it can instead be
+ *          MEMBARRIER_CMD_FLAG_CPU, indicating that @cpu_id contains the CPU
+ *          on which to interrupt (= restart) the RSEQ critical section.
  * @cpu_id: if @flags == MEMBARRIER_CMD_FLAG_CPU, indicates the cpu on which
  *          RSEQ CS should be interrupted (@cmd must be
  *          MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ).
+ * @cpumask: if @flags == MEMBARRIER_CMD_FLAG_CPUMASK, points to the mask of
+ *          CPUs to target, made of u64 words. Only CPUs in the mask which
+ *          run a thread of the calling process are interrupted.
+ * @cpumask_size: if @flags == MEMBARRIER_CMD_FLAG_CPUMASK, the size of
+ *          @cpumask in bytes; must be a multiple of 8.
  *
  * If this system call is not implemented, -ENOSYS is returned. If the
  * command specified does not exist, not available on the running
@@ -622,11 +674,18 @@ static int membarrier_get_registrations(void)
  *        smp_mb()           X           O            O
  *        sys_membarrier()   O           O            O
  */
-SYSCALL_DEFINE3(membarrier, int, cmd, unsigned int, flags, int, cpu_id)
+SYSCALL_DEFINE5(membarrier, int, cmd, unsigned int, flags, int, cpu_id,
+		const u64 __user *, cpumask, unsigned int, cpumask_size)
 {
 	switch (cmd) {
 	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ:
-		if (unlikely(flags && flags != MEMBARRIER_CMD_FLAG_CPU))
+		if (unlikely(flags && flags != MEMBARRIER_CMD_FLAG_CPU &&
+			     flags != MEMBARRIER_CMD_FLAG_CPUMASK))
+			return -EINVAL;
+		break;
+	case MEMBARRIER_CMD_PRIVATE_EXPEDITED:
+	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE:
+		if (unlikely(flags && flags != MEMBARRIER_CMD_FLAG_CPUMASK))
 			return -EINVAL;
 		break;
 	default:
@@ -637,6 +696,19 @@ SYSCALL_DEFINE3(membarrier, int, cmd, unsigned int, flags, int, cpu_id)
 	if (!(flags & MEMBARRIER_CMD_FLAG_CPU))
 		cpu_id = -1;
 
+	if (flags & MEMBARRIER_CMD_FLAG_CPUMASK) {
+		switch (cmd) {
+		case MEMBARRIER_CMD_PRIVATE_EXPEDITED:
+			return membarrier_private_expedited_mask(0, cpumask, cpumask_size);
+		case MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE:
+			return membarrier_private_expedited_mask(MEMBARRIER_FLAG_SYNC_CORE,
+								 cpumask, cpumask_size);
+		default:
+			return membarrier_private_expedited_mask(MEMBARRIER_FLAG_RSEQ,
+								 cpumask, cpumask_size);
+		}
+	}
+
 	switch (cmd) {
 	case MEMBARRIER_CMD_QUERY:
 	{
@@ -658,15 +730,17 @@ SYSCALL_DEFINE3(membarrier, int, cmd, unsigned int, flags, int, cpu_id)
 	case MEMBARRIER_CMD_REGISTER_GLOBAL_EXPEDITED:
 		return membarrier_register_global_expedited();
 	case MEMBARRIER_CMD_PRIVATE_EXPEDITED:
-		return membarrier_private_expedited(0, cpu_id);
+		return membarrier_private_expedited(0, cpu_id, cpu_online_mask);
 	case MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED:
 		return membarrier_register_private_expedited(0);
 	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE:
-		return membarrier_private_expedited(MEMBARRIER_FLAG_SYNC_CORE, cpu_id);
+		return membarrier_private_expedited(MEMBARRIER_FLAG_SYNC_CORE, cpu_id,
+						    cpu_online_mask);
 	case MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_SYNC_CORE:
 		return membarrier_register_private_expedited(MEMBARRIER_FLAG_SYNC_CORE);
 	case MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ:
-		return membarrier_private_expedited(MEMBARRIER_FLAG_RSEQ, cpu_id);
+		return membarrier_private_expedited(MEMBARRIER_FLAG_RSEQ, cpu_id,
+						    cpu_online_mask);
 	case MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_RSEQ:
 		return membarrier_register_private_expedited(MEMBARRIER_FLAG_RSEQ);
 	case MEMBARRIER_CMD_GET_REGISTRATIONS:
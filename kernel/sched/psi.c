@@ -153,6 +153,25 @@ static int __init setup_psi(char *str)
 }
 __setup("psi=", setup_psi);
 
+/*
+ * With psi_leaf_only=1, a task state change is only recorded in the group
+ * of the task's cgroup and in psi_system, instead of in every ancestor.
+ * The times of a cgroup's subtree are then summed up from its descendants
+ * when its pressure is aggregated, see psi_propagate_subtree().  The sum
+ * is exact as long as the descendants don't stall concurrently on the same
+ * CPU, and overstates SOME and FULL pressure of ancestors otherwise.
+ */
+static DEFINE_STATIC_KEY_FALSE(psi_leaf_only);
+static bool psi_leaf_only_enable;
+static int __init setup_psi_leaf_only(char *str)
+{
+	return kstrtobool(str, &psi_leaf_only_enable) == 0;
+}
+__setup("psi_leaf_only=", setup_psi_leaf_only);
+
+/* Serializes the propagation of subtree times, see psi_propagate_subtree() */
+static DEFINE_MUTEX(psi_subtree_lock);
+
 /* Running averages - we need to be higher-res than loadavg */
 #define PSI_FREQ	(2*HZ+1)	/* 2 sec intervals */
 #define EXP_10s		1677		/* 1/exp(2s/10s) as fixed-point */
@@ -213,6 +232,8 @@ void __init psi_init(void)
 
 	if (!cgroup_psi_enabled())
 		static_branch_disable(&psi_cgroups_enabled);
+	else if (psi_leaf_only_enable)
+		static_branch_enable(&psi_leaf_only);
 
 	psi_period = jiffies_to_nsecs(PSI_FREQ);
 	group_init(&psi_system);
@@ -242,6 +263,96 @@ static bool test_state(unsigned int *tasks, enum psi_states state, bool oncpu)
 	}
 }
 
+/* Whether @group's times are summed up from its subtree, see psi_leaf_only */
+static inline bool psi_subtree_group(struct psi_group *group)
+{
+	return static_branch_unlikely(&psi_leaf_only) && group != &psi_system;
+}
+
+/* The next group a task state change has to be recorded in */
+static inline struct psi_group *psi_next_group(struct psi_group *group)
+{
+	if (psi_subtree_group(group))
+		return &psi_system;
+	return group->parent;
+}
+
+/*
+ * Snapshot the times of @groupc's tasks, including the currently active
+ * states, plus the times its child groups propagated into it.
+ */
+static void get_subtree_times(struct psi_group_cpu *groupc, int cpu,
+			      u32 *times)
+{
+	u64 now, state_start;
+	enum psi_states s;
+	unsigned int seq;
+	u32 state_mask;
+
+	do {
+		seq = read_seqcount_begin(&groupc->seq);
+		now = cpu_clock(cpu);
+		memcpy(times, groupc->times, sizeof(groupc->times));
+		state_mask = groupc->state_mask;
+		state_start = groupc->state_start;
+	} while (read_seqcount_retry(&groupc->seq, seq));
+
+	for (s = 0; s < NR_PSI_STATES; s++) {
+		if (state_mask & (1 << s))
+			times[s] += now - state_start;
+		times[s] += groupc->children_times[s];
+	}
+}
+
+/* Propagate the subtree times of @group gathered since last time to its parent */
+static void psi_push_subtree_times(struct psi_group *group)
+{
+	struct psi_group *parent = group->parent;
+	enum psi_states s;
+	int cpu;
+
+	lockdep_assert_held(&psi_subtree_lock);
+
+	/* psi_system records all task changes itself */
+	if (!parent || parent == &psi_system)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct psi_group_cpu *groupc = per_cpu_ptr(group->pcpu, cpu);
+		struct psi_group_cpu *parentc = per_cpu_ptr(parent->pcpu, cpu);
+		u32 times[NR_PSI_STATES];
+
+		get_subtree_times(groupc, cpu, times);
+		for (s = 0; s < NR_PSI_STATES; s++) {
+			parentc->children_times[s] +=
+				times[s] - groupc->pushed_times[s];
+			groupc->pushed_times[s] = times[s];
+		}
+	}
+}
+
+/*
+ * Bring the times of @group up to date with those of its descendants, by
+ * propagating them bottom-up, like rstat does for cgroup stats: each group
+ * hands the growth of its subtree times since the last propagation to its
+ * parent.
+ */
+static void psi_propagate_subtree(struct psi_group *group)
+{
+	struct cgroup_subsys_state *css;
+
+	lockdep_assert_held(&psi_subtree_lock);
+
+	rcu_read_lock();
+	css_for_each_descendant_post(css, &group->cgroup->self) {
+		struct psi_group *desc = cgroup_psi(css->cgroup);
+
+		if (desc != group)
+			psi_push_subtree_times(desc);
+	}
+	rcu_read_unlock();
+}
+
 static void get_recent_times(struct psi_group *group, int cpu,
 			     enum psi_aggregators aggregator, u32 *times,
 			     u32 *pchanged_states)
@@ -256,6 +367,29 @@ static void get_recent_times(struct psi_group *group, int cpu,
 
 	*pchanged_states = 0;
 
+	if (psi_subtree_group(group)) {
+		get_subtree_times(groupc, cpu, times);
+
+		for (s = 0; s < NR_PSI_STATES; s++) {
+			u32 delta = times[s] - groupc->times_prev[aggregator][s];
+
+			groupc->times_prev[aggregator][s] = times[s];
+			times[s] = delta;
+			if (delta)
+				*pchanged_states |= (1 << s);
+		}
+
+		/* Summed up stalls can't exceed the summed up busy time */
+		for (s = 0; s < PSI_NONIDLE; s++)
+			times[s] = min(times[s], times[PSI_NONIDLE]);
+
+		/* The aggregation worker itself runs in the root cgroup */
+		if (current_work() == &group->avgs_work.work &&
+		    (*pchanged_states & (1 << PSI_NONIDLE)))
+			*pchanged_states |= PSI_STATE_RESCHEDULE;
+		return;
+	}
+
 	/* Snapshot a coherent view of the CPU state */
 	do {
 		seq = read_seqcount_begin(&groupc->seq);
@@ -339,10 +473,16 @@ static void collect_percpu_times(struct psi_group *group,
 {
 	u64 deltas[NR_PSI_STATES - 1] = { 0, };
 	unsigned long nonidle_total = 0;
+	bool subtree = psi_subtree_group(group);
 	u32 changed_states = 0;
 	int cpu;
 	int s;
 
+	if (subtree) {
+		mutex_lock(&psi_subtree_lock);
+		psi_propagate_subtree(group);
+	}
+
 	/*
 	 * Collect the per-cpu time buckets and average them into a
 	 * single time sample that is normalized to wallclock time.
@@ -367,6 +507,9 @@ static void collect_percpu_times(struct psi_group *group,
 			deltas[s] += (u64)times[s] * nonidle;
 	}
 
+	if (subtree)
+		mutex_unlock(&psi_subtree_lock);
+
 	/*
 	 * Integrate the sample into the running statistics that are
 	 * reported to userspace: the cumulative stall times and the
@@ -764,6 +907,25 @@ static void record_times(struct psi_group_cpu *groupc, u64 now)
 		groupc->times[PSI_NONIDLE] += delta;
 }
 
+/*
+ * With psi_leaf_only, the ancestors of a group don't see its state changes,
+ * but still need their aggregation to run while the group is busy.
+ */
+static void psi_kick_ancestors(struct psi_group *group, u32 state_mask,
+			       bool wake_clock)
+{
+	while ((group = group->parent) && group != &psi_system) {
+		if (!group->enabled)
+			continue;
+
+		if (state_mask & group->rtpoll_states)
+			psi_schedule_rtpoll_work(group, 1, false);
+
+		if (wake_clock && !delayed_work_pending(&group->avgs_work))
+			schedule_delayed_work(&group->avgs_work, PSI_FREQ);
+	}
+}
+
 static void psi_group_change(struct psi_group *group, int cpu,
 			     unsigned int clear, unsigned int set, u64 now,
 			     bool wake_clock)
@@ -869,6 +1031,9 @@ static void psi_group_change(struct psi_group *group, int cpu,
 
 	if (wake_clock && !delayed_work_pending(&group->avgs_work))
 		schedule_delayed_work(&group->avgs_work, PSI_FREQ);
+
+	if (psi_subtree_group(group))
+		psi_kick_ancestors(group, state_mask, wake_clock);
 }
 
 static inline struct psi_group *task_psi_group(struct task_struct *task)
@@ -911,7 +1076,7 @@ void psi_task_change(struct task_struct *task, int clear, int set)
 	group = task_psi_group(task);
 	do {
 		psi_group_change(group, cpu, clear, set, now, true);
-	} while ((group = group->parent));
+	} while ((group = psi_next_group(group)));
 }
 
 void psi_task_switch(struct task_struct *prev, struct task_struct *next,
@@ -937,7 +1102,7 @@ void psi_task_switch(struct task_struct *prev, struct task_struct *next,
 			}
 
 			psi_group_change(group, cpu, 0, TSK_ONCPU, now, true);
-		} while ((group = group->parent));
+		} while ((group = psi_next_group(group)));
 	}
 
 	if (prev->pid) {
@@ -975,7 +1140,7 @@ void psi_task_switch(struct task_struct *prev, struct task_struct *next,
 			if (group == common)
 				break;
 			psi_group_change(group, cpu, clear, set, now, wake_clock);
-		} while ((group = group->parent));
+		} while ((group = psi_next_group(group)));
 
 		/*
 		 * TSK_ONCPU is handled up to the common ancestor. If there are
@@ -985,7 +1150,7 @@ void psi_task_switch(struct task_struct *prev, struct task_struct *next,
 		 */
 		if ((prev->psi_flags ^ next->psi_flags) & ~TSK_ONCPU) {
 			clear &= ~TSK_ONCPU;
-			for (; group; group = group->parent)
+			for (; group; group = psi_next_group(group))
 				psi_group_change(group, cpu, clear, set, now, wake_clock);
 		}
 	}
@@ -1033,7 +1198,7 @@ void psi_account_irqtime(struct rq *rq, struct task_struct *curr, struct task_st
 
 		if (group->rtpoll_states & (1 << PSI_IRQ_FULL))
 			psi_schedule_rtpoll_work(group, 1, false);
-	} while ((group = group->parent));
+	} while ((group = psi_next_group(group)));
 }
 #endif
 
@@ -1116,9 +1281,25 @@ int psi_cgroup_alloc(struct cgroup *cgroup)
 	}
 	group_init(cgroup->psi);
 	cgroup->psi->parent = cgroup_psi(cgroup_parent(cgroup));
+	cgroup->psi->cgroup = cgroup;
 	return 0;
 }
 
+/*
+ * @cgroup has no tasks left; hand what its subtree times grew by since the
+ * last propagation over to its parent before it disappears from the
+ * parent's subtree.
+ */
+void psi_cgroup_release(struct cgroup *cgroup)
+{
+	if (!static_branch_unlikely(&psi_leaf_only))
+		return;
+
+	mutex_lock(&psi_subtree_lock);
+	psi_push_subtree_times(cgroup->psi);
+	mutex_unlock(&psi_subtree_lock);
+}
+
 void psi_cgroup_free(struct cgroup *cgroup)
 {
 	if (!static_branch_likely(&psi_cgroups_enabled))
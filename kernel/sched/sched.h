@@ -189,7 +189,8 @@ static inline int idle_policy(int policy)
 }
 static inline int fair_policy(int policy)
 {
-	return policy == SCHED_NORMAL || policy == SCHED_BATCH;
+	return policy == SCHED_NORMAL || policy == SCHED_BATCH ||
+	       (IS_ENABLED(CONFIG_SCHED_CLASS_EXT) && policy == SCHED_EXT);
 }
 
 static inline int rt_policy(int policy)
@@ -994,6 +995,19 @@ struct balance_callback {
 	void (*func)(struct rq *rq);
 };
 
+#ifdef CONFIG_SCHED_CLASS_EXT
+/* BPF extensible class' runqueue: */
+struct scx_rq {
+	struct scx_dispatch_q	local_dsq;
+	/* queued tasks which aren't running, for the watchdog */
+	struct list_head	runnable_list;
+	unsigned int		nr_running;
+	cpumask_var_t		cpus_to_kick;
+	cpumask_var_t		cpus_to_preempt;
+	struct irq_work		kick_cpus_irq_work;
+};
+#endif /* CONFIG_SCHED_CLASS_EXT */
+
 /*
  * This is the main, per-CPU runqueue data structure.
  *
@@ -1036,6 +1050,9 @@ struct rq {
 	struct cfs_rq		cfs;
 	struct rt_rq		rt;
 	struct dl_rq		dl;
+#ifdef CONFIG_SCHED_CLASS_EXT
+	struct scx_rq		scx;
+#endif
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	/* list of leaf cfs_rq on this CPU: */
@@ -1163,6 +1180,11 @@ struct rq {
 	/* try_to_wake_up() stats */
 	unsigned int		ttwu_count;
 	unsigned int		ttwu_local;
+
+	/* update_blocked_averages() stats */
+	unsigned int		blocked_updates;
+	unsigned int		blocked_cfs_walked;
+	unsigned int		blocked_cfs_skipped;
 #endif
 
 #ifdef CONFIG_CPU_IDLE
@@ -1451,6 +1473,12 @@ static inline void update_idle_core(struct rq *rq)
 static inline void update_idle_core(struct rq *rq) { }
 #endif
 
+#ifdef CONFIG_SMP
+extern void update_idle_cpumask(struct rq *rq, bool idle);
+#else
+static inline void update_idle_cpumask(struct rq *rq, bool idle) { }
+#endif
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 static inline struct task_struct *task_of(struct sched_entity *se)
 {
@@ -1892,6 +1920,16 @@ DECLARE_PER_CPU(int, sd_llc_size);
 DECLARE_PER_CPU(int, sd_llc_id);
 DECLARE_PER_CPU(int, sd_share_id);
 DECLARE_PER_CPU(struct sched_domain_shared __rcu *, sd_llc_shared);
+
+static inline struct cpumask *sds_idle_cpus(struct sched_domain_shared *sds)
+{
+	return to_cpumask(sds->idle_masks);
+}
+
+static inline struct cpumask *sds_idle_cores(struct sched_domain_shared *sds)
+{
+	return to_cpumask(sds->idle_masks + cpumask_size() / sizeof(long));
+}
 DECLARE_PER_CPU(struct sched_domain __rcu *, sd_numa);
 DECLARE_PER_CPU(struct sched_domain __rcu *, sd_asym_packing);
 DECLARE_PER_CPU(struct sched_domain __rcu *, sd_asym_cpucapacity);
@@ -2367,6 +2405,9 @@ extern const struct sched_class stop_sched_class;
 extern const struct sched_class dl_sched_class;
 extern const struct sched_class rt_sched_class;
 extern const struct sched_class fair_sched_class;
+#ifdef CONFIG_SCHED_CLASS_EXT
+extern const struct sched_class ext_sched_class;
+#endif
 extern const struct sched_class idle_sched_class;
 
 static inline bool sched_stop_runnable(struct rq *rq)
@@ -2544,6 +2585,28 @@ extern void deactivate_task(struct rq *rq, struct task_struct *p, int flags);
 
 extern void wakeup_preempt(struct rq *rq, struct task_struct *p, int flags);
 
+#ifdef CONFIG_SCHED_CLASS_EXT
+/*
+ * Used by the ext class to move tasks between classes when a BPF scheduler
+ * is loaded or unloaded, the same way __sched_setscheduler() does.
+ */
+struct sched_enq_and_set_ctx {
+	struct task_struct	*p;
+	int			queue_flags;
+	bool			queued;
+	bool			running;
+};
+
+extern void sched_deq_and_put_task(struct task_struct *p, int queue_flags,
+				   struct sched_enq_and_set_ctx *ctx);
+extern void sched_enq_and_set_task(struct sched_enq_and_set_ctx *ctx);
+#endif
+
+extern void __setscheduler_prio(struct task_struct *p, int prio);
+extern void check_class_changed(struct rq *rq, struct task_struct *p,
+				const struct sched_class *prev_class,
+				int oldprio);
+
 #ifdef CONFIG_PREEMPT_RT
 #define SCHED_NR_MIGRATE_BREAK 8
 #else
@@ -2552,6 +2615,8 @@ extern void wakeup_preempt(struct rq *rq, struct task_struct *p, int flags);
 
 extern const_debug unsigned int sysctl_sched_nr_migrate;
 extern const_debug unsigned int sysctl_sched_migration_cost;
+extern const_debug unsigned int sysctl_sched_newidle_cost_cap;
+extern const_debug unsigned int sysctl_sched_newidle_backoff_max;
 
 extern unsigned int sysctl_sched_base_slice;
 
@@ -3481,4 +3546,6 @@ static inline void init_sched_mm_cid(struct task_struct *t) { }
 extern u64 avg_vruntime(struct cfs_rq *cfs_rq);
 extern int entity_eligible(struct cfs_rq *cfs_rq, struct sched_entity *se);
 
+#include "ext.h"
+
 #endif /* _KERNEL_SCHED_SCHED_H */
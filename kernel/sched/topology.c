@@ -1626,6 +1626,7 @@ sd_init(struct sched_domain_topology_level *tl,
 		.balance_interval	= sd_weight,
 		.max_newidle_lb_cost	= 0,
 		.last_decay_max_lb_cost	= jiffies,
+		.newidle_cost_cap	= sysctl_sched_newidle_cost_cap,
 		.child			= child,
 #ifdef CONFIG_SCHED_DEBUG
 		.name			= tl->name,
@@ -1681,6 +1682,14 @@ sd_init(struct sched_domain_topology_level *tl,
 		sd->shared = *per_cpu_ptr(sdd->sds, sd_id);
 		atomic_inc(&sd->shared->ref);
 		atomic_set(&sd->shared->nr_busy_cpus, sd_weight);
+		/*
+		 * Start out with everything marked idle; select_idle_cpu()
+		 * drops the CPUs it finds busy.
+		 */
+		cpumask_or(sds_idle_cpus(sd->shared),
+			   sds_idle_cpus(sd->shared), tl->mask(cpu));
+		cpumask_or(sds_idle_cores(sd->shared),
+			   sds_idle_cores(sd->shared), tl->mask(cpu));
 	}
 
 	sd->private = sdd;
@@ -2248,7 +2257,7 @@ static int __sdt_alloc(const struct cpumask *cpu_map)
 
 			*per_cpu_ptr(sdd->sd, j) = sd;
 
-			sds = kzalloc_node(sizeof(struct sched_domain_shared),
+			sds = kzalloc_node(sizeof(struct sched_domain_shared) + 2 * cpumask_size(),
 					GFP_KERNEL, cpu_to_node(j));
 			if (!sds)
 				return -ENOMEM;
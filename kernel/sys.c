@@ -16,6 +16,8 @@
 #include <linux/fs.h>
 #include <linux/kmod.h>
 #include <linux/ksm.h>
+#include <linux/khugepaged.h>
+#include <linux/futex.h>
 #include <linux/perf_event.h>
 #include <linux/resource.h>
 #include <linux/kernel.h>
@@ -2640,6 +2642,21 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 			clear_bit(MMF_DISABLE_THP, &me->mm->flags);
 		mmap_write_unlock(me->mm);
 		break;
+	case PR_GET_THP_COLLAPSE_PRIO:
+		if (arg2 || arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = khugepaged_get_collapse_prio(me->mm);
+		break;
+	case PR_SET_THP_COLLAPSE_PRIO:
+		if (arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = khugepaged_set_collapse_prio(me->mm, arg2);
+		break;
+	case PR_FUTEX_HASH:
+		if (arg5)
+			return -EINVAL;
+		error = futex_hash_prctl(arg2, arg3, arg4);
+		break;
 	case PR_MPX_ENABLE_MANAGEMENT:
 	case PR_MPX_DISABLE_MANAGEMENT:
 		/* No longer implemented: */
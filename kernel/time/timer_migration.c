@@ -5,6 +5,8 @@
  * Copyright(C) 2022 linutronix GmbH
  */
 #include <linux/cpuhotplug.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/smp.h>
 #include <linux/spinlock.h>
@@ -420,6 +422,50 @@ static struct list_head *tmigr_level_list __read_mostly;
 static unsigned int tmigr_hierarchy_levels __read_mostly;
 static unsigned int tmigr_crossnode_level __read_mostly;
 
+/*
+ * Group sizes of the per node levels and of the levels crossing nodes. Small
+ * lowest level groups keep a CPU from being woken up for the timers of many
+ * idle siblings, large groups keep the hierarchy flat and the remote expiry
+ * walks short.
+ */
+static unsigned int tmigr_group_size __ro_after_init = TMIGR_CHILDREN_PER_GROUP;
+static unsigned int tmigr_crossnode_group_size __ro_after_init = TMIGR_CHILDREN_PER_GROUP;
+
+static int __init tmigr_parse_group_size(char *str, unsigned int *size)
+{
+	unsigned int val;
+
+	if (kstrtouint(str, 0, &val) || val < 2 ||
+	    val > TMIGR_CHILDREN_PER_GROUP || !is_power_of_2(val)) {
+		pr_warn("Timer migration: invalid group size '%s', must be a power of 2 between 2 and %d\n",
+			str, TMIGR_CHILDREN_PER_GROUP);
+		return 0;
+	}
+
+	*size = val;
+	return 1;
+}
+
+static int __init tmigr_group_size_setup(char *str)
+{
+	return tmigr_parse_group_size(str, &tmigr_group_size);
+}
+__setup("tmigr_group_size=", tmigr_group_size_setup);
+
+static int __init tmigr_crossnode_group_size_setup(char *str)
+{
+	return tmigr_parse_group_size(str, &tmigr_crossnode_group_size);
+}
+__setup("tmigr_crossnode_group_size=", tmigr_crossnode_group_size_setup);
+
+static inline unsigned int tmigr_level_group_size(unsigned int lvl)
+{
+	if (lvl < tmigr_crossnode_level)
+		return tmigr_group_size;
+
+	return tmigr_crossnode_group_size;
+}
+
 static DEFINE_PER_CPU(struct tmigr_cpu, tmigr_cpu);
 
 #define TMIGR_NONE	0xFF
@@ -538,6 +584,10 @@ struct tmigr_walk {
  *			hierarchy. When the CPU is idle and the whole hierarchy is
  *			idle, only the first event of the top level has to be
  *			considered.
+ * @depth:		number of levels handled by the remote expiry walk;
+ *			required in tmigr_handle_remote() only
+ * @expired:		number of idle CPUs whose timers were expired by the
+ *			walk; required in tmigr_handle_remote() only
  */
 struct tmigr_remote_data {
 	unsigned long	basej;
@@ -546,6 +596,8 @@ struct tmigr_remote_data {
 	u8		childmask;
 	bool		check;
 	bool		tmc_active;
+	unsigned int	depth;
+	unsigned int	expired;
 };
 
 /*
@@ -894,9 +946,14 @@ static u64 tmigr_new_timer(struct tmigr_cpu *tmc, u64 nextexp)
 	return data.firstexp;
 }
 
-static void tmigr_handle_remote_cpu(unsigned int cpu, u64 now,
+/*
+ * Returns true when the timers of @cpu were expired, i.e. when @cpu is not the
+ * local CPU and was not taken care of in the meantime.
+ */
+static bool tmigr_handle_remote_cpu(unsigned int cpu, u64 now,
 				    unsigned long jif)
 {
+	bool expired = false;
 	struct timer_events tevt;
 	struct tmigr_walk data;
 	struct tmigr_cpu *tmc;
@@ -923,7 +980,7 @@ static void tmigr_handle_remote_cpu(unsigned int cpu, u64 now,
 	if (!tmc->online || tmc->remote || tmc->cpuevt.ignore ||
 	    now < tmc->cpuevt.nextevt.expires) {
 		raw_spin_unlock_irq(&tmc->lock);
-		return;
+		return false;
 	}
 
 	trace_tmigr_handle_remote_cpu(tmc);
@@ -931,11 +988,18 @@ static void tmigr_handle_remote_cpu(unsigned int cpu, u64 now,
 	tmc->remote = true;
 	WRITE_ONCE(tmc->wakeup, KTIME_MAX);
 
+	if (cpu != smp_processor_id()) {
+		tmc->expired_remotely++;
+		expired = true;
+	}
+
 	/* Drop the lock to allow the remote CPU to exit idle */
 	raw_spin_unlock_irq(&tmc->lock);
 
-	if (cpu != smp_processor_id())
+	if (expired) {
 		timer_expire_remote(cpu);
+		this_cpu_inc(tmigr_cpu.remote_expiries);
+	}
 
 	/*
 	 * Lock ordering needs to be preserved - timer_base locks before tmigr
@@ -991,6 +1055,8 @@ static void tmigr_handle_remote_cpu(unsigned int cpu, u64 now,
 unlock:
 	tmc->remote = false;
 	raw_spin_unlock_irq(&tmc->lock);
+
+	return expired;
 }
 
 static bool tmigr_handle_remote_up(struct tmigr_group *group,
@@ -1025,9 +1091,11 @@ static bool tmigr_handle_remote_up(struct tmigr_group *group,
 	if (evt) {
 		unsigned int remote_cpu = evt->cpu;
 
+		group->remote_expiries++;
 		raw_spin_unlock_irq(&group->lock);
 
-		tmigr_handle_remote_cpu(remote_cpu, now, jif);
+		if (tmigr_handle_remote_cpu(remote_cpu, now, jif))
+			data->expired++;
 
 		/* check if there is another event, that needs to be handled */
 		goto again;
@@ -1041,6 +1109,8 @@ static bool tmigr_handle_remote_up(struct tmigr_group *group,
 	 */
 	data->childmask = group->childmask;
 	data->firstexp = group->next_expiry;
+	data->depth++;
+	group->walks++;
 
 	raw_spin_unlock_irq(&group->lock);
 
@@ -1062,6 +1132,8 @@ void tmigr_handle_remote(void)
 
 	data.childmask = tmc->childmask;
 	data.firstexp = KTIME_MAX;
+	data.depth = 0;
+	data.expired = 0;
 
 	/*
 	 * NOTE: This is a doubled check because the migrator test will be done
@@ -1076,6 +1148,10 @@ void tmigr_handle_remote(void)
 		 */
 		if (READ_ONCE(tmc->wakeup) == KTIME_MAX)
 			return;
+
+		/* The CPU was woken up as idle migrator */
+		tmc->idle_wakeups++;
+		trace_tmigr_cpu_idle_wakeup(tmc);
 	}
 
 	data.now = get_jiffies_update(&data.basej);
@@ -1090,6 +1166,8 @@ void tmigr_handle_remote(void)
 
 	__walk_groups(&tmigr_handle_remote_up, &data, tmc);
 
+	trace_tmigr_handle_remote_walk(tmc, data.depth, data.expired);
+
 	raw_spin_lock_irq(&tmc->lock);
 	WRITE_ONCE(tmc->wakeup, data.firstexp);
 	raw_spin_unlock_irq(&tmc->lock);
@@ -1483,7 +1561,7 @@ static struct tmigr_group *tmigr_get_group(unsigned int cpu, int node,
 			continue;
 
 		/* Capacity left? */
-		if (tmp->num_children >= TMIGR_CHILDREN_PER_GROUP)
+		if (tmp->num_children >= tmigr_level_group_size(lvl))
 			continue;
 
 		/*
@@ -1740,6 +1818,58 @@ static int tmigr_cpu_offline(unsigned int cpu)
 	return 0;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int tmigr_stats_show(struct seq_file *m, void *v)
+{
+	struct tmigr_group *group;
+	unsigned int lvl, cpu;
+
+	seq_printf(m, "levels: %u crossnode_level: %u group_size: %u crossnode_group_size: %u\n",
+		   tmigr_hierarchy_levels, tmigr_crossnode_level,
+		   tmigr_group_size, tmigr_crossnode_group_size);
+
+	seq_puts(m, "\nlevel groups walks remote_expiries\n");
+
+	mutex_lock(&tmigr_mutex);
+	for (lvl = 0; lvl < tmigr_hierarchy_levels; lvl++) {
+		unsigned long walks = 0, remote = 0;
+		unsigned int groups = 0;
+
+		list_for_each_entry(group, &tmigr_level_list[lvl], list) {
+			groups++;
+			walks += data_race(group->walks);
+			remote += data_race(group->remote_expiries);
+		}
+		seq_printf(m, "%u %u %lu %lu\n", lvl, groups, walks, remote);
+	}
+	mutex_unlock(&tmigr_mutex);
+
+	seq_puts(m, "\ncpu idle_wakeups remote_expiries expired_remotely\n");
+
+	for_each_possible_cpu(cpu) {
+		struct tmigr_cpu *tmc = per_cpu_ptr(&tmigr_cpu, cpu);
+
+		if (!tmc->tmgroup)
+			continue;
+
+		seq_printf(m, "%u %lu %lu %lu\n", cpu,
+			   data_race(tmc->idle_wakeups),
+			   data_race(tmc->remote_expiries),
+			   data_race(tmc->expired_remotely));
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(tmigr_stats);
+
+static void __init tmigr_debugfs_init(void)
+{
+	debugfs_create_file("timer_migration", 0444, NULL, NULL, &tmigr_stats_fops);
+}
+#else
+static inline void tmigr_debugfs_init(void) { }
+#endif
+
 static int __init tmigr_init(void)
 {
 	unsigned int cpulvl, nodelvl, cpus_per_node, i;
@@ -1767,11 +1897,11 @@ static int __init tmigr_init(void)
 
 	/* Calc the hierarchy levels required to hold the CPUs of a node */
 	cpulvl = DIV_ROUND_UP(order_base_2(cpus_per_node),
-			      ilog2(TMIGR_CHILDREN_PER_GROUP));
+			      ilog2(tmigr_group_size));
 
 	/* Calculate the extra levels to connect all nodes */
 	nodelvl = DIV_ROUND_UP(order_base_2(nnodes),
-			       ilog2(TMIGR_CHILDREN_PER_GROUP));
+			       ilog2(tmigr_crossnode_group_size));
 
 	tmigr_hierarchy_levels = cpulvl + nodelvl;
 
@@ -1792,15 +1922,17 @@ static int __init tmigr_init(void)
 		INIT_LIST_HEAD(&tmigr_level_list[i]);
 
 	pr_info("Timer migration: %d hierarchy levels; %d children per group;"
-		" %d crossnode level\n",
-		tmigr_hierarchy_levels, TMIGR_CHILDREN_PER_GROUP,
-		tmigr_crossnode_level);
+		" %d crossnode level; %d children per crossnode group\n",
+		tmigr_hierarchy_levels, tmigr_group_size,
+		tmigr_crossnode_level, tmigr_crossnode_group_size);
 
 	ret = cpuhp_setup_state(CPUHP_AP_TMIGR_ONLINE, "tmigr:online",
 				tmigr_cpu_online, tmigr_cpu_offline);
 	if (ret)
 		goto err;
 
+	tmigr_debugfs_init();
+
 	return 0;
 
 err:
@@ -2,7 +2,11 @@
 #ifndef _KERNEL_TIME_MIGRATION_H
 #define _KERNEL_TIME_MIGRATION_H
 
-/* Per group capacity. Must be a power of 2! */
+/*
+ * Per group capacity. Must be a power of 2! It is the upper limit for the
+ * tmigr_group_size= and tmigr_crossnode_group_size= boot parameters, as
+ * the childmask of a group is a u8.
+ */
 #define TMIGR_CHILDREN_PER_GROUP 8
 
 /**
@@ -39,8 +43,8 @@ struct tmigr_event {
  *			tmigr_crossnode_level); otherwise it is set to
  *			NUMA_NO_NODE
  * @num_children:	Counter of group children to make sure the group is only
- *			filled with TMIGR_CHILDREN_PER_GROUP; Required for setup
- *			only
+ *			filled up to the group size of its level; Required for
+ *			setup only
  * @childmask:		childmask of the group in the parent group; is set
  *			during setup and will never change; can be read
  *			lockless
@@ -48,6 +52,10 @@ struct tmigr_event {
  *			tmigr_level_list; is required during setup when a
  *			new group needs to be connected to the existing
  *			hierarchy groups
+ * @walks:		Number of remote expiry hierarchy walks which handled
+ *			the group; protected by @lock, statistics only
+ * @remote_expiries:	Number of expired events of idle children handed out
+ *			by the group; protected by @lock, statistics only
  */
 struct tmigr_group {
 	raw_spinlock_t		lock;
@@ -61,6 +69,8 @@ struct tmigr_group {
 	unsigned int		num_children;
 	u8			childmask;
 	struct list_head	list;
+	unsigned long		walks;
+	unsigned long		remote_expiries;
 };
 
 /**
@@ -85,6 +95,13 @@ struct tmigr_group {
  *			is returned to timer code in the idle path and is only
  *			used in idle path.
  * @cpuevt:		CPU event which could be enqueued into the parent group
+ * @idle_wakeups:	Number of times the CPU handled remote timers only
+ *			because it was the last CPU going idle and had to wake
+ *			up for the first event of the hierarchy; statistics only
+ * @remote_expiries:	Number of times the CPU expired timers of another
+ *			idle CPU; statistics only
+ * @expired_remotely:	Number of times the timers of the CPU were expired by
+ *			another CPU; protected by @lock, statistics only
  */
 struct tmigr_cpu {
 	raw_spinlock_t		lock;
@@ -95,6 +112,9 @@ struct tmigr_cpu {
 	u8			childmask;
 	u64			wakeup;
 	struct tmigr_event	cpuevt;
+	unsigned long		idle_wakeups;
+	unsigned long		remote_expiries;
+	unsigned long		expired_remotely;
 };
 
 /**
@@ -14,6 +14,14 @@
 
 #include "trace.h"
 
+/*
+ * The number of rethook nodes in use at any time is bounded by how many
+ * probed functions can be active at once on a CPU, not by how many
+ * functions are probed. Don't let wide probes allocate a pool that
+ * scales with the number of probe sites.
+ */
+#define FPROBE_MAX_ACTIVE_PER_CPU	64
+
 struct fprobe_rethook_node {
 	struct rethook_node node;
 	unsigned long entry_ip;
@@ -198,7 +206,8 @@ static int fprobe_init_rethook(struct fprobe *fp, int num)
 	if (fp->nr_maxactive)
 		num = fp->nr_maxactive;
 	else
-		num *= num_possible_cpus() * 2;
+		num = min(num, FPROBE_MAX_ACTIVE_PER_CPU) *
+		      num_possible_cpus() * 2;
 	if (num <= 0)
 		return -EINVAL;
 
@@ -33,6 +33,7 @@ static struct trace_buffer *buffer;
 static struct task_struct *producer;
 static struct task_struct *consumer;
 static unsigned long read;
+static unsigned long read_pages;
 
 static unsigned int disable_reader;
 module_param(disable_reader, uint, 0644);
@@ -60,6 +61,10 @@ MODULE_PARM_DESC(producer_fifo, "use fifo for producer: 0 - disabled, 1 - low pr
 module_param(consumer_fifo, int, 0644);
 MODULE_PARM_DESC(consumer_fifo, "use fifo for consumer: 0 - disabled, 1 - low prio, 2 - fifo");
 
+static unsigned int read_mode;
+module_param(read_mode, uint, 0644);
+MODULE_PARM_DESC(read_mode, "consumer: 0 - alternate, 1 - events only, 2 - pages only");
+
 static int read_events;
 
 static int test_error;
@@ -121,6 +126,7 @@ static enum event_status read_page(int cpu)
 	page_size = ring_buffer_subbuf_size_get(buffer);
 	ret = ring_buffer_read_page(buffer, bpage, page_size, cpu, 1);
 	if (ret >= 0) {
+		read_pages++;
 		rpage = ring_buffer_read_page_data(bpage);
 		/* The commit may have missed event flags set, clear them */
 		commit = local_read(&rpage->commit) & 0xfffff;
@@ -183,10 +189,20 @@ static enum event_status read_page(int cpu)
 
 static void ring_buffer_consumer(void)
 {
-	/* toggle between reading pages and events */
-	read_events ^= 1;
+	/* toggle between reading pages and events, unless told otherwise */
+	switch (read_mode) {
+	case 1:
+		read_events = 1;
+		break;
+	case 2:
+		read_events = 0;
+		break;
+	default:
+		read_events ^= 1;
+	}
 
 	read = 0;
+	read_pages = 0;
 	/*
 	 * Continue running until the producer specifically asks to stop
 	 * and is ready for the completion.
@@ -331,6 +347,8 @@ static void ring_buffer_producer(void)
 	else
 		trace_printk("Read:     %ld  (by %s)\n", read,
 			read_events ? "events" : "pages");
+	if (!disable_reader && !read_events)
+		trace_printk("Pages:    %ld\n", read_pages);
 	trace_printk("Entries:  %lld\n", entries);
 	trace_printk("Total:    %lld\n", entries + overruns + read);
 	trace_printk("Missed:   %ld\n", missed);
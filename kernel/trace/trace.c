@@ -5604,7 +5604,7 @@ static const char readme_msg[] =
 	"\t            [:<var1>=<field|var_ref|numeric_literal>[,<var2>=...]]\n"
 	"\t            [:values=<field1[,field2,...]>]\n"
 	"\t            [:sort=<field1[,field2,...]>]\n"
-	"\t            [:size=#entries]\n"
+	"\t            [:size=#entries][:spill=#maps]\n"
 	"\t            [:pause][:continue][:clear]\n"
 	"\t            [:name=histname1]\n"
 	"\t            [:nohitcount]\n"
@@ -5636,6 +5636,9 @@ static const char readme_msg[] =
 	"\t    be modified by appending '.descending' or '.ascending' to a\n"
 	"\t    sort field.  The 'size' parameter can be used to specify more\n"
 	"\t    or fewer than the default 2048 entries for the hashtable size.\n"
+	"\t    The 'spill' parameter allows up to that many additional\n"
+	"\t    hashtables, each twice the size of the previous one, to be\n"
+	"\t    allocated as the table fills up, instead of dropping new keys.\n"
 	"\t    If a hist trigger is given a name using the 'name' parameter,\n"
 	"\t    its histogram data will be shared with other triggers of the\n"
 	"\t    same name, and trigger hits will update this common data.\n\n"
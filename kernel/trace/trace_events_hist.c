@@ -526,6 +526,7 @@ struct hist_trigger_attrs {
 	bool		ts_in_usecs;
 	bool		no_hitcount;
 	unsigned int	map_bits;
+	unsigned int	max_spill;
 
 	char		*assignment_str[TRACING_MAP_VARS_MAX];
 	unsigned int	n_assignments;
@@ -1505,6 +1506,17 @@ static int parse_assignment(struct trace_array *tr,
 			goto out;
 		}
 		attrs->map_bits = map_bits;
+	} else if ((len = str_has_prefix(str, "spill="))) {
+		unsigned int max_spill;
+
+		ret = kstrtouint(str + len, 0, &max_spill);
+		if (ret)
+			goto out;
+		if (max_spill > TRACING_MAP_SPILL_MAX) {
+			ret = -EINVAL;
+			goto out;
+		}
+		attrs->max_spill = max_spill;
 	} else {
 		char *assignment;
 
@@ -5126,6 +5138,10 @@ create_hist_data(unsigned int map_bits,
 		goto free;
 	}
 
+	ret = tracing_map_set_spill(hist_data->map, attrs->max_spill);
+	if (ret)
+		goto free;
+
 	ret = create_tracing_map_fields(hist_data);
 	if (ret)
 		goto free;
@@ -6049,6 +6065,8 @@ static int event_hist_trigger_print(struct seq_file *m,
 			seq_puts(m, ".descending");
 	}
 	seq_printf(m, ":size=%u", (1 << hist_data->map->map_bits));
+	if (hist_data->map->max_spill)
+		seq_printf(m, ":spill=%u", hist_data->map->max_spill);
 	if (hist_data->enable_timestamps)
 		seq_printf(m, ":clock=%s", hist_data->attrs->clock);
 	if (hist_data->attrs->no_hitcount)
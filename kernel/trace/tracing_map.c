@@ -449,12 +449,21 @@ static struct tracing_map_elt *tracing_map_elt_alloc(struct tracing_map *map)
 	return ERR_PTR(err);
 }
 
+static bool tracing_map_full(struct tracing_map *map)
+{
+	return atomic_read(&map->next_elt) >= (int)map->max_elts - 1;
+}
+
 static struct tracing_map_elt *get_free_elt(struct tracing_map *map)
 {
 	struct tracing_map_elt *elt = NULL;
 	int idx;
 
 	idx = atomic_inc_return(&map->next_elt);
+	if (idx == map->max_elts - map->max_elts / 4 &&
+	    map->root->max_spill && !READ_ONCE(map->spill))
+		irq_work_queue(&map->root->spill_irq_work);
+
 	if (idx < map->max_elts) {
 		elt = *(TRACING_MAP_ELT(map->elts, idx));
 		if (map->ops && map->ops->elt_init)
@@ -513,16 +522,14 @@ static inline bool keys_match(void *key, void *test_key, unsigned key_size)
 }
 
 static inline struct tracing_map_elt *
-__tracing_map_insert(struct tracing_map *map, void *key, bool lookup_only)
+__tracing_map_insert(struct tracing_map *map, void *key, u32 key_hash,
+		     bool lookup_only)
 {
-	u32 idx, key_hash, test_key;
+	u32 idx, test_key;
 	int dup_try = 0;
 	struct tracing_map_entry *entry;
 	struct tracing_map_elt *val;
 
-	key_hash = jhash(key, map->key_size, 0);
-	if (key_hash == 0)
-		key_hash = 1;
 	idx = key_hash >> (32 - (map->map_bits + 1));
 
 	while (1) {
@@ -534,8 +541,6 @@ __tracing_map_insert(struct tracing_map *map, void *key, bool lookup_only)
 			val = READ_ONCE(entry->val);
 			if (val &&
 			    keys_match(key, val->key, map->key_size)) {
-				if (!lookup_only)
-					atomic64_inc(&map->hits);
 				return val;
 			} else if (unlikely(!val)) {
 				/*
@@ -551,10 +556,8 @@ __tracing_map_insert(struct tracing_map *map, void *key, bool lookup_only)
 				 */
 
 				dup_try++;
-				if (dup_try > map->map_size) {
-					atomic64_inc(&map->drops);
+				if (dup_try > map->map_size)
 					break;
-				}
 				continue;
 			}
 		}
@@ -568,7 +571,6 @@ __tracing_map_insert(struct tracing_map *map, void *key, bool lookup_only)
 
 				elt = get_free_elt(map);
 				if (!elt) {
-					atomic64_inc(&map->drops);
 					entry->key = 0;
 					break;
 				}
@@ -580,7 +582,6 @@ __tracing_map_insert(struct tracing_map *map, void *key, bool lookup_only)
 				 */
 				smp_wmb();
 				WRITE_ONCE(entry->val, elt);
-				atomic64_inc(&map->hits);
 
 				return entry->val;
 			} else {
@@ -599,6 +600,38 @@ __tracing_map_insert(struct tracing_map *map, void *key, bool lookup_only)
 	return NULL;
 }
 
+static struct tracing_map_elt *
+tracing_map_insert_chain(struct tracing_map *map, void *key, bool lookup_only)
+{
+	struct tracing_map_elt *val;
+	struct tracing_map *m;
+	u32 key_hash;
+
+	key_hash = jhash(key, map->key_size, 0);
+	if (key_hash == 0)
+		key_hash = 1;
+
+	for (m = map; m; m = smp_load_acquire(&m->spill)) {
+		/*
+		 * A map that has run out of elements can't take new keys,
+		 * so only look into it for existing ones and leave the
+		 * insertion to the next map in the chain.
+		 */
+		val = __tracing_map_insert(m, key, key_hash,
+					   lookup_only || tracing_map_full(m));
+		if (val) {
+			if (!lookup_only)
+				atomic64_inc(&map->hits);
+			return val;
+		}
+	}
+
+	if (!lookup_only)
+		atomic64_inc(&map->drops);
+
+	return NULL;
+}
+
 /**
  * tracing_map_insert - Insert key and/or retrieve val from a tracing_map
  * @map: The tracing_map to insert into
@@ -630,6 +663,11 @@ __tracing_map_insert(struct tracing_map *map, void *key, bool lookup_only)
  * run out of entries.  Readers can at any point in time traverse the
  * tracing map and safely access the key/val pairs.
  *
+ * If spill maps were enabled with tracing_map_set_spill(), the
+ * insertion moves on to the next map in the chain once a map has
+ * exhausted its pool, and elements are only dropped when the last map
+ * allowed is full, or when a new spill map hasn't been published yet.
+ *
  * Return: the tracing_map_elt pointer val associated with the key.
  * If this was a newly inserted key, the val will be a newly allocated
  * and associated tracing_map_elt pointer val.  If the key wasn't
@@ -638,7 +676,7 @@ __tracing_map_insert(struct tracing_map *map, void *key, bool lookup_only)
  */
 struct tracing_map_elt *tracing_map_insert(struct tracing_map *map, void *key)
 {
-	return __tracing_map_insert(map, key, false);
+	return tracing_map_insert_chain(map, key, false);
 }
 
 /**
@@ -660,7 +698,7 @@ struct tracing_map_elt *tracing_map_insert(struct tracing_map *map, void *key)
  */
 struct tracing_map_elt *tracing_map_lookup(struct tracing_map *map, void *key)
 {
-	return __tracing_map_insert(map, key, true);
+	return tracing_map_insert_chain(map, key, true);
 }
 
 /**
@@ -678,6 +716,13 @@ void tracing_map_destroy(struct tracing_map *map)
 	if (!map)
 		return;
 
+	if (map->root == map) {
+		irq_work_sync(&map->spill_irq_work);
+		cancel_work_sync(&map->spill_work);
+	}
+
+	tracing_map_destroy(map->spill);
+
 	tracing_map_free_elts(map);
 
 	tracing_map_array_free(map->map);
@@ -707,6 +752,55 @@ void tracing_map_clear(struct tracing_map *map)
 
 	for (i = 0; i < map->max_elts; i++)
 		tracing_map_elt_clear(*(TRACING_MAP_ELT(map->elts, i)));
+
+	/* Spill maps stay allocated and are reused once the map refills */
+	if (map->spill)
+		tracing_map_clear(map->spill);
+}
+
+static void tracing_map_spill_work(struct work_struct *work)
+{
+	struct tracing_map *root = container_of(work, struct tracing_map,
+						spill_work);
+	struct tracing_map *last, *spill;
+	unsigned int map_bits;
+
+	if (root->n_spill >= root->max_spill)
+		return;
+
+	for (last = root; last->spill; last = last->spill)
+		;
+
+	map_bits = min_t(unsigned int, last->map_bits + 1,
+			 TRACING_MAP_BITS_MAX);
+	spill = tracing_map_create(map_bits, root->key_size, root->ops,
+				   root->private_data);
+	if (IS_ERR(spill))
+		return;
+
+	memcpy(spill->fields, root->fields, sizeof(root->fields));
+	memcpy(spill->key_idx, root->key_idx, sizeof(root->key_idx));
+	spill->n_fields = root->n_fields;
+	spill->n_keys = root->n_keys;
+	spill->n_vars = root->n_vars;
+	spill->root = root;
+
+	if (tracing_map_init(spill)) {
+		tracing_map_destroy(spill);
+		return;
+	}
+
+	root->n_spill++;
+	/* Pairs with the smp_load_acquire() in tracing_map_insert_chain() */
+	smp_store_release(&last->spill, spill);
+}
+
+static void tracing_map_spill_irq_work(struct irq_work *work)
+{
+	struct tracing_map *root = container_of(work, struct tracing_map,
+						spill_irq_work);
+
+	schedule_work(&root->spill_work);
 }
 
 static void set_sort_key(struct tracing_map *map,
@@ -790,6 +884,10 @@ struct tracing_map *tracing_map_create(unsigned int map_bits,
 
 	map->private_data = private_data;
 
+	map->root = map;
+	init_irq_work(&map->spill_irq_work, tracing_map_spill_irq_work);
+	INIT_WORK(&map->spill_work, tracing_map_spill_work);
+
 	map->map = tracing_map_array_alloc(map->map_size,
 					   sizeof(struct tracing_map_entry));
 	if (!map->map)
@@ -842,6 +940,31 @@ int tracing_map_init(struct tracing_map *map)
 	return err;
 }
 
+/**
+ * tracing_map_set_spill - Allow a tracing_map to spill into extra maps
+ * @map: The tracing_map
+ * @max_spill: The maximum number of spill maps, 0 to disable spilling
+ *
+ * By default, a tracing_map drops every new key once its pool of
+ * tracing_map_elts has been exhausted.  With spilling enabled, up to
+ * max_spill additional maps, each twice the size of the previous one
+ * (but no larger than 2 ** TRACING_MAP_BITS_MAX), are allocated in the
+ * background as the map fills up, and new keys are inserted into
+ * those instead.  tracing_map_sort_entries() returns the elements of
+ * all of them.  This should be called before tracing_map_init().
+ *
+ * Return: 0 if successful, -EINVAL if max_spill is too large.
+ */
+int tracing_map_set_spill(struct tracing_map *map, unsigned int max_spill)
+{
+	if (max_spill > TRACING_MAP_SPILL_MAX)
+		return -EINVAL;
+
+	map->max_spill = max_spill;
+
+	return 0;
+}
+
 static int cmp_entries_dup(const void *A, const void *B)
 {
 	const struct tracing_map_sort_entry *a, *b;
@@ -1078,25 +1201,36 @@ int tracing_map_sort_entries(struct tracing_map *map,
 {
 	int (*cmp_entries_fn)(const void *, const void *);
 	struct tracing_map_sort_entry *sort_entry, **entries;
+	unsigned int max_elts = 0;
+	struct tracing_map *m;
 	int i, n_entries, ret;
 
-	entries = vmalloc(array_size(sizeof(sort_entry), map->max_elts));
+	for (m = map; m; m = smp_load_acquire(&m->spill))
+		max_elts += m->max_elts;
+
+	entries = vmalloc(array_size(sizeof(sort_entry), max_elts));
 	if (!entries)
 		return -ENOMEM;
 
-	for (i = 0, n_entries = 0; i < map->map_size; i++) {
-		struct tracing_map_entry *entry;
+	n_entries = 0;
+	for (m = map; m && max_elts; m = smp_load_acquire(&m->spill)) {
+		/* Only walk the maps that were accounted for above */
+		max_elts -= m->max_elts;
 
-		entry = TRACING_MAP_ENTRY(map->map, i);
+		for (i = 0; i < m->map_size; i++) {
+			struct tracing_map_entry *entry;
 
-		if (!entry->key || !entry->val)
-			continue;
+			entry = TRACING_MAP_ENTRY(m->map, i);
 
-		entries[n_entries] = create_sort_entry(entry->val->key,
-						       entry->val);
-		if (!entries[n_entries++]) {
-			ret = -ENOMEM;
-			goto free;
+			if (!entry->key || !entry->val)
+				continue;
+
+			entries[n_entries] = create_sort_entry(entry->val->key,
+							       entry->val);
+			if (!entries[n_entries++]) {
+				ret = -ENOMEM;
+				goto free;
+			}
 		}
 	}
 
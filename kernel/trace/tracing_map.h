@@ -2,6 +2,9 @@
 #ifndef __TRACING_MAP_H
 #define __TRACING_MAP_H
 
+#include <linux/irq_work.h>
+#include <linux/workqueue.h>
+
 #define TRACING_MAP_BITS_DEFAULT	11
 #define TRACING_MAP_BITS_MAX		17
 #define TRACING_MAP_BITS_MIN		7
@@ -12,6 +15,7 @@
 					 TRACING_MAP_VALS_MAX)
 #define TRACING_MAP_VARS_MAX		16
 #define TRACING_MAP_SORT_KEYS_MAX	2
+#define TRACING_MAP_SPILL_MAX		8
 
 typedef int (*tracing_map_cmp_fn_t) (void *val_a, void *val_b);
 
@@ -125,6 +129,20 @@ typedef int (*tracing_map_cmp_fn_t) (void *val_a, void *val_b);
  * user, tracing_map_sort_entry objects contain a number of additional
  * fields which are used for caching and internal purposes and can
  * safely be ignored.
+ *
+ * Finally, a tracing_map can optionally be allowed to spill over into
+ * additional maps once its pool of tracing_map_elts runs low (see
+ * tracing_map_set_spill()).  Each spill map is a full tracing_map of
+ * its own, sharing the fields and ops of the map it was created from
+ * (the 'root' map), and they form a singly linked chain through the
+ * 'spill' field.  Because nothing can be allocated in the insertion
+ * path, a new spill map is allocated from a workqueue as soon as the
+ * last map in the chain is three quarters full, and is published to
+ * tracing_map_insert() once it's ready.  A key is only ever inserted
+ * into the first map in the chain that still has free elements, so a
+ * given key lives in exactly one map, and lookups simply walk the
+ * chain.  tracing_map_sort_entries() collects the elements of every
+ * map in the chain, so clients see a single merged set of entries.
 */
 
 struct tracing_map_field {
@@ -198,6 +216,12 @@ struct tracing_map {
 	unsigned int			n_vars;
 	atomic64_t			hits;
 	atomic64_t			drops;
+	struct tracing_map		*spill;
+	struct tracing_map		*root;
+	unsigned int			max_spill;
+	unsigned int			n_spill;
+	struct irq_work			spill_irq_work;
+	struct work_struct		spill_work;
 };
 
 /**
@@ -243,6 +267,8 @@ tracing_map_create(unsigned int map_bits,
 		   const struct tracing_map_ops *ops,
 		   void *private_data);
 extern int tracing_map_init(struct tracing_map *map);
+extern int tracing_map_set_spill(struct tracing_map *map,
+				 unsigned int max_spill);
 
 extern int tracing_map_add_sum_field(struct tracing_map *map);
 extern int tracing_map_add_var(struct tracing_map *map);
@@ -51,6 +51,7 @@
 #include <linux/uaccess.h>
 #include <linux/sched/isolation.h>
 #include <linux/sched/debug.h>
+#include <linux/sched/clock.h>
 #include <linux/nmi.h>
 #include <linux/kvm_para.h>
 #include <linux/delay.h>
@@ -249,6 +250,28 @@ enum pool_workqueue_stats {
 	PWQ_NR_STATS,
 };
 
+/*
+ * Per-pool_workqueue histograms with CONFIG_WQ_LATENCY_HIST. These are log2
+ * in usecs, the first bucket is < 2us and the last one collects everything
+ * from 2^(PWQ_HIST_NR_BUCKETS - 1) usecs up.
+ */
+#define PWQ_HIST_NR_BUCKETS	16
+
+enum pwq_hist_type {
+	PWQ_HIST_LATENCY,	/* from queueing until execution starts */
+	PWQ_HIST_RUN_TIME,	/* wall time spent executing */
+
+	PWQ_NR_HISTS,
+};
+
+#ifdef CONFIG_WQ_LATENCY_HIST
+struct pwq_hist {
+	u64			buckets[PWQ_HIST_NR_BUCKETS];
+	u64			max_ns;
+	work_func_t		max_func;	/* work function behind max_ns */
+};
+#endif
+
 /*
  * The per-pool workqueue.  While queued, bits below WORK_PWQ_SHIFT
  * of work_struct->data are used for flags and the remaining high bits
@@ -288,6 +311,9 @@ struct pool_workqueue {
 	struct list_head	mayday_node;	/* MD: node on wq->maydays */
 
 	u64			stats[PWQ_NR_STATS];
+#ifdef CONFIG_WQ_LATENCY_HIST
+	struct pwq_hist		hists[PWQ_NR_HISTS];	/* L: */
+#endif
 
 	/*
 	 * Release of unbound pwq is punted to a kthread_worker. See put_pwq()
@@ -2199,10 +2225,45 @@ static bool work_grab_pending(struct work_struct *work, u32 cflags,
  * CONTEXT:
  * raw_spin_lock_irq(pool->lock).
  */
+#ifdef CONFIG_WQ_LATENCY_HIST
+static void pwq_hist_record(struct pool_workqueue *pwq,
+			    enum pwq_hist_type type, u64 ns, work_func_t func)
+{
+	struct pwq_hist *hist = &pwq->hists[type];
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+	int bucket = us ? min_t(int, ilog2(us), PWQ_HIST_NR_BUCKETS - 1) : 0;
+
+	lockdep_assert_held(&pwq->pool->lock);
+
+	hist->buckets[bucket]++;
+	if (ns > hist->max_ns) {
+		hist->max_ns = ns;
+		hist->max_func = func;
+	}
+}
+
+static inline void work_stamp_queued(struct work_struct *work)
+{
+	work->queued_at = local_clock();
+}
+
+static inline u64 work_queued_at(struct work_struct *work)
+{
+	return work->queued_at;
+}
+#else
+static inline void pwq_hist_record(struct pool_workqueue *pwq,
+				   enum pwq_hist_type type, u64 ns,
+				   work_func_t func) { }
+static inline void work_stamp_queued(struct work_struct *work) { }
+static inline u64 work_queued_at(struct work_struct *work) { return 0; }
+#endif
+
 static void insert_work(struct pool_workqueue *pwq, struct work_struct *work,
 			struct list_head *head, unsigned int extra_flags)
 {
 	debug_work_activate(work);
+	work_stamp_queued(work);
 
 	/* record the work call stack in order to print it in KASAN reports */
 	kasan_record_aux_stack_noalloc(work);
@@ -3153,6 +3214,7 @@ __acquires(&pool->lock)
 	unsigned long work_data;
 	int lockdep_start_depth, rcu_start_depth;
 	bool bh_draining = pool->flags & POOL_BH_DRAINING;
+	u64 start_ns = 0;
 #ifdef CONFIG_LOCKDEP
 	/*
 	 * It is permissible to free the struct work_struct from
@@ -3214,6 +3276,12 @@ __acquires(&pool->lock)
 	set_work_pool_and_clear_pending(work, pool->id, pool_offq_flags(pool));
 
 	pwq->stats[PWQ_STAT_STARTED]++;
+	if (IS_ENABLED(CONFIG_WQ_LATENCY_HIST)) {
+		start_ns = local_clock();
+		pwq_hist_record(pwq, PWQ_HIST_LATENCY,
+				start_ns - work_queued_at(work),
+				worker->current_func);
+	}
 	raw_spin_unlock_irq(&pool->lock);
 
 	rcu_start_depth = rcu_preempt_depth();
@@ -3282,6 +3350,10 @@ __acquires(&pool->lock)
 
 	raw_spin_lock_irq(&pool->lock);
 
+	if (IS_ENABLED(CONFIG_WQ_LATENCY_HIST))
+		pwq_hist_record(pwq, PWQ_HIST_RUN_TIME, local_clock() - start_ns,
+				worker->current_func);
+
 	/*
 	 * In addition to %WQ_CPU_INTENSIVE, @worker may also have been marked
 	 * CPU intensive by wq_worker_tick() if @work hogged CPU longer than
@@ -7031,9 +7103,57 @@ static ssize_t max_active_store(struct device *dev,
 }
 static DEVICE_ATTR_RW(max_active);
 
+#ifdef CONFIG_WQ_LATENCY_HIST
+/*
+ * The histograms of all pwqs of @wq summed up, one line per bucket with the
+ * lower bound in usecs followed by the latency and run time counts, and the
+ * worst latency and run time seen along with their work functions.
+ */
+static ssize_t latency_hist_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	struct pwq_hist hists[PWQ_NR_HISTS] = {};
+	struct pool_workqueue *pwq;
+	int len = 0, i, t;
+
+	rcu_read_lock();
+	for_each_pwq(pwq, wq) {
+		for (t = 0; t < PWQ_NR_HISTS; t++) {
+			struct pwq_hist *hist = &pwq->hists[t];
+
+			for (i = 0; i < PWQ_HIST_NR_BUCKETS; i++)
+				hists[t].buckets[i] += READ_ONCE(hist->buckets[i]);
+			if (READ_ONCE(hist->max_ns) > hists[t].max_ns) {
+				hists[t].max_ns = READ_ONCE(hist->max_ns);
+				hists[t].max_func = READ_ONCE(hist->max_func);
+			}
+		}
+	}
+	rcu_read_unlock();
+
+	for (i = 0; i < PWQ_HIST_NR_BUCKETS; i++)
+		len += sysfs_emit_at(buf, len, "%lu %llu %llu\n",
+				     i ? 1UL << i : 0,
+				     hists[PWQ_HIST_LATENCY].buckets[i],
+				     hists[PWQ_HIST_RUN_TIME].buckets[i]);
+	len += sysfs_emit_at(buf, len, "max_latency_us %llu %ps\n",
+			     div_u64(hists[PWQ_HIST_LATENCY].max_ns, NSEC_PER_USEC),
+			     hists[PWQ_HIST_LATENCY].max_func);
+	len += sysfs_emit_at(buf, len, "max_run_time_us %llu %ps\n",
+			     div_u64(hists[PWQ_HIST_RUN_TIME].max_ns, NSEC_PER_USEC),
+			     hists[PWQ_HIST_RUN_TIME].max_func);
+	return len;
+}
+static DEVICE_ATTR_RO(latency_hist);
+#endif
+
 static struct attribute *wq_sysfs_attrs[] = {
 	&dev_attr_per_cpu.attr,
 	&dev_attr_max_active.attr,
+#ifdef CONFIG_WQ_LATENCY_HIST
+	&dev_attr_latency_hist.attr,
+#endif
 	NULL,
 };
 ATTRIBUTE_GROUPS(wq_sysfs);
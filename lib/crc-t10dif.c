@@ -18,6 +18,12 @@
 
 static struct crypto_shash __rcu *crct10dif_tfm;
 static DEFINE_STATIC_KEY_TRUE(crct10dif_fallback);
+
+/*
+ * The accelerated drivers work on 16 byte blocks and fall back to the
+ * table for anything shorter; do that without going through the crypto API.
+ */
+#define CRC_T10DIF_SHASH_MIN_LEN	16
 static DEFINE_MUTEX(crc_t10dif_mutex);
 static struct work_struct crct10dif_rehash_work;
 
@@ -68,7 +74,8 @@ __u16 crc_t10dif_update(__u16 crc, const unsigned char *buffer, size_t len)
 	} desc;
 	int err;
 
-	if (static_branch_unlikely(&crct10dif_fallback))
+	if (static_branch_unlikely(&crct10dif_fallback) ||
+	    len < CRC_T10DIF_SHASH_MIN_LEN)
 		return crc_t10dif_generic(crc, buffer, len);
 
 	rcu_read_lock();
@@ -12,6 +12,9 @@
 
 static struct crypto_shash __rcu *crc64_rocksoft_tfm;
 static DEFINE_STATIC_KEY_TRUE(crc64_rocksoft_fallback);
+
+/* As for crc_t10dif(), leave buffers the drivers won't fold to the table */
+#define CRC64_ROCKSOFT_SHASH_MIN_LEN	16
 static DEFINE_MUTEX(crc64_rocksoft_mutex);
 static struct work_struct crc64_rocksoft_rehash_work;
 
@@ -62,7 +65,8 @@ u64 crc64_rocksoft_update(u64 crc, const unsigned char *buffer, size_t len)
 	} desc;
 	int err;
 
-	if (static_branch_unlikely(&crc64_rocksoft_fallback))
+	if (static_branch_unlikely(&crc64_rocksoft_fallback) ||
+	    len < CRC64_ROCKSOFT_SHASH_MIN_LEN)
 		return crc64_rocksoft_generic(crc, buffer, len);
 
 	rcu_read_lock();
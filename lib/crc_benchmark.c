@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * KUnit check and benchmark of the CRC library functions, through the same
+ * entry points and dispatch that their users get.
+ */
+
+#include <kunit/test.h>
+#include <linux/crc-t10dif.h>
+#include <linux/crc32.h>
+#include <linux/crc32c.h>
+#include <linux/crc64.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/sched.h>
+
+struct crc_variant {
+	const char *name;
+	u64 (*fn)(u64 crc, const u8 *p, size_t len);
+	u64 init, xor_out, check;	/* check: the CRC of "123456789" */
+};
+
+static u64 crc32_le_wrapper(u64 crc, const u8 *p, size_t len)
+{
+	return crc32_le(crc, p, len);
+}
+
+static u64 crc32_be_wrapper(u64 crc, const u8 *p, size_t len)
+{
+	return crc32_be(crc, p, len);
+}
+
+static u64 crc32c_wrapper(u64 crc, const u8 *p, size_t len)
+{
+	return crc32c(crc, p, len);
+}
+
+static u64 crc_t10dif_wrapper(u64 crc, const u8 *p, size_t len)
+{
+	return crc_t10dif_update(crc, p, len);
+}
+
+static u64 crc64_be_wrapper(u64 crc, const u8 *p, size_t len)
+{
+	return crc64_be(crc, p, len);
+}
+
+static u64 crc64_rocksoft_wrapper(u64 crc, const u8 *p, size_t len)
+{
+	return crc64_rocksoft_update(crc, p, len);
+}
+
+static const struct crc_variant crc_variants[] = {
+	{ "crc32_le", crc32_le_wrapper, 0xffffffff, 0xffffffff, 0xcbf43926 },
+	{ "crc32_be", crc32_be_wrapper, 0xffffffff, 0xffffffff, 0xfc891918 },
+	{ "crc32c", crc32c_wrapper, 0xffffffff, 0xffffffff, 0xe3069283 },
+	{ "crc_t10dif", crc_t10dif_wrapper, 0, 0, 0xd0db },
+	{ "crc64_be", crc64_be_wrapper, 0, 0, 0x6c40df5f0b497347ULL },
+	/* crc64_rocksoft_update() inverts on the way in and out itself */
+	{ "crc64_rocksoft", crc64_rocksoft_wrapper, 0, 0,
+	  0xae8b14860a799888ULL },
+};
+
+static void crc_check_values(struct kunit *test)
+{
+	static const u8 data[] = "123456789";
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(crc_variants); i++) {
+		const struct crc_variant *v = &crc_variants[i];
+		u64 crc = v->fn(v->init, data, sizeof(data) - 1) ^ v->xor_out;
+
+		KUNIT_EXPECT_EQ_MSG(test, crc, v->check, "%s", v->name);
+	}
+}
+
+/* Computing a CRC in two pieces must give the same result as in one */
+static void crc_check_split(struct kunit *test)
+{
+	size_t len = 4096, split;
+	u8 *buf;
+	int i;
+
+	buf = kunit_kmalloc(test, len, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, buf);
+	get_random_bytes(buf, len);
+
+	for (i = 0; i < ARRAY_SIZE(crc_variants); i++) {
+		const struct crc_variant *v = &crc_variants[i];
+		u64 whole = v->fn(v->init, buf, len);
+
+		for (split = 0; split <= 512; split += 7)
+			KUNIT_EXPECT_EQ_MSG(test, whole,
+				v->fn(v->fn(v->init, buf, split),
+				      buf + split, len - split),
+				"%s split at %zu", v->name, split);
+	}
+}
+
+static const size_t crc_bench_lens[] = { 16, 64, 256, 1024, 4096, 65536 };
+
+/* Bytes to checksum for each variant and length */
+#define CRC_BENCH_BYTES		(32 << 20)
+
+static void crc_benchmark(struct kunit *test)
+{
+	size_t max_len = crc_bench_lens[ARRAY_SIZE(crc_bench_lens) - 1];
+	u8 *buf;
+	int i, j;
+
+	buf = kunit_kmalloc(test, max_len, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, buf);
+	get_random_bytes(buf, max_len);
+
+	for (i = 0; i < ARRAY_SIZE(crc_variants); i++) {
+		const struct crc_variant *v = &crc_variants[i];
+
+		for (j = 0; j < ARRAY_SIZE(crc_bench_lens); j++) {
+			size_t len = crc_bench_lens[j];
+			u64 n, nr = CRC_BENCH_BYTES / len;
+			u64 crc = v->init, start, ns, mbps;
+
+			start = ktime_get_ns();
+			for (n = 0; n < nr; n++)
+				crc = v->fn(crc, buf, len);
+			ns = max(ktime_get_ns() - start, 1ULL);
+
+			/* bytes per ns are GB/s, keep two decimals */
+			mbps = div64_u64((u64)CRC_BENCH_BYTES * 1000, ns);
+			kunit_info(test, "%s len=%zu: %llu.%02llu GB/s (crc %llx)\n",
+				   v->name, len, mbps / 1000, mbps % 1000 / 10,
+				   crc);
+			cond_resched();
+		}
+	}
+}
+
+static struct kunit_case crc_benchmark_cases[] = {
+	KUNIT_CASE(crc_check_values),
+	KUNIT_CASE(crc_check_split),
+	KUNIT_CASE(crc_benchmark),
+	{}
+};
+
+static struct kunit_suite crc_benchmark_suite = {
+	.name = "crc",
+	.test_cases = crc_benchmark_cases,
+};
+
+kunit_test_suites(&crc_benchmark_suite);
+
+MODULE_DESCRIPTION("KUnit check and benchmark of the CRC library");
+MODULE_LICENSE("GPL");
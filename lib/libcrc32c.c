@@ -32,10 +32,22 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/crc32c.h>
+#include <linux/crc32.h>
+#include <linux/static_call.h>
 
+/*
+ * crc32c() calls __crc32c_le() directly, which is the arch CRC instructions
+ * where the arch provides them, unless the crypto API has a better driver:
+ * the generic driver is only __crc32c_le() behind an indirect call.
+ */
 static struct crypto_shash *tfm;
 
-u32 crc32c(u32 crc, const void *address, unsigned int length)
+static u32 crc32c_lib(u32 crc, const void *address, unsigned int length)
+{
+	return __crc32c_le(crc, address, length);
+}
+
+static u32 crc32c_shash(u32 crc, const void *address, unsigned int length)
 {
 	SHASH_DESC_ON_STACK(shash, tfm);
 	u32 ret, *ctx = (u32 *)shash_desc_ctx(shash);
@@ -52,16 +64,29 @@ u32 crc32c(u32 crc, const void *address, unsigned int length)
 	return ret;
 }
 
+DEFINE_STATIC_CALL(crc32c_impl, crc32c_lib);
+
+u32 crc32c(u32 crc, const void *address, unsigned int length)
+{
+	return static_call(crc32c_impl)(crc, address, length);
+}
+
 EXPORT_SYMBOL(crc32c);
 
 static int __init libcrc32c_mod_init(void)
 {
 	tfm = crypto_alloc_shash("crc32c", 0, 0);
-	return PTR_ERR_OR_ZERO(tfm);
+	if (IS_ERR(tfm))
+		return PTR_ERR(tfm);
+
+	if (strcmp(crypto_shash_driver_name(tfm), "crc32c-generic"))
+		static_call_update(crc32c_impl, crc32c_shash);
+	return 0;
 }
 
 static void __exit libcrc32c_mod_fini(void)
 {
+	static_call_update(crc32c_impl, crc32c_lib);
 	crypto_free_shash(tfm);
 }
 
@@ -37,11 +37,19 @@
 #include "lz4defs.h"
 #include <linux/module.h>
 #include <linux/kernel.h>
+#include <asm/page.h>
 #include <asm/unaligned.h>
 
 static const int LZ4_minLength = (MFLIMIT + 1);
 static const int LZ4_64Klimit = ((64 * KB) + (MFLIMIT - 1));
 
+/*
+ * One slot per input byte is plenty for a page; for 4K pages the table is
+ * 8KB, half of what byU16 uses, and stays in L1 together with the page.
+ */
+#define LZ4_PAGE_HASHLOG min_t(int, PAGE_SHIFT, LZ4_HASHLOG + 1)
+#define LZ4_PAGE_TABLESIZE ((1 << LZ4_PAGE_HASHLOG) * sizeof(U16))
+
 /*-******************************
  *	Compression functions
  ********************************/
@@ -49,7 +57,10 @@ static FORCE_INLINE U32 LZ4_hash4(
 	U32 sequence,
 	tableType_t const tableType)
 {
-	if (tableType == byU16)
+	if (tableType == byPage)
+		return ((sequence * 2654435761U)
+			>> ((MINMATCH * 8) - LZ4_PAGE_HASHLOG));
+	else if (tableType == byU16)
 		return ((sequence * 2654435761U)
 			>> ((MINMATCH * 8) - (LZ4_HASHLOG + 1)));
 	else
@@ -111,6 +122,7 @@ static void LZ4_putPositionOnHash(
 		return;
 	}
 	case byU16:
+	case byPage:
 	{
 		U16 *hashTable = (U16 *) tableBase;
 
@@ -225,7 +237,7 @@ static FORCE_INLINE int LZ4_compress_generic(
 		break;
 	}
 
-	if ((tableType == byU16)
+	if ((tableType == byU16 || tableType == byPage)
 		&& (inputSize >= LZ4_64Klimit)) {
 		/* Size too large (not within 64K limit) */
 		return 0;
@@ -283,7 +295,7 @@ static FORCE_INLINE int LZ4_compress_generic(
 			} while (((dictIssue == dictSmall)
 					? (match < lowRefLimit)
 					: 0)
-				|| ((tableType == byU16)
+				|| ((tableType == byU16 || tableType == byPage)
 					? 0
 					: (match + MAX_DISTANCE < ip))
 				|| (LZ4_read32(match + refDelta)
@@ -516,6 +528,33 @@ int LZ4_compress_default(const char *source, char *dest, int inputSize,
 }
 EXPORT_SYMBOL(LZ4_compress_default);
 
+int LZ4_compress_page(const char *source, char *dest, int maxOutputSize,
+	void *wrkmem)
+{
+	LZ4_stream_t_internal *ctx = &((LZ4_stream_t *)wrkmem)->internal_donotuse;
+
+	/* Offsets must fit byU16, and there is no point for huge pages */
+	if (PAGE_SIZE >= LZ4_64Klimit)
+		return LZ4_compress_default(source, dest, PAGE_SIZE,
+			maxOutputSize, wrkmem);
+
+	/* Only the part of the table that byPage hashes into is used */
+	memset(ctx->hashTable, 0, LZ4_PAGE_TABLESIZE);
+	ctx->currentOffset = 0;
+	ctx->dictionary = NULL;
+	ctx->dictSize = 0;
+
+	if (maxOutputSize >= LZ4_COMPRESSBOUND(PAGE_SIZE))
+		return LZ4_compress_generic(ctx, source, dest, PAGE_SIZE, 0,
+			noLimit, byPage, noDict, noDictIssue,
+			LZ4_ACCELERATION_DEFAULT);
+	else
+		return LZ4_compress_generic(ctx, source, dest, PAGE_SIZE,
+			maxOutputSize, limitedOutput, byPage, noDict,
+			noDictIssue, LZ4_ACCELERATION_DEFAULT);
+}
+EXPORT_SYMBOL(LZ4_compress_page);
+
 /*-******************************
  *	*_destSize() variant
  ********************************/
@@ -234,7 +234,8 @@ static FORCE_INLINE unsigned int LZ4_count(
 }
 
 typedef enum { noLimit = 0, limitedOutput = 1 } limitedOutput_directive;
-typedef enum { byPtr, byU32, byU16 } tableType_t;
+/* byPage: byU16 offsets, hashed into a table sized for one page */
+typedef enum { byPtr, byU32, byU16, byPage } tableType_t;
 
 typedef enum { noDict = 0, withPrefix64k, usingExtDict } dict_directive;
 typedef enum { noDictIssue = 0, dictSmall } dictIssue_directive;
@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * KUnit check and benchmark of LZ4_compress_page() against the generic
+ * LZ4_compress_default() path, on the kinds of pages zram and zswap see.
+ */
+
+#include <kunit/test.h>
+#include <linux/ktime.h>
+#include <linux/lz4.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/sched.h>
+#include <linux/vmalloc.h>
+
+enum lz4_page_kind {
+	LZ4_PAGE_ZERO,
+	LZ4_PAGE_TEXT,
+	LZ4_PAGE_SPARSE,
+	LZ4_PAGE_RANDOM,
+	NR_LZ4_PAGE_KINDS,
+};
+
+static const char * const lz4_page_kind_names[] = {
+	"zero", "text", "sparse", "random",
+};
+
+static void lz4_fill_page(u8 *page, enum lz4_page_kind kind)
+{
+	static const char words[] = "the quick brown fox jumps over the lazy dog ";
+	size_t i;
+
+	switch (kind) {
+	case LZ4_PAGE_ZERO:
+		memset(page, 0, PAGE_SIZE);
+		break;
+	case LZ4_PAGE_TEXT:
+		for (i = 0; i < PAGE_SIZE; i++)
+			page[i] = words[(i * 7 + i / 64) % (sizeof(words) - 1)];
+		break;
+	case LZ4_PAGE_SPARSE:
+		/* mostly zero with some pointers, like a slab or page table */
+		memset(page, 0, PAGE_SIZE);
+		for (i = 0; i < PAGE_SIZE; i += 64)
+			get_random_bytes(page + i, 8);
+		break;
+	default:
+		get_random_bytes(page, PAGE_SIZE);
+		break;
+	}
+}
+
+struct lz4_bench_ctx {
+	u8 *src, *dst, *out;
+	void *wrkmem;
+	int dst_size;
+};
+
+static struct lz4_bench_ctx *lz4_bench_init(struct kunit *test)
+{
+	struct lz4_bench_ctx *ctx;
+
+	ctx = kunit_kzalloc(test, sizeof(*ctx), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, ctx);
+	ctx->dst_size = LZ4_COMPRESSBOUND(PAGE_SIZE);
+	ctx->src = kunit_kmalloc(test, PAGE_SIZE, GFP_KERNEL);
+	ctx->out = kunit_kmalloc(test, PAGE_SIZE, GFP_KERNEL);
+	ctx->dst = kunit_kmalloc(test, ctx->dst_size, GFP_KERNEL);
+	ctx->wrkmem = kunit_kmalloc(test, LZ4_MEM_COMPRESS, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, ctx->src);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, ctx->out);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, ctx->dst);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, ctx->wrkmem);
+	return ctx;
+}
+
+/* Every page must decompress back to itself, with full or short output */
+static void lz4_check_page(struct kunit *test)
+{
+	struct lz4_bench_ctx *ctx = lz4_bench_init(test);
+	enum lz4_page_kind kind;
+	int len, short_len;
+
+	for (kind = 0; kind < NR_LZ4_PAGE_KINDS; kind++) {
+		lz4_fill_page(ctx->src, kind);
+
+		len = LZ4_compress_page(ctx->src, ctx->dst, ctx->dst_size,
+					ctx->wrkmem);
+		KUNIT_ASSERT_GT_MSG(test, len, 0, "%s",
+				    lz4_page_kind_names[kind]);
+		KUNIT_EXPECT_EQ(test, LZ4_decompress_safe(ctx->dst, ctx->out,
+							  len, PAGE_SIZE),
+				(int)PAGE_SIZE);
+		KUNIT_EXPECT_MEMEQ(test, ctx->src, ctx->out, PAGE_SIZE);
+
+		/* zram gives up on pages that do not fit its limit */
+		short_len = LZ4_compress_page(ctx->src, ctx->dst, len - 1,
+					      ctx->wrkmem);
+		KUNIT_EXPECT_EQ_MSG(test, short_len, 0, "%s",
+				    lz4_page_kind_names[kind]);
+		KUNIT_EXPECT_EQ(test, LZ4_compress_page(ctx->src, ctx->dst, len,
+							ctx->wrkmem), len);
+	}
+}
+
+/* Pages to compress for each kind and path */
+#define LZ4_BENCH_PAGES		(1 << 15)
+
+static void lz4_bench_one(struct kunit *test, struct lz4_bench_ctx *ctx,
+			  const char *kind, const char *name, bool page)
+{
+	u64 n, start, ns, pps;
+	int len = 0;
+
+	start = ktime_get_ns();
+	for (n = 0; n < LZ4_BENCH_PAGES; n++) {
+		if (page)
+			len = LZ4_compress_page(ctx->src, ctx->dst,
+						ctx->dst_size, ctx->wrkmem);
+		else
+			len = LZ4_compress_default(ctx->src, ctx->dst,
+						   PAGE_SIZE, ctx->dst_size,
+						   ctx->wrkmem);
+	}
+	ns = max(ktime_get_ns() - start, 1ULL);
+
+	pps = div64_u64((u64)LZ4_BENCH_PAGES * NSEC_PER_SEC, ns);
+	kunit_info(test, "%s %s: %llu pages/s, %d bytes\n", kind, name, pps,
+		   len);
+}
+
+static void lz4_benchmark(struct kunit *test)
+{
+	struct lz4_bench_ctx *ctx = lz4_bench_init(test);
+	enum lz4_page_kind kind;
+
+	for (kind = 0; kind < NR_LZ4_PAGE_KINDS; kind++) {
+		lz4_fill_page(ctx->src, kind);
+		lz4_bench_one(test, ctx, lz4_page_kind_names[kind],
+			      "LZ4_compress_default", false);
+		lz4_bench_one(test, ctx, lz4_page_kind_names[kind],
+			      "LZ4_compress_page", true);
+		cond_resched();
+	}
+}
+
+static struct kunit_case lz4_benchmark_cases[] = {
+	KUNIT_CASE(lz4_check_page),
+	KUNIT_CASE(lz4_benchmark),
+	{}
+};
+
+static struct kunit_suite lz4_benchmark_suite = {
+	.name = "lz4",
+	.test_cases = lz4_benchmark_cases,
+};
+
+kunit_test_suites(&lz4_benchmark_suite);
+
+MODULE_DESCRIPTION("KUnit check and benchmark of LZ4 page compression");
+MODULE_LICENSE("GPL");
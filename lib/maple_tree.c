@@ -6304,7 +6304,7 @@ void __init maple_tree_init(void)
 {
 	maple_node_cache = kmem_cache_create("maple_node",
 			sizeof(struct maple_node), sizeof(struct maple_node),
-			SLAB_PANIC, NULL);
+			SLAB_PANIC | SLAB_SHEAVES, NULL);
 }
 
 /**
@@ -6345,6 +6345,54 @@ void *mtree_load(struct maple_tree *mt, unsigned long index)
 }
 EXPORT_SYMBOL(mtree_load);
 
+/**
+ * mtree_load_many() - Load the values stored at a number of indices
+ * @mt: The maple tree
+ * @indices: The indices to load, in ascending order
+ * @entries: The array to fill in with the entry (or %NULL) of each index
+ * @nr: The number of indices
+ *
+ * All the indices are looked up under one RCU read lock.  An index that falls
+ * in the range of the previous entry is not looked up again, and one that
+ * falls in the same leaf is found by scanning that leaf instead of walking
+ * down from the root.  Unsorted indices work too, they just get less out of
+ * this.
+ */
+void mtree_load_many(struct maple_tree *mt, const unsigned long *indices,
+		void **entries, unsigned long nr)
+{
+	MA_STATE(mas, mt, 0, 0);
+	void *entry = NULL;
+	unsigned long i;
+
+	trace_ma_read(__func__, &mas);
+	rcu_read_lock();
+	for (i = 0; i < nr; i++) {
+		unsigned long index = indices[i];
+
+		if (mas_is_active(&mas) && index >= mas.index &&
+		    index <= mas.last)
+			goto found;
+
+		if (mas_is_active(&mas) && index >= mas.min &&
+		    index <= mas.max) {
+			mas.index = index;
+			mas.last = index;
+			entry = mtree_range_walk(&mas);
+			/* A dead leaf resets the state, walk from the top. */
+			if (likely(!mas_is_start(&mas)))
+				goto found;
+		}
+
+		mas_set(&mas, index);
+		entry = mas_walk(&mas);
+found:
+		entries[i] = xa_is_zero(entry) ? NULL : entry;
+	}
+	rcu_read_unlock();
+}
+EXPORT_SYMBOL(mtree_load_many);
+
 /**
  * mtree_store_range() - Store an entry at a given range.
  * @mt: The maple tree
@@ -6383,6 +6431,84 @@ int mtree_store_range(struct maple_tree *mt, unsigned long index,
 }
 EXPORT_SYMBOL(mtree_store_range);
 
+/**
+ * mtree_store_ranges() - Store a sorted array of ranges
+ * @mt: The maple tree
+ * @ranges: The ranges to store, in ascending order and not overlapping
+ * @nr: The number of ranges
+ * @gfp: The GFP_FLAGS to use for allocations
+ *
+ * All the ranges are stored under one lock, each store starting from where
+ * the previous one left the maple state instead of walking down from the
+ * root.  When @mt is empty, the nodes for the whole array are allocated up
+ * front and the tree is built in bulk mode: leaves are filled up as they are
+ * split instead of being split in half, and only the last one is rebalanced
+ * once everything is in.  The gaps between the ranges are left empty.
+ *
+ * On failure, the ranges stored before the failing one stay in the tree.
+ *
+ * Return: 0 on success, -EINVAL on invalid request, -ENOMEM if memory could not
+ * be allocated.
+ */
+int mtree_store_ranges(struct maple_tree *mt, const struct maple_range *ranges,
+		unsigned long nr, gfp_t gfp)
+{
+	MA_STATE(mas, mt, 0, 0);
+	unsigned long i;
+	bool bulk;
+	int ret = 0;
+
+	for (i = 0; i < nr; i++) {
+		if (WARN_ON_ONCE(xa_is_advanced(ranges[i].entry)))
+			return -EINVAL;
+
+		if (ranges[i].index > ranges[i].last)
+			return -EINVAL;
+
+		if (i && ranges[i].index <= ranges[i - 1].last)
+			return -EINVAL;
+	}
+
+	if (!nr)
+		return 0;
+
+	/* The tree lock is a spinlock, get the nodes before taking it. */
+	bulk = nr > 1 && gfpflags_allow_blocking(gfp) && mtree_empty(mt) &&
+	       !mas_expected_entries(&mas, nr);
+
+	mtree_lock(mt);
+	if (bulk && !mtree_empty(mt)) {
+		/* Raced with another writer, bulk mode expects in-order stores */
+		mas.mas_flags &= ~MA_STATE_BULK;
+		bulk = false;
+	}
+
+	/*
+	 * Top up a short preallocation instead of hitting the BUG_ON() in
+	 * mas_alloc_nodes(), but without dropping the lock: a half built tree
+	 * in bulk mode must not be seen by other writers.
+	 */
+	mas.mas_flags &= ~MA_STATE_PREALLOC;
+	if (bulk)
+		gfp = GFP_NOWAIT | __GFP_NOWARN;
+
+	for (i = 0; i < nr; i++) {
+		mas.index = ranges[i].index;
+		mas.last = ranges[i].last;
+		ret = mas_store_gfp(&mas, ranges[i].entry, gfp);
+		if (ret) {
+			/* mas_destroy() walks back to the last leaf */
+			mas_set(&mas, ranges[i].index);
+			break;
+		}
+	}
+
+	mas_destroy(&mas);
+	mtree_unlock(mt);
+	return ret;
+}
+EXPORT_SYMBOL(mtree_store_ranges);
+
 /**
  * mtree_store() - Store an entry at a given index.
  * @mt: The maple tree
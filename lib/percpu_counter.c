@@ -9,6 +9,8 @@
 #include <linux/cpu.h>
 #include <linux/module.h>
 #include <linux/debugobjects.h>
+#include <linux/slab.h>
+#include <linux/topology.h>
 
 #ifdef CONFIG_HOTPLUG_CPU
 static LIST_HEAD(percpu_counters);
@@ -218,6 +220,119 @@ void percpu_counter_destroy_many(struct percpu_counter *fbc, u32 nr_counters)
 }
 EXPORT_SYMBOL(percpu_counter_destroy_many);
 
+#ifdef CONFIG_NUMA
+int __percpu_node_counter_init(struct percpu_node_counter *pnc, s64 amount,
+			       gfp_t gfp, struct lock_class_key *key)
+{
+	int node, err;
+
+	pnc->nodes = kcalloc(nr_node_ids, sizeof(*pnc->nodes), gfp);
+	if (!pnc->nodes)
+		return -ENOMEM;
+
+	for_each_node(node) {
+		pnc->nodes[node] = kzalloc_node(sizeof(*pnc->nodes[node]), gfp,
+						node);
+		if (!pnc->nodes[node])
+			goto nomem;
+	}
+
+	err = __percpu_counter_init_many(&pnc->fbc, amount, gfp, 1, key);
+	if (!err)
+		return 0;
+nomem:
+	for_each_node(node)
+		kfree(pnc->nodes[node]);
+	kfree(pnc->nodes);
+	pnc->nodes = NULL;
+	return -ENOMEM;
+}
+EXPORT_SYMBOL(__percpu_node_counter_init);
+
+void percpu_node_counter_destroy(struct percpu_node_counter *pnc)
+{
+	int node;
+
+	if (!pnc->nodes)
+		return;
+
+	percpu_counter_destroy(&pnc->fbc);
+	for_each_node(node)
+		kfree(pnc->nodes[node]);
+	kfree(pnc->nodes);
+	pnc->nodes = NULL;
+}
+EXPORT_SYMBOL(percpu_node_counter_destroy);
+
+/*
+ * Same as percpu_counter_add_batch(), except that a CPU count reaching
+ * @batch goes to the count of the node, and only a node count reaching
+ * @batch times the number of CPUs of the node goes to fbc->count.  The node
+ * count is moved under fbc->lock, so that percpu_node_counter_sum() does
+ * not miss it while it is in flight.
+ */
+void percpu_node_counter_add_batch(struct percpu_node_counter *pnc,
+				   s64 amount, s32 batch)
+{
+	struct percpu_counter *fbc = &pnc->fbc;
+	unsigned long flags;
+	s64 count;
+
+	local_irq_save(flags);
+	count = __this_cpu_read(*fbc->counters) + amount;
+	if (abs(count) >= batch) {
+		int node = numa_node_id();
+		atomic64_t *ncount = &pnc->nodes[node]->count;
+		s64 node_batch = (s64)batch * max(1U, nr_cpus_node(node));
+
+		__this_cpu_sub(*fbc->counters, count - amount);
+		if (abs(atomic64_add_return(count, ncount)) >= node_batch) {
+			raw_spin_lock(&fbc->lock);
+			fbc->count += atomic64_xchg(ncount, 0);
+			raw_spin_unlock(&fbc->lock);
+		}
+	} else {
+		this_cpu_add(*fbc->counters, amount);
+	}
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(percpu_node_counter_add_batch);
+
+/*
+ * The global count plus the node counts.  This leaves out the per-cpu
+ * counts, so it is off by less than the batch per online CPU, but only
+ * reads one cacheline per node.
+ */
+s64 percpu_node_counter_read(struct percpu_node_counter *pnc)
+{
+	s64 ret = READ_ONCE(pnc->fbc.count);
+	int node;
+
+	for_each_node(node)
+		ret += atomic64_read(&pnc->nodes[node]->count);
+	return ret;
+}
+EXPORT_SYMBOL(percpu_node_counter_read);
+
+s64 percpu_node_counter_sum(struct percpu_node_counter *pnc)
+{
+	struct percpu_counter *fbc = &pnc->fbc;
+	unsigned long flags;
+	s64 ret;
+	int cpu, node;
+
+	raw_spin_lock_irqsave(&fbc->lock, flags);
+	ret = fbc->count;
+	for_each_node(node)
+		ret += atomic64_read(&pnc->nodes[node]->count);
+	for_each_cpu_or(cpu, cpu_online_mask, cpu_dying_mask)
+		ret += *per_cpu_ptr(fbc->counters, cpu);
+	raw_spin_unlock_irqrestore(&fbc->lock, flags);
+	return ret;
+}
+EXPORT_SYMBOL(percpu_node_counter_sum);
+#endif /* CONFIG_NUMA */
+
 int percpu_counter_batch __read_mostly = 32;
 EXPORT_SYMBOL(percpu_counter_batch);
 
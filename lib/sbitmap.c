@@ -9,6 +9,48 @@
 #include <linux/sbitmap.h>
 #include <linux/seq_file.h>
 
+/*
+ * On NUMA machines the words of the map are split in one range per node:
+ * word @index belongs to node (@index * nr_node_ids / map_nr).  The hint of
+ * a CPU is kept within the range of its node, so that the CPUs of different
+ * nodes start their searches in different cachelines.  Nothing stops a CPU
+ * from allocating from the other ranges once its own runs dry.
+ */
+static inline bool sbitmap_split_nodes(const struct sbitmap *sb)
+{
+	return nr_node_ids > 1 && sb->map_nr >= nr_node_ids;
+}
+
+static inline bool sbitmap_word_is_local(const struct sbitmap *sb,
+					 unsigned int index, int node)
+{
+	if (!sbitmap_split_nodes(sb) || node == NUMA_NO_NODE)
+		return true;
+
+	return index * nr_node_ids / sb->map_nr == node;
+}
+
+/* A random hint within the range of @node */
+static unsigned int sbitmap_node_hint(const struct sbitmap *sb,
+				      unsigned int depth, int node)
+{
+	unsigned int start, end;
+
+	if (!depth)
+		return 0;
+
+	if (!sbitmap_split_nodes(sb) || node == NUMA_NO_NODE)
+		return get_random_u32_below(depth);
+
+	start = DIV_ROUND_UP(node * sb->map_nr, nr_node_ids) << sb->shift;
+	end = DIV_ROUND_UP((node + 1) * sb->map_nr, nr_node_ids) << sb->shift;
+	end = min(end, depth);
+	if (start >= end)
+		return get_random_u32_below(depth);
+
+	return start + get_random_u32_below(end - start);
+}
+
 static int init_alloc_hint(struct sbitmap *sb, gfp_t flags)
 {
 	unsigned depth = sb->depth;
@@ -21,7 +63,8 @@ static int init_alloc_hint(struct sbitmap *sb, gfp_t flags)
 		int i;
 
 		for_each_possible_cpu(i)
-			*per_cpu_ptr(sb->alloc_hint, i) = get_random_u32_below(depth);
+			*per_cpu_ptr(sb->alloc_hint, i) =
+				sbitmap_node_hint(sb, depth, cpu_to_node(i));
 	}
 	return 0;
 }
@@ -33,7 +76,7 @@ static inline unsigned update_alloc_hint_before_get(struct sbitmap *sb,
 
 	hint = this_cpu_read(*sb->alloc_hint);
 	if (unlikely(hint >= depth)) {
-		hint = depth ? get_random_u32_below(depth) : 0;
+		hint = sbitmap_node_hint(sb, depth, numa_node_id());
 		this_cpu_write(*sb->alloc_hint, hint);
 	}
 
@@ -46,8 +89,14 @@ static inline void update_alloc_hint_after_get(struct sbitmap *sb,
 					       unsigned int nr)
 {
 	if (nr == -1) {
-		/* If the map is full, a hint won't do us much good. */
-		this_cpu_write(*sb->alloc_hint, 0);
+		/*
+		 * If the map is full, a hint won't do us much good, beyond
+		 * bringing us back to our own node's words.
+		 */
+		hint = 0;
+		if (!sb->round_robin && sbitmap_split_nodes(sb))
+			hint = sbitmap_node_hint(sb, depth, numa_node_id());
+		this_cpu_write(*sb->alloc_hint, hint);
 	} else if (nr == hint || unlikely(sb->round_robin)) {
 		/* Only update the hint if we used it. */
 		hint = nr + 1;
@@ -597,7 +646,10 @@ EXPORT_SYMBOL_GPL(sbitmap_queue_wake_up);
 
 static inline void sbitmap_update_cpu_hint(struct sbitmap *sb, int cpu, int tag)
 {
-	if (likely(!sb->round_robin && tag < sb->depth))
+	/* Don't pull the hint of @cpu over to another node's words */
+	if (likely(!sb->round_robin && tag < sb->depth &&
+		   sbitmap_word_is_local(sb, SB_NR_TO_INDEX(sb, tag),
+					 cpu_to_node(cpu))))
 		data_race(*per_cpu_ptr(sb->alloc_hint, cpu) = tag);
 }
 
@@ -48,6 +48,8 @@ atomic_t maple_tree_tests_passed;
 /* #define BENCH_FORK */
 /* #define BENCH_MAS_FOR_EACH */
 /* #define BENCH_MAS_PREV */
+/* #define BENCH_STORE_RANGES */
+/* #define BENCH_LOAD_MANY */
 
 #ifdef __KERNEL__
 #define mt_set_non_kernel(x)		do {} while (0)
@@ -1852,6 +1854,131 @@ static noinline void __init bench_mas_prev(struct maple_tree *mt)
 
 }
 #endif
+#if defined(BENCH_STORE_RANGES) || defined(BENCH_LOAD_MANY)
+#define BENCH_NR_RANGES		20000
+static struct maple_range bench_ranges[BENCH_NR_RANGES] __initdata;
+static unsigned long bench_indices[BENCH_NR_RANGES] __initdata;
+static void *bench_entries[BENCH_NR_RANGES] __initdata;
+
+static void __init bench_init_ranges(void)
+{
+	int i;
+
+	for (i = 0; i < BENCH_NR_RANGES; i++) {
+		bench_ranges[i].index = i * 10;
+		bench_ranges[i].last = i * 10 + 5;
+		bench_ranges[i].entry = xa_mk_value(i);
+		bench_indices[i] = i * 10 + 3;
+	}
+}
+#endif
+
+#if defined(BENCH_STORE_RANGES)
+static noinline void __init bench_store_ranges(struct maple_tree *mt)
+{
+	int i, count = 2000;
+
+	bench_init_ranges();
+	for (i = 0; i < count; i++) {
+		mt_init_flags(mt, MT_FLAGS_ALLOC_RANGE);
+		MT_BUG_ON(mt, mtree_store_ranges(mt, bench_ranges,
+						 BENCH_NR_RANGES, GFP_KERNEL));
+		mtree_destroy(mt);
+	}
+}
+#endif
+
+#if defined(BENCH_LOAD_MANY)
+static noinline void __init bench_load_many(struct maple_tree *mt)
+{
+	int i, count = 20000;
+
+	bench_init_ranges();
+	MT_BUG_ON(mt, mtree_store_ranges(mt, bench_ranges, BENCH_NR_RANGES,
+					 GFP_KERNEL));
+	for (i = 0; i < count; i++)
+		mtree_load_many(mt, bench_indices, bench_entries,
+				BENCH_NR_RANGES);
+}
+#endif
+
+static noinline void __init check_store_ranges(struct maple_tree *mt)
+{
+	static struct maple_range ranges[1000] __initdata;
+	unsigned long indices[4];
+	void *entries[4];
+	unsigned long i, nr = ARRAY_SIZE(ranges);
+	MA_STATE(mas, mt, 0, 0);
+	void *entry;
+
+	for (i = 0; i < nr; i++) {
+		ranges[i].index = i * 10;
+		ranges[i].last = i * 10 + 5;
+		ranges[i].entry = xa_mk_value(i);
+	}
+
+	/* Bulk build of an empty tree */
+	MT_BUG_ON(mt, mtree_store_ranges(mt, ranges, nr, GFP_KERNEL));
+	mt_validate(mt);
+	i = 0;
+	mas_lock(&mas);
+	mas_for_each(&mas, entry, ULONG_MAX) {
+		MT_BUG_ON(mt, entry != xa_mk_value(i));
+		MT_BUG_ON(mt, mas.index != i * 10);
+		MT_BUG_ON(mt, mas.last != i * 10 + 5);
+		i++;
+	}
+	mas_unlock(&mas);
+	MT_BUG_ON(mt, i != nr);
+
+	/* Batched lookups: same entry, same leaf, holes and unsorted input */
+	indices[0] = 4;
+	indices[1] = 5;
+	indices[2] = 8;
+	indices[3] = 9990;
+	mtree_load_many(mt, indices, entries, 4);
+	MT_BUG_ON(mt, entries[0] != xa_mk_value(0));
+	MT_BUG_ON(mt, entries[1] != xa_mk_value(0));
+	MT_BUG_ON(mt, entries[2] != NULL);
+	MT_BUG_ON(mt, entries[3] != xa_mk_value(999));
+
+	indices[0] = 5005;
+	indices[1] = 12;
+	indices[2] = ULONG_MAX;
+	indices[3] = 5003;
+	mtree_load_many(mt, indices, entries, 4);
+	MT_BUG_ON(mt, entries[0] != xa_mk_value(500));
+	MT_BUG_ON(mt, entries[1] != xa_mk_value(1));
+	MT_BUG_ON(mt, entries[2] != NULL);
+	MT_BUG_ON(mt, entries[3] != xa_mk_value(500));
+
+	/* Overwriting a populated tree takes the regular path */
+	for (i = 0; i < nr; i++)
+		ranges[i].entry = xa_mk_value(i + 1);
+	MT_BUG_ON(mt, mtree_store_ranges(mt, ranges, nr, GFP_KERNEL));
+	mt_validate(mt);
+	for (i = 0; i < nr; i++)
+		MT_BUG_ON(mt, mtree_load(mt, i * 10 + 2) != xa_mk_value(i + 1));
+
+	/* Unsorted, overlapping and reversed ranges are refused */
+	ranges[1].index = 0;
+	MT_BUG_ON(mt, mtree_store_ranges(mt, ranges, nr, GFP_KERNEL) != -EINVAL);
+	ranges[1].index = 10;
+	ranges[1].last = 9;
+	MT_BUG_ON(mt, mtree_store_ranges(mt, ranges, nr, GFP_KERNEL) != -EINVAL);
+	ranges[1].last = 15;
+	MT_BUG_ON(mt, mtree_load(mt, 2) != xa_mk_value(1));
+
+	/* A single range and an empty array */
+	mtree_destroy(mt);
+	mt_init_flags(mt, MT_FLAGS_ALLOC_RANGE);
+	MT_BUG_ON(mt, mtree_store_ranges(mt, ranges, 0, GFP_KERNEL));
+	MT_BUG_ON(mt, !mtree_empty(mt));
+	MT_BUG_ON(mt, mtree_store_ranges(mt, ranges, 1, GFP_KERNEL));
+	MT_BUG_ON(mt, mtree_load(mt, 5) != xa_mk_value(1));
+	MT_BUG_ON(mt, mtree_load(mt, 6) != NULL);
+}
+
 /* check_forking - simulate the kernel forking sequence with the tree. */
 static noinline void __init check_forking(void)
 {
@@ -3709,6 +3836,18 @@ static int __init maple_tree_seed(void)
 	mtree_destroy(&tree);
 	goto skip;
 #endif
+#if defined(BENCH_STORE_RANGES)
+#define BENCH
+	bench_store_ranges(&tree);
+	goto skip;
+#endif
+#if defined(BENCH_LOAD_MANY)
+#define BENCH
+	mt_init_flags(&tree, MT_FLAGS_ALLOC_RANGE);
+	bench_load_many(&tree);
+	mtree_destroy(&tree);
+	goto skip;
+#endif
 
 	mt_init_flags(&tree, MT_FLAGS_ALLOC_RANGE);
 	check_root_expand(&tree);
@@ -3923,6 +4062,10 @@ static int __init maple_tree_seed(void)
 	alloc_cyclic_testing(&tree);
 	mtree_destroy(&tree);
 
+	mt_init_flags(&tree, MT_FLAGS_ALLOC_RANGE);
+	check_store_ranges(&tree);
+	mtree_destroy(&tree);
+
 
 #if defined(BENCH)
 skip:
@@ -0,0 +1,396 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Throughput benchmarks for the page, slab and vmalloc allocators.
+ *
+ * A run is started by writing "<test> [threads [ops [order [size]]]]" to
+ * /sys/kernel/debug/mm_bench/run, for example:
+ *
+ *	# echo "slab_remote 8 1000000 0 256" > /sys/kernel/debug/mm_bench/run
+ *	# cat /sys/kernel/debug/mm_bench/run
+ *	8000000 912345678
+ *
+ * Each worker is bound to its own online CPU and does <ops> allocations
+ * and the matching frees. Reading the file back returns the number of
+ * allocations done by all workers together and the wall time in nsecs of
+ * the slowest worker. "perf bench mm" drives this interface.
+ */
+#include <linux/cpu.h>
+#include <linux/debugfs.h>
+#include <linux/gfp.h>
+#include <linux/kthread.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/ptr_ring.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+/* Allocations done at once by the batched tests */
+#define MM_BENCH_BATCH		64
+
+enum mm_bench_test {
+	MM_BENCH_PAGES,
+	MM_BENCH_PAGES_BULK,
+	MM_BENCH_SLAB,
+	MM_BENCH_SLAB_REMOTE,
+	MM_BENCH_VMALLOC,
+	MM_BENCH_NR_TESTS,
+};
+
+static const char * const mm_bench_names[MM_BENCH_NR_TESTS] = {
+	[MM_BENCH_PAGES]	= "pages",
+	[MM_BENCH_PAGES_BULK]	= "pages_bulk",
+	[MM_BENCH_SLAB]		= "slab",
+	[MM_BENCH_SLAB_REMOTE]	= "slab_remote",
+	[MM_BENCH_VMALLOC]	= "vmalloc",
+};
+
+struct mm_bench_worker {
+	struct task_struct	*task;
+	/* Objects handed over by the previous worker, for slab_remote */
+	struct ptr_ring		ring;
+	struct mm_bench_worker	*next;
+	bool			finished;
+	u64			ops;
+	u64			nsecs;
+	int			err;
+};
+
+static struct mm_bench {
+	enum mm_bench_test	test;
+	unsigned int		nr_threads;
+	unsigned long		nr_ops;
+	unsigned int		order;
+	size_t			size;
+
+	atomic_t		nr_running;
+	struct completion	start;
+	struct completion	done;
+
+	/* Result of the last run */
+	bool			valid;
+	u64			ops;
+	u64			nsecs;
+} bench;
+
+/* Serializes runs and access to the results */
+static DEFINE_MUTEX(mm_bench_mutex);
+static struct dentry *mm_bench_dir;
+
+static int mm_bench_pages(struct mm_bench_worker *w)
+{
+	struct page *page;
+	unsigned long i;
+
+	for (i = 0; i < bench.nr_ops; i++) {
+		page = alloc_pages(GFP_KERNEL, bench.order);
+		if (!page)
+			return -ENOMEM;
+		__free_pages(page, bench.order);
+		w->ops++;
+		cond_resched();
+	}
+	return 0;
+}
+
+static int mm_bench_pages_bulk(struct mm_bench_worker *w)
+{
+	struct page *pages[MM_BENCH_BATCH] = { };
+	unsigned long nr, i;
+
+	while (w->ops < bench.nr_ops) {
+		nr = min_t(unsigned long, MM_BENCH_BATCH, bench.nr_ops - w->ops);
+		nr = alloc_pages_bulk_array(GFP_KERNEL, nr, pages);
+		if (!nr)
+			return -ENOMEM;
+		for (i = 0; i < nr; i++) {
+			__free_page(pages[i]);
+			pages[i] = NULL;
+		}
+		w->ops += nr;
+		cond_resched();
+	}
+	return 0;
+}
+
+static int mm_bench_slab(struct mm_bench_worker *w)
+{
+	void *objs[MM_BENCH_BATCH];
+	unsigned long nr, i;
+	int ret = 0;
+
+	while (w->ops < bench.nr_ops) {
+		nr = min_t(unsigned long, MM_BENCH_BATCH, bench.nr_ops - w->ops);
+		for (i = 0; i < nr; i++) {
+			objs[i] = kmalloc(bench.size, GFP_KERNEL);
+			if (!objs[i]) {
+				ret = -ENOMEM;
+				break;
+			}
+		}
+		w->ops += i;
+		nr = i;
+		for (i = 0; i < nr; i++)
+			kfree(objs[i]);
+		if (ret)
+			return ret;
+		cond_resched();
+	}
+	return 0;
+}
+
+static void mm_bench_kfree(void *obj)
+{
+	kfree(obj);
+}
+
+static void mm_bench_drain(struct mm_bench_worker *w)
+{
+	void *obj;
+
+	while ((obj = ptr_ring_consume(&w->ring)))
+		kfree(obj);
+}
+
+/*
+ * Every object is freed by the worker on the next CPU, so that frees hit
+ * slabs owned by a remote CPU. Whatever the neighbour hasn't picked up by
+ * the time it finished is freed by the module once all workers are done.
+ */
+static int mm_bench_slab_remote(struct mm_bench_worker *w)
+{
+	struct mm_bench_worker *next = w->next;
+	unsigned long i;
+	void *obj;
+
+	for (i = 0; i < bench.nr_ops; i++) {
+		obj = kmalloc(bench.size, GFP_KERNEL);
+		if (!obj)
+			return -ENOMEM;
+		while (ptr_ring_produce(&next->ring, obj)) {
+			if (READ_ONCE(next->finished)) {
+				kfree(obj);
+				break;
+			}
+			mm_bench_drain(w);
+			cond_resched();
+		}
+		w->ops++;
+		mm_bench_drain(w);
+	}
+	return 0;
+}
+
+static int mm_bench_vmalloc(struct mm_bench_worker *w)
+{
+	unsigned long i;
+	void *p;
+
+	for (i = 0; i < bench.nr_ops; i++) {
+		p = vmalloc(bench.size);
+		if (!p)
+			return -ENOMEM;
+		vfree(p);
+		w->ops++;
+		cond_resched();
+	}
+	return 0;
+}
+
+static int mm_bench_run_one(struct mm_bench_worker *w)
+{
+	switch (bench.test) {
+	case MM_BENCH_PAGES:
+		return mm_bench_pages(w);
+	case MM_BENCH_PAGES_BULK:
+		return mm_bench_pages_bulk(w);
+	case MM_BENCH_SLAB:
+		return mm_bench_slab(w);
+	case MM_BENCH_SLAB_REMOTE:
+		return mm_bench_slab_remote(w);
+	case MM_BENCH_VMALLOC:
+		return mm_bench_vmalloc(w);
+	default:
+		return -EINVAL;
+	}
+}
+
+static int mm_bench_thread(void *data)
+{
+	struct mm_bench_worker *w = data;
+	ktime_t start;
+
+	wait_for_completion(&bench.start);
+
+	start = ktime_get();
+	w->err = mm_bench_run_one(w);
+	w->nsecs = ktime_to_ns(ktime_sub(ktime_get(), start));
+	WRITE_ONCE(w->finished, true);
+
+	if (atomic_dec_and_test(&bench.nr_running))
+		complete(&bench.done);
+
+	/* Wait for kthread_stop() */
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	__set_current_state(TASK_RUNNING);
+	return 0;
+}
+
+static int mm_bench_run(void)
+{
+	struct mm_bench_worker *workers;
+	unsigned int i, started = 0;
+	int cpu, ret = 0;
+
+	workers = kvcalloc(bench.nr_threads, sizeof(*workers), GFP_KERNEL);
+	if (!workers)
+		return -ENOMEM;
+
+	for (i = 0; i < bench.nr_threads; i++) {
+		workers[i].next = &workers[(i + 1) % bench.nr_threads];
+		if (bench.test != MM_BENCH_SLAB_REMOTE)
+			continue;
+		ret = ptr_ring_init(&workers[i].ring, 4 * MM_BENCH_BATCH, GFP_KERNEL);
+		if (ret)
+			goto out_rings;
+	}
+
+	init_completion(&bench.start);
+	init_completion(&bench.done);
+	atomic_set(&bench.nr_running, 1);
+
+	cpus_read_lock();
+	cpu = cpumask_first(cpu_online_mask);
+	for (i = 0; i < bench.nr_threads; i++) {
+		struct task_struct *task;
+
+		task = kthread_create_on_cpu(mm_bench_thread, &workers[i], cpu,
+					     "mm_bench/%u");
+		if (IS_ERR(task)) {
+			ret = PTR_ERR(task);
+			break;
+		}
+		workers[i].task = task;
+		atomic_inc(&bench.nr_running);
+		wake_up_process(task);
+		started++;
+		cpu = cpumask_next(cpu, cpu_online_mask);
+	}
+	cpus_read_unlock();
+
+	/*
+	 * Workers that couldn't be created never finish; let those that were
+	 * created skip their handover to them.
+	 */
+	for (i = started; i < bench.nr_threads; i++)
+		workers[i].finished = true;
+
+	complete_all(&bench.start);
+	if (!atomic_dec_and_test(&bench.nr_running))
+		wait_for_completion(&bench.done);
+
+	bench.ops = 0;
+	bench.nsecs = 0;
+	for (i = 0; i < started; i++) {
+		kthread_stop(workers[i].task);
+		bench.ops += workers[i].ops;
+		bench.nsecs = max(bench.nsecs, workers[i].nsecs);
+		if (!ret)
+			ret = workers[i].err;
+	}
+	bench.valid = !ret;
+
+	i = bench.nr_threads;
+out_rings:
+	if (bench.test == MM_BENCH_SLAB_REMOTE) {
+		while (i--)
+			ptr_ring_cleanup(&workers[i].ring, mm_bench_kfree);
+	}
+	kvfree(workers);
+	return ret;
+}
+
+static ssize_t mm_bench_write(struct file *file, const char __user *ubuf,
+			      size_t count, loff_t *ppos)
+{
+	unsigned int threads = 1, order = 0;
+	unsigned long ops = 100000;
+	size_t size = PAGE_SIZE;
+	char buf[64], name[16];
+	int i, ret;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	if (sscanf(buf, "%15s %u %lu %u %zu", name, &threads, &ops, &order,
+		   &size) < 1)
+		return -EINVAL;
+
+	i = match_string(mm_bench_names, MM_BENCH_NR_TESTS, name);
+	if (i < 0)
+		return -EINVAL;
+
+	if (!threads || threads > num_online_cpus() || !ops ||
+	    order > MAX_PAGE_ORDER || !size || size > KMALLOC_MAX_SIZE)
+		return -EINVAL;
+
+	mutex_lock(&mm_bench_mutex);
+	bench.test = i;
+	bench.nr_threads = threads;
+	bench.nr_ops = ops;
+	bench.order = order;
+	bench.size = size;
+	bench.valid = false;
+	ret = mm_bench_run();
+	mutex_unlock(&mm_bench_mutex);
+
+	return ret ? ret : count;
+}
+
+static ssize_t mm_bench_read(struct file *file, char __user *ubuf,
+			     size_t count, loff_t *ppos)
+{
+	char buf[48];
+	int len;
+
+	mutex_lock(&mm_bench_mutex);
+	if (!bench.valid) {
+		mutex_unlock(&mm_bench_mutex);
+		return -ENODATA;
+	}
+	len = scnprintf(buf, sizeof(buf), "%llu %llu\n", bench.ops, bench.nsecs);
+	mutex_unlock(&mm_bench_mutex);
+
+	return simple_read_from_buffer(ubuf, count, ppos, buf, len);
+}
+
+static const struct file_operations mm_bench_fops = {
+	.owner	= THIS_MODULE,
+	.read	= mm_bench_read,
+	.write	= mm_bench_write,
+	.llseek	= default_llseek,
+};
+
+static int __init mm_bench_init(void)
+{
+	mm_bench_dir = debugfs_create_dir("mm_bench", NULL);
+	debugfs_create_file("run", 0600, mm_bench_dir, NULL, &mm_bench_fops);
+	return 0;
+}
+module_init(mm_bench_init);
+
+static void __exit mm_bench_exit(void)
+{
+	debugfs_remove_recursive(mm_bench_dir);
+}
+module_exit(mm_bench_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Page, slab and vmalloc allocator throughput benchmarks");
@@ -173,6 +173,65 @@ static int __init test_rht_lookup(struct rhashtable *ht, struct test_obj *array,
 	return 0;
 }
 
+#define TEST_BULK_KEYS	64
+
+static int __init test_rht_lookup_bulk(struct rhashtable *ht,
+				       struct test_obj *array,
+				       unsigned int entries)
+{
+	struct test_obj_val keys[TEST_BULK_KEYS];
+	const void *key_ptrs[TEST_BULK_KEYS];
+	void *objs[TEST_BULK_KEYS];
+	unsigned int i, j, nr, found, expected_found;
+	s64 start, end;
+
+	start = ktime_get_ns();
+	for (i = 0; i < entries; i += nr) {
+		nr = min_t(unsigned int, entries - i, TEST_BULK_KEYS);
+		expected_found = 0;
+		for (j = 0; j < nr; j++) {
+			memset(&keys[j], 0, sizeof(keys[j]));
+			keys[j].id = i + j;
+			key_ptrs[j] = &keys[j];
+		}
+
+		found = rhashtable_lookup_bulk(ht, key_ptrs, objs, nr,
+					       test_rht_params);
+
+		for (j = 0; j < nr; j++) {
+			struct test_obj *obj = objs[j];
+			bool expected = !((i + j) % 2);
+
+			if (array[(i + j) / 2].value.id == TEST_INSERT_FAIL)
+				expected = false;
+			expected_found += expected;
+
+			if (expected != !!obj) {
+				pr_warn("Test failed: bulk lookup of key %u returned %p\n",
+					i + j, obj);
+				return -EINVAL;
+			}
+			if (obj && obj->value.id != i + j) {
+				pr_warn("Test failed: Bulk lookup value mismatch %u!=%u\n",
+					obj->value.id, i + j);
+				return -EINVAL;
+			}
+		}
+
+		if (found != expected_found) {
+			pr_warn("Test failed: bulk lookup found %u of %u keys\n",
+				found, expected_found);
+			return -EINVAL;
+		}
+
+		cond_resched_rcu();
+	}
+	end = ktime_get_ns();
+	pr_info("  Bulk lookup of %u keys: %lld ns\n", entries, end - start);
+
+	return 0;
+}
+
 static void test_bucket_stats(struct rhashtable *ht, unsigned int entries)
 {
 	unsigned int total = 0, chain_len = 0;
@@ -212,7 +271,7 @@ static s64 __init test_rhashtable(struct rhashtable *ht, struct test_obj *array,
 	struct test_obj *obj;
 	int err;
 	unsigned int i, insert_retries = 0;
-	s64 start, end;
+	s64 start, end, lookup_start;
 
 	/*
 	 * Insertion Test:
@@ -237,7 +296,11 @@ static s64 __init test_rhashtable(struct rhashtable *ht, struct test_obj *array,
 
 	test_bucket_stats(ht, entries);
 	rcu_read_lock();
+	lookup_start = ktime_get_ns();
 	test_rht_lookup(ht, array, entries);
+	pr_info("  Lookup of %u keys: %lld ns\n", entries,
+		ktime_get_ns() - lookup_start);
+	test_rht_lookup_bulk(ht, array, entries);
 	rcu_read_unlock();
 
 	test_bucket_stats(ht, entries);
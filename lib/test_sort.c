@@ -5,6 +5,8 @@
 #include <linux/sort.h>
 #include <linux/slab.h>
 #include <linux/module.h>
+#include <linux/ktime.h>
+#include <linux/random.h>
 
 /* a simple boot-time regression test */
 
@@ -33,8 +35,94 @@ static void test_sort(struct kunit *test)
 		KUNIT_ASSERT_LE(test, a[i], a[i + 1]);
 }
 
+#define int_less(a, b) (*(a) < *(b))
+DEFINE_SORT(sort_ints, int, int_less)
+
+static void check_sort_ints(struct kunit *test, int *a, size_t num)
+{
+	size_t i;
+
+	sort_ints(a, num);
+	for (i = 1; i < num; i++)
+		KUNIT_ASSERT_LE(test, a[i - 1], a[i]);
+}
+
+static void test_sort_typed(struct kunit *test)
+{
+	int *a, i, r = 1;
+	size_t num;
+
+	a = kunit_kmalloc_array(test, TEST_LEN, sizeof(*a), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, a);
+
+	/* Every length up to a few times the insertion sort threshold */
+	for (num = 0; num <= 4 * SORT_INSERTION_THRESHOLD; num++) {
+		for (i = 0; i < num; i++) {
+			r = (r * 725861) % 6599;
+			a[i] = r;
+		}
+		check_sort_ints(test, a, num);
+	}
+
+	for (i = 0; i < TEST_LEN; i++) {
+		r = (r * 725861) % 6599;
+		a[i] = r;
+	}
+	check_sort_ints(test, a, TEST_LEN);
+
+	/* Sorted, reversed, all equal and few distinct values */
+	check_sort_ints(test, a, TEST_LEN);
+	for (i = 0; i < TEST_LEN; i++)
+		a[i] = TEST_LEN - i;
+	check_sort_ints(test, a, TEST_LEN);
+	for (i = 0; i < TEST_LEN; i++)
+		a[i] = 7;
+	check_sort_ints(test, a, TEST_LEN);
+	for (i = 0; i < TEST_LEN; i++)
+		a[i] = i % 3;
+	check_sort_ints(test, a, TEST_LEN);
+
+	/* Organ pipe, which defeats median-of-three pivots */
+	for (i = 0; i < TEST_LEN; i++)
+		a[i] = i < TEST_LEN / 2 ? i : TEST_LEN - i;
+	check_sort_ints(test, a, TEST_LEN);
+}
+
+#define BENCH_LEN	100000
+
+static void bench_sort(struct kunit *test)
+{
+	int *a, *b;
+	u64 start, generic_ns, typed_ns;
+	size_t i;
+
+	a = kunit_kmalloc_array(test, BENCH_LEN, sizeof(*a), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, a);
+	b = kunit_kmalloc_array(test, BENCH_LEN, sizeof(*b), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, b);
+
+	for (i = 0; i < BENCH_LEN; i++)
+		a[i] = b[i] = get_random_u32() >> 1;
+
+	start = ktime_get_ns();
+	sort(a, BENCH_LEN, sizeof(*a), cmpint, NULL);
+	generic_ns = ktime_get_ns() - start;
+
+	start = ktime_get_ns();
+	sort_ints(b, BENCH_LEN);
+	typed_ns = ktime_get_ns() - start;
+
+	for (i = 1; i < BENCH_LEN; i++)
+		KUNIT_ASSERT_LE(test, b[i - 1], b[i]);
+
+	kunit_info(test, "%d ints: sort() %llu ns, DEFINE_SORT() %llu ns\n",
+		   BENCH_LEN, generic_ns, typed_ns);
+}
+
 static struct kunit_case sort_test_cases[] = {
 	KUNIT_CASE(test_sort),
+	KUNIT_CASE(test_sort_typed),
+	KUNIT_CASE(bench_sort),
 	{}
 };
 
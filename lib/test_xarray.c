@@ -1414,6 +1414,60 @@ static noinline void check_find_entry(struct xarray *xa)
 	XA_BUG_ON(xa, !xa_empty(xa));
 }
 
+static noinline void check_peek_batch(struct xarray *xa)
+{
+	XA_STATE(xas, xa, 0);
+	void *entries[XA_CHUNK_SIZE];
+	unsigned long i;
+	unsigned int nr;
+
+	for (i = 0; i < 10; i++)
+		xa_store_index(xa, i, GFP_KERNEL);
+	xa_store_index(xa, 11, GFP_KERNEL);
+
+	rcu_read_lock();
+	XA_BUG_ON(xa, xas_load(&xas) != xa_mk_index(0));
+	nr = xas_peek_batch(&xas, ULONG_MAX, entries, ARRAY_SIZE(entries));
+	XA_BUG_ON(xa, nr != 9);
+	for (i = 0; i < nr; i++)
+		XA_BUG_ON(xa, entries[i] != xa_mk_index(i + 1));
+	XA_BUG_ON(xa, xas.xa_index != 0);
+
+	XA_BUG_ON(xa, xas_peek_batch(&xas, 4, entries, 8) != 4);
+	XA_BUG_ON(xa, xas_peek_batch(&xas, ULONG_MAX, entries, 2) != 2);
+
+	xas_set(&xas, 9);
+	XA_BUG_ON(xa, xas_load(&xas) != xa_mk_index(9));
+	XA_BUG_ON(xa, xas_peek_batch(&xas, ULONG_MAX, entries, 8) != 0);
+	rcu_read_unlock();
+
+	for (i = 0; i < 10; i++)
+		xa_erase_index(xa, i);
+	xa_erase_index(xa, 11);
+	XA_BUG_ON(xa, !xa_empty(xa));
+
+#ifdef CONFIG_XARRAY_MULTI
+	/* Sibling slots are skipped, the entry is returned once */
+	xa_store_order(xa, 4, 2, xa_mk_index(4), GFP_KERNEL);
+	xa_store_index(xa, 1, GFP_KERNEL);
+	xa_store_index(xa, 2, GFP_KERNEL);
+	xa_store_index(xa, 3, GFP_KERNEL);
+	xa_store_index(xa, 8, GFP_KERNEL);
+
+	xas_set(&xas, 1);
+	rcu_read_lock();
+	XA_BUG_ON(xa, xas_load(&xas) != xa_mk_index(1));
+	nr = xas_peek_batch(&xas, ULONG_MAX, entries, ARRAY_SIZE(entries));
+	XA_BUG_ON(xa, nr != 4);
+	XA_BUG_ON(xa, entries[0] != xa_mk_index(2));
+	XA_BUG_ON(xa, entries[1] != xa_mk_index(3));
+	XA_BUG_ON(xa, entries[2] != xa_mk_index(4));
+	XA_BUG_ON(xa, entries[3] != xa_mk_index(8));
+	rcu_read_unlock();
+	xa_destroy(xa);
+#endif
+}
+
 static noinline void check_pause(struct xarray *xa)
 {
 	XA_STATE(xas, xa, 0);
@@ -2148,6 +2202,7 @@ static int xarray_checks(void)
 	check_xa_alloc();
 	check_find(&array);
 	check_find_entry(&array);
+	check_peek_batch(&array);
 	check_pause(&array);
 	check_account(&array);
 	check_destroy(&array);
@@ -1298,6 +1298,53 @@ void *xas_find(struct xa_state *xas, unsigned long max)
 }
 EXPORT_SYMBOL_GPL(xas_find);
 
+/**
+ * xas_peek_batch() - Look at the entries following the current one.
+ * @xas: XArray operation state.
+ * @max: Highest index to look at.
+ * @entries: Array to copy the entries into.
+ * @nr: Size of @entries.
+ *
+ * Copies the entries after the one @xas points at out of the same node,
+ * without moving @xas.  The sibling slots of multi-index entries are
+ * skipped.  The copy stops at the end of the node, at an index above @max,
+ * at an empty slot or at an internal entry, so that a caller about to walk
+ * a dense range can start fetching the entries it is going to find there.
+ * The entries are not pinned in any way; they have to be looked up again
+ * before they are used.
+ *
+ * Context: Any context.  The caller should hold the xa_lock or the RCU lock.
+ * Return: The number of entries copied.
+ */
+unsigned int xas_peek_batch(const struct xa_state *xas, unsigned long max,
+		void **entries, unsigned int nr)
+{
+	struct xa_node *node = xas->xa_node;
+	unsigned long base;
+	unsigned int offset, count = 0;
+
+	if (xas_not_node(node))
+		return 0;
+
+	base = xas->xa_index & ~((XA_CHUNK_SIZE << node->shift) - 1);
+	for (offset = xas->xa_offset + 1;
+	     offset < XA_CHUNK_SIZE && count < nr; offset++) {
+		void *entry;
+
+		if (base + ((unsigned long)offset << node->shift) > max)
+			break;
+		entry = xa_entry(xas->xa, node, offset);
+		if (xa_is_sibling(entry))
+			continue;
+		if (!entry || xa_is_internal(entry))
+			break;
+		entries[count++] = entry;
+	}
+
+	return count;
+}
+EXPORT_SYMBOL_GPL(xas_peek_batch);
+
 /**
  * xas_find_marked() - Find the next marked entry in the XArray.
  * @xas: XArray operation state.
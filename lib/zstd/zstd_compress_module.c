@@ -11,7 +11,14 @@
 
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/nodemask.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/string.h>
+#include <linux/topology.h>
+#include <linux/wait.h>
 #include <linux/zstd.h>
 
 #include "common/zstd_deps.h"
@@ -101,6 +108,233 @@ size_t zstd_compress_cctx(zstd_cctx *cctx, void *dst, size_t dst_capacity,
 }
 EXPORT_SYMBOL(zstd_compress_cctx);
 
+zstd_cdict *zstd_create_cdict_byreference(const void *dict, size_t dict_size,
+	zstd_compression_parameters cparams, zstd_custom_mem custom_mem)
+{
+	return ZSTD_createCDict_advanced(dict, dict_size, ZSTD_dlm_byRef,
+		ZSTD_dct_auto, cparams, custom_mem);
+}
+EXPORT_SYMBOL(zstd_create_cdict_byreference);
+
+size_t zstd_free_cdict(zstd_cdict *cdict)
+{
+	return ZSTD_freeCDict(cdict);
+}
+EXPORT_SYMBOL(zstd_free_cdict);
+
+size_t zstd_compress_using_cdict(zstd_cctx *cctx, void *dst,
+	size_t dst_capacity, const void *src, size_t src_size,
+	const zstd_cdict *cdict)
+{
+	return ZSTD_compress_usingCDict(cctx, dst, dst_capacity,
+		src, src_size, cdict);
+}
+EXPORT_SYMBOL(zstd_compress_using_cdict);
+
+/*
+ * Shared compression contexts. Pools are keyed by workspace size only, so
+ * that e.g. all the users of one level share their workspaces, and each
+ * pool keeps its idle workspaces per node, on that node's memory.
+ */
+struct zstd_cctx_pool_node {
+	spinlock_t lock;
+	struct list_head idle;
+	unsigned int nr_ws;
+	unsigned int max_ws;
+};
+
+struct zstd_cctx_pool {
+	struct list_head list;
+	size_t workspace_size;
+	unsigned int users;
+	wait_queue_head_t wait;
+	struct zstd_cctx_pool_node nodes[];
+};
+
+static LIST_HEAD(zstd_cctx_pools);
+static DEFINE_MUTEX(zstd_cctx_pools_lock);
+
+static struct zstd_pool_cctx *zstd_pool_alloc_cctx(struct zstd_cctx_pool *pool,
+	int node)
+{
+	struct zstd_pool_cctx *pctx;
+
+	pctx = kmalloc_node(sizeof(*pctx), GFP_KERNEL, node);
+	if (!pctx)
+		return NULL;
+	pctx->workspace = kvmalloc_node(pool->workspace_size, GFP_KERNEL, node);
+	pctx->cctx = zstd_init_cctx(pctx->workspace, pool->workspace_size);
+	if (!pctx->cctx) {
+		kvfree(pctx->workspace);
+		kfree(pctx);
+		return NULL;
+	}
+	pctx->node = node;
+	return pctx;
+}
+
+static void zstd_pool_free_cctx(struct zstd_pool_cctx *pctx)
+{
+	kvfree(pctx->workspace);
+	kfree(pctx);
+}
+
+/* Take an idle context of @node, or account for a new one if @alloc */
+static struct zstd_pool_cctx *zstd_pool_take_node(struct zstd_cctx_pool *pool,
+	int node, bool *alloc)
+{
+	struct zstd_cctx_pool_node *pn = &pool->nodes[node];
+	struct zstd_pool_cctx *pctx;
+
+	spin_lock(&pn->lock);
+	pctx = list_first_entry_or_null(&pn->idle, struct zstd_pool_cctx, list);
+	if (pctx) {
+		list_del(&pctx->list);
+		*alloc = false;
+	} else if (*alloc && pn->nr_ws < pn->max_ws) {
+		pn->nr_ws++;
+	} else {
+		*alloc = false;
+	}
+	spin_unlock(&pn->lock);
+	return pctx;
+}
+
+static bool zstd_pool_any_idle(struct zstd_cctx_pool *pool)
+{
+	int node;
+
+	for_each_node(node)
+		if (!list_empty_careful(&pool->nodes[node].idle))
+			return true;
+	return false;
+}
+
+static bool zstd_pool_any_cctx(struct zstd_cctx_pool *pool)
+{
+	int node;
+
+	for_each_node(node)
+		if (READ_ONCE(pool->nodes[node].nr_ws))
+			return true;
+	return false;
+}
+
+struct zstd_cctx_pool *zstd_cctx_pool_get(
+	const zstd_compression_parameters *parameters)
+{
+	size_t workspace_size = zstd_cctx_workspace_bound(parameters);
+	struct zstd_cctx_pool *pool;
+	int node;
+
+	mutex_lock(&zstd_cctx_pools_lock);
+	list_for_each_entry(pool, &zstd_cctx_pools, list) {
+		if (pool->workspace_size == workspace_size) {
+			pool->users++;
+			goto out;
+		}
+	}
+
+	pool = kzalloc(struct_size(pool, nodes, nr_node_ids), GFP_KERNEL);
+	if (!pool)
+		goto out;
+	pool->workspace_size = workspace_size;
+	pool->users = 1;
+	init_waitqueue_head(&pool->wait);
+	for_each_node(node) {
+		struct zstd_cctx_pool_node *pn = &pool->nodes[node];
+
+		spin_lock_init(&pn->lock);
+		INIT_LIST_HEAD(&pn->idle);
+		/* Memoryless or CPU-less nodes still get one context */
+		pn->max_ws = max(nr_cpus_node(node), 1);
+	}
+	list_add(&pool->list, &zstd_cctx_pools);
+out:
+	mutex_unlock(&zstd_cctx_pools_lock);
+	return pool;
+}
+EXPORT_SYMBOL(zstd_cctx_pool_get);
+
+void zstd_cctx_pool_put(struct zstd_cctx_pool *pool)
+{
+	struct zstd_pool_cctx *pctx, *tmp;
+	int node;
+
+	mutex_lock(&zstd_cctx_pools_lock);
+	if (--pool->users) {
+		mutex_unlock(&zstd_cctx_pools_lock);
+		return;
+	}
+	list_del(&pool->list);
+	mutex_unlock(&zstd_cctx_pools_lock);
+
+	for_each_node(node) {
+		struct zstd_cctx_pool_node *pn = &pool->nodes[node];
+
+		list_for_each_entry_safe(pctx, tmp, &pn->idle, list) {
+			zstd_pool_free_cctx(pctx);
+			pn->nr_ws--;
+		}
+		WARN_ON_ONCE(pn->nr_ws);
+	}
+	kfree(pool);
+}
+EXPORT_SYMBOL(zstd_cctx_pool_put);
+
+struct zstd_pool_cctx *zstd_cctx_pool_take(struct zstd_cctx_pool *pool)
+{
+	struct zstd_pool_cctx *pctx;
+	int local = numa_mem_id();
+	int node;
+	bool alloc;
+
+	might_sleep();
+	for (;;) {
+		alloc = true;
+		pctx = zstd_pool_take_node(pool, local, &alloc);
+		if (pctx)
+			return pctx;
+		if (alloc) {
+			pctx = zstd_pool_alloc_cctx(pool, local);
+			if (pctx)
+				return pctx;
+			spin_lock(&pool->nodes[local].lock);
+			pool->nodes[local].nr_ws--;
+			spin_unlock(&pool->nodes[local].lock);
+		}
+
+		/* A remote workspace is still better than none */
+		for_each_node(node) {
+			if (node == local)
+				continue;
+			alloc = false;
+			pctx = zstd_pool_take_node(pool, node, &alloc);
+			if (pctx)
+				return pctx;
+		}
+
+		/* Nobody to wait for if no memory for a first context */
+		if (!zstd_pool_any_cctx(pool))
+			return NULL;
+
+		wait_event(pool->wait, zstd_pool_any_idle(pool));
+	}
+}
+EXPORT_SYMBOL(zstd_cctx_pool_take);
+
+void zstd_cctx_pool_give(struct zstd_cctx_pool *pool,
+	struct zstd_pool_cctx *pctx)
+{
+	struct zstd_cctx_pool_node *pn = &pool->nodes[pctx->node];
+
+	spin_lock(&pn->lock);
+	list_add(&pctx->list, &pn->idle);
+	spin_unlock(&pn->lock);
+	wake_up(&pool->wait);
+}
+EXPORT_SYMBOL(zstd_cctx_pool_give);
+
 size_t zstd_cstream_workspace_bound(const zstd_compression_parameters *cparams)
 {
 	return ZSTD_estimateCStreamSize_usingCParams(*cparams);
@@ -33,7 +33,6 @@
 
 struct cma cma_areas[MAX_CMA_AREAS];
 unsigned cma_area_count;
-static DEFINE_MUTEX(cma_mutex);
 
 phys_addr_t cma_get_base(const struct cma *cma)
 {
@@ -116,6 +115,7 @@ static void __init cma_activate_area(struct cma *cma)
 		init_cma_reserved_pageblock(pfn_to_page(pfn));
 
 	spin_lock_init(&cma->lock);
+	mutex_init(&cma->alloc_mutex);
 
 #ifdef CONFIG_CMA_DEBUGFS
 	INIT_HLIST_HEAD(&cma->mem_head);
@@ -424,6 +424,7 @@ struct page *cma_alloc(struct cma *cma, unsigned long count,
 	struct page *page = NULL;
 	int ret = -ENOMEM;
 	const char *name = cma ? cma->name : NULL;
+	ktime_t start_time;
 
 	trace_cma_alloc_start(name, count, align);
 
@@ -444,6 +445,7 @@ struct page *cma_alloc(struct cma *cma, unsigned long count,
 	if (bitmap_count > bitmap_maxno)
 		return page;
 
+	start_time = ktime_get();
 	for (;;) {
 		spin_lock_irq(&cma->lock);
 		bitmap_no = bitmap_find_next_zero_area_off(cma->bitmap,
@@ -461,11 +463,16 @@ struct page *cma_alloc(struct cma *cma, unsigned long count,
 		 */
 		spin_unlock_irq(&cma->lock);
 
+		/*
+		 * CMA areas are pageblock aligned, so allocations from
+		 * different areas never isolate the same pageblock and only
+		 * need to be serialized within an area.
+		 */
 		pfn = cma->base_pfn + (bitmap_no << cma->order_per_bit);
-		mutex_lock(&cma_mutex);
+		mutex_lock(&cma->alloc_mutex);
 		ret = alloc_contig_range(pfn, pfn + count, MIGRATE_CMA,
 				     GFP_KERNEL | (no_warn ? __GFP_NOWARN : 0));
-		mutex_unlock(&cma_mutex);
+		mutex_unlock(&cma->alloc_mutex);
 		if (ret == 0) {
 			page = pfn_to_page(pfn);
 			break;
@@ -477,6 +484,7 @@ struct page *cma_alloc(struct cma *cma, unsigned long count,
 
 		pr_debug("%s(): memory range at pfn 0x%lx %p is busy, retrying\n",
 			 __func__, pfn, pfn_to_page(pfn));
+		cma_sysfs_account_busy_retry(cma);
 
 		trace_cma_alloc_busy_retry(cma->name, pfn, pfn_to_page(pfn),
 					   count, align);
@@ -509,6 +517,8 @@ struct page *cma_alloc(struct cma *cma, unsigned long count,
 		count_vm_event(CMA_ALLOC_FAIL);
 		cma_sysfs_account_fail_pages(cma, count);
 	}
+	cma_sysfs_account_alloc_time(cma, ktime_sub(ktime_get(), start_time),
+				     page);
 
 	return page;
 }
@@ -4,6 +4,11 @@
 
 #include <linux/debugfs.h>
 #include <linux/kobject.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+
+/* Decades of cma_alloc() latency: < 10us, < 100us, ... < 1s and the rest */
+#define CMA_NR_LATENCY_BUCKETS	7
 
 struct cma_kobject {
 	struct kobject kobj;
@@ -16,6 +21,8 @@ struct cma {
 	unsigned long   *bitmap;
 	unsigned int order_per_bit; /* Order of pages represented by one bit */
 	spinlock_t	lock;
+	/* serializes alloc_contig_range() within the area */
+	struct mutex	alloc_mutex;
 #ifdef CONFIG_CMA_DEBUGFS
 	struct hlist_head mem_head;
 	spinlock_t mem_head_lock;
@@ -29,6 +36,11 @@ struct cma {
 	atomic64_t nr_pages_failed;
 	/* the number of CMA page released */
 	atomic64_t nr_pages_released;
+	/* the number of retries because a range was busy */
+	atomic64_t nr_busy_retries;
+	/* cma_alloc() latency histograms of successes and failures */
+	atomic64_t alloc_latency[CMA_NR_LATENCY_BUCKETS];
+	atomic64_t alloc_fail_latency[CMA_NR_LATENCY_BUCKETS];
 	/* kobject requires dynamic object */
 	struct cma_kobject *cma_kobj;
 #endif
@@ -47,6 +59,8 @@ static inline unsigned long cma_bitmap_maxno(struct cma *cma)
 void cma_sysfs_account_success_pages(struct cma *cma, unsigned long nr_pages);
 void cma_sysfs_account_fail_pages(struct cma *cma, unsigned long nr_pages);
 void cma_sysfs_account_release_pages(struct cma *cma, unsigned long nr_pages);
+void cma_sysfs_account_busy_retry(struct cma *cma);
+void cma_sysfs_account_alloc_time(struct cma *cma, ktime_t time, bool success);
 #else
 static inline void cma_sysfs_account_success_pages(struct cma *cma,
 						   unsigned long nr_pages) {};
@@ -54,5 +68,8 @@ static inline void cma_sysfs_account_fail_pages(struct cma *cma,
 						unsigned long nr_pages) {};
 static inline void cma_sysfs_account_release_pages(struct cma *cma,
 						   unsigned long nr_pages) {};
+static inline void cma_sysfs_account_busy_retry(struct cma *cma) {};
+static inline void cma_sysfs_account_alloc_time(struct cma *cma,
+						ktime_t time, bool success) {};
 #endif
 #endif
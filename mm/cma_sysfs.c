@@ -29,6 +29,25 @@ void cma_sysfs_account_release_pages(struct cma *cma, unsigned long nr_pages)
 	atomic64_add(nr_pages, &cma->nr_pages_released);
 }
 
+void cma_sysfs_account_busy_retry(struct cma *cma)
+{
+	atomic64_inc(&cma->nr_busy_retries);
+}
+
+void cma_sysfs_account_alloc_time(struct cma *cma, ktime_t time, bool success)
+{
+	s64 us = ktime_to_us(time), limit = 10;
+	int i;
+
+	for (i = 0; i < CMA_NR_LATENCY_BUCKETS - 1 && us >= limit; i++)
+		limit *= 10;
+
+	if (success)
+		atomic64_inc(&cma->alloc_latency[i]);
+	else
+		atomic64_inc(&cma->alloc_fail_latency[i]);
+}
+
 static inline struct cma *cma_from_kobj(struct kobject *kobj)
 {
 	return container_of(kobj, struct cma_kobject, kobj)->cma;
@@ -62,6 +81,44 @@ static ssize_t release_pages_success_show(struct kobject *kobj,
 }
 CMA_ATTR_RO(release_pages_success);
 
+static ssize_t alloc_busy_retries_show(struct kobject *kobj,
+				       struct kobj_attribute *attr, char *buf)
+{
+	struct cma *cma = cma_from_kobj(kobj);
+
+	return sysfs_emit(buf, "%llu\n", atomic64_read(&cma->nr_busy_retries));
+}
+CMA_ATTR_RO(alloc_busy_retries);
+
+/*
+ * One line of counts per latency decade, from allocations that took less
+ * than 10us to those that took 1s or more.
+ */
+static ssize_t cma_latency_show(atomic64_t *hist, char *buf)
+{
+	int i, len = 0;
+
+	for (i = 0; i < CMA_NR_LATENCY_BUCKETS; i++)
+		len += sysfs_emit_at(buf, len, "%s%llu", i ? " " : "",
+				     atomic64_read(&hist[i]));
+	len += sysfs_emit_at(buf, len, "\n");
+	return len;
+}
+
+static ssize_t alloc_latency_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return cma_latency_show(cma_from_kobj(kobj)->alloc_latency, buf);
+}
+CMA_ATTR_RO(alloc_latency);
+
+static ssize_t alloc_fail_latency_show(struct kobject *kobj,
+				       struct kobj_attribute *attr, char *buf)
+{
+	return cma_latency_show(cma_from_kobj(kobj)->alloc_fail_latency, buf);
+}
+CMA_ATTR_RO(alloc_fail_latency);
+
 static void cma_kobj_release(struct kobject *kobj)
 {
 	struct cma *cma = cma_from_kobj(kobj);
@@ -75,6 +132,9 @@ static struct attribute *cma_attrs[] = {
 	&alloc_pages_success_attr.attr,
 	&alloc_pages_fail_attr.attr,
 	&release_pages_success_attr.attr,
+	&alloc_busy_retries_attr.attr,
+	&alloc_latency_attr.attr,
+	&alloc_fail_latency_attr.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(cma);
@@ -8,9 +8,12 @@
 #define pr_fmt(fmt) "damon-pa: " fmt
 
 #include <linux/mmu_notifier.h>
+#include <linux/moduleparam.h>
 #include <linux/page_idle.h>
 #include <linux/pagemap.h>
+#include <linux/perf_event.h>
 #include <linux/rmap.h>
+#include <linux/sort.h>
 #include <linux/swap.h>
 
 #include "../internal.h"
@@ -195,6 +198,260 @@ static unsigned int damon_pa_check_accesses(struct damon_ctx *ctx)
 	return max_nr_accesses;
 }
 
+/*
+ * Access sampling based monitoring
+ * ================================
+ *
+ * Instead of clearing and checking the accessed bits of one random page per
+ * region, the DAMON_OPS_PADDR_SAMPLED operations consume physical addresses
+ * of memory accesses that were sampled by hardware, such as AMD IBS, Intel
+ * PEBS or Arm SPE.  A region is considered accessed in a sampling interval
+ * if any sample hit it.  This costs nothing per region, so the overhead
+ * does not grow with the size of the monitored memory.
+ *
+ * Samples are reported with damon_report_access(), either by a driver of the
+ * sampling hardware or by the perf event the operations set up on their own
+ * when the 'damon_pa_sampled.event_type' parameter is set.
+ */
+
+#ifdef MODULE_PARAM_PREFIX
+#undef MODULE_PARAM_PREFIX
+#endif
+#define MODULE_PARAM_PREFIX "damon_pa_sampled."
+
+#define DAMON_PA_NR_SAMPLES	512
+
+struct damon_pa_samples {
+	unsigned long addrs[DAMON_PA_NR_SAMPLES];
+	unsigned int head;	/* written only by the local cpu */
+	unsigned int tail;	/* written only by the consumer */
+	int nesting;
+};
+
+static DEFINE_PER_CPU(struct damon_pa_samples, damon_pa_samples);
+
+/* serializes draining of the per-cpu sample buffers */
+static DEFINE_MUTEX(damon_pa_samples_lock);
+static unsigned long *damon_pa_samples_buf;
+static int damon_pa_sampled_users;
+static atomic_t damon_pa_sampling;
+
+/**
+ * damon_report_access() - Report a sampled access to physical memory.
+ * @paddr:	Physical address that has been accessed.
+ *
+ * This is meant to be called by the overflow handlers of hardware access
+ * sampling facilities, and is safe to be called from NMI context.  The
+ * report is ignored unless a DAMON context is running with the
+ * DAMON_OPS_PADDR_SAMPLED operations.
+ */
+void damon_report_access(unsigned long paddr)
+{
+	struct damon_pa_samples *samples;
+	unsigned long flags;
+	unsigned int head;
+
+	if (!atomic_read(&damon_pa_sampling))
+		return;
+
+	local_irq_save(flags);
+	samples = this_cpu_ptr(&damon_pa_samples);
+	/* an NMI hitting an ongoing report simply loses its sample */
+	if (samples->nesting++)
+		goto out;
+	barrier();
+
+	/* the buffer is full, the consumer will see enough samples */
+	head = samples->head;
+	if (head - smp_load_acquire(&samples->tail) >= DAMON_PA_NR_SAMPLES)
+		goto out;
+	samples->addrs[head % DAMON_PA_NR_SAMPLES] = paddr;
+	smp_store_release(&samples->head, head + 1);
+out:
+	barrier();
+	samples->nesting--;
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL_GPL(damon_report_access);
+
+#ifdef CONFIG_PERF_EVENTS
+/*
+ * Raw perf event to sample accesses with, e.g. type 4 and config 0x1cd with
+ * config1 holding the latency threshold for Intel load latency PEBS, or the
+ * dynamic type of the 'ibs_op' PMU on AMD.  -1 leaves reporting the samples
+ * to other kernel code.
+ */
+static int event_type = -1;
+module_param(event_type, int, 0600);
+
+static unsigned long long event_config __read_mostly;
+module_param(event_config, ullong, 0600);
+
+static unsigned long long event_config1 __read_mostly;
+module_param(event_config1, ullong, 0600);
+
+/* Number of events between two samples */
+static unsigned long long event_period __read_mostly = 10007;
+module_param(event_period, ullong, 0600);
+
+static unsigned int event_precise __read_mostly = 2;
+module_param(event_precise, uint, 0600);
+
+static DEFINE_PER_CPU(struct perf_event *, damon_pa_perf_event);
+
+static void damon_pa_perf_overflow(struct perf_event *event,
+		struct perf_sample_data *data, struct pt_regs *regs)
+{
+	perf_prepare_sample(data, event, regs);
+	if (data->sample_flags & PERF_SAMPLE_PHYS_ADDR && data->phys_addr)
+		damon_report_access(data->phys_addr);
+}
+
+static void damon_pa_perf_stop(void)
+{
+	struct perf_event *event;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		event = per_cpu(damon_pa_perf_event, cpu);
+		if (!event)
+			continue;
+		perf_event_release_kernel(event);
+		per_cpu(damon_pa_perf_event, cpu) = NULL;
+	}
+}
+
+static void damon_pa_perf_start(void)
+{
+	struct perf_event_attr attr = {
+		.size = sizeof(attr),
+		.sample_type = PERF_SAMPLE_ADDR | PERF_SAMPLE_PHYS_ADDR,
+		.exclude_hv = 1,
+		.exclude_idle = 1,
+	};
+	struct perf_event *event;
+	int cpu;
+
+	if (event_type < 0)
+		return;
+
+	attr.type = event_type;
+	attr.config = event_config;
+	attr.config1 = event_config1;
+	attr.sample_period = event_period;
+	attr.precise_ip = event_precise;
+
+	cpus_read_lock();
+	for_each_online_cpu(cpu) {
+		event = perf_event_create_kernel_counter(&attr, cpu, NULL,
+				damon_pa_perf_overflow, NULL);
+		if (IS_ERR(event)) {
+			pr_warn_once("creating the sampling event failed (%ld)\n",
+					PTR_ERR(event));
+			continue;
+		}
+		per_cpu(damon_pa_perf_event, cpu) = event;
+	}
+	cpus_read_unlock();
+}
+#else
+static inline void damon_pa_perf_start(void) {}
+static inline void damon_pa_perf_stop(void) {}
+#endif	/* CONFIG_PERF_EVENTS */
+
+static void damon_pa_sampled_init(struct damon_ctx *ctx)
+{
+	int cpu;
+
+	mutex_lock(&damon_pa_samples_lock);
+	if (!damon_pa_sampled_users++) {
+		damon_pa_samples_buf = kvmalloc_array(nr_cpu_ids,
+				sizeof(unsigned long) * DAMON_PA_NR_SAMPLES,
+				GFP_KERNEL);
+		/* discard samples left over from the last run */
+		for_each_possible_cpu(cpu) {
+			struct damon_pa_samples *samples;
+
+			samples = per_cpu_ptr(&damon_pa_samples, cpu);
+			samples->tail = READ_ONCE(samples->head);
+		}
+		atomic_set(&damon_pa_sampling, 1);
+		damon_pa_perf_start();
+	}
+	mutex_unlock(&damon_pa_samples_lock);
+}
+
+static void damon_pa_sampled_cleanup(struct damon_ctx *ctx)
+{
+	mutex_lock(&damon_pa_samples_lock);
+	if (!--damon_pa_sampled_users) {
+		atomic_set(&damon_pa_sampling, 0);
+		damon_pa_perf_stop();
+		kvfree(damon_pa_samples_buf);
+		damon_pa_samples_buf = NULL;
+	}
+	mutex_unlock(&damon_pa_samples_lock);
+}
+
+/* Move the samples of all cpus into damon_pa_samples_buf */
+static unsigned long damon_pa_drain_samples(void)
+{
+	unsigned long nr = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct damon_pa_samples *samples;
+		unsigned int head, tail;
+
+		samples = per_cpu_ptr(&damon_pa_samples, cpu);
+		head = smp_load_acquire(&samples->head);
+		for (tail = samples->tail; tail != head; tail++)
+			damon_pa_samples_buf[nr++] =
+				samples->addrs[tail % DAMON_PA_NR_SAMPLES];
+		smp_store_release(&samples->tail, tail);
+	}
+	return nr;
+}
+
+static int damon_pa_cmp_addr(const void *a, const void *b)
+{
+	unsigned long l = *(const unsigned long *)a;
+	unsigned long r = *(const unsigned long *)b;
+
+	return l < r ? -1 : l > r;
+}
+
+static unsigned int damon_pa_sampled_check_accesses(struct damon_ctx *ctx)
+{
+	struct damon_target *t;
+	struct damon_region *r;
+	unsigned int max_nr_accesses = 0;
+	unsigned long nr = 0, i;
+
+	mutex_lock(&damon_pa_samples_lock);
+	if (damon_pa_samples_buf) {
+		nr = damon_pa_drain_samples();
+		sort(damon_pa_samples_buf, nr, sizeof(unsigned long),
+				damon_pa_cmp_addr, NULL);
+	}
+
+	/* Regions are sorted by address, like the samples now are */
+	damon_for_each_target(t, ctx) {
+		i = 0;
+		damon_for_each_region(r, t) {
+			while (i < nr && damon_pa_samples_buf[i] < r->ar.start)
+				i++;
+			damon_update_region_access_rate(r,
+					i < nr && damon_pa_samples_buf[i] < r->ar.end,
+					&ctx->attrs);
+			max_nr_accesses = max(r->nr_accesses, max_nr_accesses);
+		}
+	}
+	mutex_unlock(&damon_pa_samples_lock);
+
+	return max_nr_accesses;
+}
+
 static bool __damos_pa_filter_out(struct damos_filter *filter,
 		struct folio *folio)
 {
@@ -378,7 +635,24 @@ static int __init damon_pa_initcall(void)
 		.get_scheme_score = damon_pa_scheme_score,
 	};
 
-	return damon_register_ops(&ops);
+	struct damon_operations sampled_ops = {
+		.id = DAMON_OPS_PADDR_SAMPLED,
+		.init = damon_pa_sampled_init,
+		.update = NULL,
+		.prepare_access_checks = NULL,
+		.check_accesses = damon_pa_sampled_check_accesses,
+		.reset_aggregated = NULL,
+		.target_valid = NULL,
+		.cleanup = damon_pa_sampled_cleanup,
+		.apply_scheme = damon_pa_apply_scheme,
+		.get_scheme_score = damon_pa_scheme_score,
+	};
+	int err;
+
+	err = damon_register_ops(&ops);
+	if (err)
+		return err;
+	return damon_register_ops(&sampled_ops);
 };
 
 subsys_initcall(damon_pa_initcall);
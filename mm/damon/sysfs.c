@@ -627,6 +627,7 @@ static const char * const damon_sysfs_ops_strs[] = {
 	"vaddr",
 	"fvaddr",
 	"paddr",
+	"paddr_sampled",
 };
 
 struct damon_sysfs_context {
@@ -1210,7 +1211,8 @@ static int damon_sysfs_set_targets(struct damon_ctx *ctx,
 	int i = 0, err;
 
 	/* Multiple physical address space monitoring targets makes no sense */
-	if (ctx->ops.id == DAMON_OPS_PADDR && sysfs_targets->nr > 1)
+	if ((ctx->ops.id == DAMON_OPS_PADDR ||
+	     ctx->ops.id == DAMON_OPS_PADDR_SAMPLED) && sysfs_targets->nr > 1)
 		return -EINVAL;
 
 	damon_for_each_target_safe(t, next, ctx) {
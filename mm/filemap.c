@@ -46,6 +46,7 @@
 #include <linux/pipe_fs_i.h>
 #include <linux/splice.h>
 #include <linux/rcupdate_wait.h>
+#include <linux/prefetch.h>
 #include <asm/pgalloc.h>
 #include <asm/tlbflush.h>
 #include "internal.h"
@@ -228,6 +229,8 @@ void __filemap_remove_folio(struct folio *folio, void *shadow)
 	struct address_space *mapping = folio->mapping;
 
 	trace_mm_filemap_delete_from_page_cache(folio);
+	if (folio_test_readahead(folio) && !folio_test_writeback(folio))
+		trace_mm_filemap_readahead_waste(folio);
 	filemap_unaccount_folio(mapping, folio);
 	page_cache_delete(mapping, folio, shadow);
 }
@@ -449,6 +452,24 @@ int filemap_fdatawrite_range(struct address_space *mapping, loff_t start,
 }
 EXPORT_SYMBOL(filemap_fdatawrite_range);
 
+/**
+ * filemap_fdatawrite_range_kick - start writeback on a range
+ * @mapping:	target address_space
+ * @start:	index to start writeback on
+ * @end:	last (inclusive) index for writeback
+ *
+ * This is a non-integrity writeback helper, to start writing back folios
+ * for the indicated range.
+ *
+ * Return: %0 on success, negative error code otherwise.
+ */
+int filemap_fdatawrite_range_kick(struct address_space *mapping, loff_t start,
+				  loff_t end)
+{
+	return __filemap_fdatawrite_range(mapping, start, end, WB_SYNC_NONE);
+}
+EXPORT_SYMBOL_GPL(filemap_fdatawrite_range_kick);
+
 /**
  * filemap_flush - mostly a non-blocking flush
  * @mapping:	target address_space
@@ -1598,6 +1619,40 @@ int folio_wait_private_2_killable(struct folio *folio)
 }
 EXPORT_SYMBOL(folio_wait_private_2_killable);
 
+/*
+ * Drop a folio of uncached buffered I/O from the page cache.  Folios that
+ * are mapped, dirty or in use by somebody else are left alone and are
+ * then cached like any other folio.
+ */
+static void folio_end_dropbehind(struct folio *folio)
+{
+	struct address_space *mapping = folio->mapping;
+
+	VM_BUG_ON_FOLIO(!folio_test_locked(folio), folio);
+
+	if (folio_test_writeback(folio) || folio_test_dirty(folio))
+		return;
+	if (!folio_test_clear_dropbehind(folio))
+		return;
+	if (mapping)
+		mapping_evict_folio(mapping, folio);
+}
+
+static void folio_end_dropbehind_write(struct folio *folio)
+{
+	/*
+	 * Writeback mostly completes from interrupt context, where the folio
+	 * can't be removed from the page cache.  Move it to the tail of the
+	 * inactive list, so that reclaim finds it first.
+	 */
+	if (in_task() && folio_trylock(folio)) {
+		folio_end_dropbehind(folio);
+		folio_unlock(folio);
+	} else if (folio_test_clear_dropbehind(folio)) {
+		folio_rotate_reclaimable(folio);
+	}
+}
+
 /**
  * folio_end_writeback - End writeback against a folio.
  * @folio: The folio.
@@ -1632,6 +1687,8 @@ void folio_end_writeback(struct folio *folio)
 	if (__folio_end_writeback(folio))
 		folio_wake_bit(folio, PG_writeback);
 	acct_reclaim_writeback(folio);
+	if (folio_test_dropbehind(folio) && !folio_test_dirty(folio))
+		folio_end_dropbehind_write(folio);
 	folio_put(folio);
 }
 EXPORT_SYMBOL(folio_end_writeback);
@@ -1907,6 +1964,10 @@ struct folio *__filemap_get_folio(struct address_space *mapping, pgoff_t index,
 		VM_BUG_ON_FOLIO(!folio_contains(folio, index), folio);
 	}
 
+	/* A cached access keeps the folio around */
+	if (folio_test_dropbehind(folio) && !(fgp_flags & FGP_DONTCACHE))
+		folio_clear_dropbehind(folio);
+
 	if (fgp_flags & FGP_ACCESSED)
 		folio_mark_accessed(folio);
 	else if (fgp_flags & FGP_WRITE) {
@@ -1954,6 +2015,8 @@ struct folio *__filemap_get_folio(struct address_space *mapping, pgoff_t index,
 			/* Init accessed so avoid atomic mark_page_accessed later */
 			if (fgp_flags & FGP_ACCESSED)
 				__folio_set_referenced(folio);
+			if (fgp_flags & FGP_DONTCACHE)
+				__folio_set_dropbehind(folio);
 
 			err = filemap_add_folio(mapping, folio, index, gfp);
 			if (!err)
@@ -2299,6 +2362,27 @@ static void shrink_readahead_size_eio(struct file_ra_state *ra)
  * folio in the batch may have the readahead flag set or the uptodate flag
  * clear so that the caller can take the appropriate action.
  */
+/*
+ * The folios of a read batch are usually cold in the cache.  Start fetching
+ * the ones that follow in the same xarray node, so that taking references
+ * on them one by one does not stall on each of them in turn.
+ */
+static void filemap_prefetch_batch(struct xa_state *xas, pgoff_t max,
+		struct folio_batch *fbatch)
+{
+	void *entries[PAGEVEC_SIZE];
+	unsigned int i, nr;
+
+	nr = min_t(unsigned int, ARRAY_SIZE(entries),
+		   folio_batch_space(fbatch));
+	nr = xas_peek_batch(xas, max, entries, nr);
+	for (i = 0; i < nr; i++) {
+		if (xa_is_value(entries[i]))
+			break;
+		prefetchw(entries[i]);
+	}
+}
+
 static void filemap_get_read_batch(struct address_space *mapping,
 		pgoff_t index, pgoff_t max, struct folio_batch *fbatch)
 {
@@ -2306,7 +2390,10 @@ static void filemap_get_read_batch(struct address_space *mapping,
 	struct folio *folio;
 
 	rcu_read_lock();
-	for (folio = xas_load(&xas); folio; folio = xas_next(&xas)) {
+	folio = xas_load(&xas);
+	if (folio && folio_batch_space(fbatch) > 1)
+		filemap_prefetch_batch(&xas, max, fbatch);
+	for (; folio; folio = xas_next(&xas)) {
 		if (xas_retry(&xas, folio))
 			continue;
 		if (xas.xa_index > max || xa_is_value(folio))
@@ -2448,16 +2535,19 @@ static int filemap_update_page(struct kiocb *iocb,
 	return error;
 }
 
-static int filemap_create_folio(struct file *file,
+static int filemap_create_folio(struct kiocb *iocb,
 		struct address_space *mapping, pgoff_t index,
 		struct folio_batch *fbatch)
 {
+	struct file *file = iocb->ki_filp;
 	struct folio *folio;
 	int error;
 
 	folio = filemap_alloc_folio(mapping_gfp_mask(mapping), 0);
 	if (!folio)
 		return -ENOMEM;
+	if (iocb->ki_flags & IOCB_DONTCACHE)
+		__folio_set_dropbehind(folio);
 
 	/*
 	 * Protect against truncate / hole punch. Grabbing invalidate_lock
@@ -2501,6 +2591,8 @@ static int filemap_readahead(struct kiocb *iocb, struct file *file,
 
 	if (iocb->ki_flags & IOCB_NOIO)
 		return -EAGAIN;
+	if (iocb->ki_flags & IOCB_DONTCACHE)
+		ractl.dropbehind = true;
 	page_cache_async_ra(&ractl, folio, last_index - folio->index);
 	return 0;
 }
@@ -2524,16 +2616,19 @@ static int filemap_get_pages(struct kiocb *iocb, size_t count,
 
 	filemap_get_read_batch(mapping, index, last_index - 1, fbatch);
 	if (!folio_batch_count(fbatch)) {
+		DEFINE_READAHEAD(ractl, filp, ra, mapping, index);
+
 		if (iocb->ki_flags & IOCB_NOIO)
 			return -EAGAIN;
-		page_cache_sync_readahead(mapping, ra, filp, index,
-				last_index - index);
+		if (iocb->ki_flags & IOCB_DONTCACHE)
+			ractl.dropbehind = true;
+		page_cache_sync_ra(&ractl, last_index - index);
 		filemap_get_read_batch(mapping, index, last_index - 1, fbatch);
 	}
 	if (!folio_batch_count(fbatch)) {
 		if (iocb->ki_flags & (IOCB_NOWAIT | IOCB_WAITQ))
 			return -EAGAIN;
-		err = filemap_create_folio(filp, mapping,
+		err = filemap_create_folio(iocb, mapping,
 				iocb->ki_pos >> PAGE_SHIFT, fbatch);
 		if (err == AOP_TRUNCATED_PAGE)
 			goto retry;
@@ -2574,6 +2669,24 @@ static inline bool pos_same_folio(loff_t pos1, loff_t pos2, struct folio *folio)
 	return (pos1 >> shift == pos2 >> shift);
 }
 
+static void filemap_end_dropbehind_read(struct kiocb *iocb,
+		struct folio *folio)
+{
+	if (!folio_test_dropbehind(folio))
+		return;
+	if (!(iocb->ki_flags & IOCB_DONTCACHE)) {
+		folio_clear_dropbehind(folio);
+		return;
+	}
+	/* The next read continues in this folio */
+	if (iocb->ki_pos < folio_pos(folio) + folio_size(folio))
+		return;
+	if (folio_trylock(folio)) {
+		folio_end_dropbehind(folio);
+		folio_unlock(folio);
+	}
+}
+
 /**
  * filemap_read - Read data from the page cache.
  * @iocb: The iocb to read.
@@ -2685,8 +2798,12 @@ ssize_t filemap_read(struct kiocb *iocb, struct iov_iter *iter,
 			}
 		}
 put_folios:
-		for (i = 0; i < folio_batch_count(&fbatch); i++)
-			folio_put(fbatch.folios[i]);
+		for (i = 0; i < folio_batch_count(&fbatch); i++) {
+			struct folio *folio = fbatch.folios[i];
+
+			filemap_end_dropbehind_read(iocb, folio);
+			folio_put(folio);
+		}
 		folio_batch_init(&fbatch);
 	} while (iov_iter_count(iter) && iocb->ki_pos < isize && !error);
 
@@ -2825,6 +2942,14 @@ size_t splice_folio_into_pipe(struct pipe_inode_info *pipe,
 		struct pipe_buffer *buf = pipe_head_buf(pipe);
 		size_t part = min_t(size_t, PAGE_SIZE - offset, size - spliced);
 
+		/*
+		 * A lowmem folio is contiguous in the kernel mapping, so the
+		 * rest of it goes into one buffer, like the large buffers of
+		 * pipe_write().
+		 */
+		if (!folio_test_highmem(folio))
+			part = size - spliced;
+
 		*buf = (struct pipe_buffer) {
 			.ops	= &page_cache_pipe_buf_ops,
 			.page	= page,
@@ -3655,6 +3780,7 @@ vm_fault_t filemap_map_pages(struct vm_fault *vmf,
 	pte_unmap_unlock(vmf->pte, vmf->ptl);
 out:
 	rcu_read_unlock();
+	trace_mm_filemap_map_pages(mapping, start_pgoff, end_pgoff, rss);
 
 	mmap_miss_saved = READ_ONCE(file->f_ra.mmap_miss);
 	if (mmap_miss >= mmap_miss_saved)
@@ -3982,21 +4108,22 @@ ssize_t generic_perform_write(struct kiocb *iocb, struct iov_iter *i)
 	loff_t pos = iocb->ki_pos;
 	struct address_space *mapping = file->f_mapping;
 	const struct address_space_operations *a_ops = mapping->a_ops;
+	size_t chunk = mapping_max_folio_size(mapping);
 	long status = 0;
 	ssize_t written = 0;
 
 	do {
 		struct page *page;
-		unsigned long offset;	/* Offset into pagecache page */
-		unsigned long bytes;	/* Bytes to write to page */
+		struct folio *folio;
+		size_t offset;		/* Offset into folio */
+		size_t bytes;		/* Bytes to write to folio */
 		size_t copied;		/* Bytes copied from user */
 		void *fsdata = NULL;
 
-		offset = (pos & (PAGE_SIZE - 1));
-		bytes = min_t(unsigned long, PAGE_SIZE - offset,
-						iov_iter_count(i));
-
-again:
+		bytes = iov_iter_count(i);
+retry:
+		offset = pos & (chunk - 1);
+		bytes = min(chunk - offset, bytes);
 		/*
 		 * Bring in the user page that we will copy from _first_.
 		 * Otherwise there's a nasty deadlock on copying from the
@@ -4018,11 +4145,23 @@ ssize_t generic_perform_write(struct kiocb *iocb, struct iov_iter *i)
 		if (unlikely(status < 0))
 			break;
 
+		folio = page_folio(page);
+		offset = offset_in_folio(folio, pos);
+		if (bytes > folio_size(folio) - offset)
+			bytes = folio_size(folio) - offset;
+
+		/*
+		 * ->write_begin() can't be told to create an uncached folio,
+		 * so mark it here.
+		 */
+		if (iocb->ki_flags & IOCB_DONTCACHE)
+			folio_set_dropbehind(folio);
+
 		if (mapping_writably_mapped(mapping))
-			flush_dcache_page(page);
+			flush_dcache_folio(folio);
 
-		copied = copy_page_from_iter_atomic(page, offset, bytes, i);
-		flush_dcache_page(page);
+		copied = copy_folio_from_iter_atomic(folio, offset, bytes, i);
+		flush_dcache_folio(folio);
 
 		status = a_ops->write_end(file, mapping, pos, bytes, copied,
 						page, fsdata);
@@ -4040,9 +4179,11 @@ ssize_t generic_perform_write(struct kiocb *iocb, struct iov_iter *i)
 			 * halfway through, might be a race with munmap,
 			 * might be severe memory pressure.
 			 */
+			if (chunk > PAGE_SIZE)
+				chunk /= 2;
 			if (copied)
 				bytes = copied;
-			goto again;
+			goto retry;
 		}
 		pos += status;
 		written += status;
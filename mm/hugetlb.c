@@ -36,6 +36,9 @@
 #include <linux/memory.h>
 #include <linux/mm_inline.h>
 #include <linux/padata.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/workqueue.h>
 
 #include <asm/page.h>
 #include <asm/pgalloc.h>
@@ -1308,6 +1311,62 @@ static bool vma_has_reserves(struct vm_area_struct *vma, long chg)
 	return false;
 }
 
+/*
+ * Background clearing of free huge pages.  With prezero set for an hstate,
+ * a per-node kernel thread running at SCHED_IDLE clears the free pages of
+ * the node and marks them HPG_zeroed, so that a fault does not have to.
+ *
+ * The thread clears a free folio without holding hugetlb_lock, in short
+ * chunks run with interrupts off so that it cannot be held off while
+ * inside one.  Whoever takes the folio off the free lists resets
+ * ->folio under hugetlb_lock, which the thread checks before each chunk,
+ * and waits for the chunk in flight to finish.
+ */
+struct hugetlb_prezero {
+	struct task_struct *task;
+	wait_queue_head_t wait;
+	bool kick;
+	/* Protected by hugetlb_lock */
+	struct folio *folio;
+	/* Chunk of ->folio being cleared */
+	bool busy;
+};
+static struct hugetlb_prezero hugetlb_prezero_node[MAX_NUMNODES];
+static DEFINE_MUTEX(hugetlb_prezero_mutex);
+
+#define HUGETLB_PREZERO_CHUNK	8
+
+static void hugetlb_prezero_kick(struct hstate *h, int nid)
+{
+	struct hugetlb_prezero *pz = &hugetlb_prezero_node[nid];
+
+	if (!READ_ONCE(h->prezero) || !READ_ONCE(pz->task))
+		return;
+
+	WRITE_ONCE(pz->kick, true);
+	wake_up_interruptible(&pz->wait);
+}
+
+/* @folio is being taken off the free lists, stop clearing it */
+static void hugetlb_prezero_stop(struct hstate *h, struct folio *folio)
+{
+	int nid = folio_nid(folio);
+	struct hugetlb_prezero *pz = &hugetlb_prezero_node[nid];
+
+	lockdep_assert_held(&hugetlb_lock);
+
+	if (folio_test_hugetlb_zeroed(folio)) {
+		h->zeroed_huge_pages--;
+		h->zeroed_huge_pages_node[nid]--;
+	}
+
+	if (pz->folio == folio) {
+		pz->folio = NULL;
+		while (smp_load_acquire(&pz->busy))
+			cpu_relax();
+	}
+}
+
 static void enqueue_hugetlb_folio(struct hstate *h, struct folio *folio)
 {
 	int nid = folio_nid(folio);
@@ -1319,6 +1378,8 @@ static void enqueue_hugetlb_folio(struct hstate *h, struct folio *folio)
 	h->free_huge_pages++;
 	h->free_huge_pages_node[nid]++;
 	folio_set_hugetlb_freed(folio);
+	folio_clear_hugetlb_zeroed(folio);
+	hugetlb_prezero_kick(h, nid);
 }
 
 static struct folio *dequeue_hugetlb_folio_node_exact(struct hstate *h,
@@ -1326,8 +1387,11 @@ static struct folio *dequeue_hugetlb_folio_node_exact(struct hstate *h,
 {
 	struct folio *folio;
 	bool pin = !!(current->flags & PF_MEMALLOC_PIN);
+	/* Hand out the pages cleared in the background first */
+	bool zeroed = h->zeroed_huge_pages_node[nid];
 
 	lockdep_assert_held(&hugetlb_lock);
+retry:
 	list_for_each_entry(folio, &h->hugepage_freelists[nid], lru) {
 		if (pin && !folio_is_longterm_pinnable(folio))
 			continue;
@@ -1335,6 +1399,10 @@ static struct folio *dequeue_hugetlb_folio_node_exact(struct hstate *h,
 		if (folio_test_hwpoison(folio))
 			continue;
 
+		if (zeroed && !folio_test_hugetlb_zeroed(folio))
+			continue;
+
+		hugetlb_prezero_stop(h, folio);
 		list_move(&folio->lru, &h->hugepage_activelist);
 		folio_ref_unfreeze(folio, 1);
 		folio_clear_hugetlb_freed(folio);
@@ -1343,6 +1411,11 @@ static struct folio *dequeue_hugetlb_folio_node_exact(struct hstate *h,
 		return folio;
 	}
 
+	if (zeroed) {
+		zeroed = false;
+		goto retry;
+	}
+
 	return NULL;
 }
 
@@ -1642,6 +1715,8 @@ static void remove_hugetlb_folio(struct hstate *h, struct folio *folio,
 	list_del(&folio->lru);
 
 	if (folio_test_hugetlb_freed(folio)) {
+		hugetlb_prezero_stop(h, folio);
+		folio_clear_hugetlb_zeroed(folio);
 		folio_clear_hugetlb_freed(folio);
 		h->free_huge_pages--;
 		h->free_huge_pages_node[nid]--;
@@ -3721,11 +3796,84 @@ static int adjust_pool_surplus(struct hstate *h, nodemask_t *nodes_allowed,
 }
 
 #define persistent_huge_pages(h) (h->nr_huge_pages - h->surplus_huge_pages)
+/* Fresh pages allocated per round of set_max_huge_pages(), and per thread */
+#define HUGETLB_GROW_POOL_BATCH		8192UL
+#define HUGETLB_GROW_POOL_MIN_CHUNK	64UL
+
+struct hugetlb_grow_pool_arg {
+	struct hstate		*h;
+	nodemask_t		*nodes_allowed;
+	nodemask_t		*node_alloc_noretry;
+	atomic_long_t		allocated;
+	bool			failed;
+};
+
+static void hugetlb_grow_pool_chunk(unsigned long start, unsigned long end,
+				    void *arg)
+{
+	struct hugetlb_grow_pool_arg *ga = arg;
+	int next_node = numa_node_id();
+	LIST_HEAD(folio_list);
+	unsigned long i;
+
+	for (i = start; i < end && !READ_ONCE(ga->failed); i++) {
+		struct folio *folio;
+
+		folio = alloc_pool_huge_folio(ga->h, ga->nodes_allowed,
+					      ga->node_alloc_noretry,
+					      &next_node);
+		if (!folio) {
+			WRITE_ONCE(ga->failed, true);
+			break;
+		}
+
+		list_add(&folio->lru, &folio_list);
+		atomic_long_inc(&ga->allocated);
+		cond_resched();
+	}
+
+	prep_and_add_allocated_folios(ga->h, &folio_list);
+}
+
+/*
+ * Allocate up to @nr fresh huge pages into the pool, spread over several
+ * threads for non-gigantic pages, and return how many were added. Each
+ * thread starts on its own node and then interleaves over @nodes_allowed.
+ */
+static unsigned long hugetlb_grow_pool(struct hstate *h, unsigned long nr,
+				       nodemask_t *nodes_allowed,
+				       nodemask_t *node_alloc_noretry)
+{
+	struct hugetlb_grow_pool_arg ga = {
+		.h			= h,
+		.nodes_allowed		= nodes_allowed,
+		.node_alloc_noretry	= node_alloc_noretry,
+		.allocated		= ATOMIC_LONG_INIT(0),
+	};
+	struct padata_mt_job job = {
+		.thread_fn	= hugetlb_grow_pool_chunk,
+		.fn_arg		= &ga,
+		.start		= 0,
+		.size		= nr,
+		.align		= 1,
+		/* as for boot, see hugetlb_pages_alloc_boot() */
+		.max_threads	= num_node_state(N_MEMORY) * 2,
+		.min_chunk	= HUGETLB_GROW_POOL_MIN_CHUNK,
+		.numa_aware	= true,
+	};
+
+	/* concurrent contiguous range allocations only get in each other's way */
+	if (hstate_is_gigantic(h))
+		job.max_threads = 1;
+
+	padata_do_multithreaded(&job);
+	return atomic_long_read(&ga.allocated);
+}
+
 static int set_max_huge_pages(struct hstate *h, unsigned long count, int nid,
 			      nodemask_t *nodes_allowed)
 {
 	unsigned long min_count;
-	unsigned long allocated;
 	struct folio *folio;
 	LIST_HEAD(page_list);
 	NODEMASK_ALLOC(nodemask_t, node_alloc_noretry, GFP_KERNEL);
@@ -3803,45 +3951,31 @@ static int set_max_huge_pages(struct hstate *h, unsigned long count, int nid,
 			break;
 	}
 
-	allocated = 0;
-	while (count > (persistent_huge_pages(h) + allocated)) {
+	/*
+	 * Allocate in batches so that a huge count, which asks for as many
+	 * pages as possible, still stops at the first failure and signals
+	 * are noticed in between.
+	 */
+	while (count > persistent_huge_pages(h)) {
+		unsigned long nr = min(count - persistent_huge_pages(h),
+				       HUGETLB_GROW_POOL_BATCH);
+		unsigned long allocated;
+
 		/*
 		 * If this allocation races such that we no longer need the
 		 * page, free_huge_folio will handle it by freeing the page
 		 * and reducing the surplus.
 		 */
 		spin_unlock_irq(&hugetlb_lock);
-
-		/* yield cpu to avoid soft lockup */
-		cond_resched();
-
-		folio = alloc_pool_huge_folio(h, nodes_allowed,
-						node_alloc_noretry,
-						&h->next_nid_to_alloc);
-		if (!folio) {
-			prep_and_add_allocated_folios(h, &page_list);
-			spin_lock_irq(&hugetlb_lock);
+		allocated = hugetlb_grow_pool(h, nr, nodes_allowed,
+					      node_alloc_noretry);
+		spin_lock_irq(&hugetlb_lock);
+		if (allocated < nr)
 			goto out;
-		}
-
-		list_add(&folio->lru, &page_list);
-		allocated++;
 
 		/* Bail for signals. Probably ctrl-c from user */
-		if (signal_pending(current)) {
-			prep_and_add_allocated_folios(h, &page_list);
-			spin_lock_irq(&hugetlb_lock);
+		if (signal_pending(current))
 			goto out;
-		}
-
-		spin_lock_irq(&hugetlb_lock);
-	}
-
-	/* Add allocated pages to the pool */
-	if (!list_empty(&page_list)) {
-		spin_unlock_irq(&hugetlb_lock);
-		prep_and_add_allocated_folios(h, &page_list);
-		spin_lock_irq(&hugetlb_lock);
 	}
 
 	/*
@@ -3994,6 +4128,243 @@ static int demote_pool_huge_page(struct hstate *h, nodemask_t *nodes_allowed)
 	return -EBUSY;
 }
 
+/*
+ * Clear one free folio of node @nid in the background.  Returns false if
+ * there was nothing left to clear.
+ */
+static bool hugetlb_prezero_one(int nid)
+{
+	struct hugetlb_prezero *pz = &hugetlb_prezero_node[nid];
+	struct folio *folio = NULL, *iter;
+	unsigned long i, j, nr;
+	struct hstate *h;
+
+	spin_lock_irq(&hugetlb_lock);
+	for_each_hstate(h) {
+		if (!READ_ONCE(h->prezero) ||
+		    h->zeroed_huge_pages_node[nid] == h->free_huge_pages_node[nid])
+			continue;
+
+		/* The oldest free pages are the least likely to be reused soon */
+		list_for_each_entry_reverse(iter, &h->hugepage_freelists[nid], lru) {
+			if (folio_test_hugetlb_zeroed(iter) ||
+			    folio_test_hwpoison(iter))
+				continue;
+			folio = iter;
+			break;
+		}
+		if (folio)
+			break;
+	}
+	pz->folio = folio;
+	spin_unlock_irq(&hugetlb_lock);
+
+	if (!folio)
+		return false;
+
+	nr = pages_per_huge_page(h);
+	for (i = 0; i < nr; i += HUGETLB_PREZERO_CHUNK) {
+		spin_lock_irq(&hugetlb_lock);
+		if (pz->folio != folio) {
+			/* Allocated or dissolved under us */
+			spin_unlock_irq(&hugetlb_lock);
+			return true;
+		}
+		WRITE_ONCE(pz->busy, true);
+		spin_unlock(&hugetlb_lock);
+
+		for (j = i; j < min(i + HUGETLB_PREZERO_CHUNK, nr); j++) {
+			clear_highpage(folio_page(folio, j));
+			flush_dcache_page(folio_page(folio, j));
+		}
+
+		smp_store_release(&pz->busy, false);
+		local_irq_enable();
+
+		if (kthread_should_stop() || freezing(current))
+			break;
+		cond_resched();
+	}
+
+	spin_lock_irq(&hugetlb_lock);
+	if (pz->folio == folio) {
+		if (i >= nr) {
+			folio_set_hugetlb_zeroed(folio);
+			h->zeroed_huge_pages++;
+			h->zeroed_huge_pages_node[nid]++;
+		}
+		pz->folio = NULL;
+	}
+	spin_unlock_irq(&hugetlb_lock);
+
+	return true;
+}
+
+static int hugetlb_prezero_thread(void *data)
+{
+	int nid = (long)data;
+	struct hugetlb_prezero *pz = &hugetlb_prezero_node[nid];
+	const struct cpumask *cpumask = cpumask_of_node(nid);
+	struct sched_param param = { .sched_priority = 0 };
+
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(current, cpumask);
+	sched_setscheduler_nocheck(current, SCHED_IDLE, &param);
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		if (hugetlb_prezero_one(nid)) {
+			cond_resched();
+			continue;
+		}
+
+		wait_event_freezable(pz->wait, READ_ONCE(pz->kick) ||
+					       kthread_should_stop());
+		WRITE_ONCE(pz->kick, false);
+	}
+
+	return 0;
+}
+
+static int hugetlb_prezero_start(void)
+{
+	struct task_struct *task;
+	int nid, ret = 0;
+
+	lockdep_assert_held(&hugetlb_prezero_mutex);
+
+	for_each_node_state(nid, N_MEMORY) {
+		struct hugetlb_prezero *pz = &hugetlb_prezero_node[nid];
+
+		if (pz->task)
+			continue;
+
+		init_waitqueue_head(&pz->wait);
+		task = kthread_run(hugetlb_prezero_thread, (void *)(long)nid,
+				   "khugetlbzerod%d", nid);
+		if (IS_ERR(task)) {
+			pr_err("Failed to start khugetlbzerod on node %d\n", nid);
+			ret = PTR_ERR(task);
+			continue;
+		}
+		WRITE_ONCE(pz->task, task);
+	}
+
+	return ret;
+}
+
+/*
+ * Clearing a gigantic folio at fault time can be split across up to
+ * clear_threads CPUs of the folio's node, in chunks of at least
+ * HUGETLB_CLEAR_CHUNK_MIN pages.
+ */
+#define HUGETLB_CLEAR_CHUNK_MIN	(SZ_8M >> PAGE_SHIFT)
+
+struct hugetlb_clear_job;
+
+struct hugetlb_clear_chunk {
+	struct work_struct work;
+	struct hugetlb_clear_job *job;
+	unsigned long start;
+	unsigned long nr;
+};
+
+struct hugetlb_clear_job {
+	struct folio *folio;
+	unsigned long addr;
+	atomic_t pending;
+	struct completion done;
+	unsigned int nr_chunks;
+	struct hugetlb_clear_chunk chunks[] __counted_by(nr_chunks);
+};
+
+static void hugetlb_clear_chunk_fn(struct work_struct *work)
+{
+	struct hugetlb_clear_chunk *chunk =
+		container_of(work, struct hugetlb_clear_chunk, work);
+	struct hugetlb_clear_job *job = chunk->job;
+	unsigned long i;
+
+	for (i = chunk->start; i < chunk->start + chunk->nr; i++) {
+		cond_resched();
+		clear_user_highpage(folio_page(job->folio, i),
+				    job->addr + i * PAGE_SIZE);
+	}
+
+	if (atomic_dec_and_test(&job->pending))
+		complete(&job->done);
+}
+
+static bool hugetlb_clear_folio_mt(struct hstate *h, struct folio *folio,
+				   unsigned long addr, unsigned int nr_threads)
+{
+	unsigned long nr_pages = pages_per_huge_page(h), per_chunk;
+	int nid = folio_nid(folio);
+	unsigned int nr_cpus = cpumask_weight(cpumask_of_node(nid));
+	struct hugetlb_clear_job *job;
+	unsigned int i;
+
+	if (nr_cpus)
+		nr_threads = min(nr_threads, nr_cpus);
+	nr_threads = min_t(unsigned long, nr_threads,
+			   nr_pages / HUGETLB_CLEAR_CHUNK_MIN);
+	if (nr_threads < 2)
+		return false;
+
+	job = kmalloc(struct_size(job, chunks, nr_threads), GFP_KERNEL);
+	if (!job)
+		return false;
+
+	job->nr_chunks = nr_threads;
+	job->folio = folio;
+	job->addr = ALIGN_DOWN(addr, huge_page_size(h));
+	atomic_set(&job->pending, nr_threads);
+	init_completion(&job->done);
+
+	per_chunk = DIV_ROUND_UP(nr_pages, nr_threads);
+	for (i = 0; i < nr_threads; i++) {
+		struct hugetlb_clear_chunk *chunk = &job->chunks[i];
+
+		chunk->job = job;
+		chunk->start = i * per_chunk;
+		chunk->nr = min(per_chunk, nr_pages - chunk->start);
+		INIT_WORK(&chunk->work, hugetlb_clear_chunk_fn);
+		if (i)
+			queue_work_node(nid, system_unbound_wq, &chunk->work);
+	}
+
+	/* Clear the first chunk ourselves */
+	hugetlb_clear_chunk_fn(&job->chunks[0].work);
+	wait_for_completion(&job->done);
+	kfree(job);
+
+	return true;
+}
+
+/*
+ * hugetlb_clear_folio - clear a newly allocated hugetlb folio
+ * @h: hstate of the folio
+ * @folio: the folio
+ * @addr: user address the folio is being faulted in at
+ *
+ * The folio is left alone if it was already cleared in the background.
+ */
+void hugetlb_clear_folio(struct hstate *h, struct folio *folio,
+			 unsigned long addr)
+{
+	unsigned int nr_threads = READ_ONCE(h->clear_threads);
+
+	if (folio_test_hugetlb_zeroed(folio)) {
+		folio_clear_hugetlb_zeroed(folio);
+		return;
+	}
+
+	if (nr_threads > 1 && hugetlb_clear_folio_mt(h, folio, addr, nr_threads))
+		return;
+
+	clear_huge_page(&folio->page, addr, pages_per_huge_page(h));
+}
+
 #define HSTATE_ATTR_RO(_name) \
 	static struct kobj_attribute _name##_attr = __ATTR_RO(_name)
 
@@ -4194,6 +4565,84 @@ static ssize_t surplus_hugepages_show(struct kobject *kobj,
 }
 HSTATE_ATTR_RO(surplus_hugepages);
 
+static ssize_t free_zeroed_hugepages_show(struct kobject *kobj,
+					struct kobj_attribute *attr, char *buf)
+{
+	struct hstate *h;
+	unsigned long zeroed_huge_pages;
+	int nid;
+
+	h = kobj_to_hstate(kobj, &nid);
+	if (nid == NUMA_NO_NODE)
+		zeroed_huge_pages = h->zeroed_huge_pages;
+	else
+		zeroed_huge_pages = h->zeroed_huge_pages_node[nid];
+
+	return sysfs_emit(buf, "%lu\n", zeroed_huge_pages);
+}
+HSTATE_ATTR_RO(free_zeroed_hugepages);
+
+static ssize_t prezero_show(struct kobject *kobj,
+					struct kobj_attribute *attr, char *buf)
+{
+	struct hstate *h = kobj_to_hstate(kobj, NULL);
+
+	return sysfs_emit(buf, "%d\n", READ_ONCE(h->prezero));
+}
+
+static ssize_t prezero_store(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t count)
+{
+	struct hstate *h = kobj_to_hstate(kobj, NULL);
+	bool prezero;
+	int err, nid;
+
+	err = kstrtobool(buf, &prezero);
+	if (err)
+		return err;
+
+	mutex_lock(&hugetlb_prezero_mutex);
+	if (prezero)
+		err = hugetlb_prezero_start();
+	WRITE_ONCE(h->prezero, prezero);
+	mutex_unlock(&hugetlb_prezero_mutex);
+
+	if (prezero) {
+		for_each_node_state(nid, N_MEMORY)
+			hugetlb_prezero_kick(h, nid);
+	}
+
+	return err ? err : count;
+}
+HSTATE_ATTR(prezero);
+
+static ssize_t clear_threads_show(struct kobject *kobj,
+					struct kobj_attribute *attr, char *buf)
+{
+	struct hstate *h = kobj_to_hstate(kobj, NULL);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(h->clear_threads));
+}
+
+static ssize_t clear_threads_store(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t count)
+{
+	struct hstate *h = kobj_to_hstate(kobj, NULL);
+	unsigned int input;
+	int err;
+
+	err = kstrtouint(buf, 10, &input);
+	if (err)
+		return err;
+	if (!input || input > num_possible_cpus())
+		return -EINVAL;
+
+	WRITE_ONCE(h->clear_threads, input);
+
+	return count;
+}
+HSTATE_ATTR(clear_threads);
+
 static ssize_t demote_store(struct kobject *kobj,
 	       struct kobj_attribute *attr, const char *buf, size_t len)
 {
@@ -4295,6 +4744,9 @@ static struct attribute *hstate_attrs[] = {
 	&free_hugepages_attr.attr,
 	&resv_hugepages_attr.attr,
 	&surplus_hugepages_attr.attr,
+	&free_zeroed_hugepages_attr.attr,
+	&prezero_attr.attr,
+	&clear_threads_attr.attr,
 #ifdef CONFIG_NUMA
 	&nr_hugepages_mempolicy_attr.attr,
 #endif
@@ -4371,6 +4823,7 @@ static struct attribute *per_node_hstate_attrs[] = {
 	&nr_hugepages_attr.attr,
 	&free_hugepages_attr.attr,
 	&surplus_hugepages_attr.attr,
+	&free_zeroed_hugepages_attr.attr,
 	NULL,
 };
 
@@ -4619,6 +5072,7 @@ void __init hugetlb_add_hstate(unsigned int order)
 	h = &hstates[hugetlb_max_hstate++];
 	mutex_init(&h->resize_lock);
 	h->order = order;
+	h->clear_threads = 1;
 	h->mask = ~(huge_page_size(h) - 1);
 	for (i = 0; i < MAX_NUMNODES; ++i)
 		INIT_LIST_HEAD(&h->hugepage_freelists[i]);
@@ -6262,8 +6716,7 @@ static vm_fault_t hugetlb_no_page(struct address_space *mapping,
 				ret = 0;
 			goto out;
 		}
-		clear_huge_page(&folio->page, vmf->real_address,
-				pages_per_huge_page(h));
+		hugetlb_clear_folio(h, folio, vmf->real_address);
 		__folio_mark_uptodate(folio);
 		new_folio = true;
 
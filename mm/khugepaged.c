@@ -70,6 +70,7 @@ static DEFINE_MUTEX(khugepaged_mutex);
 
 /* default scan 8*512 pte (or vmas) every 30 second */
 static unsigned int khugepaged_pages_to_scan __read_mostly;
+static unsigned int khugepaged_prio_pages_to_scan __read_mostly;
 static unsigned int khugepaged_pages_collapsed;
 static unsigned int khugepaged_full_scans;
 static unsigned int khugepaged_scan_sleep_millisecs __read_mostly = 10000;
@@ -110,6 +111,8 @@ struct collapse_control {
  */
 struct khugepaged_mm_slot {
 	struct mm_slot slot;
+	/* queued on khugepaged_prio_scan rather than khugepaged_scan */
+	bool prio;
 };
 
 /**
@@ -118,7 +121,9 @@ struct khugepaged_mm_slot {
  * @mm_slot: the current mm_slot we are scanning
  * @address: the next address inside that to be scanned
  *
- * There is only the one khugepaged_scan instance of this cursor structure.
+ * There is one instance of this cursor structure per queue: khugepaged_scan
+ * for ordinary mms and khugepaged_prio_scan for mms that asked to be
+ * collapsed first through PR_SET_THP_COLLAPSE_PRIO.
  */
 struct khugepaged_scan {
 	struct list_head mm_head;
@@ -130,6 +135,47 @@ static struct khugepaged_scan khugepaged_scan = {
 	.mm_head = LIST_HEAD_INIT(khugepaged_scan.mm_head),
 };
 
+static struct khugepaged_scan khugepaged_prio_scan = {
+	.mm_head = LIST_HEAD_INIT(khugepaged_prio_scan.mm_head),
+};
+
+static inline struct khugepaged_scan *
+khugepaged_scan_of(struct khugepaged_mm_slot *mm_slot)
+{
+	return mm_slot->prio ? &khugepaged_prio_scan : &khugepaged_scan;
+}
+
+static inline bool khugepaged_has_mm(void)
+{
+	return !list_empty(&khugepaged_scan.mm_head) ||
+	       !list_empty(&khugepaged_prio_scan.mm_head);
+}
+
+static inline bool khugepaged_is_cursor(struct khugepaged_mm_slot *mm_slot)
+{
+	return khugepaged_scan.mm_slot == mm_slot ||
+	       khugepaged_prio_scan.mm_slot == mm_slot;
+}
+
+/*
+ * Move @mm_slot to the queue matching its mm's collapse priority. The
+ * slot under a scan cursor is left alone, it is requeued once the cursor
+ * moves past it.
+ */
+static void khugepaged_requeue_mm_slot(struct khugepaged_mm_slot *mm_slot)
+{
+	bool prio = READ_ONCE(mm_slot->slot.mm->khugepaged_prio);
+
+	lockdep_assert_held(&khugepaged_mm_lock);
+
+	if (mm_slot->prio == prio || khugepaged_is_cursor(mm_slot))
+		return;
+
+	mm_slot->prio = prio;
+	list_move_tail(&mm_slot->slot.mm_node,
+		       &khugepaged_scan_of(mm_slot)->mm_head);
+}
+
 #ifdef CONFIG_SYSFS
 static ssize_t scan_sleep_millisecs_show(struct kobject *kobj,
 					 struct kobj_attribute *attr,
@@ -209,6 +255,30 @@ static ssize_t pages_to_scan_store(struct kobject *kobj,
 static struct kobj_attribute pages_to_scan_attr =
 	__ATTR_RW(pages_to_scan);
 
+static ssize_t prio_pages_to_scan_show(struct kobject *kobj,
+				       struct kobj_attribute *attr,
+				       char *buf)
+{
+	return sysfs_emit(buf, "%u\n", khugepaged_prio_pages_to_scan);
+}
+static ssize_t prio_pages_to_scan_store(struct kobject *kobj,
+					struct kobj_attribute *attr,
+					const char *buf, size_t count)
+{
+	unsigned int pages;
+	int err;
+
+	err = kstrtouint(buf, 10, &pages);
+	if (err || !pages)
+		return -EINVAL;
+
+	khugepaged_prio_pages_to_scan = pages;
+
+	return count;
+}
+static struct kobj_attribute prio_pages_to_scan_attr =
+	__ATTR_RW(prio_pages_to_scan);
+
 static ssize_t pages_collapsed_show(struct kobject *kobj,
 				    struct kobj_attribute *attr,
 				    char *buf)
@@ -333,6 +403,7 @@ static struct attribute *khugepaged_attr[] = {
 	&khugepaged_max_ptes_swap_attr.attr,
 	&khugepaged_max_ptes_shared_attr.attr,
 	&pages_to_scan_attr.attr,
+	&prio_pages_to_scan_attr.attr,
 	&pages_collapsed_attr.attr,
 	&full_scans_attr.attr,
 	&scan_sleep_millisecs_attr.attr,
@@ -393,6 +464,7 @@ int __init khugepaged_init(void)
 		return -ENOMEM;
 
 	khugepaged_pages_to_scan = HPAGE_PMD_NR * 8;
+	khugepaged_prio_pages_to_scan = HPAGE_PMD_NR * 8;
 	khugepaged_max_ptes_none = HPAGE_PMD_NR - 1;
 	khugepaged_max_ptes_swap = HPAGE_PMD_NR / 8;
 	khugepaged_max_ptes_shared = HPAGE_PMD_NR / 2;
@@ -433,14 +505,16 @@ void __khugepaged_enter(struct mm_struct *mm)
 
 	slot = &mm_slot->slot;
 
+	mm_slot->prio = READ_ONCE(mm->khugepaged_prio);
+
 	spin_lock(&khugepaged_mm_lock);
 	mm_slot_insert(mm_slots_hash, mm, slot);
 	/*
 	 * Insert just behind the scanning cursor, to let the area settle
 	 * down a little.
 	 */
-	wakeup = list_empty(&khugepaged_scan.mm_head);
-	list_add_tail(&slot->mm_node, &khugepaged_scan.mm_head);
+	wakeup = !khugepaged_has_mm();
+	list_add_tail(&slot->mm_node, &khugepaged_scan_of(mm_slot)->mm_head);
 	spin_unlock(&khugepaged_mm_lock);
 
 	mmgrab(mm);
@@ -468,7 +542,7 @@ void __khugepaged_exit(struct mm_struct *mm)
 	spin_lock(&khugepaged_mm_lock);
 	slot = mm_slot_lookup(mm_slots_hash, mm);
 	mm_slot = mm_slot_entry(slot, struct khugepaged_mm_slot, slot);
-	if (mm_slot && khugepaged_scan.mm_slot != mm_slot) {
+	if (mm_slot && !khugepaged_is_cursor(mm_slot)) {
 		hash_del(&slot->hash);
 		list_del(&slot->mm_node);
 		free = 1;
@@ -2312,7 +2386,8 @@ static int hpage_collapse_scan_file(struct mm_struct *mm, unsigned long addr,
 }
 #endif
 
-static unsigned int khugepaged_scan_mm_slot(unsigned int pages, int *result,
+static unsigned int khugepaged_scan_mm_slot(struct khugepaged_scan *scan,
+					    unsigned int pages, int *result,
 					    struct collapse_control *cc)
 	__releases(&khugepaged_mm_lock)
 	__acquires(&khugepaged_mm_lock)
@@ -2328,15 +2403,15 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages, int *result,
 	lockdep_assert_held(&khugepaged_mm_lock);
 	*result = SCAN_FAIL;
 
-	if (khugepaged_scan.mm_slot) {
-		mm_slot = khugepaged_scan.mm_slot;
+	if (scan->mm_slot) {
+		mm_slot = scan->mm_slot;
 		slot = &mm_slot->slot;
 	} else {
-		slot = list_entry(khugepaged_scan.mm_head.next,
+		slot = list_entry(scan->mm_head.next,
 				     struct mm_slot, mm_node);
 		mm_slot = mm_slot_entry(slot, struct khugepaged_mm_slot, slot);
-		khugepaged_scan.address = 0;
-		khugepaged_scan.mm_slot = mm_slot;
+		scan->address = 0;
+		scan->mm_slot = mm_slot;
 	}
 	spin_unlock(&khugepaged_mm_lock);
 
@@ -2353,7 +2428,7 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages, int *result,
 	if (unlikely(hpage_collapse_test_exit_or_disable(mm)))
 		goto breakouterloop;
 
-	vma_iter_init(&vmi, mm, khugepaged_scan.address);
+	vma_iter_init(&vmi, mm, scan->address);
 	for_each_vma(vmi, vma) {
 		unsigned long hstart, hend;
 
@@ -2370,52 +2445,55 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages, int *result,
 		}
 		hstart = round_up(vma->vm_start, HPAGE_PMD_SIZE);
 		hend = round_down(vma->vm_end, HPAGE_PMD_SIZE);
-		if (khugepaged_scan.address > hend)
+		if (scan->address > hend)
 			goto skip;
-		if (khugepaged_scan.address < hstart)
-			khugepaged_scan.address = hstart;
-		VM_BUG_ON(khugepaged_scan.address & ~HPAGE_PMD_MASK);
+		if (scan->address < hstart)
+			scan->address = hstart;
+		VM_BUG_ON(scan->address & ~HPAGE_PMD_MASK);
 
-		while (khugepaged_scan.address < hend) {
+		while (scan->address < hend) {
 			bool mmap_locked = true;
 
 			cond_resched();
 			if (unlikely(hpage_collapse_test_exit_or_disable(mm)))
 				goto breakouterloop;
 
-			VM_BUG_ON(khugepaged_scan.address < hstart ||
-				  khugepaged_scan.address + HPAGE_PMD_SIZE >
+			VM_BUG_ON(scan->address < hstart ||
+				  scan->address + HPAGE_PMD_SIZE >
 				  hend);
 			if (IS_ENABLED(CONFIG_SHMEM) && vma->vm_file) {
 				struct file *file = get_file(vma->vm_file);
 				pgoff_t pgoff = linear_page_index(vma,
-						khugepaged_scan.address);
+						scan->address);
 
 				mmap_read_unlock(mm);
 				mmap_locked = false;
 				*result = hpage_collapse_scan_file(mm,
-					khugepaged_scan.address, file, pgoff, cc);
+					scan->address, file, pgoff, cc);
 				fput(file);
 				if (*result == SCAN_PTE_MAPPED_HUGEPAGE) {
 					mmap_read_lock(mm);
 					if (hpage_collapse_test_exit_or_disable(mm))
 						goto breakouterloop;
 					*result = collapse_pte_mapped_thp(mm,
-						khugepaged_scan.address, false);
+						scan->address, false);
 					if (*result == SCAN_PMD_MAPPED)
 						*result = SCAN_SUCCEED;
 					mmap_read_unlock(mm);
 				}
 			} else {
 				*result = hpage_collapse_scan_pmd(mm, vma,
-					khugepaged_scan.address, &mmap_locked, cc);
+					scan->address, &mmap_locked, cc);
 			}
 
-			if (*result == SCAN_SUCCEED)
+			mm->khugepaged_scanned++;
+			if (*result == SCAN_SUCCEED) {
 				++khugepaged_pages_collapsed;
+				mm->khugepaged_collapsed++;
+			}
 
 			/* move to next address */
-			khugepaged_scan.address += HPAGE_PMD_SIZE;
+			scan->address += HPAGE_PMD_SIZE;
 			progress += HPAGE_PMD_NR;
 			if (!mmap_locked)
 				/*
@@ -2435,7 +2513,7 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages, int *result,
 breakouterloop_mmap_lock:
 
 	spin_lock(&khugepaged_mm_lock);
-	VM_BUG_ON(khugepaged_scan.mm_slot != mm_slot);
+	VM_BUG_ON(scan->mm_slot != mm_slot);
 	/*
 	 * Release the current mm_slot if this mm is about to die, or
 	 * if we scanned all vmas of this mm.
@@ -2446,17 +2524,19 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages, int *result,
 		 * khugepaged runs here, khugepaged_exit will find
 		 * mm_slot not pointing to the exiting mm.
 		 */
-		if (slot->mm_node.next != &khugepaged_scan.mm_head) {
+		if (slot->mm_node.next != &scan->mm_head) {
 			slot = list_entry(slot->mm_node.next,
 					  struct mm_slot, mm_node);
-			khugepaged_scan.mm_slot =
+			scan->mm_slot =
 				mm_slot_entry(slot, struct khugepaged_mm_slot, slot);
-			khugepaged_scan.address = 0;
+			scan->address = 0;
 		} else {
-			khugepaged_scan.mm_slot = NULL;
-			khugepaged_full_scans++;
+			scan->mm_slot = NULL;
+			if (scan == &khugepaged_scan)
+				khugepaged_full_scans++;
 		}
 
+		khugepaged_requeue_mm_slot(mm_slot);
 		collect_mm_slot(mm_slot);
 	}
 
@@ -2465,58 +2545,78 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages, int *result,
 
 static int khugepaged_has_work(void)
 {
-	return !list_empty(&khugepaged_scan.mm_head) &&
-		hugepage_flags_enabled();
+	return khugepaged_has_mm() && hugepage_flags_enabled();
 }
 
 static int khugepaged_wait_event(void)
 {
-	return !list_empty(&khugepaged_scan.mm_head) ||
-		kthread_should_stop();
+	return khugepaged_has_mm() || kthread_should_stop();
 }
 
-static void khugepaged_do_scan(struct collapse_control *cc)
+/*
+ * Scan up to @pages of the mms queued on @scan. Returns false if khugepaged
+ * should give up on this round altogether.
+ */
+static bool khugepaged_scan_queue(struct khugepaged_scan *scan,
+				  unsigned int pages, bool *wait,
+				  struct collapse_control *cc)
 {
 	unsigned int progress = 0, pass_through_head = 0;
-	unsigned int pages = READ_ONCE(khugepaged_pages_to_scan);
-	bool wait = true;
 	int result = SCAN_SUCCEED;
 
-	lru_add_drain_all();
-
 	while (true) {
 		cond_resched();
 
 		if (unlikely(kthread_should_stop()))
-			break;
+			return false;
 
 		spin_lock(&khugepaged_mm_lock);
-		if (!khugepaged_scan.mm_slot)
+		if (!scan->mm_slot)
 			pass_through_head++;
-		if (khugepaged_has_work() &&
+		if (!list_empty(&scan->mm_head) && hugepage_flags_enabled() &&
 		    pass_through_head < 2)
-			progress += khugepaged_scan_mm_slot(pages - progress,
+			progress += khugepaged_scan_mm_slot(scan, pages - progress,
 							    &result, cc);
 		else
 			progress = pages;
 		spin_unlock(&khugepaged_mm_lock);
 
 		if (progress >= pages)
-			break;
+			return true;
 
 		if (result == SCAN_ALLOC_HUGE_PAGE_FAIL) {
 			/*
 			 * If fail to allocate the first time, try to sleep for
 			 * a while.  When hit again, cancel the scan.
 			 */
-			if (!wait)
-				break;
-			wait = false;
+			if (!*wait)
+				return false;
+			*wait = false;
 			khugepaged_alloc_sleep();
 		}
 	}
 }
 
+static void khugepaged_do_scan(struct collapse_control *cc)
+{
+	bool wait = true;
+
+	lru_add_drain_all();
+
+	/*
+	 * The priority queue is scanned first and with a budget of its own,
+	 * so latency sensitive mms are not stuck behind every other mm that
+	 * ever had a THP eligible vma.
+	 */
+	if (!khugepaged_scan_queue(&khugepaged_prio_scan,
+				   READ_ONCE(khugepaged_prio_pages_to_scan),
+				   &wait, cc))
+		return;
+
+	khugepaged_scan_queue(&khugepaged_scan,
+			      READ_ONCE(khugepaged_pages_to_scan), &wait, cc);
+}
+
 static bool khugepaged_should_wakeup(void)
 {
 	return kthread_should_stop() ||
@@ -2558,6 +2658,10 @@ static int khugepaged(void *none)
 	spin_lock(&khugepaged_mm_lock);
 	mm_slot = khugepaged_scan.mm_slot;
 	khugepaged_scan.mm_slot = NULL;
+	if (mm_slot)
+		collect_mm_slot(mm_slot);
+	mm_slot = khugepaged_prio_scan.mm_slot;
+	khugepaged_prio_scan.mm_slot = NULL;
 	if (mm_slot)
 		collect_mm_slot(mm_slot);
 	spin_unlock(&khugepaged_mm_lock);
@@ -2631,7 +2735,7 @@ int start_stop_khugepaged(void)
 			goto fail;
 		}
 
-		if (!list_empty(&khugepaged_scan.mm_head))
+		if (khugepaged_has_mm())
 			wake_up_interruptible(&khugepaged_wait);
 	} else if (khugepaged_thread) {
 		kthread_stop(khugepaged_thread);
@@ -2656,6 +2760,36 @@ bool current_is_khugepaged(void)
 	return kthread_func(current) == khugepaged;
 }
 
+/**
+ * khugepaged_set_collapse_prio - move an mm to khugepaged's priority queue
+ * @mm: mm to (de)prioritise
+ * @prio: non-zero to scan @mm on the priority queue
+ *
+ * Backs PR_SET_THP_COLLAPSE_PRIO. An mm khugepaged already knows about is
+ * requeued right away, unless it is being scanned at the moment.
+ *
+ * Return: 0 on success, or -EINVAL for an out of range @prio.
+ */
+int khugepaged_set_collapse_prio(struct mm_struct *mm, unsigned long prio)
+{
+	struct khugepaged_mm_slot *mm_slot;
+	struct mm_slot *slot;
+
+	if (prio > 1)
+		return -EINVAL;
+
+	WRITE_ONCE(mm->khugepaged_prio, prio);
+
+	spin_lock(&khugepaged_mm_lock);
+	slot = mm_slot_lookup(mm_slots_hash, mm);
+	mm_slot = mm_slot_entry(slot, struct khugepaged_mm_slot, slot);
+	if (mm_slot)
+		khugepaged_requeue_mm_slot(mm_slot);
+	spin_unlock(&khugepaged_mm_lock);
+
+	return 0;
+}
+
 static int madvise_collapse_errno(enum scan_result r)
 {
 	/*
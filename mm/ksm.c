@@ -224,6 +224,7 @@ struct ksm_rmap_item {
 #define SEQNR_MASK	0x0ff	/* low bits of unstable tree seqnr */
 #define UNSTABLE_FLAG	0x100	/* is a node of the unstable tree */
 #define STABLE_FLAG	0x200	/* is listed from the stable tree */
+#define CHECKSUM_FLAG	0x400	/* oldchecksum is from a previous scan */
 
 /* The stable and unstable tree heads */
 static struct rb_root one_stable_tree[1] = { RB_ROOT };
@@ -301,6 +302,14 @@ atomic_long_t ksm_zero_pages = ATOMIC_LONG_INIT(0);
 /* The number of pages that have been skipped due to "smart scanning" */
 static unsigned long ksm_pages_skipped;
 
+/* The number of changed pages "smart scanning" didn't search the trees for */
+static unsigned long ksm_pages_volatile_skipped;
+
+/* Pages scanned per second during the last full scan */
+static unsigned long ksm_scan_rate;
+static ktime_t ksm_scan_start;
+static unsigned long ksm_scan_start_pages;
+
 /* Don't scan more than max pages per batch. */
 static unsigned long ksm_advisor_max_pages_to_scan = 30000;
 
@@ -1038,7 +1047,7 @@ static void remove_rmap_item_from_tree(struct ksm_rmap_item *rmap_item)
 			rb_erase(&rmap_item->node,
 				 root_unstable_tree + NUMA(rmap_item->nid));
 		ksm_pages_unshared--;
-		rmap_item->address &= PAGE_MASK;
+		rmap_item->address &= PAGE_MASK | CHECKSUM_FLAG;
 	}
 out:
 	cond_resched();		/* we're called from many long loops */
@@ -2312,6 +2321,7 @@ static void cmp_and_merge_page(struct page *page, struct ksm_rmap_item *rmap_ite
 	struct ksm_stable_node *stable_node;
 	struct page *kpage;
 	unsigned int checksum;
+	bool have_checksum = false;
 	int err;
 	bool max_page_sharing_bypass = false;
 
@@ -2333,6 +2343,22 @@ static void cmp_and_merge_page(struct page *page, struct ksm_rmap_item *rmap_ite
 		 */
 		if (!is_page_sharing_candidate(stable_node))
 			max_page_sharing_bypass = true;
+	} else if (ksm_smart_scan) {
+		/*
+		 * Hashing the page is much cheaper than comparing it with the
+		 * pages of the stable tree.  A page that changed since the last
+		 * scan won't go into the unstable tree below, and is likely to
+		 * be written to again if merged: don't search for it at all.
+		 */
+		checksum = calc_checksum(page);
+		have_checksum = true;
+		if ((rmap_item->address & CHECKSUM_FLAG) &&
+		    rmap_item->oldchecksum != checksum) {
+			remove_rmap_item_from_tree(rmap_item);
+			rmap_item->oldchecksum = checksum;
+			ksm_pages_volatile_skipped++;
+			return;
+		}
 	}
 
 	/* We first start with searching the page inside the stable tree */
@@ -2369,7 +2395,9 @@ static void cmp_and_merge_page(struct page *page, struct ksm_rmap_item *rmap_ite
 	 * don't want to insert it in the unstable tree, and we don't want
 	 * to waste our time searching for something identical to it there.
 	 */
-	checksum = calc_checksum(page);
+	if (!have_checksum)
+		checksum = calc_checksum(page);
+	rmap_item->address |= CHECKSUM_FLAG;
 	if (rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
 		return;
@@ -2581,6 +2609,8 @@ static struct ksm_rmap_item *scan_get_next_rmap_item(struct page **page)
 	mm_slot = ksm_scan.mm_slot;
 	if (mm_slot == &ksm_mm_head) {
 		advisor_start_scan();
+		ksm_scan_start = ktime_get();
+		ksm_scan_start_pages = ksm_pages_scanned;
 		trace_ksm_start_scan(ksm_scan.seqnr, ksm_rmap_items);
 
 		/*
@@ -2739,6 +2769,9 @@ static struct ksm_rmap_item *scan_get_next_rmap_item(struct page **page)
 		goto next_mm;
 
 	advisor_stop_scan();
+	ksm_scan_rate = div64_u64((u64)(ksm_pages_scanned - ksm_scan_start_pages) *
+				  MSEC_PER_SEC,
+				  max_t(s64, ktime_ms_delta(ktime_get(), ksm_scan_start), 1));
 
 	trace_ksm_stop_scan(ksm_scan.seqnr, ksm_rmap_items);
 	ksm_scan.seqnr++;
@@ -3659,6 +3692,20 @@ static ssize_t pages_skipped_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(pages_skipped);
 
+static ssize_t pages_volatile_skipped_show(struct kobject *kobj,
+					   struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%lu\n", ksm_pages_volatile_skipped);
+}
+KSM_ATTR_RO(pages_volatile_skipped);
+
+static ssize_t scan_rate_show(struct kobject *kobj,
+			      struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%lu\n", ksm_scan_rate);
+}
+KSM_ATTR_RO(scan_rate);
+
 static ssize_t ksm_zero_pages_show(struct kobject *kobj,
 				struct kobj_attribute *attr, char *buf)
 {
@@ -3881,6 +3928,8 @@ static struct attribute *ksm_attrs[] = {
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&pages_skipped_attr.attr,
+	&pages_volatile_skipped_attr.attr,
+	&scan_rate_attr.attr,
 	&ksm_zero_pages_attr.attr,
 	&full_scans_attr.attr,
 #ifdef CONFIG_NUMA
@@ -606,6 +606,12 @@ static const unsigned int memcg_node_stat_items[] = {
 #ifdef CONFIG_SWAP
 	NR_SWAPCACHE,
 #endif
+#ifdef CONFIG_NUMA_BALANCING
+	PGPROMOTE_SUCCESS,
+#endif
+	PGDEMOTE_KSWAPD,
+	PGDEMOTE_DIRECT,
+	PGDEMOTE_KHUGEPAGED,
 };
 
 static const unsigned int memcg_stat_items[] = {
@@ -852,7 +858,7 @@ static inline void memcg_rstat_updated(struct mem_cgroup *memcg, int val)
 	if (!val)
 		return;
 
-	cgroup_rstat_updated(memcg->css.cgroup, cpu);
+	css_rstat_updated(&memcg->css, cpu);
 	statc = this_cpu_ptr(memcg->vmstats_percpu);
 	for (; statc; statc = statc->parent) {
 		stats_updates = READ_ONCE(statc->stats_updates) + abs(val);
@@ -876,7 +882,7 @@ static void do_flush_stats(struct mem_cgroup *memcg)
 	if (mem_cgroup_is_root(memcg))
 		WRITE_ONCE(flush_last_time, jiffies_64);
 
-	cgroup_rstat_flush(memcg->css.cgroup);
+	css_rstat_flush(&memcg->css);
 }
 
 /*
@@ -1294,6 +1300,24 @@ struct mem_cgroup *get_mem_cgroup_from_current(void)
 	return memcg;
 }
 
+/**
+ * get_mem_cgroup_from_folio - Obtain a reference on a given folio's memcg.
+ * @folio: folio from which memcg should be extracted.
+ */
+struct mem_cgroup *get_mem_cgroup_from_folio(struct folio *folio)
+{
+	struct mem_cgroup *memcg = folio_memcg(folio);
+
+	if (mem_cgroup_disabled())
+		return NULL;
+
+	rcu_read_lock();
+	if (!memcg || WARN_ON_ONCE(!css_tryget(&memcg->css)))
+		memcg = root_mem_cgroup;
+	rcu_read_unlock();
+	return memcg;
+}
+
 /**
  * mem_cgroup_iter - iterate over memory cgroup hierarchy
  * @root: hierarchy root
@@ -1744,6 +1768,13 @@ static const struct memory_stat memory_stats[] = {
 	{ "workingset_restore_anon",	WORKINGSET_RESTORE_ANON		},
 	{ "workingset_restore_file",	WORKINGSET_RESTORE_FILE		},
 	{ "workingset_nodereclaim",	WORKINGSET_NODERECLAIM		},
+
+#ifdef CONFIG_NUMA_BALANCING
+	{ "pgpromote_success",		PGPROMOTE_SUCCESS		},
+#endif
+	{ "pgdemote_kswapd",		PGDEMOTE_KSWAPD			},
+	{ "pgdemote_direct",		PGDEMOTE_DIRECT			},
+	{ "pgdemote_khugepaged",	PGDEMOTE_KHUGEPAGED		},
 };
 
 /* The actual unit of the state item, not the same as the output unit */
@@ -1766,8 +1797,9 @@ static int memcg_page_state_unit(int item)
 static int memcg_page_state_output_unit(int item)
 {
 	/*
-	 * Workingset state is actually in pages, but we export it to userspace
-	 * as a scalar count of events, so special case it here.
+	 * Workingset and promotion/demotion state is actually in pages, but we
+	 * export it to userspace as a scalar count of events, so special case
+	 * it here.
 	 */
 	switch (item) {
 	case WORKINGSET_REFAULT_ANON:
@@ -1777,6 +1809,12 @@ static int memcg_page_state_output_unit(int item)
 	case WORKINGSET_RESTORE_ANON:
 	case WORKINGSET_RESTORE_FILE:
 	case WORKINGSET_NODERECLAIM:
+#ifdef CONFIG_NUMA_BALANCING
+	case PGPROMOTE_SUCCESS:
+#endif
+	case PGDEMOTE_KSWAPD:
+	case PGDEMOTE_DIRECT:
+	case PGDEMOTE_KHUGEPAGED:
 		return 1;
 	default:
 		return memcg_page_state_unit(item);
@@ -2409,10 +2447,19 @@ void folio_memcg_unlock(struct folio *folio)
 	__folio_memcg_unlock(folio_memcg(folio));
 }
 
+/*
+ * Number of memcgs a cpu keeps charges in stock for, so that a cpu shared
+ * by the tasks of a few cgroups doesn't drain its stock on every switch.
+ */
+#define NR_MEMCG_STOCK 7
+
 struct memcg_stock_pcp {
 	local_lock_t stock_lock;
-	struct mem_cgroup *cached; /* this never be root cgroup */
-	unsigned int nr_pages;
+	struct mem_cgroup *cached[NR_MEMCG_STOCK]; /* this never be root cgroup */
+	unsigned int nr_pages[NR_MEMCG_STOCK];
+	/* number of used slots, and the next one to evict when all are */
+	unsigned int nr_cached;
+	unsigned int evict_next;
 
 #ifdef CONFIG_MEMCG_KMEM
 	struct obj_cgroup *cached_objcg;
@@ -2457,8 +2504,8 @@ static void memcg_account_kmem(struct mem_cgroup *memcg, int nr_pages)
  * @memcg: memcg to consume from.
  * @nr_pages: how many pages to charge.
  *
- * The charges will only happen if @memcg matches the current cpu's memcg
- * stock, and at least @nr_pages are available in that stock.  Failure to
+ * The charges will only happen if @memcg is one of the current cpu's memcg
+ * stocks, and at least @nr_pages are available in that stock.  Failure to
  * service an allocation will refill the stock.
  *
  * returns true if successful, false otherwise.
@@ -2469,6 +2516,7 @@ static bool consume_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 	unsigned int stock_pages;
 	unsigned long flags;
 	bool ret = false;
+	int i;
 
 	if (nr_pages > MEMCG_CHARGE_BATCH)
 		return ret;
@@ -2476,11 +2524,18 @@ static bool consume_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 	local_lock_irqsave(&memcg_stock.stock_lock, flags);
 
 	stock = this_cpu_ptr(&memcg_stock);
-	stock_pages = READ_ONCE(stock->nr_pages);
-	if (memcg == READ_ONCE(stock->cached) && stock_pages >= nr_pages) {
-		WRITE_ONCE(stock->nr_pages, stock_pages - nr_pages);
-		ret = true;
+	for (i = 0; i < NR_MEMCG_STOCK; i++) {
+		if (memcg != READ_ONCE(stock->cached[i]))
+			continue;
+
+		stock_pages = READ_ONCE(stock->nr_pages[i]);
+		if (stock_pages >= nr_pages) {
+			WRITE_ONCE(stock->nr_pages[i], stock_pages - nr_pages);
+			ret = true;
+		}
+		break;
 	}
+	__count_vm_event(ret ? MEMCG_STOCK_HIT : MEMCG_STOCK_MISS);
 
 	local_unlock_irqrestore(&memcg_stock.stock_lock, flags);
 
@@ -2488,12 +2543,12 @@ static bool consume_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 }
 
 /*
- * Returns stocks cached in percpu and reset cached information.
+ * Returns the stock cached in percpu slot @i and reset cached information.
  */
-static void drain_stock(struct memcg_stock_pcp *stock)
+static void drain_stock(struct memcg_stock_pcp *stock, int i)
 {
-	unsigned int stock_pages = READ_ONCE(stock->nr_pages);
-	struct mem_cgroup *old = READ_ONCE(stock->cached);
+	unsigned int stock_pages = READ_ONCE(stock->nr_pages[i]);
+	struct mem_cgroup *old = READ_ONCE(stock->cached[i]);
 
 	if (!old)
 		return;
@@ -2503,11 +2558,31 @@ static void drain_stock(struct memcg_stock_pcp *stock)
 		if (do_memsw_account())
 			page_counter_uncharge(&old->memsw, stock_pages);
 
-		WRITE_ONCE(stock->nr_pages, 0);
+		WRITE_ONCE(stock->nr_pages[i], 0);
 	}
 
 	css_put(&old->css);
-	WRITE_ONCE(stock->cached, NULL);
+	WRITE_ONCE(stock->cached[i], NULL);
+	WRITE_ONCE(stock->nr_cached, stock->nr_cached - 1);
+}
+
+static void drain_stock_all(struct memcg_stock_pcp *stock)
+{
+	int i;
+
+	for (i = 0; i < NR_MEMCG_STOCK; i++)
+		drain_stock(stock, i);
+}
+
+/*
+ * Number of pages to charge ahead of time and keep in stock.  The more
+ * memcgs the local cpu keeps stocks for, the less is kept for each of them,
+ * so that the charges stranded on a cpu stay within a few batches.
+ */
+static unsigned int memcg_stock_batch(void)
+{
+	return MEMCG_CHARGE_BATCH >>
+		(data_race(raw_cpu_ptr(&memcg_stock)->nr_cached) / 3);
 }
 
 static void drain_local_stock(struct work_struct *dummy)
@@ -2525,7 +2600,7 @@ static void drain_local_stock(struct work_struct *dummy)
 
 	stock = this_cpu_ptr(&memcg_stock);
 	old = drain_obj_stock(stock);
-	drain_stock(stock);
+	drain_stock_all(stock);
 	clear_bit(FLUSHING_CACHED_CHARGE, &stock->flags);
 
 	local_unlock_irqrestore(&memcg_stock.stock_lock, flags);
@@ -2540,18 +2615,35 @@ static void __refill_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 {
 	struct memcg_stock_pcp *stock;
 	unsigned int stock_pages;
+	int i, empty = -1;
 
 	stock = this_cpu_ptr(&memcg_stock);
-	if (READ_ONCE(stock->cached) != memcg) { /* reset if necessary */
-		drain_stock(stock);
+	for (i = 0; i < NR_MEMCG_STOCK; i++) {
+		struct mem_cgroup *cached = READ_ONCE(stock->cached[i]);
+
+		if (cached == memcg)
+			break;
+		if (!cached && empty < 0)
+			empty = i;
+	}
+
+	if (i == NR_MEMCG_STOCK) {
+		if (empty < 0) {
+			/* all slots are taken, evict them in turn */
+			empty = stock->evict_next;
+			stock->evict_next = (empty + 1) % NR_MEMCG_STOCK;
+			drain_stock(stock, empty);
+		}
+		i = empty;
 		css_get(&memcg->css);
-		WRITE_ONCE(stock->cached, memcg);
+		WRITE_ONCE(stock->cached[i], memcg);
+		WRITE_ONCE(stock->nr_cached, stock->nr_cached + 1);
 	}
-	stock_pages = READ_ONCE(stock->nr_pages) + nr_pages;
-	WRITE_ONCE(stock->nr_pages, stock_pages);
+	stock_pages = READ_ONCE(stock->nr_pages[i]) + nr_pages;
+	WRITE_ONCE(stock->nr_pages[i], stock_pages);
 
 	if (stock_pages > MEMCG_CHARGE_BATCH)
-		drain_stock(stock);
+		drain_stock(stock, i);
 }
 
 static void refill_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
@@ -2586,13 +2678,18 @@ static void drain_all_stock(struct mem_cgroup *root_memcg)
 		struct memcg_stock_pcp *stock = &per_cpu(memcg_stock, cpu);
 		struct mem_cgroup *memcg;
 		bool flush = false;
+		int i;
 
 		rcu_read_lock();
-		memcg = READ_ONCE(stock->cached);
-		if (memcg && READ_ONCE(stock->nr_pages) &&
-		    mem_cgroup_is_descendant(memcg, root_memcg))
-			flush = true;
-		else if (obj_stock_flush_required(stock, root_memcg))
+		for (i = 0; i < NR_MEMCG_STOCK; i++) {
+			memcg = READ_ONCE(stock->cached[i]);
+			if (memcg && READ_ONCE(stock->nr_pages[i]) &&
+			    mem_cgroup_is_descendant(memcg, root_memcg)) {
+				flush = true;
+				break;
+			}
+		}
+		if (!flush && obj_stock_flush_required(stock, root_memcg))
 			flush = true;
 		rcu_read_unlock();
 
@@ -2613,7 +2710,7 @@ static int memcg_hotplug_cpu_dead(unsigned int cpu)
 	struct memcg_stock_pcp *stock;
 
 	stock = &per_cpu(memcg_stock, cpu);
-	drain_stock(stock);
+	drain_stock_all(stock);
 
 	return 0;
 }
@@ -2890,7 +2987,7 @@ void mem_cgroup_handle_over_high(gfp_t gfp_mask)
 static int try_charge_memcg(struct mem_cgroup *memcg, gfp_t gfp_mask,
 			unsigned int nr_pages)
 {
-	unsigned int batch = max(MEMCG_CHARGE_BATCH, nr_pages);
+	unsigned int batch = max(memcg_stock_batch(), nr_pages);
 	int nr_retries = MAX_RECLAIM_RETRIES;
 	struct mem_cgroup *mem_over_limit;
 	struct page_counter *counter;
@@ -5789,6 +5886,9 @@ mem_cgroup_css_alloc(struct cgroup_subsys_state *parent_css)
 		!parent || READ_ONCE(parent->zswap_writeback));
 #endif
 	page_counter_set_high(&memcg->swap, PAGE_COUNTER_MAX);
+#ifdef CONFIG_NUMA_BALANCING
+	memcg->numa_promote_rate_limit = PAGE_COUNTER_MAX;
+#endif
 	if (parent) {
 		WRITE_ONCE(memcg->swappiness, mem_cgroup_swappiness(parent));
 		WRITE_ONCE(memcg->oom_kill_disable, READ_ONCE(parent->oom_kill_disable));
@@ -7179,6 +7279,131 @@ static ssize_t memory_oom_group_write(struct kernfs_open_file *of,
 	return nbytes;
 }
 
+#ifdef CONFIG_NUMA_BALANCING
+/**
+ * mem_cgroup_numa_hot_threshold - hot threshold for promoting a folio
+ * @folio: folio on a slow memory tier that took a hint fault
+ *
+ * Return: the hint fault latency in milliseconds below which @folio is
+ * considered hot as configured by its closest memcg ancestor, or 0 if
+ * the system-wide threshold applies.
+ */
+unsigned int mem_cgroup_numa_hot_threshold(struct folio *folio)
+{
+	struct mem_cgroup *memcg;
+	unsigned int th = 0;
+
+	if (mem_cgroup_disabled())
+		return 0;
+
+	rcu_read_lock();
+	for (memcg = folio_memcg(folio); memcg && !mem_cgroup_is_root(memcg);
+	     memcg = parent_mem_cgroup(memcg)) {
+		th = READ_ONCE(memcg->numa_hot_threshold);
+		if (th)
+			break;
+	}
+	rcu_read_unlock();
+
+	return th;
+}
+
+/**
+ * mem_cgroup_numa_promotion_rate_limit - charge a promotion candidate
+ * @folio: folio that is about to be promoted
+ * @nr: number of pages in @folio
+ *
+ * Account @nr candidate pages against the promotion budget of every
+ * ancestor of @folio's memcg. The budgets are refilled once per second,
+ * so a cgroup with hot pages on a slow tier cannot starve the promotion
+ * bandwidth of its siblings.
+ *
+ * Return: true if any ancestor exhausted its budget for this period.
+ */
+bool mem_cgroup_numa_promotion_rate_limit(struct folio *folio, int nr)
+{
+	struct mem_cgroup *memcg;
+	unsigned int now, start;
+	bool limited = false;
+
+	if (mem_cgroup_disabled())
+		return false;
+
+	now = jiffies_to_msecs(jiffies);
+	rcu_read_lock();
+	for (memcg = folio_memcg(folio); memcg && !mem_cgroup_is_root(memcg);
+	     memcg = parent_mem_cgroup(memcg)) {
+		unsigned long rate_limit;
+
+		rate_limit = READ_ONCE(memcg->numa_promote_rate_limit);
+		if (rate_limit == PAGE_COUNTER_MAX)
+			continue;
+
+		start = READ_ONCE(memcg->numa_rl_start);
+		if (now - start > MSEC_PER_SEC &&
+		    cmpxchg(&memcg->numa_rl_start, start, now) == start)
+			atomic_long_set(&memcg->numa_rl_nr_cand, 0);
+		if (atomic_long_add_return(nr, &memcg->numa_rl_nr_cand) >
+		    rate_limit)
+			limited = true;
+	}
+	rcu_read_unlock();
+
+	return limited;
+}
+
+static int memory_numa_promote_rate_limit_show(struct seq_file *m, void *v)
+{
+	return seq_puts_memcg_tunable(m,
+		READ_ONCE(mem_cgroup_from_seq(m)->numa_promote_rate_limit));
+}
+
+static ssize_t memory_numa_promote_rate_limit_write(struct kernfs_open_file *of,
+						    char *buf, size_t nbytes,
+						    loff_t off)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_css(of_css(of));
+	unsigned long rate_limit;
+	int err;
+
+	buf = strstrip(buf);
+	err = page_counter_memparse(buf, "max", &rate_limit);
+	if (err)
+		return err;
+
+	WRITE_ONCE(memcg->numa_promote_rate_limit, rate_limit);
+
+	return nbytes;
+}
+
+static int memory_numa_hot_threshold_show(struct seq_file *m, void *v)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_seq(m);
+
+	seq_printf(m, "%u\n", READ_ONCE(memcg->numa_hot_threshold));
+
+	return 0;
+}
+
+static ssize_t memory_numa_hot_threshold_write(struct kernfs_open_file *of,
+					       char *buf, size_t nbytes,
+					       loff_t off)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_css(of_css(of));
+	unsigned int th;
+	int ret;
+
+	buf = strstrip(buf);
+	ret = kstrtouint(buf, 0, &th);
+	if (ret)
+		return ret;
+
+	WRITE_ONCE(memcg->numa_hot_threshold, th);
+
+	return nbytes;
+}
+#endif /* CONFIG_NUMA_BALANCING */
+
 static ssize_t memory_reclaim(struct kernfs_open_file *of, char *buf,
 			      size_t nbytes, loff_t off)
 {
@@ -7278,6 +7503,20 @@ static struct cftype memory_files[] = {
 		.name = "numa_stat",
 		.seq_show = memory_numa_stat_show,
 	},
+#endif
+#ifdef CONFIG_NUMA_BALANCING
+	{
+		.name = "numa_promote_rate_limit",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = memory_numa_promote_rate_limit_show,
+		.write = memory_numa_promote_rate_limit_write,
+	},
+	{
+		.name = "numa_hot_threshold_ms",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = memory_numa_hot_threshold_show,
+		.write = memory_numa_hot_threshold_write,
+	},
 #endif
 	{
 		.name = "oom.group",
@@ -7585,14 +7824,12 @@ int mem_cgroup_swapin_charge_folio(struct folio *folio, struct mm_struct *mm,
 
 /*
  * mem_cgroup_swapin_uncharge_swap - uncharge swap slot
- * @entry: swap entry for which the page is charged
+ * @entry: the first swap entry for which the pages are charged
+ * @nr_pages: number of pages which will be uncharged
  *
  * Call this function after successfully adding the charged page to swapcache.
- *
- * Note: This function assumes the page for which swap slot is being uncharged
- * is order 0 page.
  */
-void mem_cgroup_swapin_uncharge_swap(swp_entry_t entry)
+void mem_cgroup_swapin_uncharge_swap(swp_entry_t entry, unsigned int nr_pages)
 {
 	/*
 	 * Cgroup1's unified memory+swap counter has been charged with the
@@ -7612,7 +7849,7 @@ void mem_cgroup_swapin_uncharge_swap(swp_entry_t entry)
 		 * let's not wait for it.  The page already received a
 		 * memory+swap charge, drop the swap entry duplicate.
 		 */
-		mem_cgroup_uncharge_swap(entry, 1);
+		mem_cgroup_uncharge_swap(entry, nr_pages);
 	}
 }
 
@@ -35,6 +35,7 @@
 #include <linux/compaction.h>
 #include <linux/rmap.h>
 #include <linux/module.h>
+#include <linux/padata.h>
 
 #include <asm/tlbflush.h>
 
@@ -738,6 +739,54 @@ static inline void section_taint_zone_device(unsigned long pfn)
 }
 #endif
 
+struct memmap_init_job_arg {
+	int nid;
+	enum zone_type zone_idx;
+	int migratetype;
+};
+
+static void memmap_init_job_chunk(unsigned long start_pfn,
+				  unsigned long end_pfn, void *arg)
+{
+	struct memmap_init_job_arg *job_arg = arg;
+
+	memmap_init_range(end_pfn - start_pfn, job_arg->nid, job_arg->zone_idx,
+			  start_pfn, 0, MEMINIT_HOTPLUG, NULL,
+			  job_arg->migratetype);
+}
+
+/*
+ * Initialize the memmap of hotplugged memory with padata helpers, in
+ * chunks of at least a section, like deferred struct page init does at
+ * boot. Onlining a large memory block otherwise spends most of its time
+ * here, single-threaded in the context writing to sysfs.
+ */
+static void memmap_init_hotplug(struct zone *zone, unsigned long start_pfn,
+				unsigned long nr_pages, int migratetype)
+{
+	struct memmap_init_job_arg job_arg = {
+		.nid		= zone_to_nid(zone),
+		.zone_idx	= zone_idx(zone),
+		.migratetype	= migratetype,
+	};
+	struct padata_mt_job job = {
+		.thread_fn	= memmap_init_job_chunk,
+		.fn_arg		= &job_arg,
+		.start		= start_pfn,
+		.size		= nr_pages,
+		.align		= pageblock_nr_pages,
+		.min_chunk	= PAGES_PER_SECTION,
+		.max_threads	= num_online_cpus(),
+		.numa_aware	= false,
+	};
+
+	padata_do_multithreaded(&job);
+
+	/* Chunks may update this out of order */
+	if (highest_memmap_pfn < start_pfn + nr_pages - 1)
+		highest_memmap_pfn = start_pfn + nr_pages - 1;
+}
+
 /*
  * Associate the pfn range with the given zone, initializing the memmaps
  * and resizing the pgdat/zone data to span the added pages. After this
@@ -780,8 +829,11 @@ void __ref move_pfn_range_to_zone(struct zone *zone, unsigned long start_pfn,
 	 * expects the zone spans the pfn range. All the pages in the range
 	 * are reserved so nobody should be touching them so we should be safe
 	 */
-	memmap_init_range(nr_pages, nid, zone_idx(zone), start_pfn, 0,
-			 MEMINIT_HOTPLUG, altmap, migratetype);
+	if (altmap || zone_is_zone_device(zone))
+		memmap_init_range(nr_pages, nid, zone_idx(zone), start_pfn, 0,
+				  MEMINIT_HOTPLUG, altmap, migratetype);
+	else
+		memmap_init_hotplug(zone, start_pfn, nr_pages, migratetype);
 
 	set_zone_contiguous(zone);
 }
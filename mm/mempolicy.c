@@ -109,6 +109,8 @@
 #include <linux/mmu_notifier.h>
 #include <linux/printk.h>
 #include <linux/swapops.h>
+#include <linux/gcd.h>
+#include <linux/node.h>
 
 #include <asm/tlbflush.h>
 #include <asm/tlb.h>
@@ -149,6 +151,15 @@ static struct mempolicy preferred_node_policy[MAX_NUMNODES];
 static u8 __rcu *iw_table;
 static DEFINE_MUTEX(iw_table_lock);
 
+/*
+ * In auto mode iw_table is derived from node_bw_table, the bandwidth of
+ * each node as seen from the CPUs (HMAT/CDAT, in MB/s). Both are protected
+ * by iw_table_lock. Setting a node weight by hand leaves auto mode.
+ */
+#define WI_AUTO_MAX_WEIGHT	32
+static unsigned int *node_bw_table;
+static bool wi_auto;
+
 static u8 get_il_weight(int node)
 {
 	u8 *table;
@@ -164,6 +175,98 @@ static u8 get_il_weight(int node)
 	return weight;
 }
 
+/*
+ * Scale the bandwidths to weights in [1, WI_AUTO_MAX_WEIGHT] and reduce
+ * them by their common divisor, so the interleave rounds stay short.
+ * Nodes without bandwidth data get the default weight.
+ */
+static void reduce_interleave_weights(unsigned int *bw, u8 *new_iw)
+{
+	unsigned int iw_gcd = 0;
+	u64 sum_bw = 0;
+	int nid;
+
+	for_each_node_state(nid, N_MEMORY)
+		sum_bw += bw[nid];
+
+	for_each_node_state(nid, N_MEMORY) {
+		unsigned int weight = 1;
+
+		if (sum_bw && bw[nid])
+			weight = max_t(u64, div64_u64((u64)bw[nid] *
+					WI_AUTO_MAX_WEIGHT, sum_bw), 1);
+		new_iw[nid] = weight;
+		iw_gcd = iw_gcd ? gcd(iw_gcd, weight) : weight;
+	}
+
+	if (iw_gcd > 1)
+		for_each_node_state(nid, N_MEMORY)
+			new_iw[nid] /= iw_gcd;
+}
+
+/*
+ * Recompute iw_table from node_bw_table. Returns the old table, which the
+ * caller frees after a grace period, or NULL.
+ */
+static u8 *wi_auto_update_locked(void)
+{
+	u8 *new, *old;
+
+	lockdep_assert_held(&iw_table_lock);
+
+	if (!node_bw_table)
+		return NULL;
+
+	new = kzalloc(nr_node_ids, GFP_KERNEL);
+	if (!new)
+		return NULL;
+
+	reduce_interleave_weights(node_bw_table, new);
+	old = rcu_dereference_protected(iw_table,
+					lockdep_is_held(&iw_table_lock));
+	rcu_assign_pointer(iw_table, new);
+	return old;
+}
+
+/**
+ * mempolicy_set_node_perf - update a node's bandwidth for weighted interleave
+ * @node: node whose performance data changed
+ * @coords: bandwidth and latency of @node as seen from the CPUs
+ *
+ * Called when firmware tables or a driver report new performance data for
+ * @node. In auto mode the interleave weights are recomputed right away, so
+ * a source of live bandwidth data can keep calling this to retune them.
+ *
+ * Return: 0 on success, -ENOMEM if the bandwidth table can't be allocated.
+ */
+int mempolicy_set_node_perf(unsigned int node, struct access_coordinate *coords)
+{
+	u8 *old = NULL;
+
+	mutex_lock(&iw_table_lock);
+	if (!node_bw_table) {
+		node_bw_table = kcalloc(nr_node_ids, sizeof(*node_bw_table),
+					GFP_KERNEL);
+		if (!node_bw_table) {
+			mutex_unlock(&iw_table_lock);
+			return -ENOMEM;
+		}
+	}
+
+	/* Interleaving is bound by the weaker of the two directions. */
+	node_bw_table[node] = min(coords->read_bandwidth,
+				  coords->write_bandwidth);
+	if (wi_auto)
+		old = wi_auto_update_locked();
+	mutex_unlock(&iw_table_lock);
+
+	if (old) {
+		synchronize_rcu();
+		kfree(old);
+	}
+	return 0;
+}
+
 /**
  * numa_nearest_node - Find nearest node by state
  * @node: Node id to start the search
@@ -2300,6 +2403,9 @@ struct folio *vma_alloc_folio_noprof(gfp_t gfp, int order, struct vm_area_struct
 	pgoff_t ilx;
 	struct page *page;
 
+	if (vma->vm_flags & VM_DROPPABLE)
+		gfp |= __GFP_NOWARN;
+
 	pol = get_vma_policy(vma, addr, order, &ilx);
 	page = alloc_pages_mpol_noprof(gfp | __GFP_COMP, order,
 				       pol, ilx, numa_node_id());
@@ -3386,12 +3492,45 @@ static ssize_t node_store(struct kobject *kobj, struct kobj_attribute *attr,
 		memcpy(new, old, nr_node_ids);
 	new[node_attr->nid] = weight;
 	rcu_assign_pointer(iw_table, new);
+	wi_auto = false;
 	mutex_unlock(&iw_table_lock);
 	synchronize_rcu();
 	kfree(old);
 	return count;
 }
 
+static ssize_t auto_show(struct kobject *kobj, struct kobj_attribute *attr,
+			 char *buf)
+{
+	return sysfs_emit(buf, "%d\n", READ_ONCE(wi_auto));
+}
+
+static ssize_t auto_store(struct kobject *kobj, struct kobj_attribute *attr,
+			  const char *buf, size_t count)
+{
+	u8 *old = NULL;
+	bool input;
+
+	if (kstrtobool(buf, &input))
+		return -EINVAL;
+
+	mutex_lock(&iw_table_lock);
+	/* Leaving auto mode keeps the current weights. */
+	if (input && !wi_auto)
+		old = wi_auto_update_locked();
+	WRITE_ONCE(wi_auto, input);
+	mutex_unlock(&iw_table_lock);
+
+	if (old) {
+		synchronize_rcu();
+		kfree(old);
+	}
+	return count;
+}
+
+static struct kobj_attribute wi_auto_attr =
+	__ATTR(auto, 0644, auto_show, auto_store);
+
 static struct iw_node_attr **node_attrs;
 
 static void sysfs_wi_node_release(struct iw_node_attr *node_attr,
@@ -3474,6 +3613,11 @@ static int add_weighted_interleave_group(struct kobject *root_kobj)
 			break;
 		}
 	}
+	if (!err) {
+		err = sysfs_create_file(wi_kobj, &wi_auto_attr.attr);
+		if (err)
+			pr_err("failed to add sysfs [auto]\n");
+	}
 	if (err)
 		kobject_put(wi_kobj);
 	return 0;
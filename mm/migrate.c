@@ -2608,11 +2608,13 @@ int migrate_misplaced_folio(struct folio *folio, struct vm_area_struct *vma,
 			    int node)
 {
 	pg_data_t *pgdat = NODE_DATA(node);
+	struct mem_cgroup *memcg;
 	int isolated;
 	int nr_remaining;
 	unsigned int nr_succeeded;
 	LIST_HEAD(migratepages);
 	int nr_pages = folio_nr_pages(folio);
+	bool promote;
 
 	/*
 	 * Don't migrate file folios that are mapped in multiple processes
@@ -2636,6 +2638,10 @@ int migrate_misplaced_folio(struct folio *folio, struct vm_area_struct *vma,
 	if (!isolated)
 		goto out;
 
+	/* the folio is gone after a successful migration, look it up now */
+	promote = !node_is_toptier(folio_nid(folio)) && node_is_toptier(node);
+	memcg = promote ? get_mem_cgroup_from_folio(folio) : NULL;
+
 	list_add(&folio->lru, &migratepages);
 	nr_remaining = migrate_pages(&migratepages, alloc_misplaced_dst_folio,
 				     NULL, node, MIGRATE_ASYNC,
@@ -2651,10 +2657,11 @@ int migrate_misplaced_folio(struct folio *folio, struct vm_area_struct *vma,
 	}
 	if (nr_succeeded) {
 		count_vm_numa_events(NUMA_PAGE_MIGRATE, nr_succeeded);
-		if (!node_is_toptier(folio_nid(folio)) && node_is_toptier(node))
-			mod_node_page_state(pgdat, PGPROMOTE_SUCCESS,
-					    nr_succeeded);
+		if (promote)
+			mod_lruvec_state(mem_cgroup_lruvec(memcg, pgdat),
+					 PGPROMOTE_SUCCESS, nr_succeeded);
 	}
+	mem_cgroup_put(memcg);
 	BUG_ON(!list_empty(&migratepages));
 	return isolated;
 
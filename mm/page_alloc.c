@@ -45,6 +45,7 @@
 #include <linux/mmu_notifier.h>
 #include <linux/migrate.h>
 #include <linux/sched/mm.h>
+#include <linux/sched/clock.h>
 #include <linux/page_owner.h>
 #include <linux/page_table_check.h>
 #include <linux/memcontrol.h>
@@ -1138,10 +1139,19 @@ __always_inline bool free_pages_prepare(struct page *page,
  * Assumes all pages on list are in same zone.
  * count is the number of pages to free.
  */
+#ifdef CONFIG_PCP_STATS
+#define pcp_stat_add(pcp, item, val)	((pcp)->stats.item += (val))
+#define pcp_stat_clock()		local_clock()
+#else
+#define pcp_stat_add(pcp, item, val)	do { } while (0)
+#define pcp_stat_clock()		0
+#endif
+
 static void free_pcppages_bulk(struct zone *zone, int count,
 					struct per_cpu_pages *pcp,
 					int pindex)
 {
+	u64 __maybe_unused start;
 	unsigned long flags;
 	unsigned int order;
 	struct page *page;
@@ -1155,7 +1165,11 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 	/* Ensure requested pindex is drained first. */
 	pindex = pindex - 1;
 
+	pcp_stat_add(pcp, drain, 1);
+	pcp_stat_add(pcp, drain_pages, count);
+
 	spin_lock_irqsave(&zone->lock, flags);
+	start = pcp_stat_clock();
 
 	while (count > 0) {
 		struct list_head *list;
@@ -1188,6 +1202,7 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 		} while (count > 0 && !list_empty(list));
 	}
 
+	pcp_stat_add(pcp, drain_lock_ns, pcp_stat_clock() - start);
 	spin_unlock_irqrestore(&zone->lock, flags);
 }
 
@@ -2936,8 +2951,12 @@ struct page *__rmqueue_pcplist(struct zone *zone, unsigned int order,
 					migratetype, alloc_flags);
 
 			pcp->count += alloced << order;
+			pcp_stat_add(pcp, refill, 1);
+			pcp_stat_add(pcp, refill_pages, alloced << order);
 			if (unlikely(list_empty(list)))
 				return NULL;
+		} else {
+			pcp_stat_add(pcp, hit, 1);
 		}
 
 		page = list_first_entry(list, struct page, pcp_list);
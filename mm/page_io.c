@@ -222,6 +222,14 @@ static inline void count_swpout_vm_event(struct folio *folio)
 	count_vm_events(PSWPOUT, folio_nr_pages(folio));
 }
 
+static inline void count_swpin_vm_event(struct folio *folio)
+{
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	count_mthp_stat(folio_order(folio), MTHP_STAT_SWPIN);
+#endif
+	count_vm_events(PSWPIN, folio_nr_pages(folio));
+}
+
 #if defined(CONFIG_MEMCG) && defined(CONFIG_BLK_CGROUP)
 static void bio_associate_blkg_from_page(struct bio *bio, struct folio *folio)
 {
@@ -411,10 +419,10 @@ static void sio_read_complete(struct kiocb *iocb, long ret)
 		for (p = 0; p < sio->pages; p++) {
 			struct folio *folio = page_folio(sio->bvec[p].bv_page);
 
+			count_swpin_vm_event(folio);
 			folio_mark_uptodate(folio);
 			folio_unlock(folio);
 		}
-		count_vm_events(PSWPIN, sio->pages);
 	} else {
 		for (p = 0; p < sio->pages; p++) {
 			struct folio *folio = page_folio(sio->bvec[p].bv_page);
@@ -474,7 +482,7 @@ static void swap_read_folio_bdev_sync(struct folio *folio,
 	 * attempt to access it in the page fault retry time check.
 	 */
 	get_task_struct(current);
-	count_vm_event(PSWPIN);
+	count_swpin_vm_event(folio);
 	submit_bio_wait(&bio);
 	__end_swap_bio_read(&bio);
 	put_task_struct(current);
@@ -489,7 +497,7 @@ static void swap_read_folio_bdev_async(struct folio *folio,
 	bio->bi_iter.bi_sector = swap_folio_sector(folio);
 	bio->bi_end_io = end_swap_bio_read;
 	bio_add_folio_nofail(bio, folio, folio_size(folio), 0);
-	count_vm_event(PSWPIN);
+	count_swpin_vm_event(folio);
 	submit_bio(bio);
 }
 
@@ -516,10 +524,11 @@ void swap_read_folio(struct folio *folio, bool synchronous,
 	}
 	delayacct_swapin_start();
 
-	if (zswap_load(folio)) {
-		folio_mark_uptodate(folio);
-		folio_unlock(folio);
-	} else if (data_race(sis->flags & SWP_FS_OPS)) {
+	/* on success zswap marks the folio uptodate and unlocks it */
+	if (zswap_load(folio))
+		goto finish;
+
+	if (data_race(sis->flags & SWP_FS_OPS)) {
 		swap_read_folio_fs(folio, plug);
 	} else if (synchronous || (sis->flags & SWP_SYNCHRONOUS_IO)) {
 		swap_read_folio_bdev_sync(folio, sis);
@@ -527,6 +536,7 @@ void swap_read_folio(struct folio *folio, bool synchronous,
 		swap_read_folio_bdev_async(folio, sis);
 	}
 
+finish:
 	if (workingset) {
 		delayacct_thrashing_end(&in_thrashing);
 		psi_memstall_leave(&pflags);
@@ -129,6 +129,8 @@
 #include <linux/fadvise.h>
 #include <linux/sched/mm.h>
 
+#include <trace/events/filemap.h>
+
 #include "internal.h"
 
 /*
@@ -188,6 +190,16 @@ static void read_pages(struct readahead_control *rac)
 	BUG_ON(readahead_count(rac));
 }
 
+static struct folio *ractl_alloc_folio(struct readahead_control *ractl,
+		gfp_t gfp_mask, unsigned int order)
+{
+	struct folio *folio = filemap_alloc_folio(gfp_mask, order);
+
+	if (folio && ractl->dropbehind)
+		__folio_set_dropbehind(folio);
+	return folio;
+}
+
 /**
  * page_cache_ra_unbounded - Start unchecked readahead.
  * @ractl: Readahead control.
@@ -245,7 +257,7 @@ void page_cache_ra_unbounded(struct readahead_control *ractl,
 			continue;
 		}
 
-		folio = filemap_alloc_folio(gfp_mask, 0);
+		folio = ractl_alloc_folio(ractl, gfp_mask, 0);
 		if (!folio)
 			break;
 
@@ -465,11 +477,74 @@ static int try_context_readahead(struct address_space *mapping,
 	return 1;
 }
 
+/*
+ * Reads of a column in a columnar file are strided: reads of about the same
+ * size, with holes of the same size in between. Neither the sequential
+ * detection nor the page cache context see those, so track the hole in
+ * ra->stride and read the next chunks ahead once the same hole showed up
+ * RA_STRIDE_HITS times in a row. The first folio of the last chunk gets the
+ * readahead marker, so that a reader keeping the stride never blocks.
+ */
+#define RA_STRIDE_HITS		2
+
+static bool try_stride_readahead(struct readahead_control *ractl,
+		struct folio *folio, unsigned long req_size,
+		unsigned long max_pages)
+{
+	struct file_ra_state *ra = ractl->ra;
+	pgoff_t index = readahead_index(ractl);
+	pgoff_t prev_index = (unsigned long long)ra->prev_pos >> PAGE_SHIFT;
+	unsigned long stride, period, nr_chunks, i;
+
+	if (ra->prev_pos < 0 || index <= prev_index + 1 ||
+	    index - prev_index > UINT_MAX)
+		goto reset;
+
+	stride = index - prev_index;
+	if (stride != ra->stride) {
+		/* Marker hits do not start a new stride */
+		if (folio)
+			goto reset;
+		ra->stride = stride;
+		ra->stride_count = 1;
+		return false;
+	}
+
+	if (!folio && ra->stride_count < RA_STRIDE_HITS)
+		ra->stride_count++;
+	if (ra->stride_count < RA_STRIDE_HITS)
+		return false;
+
+	/* Chunks as large as the window are better served as random reads */
+	nr_chunks = max_pages / req_size;
+	if (nr_chunks < 2)
+		return false;
+
+	trace_mm_filemap_readahead_stride(ractl, req_size);
+
+	/*
+	 * Chunk 0 is the current read, it is only in the page cache already
+	 * when we got here through its marker.
+	 */
+	period = req_size - 1 + stride;
+	for (i = folio ? 1 : 0; i < nr_chunks; i++) {
+		ractl->_index = index + i * period;
+		do_page_cache_ra(ractl, req_size,
+				 i == nr_chunks - 1 ? req_size : 0);
+	}
+	return true;
+
+reset:
+	ra->stride = 0;
+	ra->stride_count = 0;
+	return false;
+}
+
 static inline int ra_alloc_folio(struct readahead_control *ractl, pgoff_t index,
 		pgoff_t mark, unsigned int order, gfp_t gfp)
 {
 	int err;
-	struct folio *folio = filemap_alloc_folio(gfp, order);
+	struct folio *folio = ractl_alloc_folio(ractl, gfp, order);
 
 	if (!folio)
 		return -ENOMEM;
@@ -589,13 +664,16 @@ static void ondemand_readahead(struct readahead_control *ractl,
 
 	/*
 	 * Hit a marked folio without valid readahead state.
-	 * E.g. interleaved reads.
+	 * E.g. interleaved or strided reads.
 	 * Query the pagecache for async_size, which normally equals to
 	 * readahead size. Ramp it up and use it as the new readahead size.
 	 */
 	if (folio) {
 		pgoff_t start;
 
+		if (try_stride_readahead(ractl, folio, req_size, max_pages))
+			return;
+
 		rcu_read_lock();
 		start = page_cache_next_miss(ractl->mapping, index + 1,
 				max_pages);
@@ -627,6 +705,12 @@ static void ondemand_readahead(struct readahead_control *ractl,
 	if (index - prev_index <= 1UL)
 		goto initial_readahead;
 
+	/*
+	 * Equally sized holes between the reads of a strided scan.
+	 */
+	if (try_stride_readahead(ractl, NULL, req_size, max_pages))
+		return;
+
 	/*
 	 * Query the page cache and look for the traces(cached history pages)
 	 * that a sequential stream would leave behind.
@@ -643,6 +727,7 @@ static void ondemand_readahead(struct readahead_control *ractl,
 	return;
 
 initial_readahead:
+	ra->stride_count = 0;
 	ra->start = index;
 	ra->size = get_init_ra_size(req_size, max_pages);
 	ra->async_size = ra->size > req_size ? ra->size - req_size : ra->size;
@@ -687,6 +772,8 @@ void page_cache_sync_ra(struct readahead_control *ractl,
 		do_forced_ra = true;
 	}
 
+	trace_mm_filemap_readahead_miss(ractl, req_count);
+
 	/* be dumb */
 	if (do_forced_ra) {
 		force_page_cache_ra(ractl, req_count);
@@ -715,6 +802,8 @@ void page_cache_async_ra(struct readahead_control *ractl,
 	if (blk_cgroup_congested())
 		return;
 
+	trace_mm_filemap_readahead_hit(ractl, req_count);
+
 	ondemand_readahead(ractl, folio, req_count);
 }
 EXPORT_SYMBOL_GPL(page_cache_async_ra);
@@ -794,7 +883,7 @@ void readahead_expand(struct readahead_control *ractl,
 		if (folio && !xa_is_value(folio))
 			return; /* Folio apparently present */
 
-		folio = filemap_alloc_folio(gfp_mask, 0);
+		folio = ractl_alloc_folio(ractl, gfp_mask, 0);
 		if (!folio)
 			return;
 		if (filemap_add_folio(mapping, folio, index, gfp_mask) < 0) {
@@ -821,7 +910,7 @@ void readahead_expand(struct readahead_control *ractl,
 		if (folio && !xa_is_value(folio))
 			return; /* Folio apparently present */
 
-		folio = filemap_alloc_folio(gfp_mask, 0);
+		folio = ractl_alloc_folio(ractl, gfp_mask, 0);
 		if (!folio)
 			return;
 		if (filemap_add_folio(mapping, folio, index, gfp_mask) < 0) {
@@ -119,6 +119,7 @@ struct shmem_options {
 	umode_t mode;
 	bool full_inums;
 	int huge;
+	unsigned long huge_orders;
 	int seen;
 	bool noswap;
 	unsigned short quota_types;
@@ -129,6 +130,7 @@ struct shmem_options {
 #define SHMEM_SEEN_INUMS 8
 #define SHMEM_SEEN_NOSWAP 16
 #define SHMEM_SEEN_QUOTA 32
+#define SHMEM_SEEN_HUGE_SIZES 64
 };
 
 #ifdef CONFIG_TMPFS
@@ -516,6 +518,10 @@ static bool shmem_confirm_swap(struct address_space *mapping,
  *	also respect fadvise()/madvise() hints;
  * SHMEM_HUGE_ADVISE:
  *	only allocate huge pages if requested with fadvise()/madvise();
+ *
+ * The huge pages are PMD-sized, unless the sizes to use are listed with the
+ * huge_sizes= option: those are then tried from the largest one down, and
+ * writes and fallocate() only use the sizes that they fill.
  */
 
 #define SHMEM_HUGE_NEVER	0
@@ -584,6 +590,81 @@ bool shmem_is_huge(struct inode *inode, pgoff_t index,
 	return __shmem_is_huge(inode, index, shmem_huge_force, mm, vm_flags);
 }
 
+/* The largest folio that huge_sizes= may ask for */
+#define SHMEM_MAX_HUGE_ORDER	min_t(int, HPAGE_PMD_ORDER, MAX_PAGECACHE_ORDER)
+
+/*
+ * Return the subset of @orders whose folio around @index, naturally aligned,
+ * ends at or before the page offset @end.
+ */
+static unsigned long shmem_orders_within(pgoff_t index, pgoff_t end,
+					 unsigned long orders)
+{
+	unsigned long within = 0;
+	int order;
+
+	for_each_set_bit(order, &orders, BITS_PER_LONG) {
+		if (round_up(index + 1, 1UL << order) <= end)
+			within |= BIT(order);
+	}
+	return within;
+}
+
+/*
+ * Return the folio orders that huge= allows for a new folio at @index.
+ * @write_end is the file offset that a write or fallocate() is going to fill
+ * up to, or 0 when the caller has no such hint.
+ */
+static unsigned long shmem_huge_orders(struct inode *inode, pgoff_t index,
+		loff_t write_end, struct vm_area_struct *vma)
+{
+	struct shmem_sb_info *sbinfo = SHMEM_SB(inode->i_sb);
+	unsigned long orders = READ_ONCE(sbinfo->huge_orders);
+	unsigned long vm_flags = vma ? vma->vm_flags : 0;
+	struct mm_struct *mm = vma ? vma->vm_mm : NULL;
+	unsigned long within;
+	pgoff_t end;
+
+	if (!orders || shmem_huge == SHMEM_HUGE_FORCE) {
+		if (!shmem_is_huge(inode, index, false, mm, vm_flags))
+			return 0;
+		return BIT(HPAGE_PMD_ORDER);
+	}
+
+	if (!S_ISREG(inode->i_mode))
+		return 0;
+	if (mm && ((vm_flags & VM_NOHUGEPAGE) || test_bit(MMF_DISABLE_THP, &mm->flags)))
+		return 0;
+	if (shmem_huge == SHMEM_HUGE_DENY)
+		return 0;
+
+	/*
+	 * A write knows how much of the file it is about to fill: don't
+	 * allocate beyond that, so that small writes get small folios.
+	 */
+	end = DIV_ROUND_UP(write_end, PAGE_SIZE);
+	if (!vma && end)
+		orders = shmem_orders_within(index, end, orders);
+
+	switch (sbinfo->huge) {
+	case SHMEM_HUGE_ALWAYS:
+		return orders;
+	case SHMEM_HUGE_WITHIN_SIZE:
+		end = max_t(pgoff_t, end,
+			    DIV_ROUND_UP(i_size_read(inode), PAGE_SIZE));
+		within = shmem_orders_within(index, end, orders);
+		if (within)
+			return within;
+		fallthrough;
+	case SHMEM_HUGE_ADVISE:
+		if (vm_flags & VM_HUGEPAGE)
+			return orders;
+		fallthrough;
+	default:
+		return 0;
+	}
+}
+
 #if defined(CONFIG_SYSFS)
 static int shmem_parse_huge(const char *str)
 {
@@ -626,6 +707,50 @@ static const char *shmem_format_huge(int huge)
 }
 #endif
 
+#ifdef CONFIG_TMPFS
+/* Parse a huge_sizes= list, like "64k:256k:2m", into folio orders */
+static int shmem_parse_huge_sizes(char *str, unsigned long *orders)
+{
+	unsigned long mask = 0;
+	unsigned long long size;
+	char *rest;
+	int order;
+
+	for (;;) {
+		size = memparse(str, &rest);
+		if (rest == str || size < PAGE_SIZE ||
+		    !is_power_of_2(size >> PAGE_SHIFT) ||
+		    (size & ~PAGE_MASK))
+			return -EINVAL;
+		order = ilog2(size >> PAGE_SHIFT);
+		/* Order-1 folios can't be put in the page cache */
+		if (order < 2 || order > SHMEM_MAX_HUGE_ORDER)
+			return -EINVAL;
+		mask |= BIT(order);
+		if (!*rest)
+			break;
+		if (*rest != ':')
+			return -EINVAL;
+		str = rest + 1;
+	}
+
+	*orders = mask;
+	return 0;
+}
+
+static void shmem_show_huge_sizes(struct seq_file *seq, unsigned long orders)
+{
+	char sep = '=';
+	int order;
+
+	seq_puts(seq, ",huge_sizes");
+	for_each_set_bit(order, &orders, BITS_PER_LONG) {
+		seq_printf(seq, "%c%luk", sep, (PAGE_SIZE << order) >> 10);
+		sep = ':';
+	}
+}
+#endif /* CONFIG_TMPFS */
+
 static unsigned long shmem_unused_huge_shrink(struct shmem_sb_info *sbinfo,
 		struct shrink_control *sc, unsigned long nr_to_split)
 {
@@ -685,7 +810,8 @@ static unsigned long shmem_unused_huge_shrink(struct shmem_sb_info *sbinfo,
 		if (nr_to_split && split >= nr_to_split)
 			goto move_back;
 
-		index = (inode->i_size & HPAGE_PMD_MASK) >> PAGE_SHIFT;
+		/* The folio that i_size ends in, whatever its size */
+		index = inode->i_size >> PAGE_SHIFT;
 		folio = filemap_get_folio(inode->i_mapping, index);
 		if (IS_ERR(folio))
 			goto drop;
@@ -759,6 +885,19 @@ static long shmem_unused_huge_count(struct super_block *sb,
 
 #define shmem_huge SHMEM_HUGE_DENY
 
+#ifdef CONFIG_TMPFS
+static int shmem_parse_huge_sizes(char *str, unsigned long *orders)
+{
+	return -EINVAL;
+}
+#endif
+
+static unsigned long shmem_huge_orders(struct inode *inode, pgoff_t index,
+		loff_t write_end, struct vm_area_struct *vma)
+{
+	return 0;
+}
+
 static unsigned long shmem_unused_huge_shrink(struct shmem_sb_info *sbinfo,
 		struct shrink_control *sc, unsigned long nr_to_split)
 {
@@ -1614,50 +1753,44 @@ static gfp_t limit_gfp_mask(gfp_t huge_gfp, gfp_t limit_gfp)
 	return result;
 }
 
-static struct folio *shmem_alloc_hugefolio(gfp_t gfp,
+static struct folio *shmem_alloc_folio(gfp_t gfp, int order,
 		struct shmem_inode_info *info, pgoff_t index)
 {
 	struct mempolicy *mpol;
 	pgoff_t ilx;
 	struct page *page;
 
-	mpol = shmem_get_pgoff_policy(info, index, HPAGE_PMD_ORDER, &ilx);
-	page = alloc_pages_mpol(gfp, HPAGE_PMD_ORDER, mpol, ilx, numa_node_id());
+	mpol = shmem_get_pgoff_policy(info, index, order, &ilx);
+	page = alloc_pages_mpol(gfp, order, mpol, ilx, numa_node_id());
 	mpol_cond_put(mpol);
 
 	return page_rmappable_folio(page);
 }
 
-static struct folio *shmem_alloc_folio(gfp_t gfp,
-		struct shmem_inode_info *info, pgoff_t index)
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+static void shmem_count_huge_fallback(int order)
 {
-	struct mempolicy *mpol;
-	pgoff_t ilx;
-	struct page *page;
-
-	mpol = shmem_get_pgoff_policy(info, index, 0, &ilx);
-	page = alloc_pages_mpol(gfp, 0, mpol, ilx, numa_node_id());
-	mpol_cond_put(mpol);
-
-	return (struct folio *)page;
+	if (order == HPAGE_PMD_ORDER)
+		count_vm_event(THP_FILE_FALLBACK);
+	count_mthp_stat(order, MTHP_STAT_SHMEM_FALLBACK);
 }
 
-static struct folio *shmem_alloc_and_add_folio(gfp_t gfp,
-		struct inode *inode, pgoff_t index,
-		struct mm_struct *fault_mm, bool huge)
+/*
+ * Allocate a folio of the largest of @orders that doesn't overlap anything
+ * in the page cache, and align *@index to it.
+ */
+static struct folio *shmem_alloc_huge_folio(gfp_t gfp, struct inode *inode,
+		pgoff_t *index, unsigned long orders)
 {
 	struct address_space *mapping = inode->i_mapping;
 	struct shmem_inode_info *info = SHMEM_I(inode);
 	struct folio *folio;
-	long pages;
-	int error;
-
-	if (!IS_ENABLED(CONFIG_TRANSPARENT_HUGEPAGE))
-		huge = false;
+	pgoff_t aligned;
+	int order;
 
-	if (huge) {
-		pages = HPAGE_PMD_NR;
-		index = round_down(index, HPAGE_PMD_NR);
+	order = highest_order(orders);
+	while (orders) {
+		aligned = round_down(*index, 1UL << order);
 
 		/*
 		 * Check for conflict before waiting on a huge allocation.
@@ -1667,19 +1800,53 @@ static struct folio *shmem_alloc_and_add_folio(gfp_t gfp,
 		 * Be careful to retry when appropriate, but not forever!
 		 * Elsewhere -EEXIST would be the right code, but not here.
 		 */
-		if (xa_find(&mapping->i_pages, &index,
-				index + HPAGE_PMD_NR - 1, XA_PRESENT))
-			return ERR_PTR(-E2BIG);
+		if (!xa_find(&mapping->i_pages, &aligned,
+			     aligned + (1UL << order) - 1, XA_PRESENT)) {
+			aligned = round_down(*index, 1UL << order);
+			folio = shmem_alloc_folio(gfp, order, info, aligned);
+			if (folio) {
+				*index = aligned;
+				return folio;
+			}
+			shmem_count_huge_fallback(order);
+		}
+		order = next_order(&orders, order);
+	}
+
+	return NULL;
+}
+#else /* !CONFIG_TRANSPARENT_HUGEPAGE */
+static void shmem_count_huge_fallback(int order)
+{
+}
 
-		folio = shmem_alloc_hugefolio(gfp, info, index);
+static struct folio *shmem_alloc_huge_folio(gfp_t gfp, struct inode *inode,
+		pgoff_t *index, unsigned long orders)
+{
+	return NULL;
+}
+#endif /* CONFIG_TRANSPARENT_HUGEPAGE */
+
+static struct folio *shmem_alloc_and_add_folio(gfp_t gfp,
+		struct inode *inode, pgoff_t index,
+		struct mm_struct *fault_mm, unsigned long orders)
+{
+	struct address_space *mapping = inode->i_mapping;
+	struct shmem_inode_info *info = SHMEM_I(inode);
+	struct folio *folio;
+	long pages;
+	int error;
+
+	if (orders) {
+		folio = shmem_alloc_huge_folio(gfp, inode, &index, orders);
 		if (!folio)
-			count_vm_event(THP_FILE_FALLBACK);
+			return ERR_PTR(-E2BIG);
 	} else {
-		pages = 1;
-		folio = shmem_alloc_folio(gfp, info, index);
+		folio = shmem_alloc_folio(gfp, 0, info, index);
+		if (!folio)
+			return ERR_PTR(-ENOMEM);
 	}
-	if (!folio)
-		return ERR_PTR(-ENOMEM);
+	pages = folio_nr_pages(folio);
 
 	__folio_set_locked(folio);
 	__folio_set_swapbacked(folio);
@@ -1690,9 +1857,12 @@ static struct folio *shmem_alloc_and_add_folio(gfp_t gfp,
 		if (xa_find(&mapping->i_pages, &index,
 				index + pages - 1, XA_PRESENT)) {
 			error = -EEXIST;
-		} else if (huge) {
-			count_vm_event(THP_FILE_FALLBACK);
-			count_vm_event(THP_FILE_FALLBACK_CHARGE);
+		} else if (pages > 1) {
+			shmem_count_huge_fallback(folio_order(folio));
+			if (folio_test_pmd_mappable(folio))
+				count_vm_event(THP_FILE_FALLBACK_CHARGE);
+			count_mthp_stat(folio_order(folio),
+					MTHP_STAT_SHMEM_FALLBACK_CHARGE);
 		}
 		goto unlock;
 	}
@@ -1776,7 +1946,7 @@ static int shmem_replace_folio(struct folio **foliop, gfp_t gfp,
 	 */
 	gfp &= ~GFP_CONSTRAINT_MASK;
 	VM_BUG_ON_FOLIO(folio_test_large(old), old);
-	new = shmem_alloc_folio(gfp, info, index);
+	new = shmem_alloc_folio(gfp, 0, info, index);
 	if (!new)
 		return -ENOMEM;
 
@@ -1966,13 +2136,15 @@ static int shmem_swapin_folio(struct inode *inode, pgoff_t index,
  * entry since a page cannot live in both the swap and page cache.
  *
  * vmf and fault_type are only supplied by shmem_fault: otherwise they are NULL.
+ * write_end is the file offset a write or fallocate fills up to, or 0.
  */
 static int shmem_get_folio_gfp(struct inode *inode, pgoff_t index,
-		struct folio **foliop, enum sgp_type sgp, gfp_t gfp,
-		struct vm_fault *vmf, vm_fault_t *fault_type)
+		loff_t write_end, struct folio **foliop, enum sgp_type sgp,
+		gfp_t gfp, struct vm_fault *vmf, vm_fault_t *fault_type)
 {
 	struct vm_area_struct *vma = vmf ? vmf->vma : NULL;
 	struct mm_struct *fault_mm;
+	unsigned long orders;
 	struct folio *folio;
 	int error;
 	bool alloced;
@@ -2047,23 +2219,26 @@ static int shmem_get_folio_gfp(struct inode *inode, pgoff_t index,
 		return 0;
 	}
 
-	if (shmem_is_huge(inode, index, false, fault_mm,
-			  vma ? vma->vm_flags : 0)) {
+	orders = shmem_huge_orders(inode, index, write_end, vma);
+	if (orders) {
 		gfp_t huge_gfp;
 
 		huge_gfp = vma_thp_gfp_mask(vma);
 		huge_gfp = limit_gfp_mask(huge_gfp, gfp);
 		folio = shmem_alloc_and_add_folio(huge_gfp,
-				inode, index, fault_mm, true);
+				inode, index, fault_mm, orders);
 		if (!IS_ERR(folio)) {
-			count_vm_event(THP_FILE_ALLOC);
+			if (folio_test_pmd_mappable(folio))
+				count_vm_event(THP_FILE_ALLOC);
+			count_mthp_stat(folio_order(folio),
+					MTHP_STAT_SHMEM_ALLOC);
 			goto alloced;
 		}
 		if (PTR_ERR(folio) == -EEXIST)
 			goto repeat;
 	}
 
-	folio = shmem_alloc_and_add_folio(gfp, inode, index, fault_mm, false);
+	folio = shmem_alloc_and_add_folio(gfp, inode, index, fault_mm, 0);
 	if (IS_ERR(folio)) {
 		error = PTR_ERR(folio);
 		if (error == -EEXIST)
@@ -2074,7 +2249,7 @@ static int shmem_get_folio_gfp(struct inode *inode, pgoff_t index,
 
 alloced:
 	alloced = true;
-	if (folio_test_pmd_mappable(folio) &&
+	if (folio_test_large(folio) &&
 	    DIV_ROUND_UP(i_size_read(inode), PAGE_SIZE) <
 					folio_next_index(folio) - 1) {
 		struct shmem_sb_info *sbinfo = SHMEM_SB(inode->i_sb);
@@ -2168,7 +2343,7 @@ static int shmem_get_folio_gfp(struct inode *inode, pgoff_t index,
 int shmem_get_folio(struct inode *inode, pgoff_t index, struct folio **foliop,
 		enum sgp_type sgp)
 {
-	return shmem_get_folio_gfp(inode, index, foliop, sgp,
+	return shmem_get_folio_gfp(inode, index, 0, foliop, sgp,
 			mapping_gfp_mask(inode->i_mapping), NULL, NULL);
 }
 EXPORT_SYMBOL_GPL(shmem_get_folio);
@@ -2263,7 +2438,7 @@ static vm_fault_t shmem_fault(struct vm_fault *vmf)
 	}
 
 	WARN_ON_ONCE(vmf->page != NULL);
-	err = shmem_get_folio_gfp(inode, vmf->pgoff, &folio, SGP_CACHE,
+	err = shmem_get_folio_gfp(inode, vmf->pgoff, 0, &folio, SGP_CACHE,
 				  gfp, vmf, &ret);
 	if (err)
 		return vmf_error(err);
@@ -2644,7 +2819,7 @@ int shmem_mfill_atomic_pte(pmd_t *dst_pmd,
 
 	if (!*foliop) {
 		ret = -ENOMEM;
-		folio = shmem_alloc_folio(gfp, info, pgoff);
+		folio = shmem_alloc_folio(gfp, 0, info, pgoff);
 		if (!folio)
 			goto out_unacct_blocks;
 
@@ -2751,7 +2926,8 @@ shmem_write_begin(struct file *file, struct address_space *mapping,
 			return -EPERM;
 	}
 
-	ret = shmem_get_folio(inode, index, &folio, SGP_WRITE);
+	ret = shmem_get_folio_gfp(inode, index, pos + len, &folio, SGP_WRITE,
+			mapping_gfp_mask(mapping), NULL, NULL);
 	if (ret)
 		return ret;
 
@@ -3185,8 +3361,10 @@ static long shmem_fallocate(struct file *file, int mode, loff_t offset,
 		else if (shmem_falloc.nr_unswapped > shmem_falloc.nr_falloced)
 			error = -ENOMEM;
 		else
-			error = shmem_get_folio(inode, index, &folio,
-						SGP_FALLOC);
+			error = shmem_get_folio_gfp(inode, index, offset + len,
+					&folio, SGP_FALLOC,
+					mapping_gfp_mask(inode->i_mapping),
+					NULL, NULL);
 		if (error) {
 			info->fallocend = undo_fallocend;
 			/* Remove the !uptodate folios we added */
@@ -3887,6 +4065,7 @@ static const struct export_operations shmem_export_ops = {
 enum shmem_param {
 	Opt_gid,
 	Opt_huge,
+	Opt_huge_sizes,
 	Opt_mode,
 	Opt_mpol,
 	Opt_nr_blocks,
@@ -3916,6 +4095,7 @@ static const struct constant_table shmem_param_enums_huge[] = {
 const struct fs_parameter_spec shmem_fs_parameters[] = {
 	fsparam_u32   ("gid",		Opt_gid),
 	fsparam_enum  ("huge",		Opt_huge,  shmem_param_enums_huge),
+	fsparam_string("huge_sizes",	Opt_huge_sizes),
 	fsparam_u32oct("mode",		Opt_mode),
 	fsparam_string("mpol",		Opt_mpol),
 	fsparam_string("nr_blocks",	Opt_nr_blocks),
@@ -4016,6 +4196,14 @@ static int shmem_parse_one(struct fs_context *fc, struct fs_parameter *param)
 			goto unsupported_parameter;
 		ctx->seen |= SHMEM_SEEN_HUGE;
 		break;
+	case Opt_huge_sizes:
+		if (!(IS_ENABLED(CONFIG_TRANSPARENT_HUGEPAGE) &&
+		      has_transparent_hugepage()))
+			goto unsupported_parameter;
+		if (shmem_parse_huge_sizes(param->string, &ctx->huge_orders))
+			goto bad_value;
+		ctx->seen |= SHMEM_SEEN_HUGE_SIZES;
+		break;
 	case Opt_mpol:
 		if (IS_ENABLED(CONFIG_NUMA)) {
 			mpol_put(ctx->mpol);
@@ -4222,6 +4410,8 @@ static int shmem_reconfigure(struct fs_context *fc)
 
 	if (ctx->seen & SHMEM_SEEN_HUGE)
 		sbinfo->huge = ctx->huge;
+	if (ctx->seen & SHMEM_SEEN_HUGE_SIZES)
+		WRITE_ONCE(sbinfo->huge_orders, ctx->huge_orders);
 	if (ctx->seen & SHMEM_SEEN_INUMS)
 		sbinfo->full_inums = ctx->full_inums;
 	if (ctx->seen & SHMEM_SEEN_BLOCKS)
@@ -4295,6 +4485,8 @@ static int shmem_show_options(struct seq_file *seq, struct dentry *root)
 	/* Rightly or wrongly, show huge mount option unmasked by shmem_huge */
 	if (sbinfo->huge)
 		seq_printf(seq, ",huge=%s", shmem_format_huge(sbinfo->huge));
+	if (sbinfo->huge_orders)
+		shmem_show_huge_sizes(seq, sbinfo->huge_orders);
 #endif
 	mpol = shmem_get_sbmpol(sbinfo);
 	shmem_show_mpol(seq, mpol);
@@ -4388,6 +4580,7 @@ static int shmem_fill_super(struct super_block *sb, struct fs_context *fc)
 	sbinfo->full_inums = ctx->full_inums;
 	sbinfo->mode = ctx->mode;
 	sbinfo->huge = ctx->huge;
+	sbinfo->huge_orders = ctx->huge_orders;
 	sbinfo->mpol = ctx->mpol;
 	ctx->mpol = NULL;
 
@@ -4966,7 +5159,7 @@ struct folio *shmem_read_folio_gfp(struct address_space *mapping,
 	struct folio *folio;
 	int error;
 
-	error = shmem_get_folio_gfp(inode, index, &folio, SGP_CACHE,
+	error = shmem_get_folio_gfp(inode, index, 0, &folio, SGP_CACHE,
 				    gfp, NULL, NULL);
 	if (error)
 		return ERR_PTR(error);
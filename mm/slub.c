@@ -373,6 +373,10 @@ enum stat_item {
 	CPU_PARTIAL_FREE,	/* Refill cpu partial on free */
 	CPU_PARTIAL_NODE,	/* Refill cpu partial from node partial */
 	CPU_PARTIAL_DRAIN,	/* Drain cpu partial to node partial */
+	SHEAF_ALLOC,		/* Allocation from cpu sheaf */
+	SHEAF_FREE,		/* Free to cpu sheaf */
+	SHEAF_REFILL,		/* Refill of an empty cpu sheaf */
+	SHEAF_FLUSH,		/* Flush of a full cpu sheaf */
 	NR_SLUB_STAT_ITEMS
 };
 
@@ -398,6 +402,22 @@ struct kmem_cache_cpu {
 	unsigned int stat[NR_SLUB_STAT_ITEMS];
 #endif
 };
+
+/*
+ * Per cpu array of objects for SLAB_SHEAVES caches. Objects freed on any cpu
+ * are kept here and handed out again by allocations on that cpu, so that
+ * cross cpu alloc/free patterns don't end up in the __slab_free() slowpath.
+ * An empty sheaf is refilled and a full one is flushed SLUB_SHEAF_BATCH
+ * objects at a time.
+ */
+#define SLUB_SHEAF_CAPACITY	32
+#define SLUB_SHEAF_BATCH	(SLUB_SHEAF_CAPACITY / 2)
+
+struct slub_percpu_sheaf {
+	local_lock_t lock;	/* Protects the fields below */
+	unsigned int size;
+	void *objects[SLUB_SHEAF_CAPACITY];
+};
 #endif /* CONFIG_SLUB_TINY */
 
 static inline void stat(const struct kmem_cache *s, enum stat_item si)
@@ -3080,6 +3100,124 @@ static inline void put_partials_cpu(struct kmem_cache *s,
 
 #endif	/* CONFIG_SLUB_CPU_PARTIAL */
 
+static int __kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags,
+				   size_t size, void **p);
+static void __kmem_cache_free_bulk(struct kmem_cache *s, size_t size, void **p);
+
+static inline bool cache_has_sheaf(struct kmem_cache *s)
+{
+	return s->cpu_sheaf;
+}
+
+/*
+ * Objects in the sheaf went through the free hooks already and are handed
+ * out again through the alloc hooks, just like objects on a freelist.
+ */
+static void *alloc_from_sheaf(struct kmem_cache *s, gfp_t gfpflags)
+{
+	struct slub_percpu_sheaf *sheaf;
+	void *batch[SLUB_SHEAF_BATCH];
+	unsigned long flags;
+	void *object = NULL;
+	int nr;
+
+	local_lock_irqsave(&s->cpu_sheaf->lock, flags);
+	sheaf = this_cpu_ptr(s->cpu_sheaf);
+	if (likely(sheaf->size))
+		object = sheaf->objects[--sheaf->size];
+	local_unlock_irqrestore(&s->cpu_sheaf->lock, flags);
+
+	if (likely(object)) {
+		stat(s, SHEAF_ALLOC);
+		return object;
+	}
+
+	/* Refill, the last object of the batch is for the caller. */
+	nr = __kmem_cache_alloc_bulk(s, gfpflags, SLUB_SHEAF_BATCH, batch);
+	if (!nr)
+		return NULL;
+	object = batch[--nr];
+
+	local_lock_irqsave(&s->cpu_sheaf->lock, flags);
+	sheaf = this_cpu_ptr(s->cpu_sheaf);
+	while (nr && sheaf->size < SLUB_SHEAF_CAPACITY)
+		sheaf->objects[sheaf->size++] = batch[--nr];
+	local_unlock_irqrestore(&s->cpu_sheaf->lock, flags);
+
+	/* Somebody refilled the sheaf while we were allocating. */
+	__kmem_cache_free_bulk(s, nr, batch);
+	stat(s, SHEAF_REFILL);
+
+	return object;
+}
+
+static bool free_to_sheaf(struct kmem_cache *s, struct slab *slab,
+			  void *object)
+{
+	struct slub_percpu_sheaf *sheaf;
+	void *batch[SLUB_SHEAF_BATCH];
+	unsigned long flags;
+	bool flush = false;
+
+	/*
+	 * pfmemalloc objects must go back to their slab so they are not
+	 * handed out to allocations without access to the reserves.
+	 */
+	if (unlikely(slab_test_pfmemalloc(slab) || is_kfence_address(object)))
+		return false;
+
+	local_lock_irqsave(&s->cpu_sheaf->lock, flags);
+	sheaf = this_cpu_ptr(s->cpu_sheaf);
+	if (unlikely(sheaf->size == SLUB_SHEAF_CAPACITY)) {
+		sheaf->size -= SLUB_SHEAF_BATCH;
+		memcpy(batch, &sheaf->objects[sheaf->size], sizeof(batch));
+		flush = true;
+	}
+	sheaf->objects[sheaf->size++] = object;
+	local_unlock_irqrestore(&s->cpu_sheaf->lock, flags);
+
+	stat(s, SHEAF_FREE);
+	if (unlikely(flush)) {
+		__kmem_cache_free_bulk(s, SLUB_SHEAF_BATCH, batch);
+		stat(s, SHEAF_FLUSH);
+	}
+
+	return true;
+}
+
+static void flush_sheaf(struct kmem_cache *s)
+{
+	struct slub_percpu_sheaf *sheaf;
+	void *objects[SLUB_SHEAF_CAPACITY];
+	unsigned long flags;
+	unsigned int nr;
+
+	if (!cache_has_sheaf(s))
+		return;
+
+	local_lock_irqsave(&s->cpu_sheaf->lock, flags);
+	sheaf = this_cpu_ptr(s->cpu_sheaf);
+	nr = sheaf->size;
+	memcpy(objects, sheaf->objects, nr * sizeof(void *));
+	sheaf->size = 0;
+	local_unlock_irqrestore(&s->cpu_sheaf->lock, flags);
+
+	__kmem_cache_free_bulk(s, nr, objects);
+}
+
+/* For a cpu that went away, so no locking is needed. */
+static void __flush_sheaf(struct kmem_cache *s, int cpu)
+{
+	struct slub_percpu_sheaf *sheaf;
+
+	if (!cache_has_sheaf(s))
+		return;
+
+	sheaf = per_cpu_ptr(s->cpu_sheaf, cpu);
+	__kmem_cache_free_bulk(s, sheaf->size, sheaf->objects);
+	sheaf->size = 0;
+}
+
 static inline void flush_slab(struct kmem_cache *s, struct kmem_cache_cpu *c)
 {
 	unsigned long flags;
@@ -3106,8 +3244,13 @@ static inline void flush_slab(struct kmem_cache *s, struct kmem_cache_cpu *c)
 static inline void __flush_cpu_slab(struct kmem_cache *s, int cpu)
 {
 	struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
-	void *freelist = c->freelist;
-	struct slab *slab = c->slab;
+	void *freelist;
+	struct slab *slab;
+
+	__flush_sheaf(s, cpu);
+
+	freelist = c->freelist;
+	slab = c->slab;
 
 	c->slab = NULL;
 	c->freelist = NULL;
@@ -3141,8 +3284,10 @@ static void flush_cpu_slab(struct work_struct *w)
 	sfw = container_of(w, struct slub_flush_work, work);
 
 	s = sfw->s;
-	c = this_cpu_ptr(s->cpu_slab);
 
+	flush_sheaf(s);
+
+	c = this_cpu_ptr(s->cpu_slab);
 	if (c->slab)
 		flush_slab(s, c);
 
@@ -3153,6 +3298,9 @@ static bool has_cpu_slab(int cpu, struct kmem_cache *s)
 {
 	struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
 
+	if (cache_has_sheaf(s) && READ_ONCE(per_cpu_ptr(s->cpu_sheaf, cpu)->size))
+		return true;
+
 	return c->slab || slub_percpu_partial(c);
 }
 
@@ -3212,6 +3360,16 @@ static int slub_cpu_dead(unsigned int cpu)
 }
 
 #else /* CONFIG_SLUB_TINY */
+static inline bool cache_has_sheaf(struct kmem_cache *s) { return false; }
+static inline void *alloc_from_sheaf(struct kmem_cache *s, gfp_t gfpflags)
+{
+	return NULL;
+}
+static inline bool free_to_sheaf(struct kmem_cache *s, struct slab *slab,
+				 void *object)
+{
+	return false;
+}
 static inline void flush_all_cpus_locked(struct kmem_cache *s) { }
 static inline void flush_all(struct kmem_cache *s) { }
 static inline void __flush_cpu_slab(struct kmem_cache *s, int cpu) { }
@@ -3987,7 +4145,10 @@ static __fastpath_inline void *slab_alloc_node(struct kmem_cache *s, struct list
 	if (unlikely(object))
 		goto out;
 
-	object = __slab_alloc_node(s, gfpflags, node, addr, orig_size);
+	if (cache_has_sheaf(s) && node == NUMA_NO_NODE)
+		object = alloc_from_sheaf(s, gfpflags);
+	if (!object)
+		object = __slab_alloc_node(s, gfpflags, node, addr, orig_size);
 
 	maybe_wipe_obj_freeptr(s, object);
 	init = slab_want_init_on_alloc(gfpflags, s);
@@ -4435,8 +4596,11 @@ void slab_free(struct kmem_cache *s, struct slab *slab, void *object,
 	memcg_slab_free_hook(s, slab, &object, 1);
 	alloc_tagging_slab_free_hook(s, slab, &object, 1);
 
-	if (likely(slab_free_hook(s, object, slab_want_init_on_free(s))))
+	if (likely(slab_free_hook(s, object, slab_want_init_on_free(s)))) {
+		if (cache_has_sheaf(s) && free_to_sheaf(s, slab, object))
+			return;
 		do_slab_free(s, slab, object, object, 1, addr);
+	}
 }
 
 #ifdef CONFIG_MEMCG_KMEM
@@ -4974,6 +5138,18 @@ static inline int alloc_kmem_cache_cpus(struct kmem_cache *s)
 
 	init_kmem_cache_cpus(s);
 
+	/* Debugging needs every object to go through the slowpaths. */
+	if ((s->flags & SLAB_SHEAVES) && !kmem_cache_debug(s)) {
+		int cpu;
+
+		s->cpu_sheaf = alloc_percpu(struct slub_percpu_sheaf);
+		if (!s->cpu_sheaf)
+			return 0;
+
+		for_each_possible_cpu(cpu)
+			local_lock_init(&per_cpu_ptr(s->cpu_sheaf, cpu)->lock);
+	}
+
 	return 1;
 }
 #else
@@ -5043,6 +5219,7 @@ void __kmem_cache_release(struct kmem_cache *s)
 {
 	cache_random_seq_destroy(s);
 #ifndef CONFIG_SLUB_TINY
+	free_percpu(s->cpu_sheaf);
 	free_percpu(s->cpu_slab);
 #endif
 	free_kmem_cache_nodes(s);
@@ -6432,6 +6609,32 @@ static ssize_t slabs_cpu_partial_show(struct kmem_cache *s, char *buf)
 }
 SLAB_ATTR_RO(slabs_cpu_partial);
 
+#ifndef CONFIG_SLUB_TINY
+static ssize_t sheaf_objects_show(struct kmem_cache *s, char *buf)
+{
+	unsigned int objects = 0, nr;
+	int cpu, len = 0;
+
+	if (!cache_has_sheaf(s))
+		return sysfs_emit(buf, "0\n");
+
+	for_each_online_cpu(cpu)
+		objects += data_race(per_cpu_ptr(s->cpu_sheaf, cpu)->size);
+
+	len += sysfs_emit_at(buf, len, "%u", objects);
+
+	for_each_online_cpu(cpu) {
+		nr = data_race(per_cpu_ptr(s->cpu_sheaf, cpu)->size);
+		if (nr)
+			len += sysfs_emit_at(buf, len, " C%d=%u", cpu, nr);
+	}
+	len += sysfs_emit_at(buf, len, "\n");
+
+	return len;
+}
+SLAB_ATTR_RO(sheaf_objects);
+#endif
+
 static ssize_t reclaim_account_show(struct kmem_cache *s, char *buf)
 {
 	return sysfs_emit(buf, "%d\n", !!(s->flags & SLAB_RECLAIM_ACCOUNT));
@@ -6684,6 +6887,10 @@ STAT_ATTR(CPU_PARTIAL_ALLOC, cpu_partial_alloc);
 STAT_ATTR(CPU_PARTIAL_FREE, cpu_partial_free);
 STAT_ATTR(CPU_PARTIAL_NODE, cpu_partial_node);
 STAT_ATTR(CPU_PARTIAL_DRAIN, cpu_partial_drain);
+STAT_ATTR(SHEAF_ALLOC, sheaf_alloc);
+STAT_ATTR(SHEAF_FREE, sheaf_free);
+STAT_ATTR(SHEAF_REFILL, sheaf_refill);
+STAT_ATTR(SHEAF_FLUSH, sheaf_flush);
 #endif	/* CONFIG_SLUB_STATS */
 
 #ifdef CONFIG_KFENCE
@@ -6727,6 +6934,9 @@ static struct attribute *slab_attrs[] = {
 	&destroy_by_rcu_attr.attr,
 	&shrink_attr.attr,
 	&slabs_cpu_partial_attr.attr,
+#ifndef CONFIG_SLUB_TINY
+	&sheaf_objects_attr.attr,
+#endif
 #ifdef CONFIG_SLUB_DEBUG
 	&total_objects_attr.attr,
 	&objects_attr.attr,
@@ -6771,6 +6981,10 @@ static struct attribute *slab_attrs[] = {
 	&cpu_partial_free_attr.attr,
 	&cpu_partial_node_attr.attr,
 	&cpu_partial_drain_attr.attr,
+	&sheaf_alloc_attr.attr,
+	&sheaf_free_attr.attr,
+	&sheaf_refill_attr.attr,
+	&sheaf_flush_attr.attr,
 #endif
 #ifdef CONFIG_FAILSLAB
 	&failslab_attr.attr,
@@ -697,44 +697,25 @@ static __always_inline ssize_t mfill_atomic_pte(pmd_t *dst_pmd,
 	return err;
 }
 
-static __always_inline ssize_t mfill_atomic(struct userfaultfd_ctx *ctx,
-					    unsigned long dst_start,
-					    unsigned long src_start,
-					    unsigned long len,
-					    uffd_flags_t flags)
+/*
+ * Lock the vma covering @dst_start and @len and check that it can be filled
+ * with @flags.  On success the vma and ctx->map_changing_lock are held.
+ */
+static struct vm_area_struct *mfill_atomic_lock(struct userfaultfd_ctx *ctx,
+						unsigned long dst_start,
+						unsigned long len,
+						uffd_flags_t flags)
 {
-	struct mm_struct *dst_mm = ctx->mm;
 	struct vm_area_struct *dst_vma;
 	ssize_t err;
-	pmd_t *dst_pmd;
-	unsigned long src_addr, dst_addr;
-	long copied;
-	struct folio *folio;
 
-	/*
-	 * Sanitize the command parameters:
-	 */
-	BUG_ON(dst_start & ~PAGE_MASK);
-	BUG_ON(len & ~PAGE_MASK);
-
-	/* Does the address range wrap, or is the span zero-sized? */
-	BUG_ON(src_start + len <= src_start);
-	BUG_ON(dst_start + len <= dst_start);
-
-	src_addr = src_start;
-	dst_addr = dst_start;
-	copied = 0;
-	folio = NULL;
-retry:
 	/*
 	 * Make sure the vma is not shared, that the dst range is
 	 * both valid and fully within a single existing vma.
 	 */
-	dst_vma = uffd_mfill_lock(dst_mm, dst_start, len);
-	if (IS_ERR(dst_vma)) {
-		err = PTR_ERR(dst_vma);
-		goto out;
-	}
+	dst_vma = uffd_mfill_lock(ctx->mm, dst_start, len);
+	if (IS_ERR(dst_vma))
+		return dst_vma;
 
 	/*
 	 * If memory mappings are changing because of non-cooperative
@@ -762,12 +743,9 @@ static __always_inline ssize_t mfill_atomic(struct userfaultfd_ctx *ctx,
 	if ((flags & MFILL_ATOMIC_WP) && !(dst_vma->vm_flags & VM_UFFD_WP))
 		goto out_unlock;
 
-	/*
-	 * If this is a HUGETLB vma, pass off to appropriate routine
-	 */
+	/* HUGETLB vmas are passed off to their own routine */
 	if (is_vm_hugetlb_page(dst_vma))
-		return  mfill_atomic_hugetlb(ctx, dst_vma, dst_start,
-					     src_start, len, flags);
+		return dst_vma;
 
 	if (!vma_is_anonymous(dst_vma) && !vma_is_shmem(dst_vma))
 		goto out_unlock;
@@ -775,80 +753,180 @@ static __always_inline ssize_t mfill_atomic(struct userfaultfd_ctx *ctx,
 	    uffd_flags_mode_is(flags, MFILL_ATOMIC_CONTINUE))
 		goto out_unlock;
 
-	while (src_addr < src_start + len) {
-		pmd_t dst_pmdval;
+	return dst_vma;
 
-		BUG_ON(dst_addr >= dst_start + len);
+out_unlock:
+	up_read(&ctx->map_changing_lock);
+	uffd_mfill_unlock(dst_vma);
+	return ERR_PTR(err);
+}
 
-		dst_pmd = mm_alloc_pmd(dst_mm, dst_addr);
-		if (unlikely(!dst_pmd)) {
-			err = -ENOMEM;
-			break;
-		}
+static void mfill_atomic_unlock(struct userfaultfd_ctx *ctx,
+				struct vm_area_struct *dst_vma)
+{
+	up_read(&ctx->map_changing_lock);
+	uffd_mfill_unlock(dst_vma);
+}
+
+/*
+ * Fill the ranges of @iov in order.  The vma stays locked as long as the
+ * following ranges fall into it, so a batch of faults resolved in the same
+ * mapping only looks up and locks the vma once.
+ *
+ * Returns the number of bytes filled, which only covers a leading part of
+ * the ranges if an error was hit, or the error if nothing was filled.
+ */
+static __always_inline ssize_t mfill_atomic(struct userfaultfd_ctx *ctx,
+					    const struct uffdio_iovec *iov,
+					    unsigned long nr_iov,
+					    uffd_flags_t flags)
+{
+	struct mm_struct *dst_mm = ctx->mm;
+	struct vm_area_struct *dst_vma = NULL;
+	ssize_t err = 0;
+	pmd_t *dst_pmd;
+	unsigned long dst_start, src_start, len;
+	unsigned long src_addr, dst_addr;
+	unsigned long i;
+	long copied;
+	struct folio *folio;
+
+	copied = 0;
+	folio = NULL;
+	for (i = 0; i < nr_iov; i++) {
+		dst_start = iov[i].dst;
+		src_start = iov[i].src;
+		len = iov[i].len;
 
-		dst_pmdval = pmdp_get_lockless(dst_pmd);
 		/*
-		 * If the dst_pmd is mapped as THP don't
-		 * override it and just be strict.
+		 * Sanitize the command parameters:
 		 */
-		if (unlikely(pmd_trans_huge(dst_pmdval))) {
-			err = -EEXIST;
-			break;
-		}
-		if (unlikely(pmd_none(dst_pmdval)) &&
-		    unlikely(__pte_alloc(dst_mm, dst_pmd))) {
-			err = -ENOMEM;
-			break;
+		BUG_ON(dst_start & ~PAGE_MASK);
+		BUG_ON(len & ~PAGE_MASK);
+
+		/* Does the address range wrap, or is the span zero-sized? */
+		BUG_ON(src_start + len <= src_start);
+		BUG_ON(dst_start + len <= dst_start);
+
+		src_addr = src_start;
+		dst_addr = dst_start;
+
+		if (dst_vma && (dst_start < dst_vma->vm_start ||
+				!validate_dst_vma(dst_vma, dst_start + len))) {
+			mfill_atomic_unlock(ctx, dst_vma);
+			dst_vma = NULL;
 		}
-		/* If an huge pmd materialized from under us fail */
-		if (unlikely(pmd_trans_huge(*dst_pmd))) {
-			err = -EFAULT;
-			break;
+retry:
+		if (!dst_vma) {
+			dst_vma = mfill_atomic_lock(ctx, dst_start, len, flags);
+			if (IS_ERR(dst_vma)) {
+				err = PTR_ERR(dst_vma);
+				dst_vma = NULL;
+				break;
+			}
 		}
 
-		BUG_ON(pmd_none(*dst_pmd));
-		BUG_ON(pmd_trans_huge(*dst_pmd));
+		/*
+		 * If this is a HUGETLB vma, pass off to appropriate routine,
+		 * which drops the locks.
+		 */
+		if (is_vm_hugetlb_page(dst_vma)) {
+			unsigned long left = dst_start + len - dst_addr;
 
-		err = mfill_atomic_pte(dst_pmd, dst_vma, dst_addr,
-				       src_addr, flags, &folio);
-		cond_resched();
+			if (folio) {
+				folio_put(folio);
+				folio = NULL;
+			}
+			err = mfill_atomic_hugetlb(ctx, dst_vma, dst_addr,
+						   src_addr, left, flags);
+			dst_vma = NULL;
+			if (err < 0)
+				break;
+			copied += err;
+			if (err != left) {
+				err = 0;
+				break;
+			}
+			err = 0;
+			continue;
+		}
 
-		if (unlikely(err == -ENOENT)) {
-			void *kaddr;
+		while (src_addr < src_start + len) {
+			pmd_t dst_pmdval;
 
-			up_read(&ctx->map_changing_lock);
-			uffd_mfill_unlock(dst_vma);
-			BUG_ON(!folio);
+			BUG_ON(dst_addr >= dst_start + len);
 
-			kaddr = kmap_local_folio(folio, 0);
-			err = copy_from_user(kaddr,
-					     (const void __user *) src_addr,
-					     PAGE_SIZE);
-			kunmap_local(kaddr);
-			if (unlikely(err)) {
+			dst_pmd = mm_alloc_pmd(dst_mm, dst_addr);
+			if (unlikely(!dst_pmd)) {
+				err = -ENOMEM;
+				break;
+			}
+
+			dst_pmdval = pmdp_get_lockless(dst_pmd);
+			/*
+			 * If the dst_pmd is mapped as THP don't
+			 * override it and just be strict.
+			 */
+			if (unlikely(pmd_trans_huge(dst_pmdval))) {
+				err = -EEXIST;
+				break;
+			}
+			if (unlikely(pmd_none(dst_pmdval)) &&
+			    unlikely(__pte_alloc(dst_mm, dst_pmd))) {
+				err = -ENOMEM;
+				break;
+			}
+			/* If an huge pmd materialized from under us fail */
+			if (unlikely(pmd_trans_huge(*dst_pmd))) {
 				err = -EFAULT;
-				goto out;
+				break;
 			}
-			flush_dcache_folio(folio);
-			goto retry;
-		} else
-			BUG_ON(folio);
 
-		if (!err) {
-			dst_addr += PAGE_SIZE;
-			src_addr += PAGE_SIZE;
-			copied += PAGE_SIZE;
+			BUG_ON(pmd_none(*dst_pmd));
+			BUG_ON(pmd_trans_huge(*dst_pmd));
 
-			if (fatal_signal_pending(current))
-				err = -EINTR;
+			err = mfill_atomic_pte(dst_pmd, dst_vma, dst_addr,
+					       src_addr, flags, &folio);
+			cond_resched();
+
+			if (unlikely(err == -ENOENT)) {
+				void *kaddr;
+
+				mfill_atomic_unlock(ctx, dst_vma);
+				dst_vma = NULL;
+				BUG_ON(!folio);
+
+				kaddr = kmap_local_folio(folio, 0);
+				err = copy_from_user(kaddr,
+						     (const void __user *) src_addr,
+						     PAGE_SIZE);
+				kunmap_local(kaddr);
+				if (unlikely(err)) {
+					err = -EFAULT;
+					goto out;
+				}
+				flush_dcache_folio(folio);
+				goto retry;
+			} else
+				BUG_ON(folio);
+
+			if (!err) {
+				dst_addr += PAGE_SIZE;
+				src_addr += PAGE_SIZE;
+				copied += PAGE_SIZE;
+
+				if (fatal_signal_pending(current))
+					err = -EINTR;
+			}
+			if (err)
+				break;
 		}
 		if (err)
 			break;
 	}
 
-out_unlock:
-	up_read(&ctx->map_changing_lock);
-	uffd_mfill_unlock(dst_vma);
+	if (dst_vma)
+		mfill_atomic_unlock(ctx, dst_vma);
 out:
 	if (folio)
 		folio_put(folio);
@@ -862,7 +940,19 @@ ssize_t mfill_atomic_copy(struct userfaultfd_ctx *ctx, unsigned long dst_start,
 			  unsigned long src_start, unsigned long len,
 			  uffd_flags_t flags)
 {
-	return mfill_atomic(ctx, dst_start, src_start, len,
+	struct uffdio_iovec iov = {
+		.dst = dst_start, .src = src_start, .len = len,
+	};
+
+	return mfill_atomic(ctx, &iov, 1,
+			    uffd_flags_set_mode(flags, MFILL_ATOMIC_COPY));
+}
+
+ssize_t mfill_atomic_copy_vec(struct userfaultfd_ctx *ctx,
+			      const struct uffdio_iovec *iov,
+			      unsigned long nr_iov, uffd_flags_t flags)
+{
+	return mfill_atomic(ctx, iov, nr_iov,
 			    uffd_flags_set_mode(flags, MFILL_ATOMIC_COPY));
 }
 
@@ -870,12 +960,15 @@ ssize_t mfill_atomic_zeropage(struct userfaultfd_ctx *ctx,
 			      unsigned long start,
 			      unsigned long len)
 {
-	return mfill_atomic(ctx, start, 0, len,
+	struct uffdio_iovec iov = { .dst = start, .len = len };
+
+	return mfill_atomic(ctx, &iov, 1,
 			    uffd_flags_set_mode(0, MFILL_ATOMIC_ZEROPAGE));
 }
 
-ssize_t mfill_atomic_continue(struct userfaultfd_ctx *ctx, unsigned long start,
-			      unsigned long len, uffd_flags_t flags)
+ssize_t mfill_atomic_continue_vec(struct userfaultfd_ctx *ctx,
+				  const struct uffdio_iovec *iov,
+				  unsigned long nr_iov, uffd_flags_t flags)
 {
 
 	/*
@@ -886,14 +979,24 @@ ssize_t mfill_atomic_continue(struct userfaultfd_ctx *ctx, unsigned long start,
 	 */
 	smp_wmb();
 
-	return mfill_atomic(ctx, start, 0, len,
+	return mfill_atomic(ctx, iov, nr_iov,
 			    uffd_flags_set_mode(flags, MFILL_ATOMIC_CONTINUE));
 }
 
+ssize_t mfill_atomic_continue(struct userfaultfd_ctx *ctx, unsigned long start,
+			      unsigned long len, uffd_flags_t flags)
+{
+	struct uffdio_iovec iov = { .dst = start, .len = len };
+
+	return mfill_atomic_continue_vec(ctx, &iov, 1, flags);
+}
+
 ssize_t mfill_atomic_poison(struct userfaultfd_ctx *ctx, unsigned long start,
 			    unsigned long len, uffd_flags_t flags)
 {
-	return mfill_atomic(ctx, start, 0, len,
+	struct uffdio_iovec iov = { .dst = start, .len = len };
+
+	return mfill_atomic(ctx, &iov, 1,
 			    uffd_flags_set_mode(flags, MFILL_ATOMIC_POISON));
 }
 
@@ -18,6 +18,7 @@
 #include <linux/interrupt.h>
 #include <linux/proc_fs.h>
 #include <linux/seq_file.h>
+#include <linux/debugfs.h>
 #include <linux/set_memory.h>
 #include <linux/debugobjects.h>
 #include <linux/kallsyms.h>
@@ -809,6 +810,7 @@ EXPORT_SYMBOL(vmalloc_to_pfn);
 
 
 static DEFINE_SPINLOCK(free_vmap_area_lock);
+static atomic_long_t free_vmap_area_lock_contended;
 static bool vmap_initialized __read_mostly;
 
 /*
@@ -863,9 +865,18 @@ struct rb_list {
  */
 #define MAX_VA_SIZE_PAGES 256
 
+/*
+ * Bigger VAs are kept in a handful of extra pools which are bound to one
+ * exact size on demand. A pool that runs empty can be rebound, so these
+ * follow whatever large sizes are popular at the moment.
+ */
+#define NR_LARGE_VA_POOLS 8
+#define NR_VA_POOLS (MAX_VA_SIZE_PAGES + NR_LARGE_VA_POOLS)
+
 struct vmap_pool {
 	struct list_head head;
 	unsigned long len;
+	unsigned long size;
 };
 
 /*
@@ -875,10 +886,14 @@ struct vmap_pool {
  */
 static struct vmap_node {
 	/* Simple size segregated storage. */
-	struct vmap_pool pool[MAX_VA_SIZE_PAGES];
+	struct vmap_pool pool[NR_VA_POOLS];
 	spinlock_t pool_lock;
 	bool skip_populate;
 
+	/* Allocations served from or missed in the pools. */
+	atomic_long_t pool_hit;
+	atomic_long_t pool_miss;
+
 	/* Bookkeeping data of this node. */
 	struct rb_list busy;
 	struct rb_list lazy;
@@ -1813,10 +1828,14 @@ static void free_vmap_area(struct vmap_area *va)
 	spin_unlock(&free_vmap_area_lock);
 }
 
-static inline void
+/*
+ * Returns true if the lock was contended.
+ */
+static inline bool
 preload_this_cpu_lock(spinlock_t *lock, gfp_t gfp_mask, int node)
 {
 	struct vmap_area *va = NULL;
+	bool contended = false;
 
 	/*
 	 * Preload this CPU with one extra vmap_area object. It is used
@@ -1830,38 +1849,75 @@ preload_this_cpu_lock(spinlock_t *lock, gfp_t gfp_mask, int node)
 	if (!this_cpu_read(ne_fit_preload_node))
 		va = kmem_cache_alloc_node(vmap_area_cachep, gfp_mask, node);
 
-	spin_lock(lock);
+	if (!spin_trylock(lock)) {
+		contended = true;
+		spin_lock(lock);
+	}
 
 	if (va && __this_cpu_cmpxchg(ne_fit_preload_node, NULL, va))
 		kmem_cache_free(vmap_area_cachep, va);
+
+	return contended;
 }
 
 static struct vmap_pool *
 size_to_va_pool(struct vmap_node *vn, unsigned long size)
 {
 	unsigned int idx = (size - 1) / PAGE_SIZE;
+	int i;
 
 	if (idx < MAX_VA_SIZE_PAGES)
 		return &vn->pool[idx];
 
+	for (i = MAX_VA_SIZE_PAGES; i < NR_VA_POOLS; i++)
+		if (READ_ONCE(vn->pool[i].size) == size)
+			return &vn->pool[i];
+
+	return NULL;
+}
+
+/*
+ * Bind an empty large pool to the given size. A pool that is being
+ * decayed is detached but still accounted in "len", so it is skipped.
+ */
+static struct vmap_pool *
+claim_large_va_pool(struct vmap_node *vn, unsigned long size)
+{
+	struct vmap_pool *vp;
+	int i;
+
+	lockdep_assert_held(&vn->pool_lock);
+
+	for (i = MAX_VA_SIZE_PAGES; i < NR_VA_POOLS; i++) {
+		vp = &vn->pool[i];
+
+		if (!vp->len && list_empty(&vp->head)) {
+			WRITE_ONCE(vp->size, size);
+			return vp;
+		}
+	}
+
 	return NULL;
 }
 
 static bool
 node_pool_add_va(struct vmap_node *n, struct vmap_area *va)
 {
+	unsigned long size = va_size(va);
 	struct vmap_pool *vp;
 
-	vp = size_to_va_pool(n, va_size(va));
+	spin_lock(&n->pool_lock);
+	vp = size_to_va_pool(n, size);
 	if (!vp)
-		return false;
+		vp = claim_large_va_pool(n, size);
 
-	spin_lock(&n->pool_lock);
-	list_add(&va->list, &vp->head);
-	WRITE_ONCE(vp->len, vp->len + 1);
+	if (vp) {
+		list_add(&va->list, &vp->head);
+		WRITE_ONCE(vp->len, vp->len + 1);
+	}
 	spin_unlock(&n->pool_lock);
 
-	return true;
+	return vp != NULL;
 }
 
 static struct vmap_area *
@@ -1878,7 +1934,8 @@ node_pool_del_va(struct vmap_node *vn, unsigned long size,
 		return NULL;
 
 	spin_lock(&vn->pool_lock);
-	if (!list_empty(&vp->head)) {
+	/* A large pool may have been rebound to another size meanwhile. */
+	if (!list_empty(&vp->head) && vp->size == size) {
 		va = list_first_entry(&vp->head, struct vmap_area, list);
 
 		if (IS_ALIGNED(va->va_start, align)) {
@@ -1911,6 +1968,7 @@ node_alloc(unsigned long size, unsigned long align,
 		unsigned long vstart, unsigned long vend,
 		unsigned long *addr, unsigned int *vn_id)
 {
+	struct vmap_node *vn;
 	struct vmap_area *va;
 
 	*vn_id = 0;
@@ -1925,11 +1983,16 @@ node_alloc(unsigned long size, unsigned long align,
 		return NULL;
 
 	*vn_id = raw_smp_processor_id() % nr_vmap_nodes;
-	va = node_pool_del_va(id_to_node(*vn_id), size, align, vstart, vend);
+	vn = id_to_node(*vn_id);
+	va = node_pool_del_va(vn, size, align, vstart, vend);
 	*vn_id = encode_vn_id(*vn_id);
 
-	if (va)
+	if (va) {
 		*addr = va->va_start;
+		atomic_long_inc(&vn->pool_hit);
+	} else {
+		atomic_long_inc(&vn->pool_miss);
+	}
 
 	return va;
 }
@@ -1995,7 +2058,8 @@ static struct vmap_area *alloc_vmap_area(unsigned long size,
 
 retry:
 	if (addr == vend) {
-		preload_this_cpu_lock(&free_vmap_area_lock, gfp_mask, node);
+		if (preload_this_cpu_lock(&free_vmap_area_lock, gfp_mask, node))
+			atomic_long_inc(&free_vmap_area_lock_contended);
 		addr = __alloc_vmap_area(&free_vmap_area_root, &free_vmap_area_list,
 			size, align, vstart, vend);
 		spin_unlock(&free_vmap_area_lock);
@@ -2139,7 +2203,7 @@ decay_va_pool_node(struct vmap_node *vn, bool full_decay)
 	decay_root = RB_ROOT;
 	INIT_LIST_HEAD(&decay_list);
 
-	for (i = 0; i < MAX_VA_SIZE_PAGES; i++) {
+	for (i = 0; i < NR_VA_POOLS; i++) {
 		struct list_head tmp_list;
 
 		if (list_empty(&vn->pool[i].head))
@@ -4967,6 +5031,48 @@ module_init(proc_vmalloc_init);
 
 #endif
 
+#ifdef CONFIG_DEBUG_FS
+static int vmap_pools_show(struct seq_file *m, void *p)
+{
+	struct vmap_node *vn;
+	struct vmap_pool *vp;
+	unsigned long len;
+	int i, j;
+
+	seq_printf(m, "free_vmap_area_lock contended: %ld\n",
+		   atomic_long_read(&free_vmap_area_lock_contended));
+
+	for (i = 0; i < nr_vmap_nodes; i++) {
+		vn = &vmap_nodes[i];
+
+		for (len = 0, j = 0; j < MAX_VA_SIZE_PAGES; j++)
+			len += READ_ONCE(vn->pool[j].len);
+
+		seq_printf(m, "node %d: hit %ld miss %ld small %lu",
+			   i, atomic_long_read(&vn->pool_hit),
+			   atomic_long_read(&vn->pool_miss), len);
+
+		for (j = MAX_VA_SIZE_PAGES; j < NR_VA_POOLS; j++) {
+			vp = &vn->pool[j];
+			len = READ_ONCE(vp->len);
+			if (len)
+				seq_printf(m, " %lu:%lu", READ_ONCE(vp->size), len);
+		}
+		seq_putc(m, '\n');
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(vmap_pools);
+
+static int __init vmalloc_debugfs_init(void)
+{
+	debugfs_create_file("vmap_pools", 0400, NULL, NULL, &vmap_pools_fops);
+	return 0;
+}
+late_initcall(vmalloc_debugfs_init);
+#endif
+
 static void __init vmap_init_free_space(void)
 {
 	unsigned long vmap_start = 1;
@@ -5054,9 +5160,12 @@ static void vmap_init_nodes(void)
 		INIT_LIST_HEAD(&vn->lazy.head);
 		spin_lock_init(&vn->lazy.lock);
 
-		for (i = 0; i < MAX_VA_SIZE_PAGES; i++) {
+		for (i = 0; i < NR_VA_POOLS; i++) {
 			INIT_LIST_HEAD(&vn->pool[i].head);
 			WRITE_ONCE(vn->pool[i].len, 0);
+			/* Large pools are bound on first use. */
+			vn->pool[i].size = i < MAX_VA_SIZE_PAGES ?
+				(i + 1) * PAGE_SIZE : 0;
 		}
 
 		spin_lock_init(&vn->pool_lock);
@@ -5073,7 +5182,7 @@ vmap_node_shrink_count(struct shrinker *shrink, struct shrink_control *sc)
 	for (count = 0, i = 0; i < nr_vmap_nodes; i++) {
 		vn = &vmap_nodes[i];
 
-		for (j = 0; j < MAX_VA_SIZE_PAGES; j++)
+		for (j = 0; j < NR_VA_POOLS; j++)
 			count += READ_ONCE(vn->pool[j].len);
 	}
 
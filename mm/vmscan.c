@@ -947,6 +947,26 @@ static struct folio *alloc_demote_folio(struct folio *src,
 	return alloc_migration_target(src, (unsigned long)mtc);
 }
 
+/*
+ * Return a reference to the memcg all folios on @folios are charged to, or
+ * NULL if they belong to different memcgs, as with folios isolated through
+ * reclaim_pages().
+ */
+static struct mem_cgroup *folio_list_memcg(struct list_head *folios)
+{
+	struct folio *folio, *first;
+
+	if (mem_cgroup_disabled() || list_empty(folios))
+		return NULL;
+
+	first = list_first_entry(folios, struct folio, lru);
+	list_for_each_entry(folio, folios, lru)
+		if (folio_memcg(folio) != folio_memcg(first))
+			return NULL;
+
+	return get_mem_cgroup_from_folio(first);
+}
+
 /*
  * Take folios on @demote_folios and attempt to demote them to another node.
  * Folios which are not demoted are left on @demote_folios.
@@ -955,8 +975,10 @@ static unsigned int demote_folio_list(struct list_head *demote_folios,
 				     struct pglist_data *pgdat)
 {
 	int target_nid = next_demotion_node(pgdat->node_id);
+	struct mem_cgroup *memcg;
 	unsigned int nr_succeeded;
 	nodemask_t allowed_mask;
+	int idx;
 
 	struct migration_target_control mtc = {
 		/*
@@ -979,13 +1001,21 @@ static unsigned int demote_folio_list(struct list_head *demote_folios,
 
 	node_get_allowed_targets(pgdat, &allowed_mask);
 
+	/* Demoted folios are freed, so find their memcg beforehand */
+	memcg = folio_list_memcg(demote_folios);
+
 	/* Demotion ignores all cpuset and mempolicy settings */
 	migrate_pages(demote_folios, alloc_demote_folio, NULL,
 		      (unsigned long)&mtc, MIGRATE_ASYNC, MR_DEMOTION,
 		      &nr_succeeded);
 
-	mod_node_page_state(pgdat, PGDEMOTE_KSWAPD + reclaimer_offset(),
-			    nr_succeeded);
+	idx = PGDEMOTE_KSWAPD + reclaimer_offset();
+	if (memcg)
+		mod_lruvec_state(mem_cgroup_lruvec(memcg, pgdat), idx,
+				 nr_succeeded);
+	else
+		mod_node_page_state(pgdat, idx, nr_succeeded);
+	mem_cgroup_put(memcg);
 
 	return nr_succeeded;
 }
@@ -1296,7 +1326,8 @@ static unsigned int shrink_folio_list(struct list_head *folio_list,
 			goto activate_locked;
 
 		mapping = folio_mapping(folio);
-		if (folio_test_dirty(folio)) {
+		if (folio_test_dirty(folio) &&
+		    !(folio_test_anon(folio) && !folio_test_swapbacked(folio))) {
 			/*
 			 * Only kswapd can writeback filesystem folios
 			 * to avoid risk of stack overflow. But avoid
@@ -3253,6 +3284,7 @@ static int should_skip_vma(unsigned long start, unsigned long end, struct mm_wal
 static bool get_next_vma(unsigned long mask, unsigned long size, struct mm_walk *args,
 			 unsigned long *vm_start, unsigned long *vm_end)
 {
+	struct lru_gen_mm_walk *walk = args->private;
 	unsigned long start = round_up(*vm_end, size);
 	unsigned long end = (start | ~mask) + 1;
 	VMA_ITERATOR(vmi, args->mm, start);
@@ -3260,6 +3292,10 @@ static bool get_next_vma(unsigned long mask, unsigned long size, struct mm_walk
 	VM_WARN_ON_ONCE(mask & size);
 	VM_WARN_ON_ONCE((start & mask) != (*vm_start & mask));
 
+	/* the rest of the mm belongs to another walker, see walk_mm() */
+	if (end && end > walk->end_addr)
+		end = walk->end_addr;
+
 	for_each_vma(vmi, args->vma) {
 		if (end && end <= args->vma->vm_start)
 			return false;
@@ -3617,7 +3653,8 @@ static int walk_pud_range(p4d_t *p4d, unsigned long start, unsigned long end,
 	return -EAGAIN;
 }
 
-static void walk_mm(struct mm_struct *mm, struct lru_gen_mm_walk *walk)
+static void walk_mm_range(struct mm_struct *mm, struct lru_gen_mm_walk *walk,
+			  unsigned long start, unsigned long end)
 {
 	static const struct mm_walk_ops mm_walk_ops = {
 		.test_walk = should_skip_vma,
@@ -3629,7 +3666,8 @@ static void walk_mm(struct mm_struct *mm, struct lru_gen_mm_walk *walk)
 	struct lruvec *lruvec = walk->lruvec;
 	struct mem_cgroup *memcg = lruvec_memcg(lruvec);
 
-	walk->next_addr = FIRST_USER_ADDRESS;
+	walk->next_addr = start;
+	walk->end_addr = end;
 
 	do {
 		DEFINE_MAX_SEQ(lruvec);
@@ -3646,7 +3684,8 @@ static void walk_mm(struct mm_struct *mm, struct lru_gen_mm_walk *walk)
 
 		/* the caller might be holding the lock for write */
 		if (mmap_read_trylock(mm)) {
-			err = walk_page_range(mm, walk->next_addr, ULONG_MAX, &mm_walk_ops, walk);
+			err = walk_page_range(mm, walk->next_addr, walk->end_addr,
+					      &mm_walk_ops, walk);
 
 			mmap_read_unlock(mm);
 		}
@@ -3660,7 +3699,129 @@ static void walk_mm(struct mm_struct *mm, struct lru_gen_mm_walk *walk)
 		}
 
 		cond_resched();
-	} while (err == -EAGAIN);
+	} while (err == -EAGAIN && walk->next_addr < walk->end_addr);
+}
+
+/*
+ * The page tables of a large mm can be walked by several workers at once,
+ * each covering a range of its VMAs. The ranges are cut at PMD boundaries
+ * so that no PTE table is shared, and sized by the VMAs they contain.
+ */
+#define MIN_WALK_WORKER_PAGES	((unsigned long)(SZ_8G >> PAGE_SHIFT))
+#define MAX_WALK_WORKERS	16
+
+static unsigned int lru_gen_walk_workers __read_mostly = 1;
+static struct workqueue_struct *lru_gen_walk_wq;
+
+struct lru_gen_walk_work {
+	struct work_struct work;
+	struct mm_struct *mm;
+	unsigned long start;
+	unsigned long end;
+	struct lru_gen_mm_walk walk;
+};
+
+static void walk_mm_workfn(struct work_struct *work)
+{
+	struct lru_gen_walk_work *w = container_of(work, struct lru_gen_walk_work, work);
+
+	walk_mm_range(w->mm, &w->walk, w->start, w->end);
+}
+
+static unsigned long walk_vma_size(struct vm_area_struct *vma)
+{
+	if ((vma->vm_flags & (VM_IO | VM_PFNMAP)) || !vma_is_accessible(vma))
+		return 0;
+
+	return vma->vm_end - vma->vm_start;
+}
+
+/* split the VMAs of @mm into @nr ranges of about the same size */
+static int walk_mm_split(struct mm_struct *mm, unsigned long *bounds, int nr)
+{
+	struct vm_area_struct *vma;
+	unsigned long total = 0, target, sum = 0;
+	int i = 1;
+	VMA_ITERATOR(vmi, mm, 0);
+
+	if (!mmap_read_trylock(mm))
+		return 1;
+
+	for_each_vma(vmi, vma)
+		total += walk_vma_size(vma);
+
+	target = total / nr;
+	vma_iter_init(&vmi, mm, 0);
+	for_each_vma(vmi, vma) {
+		unsigned long size = walk_vma_size(vma);
+
+		while (i < nr && sum + size > target * i) {
+			unsigned long addr = vma->vm_start;
+
+			if (target * i > sum)
+				addr += target * i - sum;
+			addr = min(ALIGN(addr, PMD_SIZE), vma->vm_end);
+			if (addr <= bounds[i - 1])
+				break;
+			bounds[i++] = addr;
+		}
+		sum += size;
+	}
+
+	mmap_read_unlock(mm);
+
+	return i;
+}
+
+static void walk_mm(struct mm_struct *mm, struct lru_gen_mm_walk *walk)
+{
+	unsigned long bounds[MAX_WALK_WORKERS + 1];
+	struct lru_gen_walk_work *works;
+	int i, j, nr;
+
+	nr = min(READ_ONCE(lru_gen_walk_workers),
+		 (unsigned int)(get_mm_rss(mm) / MIN_WALK_WORKER_PAGES));
+	if (nr <= 1 || !lru_gen_walk_wq)
+		goto single;
+
+	bounds[0] = FIRST_USER_ADDRESS;
+	nr = walk_mm_split(mm, bounds, nr);
+	if (nr <= 1)
+		goto single;
+	bounds[nr] = ULONG_MAX;
+
+	works = kcalloc(nr - 1, sizeof(*works), __GFP_HIGH | __GFP_NOMEMALLOC | __GFP_NOWARN);
+	if (!works)
+		goto single;
+
+	for (i = 0; i < nr - 1; i++) {
+		struct lru_gen_walk_work *w = &works[i];
+
+		INIT_WORK(&w->work, walk_mm_workfn);
+		w->mm = mm;
+		w->start = bounds[i + 1];
+		w->end = bounds[i + 2];
+		w->walk.lruvec = walk->lruvec;
+		w->walk.seq = walk->seq;
+		w->walk.can_swap = walk->can_swap;
+		w->walk.force_scan = walk->force_scan;
+		queue_work(lru_gen_walk_wq, &w->work);
+	}
+
+	walk_mm_range(mm, walk, bounds[0], bounds[1]);
+
+	for (i = 0; i < nr - 1; i++) {
+		flush_work(&works[i].work);
+
+		/* reported with ours by the next iterate_mm_list() */
+		for (j = 0; j < NR_MM_STATS; j++)
+			walk->mm_stats[j] += works[i].walk.mm_stats[j];
+	}
+
+	kfree(works);
+	return;
+single:
+	walk_mm_range(mm, walk, FIRST_USER_ADDRESS, ULONG_MAX);
 }
 
 static struct lru_gen_mm_walk *set_mm_walk(struct pglist_data *pgdat, bool force_alloc)
@@ -4265,15 +4426,6 @@ static bool sort_folio(struct lruvec *lruvec, struct folio *folio, struct scan_c
 		return true;
 	}
 
-	/* dirty lazyfree */
-	if (type == LRU_GEN_FILE && folio_test_anon(folio) && folio_test_dirty(folio)) {
-		success = lru_gen_del_folio(lruvec, folio, true);
-		VM_WARN_ON_ONCE_FOLIO(!success, folio);
-		folio_set_swapbacked(folio);
-		lruvec_add_folio_tail(lruvec, folio);
-		return true;
-	}
-
 	/* promoted */
 	if (gen != lru_gen_from_seq(lrugen->min_seq[type])) {
 		list_move(&folio->lru, &lrugen->folios[gen][type][zone]);
@@ -5124,6 +5276,27 @@ static ssize_t min_ttl_ms_store(struct kobject *kobj, struct kobj_attribute *att
 
 static struct kobj_attribute lru_gen_min_ttl_attr = __ATTR_RW(min_ttl_ms);
 
+static ssize_t walk_workers_show(struct kobject *kobj, struct kobj_attribute *attr,
+				 char *buf)
+{
+	return sysfs_emit(buf, "%u\n", READ_ONCE(lru_gen_walk_workers));
+}
+
+static ssize_t walk_workers_store(struct kobject *kobj, struct kobj_attribute *attr,
+				  const char *buf, size_t len)
+{
+	unsigned int workers;
+
+	if (kstrtouint(buf, 0, &workers) || !workers || workers > MAX_WALK_WORKERS)
+		return -EINVAL;
+
+	WRITE_ONCE(lru_gen_walk_workers, workers);
+
+	return len;
+}
+
+static struct kobj_attribute lru_gen_walk_workers_attr = __ATTR_RW(walk_workers);
+
 static ssize_t enabled_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf)
 {
 	unsigned int caps = 0;
@@ -5173,6 +5346,7 @@ static struct kobj_attribute lru_gen_enabled_attr = __ATTR_RW(enabled);
 static struct attribute *lru_gen_attrs[] = {
 	&lru_gen_min_ttl_attr.attr,
 	&lru_gen_enabled_attr.attr,
+	&lru_gen_walk_workers_attr.attr,
 	NULL
 };
 
@@ -5628,6 +5802,10 @@ static int __init init_lru_gen(void)
 	if (sysfs_create_group(mm_kobj, &lru_gen_attr_group))
 		pr_err("lru_gen: failed to create sysfs group\n");
 
+	lru_gen_walk_wq = alloc_workqueue("lru_gen_walk", WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	if (!lru_gen_walk_wq)
+		pr_err("lru_gen: failed to create walk workqueue\n");
+
 	debugfs_create_file("lru_gen", 0644, NULL, NULL, &lru_gen_rw_fops);
 	debugfs_create_file("lru_gen_full", 0444, NULL, NULL, &lru_gen_ro_fops);
 
@@ -1410,6 +1410,10 @@ const char * const vmstat_text[] = {
 	"direct_map_level2_splits",
 	"direct_map_level3_splits",
 #endif
+#ifdef CONFIG_MEMCG
+	"memcg_stock_hit",
+	"memcg_stock_miss",
+#endif
 #ifdef CONFIG_PER_VMA_LOCK_STATS
 	"vma_lock_success",
 	"vma_lock_abort",
@@ -1751,6 +1755,22 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 			   pcp->count,
 			   pcp->high,
 			   pcp->batch);
+#ifdef CONFIG_PCP_STATS
+		seq_printf(m,
+			   "\n              hit:             %lu"
+			   "\n              refill:          %lu"
+			   "\n              refill_pages:    %lu"
+			   "\n              drain:           %lu"
+			   "\n              drain_pages:     %lu"
+			   "\n              drain_lock_usec: %llu",
+			   READ_ONCE(pcp->stats.hit),
+			   READ_ONCE(pcp->stats.refill),
+			   READ_ONCE(pcp->stats.refill_pages),
+			   READ_ONCE(pcp->stats.drain),
+			   READ_ONCE(pcp->stats.drain_pages),
+			   div_u64(READ_ONCE(pcp->stats.drain_lock_ns),
+				   NSEC_PER_USEC));
+#endif
 #ifdef CONFIG_SMP
 		pzstats = per_cpu_ptr(zone->per_cpu_zonestats, i);
 		seq_printf(m, "\n  vm stats threshold: %d",
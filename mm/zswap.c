@@ -92,6 +92,9 @@ static const struct kernel_param_ops zswap_enabled_param_ops = {
 };
 module_param_cb(enabled, &zswap_enabled_param_ops, &zswap_enabled, 0644);
 
+/* Set once zswap is first enabled, it may hold entries from then on */
+static DEFINE_STATIC_KEY_MAYBE(CONFIG_ZSWAP_DEFAULT_ON, zswap_ever_enabled);
+
 /* Crypto compressor to use */
 static char *zswap_compressor = CONFIG_ZSWAP_COMPRESSOR_DEFAULT;
 static int zswap_compressor_param_set(const char *,
@@ -136,15 +139,30 @@ bool is_zswap_enabled(void)
 	return zswap_enabled;
 }
 
+bool zswap_never_enabled(void)
+{
+	return !static_branch_maybe(CONFIG_ZSWAP_DEFAULT_ON, &zswap_ever_enabled);
+}
+
 /*********************************
 * data structures
 **********************************/
 
+/*
+ * Number of compression requests kept in flight per CPU for asynchronous
+ * (hardware) compressors. Synchronous ones complete every request on
+ * submission and get a single one.
+ */
+#define ZSWAP_MAX_BATCH_SIZE	8
+
 struct crypto_acomp_ctx {
 	struct crypto_acomp *acomp;
-	struct acomp_req *req;
-	struct crypto_wait wait;
-	u8 *buffer;
+	struct acomp_req *reqs[ZSWAP_MAX_BATCH_SIZE];
+	struct crypto_wait waits[ZSWAP_MAX_BATCH_SIZE];
+	u8 *buffers[ZSWAP_MAX_BATCH_SIZE];
+	struct scatterlist inputs[ZSWAP_MAX_BATCH_SIZE];
+	struct scatterlist outputs[ZSWAP_MAX_BATCH_SIZE];
+	unsigned int nr_reqs;
 	struct mutex mutex;
 	bool is_sleepable;
 };
@@ -673,10 +691,13 @@ static int zswap_enabled_param_set(const char *val,
 			break;
 		fallthrough;
 	case ZSWAP_INIT_SUCCEED:
-		if (!zswap_has_pool)
+		if (!zswap_has_pool) {
 			pr_err("can't enable, no pool configured\n");
-		else
-			ret = param_set_bool(val, kp);
+			break;
+		}
+		ret = param_set_bool(val, kp);
+		if (!ret && zswap_enabled)
+			static_branch_enable(&zswap_ever_enabled);
 		break;
 	case ZSWAP_INIT_FAILED:
 		pr_err("can't enable, initialization failed\n");
@@ -837,49 +858,64 @@ static int zswap_cpu_comp_prepare(unsigned int cpu, struct hlist_node *node)
 	struct zswap_pool *pool = hlist_entry(node, struct zswap_pool, node);
 	struct crypto_acomp_ctx *acomp_ctx = per_cpu_ptr(pool->acomp_ctx, cpu);
 	struct crypto_acomp *acomp;
-	struct acomp_req *req;
+	unsigned int i;
 	int ret;
 
 	mutex_init(&acomp_ctx->mutex);
 
-	acomp_ctx->buffer = kmalloc_node(PAGE_SIZE * 2, GFP_KERNEL, cpu_to_node(cpu));
-	if (!acomp_ctx->buffer)
-		return -ENOMEM;
-
 	acomp = crypto_alloc_acomp_node(pool->tfm_name, 0, 0, cpu_to_node(cpu));
 	if (IS_ERR(acomp)) {
 		pr_err("could not alloc crypto acomp %s : %ld\n",
 				pool->tfm_name, PTR_ERR(acomp));
-		ret = PTR_ERR(acomp);
-		goto acomp_fail;
+		return PTR_ERR(acomp);
 	}
 	acomp_ctx->acomp = acomp;
 	acomp_ctx->is_sleepable = acomp_is_async(acomp);
+	acomp_ctx->nr_reqs = acomp_ctx->is_sleepable ? ZSWAP_MAX_BATCH_SIZE : 1;
 
-	req = acomp_request_alloc(acomp_ctx->acomp);
-	if (!req) {
-		pr_err("could not alloc crypto acomp_request %s\n",
-		       pool->tfm_name);
-		ret = -ENOMEM;
-		goto req_fail;
-	}
-	acomp_ctx->req = req;
+	for (i = 0; i < acomp_ctx->nr_reqs; i++) {
+		struct acomp_req *req;
 
-	crypto_init_wait(&acomp_ctx->wait);
-	/*
-	 * if the backend of acomp is async zip, crypto_req_done() will wakeup
-	 * crypto_wait_req(); if the backend of acomp is scomp, the callback
-	 * won't be called, crypto_wait_req() will return without blocking.
-	 */
-	acomp_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
-				   crypto_req_done, &acomp_ctx->wait);
+		acomp_ctx->buffers[i] = kmalloc_node(PAGE_SIZE * 2, GFP_KERNEL,
+						     cpu_to_node(cpu));
+		if (!acomp_ctx->buffers[i]) {
+			ret = -ENOMEM;
+			goto fail;
+		}
+
+		req = acomp_request_alloc(acomp_ctx->acomp);
+		if (!req) {
+			pr_err("could not alloc crypto acomp_request %s\n",
+			       pool->tfm_name);
+			ret = -ENOMEM;
+			goto fail;
+		}
+		acomp_ctx->reqs[i] = req;
+
+		crypto_init_wait(&acomp_ctx->waits[i]);
+		/*
+		 * if the backend of acomp is async zip, crypto_req_done() will
+		 * wakeup crypto_wait_req(); if the backend of acomp is scomp,
+		 * the callback won't be called, crypto_wait_req() will return
+		 * without blocking.
+		 */
+		acomp_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+					   crypto_req_done,
+					   &acomp_ctx->waits[i]);
+	}
 
 	return 0;
 
-req_fail:
+fail:
+	for (i = 0; i < acomp_ctx->nr_reqs; i++) {
+		if (acomp_ctx->reqs[i])
+			acomp_request_free(acomp_ctx->reqs[i]);
+		acomp_ctx->reqs[i] = NULL;
+		kfree(acomp_ctx->buffers[i]);
+		acomp_ctx->buffers[i] = NULL;
+	}
 	crypto_free_acomp(acomp_ctx->acomp);
-acomp_fail:
-	kfree(acomp_ctx->buffer);
+	acomp_ctx->acomp = NULL;
 	return ret;
 }
 
@@ -887,88 +923,118 @@ static int zswap_cpu_comp_dead(unsigned int cpu, struct hlist_node *node)
 {
 	struct zswap_pool *pool = hlist_entry(node, struct zswap_pool, node);
 	struct crypto_acomp_ctx *acomp_ctx = per_cpu_ptr(pool->acomp_ctx, cpu);
+	unsigned int i;
 
 	if (!IS_ERR_OR_NULL(acomp_ctx)) {
-		if (!IS_ERR_OR_NULL(acomp_ctx->req))
-			acomp_request_free(acomp_ctx->req);
+		for (i = 0; i < acomp_ctx->nr_reqs; i++) {
+			if (!IS_ERR_OR_NULL(acomp_ctx->reqs[i]))
+				acomp_request_free(acomp_ctx->reqs[i]);
+			acomp_ctx->reqs[i] = NULL;
+			kfree(acomp_ctx->buffers[i]);
+			acomp_ctx->buffers[i] = NULL;
+		}
 		if (!IS_ERR_OR_NULL(acomp_ctx->acomp))
 			crypto_free_acomp(acomp_ctx->acomp);
-		kfree(acomp_ctx->buffer);
 	}
 
 	return 0;
 }
 
-static bool zswap_compress(struct folio *folio, struct zswap_entry *entry)
+static int zswap_compress_store(struct crypto_acomp_ctx *acomp_ctx,
+				unsigned int i, struct zswap_entry *entry)
 {
-	struct crypto_acomp_ctx *acomp_ctx;
-	struct scatterlist input, output;
-	int comp_ret = 0, alloc_ret = 0;
-	unsigned int dlen = PAGE_SIZE;
+	unsigned int dlen = acomp_ctx->reqs[i]->dlen;
 	unsigned long handle;
 	struct zpool *zpool;
 	char *buf;
 	gfp_t gfp;
-	u8 *dst;
-
-	acomp_ctx = raw_cpu_ptr(entry->pool->acomp_ctx);
-
-	mutex_lock(&acomp_ctx->mutex);
-
-	dst = acomp_ctx->buffer;
-	sg_init_table(&input, 1);
-	sg_set_page(&input, &folio->page, PAGE_SIZE, 0);
-
-	/*
-	 * We need PAGE_SIZE * 2 here since there maybe over-compression case,
-	 * and hardware-accelerators may won't check the dst buffer size, so
-	 * giving the dst buffer with enough length to avoid buffer overflow.
-	 */
-	sg_init_one(&output, dst, PAGE_SIZE * 2);
-	acomp_request_set_params(acomp_ctx->req, &input, &output, PAGE_SIZE, dlen);
-
-	/*
-	 * it maybe looks a little bit silly that we send an asynchronous request,
-	 * then wait for its completion synchronously. This makes the process look
-	 * synchronous in fact.
-	 * Theoretically, acomp supports users send multiple acomp requests in one
-	 * acomp instance, then get those requests done simultaneously. but in this
-	 * case, zswap actually does store and load page by page, there is no
-	 * existing method to send the second page before the first page is done
-	 * in one thread doing zwap.
-	 * but in different threads running on different cpu, we have different
-	 * acomp instance, so multiple threads can do (de)compression in parallel.
-	 */
-	comp_ret = crypto_wait_req(crypto_acomp_compress(acomp_ctx->req), &acomp_ctx->wait);
-	dlen = acomp_ctx->req->dlen;
-	if (comp_ret)
-		goto unlock;
+	int ret;
 
 	zpool = zswap_find_zpool(entry);
 	gfp = __GFP_NORETRY | __GFP_NOWARN | __GFP_KSWAPD_RECLAIM;
 	if (zpool_malloc_support_movable(zpool))
 		gfp |= __GFP_HIGHMEM | __GFP_MOVABLE;
-	alloc_ret = zpool_malloc(zpool, dlen, gfp, &handle);
-	if (alloc_ret)
-		goto unlock;
+	ret = zpool_malloc(zpool, dlen, gfp, &handle);
+	if (ret)
+		return ret;
 
 	buf = zpool_map_handle(zpool, handle, ZPOOL_MM_WO);
-	memcpy(buf, dst, dlen);
+	memcpy(buf, acomp_ctx->buffers[i], dlen);
 	zpool_unmap_handle(zpool, handle);
 
 	entry->handle = handle;
 	entry->length = dlen;
+	return 0;
+}
+
+/*
+ * Compress @nr pages into their entries, which all belong to the same pool.
+ * Up to ->nr_reqs requests are put in flight before waiting for the first
+ * one, so that an asynchronous compressor can work on them in parallel.
+ * Entries that fail are left with a zero length. Returns true if all pages
+ * were compressed and stored.
+ */
+static bool zswap_compress_pages(struct page **pages,
+				 struct zswap_entry **entries, unsigned int nr)
+{
+	struct crypto_acomp_ctx *acomp_ctx;
+	int errs[ZSWAP_MAX_BATCH_SIZE];
+	unsigned int start, i, n;
+	bool ret = true;
+
+	if (!nr)
+		return true;
+
+	acomp_ctx = raw_cpu_ptr(entries[0]->pool->acomp_ctx);
+
+	mutex_lock(&acomp_ctx->mutex);
 
-unlock:
-	if (comp_ret == -ENOSPC || alloc_ret == -ENOSPC)
-		zswap_reject_compress_poor++;
-	else if (comp_ret)
-		zswap_reject_compress_fail++;
-	else if (alloc_ret)
-		zswap_reject_alloc_fail++;
+	for (start = 0; start < nr; start += n) {
+		n = min(nr - start, acomp_ctx->nr_reqs);
+
+		for (i = 0; i < n; i++) {
+			struct acomp_req *req = acomp_ctx->reqs[i];
+
+			sg_init_table(&acomp_ctx->inputs[i], 1);
+			sg_set_page(&acomp_ctx->inputs[i], pages[start + i],
+				    PAGE_SIZE, 0);
+			/*
+			 * We need PAGE_SIZE * 2 here since there maybe
+			 * over-compression case, and hardware-accelerators may
+			 * won't check the dst buffer size, so giving the dst
+			 * buffer with enough length to avoid buffer overflow.
+			 */
+			sg_init_one(&acomp_ctx->outputs[i],
+				    acomp_ctx->buffers[i], PAGE_SIZE * 2);
+			acomp_request_set_params(req, &acomp_ctx->inputs[i],
+						 &acomp_ctx->outputs[i],
+						 PAGE_SIZE, PAGE_SIZE);
+			errs[i] = crypto_acomp_compress(req);
+		}
+
+		for (i = 0; i < n; i++) {
+			struct zswap_entry *entry = entries[start + i];
+			int comp_ret, alloc_ret = 0;
+
+			comp_ret = crypto_wait_req(errs[i], &acomp_ctx->waits[i]);
+			if (!comp_ret)
+				alloc_ret = zswap_compress_store(acomp_ctx, i,
+								 entry);
+
+			if (comp_ret == -ENOSPC || alloc_ret == -ENOSPC)
+				zswap_reject_compress_poor++;
+			else if (comp_ret)
+				zswap_reject_compress_fail++;
+			else if (alloc_ret)
+				zswap_reject_alloc_fail++;
+
+			if (comp_ret || alloc_ret)
+				ret = false;
+		}
+	}
 
 	mutex_unlock(&acomp_ctx->mutex);
-	return comp_ret == 0 && alloc_ret == 0;
+	return ret;
 }
 
 static void zswap_decompress(struct zswap_entry *entry, struct page *page)
@@ -993,20 +1059,20 @@ static void zswap_decompress(struct zswap_entry *entry, struct page *page)
 	 */
 	if ((acomp_ctx->is_sleepable && !zpool_can_sleep_mapped(zpool)) ||
 	    !virt_addr_valid(src)) {
-		memcpy(acomp_ctx->buffer, src, entry->length);
-		src = acomp_ctx->buffer;
+		memcpy(acomp_ctx->buffers[0], src, entry->length);
+		src = acomp_ctx->buffers[0];
 		zpool_unmap_handle(zpool, entry->handle);
 	}
 
 	sg_init_one(&input, src, entry->length);
 	sg_init_table(&output, 1);
 	sg_set_page(&output, page, PAGE_SIZE, 0);
-	acomp_request_set_params(acomp_ctx->req, &input, &output, entry->length, PAGE_SIZE);
-	BUG_ON(crypto_wait_req(crypto_acomp_decompress(acomp_ctx->req), &acomp_ctx->wait));
-	BUG_ON(acomp_ctx->req->dlen != PAGE_SIZE);
+	acomp_request_set_params(acomp_ctx->reqs[0], &input, &output, entry->length, PAGE_SIZE);
+	BUG_ON(crypto_wait_req(crypto_acomp_decompress(acomp_ctx->reqs[0]), &acomp_ctx->waits[0]));
+	BUG_ON(acomp_ctx->reqs[0]->dlen != PAGE_SIZE);
 	mutex_unlock(&acomp_ctx->mutex);
 
-	if (src != acomp_ctx->buffer)
+	if (src != acomp_ctx->buffers[0])
 		zpool_unmap_handle(zpool, entry->handle);
 }
 
@@ -1373,28 +1439,28 @@ static void shrink_worker(struct work_struct *w)
 /*********************************
 * same-filled functions
 **********************************/
-static bool zswap_is_folio_same_filled(struct folio *folio, unsigned long *value)
+static bool zswap_is_page_same_filled(struct page *page, unsigned long *value)
 {
-	unsigned long *page;
+	unsigned long *data;
 	unsigned long val;
-	unsigned int pos, last_pos = PAGE_SIZE / sizeof(*page) - 1;
+	unsigned int pos, last_pos = PAGE_SIZE / sizeof(*data) - 1;
 	bool ret = false;
 
-	page = kmap_local_folio(folio, 0);
-	val = page[0];
+	data = kmap_local_page(page);
+	val = data[0];
 
-	if (val != page[last_pos])
+	if (val != data[last_pos])
 		goto out;
 
 	for (pos = 1; pos < last_pos; pos++) {
-		if (val != page[pos])
+		if (val != data[pos])
 			goto out;
 	}
 
 	*value = val;
 	ret = true;
 out:
-	kunmap_local(page);
+	kunmap_local(data);
 	return ret;
 }
 
@@ -1409,23 +1475,141 @@ static void zswap_fill_page(void *ptr, unsigned long value)
 /*********************************
 * main API
 **********************************/
+/* Free an entry that never made it into the xarray. */
+static void zswap_entry_discard(struct zswap_entry *entry)
+{
+	if (entry->length)
+		zpool_free(zswap_find_zpool(entry), entry->handle);
+	if (entry->pool)
+		zswap_pool_put(entry->pool);
+	zswap_entry_cache_free(entry);
+}
+
+/*
+ * Store @nr subpages of @folio, starting at @start. The caller holds a
+ * reference on @pool for the duration of the store, each compressed entry
+ * takes its own. All pages that aren't same-filled are compressed as one
+ * batch before any entry is published.
+ */
+static bool zswap_store_pages(struct folio *folio, long start, long nr,
+			      struct obj_cgroup *objcg, struct zswap_pool *pool)
+{
+	struct zswap_entry *entries[ZSWAP_MAX_BATCH_SIZE];
+	struct zswap_entry *comp_entries[ZSWAP_MAX_BATCH_SIZE];
+	struct page *comp_pages[ZSWAP_MAX_BATCH_SIZE];
+	unsigned int nr_comp = 0;
+	long i, first = 0, nr_alloc;
+
+	for (nr_alloc = 0; nr_alloc < nr; nr_alloc++) {
+		struct page *page = folio_page(folio, start + nr_alloc);
+		struct zswap_entry *entry;
+		unsigned long value;
+
+		entry = zswap_entry_cache_alloc(GFP_KERNEL, page_to_nid(page));
+		if (!entry) {
+			zswap_reject_kmemcache_fail++;
+			goto discard;
+		}
+		entries[nr_alloc] = entry;
+		entry->length = 0;
+
+		if (zswap_is_page_same_filled(page, &value)) {
+			entry->pool = NULL;
+			entry->value = value;
+			continue;
+		}
+
+		/* if entry is successfully added, it keeps the reference */
+		percpu_ref_get(&pool->ref);
+		entry->pool = pool;
+		comp_entries[nr_comp] = entry;
+		comp_pages[nr_comp++] = page;
+	}
+
+	if (!zswap_compress_pages(comp_pages, comp_entries, nr_comp))
+		goto discard;
+
+	for (i = 0; i < nr; i++) {
+		struct zswap_entry *entry = entries[i], *old;
+		swp_entry_t swp = folio->swap;
+
+		swp = swp_entry(swp_type(swp), swp_offset(swp) + start + i);
+		entry->swpentry = swp;
+		entry->objcg = objcg;
+
+		old = xa_store(swap_zswap_tree(swp), swp_offset(swp), entry,
+			       GFP_KERNEL);
+		if (xa_is_err(old)) {
+			int err = xa_err(old);
+
+			WARN_ONCE(err != -ENOMEM, "unexpected xarray error: %d\n", err);
+			zswap_reject_alloc_fail++;
+			/* published entries are invalidated by the caller */
+			first = i;
+			goto discard;
+		}
+
+		/*
+		 * We may have had an existing entry that became stale when
+		 * the folio was redirtied and now the new version is being
+		 * swapped out. Get rid of the old.
+		 */
+		if (old)
+			zswap_entry_free(old);
+
+		if (objcg) {
+			obj_cgroup_get(objcg);
+			obj_cgroup_charge_zswap(objcg, entry->length);
+			count_objcg_event(objcg, ZSWPOUT);
+		}
+
+		/*
+		 * We finish initializing the entry while it's already in xarray.
+		 * This is safe because:
+		 *
+		 * 1. Concurrent stores and invalidations are excluded by folio lock.
+		 *
+		 * 2. Writeback is excluded by the entry not being on the LRU yet.
+		 *    The publishing order matters to prevent writeback from seeing
+		 *    an incoherent entry.
+		 */
+		if (entry->length) {
+			INIT_LIST_HEAD(&entry->lru);
+			zswap_lru_add(&zswap_list_lru, entry);
+		} else {
+			atomic_inc(&zswap_same_filled_pages);
+		}
+
+		/* update stats */
+		atomic_inc(&zswap_stored_pages);
+		count_vm_event(ZSWPOUT);
+	}
+
+	return true;
+
+discard:
+	for (i = first; i < nr_alloc; i++)
+		zswap_entry_discard(entries[i]);
+	return false;
+}
+
+/*
+ * Large folios are stored one subpage at a time, each in its own entry, and
+ * either all or none of them end up in zswap.
+ */
 bool zswap_store(struct folio *folio)
 {
+	long nr_pages = folio_nr_pages(folio);
 	swp_entry_t swp = folio->swap;
-	pgoff_t offset = swp_offset(swp);
-	struct xarray *tree = swap_zswap_tree(swp);
-	struct zswap_entry *entry, *old;
 	struct obj_cgroup *objcg = NULL;
 	struct mem_cgroup *memcg = NULL;
-	unsigned long value;
+	struct zswap_pool *pool;
+	bool ret = false;
+	long index;
 
 	VM_WARN_ON_ONCE(!folio_test_locked(folio));
 	VM_WARN_ON_ONCE(!folio_test_swapcache(folio));
 
-	/* Large folios aren't supported */
-	if (folio_test_large(folio))
-		return false;
-
 	if (!zswap_enabled)
 		goto check_old;
 
@@ -1435,32 +1619,17 @@ bool zswap_store(struct folio *folio)
 		memcg = get_mem_cgroup_from_objcg(objcg);
 		if (shrink_memcg(memcg)) {
 			mem_cgroup_put(memcg);
-			goto reject;
+			goto put_objcg;
 		}
 		mem_cgroup_put(memcg);
 	}
 
 	if (zswap_check_limits())
-		goto reject;
-
-	/* allocate entry */
-	entry = zswap_entry_cache_alloc(GFP_KERNEL, folio_nid(folio));
-	if (!entry) {
-		zswap_reject_kmemcache_fail++;
-		goto reject;
-	}
-
-	if (zswap_is_folio_same_filled(folio, &value)) {
-		entry->length = 0;
-		entry->value = value;
-		atomic_inc(&zswap_same_filled_pages);
-		goto store_entry;
-	}
+		goto put_objcg;
 
-	/* if entry is successfully added, it keeps the reference */
-	entry->pool = zswap_pool_current_get();
-	if (!entry->pool)
-		goto freepage;
+	pool = zswap_pool_current_get();
+	if (!pool)
+		goto put_objcg;
 
 	if (objcg) {
 		memcg = get_mem_cgroup_from_objcg(objcg);
@@ -1471,131 +1640,138 @@ bool zswap_store(struct folio *folio)
 		mem_cgroup_put(memcg);
 	}
 
-	if (!zswap_compress(folio, entry))
-		goto put_pool;
-
-store_entry:
-	entry->swpentry = swp;
-	entry->objcg = objcg;
-
-	old = xa_store(tree, offset, entry, GFP_KERNEL);
-	if (xa_is_err(old)) {
-		int err = xa_err(old);
-
-		WARN_ONCE(err != -ENOMEM, "unexpected xarray error: %d\n", err);
-		zswap_reject_alloc_fail++;
-		goto store_failed;
-	}
-
-	/*
-	 * We may have had an existing entry that became stale when
-	 * the folio was redirtied and now the new version is being
-	 * swapped out. Get rid of the old.
-	 */
-	if (old)
-		zswap_entry_free(old);
-
-	if (objcg) {
-		obj_cgroup_charge_zswap(objcg, entry->length);
-		count_objcg_event(objcg, ZSWPOUT);
-	}
+	for (index = 0; index < nr_pages; index += ZSWAP_MAX_BATCH_SIZE) {
+		long nr = min(nr_pages - index, (long)ZSWAP_MAX_BATCH_SIZE);
 
-	/*
-	 * We finish initializing the entry while it's already in xarray.
-	 * This is safe because:
-	 *
-	 * 1. Concurrent stores and invalidations are excluded by folio lock.
-	 *
-	 * 2. Writeback is excluded by the entry not being on the LRU yet.
-	 *    The publishing order matters to prevent writeback from seeing
-	 *    an incoherent entry.
-	 */
-	if (entry->length) {
-		INIT_LIST_HEAD(&entry->lru);
-		zswap_lru_add(&zswap_list_lru, entry);
+		if (!zswap_store_pages(folio, index, nr, objcg, pool))
+			goto put_pool;
 	}
 
-	/* update stats */
-	atomic_inc(&zswap_stored_pages);
-	count_vm_event(ZSWPOUT);
-
-	return true;
+	ret = true;
 
-store_failed:
-	if (!entry->length)
-		atomic_dec(&zswap_same_filled_pages);
-	else {
-		zpool_free(zswap_find_zpool(entry), entry->handle);
 put_pool:
-		zswap_pool_put(entry->pool);
-	}
-freepage:
-	zswap_entry_cache_free(entry);
-reject:
+	zswap_pool_put(pool);
+put_objcg:
 	obj_cgroup_put(objcg);
-	if (zswap_pool_reached_full)
+	if (!ret && zswap_pool_reached_full)
 		queue_work(shrink_wq, &zswap_shrink_work);
 check_old:
 	/*
 	 * If the zswap store fails or zswap is disabled, we must invalidate the
-	 * possibly stale entry which was previously stored at this offset.
+	 * possibly stale entries which were previously stored at the folio's
+	 * offsets, as well as the subpages of this folio that did make it in.
 	 * Otherwise, writeback could overwrite the new data in the swapfile.
 	 */
-	entry = xa_erase(tree, offset);
-	if (entry)
-		zswap_entry_free(entry);
-	return false;
+	if (!ret) {
+		for (index = 0; index < nr_pages; index++)
+			zswap_invalidate(swp_entry(swp_type(swp),
+						   swp_offset(swp) + index));
+	}
+	return ret;
+}
+
+/*
+ * A large folio is loaded as a unit: all of its subpages have to be in
+ * zswap. Return the number of subpages found.
+ */
+static long zswap_folio_entries(struct folio *folio)
+{
+	long nr_pages = folio_nr_pages(folio);
+	swp_entry_t swp = folio->swap;
+	long index, nr = 0;
+
+	for (index = 0; index < nr_pages; index++) {
+		swp_entry_t page_swp = swp_entry(swp_type(swp),
+						 swp_offset(swp) + index);
+
+		if (xa_load(swap_zswap_tree(page_swp), swp_offset(page_swp)))
+			nr++;
+	}
+	return nr;
 }
 
+/**
+ * zswap_load() - load a folio from zswap
+ * @folio: folio to load
+ *
+ * On success the folio is marked uptodate and unlocked. A large folio that
+ * is only partially in zswap has no consistent copy anywhere, it is unlocked
+ * without being marked uptodate, so the swapin fails with an I/O error.
+ *
+ * Return: true if zswap took care of the folio, false if the caller has to
+ * read it from the swap device.
+ */
 bool zswap_load(struct folio *folio)
 {
+	long nr_pages = folio_nr_pages(folio);
 	swp_entry_t swp = folio->swap;
-	pgoff_t offset = swp_offset(swp);
-	struct page *page = &folio->page;
 	bool swapcache = folio_test_swapcache(folio);
-	struct xarray *tree = swap_zswap_tree(swp);
 	struct zswap_entry *entry;
+	long index;
 	u8 *dst;
 
 	VM_WARN_ON_ONCE(!folio_test_locked(folio));
 
-	/*
-	 * When reading into the swapcache, invalidate our entry. The
-	 * swapcache can be the authoritative owner of the page and
-	 * its mappings, and the pressure that results from having two
-	 * in-memory copies outweighs any benefits of caching the
-	 * compression work.
-	 *
-	 * (Most swapins go through the swapcache. The notable
-	 * exception is the singleton fault on SWP_SYNCHRONOUS_IO
-	 * files, which reads into a private page and may free it if
-	 * the fault fails. We remain the primary owner of the entry.)
-	 */
-	if (swapcache)
-		entry = xa_erase(tree, offset);
-	else
-		entry = xa_load(tree, offset);
-
-	if (!entry)
-		return false;
+	if (nr_pages > 1) {
+		long nr = zswap_folio_entries(folio);
 
-	if (entry->length)
-		zswap_decompress(entry, page);
-	else {
-		dst = kmap_local_page(page);
-		zswap_fill_page(dst, entry->value);
-		kunmap_local(dst);
+		if (!nr)
+			return false;
+		if (WARN_ON_ONCE(nr != nr_pages)) {
+			folio_unlock(folio);
+			return true;
+		}
 	}
 
-	count_vm_event(ZSWPIN);
-	if (entry->objcg)
-		count_objcg_event(entry->objcg, ZSWPIN);
+	for (index = 0; index < nr_pages; index++) {
+		swp_entry_t page_swp = swp_entry(swp_type(swp),
+						 swp_offset(swp) + index);
+		struct xarray *tree = swap_zswap_tree(page_swp);
+		pgoff_t offset = swp_offset(page_swp);
+		struct page *page = folio_page(folio, index);
 
-	if (swapcache) {
-		zswap_entry_free(entry);
-		folio_mark_dirty(folio);
+		/*
+		 * When reading into the swapcache, invalidate our entry. The
+		 * swapcache can be the authoritative owner of the page and
+		 * its mappings, and the pressure that results from having two
+		 * in-memory copies outweighs any benefits of caching the
+		 * compression work.
+		 *
+		 * (Most swapins go through the swapcache. The notable
+		 * exception is the singleton fault on SWP_SYNCHRONOUS_IO
+		 * files, which reads into a private page and may free it if
+		 * the fault fails. We remain the primary owner of the entry.)
+		 */
+		if (swapcache)
+			entry = xa_erase(tree, offset);
+		else
+			entry = xa_load(tree, offset);
+
+		/* large folios were checked above, under the folio lock */
+		if (!entry)
+			return false;
+
+		if (entry->length)
+			zswap_decompress(entry, page);
+		else {
+			dst = kmap_local_page(page);
+			zswap_fill_page(dst, entry->value);
+			kunmap_local(dst);
+		}
+
+		count_vm_event(ZSWPIN);
+		if (entry->objcg)
+			count_objcg_event(entry->objcg, ZSWPIN);
+
+		if (swapcache)
+			zswap_entry_free(entry);
 	}
 
+	if (swapcache)
+		folio_mark_dirty(folio);
+
+	folio_mark_uptodate(folio);
+	folio_unlock(folio);
 	return true;
 }
 
@@ -1769,6 +1945,8 @@ static int __init zswap_init(void)
 {
 	if (!zswap_enabled)
 		return 0;
+	/* zswap.enabled=1 on the command line is parsed before jump labels */
+	static_branch_enable(&zswap_ever_enabled);
 	return zswap_setup();
 }
 /* must be late so crypto has time to come up */
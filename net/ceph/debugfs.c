@@ -375,6 +375,45 @@ static int osdc_show(struct seq_file *s, void *pp)
 	return 0;
 }
 
+static void dump_con_stats(struct seq_file *s, const char *name, int id,
+			   struct ceph_connection *con)
+{
+	u64 secs = max(1UL, (jiffies - con->stats_start) / HZ);
+
+	seq_printf(s, "%s%d\t%s\tin %llu/%llu\tout %llu/%llu\tin_Bps %llu\tout_Bps %llu\n",
+		   name, id, ceph_pr_addr(&con->peer_addr),
+		   READ_ONCE(con->in_msgs), READ_ONCE(con->in_bytes),
+		   READ_ONCE(con->out_msgs), READ_ONCE(con->out_bytes),
+		   div64_u64(READ_ONCE(con->in_bytes), secs),
+		   div64_u64(READ_ONCE(con->out_bytes), secs));
+}
+
+/*
+ * Messages and bytes received and sent on each connection, and the average
+ * rates since the connection was set up.
+ */
+static int connections_show(struct seq_file *s, void *p)
+{
+	struct ceph_client *client = s->private;
+	struct ceph_osd_client *osdc = &client->osdc;
+	struct ceph_mon_client *monc = &client->monc;
+	struct rb_node *n;
+
+	mutex_lock(&monc->mutex);
+	if (monc->cur_mon >= 0)
+		dump_con_stats(s, "mon", monc->cur_mon, &monc->con);
+	mutex_unlock(&monc->mutex);
+
+	down_read(&osdc->lock);
+	for (n = rb_first(&osdc->osds); n; n = rb_next(n)) {
+		struct ceph_osd *osd = rb_entry(n, struct ceph_osd, o_node);
+
+		dump_con_stats(s, "osd", osd->o_osd, &osd->o_con);
+	}
+	up_read(&osdc->lock);
+	return 0;
+}
+
 static int client_options_show(struct seq_file *s, void *p)
 {
 	struct ceph_client *client = s->private;
@@ -393,6 +432,7 @@ DEFINE_SHOW_ATTRIBUTE(osdmap);
 DEFINE_SHOW_ATTRIBUTE(monc);
 DEFINE_SHOW_ATTRIBUTE(osdc);
 DEFINE_SHOW_ATTRIBUTE(client_options);
+DEFINE_SHOW_ATTRIBUTE(connections);
 
 void __init ceph_debugfs_init(void)
 {
@@ -444,11 +484,18 @@ void ceph_debugfs_client_init(struct ceph_client *client)
 					client->debugfs_dir,
 					client,
 					&client_options_fops);
+
+	client->debugfs_connections = debugfs_create_file("connections",
+					0400,
+					client->debugfs_dir,
+					client,
+					&connections_fops);
 }
 
 void ceph_debugfs_client_cleanup(struct ceph_client *client)
 {
 	dout("ceph_debugfs_client_cleanup %p\n", client);
+	debugfs_remove(client->debugfs_connections);
 	debugfs_remove(client->debugfs_options);
 	debugfs_remove(client->debugfs_osdmap);
 	debugfs_remove(client->debugfs_monmap);
@@ -239,6 +239,16 @@ static void _ceph_msgr_exit(void)
 	ceph_msgr_slab_exit();
 }
 
+/*
+ * Connection work normally runs on the CPU that queued it, usually the one
+ * taking the socket's receive softirq. With few busy connections whose
+ * interrupts land on the same CPU, an unbound workqueue spreads them over
+ * the CPUs of the pod instead.
+ */
+static bool msgr_unbound;
+module_param(msgr_unbound, bool, 0444);
+MODULE_PARM_DESC(msgr_unbound, "Run connection work on an unbound workqueue");
+
 int __init ceph_msgr_init(void)
 {
 	if (ceph_msgr_slab_init())
@@ -252,7 +262,8 @@ int __init ceph_msgr_init(void)
 	 * The number of active work items is limited by the number of
 	 * connections, so leave @max_active at default.
 	 */
-	ceph_msgr_wq = alloc_workqueue("ceph-msgr", WQ_MEM_RECLAIM, 0);
+	ceph_msgr_wq = alloc_workqueue("ceph-msgr", WQ_MEM_RECLAIM |
+				       (msgr_unbound ? WQ_UNBOUND : 0), 0);
 	if (ceph_msgr_wq)
 		return 0;
 
@@ -644,6 +655,7 @@ void ceph_con_init(struct ceph_connection *con, void *private,
 	INIT_LIST_HEAD(&con->out_queue);
 	INIT_LIST_HEAD(&con->out_sent);
 	INIT_DELAYED_WORK(&con->work, ceph_con_workfn);
+	con->stats_start = jiffies;
 
 	con->state = CEPH_CON_S_CLOSED;
 }
@@ -1410,6 +1422,10 @@ void ceph_con_process_message(struct ceph_connection *con)
 		con->peer_name = msg->hdr.src;
 
 	con->in_seq++;
+	con->in_msgs++;
+	con->in_bytes += le32_to_cpu(msg->hdr.front_len) +
+			 le32_to_cpu(msg->hdr.middle_len) +
+			 le32_to_cpu(msg->hdr.data_len);
 	mutex_unlock(&con->mutex);
 
 	dout("===== %p %llu from %s%lld %d=%s len %d+%d+%d (%u %u %u) =====\n",
@@ -2123,6 +2139,11 @@ void ceph_con_get_out_msg(struct ceph_connection *con)
 	 */
 	list_move_tail(&msg->list_head, &con->out_sent);
 
+	con->out_msgs++;
+	con->out_bytes += le32_to_cpu(msg->hdr.front_len) +
+			  le32_to_cpu(msg->hdr.middle_len) +
+			  le32_to_cpu(msg->hdr.data_len);
+
 	/*
 	 * Only assign outgoing seq # if we haven't sent this message
 	 * yet.  If it is requeued, resend with it's original seq.
@@ -4459,6 +4459,87 @@ int __dev_direct_xmit(struct sk_buff *skb, u16 queue_id)
 }
 EXPORT_SYMBOL(__dev_direct_xmit);
 
+/**
+ * __dev_direct_xmit_bulk - transmit a batch of skbs on one queue
+ * @dev: device all skbs are sent on
+ * @skbs: skbs to send, the slots of skbs dropped by validation are cleared
+ * @n: number of skbs
+ * @queue_id: tx queue to use
+ * @sent: set to the number of leading slots handed to the driver or dropped
+ *
+ * Bulk variant of __dev_direct_xmit(). The tx queue lock is taken once and
+ * the driver learns about further skbs through xmit_more, so that it can
+ * ring its doorbell once per batch.
+ *
+ * Return: NETDEV_TX_OK, NET_XMIT_DROP if any skb was dropped, or
+ * NETDEV_TX_BUSY if the queue stopped, in which case the skbs from
+ * *@sent on were not consumed.
+ */
+int __dev_direct_xmit_bulk(struct net_device *dev, struct sk_buff **skbs,
+			   unsigned int n, u16 queue_id, unsigned int *sent)
+{
+	unsigned int i, last = 0;
+	struct netdev_queue *txq;
+	int ret = NETDEV_TX_OK;
+	bool again = false;
+	int rc;
+
+	if (unlikely(!netif_running(dev) ||
+		     !netif_carrier_ok(dev))) {
+		for (i = 0; i < n; i++) {
+			dev_core_stats_tx_dropped_inc(dev);
+			kfree_skb_list(skbs[i]);
+			skbs[i] = NULL;
+		}
+		*sent = n;
+		return NET_XMIT_DROP;
+	}
+
+	for (i = 0; i < n; i++) {
+		struct sk_buff *skb = validate_xmit_skb_list(skbs[i], dev, &again);
+
+		if (unlikely(skb != skbs[i])) {
+			dev_core_stats_tx_dropped_inc(dev);
+			kfree_skb_list(skb);
+			skbs[i] = NULL;
+			ret = NET_XMIT_DROP;
+			continue;
+		}
+		skb_set_queue_mapping(skb, queue_id);
+		last = i + 1;
+	}
+
+	txq = netdev_get_tx_queue(dev, queue_id);
+
+	local_bh_disable();
+
+	dev_xmit_recursion_inc();
+	HARD_TX_LOCK(dev, txq, smp_processor_id());
+	for (i = 0; i < last; i++) {
+		if (!skbs[i])
+			continue;
+		if (netif_xmit_frozen_or_drv_stopped(txq)) {
+			ret = NETDEV_TX_BUSY;
+			break;
+		}
+		rc = netdev_start_xmit(skbs[i], dev, txq, i + 1 < last);
+		if (rc == NETDEV_TX_BUSY) {
+			ret = NETDEV_TX_BUSY;
+			break;
+		}
+		if (rc == NET_XMIT_DROP)
+			ret = NET_XMIT_DROP;
+	}
+	HARD_TX_UNLOCK(dev, txq);
+	dev_xmit_recursion_dec();
+
+	local_bh_enable();
+
+	*sent = ret == NETDEV_TX_BUSY ? i : n;
+	return ret;
+}
+EXPORT_SYMBOL(__dev_direct_xmit_bulk);
+
 /*************************************************************************
  *			Receiver routines
  *************************************************************************/
@@ -4542,6 +4623,7 @@ set_rps_cpu(struct net_device *dev, struct sk_buff *skb,
 							rxq_index, flow_id);
 		if (rc < 0)
 			goto out;
+		this_cpu_inc(softnet_data.rfs_accel_steered);
 		old_rflow = rflow;
 		rflow = &flow_table->flows[flow_id];
 		WRITE_ONCE(rflow->filter, rc);
@@ -4598,18 +4680,25 @@ static int get_rps_cpu(struct net_device *dev, struct sk_buff *skb,
 	if (!hash)
 		goto done;
 
-	sock_flow_table = rcu_dereference(net_hotdata.rps_sock_flow_table);
+	sock_flow_table = rps_sock_flow_table_get(dev_net(dev));
 	if (flow_table && sock_flow_table) {
 		struct rps_dev_flow *rflow;
 		u32 next_cpu;
 		u32 ident;
 
-		/* First check into global flow table if there is a match.
+		/* First check into sock flow table if there is a match.
 		 * This READ_ONCE() pairs with WRITE_ONCE() from rps_record_sock_flow().
 		 */
 		ident = READ_ONCE(sock_flow_table->ents[hash & sock_flow_table->mask]);
-		if ((ident ^ hash) & ~net_hotdata.rps_cpu_mask)
-			goto try_rps;
+		if (!rps_sock_flow_match(ident, hash)) {
+			u32 alt = rps_sock_flow_alt_index(sock_flow_table, hash);
+
+			ident = READ_ONCE(sock_flow_table->ents[alt]);
+			if (!rps_sock_flow_match(ident, hash)) {
+				this_cpu_inc(softnet_data.rfs_mismatch);
+				goto try_rps;
+			}
+		}
 
 		next_cpu = ident & net_hotdata.rps_cpu_mask;
 
@@ -4639,6 +4728,7 @@ static int get_rps_cpu(struct net_device *dev, struct sk_buff *skb,
 		}
 
 		if (tcpu < nr_cpu_ids && cpu_online(tcpu)) {
+			this_cpu_inc(softnet_data.rfs_steered);
 			*rflowp = rflow;
 			cpu = tcpu;
 			goto done;
@@ -5746,6 +5836,7 @@ static void __netif_receive_skb_list(struct list_head *head)
 	unsigned long noreclaim_flag = 0;
 	struct sk_buff *skb, *next;
 	bool pfmemalloc = false; /* Is current sublist PF_MEMALLOC? */
+	bool nf_batch = nf_ingress_xmit_batch_begin();
 
 	list_for_each_entry_safe(skb, next, head, list) {
 		if ((sk_memalloc_socks() && skb_pfmemalloc(skb)) != pfmemalloc) {
@@ -5766,6 +5857,8 @@ static void __netif_receive_skb_list(struct list_head *head)
 	/* Handle the remaining sublist */
 	if (!list_empty(head))
 		__netif_receive_skb_list_core(head, pfmemalloc);
+	/* Transmit what ingress hooks stole from the lists */
+	nf_ingress_xmit_batch_end(nf_batch);
 	/* Restore pflags */
 	if (pfmemalloc)
 		memalloc_noreclaim_restore(noreclaim_flag);
@@ -6183,12 +6276,12 @@ bool napi_complete_done(struct napi_struct *n, int work_done)
 
 	if (work_done) {
 		if (n->gro_bitmask)
-			timeout = READ_ONCE(n->dev->gro_flush_timeout);
-		n->defer_hard_irqs_count = READ_ONCE(n->dev->napi_defer_hard_irqs);
+			timeout = napi_get_gro_flush_timeout(n);
+		n->defer_hard_irqs_count = napi_get_defer_hard_irqs(n);
 	}
 	if (n->defer_hard_irqs_count > 0) {
 		n->defer_hard_irqs_count--;
-		timeout = READ_ONCE(n->dev->gro_flush_timeout);
+		timeout = napi_get_gro_flush_timeout(n);
 		if (timeout)
 			ret = false;
 	}
@@ -6320,8 +6413,8 @@ static void busy_poll_stop(struct napi_struct *napi, void *have_poll_lock,
 	local_bh_disable();
 
 	if (flags & NAPI_F_PREFER_BUSY_POLL) {
-		napi->defer_hard_irqs_count = READ_ONCE(napi->dev->napi_defer_hard_irqs);
-		timeout = READ_ONCE(napi->dev->gro_flush_timeout);
+		napi->defer_hard_irqs_count = napi_get_defer_hard_irqs(napi);
+		timeout = napi_get_gro_flush_timeout(napi);
 		if (napi->defer_hard_irqs_count && timeout) {
 			hrtimer_start(&napi->timer, ns_to_ktime(timeout), HRTIMER_MODE_REL_PINNED);
 			skip_schedule = true;
@@ -6448,6 +6541,55 @@ void napi_busy_loop(unsigned int napi_id,
 }
 EXPORT_SYMBOL(napi_busy_loop);
 
+/**
+ * napi_suspend_irqs - keep device interrupts of a NAPI masked
+ * @napi_id: id of the NAPI that busy polling just found events on
+ *
+ * While the application keeps finding events through busy polling, the
+ * deferral timer is re-armed with irq_suspend_timeout, which is meant to
+ * be longer than gro_flush_timeout. IRQs thereby stay masked until either
+ * napi_resume_irqs() is called or the application stops polling for
+ * irq_suspend_timeout, at which point napi_watchdog() takes over again.
+ */
+void napi_suspend_irqs(unsigned int napi_id)
+{
+	struct napi_struct *napi;
+
+	rcu_read_lock();
+	napi = napi_by_id(napi_id);
+	if (napi) {
+		unsigned long timeout = napi_get_irq_suspend_timeout(napi);
+
+		if (timeout)
+			hrtimer_start(&napi->timer, ns_to_ktime(timeout),
+				      HRTIMER_MODE_REL_PINNED);
+	}
+	rcu_read_unlock();
+}
+
+/**
+ * napi_resume_irqs - end an IRQ suspension started by napi_suspend_irqs()
+ * @napi_id: id of the NAPI that busy polling found no events on
+ */
+void napi_resume_irqs(unsigned int napi_id)
+{
+	struct napi_struct *napi;
+
+	rcu_read_lock();
+	napi = napi_by_id(napi_id);
+	if (napi) {
+		/* If irq_suspend_timeout was cleared since the suspension,
+		 * the armed timer still resumes irq processing in time.
+		 */
+		if (napi_get_irq_suspend_timeout(napi)) {
+			local_bh_disable();
+			napi_schedule(napi);
+			local_bh_enable();
+		}
+	}
+	rcu_read_unlock();
+}
+
 #endif /* CONFIG_NET_RX_BUSY_POLL */
 
 static void napi_hash_add(struct napi_struct *napi)
@@ -6505,10 +6647,73 @@ static void init_gro_hash(struct napi_struct *napi)
 	int i;
 
 	for (i = 0; i < GRO_HASH_BUCKETS; i++) {
-		INIT_LIST_HEAD(&napi->gro_hash[i].list);
-		napi->gro_hash[i].count = 0;
+		INIT_LIST_HEAD(&napi->gro_hash_default[i].list);
+		napi->gro_hash_default[i].count = 0;
 	}
+	napi->gro_hash = napi->gro_hash_default;
+	napi->gro_hash_mask = GRO_HASH_BUCKETS - 1;
+	napi->gro_hash_table = NULL;
+	napi->gro_hash_next = NULL;
 	napi->gro_bitmask = 0;
+	napi->gro_packets = 0;
+	napi->gro_merged = 0;
+	napi->gro_evicted = 0;
+}
+
+/**
+ * gro_hash_alloc - allocate a GRO table for napi_set_gro_hash()
+ * @nr_buckets: number of buckets, a power of 2 up to GRO_HASH_BUCKETS_MAX
+ *
+ * Return: the new table, or NULL on allocation failure.
+ */
+struct gro_hash *gro_hash_alloc(unsigned int nr_buckets)
+{
+	struct gro_hash *hash;
+	unsigned int i;
+
+	if (WARN_ON_ONCE(!is_power_of_2(nr_buckets) ||
+			 nr_buckets > GRO_HASH_BUCKETS_MAX))
+		return NULL;
+
+	hash = kzalloc(struct_size(hash, buckets, nr_buckets), GFP_KERNEL);
+	if (!hash)
+		return NULL;
+
+	hash->mask = nr_buckets - 1;
+	for (i = 0; i < nr_buckets; i++)
+		INIT_LIST_HEAD(&hash->buckets[i].list);
+
+	return hash;
+}
+
+/**
+ * napi_set_gro_hash - queue a GRO table for a NAPI instance
+ * @n: NAPI instance
+ * @hash: table from gro_hash_alloc(), owned by @n from now on
+ *
+ * The table can only be swapped by the owner of the NAPI, so this merely
+ * queues @hash; the instance flushes its held packets and switches over on
+ * its next poll. A table queued earlier and not yet picked up is freed.
+ */
+void napi_set_gro_hash(struct napi_struct *n, struct gro_hash *hash)
+{
+	kfree(xchg(&n->gro_hash_next, hash));
+}
+
+/* Called by the owner of the NAPI instance with a table queued. */
+void napi_gro_hash_resize(struct napi_struct *n)
+{
+	struct gro_hash *hash = xchg(&n->gro_hash_next, NULL);
+
+	if (!hash)
+		return;
+
+	napi_gro_flush(n, false);
+
+	kfree(n->gro_hash_table);
+	n->gro_hash_table = hash;
+	n->gro_hash = hash->buckets;
+	WRITE_ONCE(n->gro_hash_mask, hash->mask);
 }
 
 int dev_set_threaded(struct net_device *dev, bool threaded)
@@ -6603,11 +6808,18 @@ void netif_napi_add_weight(struct net_device *dev, struct napi_struct *napi,
 	INIT_LIST_HEAD(&napi->rx_list);
 	napi->rx_count = 0;
 	napi->poll = poll;
+	napi_set_defer_hard_irqs(napi, READ_ONCE(dev->napi_defer_hard_irqs));
+	napi_set_gro_flush_timeout(napi, READ_ONCE(dev->gro_flush_timeout));
 	if (weight > NAPI_POLL_WEIGHT)
 		netdev_err_once(dev, "%s() called with weight %d\n", __func__,
 				weight);
 	napi->weight = weight;
 	napi->dev = dev;
+	napi_set_thread_busy_poll_usecs(napi, 0);
+	napi_set_thread_busy_poll_budget(napi, 0);
+	napi->thread_poll_ns = 0;
+	napi->thread_idle_ns = 0;
+	napi->thread_sleeps = 0;
 #ifdef CONFIG_NETPOLL
 	napi->poll_owner = -1;
 #endif
@@ -6627,6 +6839,25 @@ void netif_napi_add_weight(struct net_device *dev, struct napi_struct *napi,
 }
 EXPORT_SYMBOL(netif_napi_add_weight);
 
+/**
+ * napi_init_for_gro - initialize a NAPI context used only for GRO
+ * @napi: NAPI context, zeroed by the caller
+ *
+ * For code running its own receive loop on skbs it built, such as the
+ * cpumap kthread, which wants napi_gro_receive(), napi_gro_flush() and
+ * gro_normal_list() without a device. The context is never scheduled,
+ * listed or hashed, and must be flushed before its memory is freed.
+ */
+void napi_init_for_gro(struct napi_struct *napi)
+{
+	INIT_LIST_HEAD(&napi->poll_list);
+	init_gro_hash(napi);
+	napi->skb = NULL;
+	INIT_LIST_HEAD(&napi->rx_list);
+	napi->rx_count = 0;
+	napi->list_owner = -1;
+}
+
 void napi_disable(struct napi_struct *n)
 {
 	unsigned long val, new;
@@ -6676,7 +6907,7 @@ static void flush_gro_hash(struct napi_struct *napi)
 {
 	int i;
 
-	for (i = 0; i < GRO_HASH_BUCKETS; i++) {
+	for (i = 0; i <= napi->gro_hash_mask; i++) {
 		struct sk_buff *skb, *n;
 
 		list_for_each_entry_safe(skb, n, &napi->gro_hash[i].list, list)
@@ -6696,7 +6927,9 @@ void __netif_napi_del(struct napi_struct *napi)
 	napi_free_frags(napi);
 
 	flush_gro_hash(napi);
-	napi->gro_bitmask = 0;
+	kfree(napi->gro_hash_table);
+	kfree(xchg(&napi->gro_hash_next, NULL));
+	init_gro_hash(napi);
 
 	if (napi->thread) {
 		kthread_stop(napi->thread);
@@ -6705,11 +6938,13 @@ void __netif_napi_del(struct napi_struct *napi)
 }
 EXPORT_SYMBOL(__netif_napi_del);
 
-static int __napi_poll(struct napi_struct *n, bool *repoll)
+static int __napi_poll(struct napi_struct *n, int weight, bool *repoll)
 {
-	int work, weight;
+	int work;
 
-	weight = n->weight;
+	/* Switch to a GRO table queued by napi_set_gro_hash() */
+	if (unlikely(READ_ONCE(n->gro_hash_next)))
+		napi_gro_hash_resize(n);
 
 	/* This NAPI_STATE_SCHED test is for avoiding a race
 	 * with netpoll's poll_napi().  Only the entity which
@@ -6788,7 +7023,7 @@ static int napi_poll(struct napi_struct *n, struct list_head *repoll)
 
 	have = netpoll_poll_lock(n);
 
-	work = __napi_poll(n, &do_repoll);
+	work = __napi_poll(n, n->weight, &do_repoll);
 
 	if (do_repoll)
 		list_add_tail(&n->poll_list, repoll);
@@ -6822,21 +7057,74 @@ static int napi_thread_wait(struct napi_struct *napi)
 	return -1;
 }
 
+/* Threaded busy polling keeps the kthread owning its NAPI instance and
+ * polling it with device interrupts off until the queue has been idle for
+ * thread_busy_poll_usecs. NAPI_STATE_IN_BUSY_POLL makes napi_complete_done()
+ * leave the instance scheduled, as it does for sk_busy_loop().
+ */
+static bool napi_thread_busy_poll_ok(struct napi_struct *napi)
+{
+	return napi_get_thread_busy_poll_usecs(napi) &&
+	       test_bit(NAPI_STATE_THREADED, &napi->state) &&
+	       !napi_disable_pending(napi) && !kthread_should_stop();
+}
+
+/* Called with bh disabled. The driver left the instance scheduled, deliver
+ * what it handed to GRO since napi_complete_done() did not.
+ */
+static void napi_thread_busy_poll_flush(struct napi_struct *napi)
+{
+	if (napi->gro_bitmask)
+		napi_gro_flush(napi, HZ >= 1000);
+	gro_normal_list(napi);
+}
+
+static void napi_thread_busy_poll_stop(struct napi_struct *napi)
+{
+	/* The next poll re-enables device interrupts and picks up whatever
+	 * raced with us, see busy_poll_stop().
+	 */
+	clear_bit(NAPI_STATE_MISSED, &napi->state);
+	clear_bit(NAPI_STATE_IN_BUSY_POLL, &napi->state);
+	WRITE_ONCE(napi->thread_sleeps, napi->thread_sleeps + 1);
+}
+
 static void napi_threaded_poll_loop(struct napi_struct *napi)
 {
 	struct softnet_data *sd;
 	unsigned long last_qs = jiffies;
+	u64 idle_since = 0, idle_limit = 0;
+	int budget = napi->weight;
+	bool busy = false;
+
+	if (napi_thread_busy_poll_ok(napi)) {
+		idle_limit = (u64)napi_get_thread_busy_poll_usecs(napi) *
+			     NSEC_PER_USEC;
+		budget = napi_get_thread_busy_poll_budget(napi);
+		if (!budget || budget > napi->weight)
+			budget = napi->weight;
+		idle_since = local_clock();
+		set_bit(NAPI_STATE_IN_BUSY_POLL, &napi->state);
+		busy = true;
+	}
 
 	for (;;) {
 		bool repoll = false;
+		u64 start = 0;
 		void *have;
+		int work;
+
+		if (busy)
+			start = local_clock();
 
 		local_bh_disable();
 		sd = this_cpu_ptr(&softnet_data);
 		sd->in_napi_threaded_poll = true;
 
 		have = netpoll_poll_lock(napi);
-		__napi_poll(napi, &repoll);
+		work = __napi_poll(napi, busy ? budget : napi->weight, &repoll);
+		if (busy && !repoll)
+			napi_thread_busy_poll_flush(napi);
 		netpoll_poll_unlock(have);
 
 		sd->in_napi_threaded_poll = false;
@@ -6849,6 +7137,26 @@ static void napi_threaded_poll_loop(struct napi_struct *napi)
 		skb_defer_free_flush(sd);
 		local_bh_enable();
 
+		if (busy) {
+			u64 now = local_clock();
+
+			if (work) {
+				WRITE_ONCE(napi->thread_poll_ns,
+					   napi->thread_poll_ns + now - start);
+				idle_since = now;
+			} else {
+				WRITE_ONCE(napi->thread_idle_ns,
+					   napi->thread_idle_ns + now - start);
+			}
+
+			if (now - idle_since > idle_limit ||
+			    !napi_thread_busy_poll_ok(napi)) {
+				napi_thread_busy_poll_stop(napi);
+				busy = false;
+			}
+			repoll = true;
+		}
+
 		if (!repoll)
 			break;
 
@@ -11571,7 +11879,8 @@ static struct hlist_head * __net_init netdev_create_hash(void)
 /* Initialize per network namespace state */
 static int __net_init netdev_init(struct net *net)
 {
-	BUILD_BUG_ON(GRO_HASH_BUCKETS >
+	BUILD_BUG_ON(GRO_HASH_BUCKETS > GRO_HASH_BUCKETS_MAX);
+	BUILD_BUG_ON(GRO_HASH_BUCKETS_MAX >
 		     8 * sizeof_field(struct napi_struct, gro_bitmask));
 
 	INIT_LIST_HEAD(&net->dev_base_head);
@@ -35,6 +35,176 @@ void dev_addr_flush(struct net_device *dev);
 int dev_addr_init(struct net_device *dev);
 void dev_addr_check(struct net_device *dev);
 
+/**
+ * napi_get_defer_hard_irqs - get the NAPI's defer_hard_irqs
+ * @n: napi struct to get the defer_hard_irqs field from
+ *
+ * Return: the per-NAPI value of the defer_hard_irqs field.
+ */
+static inline u32 napi_get_defer_hard_irqs(const struct napi_struct *n)
+{
+	return READ_ONCE(n->defer_hard_irqs);
+}
+
+/**
+ * napi_set_defer_hard_irqs - set the defer_hard_irqs for a napi
+ * @n: napi_struct to set the defer_hard_irqs field
+ * @defer: the value the field should be set to
+ */
+static inline void napi_set_defer_hard_irqs(struct napi_struct *n, u32 defer)
+{
+	WRITE_ONCE(n->defer_hard_irqs, defer);
+}
+
+/**
+ * netdev_set_defer_hard_irqs - set defer_hard_irqs for all NAPIs of a netdev
+ * @netdev: the net_device for which all NAPIs will have defer_hard_irqs set
+ * @defer: the defer_hard_irqs value to set
+ */
+static inline void netdev_set_defer_hard_irqs(struct net_device *netdev,
+					      u32 defer)
+{
+	struct napi_struct *napi;
+
+	WRITE_ONCE(netdev->napi_defer_hard_irqs, defer);
+	list_for_each_entry(napi, &netdev->napi_list, dev_list)
+		napi_set_defer_hard_irqs(napi, defer);
+}
+
+/**
+ * napi_get_gro_flush_timeout - get the gro_flush_timeout
+ * @n: napi struct to get the gro_flush_timeout from
+ *
+ * Return: the per-NAPI value of the gro_flush_timeout field.
+ */
+static inline unsigned long
+napi_get_gro_flush_timeout(const struct napi_struct *n)
+{
+	return READ_ONCE(n->gro_flush_timeout);
+}
+
+/**
+ * napi_set_gro_flush_timeout - set the gro_flush_timeout for a napi
+ * @n: napi struct to set the gro_flush_timeout
+ * @timeout: timeout value to set
+ */
+static inline void napi_set_gro_flush_timeout(struct napi_struct *n,
+					      unsigned long timeout)
+{
+	WRITE_ONCE(n->gro_flush_timeout, timeout);
+}
+
+/**
+ * netdev_set_gro_flush_timeout - set gro_flush_timeout of a netdev's NAPIs
+ * @netdev: the net_device for which all NAPIs will have gro_flush_timeout set
+ * @timeout: the timeout value to set
+ */
+static inline void netdev_set_gro_flush_timeout(struct net_device *netdev,
+						unsigned long timeout)
+{
+	struct napi_struct *napi;
+
+	WRITE_ONCE(netdev->gro_flush_timeout, timeout);
+	list_for_each_entry(napi, &netdev->napi_list, dev_list)
+		napi_set_gro_flush_timeout(napi, timeout);
+}
+
+/**
+ * napi_get_irq_suspend_timeout - get the irq_suspend_timeout
+ * @n: napi struct to get the irq_suspend_timeout from
+ *
+ * Return: the per-NAPI value of the irq_suspend_timeout field.
+ */
+static inline unsigned long
+napi_get_irq_suspend_timeout(const struct napi_struct *n)
+{
+	return READ_ONCE(n->irq_suspend_timeout);
+}
+
+/**
+ * napi_set_irq_suspend_timeout - set the irq_suspend_timeout for a napi
+ * @n: napi struct to set the irq_suspend_timeout
+ * @timeout: timeout value to set
+ */
+static inline void napi_set_irq_suspend_timeout(struct napi_struct *n,
+						unsigned long timeout)
+{
+	WRITE_ONCE(n->irq_suspend_timeout, timeout);
+}
+
+/**
+ * napi_get_thread_busy_poll_usecs - get the threaded busy poll idle limit
+ * @n: napi struct to get the limit from
+ *
+ * Return: how long the NAPI kthread keeps polling an idle queue before
+ * re-enabling interrupts and sleeping, 0 if threaded busy polling is off.
+ */
+static inline u32 napi_get_thread_busy_poll_usecs(const struct napi_struct *n)
+{
+	return READ_ONCE(n->thread_busy_poll_usecs);
+}
+
+/**
+ * napi_set_thread_busy_poll_usecs - set the threaded busy poll idle limit
+ * @n: napi struct to set the limit for
+ * @usecs: idle time in microseconds, 0 disables threaded busy polling
+ *
+ * Only has an effect while the NAPI instance runs in threaded mode. The
+ * kthread picks the new value up on its next wakeup.
+ */
+static inline void napi_set_thread_busy_poll_usecs(struct napi_struct *n,
+						   u32 usecs)
+{
+	WRITE_ONCE(n->thread_busy_poll_usecs, usecs);
+}
+
+/**
+ * napi_get_thread_busy_poll_budget - get the threaded busy poll budget
+ * @n: napi struct to get the budget from
+ *
+ * Return: the budget passed to each poll while busy polling, 0 for the
+ * instance's weight.
+ */
+static inline u32 napi_get_thread_busy_poll_budget(const struct napi_struct *n)
+{
+	return READ_ONCE(n->thread_busy_poll_budget);
+}
+
+/**
+ * napi_set_thread_busy_poll_budget - set the threaded busy poll budget
+ * @n: napi struct to set the budget for
+ * @budget: per poll budget, values above the weight are capped to it
+ */
+static inline void napi_set_thread_busy_poll_budget(struct napi_struct *n,
+						    u32 budget)
+{
+	WRITE_ONCE(n->thread_busy_poll_budget, budget);
+}
+
+/* A GRO table installed with napi_set_gro_hash(), @mask + 1 is a power of 2 */
+struct gro_hash {
+	unsigned int		mask;
+	struct gro_list		buckets[];
+};
+
+struct gro_hash *gro_hash_alloc(unsigned int nr_buckets);
+void napi_set_gro_hash(struct napi_struct *n, struct gro_hash *hash);
+void napi_gro_hash_resize(struct napi_struct *n);
+
+/**
+ * napi_get_gro_hash_buckets - get the number of GRO hash buckets in use
+ * @n: napi struct to get the bucket count from
+ *
+ * A table installed with napi_set_gro_hash() is only reported once the NAPI
+ * instance has switched to it on its next poll.
+ *
+ * Return: the per-NAPI number of GRO hash buckets.
+ */
+static inline unsigned int napi_get_gro_hash_buckets(const struct napi_struct *n)
+{
+	return READ_ONCE(n->gro_hash_mask) + 1;
+}
+
 /* sysctls not referred to from outside net/core/ */
 extern int		netdev_unregister_timeout_secs;
 extern int		weight_p;
@@ -112,6 +112,9 @@ int skb_gro_receive(struct sk_buff *p, struct sk_buff *skb)
 	if (p->pp_recycle != skb->pp_recycle)
 		return -ETOOMANYREFS;
 
+	if (skb_frags_readable(p) != skb_frags_readable(skb))
+		return -EFAULT;
+
 	/* pairs with WRITE_ONCE() in netif_set_gro(_ipv4)_max_size() */
 	gro_max_size = p->protocol == htons(ETH_P_IPV6) ?
 			READ_ONCE(p->dev->gro_max_size) :
@@ -408,7 +411,8 @@ static inline void skb_gro_reset_offset(struct sk_buff *skb, u32 nhoff)
 	pinfo = skb_shinfo(skb);
 	frag0 = &pinfo->frags[0];
 
-	if (pinfo->nr_frags && !PageHighMem(skb_frag_page(frag0)) &&
+	if (pinfo->nr_frags && skb_frags_readable(skb) &&
+	    !PageHighMem(skb_frag_page(frag0)) &&
 	    (!NET_IP_ALIGN || !((skb_frag_off(frag0) + nhoff) & 3))) {
 		NAPI_GRO_CB(skb)->frag0 = skb_frag_address(frag0);
 		NAPI_GRO_CB(skb)->frag0_len = min_t(unsigned int,
@@ -446,28 +450,38 @@ static void gro_try_pull_from_frag0(struct sk_buff *skb)
 		gro_pull_from_frag0(skb, grow);
 }
 
-static void gro_flush_oldest(struct napi_struct *napi, struct list_head *head)
+/* Pick the held skb that has aggregated the fewest segments, the oldest one
+ * on ties. With a high fan-in of short flows, evicting strictly by age keeps
+ * flushing the few flows that coalesce well (including trains that hardware
+ * GRO already aggregated); this keeps them in the table instead.
+ */
+static void gro_flush_victim(struct napi_struct *napi, struct list_head *head)
 {
-	struct sk_buff *oldest;
+	struct sk_buff *victim = NULL, *p;
 
-	oldest = list_last_entry(head, struct sk_buff, list);
+	/* Walk from the oldest, i.e. the tail of the list. */
+	list_for_each_entry_reverse(p, head, list) {
+		if (!victim || NAPI_GRO_CB(p)->count < NAPI_GRO_CB(victim)->count)
+			victim = p;
+	}
 
 	/* We are called with head length >= MAX_GRO_SKBS, so this is
 	 * impossible.
 	 */
-	if (WARN_ON_ONCE(!oldest))
+	if (WARN_ON_ONCE(!victim))
 		return;
 
 	/* Do not adjust napi->gro_hash[].count, caller is adding a new
 	 * SKB to the chain.
 	 */
-	skb_list_del_init(oldest);
-	napi_gro_complete(napi, oldest);
+	skb_list_del_init(victim);
+	napi_gro_complete(napi, victim);
+	WRITE_ONCE(napi->gro_evicted, napi->gro_evicted + 1);
 }
 
 static enum gro_result dev_gro_receive(struct napi_struct *napi, struct sk_buff *skb)
 {
-	u32 bucket = skb_get_hash_raw(skb) & (GRO_HASH_BUCKETS - 1);
+	u32 bucket = skb_get_hash_raw(skb) & napi->gro_hash_mask;
 	struct gro_list *gro_list = &napi->gro_hash[bucket];
 	struct list_head *head = &net_hotdata.offload_base;
 	struct packet_offload *ptype;
@@ -490,6 +504,7 @@ static enum gro_result dev_gro_receive(struct napi_struct *napi, struct sk_buff
 	goto normal;
 
 found_ptype:
+	WRITE_ONCE(napi->gro_packets, napi->gro_packets + 1);
 	skb_set_network_header(skb, skb_gro_offset(skb));
 	skb_reset_mac_len(skb);
 	BUILD_BUG_ON(sizeof_field(struct napi_gro_cb, zeroed) != sizeof(u32));
@@ -530,6 +545,8 @@ static enum gro_result dev_gro_receive(struct napi_struct *napi, struct sk_buff
 
 	same_flow = NAPI_GRO_CB(skb)->same_flow;
 	ret = NAPI_GRO_CB(skb)->free ? GRO_MERGED_FREE : GRO_MERGED;
+	if (same_flow)
+		WRITE_ONCE(napi->gro_merged, napi->gro_merged + 1);
 
 	if (pp) {
 		skb_list_del_init(pp);
@@ -544,7 +561,7 @@ static enum gro_result dev_gro_receive(struct napi_struct *napi, struct sk_buff
 		goto normal;
 
 	if (unlikely(gro_list->count >= MAX_GRO_SKBS))
-		gro_flush_oldest(napi, &gro_list->list);
+		gro_flush_victim(napi, &gro_list->list);
 	else
 		gro_list->count++;
 
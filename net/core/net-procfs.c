@@ -126,6 +126,7 @@ static int softnet_seq_show(struct seq_file *seq, void *v)
 	u32 input_qlen = softnet_input_pkt_queue_len(sd);
 	u32 process_qlen = softnet_process_queue_len(sd);
 	unsigned int flow_limit_count = 0;
+	unsigned int rfs_steered = 0, rfs_mismatch = 0, rfs_accel_steered = 0;
 
 #ifdef CONFIG_NET_FLOW_LIMIT
 	struct sd_flow_limit *fl;
@@ -136,6 +137,11 @@ static int softnet_seq_show(struct seq_file *seq, void *v)
 		flow_limit_count = fl->count;
 	rcu_read_unlock();
 #endif
+#ifdef CONFIG_RPS
+	rfs_steered = READ_ONCE(sd->rfs_steered);
+	rfs_mismatch = READ_ONCE(sd->rfs_mismatch);
+	rfs_accel_steered = READ_ONCE(sd->rfs_accel_steered);
+#endif
 
 	/* the index is the CPU id owing this sd. Since offline CPUs are not
 	 * displayed, it would be othrwise not trivial for the user-space
@@ -143,14 +149,17 @@ static int softnet_seq_show(struct seq_file *seq, void *v)
 	 */
 	seq_printf(seq,
 		   "%08x %08x %08x %08x %08x %08x %08x %08x %08x %08x %08x %08x %08x "
-		   "%08x %08x\n",
+		   "%08x %08x %08x %08x %08x %08x %08x\n",
 		   sd->processed, atomic_read(&sd->dropped),
 		   sd->time_squeeze, 0,
 		   0, 0, 0, 0, /* was fastroute */
 		   0,	/* was cpu_collision */
 		   sd->received_rps, flow_limit_count,
 		   input_qlen + process_qlen, (int)seq->index,
-		   input_qlen, process_qlen);
+		   input_qlen, process_qlen,
+		   rfs_steered, rfs_mismatch, rfs_accel_steered,
+		   READ_ONCE(sd->skb_tx_cache_hit),
+		   READ_ONCE(sd->skb_tx_cache_miss));
 	return 0;
 }
 
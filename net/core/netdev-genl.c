@@ -13,6 +13,7 @@
 
 #include "netdev-genl-gen.h"
 #include "dev.h"
+#include "devmem.h"
 
 struct netdev_nl_dump_ctx {
 	unsigned long	ifindex;
@@ -188,6 +189,40 @@ netdev_nl_napi_fill_one(struct sk_buff *rsp, struct napi_struct *napi,
 			goto nla_put_failure;
 	}
 
+	if (nla_put_u32(rsp, NETDEV_A_NAPI_DEFER_HARD_IRQS,
+			napi_get_defer_hard_irqs(napi)))
+		goto nla_put_failure;
+
+	if (nla_put_uint(rsp, NETDEV_A_NAPI_GRO_FLUSH_TIMEOUT,
+			 napi_get_gro_flush_timeout(napi)))
+		goto nla_put_failure;
+
+	if (nla_put_uint(rsp, NETDEV_A_NAPI_IRQ_SUSPEND_TIMEOUT,
+			 napi_get_irq_suspend_timeout(napi)))
+		goto nla_put_failure;
+
+	if (nla_put_u32(rsp, NETDEV_A_NAPI_GRO_HASH_BUCKETS,
+			napi_get_gro_hash_buckets(napi)) ||
+	    nla_put_uint(rsp, NETDEV_A_NAPI_GRO_PACKETS,
+			 READ_ONCE(napi->gro_packets)) ||
+	    nla_put_uint(rsp, NETDEV_A_NAPI_GRO_MERGED,
+			 READ_ONCE(napi->gro_merged)) ||
+	    nla_put_uint(rsp, NETDEV_A_NAPI_GRO_EVICTED,
+			 READ_ONCE(napi->gro_evicted)))
+		goto nla_put_failure;
+
+	if (nla_put_u32(rsp, NETDEV_A_NAPI_THREADED_BUSY_POLL_USECS,
+			napi_get_thread_busy_poll_usecs(napi)) ||
+	    nla_put_u32(rsp, NETDEV_A_NAPI_THREADED_BUSY_POLL_BUDGET,
+			napi_get_thread_busy_poll_budget(napi)) ||
+	    nla_put_uint(rsp, NETDEV_A_NAPI_THREAD_POLL_TIME,
+			 READ_ONCE(napi->thread_poll_ns)) ||
+	    nla_put_uint(rsp, NETDEV_A_NAPI_THREAD_IDLE_TIME,
+			 READ_ONCE(napi->thread_idle_ns)) ||
+	    nla_put_uint(rsp, NETDEV_A_NAPI_THREAD_SLEEPS,
+			 READ_ONCE(napi->thread_sleeps)))
+		goto nla_put_failure;
+
 	genlmsg_end(rsp, hdr);
 
 	return 0;
@@ -288,6 +323,84 @@ int netdev_nl_napi_get_dumpit(struct sk_buff *skb, struct netlink_callback *cb)
 	return err;
 }
 
+static int netdev_nl_napi_set_config(struct napi_struct *napi,
+				     struct gro_hash *gro_hash,
+				     struct genl_info *info)
+{
+	if (info->attrs[NETDEV_A_NAPI_DEFER_HARD_IRQS])
+		napi_set_defer_hard_irqs(napi,
+			nla_get_u32(info->attrs[NETDEV_A_NAPI_DEFER_HARD_IRQS]));
+
+	if (info->attrs[NETDEV_A_NAPI_GRO_FLUSH_TIMEOUT])
+		napi_set_gro_flush_timeout(napi,
+			nla_get_uint(info->attrs[NETDEV_A_NAPI_GRO_FLUSH_TIMEOUT]));
+
+	if (info->attrs[NETDEV_A_NAPI_IRQ_SUSPEND_TIMEOUT])
+		napi_set_irq_suspend_timeout(napi,
+			nla_get_uint(info->attrs[NETDEV_A_NAPI_IRQ_SUSPEND_TIMEOUT]));
+
+	if (info->attrs[NETDEV_A_NAPI_THREADED_BUSY_POLL_USECS])
+		napi_set_thread_busy_poll_usecs(napi,
+			nla_get_u32(info->attrs[NETDEV_A_NAPI_THREADED_BUSY_POLL_USECS]));
+
+	if (info->attrs[NETDEV_A_NAPI_THREADED_BUSY_POLL_BUDGET])
+		napi_set_thread_busy_poll_budget(napi,
+			nla_get_u32(info->attrs[NETDEV_A_NAPI_THREADED_BUSY_POLL_BUDGET]));
+
+	if (gro_hash)
+		napi_set_gro_hash(napi, gro_hash);
+
+	return 0;
+}
+
+int netdev_nl_napi_set_doit(struct sk_buff *skb, struct genl_info *info)
+{
+	struct gro_hash *gro_hash = NULL;
+	struct napi_struct *napi;
+	unsigned int napi_id;
+	int err;
+
+	if (GENL_REQ_ATTR_CHECK(info, NETDEV_A_NAPI_ID))
+		return -EINVAL;
+
+	napi_id = nla_get_u32(info->attrs[NETDEV_A_NAPI_ID]);
+
+	if (info->attrs[NETDEV_A_NAPI_GRO_HASH_BUCKETS]) {
+		struct nlattr *attr = info->attrs[NETDEV_A_NAPI_GRO_HASH_BUCKETS];
+		u32 nr = nla_get_u32(attr);
+
+		if (!is_power_of_2(nr) || nr > GRO_HASH_BUCKETS_MAX) {
+			NL_SET_ERR_MSG_ATTR_FMT(info->extack, attr,
+						"must be a power of 2 up to %u",
+						GRO_HASH_BUCKETS_MAX);
+			return -EINVAL;
+		}
+
+		gro_hash = gro_hash_alloc(nr);
+		if (!gro_hash)
+			return -ENOMEM;
+	}
+
+	rtnl_lock();
+	rcu_read_lock();
+
+	napi = napi_by_id(napi_id);
+	if (napi) {
+		err = netdev_nl_napi_set_config(napi, gro_hash, info);
+		gro_hash = NULL;
+	} else {
+		NL_SET_BAD_ATTR(info->extack, info->attrs[NETDEV_A_NAPI_ID]);
+		err = -ENOENT;
+	}
+
+	rcu_read_unlock();
+	rtnl_unlock();
+
+	kfree(gro_hash);
+
+	return err;
+}
+
 static int
 netdev_nl_queue_fill_one(struct sk_buff *rsp, struct net_device *netdev,
 			 u32 q_idx, u32 q_type, const struct genl_info *info)
@@ -721,6 +834,130 @@ int netdev_nl_qstats_get_dumpit(struct sk_buff *skb,
 	return err;
 }
 
+int netdev_nl_bind_rx_doit(struct sk_buff *skb, struct genl_info *info)
+{
+	struct nlattr *tb[ARRAY_SIZE(netdev_queue_id_nl_policy)];
+	struct net_devmem_dmabuf_binding *binding;
+	struct list_head *sock_binding_list;
+	u32 ifindex, dmabuf_fd, rxq_idx;
+	struct net_device *netdev;
+	struct sk_buff *rsp;
+	struct nlattr *attr;
+	int rem, err = 0;
+	void *hdr;
+
+	if (GENL_REQ_ATTR_CHECK(info, NETDEV_A_DMABUF_IFINDEX) ||
+	    GENL_REQ_ATTR_CHECK(info, NETDEV_A_DMABUF_FD) ||
+	    GENL_REQ_ATTR_CHECK(info, NETDEV_A_DMABUF_QUEUES))
+		return -EINVAL;
+
+	ifindex = nla_get_u32(info->attrs[NETDEV_A_DMABUF_IFINDEX]);
+	dmabuf_fd = nla_get_u32(info->attrs[NETDEV_A_DMABUF_FD]);
+
+	/* Bindings live as long as the netlink socket that created them */
+	sock_binding_list = genl_sk_priv_get(&netdev_nl_family,
+					     NETLINK_CB(skb).sk);
+	if (IS_ERR(sock_binding_list))
+		return PTR_ERR(sock_binding_list);
+
+	rsp = genlmsg_new(GENLMSG_DEFAULT_SIZE, GFP_KERNEL);
+	if (!rsp)
+		return -ENOMEM;
+
+	hdr = genlmsg_iput(rsp, info);
+	if (!hdr) {
+		err = -EMSGSIZE;
+		goto err_genlmsg_free;
+	}
+
+	rtnl_lock();
+
+	netdev = __dev_get_by_index(genl_info_net(info), ifindex);
+	if (!netdev || !netif_device_present(netdev)) {
+		err = -ENODEV;
+		goto err_unlock;
+	}
+
+	if (dev_xdp_prog_count(netdev)) {
+		NL_SET_ERR_MSG(info->extack, "unable to bind dmabuf to device with XDP program attached");
+		err = -EEXIST;
+		goto err_unlock;
+	}
+
+	binding = net_devmem_bind_dmabuf(netdev, dmabuf_fd, info->extack);
+	if (IS_ERR(binding)) {
+		err = PTR_ERR(binding);
+		goto err_unlock;
+	}
+
+	nla_for_each_attr_type(attr, NETDEV_A_DMABUF_QUEUES,
+			       genlmsg_data(info->genlhdr),
+			       genlmsg_len(info->genlhdr), rem) {
+		err = nla_parse_nested(tb,
+				       ARRAY_SIZE(netdev_queue_id_nl_policy) - 1,
+				       attr, netdev_queue_id_nl_policy,
+				       info->extack);
+		if (err < 0)
+			goto err_unbind;
+
+		if (NL_REQ_ATTR_CHECK(info->extack, attr, tb, NETDEV_A_QUEUE_ID) ||
+		    NL_REQ_ATTR_CHECK(info->extack, attr, tb, NETDEV_A_QUEUE_TYPE)) {
+			err = -EINVAL;
+			goto err_unbind;
+		}
+
+		if (nla_get_u32(tb[NETDEV_A_QUEUE_TYPE]) != NETDEV_QUEUE_TYPE_RX) {
+			NL_SET_BAD_ATTR(info->extack, tb[NETDEV_A_QUEUE_TYPE]);
+			err = -EINVAL;
+			goto err_unbind;
+		}
+
+		rxq_idx = nla_get_u32(tb[NETDEV_A_QUEUE_ID]);
+
+		err = net_devmem_bind_dmabuf_to_queue(netdev, rxq_idx, binding,
+						      info->extack);
+		if (err)
+			goto err_unbind;
+	}
+
+	if (nla_put_u32(rsp, NETDEV_A_DMABUF_ID, binding->id)) {
+		err = -EMSGSIZE;
+		goto err_unbind;
+	}
+
+	list_add(&binding->list, sock_binding_list);
+	rtnl_unlock();
+
+	genlmsg_end(rsp, hdr);
+
+	return genlmsg_reply(rsp, info);
+
+err_unbind:
+	net_devmem_unbind_dmabuf(binding);
+err_unlock:
+	rtnl_unlock();
+err_genlmsg_free:
+	nlmsg_free(rsp);
+	return err;
+}
+
+void netdev_nl_sock_priv_init(struct list_head *priv)
+{
+	INIT_LIST_HEAD(priv);
+}
+
+void netdev_nl_sock_priv_destroy(struct list_head *priv)
+{
+	struct net_devmem_dmabuf_binding *binding;
+	struct net_devmem_dmabuf_binding *temp;
+
+	list_for_each_entry_safe(binding, temp, priv, list) {
+		rtnl_lock();
+		net_devmem_unbind_dmabuf(binding);
+		rtnl_unlock();
+	}
+}
+
 static int netdev_genl_netdevice_event(struct notifier_block *nb,
 				       unsigned long event, void *ptr)
 {
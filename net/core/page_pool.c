@@ -21,9 +21,12 @@
 #include <linux/poison.h>
 #include <linux/ethtool.h>
 #include <linux/netdevice.h>
+#include <linux/rtnetlink.h>
 
 #include <trace/events/page_pool.h>
+#include <net/netdev_rx_queue.h>
 
+#include "devmem.h"
 #include "page_pool_priv.h"
 
 #define DEFER_TIME (msecs_to_jiffies(1000))
@@ -61,6 +64,9 @@ static const char pp_stats[][ETH_GSTRING_LEN] = {
 	"rx_pp_recycle_ring",
 	"rx_pp_recycle_ring_full",
 	"rx_pp_recycle_released_ref",
+	"rx_pp_alloc_nid_changed",
+	"rx_pp_alloc_cross_node",
+	"rx_pp_recycle_remote_node",
 };
 
 /**
@@ -89,6 +95,8 @@ bool page_pool_get_stats(const struct page_pool *pool,
 	stats->alloc_stats.empty += pool->alloc_stats.empty;
 	stats->alloc_stats.refill += pool->alloc_stats.refill;
 	stats->alloc_stats.waive += pool->alloc_stats.waive;
+	stats->alloc_stats.nid_changed += pool->alloc_stats.nid_changed;
+	stats->alloc_stats.cross_node += pool->alloc_stats.cross_node;
 
 	for_each_possible_cpu(cpu) {
 		const struct page_pool_recycle_stats *pcpu =
@@ -99,6 +107,7 @@ bool page_pool_get_stats(const struct page_pool *pool,
 		stats->recycle_stats.ring += pcpu->ring;
 		stats->recycle_stats.ring_full += pcpu->ring_full;
 		stats->recycle_stats.released_refcnt += pcpu->released_refcnt;
+		stats->recycle_stats.remote_node += pcpu->remote_node;
 	}
 
 	return true;
@@ -139,6 +148,9 @@ u64 *page_pool_ethtool_stats_get(u64 *data, const void *stats)
 	*data++ = pool_stats->recycle_stats.ring;
 	*data++ = pool_stats->recycle_stats.ring_full;
 	*data++ = pool_stats->recycle_stats.released_refcnt;
+	*data++ = pool_stats->alloc_stats.nid_changed;
+	*data++ = pool_stats->alloc_stats.cross_node;
+	*data++ = pool_stats->recycle_stats.remote_node;
 
 	return data;
 }
@@ -186,6 +198,7 @@ static int page_pool_init(struct page_pool *pool,
 			  int cpuid)
 {
 	unsigned int ring_qsize = 1024; /* Default */
+	int err;
 
 	page_pool_struct_check();
 
@@ -264,10 +277,47 @@ static int page_pool_init(struct page_pool *pool,
 	/* Driver calling page_pool_create() also call page_pool_destroy() */
 	refcount_set(&pool->user_cnt, 1);
 
+	if (pool->slow.flags & PP_FLAG_ALLOW_UNREADABLE_NETMEM) {
+		struct netdev_rx_queue *rxq;
+
+		/* The memory provider of the queue is configured under RTNL,
+		 * see net_devmem_bind_dmabuf_to_queue().
+		 */
+		ASSERT_RTNL();
+
+		if (!pool->slow.netdev ||
+		    pool->slow.queue_idx >= pool->slow.netdev->real_num_rx_queues) {
+			err = -EINVAL;
+			goto err_uninit_ring;
+		}
+
+		rxq = __netif_get_rx_queue(pool->slow.netdev,
+					   pool->slow.queue_idx);
+		pool->mp_priv = rxq->mp_params.mp_priv;
+	}
+
+	if (pool->mp_priv) {
+		err = mp_dmabuf_devmem_init(pool);
+		if (err) {
+			pr_warn("%s() mem-provider init failed %d\n", __func__,
+				err);
+			pool->mp_priv = NULL;
+			goto err_uninit_ring;
+		}
+	}
+
 	if (pool->dma_map)
 		get_device(pool->p.dev);
 
 	return 0;
+
+err_uninit_ring:
+	ptr_ring_cleanup(&pool->ring, NULL);
+#ifdef CONFIG_PAGE_POOL_STATS
+	if (!pool->system)
+		free_percpu(pool->recycle_stats);
+#endif
+	return err;
 }
 
 static void page_pool_uninit(struct page_pool *pool)
@@ -336,6 +386,19 @@ static struct page *page_pool_refill_alloc_cache(struct page_pool *pool)
 	struct page *page;
 	int pref_nid; /* preferred NUMA node */
 
+#ifdef CONFIG_NUMA
+	/* Follow the consumer when it moved to another node, e.g. after an
+	 * IRQ affinity change or a threaded NAPI migration, so that refill
+	 * and slow path stop handing out remote pages. The alloc cache is
+	 * empty here, switching is cheap. Memory providers own their memory.
+	 */
+	if (unlikely(pool->p.nid != NUMA_NO_NODE &&
+		     pool->p.nid != numa_mem_id()) && !pool->mp_priv) {
+		page_pool_nid_changed(pool, numa_mem_id());
+		alloc_stat_inc(pool, nid_changed);
+	}
+#endif
+
 	/* Quicker fallback, avoid locks when ring is empty */
 	if (__ptr_ring_empty(r)) {
 		alloc_stat_inc(pool, empty);
@@ -509,6 +572,11 @@ static struct page *__page_pool_alloc_pages_slow(struct page_pool *pool,
 	bool dma_map = pool->dma_map;
 	struct page *page;
 	int i, nr_pages;
+	int pref_nid;
+
+	/* Pools backed by a memory provider never hand out host pages */
+	if (WARN_ON_ONCE(pool->mp_priv))
+		return NULL;
 
 	/* Don't support bulk alloc for high-order pages */
 	if (unlikely(pp_order))
@@ -518,6 +586,8 @@ static struct page *__page_pool_alloc_pages_slow(struct page_pool *pool,
 	if (unlikely(pool->alloc.count > 0))
 		return pool->alloc.cache[--pool->alloc.count];
 
+	pref_nid = (pool->p.nid == NUMA_NO_NODE) ? numa_mem_id() : pool->p.nid;
+
 	/* Mark empty alloc.cache slots "empty" for alloc_pages_bulk_array */
 	memset(&pool->alloc.cache, 0, sizeof(void *) * bulk);
 
@@ -536,6 +606,9 @@ static struct page *__page_pool_alloc_pages_slow(struct page_pool *pool,
 			continue;
 		}
 
+		if (unlikely(page_to_nid(page) != pref_nid))
+			alloc_stat_inc(pool, cross_node);
+
 		page_pool_set_pp_info(pool, page);
 		pool->alloc.cache[pool->alloc.count++] = page;
 		/* Track how many pages are held 'in-flight' */
@@ -575,6 +648,25 @@ struct page *page_pool_alloc_pages(struct page_pool *pool, gfp_t gfp)
 EXPORT_SYMBOL(page_pool_alloc_pages);
 ALLOW_ERROR_INJECTION(page_pool_alloc_pages, NULL);
 
+/**
+ * page_pool_alloc_netmem() - allocate a netmem from a page pool
+ * @pool: pool from which to allocate
+ * @gfp: GFP flags used for host page allocations
+ *
+ * Pools bound to a memory provider allocate a net_iov from the provider,
+ * all other pools fall back to page_pool_alloc_pages().
+ *
+ * Return: the netmem, or 0 on failure.
+ */
+netmem_ref page_pool_alloc_netmem(struct page_pool *pool, gfp_t gfp)
+{
+	if (pool->mp_priv)
+		return mp_dmabuf_devmem_alloc_netmems(pool, gfp);
+
+	return page_to_netmem(page_pool_alloc_pages(pool, gfp));
+}
+EXPORT_SYMBOL(page_pool_alloc_netmem);
+
 /* Calculate distance between two u32 values, valid if distance is below 2^(31)
  *  https://en.wikipedia.org/wiki/Serial_number_arithmetic#General_Solution
  */
@@ -656,6 +748,8 @@ static bool page_pool_recycle_in_ring(struct page_pool *pool, struct page *page)
 
 	if (!ret) {
 		recycle_stat_inc(pool, ring);
+		if (page_to_nid(page) != numa_mem_id())
+			recycle_stat_inc(pool, remote_node);
 		return true;
 	}
 
@@ -775,6 +869,31 @@ void page_pool_put_unrefed_page(struct page_pool *pool, struct page *page,
 }
 EXPORT_SYMBOL(page_pool_put_unrefed_page);
 
+/**
+ * page_pool_put_full_netmem() - release a reference to a netmem
+ * @pool: pool the netmem was allocated from
+ * @netmem: netmem to release
+ * @allow_direct: released by the consumer, allow lockless caching
+ *
+ * net_iovs are handed back to their memory provider once the last reference
+ * is dropped, host pages go through page_pool_put_full_page().
+ */
+void page_pool_put_full_netmem(struct page_pool *pool, netmem_ref netmem,
+			       bool allow_direct)
+{
+	struct net_iov *niov = netmem_to_net_iov(netmem);
+
+	if (!niov) {
+		page_pool_put_full_page(pool, netmem_to_page(netmem),
+					allow_direct);
+		return;
+	}
+
+	if (atomic_long_dec_and_test(&niov->pp_ref_count))
+		mp_dmabuf_devmem_release(pool, niov);
+}
+EXPORT_SYMBOL(page_pool_put_full_netmem);
+
 /**
  * page_pool_put_page_bulk() - release references on multiple pages
  * @pool:	pool from which pages were allocated
@@ -935,6 +1054,9 @@ static void __page_pool_destroy(struct page_pool *pool)
 	if (pool->disconnect)
 		pool->disconnect(pool);
 
+	if (pool->mp_priv)
+		mp_dmabuf_devmem_destroy(pool);
+
 	page_pool_unlist(pool);
 	page_pool_uninit(pool);
 	kfree(pool);
@@ -153,7 +153,13 @@ page_pool_nl_stats_fill(struct sk_buff *rsp, const struct page_pool *pool,
 	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_RECYCLE_RING_FULL,
 			 stats.recycle_stats.ring_full) ||
 	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_RECYCLE_RELEASED_REFCNT,
-			 stats.recycle_stats.released_refcnt))
+			 stats.recycle_stats.released_refcnt) ||
+	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_ALLOC_NID_CHANGED,
+			 stats.alloc_stats.nid_changed) ||
+	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_ALLOC_CROSS_NODE,
+			 stats.alloc_stats.cross_node) ||
+	    nla_put_uint(rsp, NETDEV_A_PAGE_POOL_STATS_RECYCLE_REMOTE_NODE,
+			 stats.recycle_stats.remote_node))
 		goto err_cancel_msg;
 
 	genlmsg_end(rsp, hdr);
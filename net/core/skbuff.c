@@ -218,6 +218,7 @@ static void skb_under_panic(struct sk_buff *skb, unsigned int sz, void *addr)
 #define NAPI_SKB_CACHE_SIZE	64
 #define NAPI_SKB_CACHE_BULK	16
 #define NAPI_SKB_CACHE_HALF	(NAPI_SKB_CACHE_SIZE / 2)
+#define NAPI_FCLONE_CACHE_SIZE	16
 
 #if PAGE_SIZE == SZ_4K
 
@@ -281,6 +282,8 @@ struct napi_alloc_cache {
 	struct page_frag_1k page_small;
 	unsigned int skb_count;
 	void *skb_cache[NAPI_SKB_CACHE_SIZE];
+	unsigned int fclone_count;
+	void *fclone_cache[NAPI_FCLONE_CACHE_SIZE];
 };
 
 static DEFINE_PER_CPU(struct page_frag_cache, netdev_alloc_cache);
@@ -357,6 +360,43 @@ static struct sk_buff *napi_skb_cache_get(void)
 	return skb;
 }
 
+/* Heads released by TX completions are parked in napi_alloc_cache, by
+ * napi_consume_skb() for plain skbs and by kfree_skbmem() for fclones.
+ * Let the transmit path, mostly running in process context, take them back
+ * before going to slab. The cache is never refilled from here, so @gfp_mask
+ * keeps its meaning on a miss.
+ */
+static struct sk_buff *skb_tx_cache_get(struct kmem_cache *cache,
+					gfp_t gfp_mask, int flags, int node)
+{
+	struct napi_alloc_cache *nc;
+	struct sk_buff *skb = NULL;
+
+	if (unlikely(in_hardirq() || irqs_disabled()) ||
+	    unlikely(node != NUMA_NO_NODE && node != numa_mem_id()))
+		return kmem_cache_alloc_node(cache, gfp_mask & ~GFP_DMA, node);
+
+	local_bh_disable();
+	nc = this_cpu_ptr(&napi_alloc_cache);
+	if (flags & SKB_ALLOC_FCLONE) {
+		if (nc->fclone_count)
+			skb = nc->fclone_cache[--nc->fclone_count];
+	} else if (nc->skb_count) {
+		skb = nc->skb_cache[--nc->skb_count];
+	}
+	if (skb)
+		__this_cpu_inc(softnet_data.skb_tx_cache_hit);
+	else
+		__this_cpu_inc(softnet_data.skb_tx_cache_miss);
+	local_bh_enable();
+
+	if (!skb)
+		return kmem_cache_alloc_node(cache, gfp_mask & ~GFP_DMA, node);
+
+	kasan_mempool_unpoison_object(skb, kmem_cache_size(cache));
+	return skb;
+}
+
 static inline void __finalize_skb_around(struct sk_buff *skb, void *data,
 					 unsigned int size)
 {
@@ -653,7 +693,7 @@ struct sk_buff *__alloc_skb(unsigned int size, gfp_t gfp_mask,
 	    likely(node == NUMA_NO_NODE || node == numa_mem_id()))
 		skb = napi_skb_cache_get();
 	else
-		skb = kmem_cache_alloc_node(cache, gfp_mask & ~GFP_DMA, node);
+		skb = skb_tx_cache_get(cache, gfp_mask, flags, node);
 	if (unlikely(!skb))
 		return NULL;
 	prefetchw(skb);
@@ -1021,6 +1061,22 @@ bool napi_pp_put_page(struct page *page)
 	return true;
 }
 EXPORT_SYMBOL(napi_pp_put_page);
+
+bool napi_pp_put_netmem(netmem_ref netmem)
+{
+	struct net_iov *niov = netmem_to_net_iov(netmem);
+
+	if (!niov)
+		return napi_pp_put_page(netmem_to_page(netmem));
+
+	if (unlikely((niov->pp_magic & ~0x3UL) != PP_SIGNATURE))
+		return false;
+
+	page_pool_put_full_netmem(niov->pp, netmem, false);
+
+	return true;
+}
+EXPORT_SYMBOL(napi_pp_put_netmem);
 #endif
 
 static bool skb_pp_recycle(struct sk_buff *skb, void *data)
@@ -1052,6 +1108,13 @@ static int skb_pp_frag_ref(struct sk_buff *skb)
 	shinfo = skb_shinfo(skb);
 
 	for (i = 0; i < shinfo->nr_frags; i++) {
+		struct net_iov *niov = skb_frag_net_iov(&shinfo->frags[i]);
+
+		if (niov) {
+			atomic_long_inc(&niov->pp_ref_count);
+			continue;
+		}
+
 		head_page = compound_head(skb_frag_page(&shinfo->frags[i]));
 		if (likely(is_pp_page(head_page)))
 			page_pool_ref_page(head_page);
@@ -1122,6 +1185,25 @@ static void skb_release_data(struct sk_buff *skb, enum skb_drop_reason reason)
 /*
  *	Free an skbuff by memory without cleaning the state.
  */
+/* Park a released fclone pair for skb_tx_cache_get(). Only done from
+ * softirq context, where TX completions and ACK processing free them.
+ */
+static bool napi_fclone_cache_put(struct sk_buff_fclones *fclones)
+{
+	struct napi_alloc_cache *nc;
+
+	if (!in_softirq() || in_hardirq())
+		return false;
+
+	nc = this_cpu_ptr(&napi_alloc_cache);
+	if (nc->fclone_count == NAPI_FCLONE_CACHE_SIZE)
+		return false;
+
+	if (kasan_mempool_poison_object(fclones))
+		nc->fclone_cache[nc->fclone_count++] = fclones;
+	return true;
+}
+
 static void kfree_skbmem(struct sk_buff *skb)
 {
 	struct sk_buff_fclones *fclones;
@@ -1149,6 +1231,8 @@ static void kfree_skbmem(struct sk_buff *skb)
 	if (!refcount_dec_and_test(&fclones->fclone_ref))
 		return;
 fastpath:
+	if (napi_fclone_cache_put(fclones))
+		return;
 	kmem_cache_free(net_hotdata.skbuff_fclone_cache, fclones);
 }
 
@@ -2119,6 +2203,9 @@ struct sk_buff *skb_copy(const struct sk_buff *skb, gfp_t gfp_mask)
 	if (WARN_ON_ONCE(skb_shinfo(skb)->gso_type & SKB_GSO_FRAGLIST))
 		return NULL;
 
+	if (!skb_frags_readable(skb))
+		return NULL;
+
 	headerlen = skb_headroom(skb);
 	size = skb_end_offset(skb) + skb->data_len;
 	n = __alloc_skb(size, gfp_mask,
@@ -2798,6 +2885,9 @@ void *__pskb_pull_tail(struct sk_buff *skb, int delta)
 	 */
 	int i, k, eat = (skb->tail + delta) - skb->end;
 
+	if (!skb_frags_readable(skb))
+		return NULL;
+
 	if (eat > 0 || skb_cloned(skb)) {
 		if (pskb_expand_head(skb, 0, eat > 0 ? eat + 128 : 0,
 				     GFP_ATOMIC))
@@ -2951,6 +3041,9 @@ int skb_copy_bits(const struct sk_buff *skb, int offset, void *to, int len)
 		to     += copy;
 	}
 
+	if (!skb_frags_readable(skb))
+		goto fault;
+
 	for (i = 0; i < skb_shinfo(skb)->nr_frags; i++) {
 		int end;
 		skb_frag_t *f = &skb_shinfo(skb)->frags[i];
@@ -3137,8 +3230,11 @@ static bool __skb_splice_bits(struct sk_buff *skb, struct pipe_inode_info *pipe,
 		return true;
 
 	/*
-	 * then map the fragments
+	 * then map the fragments, unless they are not readable by the CPU
 	 */
+	if (!skb_frags_readable(skb))
+		return false;
+
 	for (seg = 0; seg < skb_shinfo(skb)->nr_frags; seg++) {
 		const skb_frag_t *f = &skb_shinfo(skb)->frags[seg];
 
@@ -3438,6 +3534,9 @@ __wsum __skb_checksum(const struct sk_buff *skb, int offset, int len,
 		pos	= copy;
 	}
 
+	if (WARN_ON_ONCE(!skb_frags_readable(skb)))
+		return 0;
+
 	for (i = 0; i < skb_shinfo(skb)->nr_frags; i++) {
 		int end;
 		skb_frag_t *frag = &skb_shinfo(skb)->frags[i];
@@ -4138,6 +4237,8 @@ int skb_shift(struct sk_buff *tgt, struct sk_buff *skb, int shiftlen)
 		return 0;
 	if (skb_zcopy(tgt) || skb_zcopy(skb))
 		return 0;
+	if (!skb_frags_readable(tgt) || !skb_frags_readable(skb))
+		return 0;
 
 	todo = shiftlen;
 	from = 0;
@@ -5003,7 +5104,7 @@ void __init skb_init(void)
 					      sizeof(struct sk_buff),
 					      0,
 					      SLAB_HWCACHE_ALIGN|SLAB_PANIC|
-						FLAG_SKB_NO_MERGE,
+						SLAB_SHEAVES|FLAG_SKB_NO_MERGE,
 					      offsetof(struct sk_buff, cb),
 					      sizeof_field(struct sk_buff, cb),
 					      NULL);
@@ -5923,7 +6024,11 @@ bool skb_try_coalesce(struct sk_buff *to, struct sk_buff *from,
 	if (to->pp_recycle != from->pp_recycle)
 		return false;
 
-	if (len <= skb_tailroom(to)) {
+	/* Never mix readable and unreadable (net_iov backed) frags */
+	if (skb_frags_readable(from) != skb_frags_readable(to))
+		return false;
+
+	if (len <= skb_tailroom(to) && skb_frags_readable(from)) {
 		if (len)
 			BUG_ON(skb_copy_bits(from, 0, skb_put(to, len), len));
 		*delta_truesize = 0;
@@ -13,6 +13,7 @@
 #include <linux/socket.h>
 #include <linux/netdevice.h>
 #include <linux/ratelimit.h>
+#include <linux/random.h>
 #include <linux/vmalloc.h>
 #include <linux/init.h>
 #include <linux/slab.h>
@@ -126,9 +127,21 @@ static int rps_default_mask_sysctl(struct ctl_table *table, int write,
 	return err;
 }
 
+static DEFINE_MUTEX(sock_flow_mutex);
+
+/* init_net sizes the table shared by every netns without one of its own */
+static struct rps_sock_flow_table __rcu **rps_sock_flow_tablep(struct net *net)
+{
+	if (net_eq(net, &init_net))
+		return &net_hotdata.rps_sock_flow_table;
+	return &net->core.rps_sock_flow_table;
+}
+
 static int rps_sock_flow_sysctl(struct ctl_table *table, int write,
 				void *buffer, size_t *lenp, loff_t *ppos)
 {
+	struct net *net = (struct net *)table->data;
+	struct rps_sock_flow_table __rcu **tablep = rps_sock_flow_tablep(net);
 	unsigned int orig_size, size;
 	int ret, i;
 	struct ctl_table tmp = {
@@ -137,12 +150,10 @@ static int rps_sock_flow_sysctl(struct ctl_table *table, int write,
 		.mode = table->mode
 	};
 	struct rps_sock_flow_table *orig_sock_table, *sock_table;
-	static DEFINE_MUTEX(sock_flow_mutex);
 
 	mutex_lock(&sock_flow_mutex);
 
-	orig_sock_table = rcu_dereference_protected(
-					net_hotdata.rps_sock_flow_table,
+	orig_sock_table = rcu_dereference_protected(*tablep,
 					lockdep_is_held(&sock_flow_mutex));
 	size = orig_size = orig_sock_table ? orig_sock_table->mask + 1 : 0;
 
@@ -157,8 +168,11 @@ static int rps_sock_flow_sysctl(struct ctl_table *table, int write,
 			}
 			size = roundup_pow_of_two(size);
 			if (size != orig_size) {
+				/* Charge tables of child netns to their owner */
 				sock_table =
-				    vmalloc(RPS_SOCK_FLOW_TABLE_SIZE(size));
+				    __vmalloc(RPS_SOCK_FLOW_TABLE_SIZE(size),
+					      net_eq(net, &init_net) ?
+					      GFP_KERNEL : GFP_KERNEL_ACCOUNT);
 				if (!sock_table) {
 					mutex_unlock(&sock_flow_mutex);
 					return -ENOMEM;
@@ -166,6 +180,7 @@ static int rps_sock_flow_sysctl(struct ctl_table *table, int write,
 				net_hotdata.rps_cpu_mask =
 					roundup_pow_of_two(nr_cpu_ids) - 1;
 				sock_table->mask = size - 1;
+				sock_table->seed = get_random_u32();
 			} else
 				sock_table = orig_sock_table;
 
@@ -175,8 +190,7 @@ static int rps_sock_flow_sysctl(struct ctl_table *table, int write,
 			sock_table = NULL;
 
 		if (sock_table != orig_sock_table) {
-			rcu_assign_pointer(net_hotdata.rps_sock_flow_table,
-					   sock_table);
+			rcu_assign_pointer(*tablep, sock_table);
 			if (sock_table) {
 				static_branch_inc(&rps_needed);
 				static_branch_inc(&rfs_needed);
@@ -193,6 +207,19 @@ static int rps_sock_flow_sysctl(struct ctl_table *table, int write,
 
 	return ret;
 }
+
+static void rps_sock_flow_net_exit(struct net *net)
+{
+	struct rps_sock_flow_table *sock_table;
+
+	sock_table = rcu_replace_pointer(net->core.rps_sock_flow_table, NULL,
+					 true);
+	if (sock_table) {
+		static_branch_dec(&rps_needed);
+		static_branch_dec(&rfs_needed);
+		kvfree_rcu_mightsleep(sock_table);
+	}
+}
 #endif /* CONFIG_RPS */
 
 #ifdef CONFIG_NET_FLOW_LIMIT
@@ -532,14 +559,6 @@ static struct ctl_table net_core_table[] = {
 		.extra1		= SYSCTL_ZERO,
 		.extra2		= SYSCTL_ONE
 	},
-#ifdef CONFIG_RPS
-	{
-		.procname	= "rps_sock_flow_entries",
-		.maxlen		= sizeof(int),
-		.mode		= 0644,
-		.proc_handler	= rps_sock_flow_sysctl
-	},
-#endif
 #ifdef CONFIG_NET_FLOW_LIMIT
 	{
 		.procname	= "flow_limit_cpu_bitmap",
@@ -671,6 +690,15 @@ static struct ctl_table netns_core_table[] = {
 		.mode		= 0644,
 		.proc_handler	= rps_default_mask_sysctl
 	},
+#endif
+#ifdef CONFIG_RPS
+	{
+		.procname	= "rps_sock_flow_entries",
+		.data		= &init_net,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= rps_sock_flow_sysctl
+	},
 #endif
 	{
 		.procname	= "somaxconn",
@@ -750,6 +778,9 @@ static __net_exit void sysctl_core_net_exit(struct net *net)
 	BUG_ON(tbl == netns_core_table);
 #if IS_ENABLED(CONFIG_RPS)
 	kfree(net->core.rps_default_mask);
+#endif
+#ifdef CONFIG_RPS
+	rps_sock_flow_net_exit(net);
 #endif
 	kfree(tbl);
 }
@@ -81,12 +81,85 @@ struct inet_bind_bucket *inet_bind_bucket_create(struct kmem_cache *cachep,
 	return tb;
 }
 
+/* Bind buckets created by connect() (fastreuse == -1) give an ephemeral port
+ * back when they are destroyed. With ip_local_port_cache set, the last few
+ * of them are remembered per cpu, so that a connect storm in a mostly busy
+ * port range can pick a port known to be free instead of probing linearly.
+ * Entries are only hints, __inet_hash_connect() revalidates them under the
+ * bucket lock; net and cachep are compared, never dereferenced.
+ */
+#define INET_PORT_CACHE_SIZE	16
+
+struct inet_port_cache {
+	struct {
+		const struct net	*net;
+		const struct kmem_cache	*cachep;
+		unsigned short		port;
+	} ent[INET_PORT_CACHE_SIZE];
+	unsigned int count;
+	unsigned int next;
+};
+
+static DEFINE_PER_CPU(struct inet_port_cache, inet_port_cache);
+
+/* Caller holds the bind bucket lock, bh are disabled. */
+static void inet_port_cache_push(const struct kmem_cache *cachep,
+				 const struct inet_bind_bucket *tb)
+{
+	struct inet_port_cache *pc;
+	unsigned int slot;
+
+	if (tb->fastreuse != -1 || tb->fastreuseport != -1)
+		return;
+	if (!READ_ONCE(ib_net(tb)->ipv4.sysctl_ip_local_port_cache))
+		return;
+
+	pc = this_cpu_ptr(&inet_port_cache);
+	if (pc->count < INET_PORT_CACHE_SIZE)
+		slot = pc->count++;
+	else
+		slot = pc->next++ % INET_PORT_CACHE_SIZE;
+
+	pc->ent[slot].net = ib_net(tb);
+	pc->ent[slot].cachep = cachep;
+	pc->ent[slot].port = tb->port;
+}
+
+/* Returns a recently freed port in [low, high[ of @low parity if @step is 2,
+ * or 0.
+ */
+static int inet_port_cache_pop(const struct net *net,
+			       const struct kmem_cache *cachep,
+			       int low, int high, int step)
+{
+	struct inet_port_cache *pc;
+	int i, port = 0;
+
+	local_bh_disable();
+	pc = this_cpu_ptr(&inet_port_cache);
+	for (i = pc->count - 1; i >= 0; i--) {
+		int p = pc->ent[i].port;
+
+		if (pc->ent[i].net != net || pc->ent[i].cachep != cachep ||
+		    p < low || p >= high || (p - low) % step)
+			continue;
+
+		port = p;
+		pc->ent[i] = pc->ent[--pc->count];
+		break;
+	}
+	local_bh_enable();
+
+	return port;
+}
+
 /*
  * Caller must hold hashbucket lock for this tb with local BH disabled
  */
 void inet_bind_bucket_destroy(struct kmem_cache *cachep, struct inet_bind_bucket *tb)
 {
 	if (hlist_empty(&tb->bhash2)) {
+		inet_port_cache_push(cachep, tb);
 		__hlist_del(&tb->node);
 		kmem_cache_free(cachep, tb);
 	}
@@ -556,6 +629,23 @@ static int __inet_check_established(struct inet_timewait_death_row *death_row,
 	const struct hlist_nulls_node *node;
 	struct inet_timewait_sock *tw = NULL;
 
+	/* The ehash chain is RCU protected. A connected four-tuple, the
+	 * common case while probing a busy port range, is rejected without
+	 * touching the bucket lock. TIME_WAIT and free tuples are decided
+	 * under the lock below.
+	 */
+	rcu_read_lock();
+	sk_nulls_for_each_rcu(sk2, node, &head->chain) {
+		if (sk2->sk_hash != hash ||
+		    !inet_match(net, sk2, acookie, ports, dif, sdif))
+			continue;
+		if (sk2->sk_state == TCP_TIME_WAIT)
+			break;
+		rcu_read_unlock();
+		return -EADDRNOTAVAIL;
+	}
+	rcu_read_unlock();
+
 	spin_lock(lock);
 
 	sk_nulls_for_each(sk2, node, &head->chain) {
@@ -991,6 +1081,61 @@ EXPORT_SYMBOL_GPL(inet_bhash2_reset_saddr);
 #define INET_TABLE_PERTURB_SIZE (1 << CONFIG_INET_TABLE_PERTURB_ORDER)
 static u32 *table_perturb;
 
+/* Try to get @port for a connect. Returns 0 with the bind bucket lock held
+ * and bh disabled, -EADDRINUSE if the port can't be used or -ENOMEM.
+ */
+static int inet_hash_connect_try_port(struct inet_timewait_death_row *death_row,
+				      struct sock *sk, int port, int l3mdev,
+				      struct inet_bind_hashbucket **headp,
+				      struct inet_bind_bucket **tbp,
+				      bool *tb_created,
+				      struct inet_timewait_sock **twp,
+				      int (*check_established)(struct inet_timewait_death_row *,
+							       struct sock *, __u16,
+							       struct inet_timewait_sock **))
+{
+	struct inet_hashinfo *hinfo = death_row->hashinfo;
+	struct inet_bind_hashbucket *head;
+	struct net *net = sock_net(sk);
+	struct inet_bind_bucket *tb;
+
+	head = &hinfo->bhash[inet_bhashfn(net, port, hinfo->bhash_size)];
+	spin_lock_bh(&head->lock);
+
+	/* Does not bother with rcv_saddr checks, because
+	 * the established check is already unique enough.
+	 */
+	inet_bind_bucket_for_each(tb, &head->chain) {
+		if (inet_bind_bucket_match(tb, net, port, l3mdev)) {
+			if (tb->fastreuse >= 0 ||
+			    tb->fastreuseport >= 0)
+				goto busy;
+			WARN_ON(hlist_empty(&tb->bhash2));
+			if (!check_established(death_row, sk, port, twp))
+				goto ok;
+			goto busy;
+		}
+	}
+
+	tb = inet_bind_bucket_create(hinfo->bind_bucket_cachep,
+				     net, head, port, l3mdev);
+	if (!tb) {
+		spin_unlock_bh(&head->lock);
+		return -ENOMEM;
+	}
+	*tb_created = true;
+	tb->fastreuse = -1;
+	tb->fastreuseport = -1;
+ok:
+	*headp = head;
+	*tbp = tb;
+	return 0;
+
+busy:
+	spin_unlock_bh(&head->lock);
+	return -EADDRINUSE;
+}
+
 int __inet_hash_connect(struct inet_timewait_death_row *death_row,
 		struct sock *sk, u64 port_offset,
 		int (*check_established)(struct inet_timewait_death_row *,
@@ -1008,6 +1153,7 @@ int __inet_hash_connect(struct inet_timewait_death_row *death_row,
 	int ret, i, low, high;
 	bool local_ports;
 	int step, l3mdev;
+	u32 probes = 0;
 	u32 index;
 
 	if (port) {
@@ -1039,6 +1185,28 @@ int __inet_hash_connect(struct inet_timewait_death_row *death_row,
 	 */
 	if (!local_ports)
 		offset &= ~1U;
+
+	NET_INC_STATS(net, LINUX_MIB_CONNECTPORTSEARCH);
+
+	if (READ_ONCE(net->ipv4.sysctl_ip_local_port_cache)) {
+		port = inet_port_cache_pop(net, hinfo->bind_bucket_cachep,
+					   low, high, step);
+		if (port && !inet_is_local_reserved_port(net, port)) {
+			probes++;
+			ret = inet_hash_connect_try_port(death_row, sk, port,
+							 l3mdev, &head, &tb,
+							 &tb_created, &tw,
+							 check_established);
+			if (!ret) {
+				NET_INC_STATS(net, LINUX_MIB_CONNECTPORTCACHEHIT);
+				i = 0;
+				goto ok;
+			}
+			if (ret == -ENOMEM)
+				goto out_probes;
+		}
+	}
+
 other_parity_scan:
 	port = low + offset;
 	for (i = 0; i < remaining; i += step, port += step) {
@@ -1046,38 +1214,14 @@ int __inet_hash_connect(struct inet_timewait_death_row *death_row,
 			port -= remaining;
 		if (inet_is_local_reserved_port(net, port))
 			continue;
-		head = &hinfo->bhash[inet_bhashfn(net, port,
-						  hinfo->bhash_size)];
-		spin_lock_bh(&head->lock);
-
-		/* Does not bother with rcv_saddr checks, because
-		 * the established check is already unique enough.
-		 */
-		inet_bind_bucket_for_each(tb, &head->chain) {
-			if (inet_bind_bucket_match(tb, net, port, l3mdev)) {
-				if (tb->fastreuse >= 0 ||
-				    tb->fastreuseport >= 0)
-					goto next_port;
-				WARN_ON(hlist_empty(&tb->bhash2));
-				if (!check_established(death_row, sk,
-						       port, &tw))
-					goto ok;
-				goto next_port;
-			}
-		}
-
-		tb = inet_bind_bucket_create(hinfo->bind_bucket_cachep,
-					     net, head, port, l3mdev);
-		if (!tb) {
-			spin_unlock_bh(&head->lock);
-			return -ENOMEM;
-		}
-		tb_created = true;
-		tb->fastreuse = -1;
-		tb->fastreuseport = -1;
-		goto ok;
-next_port:
-		spin_unlock_bh(&head->lock);
+		probes++;
+		ret = inet_hash_connect_try_port(death_row, sk, port, l3mdev,
+						 &head, &tb, &tb_created, &tw,
+						 check_established);
+		if (!ret)
+			goto ok;
+		if (ret == -ENOMEM)
+			goto out_probes;
 		cond_resched();
 	}
 
@@ -1086,9 +1230,14 @@ int __inet_hash_connect(struct inet_timewait_death_row *death_row,
 		if ((offset & 1) && remaining > 1)
 			goto other_parity_scan;
 	}
-	return -EADDRNOTAVAIL;
+	ret = -EADDRNOTAVAIL;
+out_probes:
+	NET_ADD_STATS(net, LINUX_MIB_CONNECTPORTPROBES, probes);
+	return ret;
 
 ok:
+	NET_ADD_STATS(net, LINUX_MIB_CONNECTPORTPROBES, probes);
+
 	/* Find the corresponding tb2 bucket since we need to
 	 * add the socket to the bhash2 table as well
 	 */
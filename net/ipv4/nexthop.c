@@ -1119,7 +1119,13 @@ static void nh_res_bucket_set_idle(const struct nh_res_table *res_table,
 
 static void nh_res_bucket_set_busy(struct nh_res_bucket *bucket)
 {
-	atomic_long_set(&bucket->used_time, (long)jiffies);
+	unsigned long now = jiffies;
+
+	/* Called per packet: only dirty the bucket's cacheline, shared by all
+	 * the CPUs forwarding over it, once per jiffy.
+	 */
+	if (nh_res_bucket_used_time(bucket) != now)
+		atomic_long_set(&bucket->used_time, (long)now);
 }
 
 static clock_t nh_res_bucket_idle_time(const struct nh_res_bucket *bucket)
@@ -305,6 +305,10 @@ static const struct snmp_mib snmp4_net_list[] = {
 	SNMP_MIB_ITEM("TCPAOKeyNotFound", LINUX_MIB_TCPAOKEYNOTFOUND),
 	SNMP_MIB_ITEM("TCPAOGood", LINUX_MIB_TCPAOGOOD),
 	SNMP_MIB_ITEM("TCPAODroppedIcmps", LINUX_MIB_TCPAODROPPEDICMPS),
+	SNMP_MIB_ITEM("TCPTxPlug", LINUX_MIB_TCPTXPLUG),
+	SNMP_MIB_ITEM("ConnectPortSearch", LINUX_MIB_CONNECTPORTSEARCH),
+	SNMP_MIB_ITEM("ConnectPortProbes", LINUX_MIB_CONNECTPORTPROBES),
+	SNMP_MIB_ITEM("ConnectPortCacheHit", LINUX_MIB_CONNECTPORTCACHEHIT),
 	SNMP_MIB_SENTINEL
 };
 
@@ -283,6 +283,9 @@
 #include <net/busy_poll.h>
 #include <net/hotdata.h>
 #include <net/rps.h>
+#include <linux/uio.h>
+
+#include "../core/devmem.h"
 
 /* Track pending CMSGs. */
 enum {
@@ -468,6 +471,7 @@ void tcp_init_sock(struct sock *sk)
 
 	set_bit(SOCK_SUPPORT_ZC, &sk->sk_socket->flags);
 	sk_sockets_allocated_inc(sk);
+	xa_init_flags(&sk->sk_user_frags, XA_FLAGS_ALLOC1);
 }
 EXPORT_SYMBOL(tcp_init_sock);
 
@@ -709,6 +713,32 @@ static bool tcp_should_autocork(struct sock *sk, struct sk_buff *skb,
 	       tcp_skb_can_collapse_to(skb);
 }
 
+/* With TCP_TX_PLUG, data written by back to back sendmsg calls is held until
+ * a full size_goal burst is queued or the plug time elapsed, so that it
+ * leaves as one TSO packet and one qdisc enqueue. The pacing timer kicks the
+ * TSQ handler to write out whatever is held when the plug expires.
+ */
+static bool tcp_tx_plug(struct sock *sk, int nonagle, int size_goal)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	u32 plug_us = READ_ONCE(tp->tx_plug_us);
+
+	if (!plug_us || (nonagle & TCP_NAGLE_PUSH) || forced_push(tp))
+		return false;
+
+	if (tp->write_seq - tp->snd_nxt >= size_goal)
+		return false;
+
+	if (!hrtimer_is_queued(&tp->pacing_timer)) {
+		hrtimer_start(&tp->pacing_timer,
+			      ns_to_ktime((u64)plug_us * NSEC_PER_USEC),
+			      HRTIMER_MODE_REL_PINNED_SOFT);
+		sock_hold(sk);
+		NET_INC_STATS(sock_net(sk), LINUX_MIB_TCPTXPLUG);
+	}
+	return true;
+}
+
 void tcp_push(struct sock *sk, int flags, int mss_now,
 	      int nonagle, int size_goal)
 {
@@ -723,6 +753,9 @@ void tcp_push(struct sock *sk, int flags, int mss_now,
 
 	tcp_mark_urg(tp, flags);
 
+	if (tcp_tx_plug(sk, nonagle, size_goal))
+		return;
+
 	if (tcp_should_autocork(sk, skb, size_goal)) {
 
 		/* avoid atomic op if TSQ_THROTTLED bit is already set */
@@ -2314,6 +2347,133 @@ static int tcp_inq_hint(struct sock *sk)
 	return inq;
 }
 
+/* Hand the dma-buf backed payload of an unreadable skb to the user.
+ *
+ * The linear part is copied as usual and reported with a SO_DEVMEM_LINEAR
+ * cmsg. Each net_iov frag is reported with a SO_DEVMEM_DMABUF cmsg carrying
+ * its offset in the dma-buf and a token; the socket keeps a reference on
+ * the net_iov until the user returns the token with SO_DEVMEM_DONTNEED.
+ *
+ * On error, returns the -errno. On success, returns number of bytes handed
+ * to the user, which may be less than @remaining_len.
+ */
+static int tcp_recvmsg_dmabuf(struct sock *sk, const struct sk_buff *skb,
+			      unsigned int offset, struct msghdr *msg,
+			      int remaining_len)
+{
+	struct dmabuf_cmsg dmabuf_cmsg = { 0 };
+	unsigned int start;
+	int i, copy, n;
+	int sent = 0;
+	int err = 0;
+
+	start = skb_headlen(skb);
+
+	if (skb_frags_readable(skb)) {
+		err = -ENODEV;
+		goto out;
+	}
+
+	/* Copy header. */
+	copy = start - offset;
+	if (copy > 0) {
+		copy = min(copy, remaining_len);
+
+		n = copy_to_iter(skb->data + offset, copy, &msg->msg_iter);
+		if (n != copy) {
+			err = -EFAULT;
+			goto out;
+		}
+
+		offset += copy;
+		remaining_len -= copy;
+
+		/* First a dmabuf_cmsg for # bytes copied to user buffer. */
+		dmabuf_cmsg.frag_size = copy;
+		err = put_cmsg(msg, SOL_SOCKET, SO_DEVMEM_LINEAR,
+			       sizeof(dmabuf_cmsg), &dmabuf_cmsg);
+		if (err || msg->msg_flags & MSG_CTRUNC) {
+			msg->msg_flags &= ~MSG_CTRUNC;
+			if (!err)
+				err = -ETOOSMALL;
+			goto out;
+		}
+
+		sent += copy;
+
+		if (remaining_len == 0)
+			goto out;
+	}
+
+	/* after that, send information of dmabuf pages through a sequence of
+	 * cmsg
+	 */
+	for (i = 0; i < skb_shinfo(skb)->nr_frags; i++) {
+		skb_frag_t *frag = &skb_shinfo(skb)->frags[i];
+		struct net_iov *niov;
+		int end;
+
+		/* !skb_frags_readable() should indicate that ALL the frags in
+		 * this skb are dmabuf net_iovs. Check individual frags anyway,
+		 * we don't want to crash here if the stack got it wrong.
+		 */
+		niov = skb_frag_net_iov(frag);
+		if (!niov) {
+			net_err_ratelimited("Found non-dmabuf skb with net_iov");
+			err = -ENODEV;
+			goto out;
+		}
+
+		end = start + skb_frag_size(frag);
+		copy = end - offset;
+
+		if (copy > 0) {
+			copy = min(copy, remaining_len);
+
+			memset(&dmabuf_cmsg, 0, sizeof(dmabuf_cmsg));
+			dmabuf_cmsg.frag_offset = net_iov_virtual_addr(niov) +
+						  skb_frag_off(frag) + offset -
+						  start;
+			dmabuf_cmsg.frag_size = copy;
+			dmabuf_cmsg.dmabuf_id = net_iov_binding_id(niov);
+
+			err = xa_alloc(&sk->sk_user_frags,
+				       &dmabuf_cmsg.frag_token, niov,
+				       xa_limit_31b, GFP_KERNEL);
+			if (err)
+				goto out;
+
+			err = put_cmsg(msg, SOL_SOCKET, SO_DEVMEM_DMABUF,
+				       sizeof(dmabuf_cmsg), &dmabuf_cmsg);
+			if (err || msg->msg_flags & MSG_CTRUNC) {
+				msg->msg_flags &= ~MSG_CTRUNC;
+				xa_erase(&sk->sk_user_frags,
+					 dmabuf_cmsg.frag_token);
+				if (!err)
+					err = -ETOOSMALL;
+				goto out;
+			}
+
+			/* The token now owns a reference on the net_iov */
+			atomic_long_inc(&niov->pp_ref_count);
+
+			offset += copy;
+			remaining_len -= copy;
+			sent += copy;
+
+			if (remaining_len == 0)
+				goto out;
+		}
+		start = end;
+	}
+
+out:
+	if (!sent)
+		sent = err;
+
+	return sent;
+}
+
 /*
  *	This routine copies from a sock struct into the user buffer.
  *
@@ -2335,6 +2495,7 @@ static int tcp_recvmsg_locked(struct sock *sk, struct msghdr *msg, size_t len,
 	int target;		/* Read at least this many bytes */
 	long timeo;
 	struct sk_buff *skb, *last;
+	int last_copied_dmabuf = -1; /* uninitialized */
 	u32 peek_offset = 0;
 	u32 urg_hole = 0;
 
@@ -2506,15 +2667,44 @@ static int tcp_recvmsg_locked(struct sock *sk, struct msghdr *msg, size_t len,
 		}
 
 		if (!(flags & MSG_TRUNC)) {
-			err = skb_copy_datagram_msg(skb, offset, msg, used);
-			if (err) {
-				/* Exception. Bailout! */
-				if (!copied)
-					copied = -EFAULT;
+			/* Never mix readable and dmabuf data in one call */
+			if (last_copied_dmabuf != -1 &&
+			    last_copied_dmabuf != !skb_frags_readable(skb))
 				break;
+
+			if (skb_frags_readable(skb)) {
+				err = skb_copy_datagram_msg(skb, offset, msg,
+							    used);
+				if (err) {
+					/* Exception. Bailout! */
+					if (!copied)
+						copied = -EFAULT;
+					break;
+				}
+			} else {
+				/* dmabuf skbs can only be received with the
+				 * MSG_SOCK_DEVMEM flag.
+				 */
+				if (!(flags & MSG_SOCK_DEVMEM) ||
+				    (flags & MSG_PEEK)) {
+					if (!copied)
+						copied = -EFAULT;
+					break;
+				}
+
+				err = tcp_recvmsg_dmabuf(sk, skb, offset, msg,
+							 used);
+				if (err <= 0) {
+					if (!copied)
+						copied = -EFAULT;
+					break;
+				}
+				used = err;
 			}
 		}
 
+		last_copied_dmabuf = !skb_frags_readable(skb);
+
 		WRITE_ONCE(*seq, *seq + used);
 		copied += used;
 		len -= used;
@@ -3746,6 +3936,22 @@ int do_tcp_setsockopt(struct sock *sk, int level, int optname,
 			tcp_enable_tx_delay();
 		WRITE_ONCE(tp->tcp_tx_delay, val);
 		break;
+	case TCP_ACK_THIN:
+		if (val < 0)
+			err = -EINVAL;
+		else
+			WRITE_ONCE(tp->ack_thin_bytes, val);
+		break;
+	case TCP_TX_PLUG:
+		if (val < 0 || val > TCP_TX_PLUG_MAX) {
+			err = -EINVAL;
+			break;
+		}
+		WRITE_ONCE(tp->tx_plug_us, val);
+		/* Unplugging ends the batch, send what is held right away */
+		if (!val)
+			tcp_push_pending_frames(sk);
+		break;
 	default:
 		err = -ENOPROTOOPT;
 		break;
@@ -4238,6 +4444,13 @@ int do_tcp_getsockopt(struct sock *sk, int level,
 		val = READ_ONCE(tp->tcp_tx_delay);
 		break;
 
+	case TCP_ACK_THIN:
+		val = READ_ONCE(tp->ack_thin_bytes);
+		break;
+	case TCP_TX_PLUG:
+		val = READ_ONCE(tp->tx_plug_us);
+		break;
+
 	case TCP_TIMESTAMP:
 		val = tcp_clock_ts(tp->tcp_usec_ts) + READ_ONCE(tp->tsoffset);
 		if (tp->tcp_usec_ts)
@@ -5405,7 +5405,8 @@ tcp_collapse(struct sock *sk, struct sk_buff_head *list, struct rb_root *root,
 		start = TCP_SKB_CB(skb)->end_seq;
 	}
 	if (end_of_skbs ||
-	    (TCP_SKB_CB(skb)->tcp_flags & (TCPHDR_SYN | TCPHDR_FIN)))
+	    (TCP_SKB_CB(skb)->tcp_flags & (TCPHDR_SYN | TCPHDR_FIN)) ||
+	    !skb_frags_readable(skb))
 		return;
 
 	__skb_queue_head_init(&tmp);
@@ -5447,7 +5448,8 @@ tcp_collapse(struct sock *sk, struct sk_buff_head *list, struct rb_root *root,
 				if (!skb ||
 				    skb == tail ||
 				    !mptcp_skb_can_collapse(nskb, skb) ||
-				    (TCP_SKB_CB(skb)->tcp_flags & (TCPHDR_SYN | TCPHDR_FIN)))
+				    (TCP_SKB_CB(skb)->tcp_flags & (TCPHDR_SYN | TCPHDR_FIN)) ||
+				    !skb_frags_readable(skb))
 					goto end;
 				if (skb_cmp_decrypted(skb, nskb))
 					goto end;
@@ -5697,6 +5699,66 @@ static inline void tcp_data_snd_check(struct sock *sk)
 /*
  * Check if sending an ack is needed.
  */
+static u32 tcp_ack_thin_bytes(const struct sock *sk)
+{
+	const struct dst_entry *dst;
+	u32 bytes;
+
+	bytes = READ_ONCE(tcp_sk(sk)->ack_thin_bytes);
+	if (!bytes) {
+		dst = __sk_dst_get(sk);
+		if (dst)
+			bytes = dst_metric(dst, RTAX_ACK_THIN);
+	}
+	return bytes;
+}
+
+/* Receiver-side ACK thinning for bulk flows: rather than ACKing every other
+ * full frame (or every GRO packet), hold the ACK on the compressed ACK timer
+ * for a fraction of the RTT, so that the ACKs for all the skbs of this flow
+ * delivered by one NAPI poll collapse into a single one. An ACK still goes
+ * out as soon as more than ack_thin bytes are un-ACKed.
+ */
+static bool tcp_ack_thin(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	unsigned long rtt, delay;
+	u32 bytes;
+
+	bytes = tcp_ack_thin_bytes(sk);
+	if (!bytes || tp->rcv_nxt - tp->rcv_wup >= bytes)
+		return false;
+
+	/* Never hold an ACK the protocol wants now, nor one carrying SACKs */
+	if ((inet_csk(sk)->icsk_ack.pending & ICSK_ACK_NOW) ||
+	    tcp_in_quickack_mode(sk) ||
+	    !RB_EMPTY_ROOT(&tp->out_of_order_queue) ||
+	    tp->compressed_ack >= U8_MAX - 1)
+		return false;
+
+	rtt = tp->rcv_rtt_est.rtt_us;
+	if (tp->srtt_us && (!rtt || tp->srtt_us < rtt))
+		rtt = tp->srtt_us;
+	if (!rtt)
+		return false;
+
+	tp->compressed_ack++;
+	if (hrtimer_is_queued(&tp->compressed_ack_timer))
+		return true;
+
+	/* tcp_ack_thin_rtt_pct % of rtt, but no more than tcp_comp_sack_delay_ns */
+	delay = min_t(u64,
+		      READ_ONCE(sock_net(sk)->ipv4.sysctl_tcp_comp_sack_delay_ns),
+		      div_u64((u64)rtt * (NSEC_PER_USEC >> 3) *
+			      READ_ONCE(sock_net(sk)->ipv4.sysctl_tcp_ack_thin_rtt_pct),
+			      100));
+	sock_hold(sk);
+	hrtimer_start_range_ns(&tp->compressed_ack_timer, ns_to_ktime(delay),
+			       READ_ONCE(sock_net(sk)->ipv4.sysctl_tcp_comp_sack_slack_ns),
+			       HRTIMER_MODE_REL_PINNED_SOFT);
+	return true;
+}
+
 static void __tcp_ack_snd_check(struct sock *sk, int ofo_possible)
 {
 	struct tcp_sock *tp = tcp_sk(sk);
@@ -5715,6 +5777,9 @@ static void __tcp_ack_snd_check(struct sock *sk, int ofo_possible)
 	    tcp_in_quickack_mode(sk) ||
 	    /* Protocol state mandates a one-time immediate ACK */
 	    inet_csk(sk)->icsk_ack.pending & ICSK_ACK_NOW) {
+		if (tcp_ack_thin(sk))
+			return;
+
 		/* If we are running from __release_sock() in user context,
 		 * Defer the ack until tcp_release_cb().
 		 */
@@ -543,6 +543,7 @@ struct sock *tcp_create_openreq_child(const struct sock *sk,
 	newtp->snd_up = seq;
 
 	INIT_LIST_HEAD(&newtp->tsq_node);
+	xa_init_flags(&newsk->sk_user_frags, XA_FLAGS_ALLOC1);
 	INIT_LIST_HEAD(&newtp->tsorted_sent_queue);
 
 	tcp_init_wl(newtp, treq->rcv_isn);
@@ -1806,6 +1806,43 @@ int udp_read_skb(struct sock *sk, skb_read_actor_t recv_actor)
 }
 EXPORT_SYMBOL(udp_read_skb);
 
+/* Report the payload length of each datagram coalesced into @skb, so that
+ * a single read of a GRO packet can be split without assuming that all but
+ * the last segment are gso_size long. Fraglist packets keep their original
+ * segment boundaries in the frag_list.
+ */
+void udp_cmsg_recv_seglens(struct msghdr *msg, struct sk_buff *skb)
+{
+	unsigned int gso_size = skb_shinfo(skb)->gso_size;
+	u16 lens[UDP_MAX_SEGMENTS];
+	unsigned int len, n = 0;
+	struct sk_buff *frag;
+
+	len = skb->len;
+	if (skb_shinfo(skb)->gso_type & SKB_GSO_FRAGLIST) {
+		skb_walk_frags(skb, frag) {
+			if (n + 1 >= UDP_MAX_SEGMENTS)
+				return;
+			lens[++n] = frag->len;
+			len -= frag->len;
+		}
+		lens[0] = len;
+		n++;
+	} else {
+		if (!gso_size)
+			return;
+		while (len) {
+			if (n >= UDP_MAX_SEGMENTS)
+				return;
+			lens[n] = min(len, gso_size);
+			len -= lens[n++];
+		}
+	}
+
+	put_cmsg(msg, SOL_UDP, UDP_GRO_SEGLENS, n * sizeof(lens[0]), lens);
+}
+EXPORT_SYMBOL_GPL(udp_cmsg_recv_seglens);
+
 /*
  * 	This should be easy, if there is something there we
  * 	return it, otherwise we block.
@@ -2755,9 +2792,27 @@ int udp_lib_setsockopt(struct sock *sk, int level, int optname,
 			udp_tunnel_encap_enable(sk);
 		udp_assign_bit(GRO_ENABLED, sk, valbool);
 		udp_assign_bit(ACCEPT_L4, sk, valbool);
+		if (!valbool)
+			udp_clear_bit(GRO_SEGLENS, sk);
 		set_xfrm_gro_udp_encap_rcv(up->encap_type, sk->sk_family, sk);
 		break;
 
+	case UDP_GRO_SEGLENS:
+		/* Implies UDP_GRO. Fraglist packets keep their segment
+		 * boundaries, accept them whole rather than segmenting them
+		 * in udp_queue_rcv_skb().
+		 */
+		if (valbool) {
+			udp_tunnel_encap_enable(sk);
+			udp_set_bit(GRO_ENABLED, sk);
+			udp_set_bit(ACCEPT_L4, sk);
+			udp_set_bit(ACCEPT_FRAGLIST, sk);
+			set_xfrm_gro_udp_encap_rcv(up->encap_type,
+						   sk->sk_family, sk);
+		}
+		udp_assign_bit(GRO_SEGLENS, sk, valbool);
+		break;
+
 	/*
 	 * 	UDP-Lite's partial checksum coverage (RFC 3828).
 	 */
@@ -2846,6 +2901,10 @@ int udp_lib_getsockopt(struct sock *sk, int level, int optname,
 		val = udp_test_bit(GRO_ENABLED, sk);
 		break;
 
+	case UDP_GRO_SEGLENS:
+		val = udp_test_bit(GRO_SEGLENS, sk);
+		break;
+
 	/* The following two cannot be changed on UDP sockets, the return is
 	 * always 0 (which corresponds to the full checksum coverage of UDP). */
 	case UDPLITE_SEND_CSCOV:
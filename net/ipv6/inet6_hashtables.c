@@ -280,6 +280,19 @@ static int __inet6_check_established(struct inet_timewait_death_row *death_row,
 	const struct hlist_nulls_node *node;
 	struct inet_timewait_sock *tw = NULL;
 
+	/* Lockless pre-check, see __inet_check_established() */
+	rcu_read_lock();
+	sk_nulls_for_each_rcu(sk2, node, &head->chain) {
+		if (sk2->sk_hash != hash ||
+		    !inet6_match(net, sk2, saddr, daddr, ports, dif, sdif))
+			continue;
+		if (sk2->sk_state == TCP_TIME_WAIT)
+			break;
+		rcu_read_unlock();
+		return -EADDRNOTAVAIL;
+	}
+	rcu_read_unlock();
+
 	spin_lock(lock);
 
 	sk_nulls_for_each(sk2, node, &head->chain) {
@@ -1581,6 +1581,22 @@ static struct fib6_node *fib6_node_lookup_1(struct fib6_node *root,
 	for (;;) {
 		struct fib6_node *next;
 
+		/* Every node below a route node shares its prefix: once the
+		 * address is off that prefix, nothing deeper can match, so
+		 * start backtracking here instead of from the bottom.
+		 */
+		if ((fn->fn_flags & RTN_RTINFO) && !FIB6_SUBTREE(fn)) {
+			struct fib6_info *leaf = rcu_dereference(fn->leaf);
+			struct rt6key *key;
+
+			if (leaf) {
+				key = (struct rt6key *)((u8 *)leaf + args->offset);
+				if (!ipv6_prefix_equal(&key->addr, args->addr,
+						       key->plen))
+					break;
+			}
+		}
+
 		dir = addr_bit_set(args->addr, fn->fn_bit);
 
 		next = dir ? rcu_dereference(fn->right) :
@@ -1478,6 +1478,61 @@ struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 	return ssk;
 }
 
+/* latency oriented variant of mptcp_subflow_get_send(): pick the subflow
+ * with room in its congestion window and the lowest srtt + 4 * mdev, the
+ * bound the RTO is built from, so that subflows with a jittery path only
+ * get traffic when the steadier ones are full. Subflows without an RTT
+ * sample yet come first, to get one.
+ */
+struct sock *mptcp_subflow_get_send_minrtt(struct mptcp_sock *msk)
+{
+	struct mptcp_subflow_context *subflow;
+	struct sock *best[SSK_MODE_MAX] = {};
+	u64 best_rtt[SSK_MODE_MAX] = { U64_MAX, U64_MAX };
+	struct sock *sk = (struct sock *)msk;
+	int nr_active = 0;
+	struct sock *ssk;
+	long tout = 0;
+	u32 burst;
+
+	mptcp_for_each_subflow(msk, subflow) {
+		const struct tcp_sock *tp;
+		u64 rtt;
+
+		ssk = mptcp_subflow_tcp_sock(subflow);
+		if (!mptcp_subflow_active(subflow))
+			continue;
+
+		tout = max(tout, mptcp_timeout_from_subflow(subflow));
+		nr_active += !subflow->backup;
+
+		tp = tcp_sk(ssk);
+		if (!sk_stream_memory_free(ssk) ||
+		    tcp_packets_in_flight(tp) >= tcp_snd_cwnd(tp))
+			continue;
+
+		rtt = (READ_ONCE(tp->srtt_us) >> 3) + READ_ONCE(tp->rttvar_us);
+		if (rtt < best_rtt[subflow->backup]) {
+			best[subflow->backup] = ssk;
+			best_rtt[subflow->backup] = rtt;
+		}
+	}
+	__mptcp_set_timeout(sk, tout);
+
+	/* pick the best backup if no other subflow is active */
+	if (!nr_active)
+		best[SSK_MODE_ACTIVE] = best[SSK_MODE_BACKUP];
+
+	ssk = best[SSK_MODE_ACTIVE];
+	if (!ssk)
+		return NULL;
+
+	burst = min_t(int, MPTCP_SEND_BURST_SIZE, mptcp_wnd_end(msk) - msk->snd_nxt);
+	if (burst)
+		msk->snd_burst = burst;
+	return ssk;
+}
+
 static void mptcp_push_release(struct sock *ssk, struct mptcp_sendmsg_info *info)
 {
 	tcp_push(ssk, 0, info->mss_now, tcp_sk(ssk)->nonagle, info->size_goal);
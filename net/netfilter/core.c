@@ -17,12 +17,14 @@
 #include <linux/if.h>
 #include <linux/netdevice.h>
 #include <linux/netfilter_ipv6.h>
+#include <linux/netfilter_netdev.h>
 #include <linux/inetdevice.h>
 #include <linux/proc_fs.h>
 #include <linux/mutex.h>
 #include <linux/mm.h>
 #include <linux/rcupdate.h>
 #include <net/net_namespace.h>
+#include <net/neighbour.h>
 #include <net/netfilter/nf_queue.h>
 #include <net/sock.h>
 
@@ -671,6 +673,90 @@ void nf_hook_slow_list(struct list_head *head, struct nf_hook_state *state,
 }
 EXPORT_SYMBOL(nf_hook_slow_list);
 
+#ifdef CONFIG_NETFILTER_INGRESS
+DEFINE_PER_CPU(struct nf_ingress_xmit_batch, nf_ingress_xmit_batch);
+EXPORT_PER_CPU_SYMBOL_GPL(nf_ingress_xmit_batch);
+
+#define NF_INGRESS_XMIT_BATCH	64
+
+struct nf_ingress_xmit_cb {
+	union {
+		__be32		v4;
+		struct in6_addr	v6;
+	} nexthop;
+	int			neigh_table;
+};
+
+#define NF_INGRESS_XMIT_CB(skb)	((struct nf_ingress_xmit_cb *)(skb)->cb)
+
+static void nf_ingress_do_xmit(struct sk_buff *skb, int neigh_table,
+			       const void *nexthop)
+{
+	if (neigh_table < 0)
+		dev_queue_xmit(skb);
+	else
+		neigh_xmit(neigh_table, skb->dev, nexthop, skb);
+}
+
+void __nf_ingress_xmit_flush(struct nf_ingress_xmit_batch *b)
+{
+	struct sk_buff *skb = b->head;
+
+	b->head = NULL;
+	b->tail = NULL;
+	b->count = 0;
+
+	while (skb) {
+		struct sk_buff *next = skb->next;
+		struct nf_ingress_xmit_cb cb = *NF_INGRESS_XMIT_CB(skb);
+
+		skb_mark_not_on_list(skb);
+		nf_ingress_do_xmit(skb, cb.neigh_table, &cb.nexthop);
+		skb = next;
+	}
+}
+EXPORT_SYMBOL_GPL(__nf_ingress_xmit_flush);
+
+/**
+ * nf_ingress_xmit - transmit a packet stolen by an ingress hook
+ * @skb: packet, with skb->dev and link layer header (if any) already set
+ * @neigh_table: NEIGH_ARP_TABLE or NEIGH_ND_TABLE, or -1 for dev_queue_xmit()
+ * @nexthop: next hop address for neigh_xmit(), unused if @neigh_table < 0
+ *
+ * When called from the list receive path, transmission is deferred until
+ * the whole list went through ingress hooks.  Caller must hold
+ * rcu_read_lock, which also covers a noref dst attached to @skb.
+ */
+void nf_ingress_xmit(struct sk_buff *skb, int neigh_table, const void *nexthop)
+{
+	struct nf_ingress_xmit_batch *b = this_cpu_ptr(&nf_ingress_xmit_batch);
+	struct nf_ingress_xmit_cb *cb;
+
+	if (!b->active) {
+		nf_ingress_do_xmit(skb, neigh_table, nexthop);
+		return;
+	}
+
+	cb = NF_INGRESS_XMIT_CB(skb);
+	cb->neigh_table = neigh_table;
+	if (neigh_table == NEIGH_ARP_TABLE)
+		cb->nexthop.v4 = *(const __be32 *)nexthop;
+	else if (neigh_table == NEIGH_ND_TABLE)
+		cb->nexthop.v6 = *(const struct in6_addr *)nexthop;
+
+	skb->next = NULL;
+	if (b->tail)
+		b->tail->next = skb;
+	else
+		b->head = skb;
+	b->tail = skb;
+
+	if (++b->count >= NF_INGRESS_XMIT_BATCH)
+		__nf_ingress_xmit_flush(b);
+}
+EXPORT_SYMBOL_GPL(nf_ingress_xmit);
+#endif /* CONFIG_NETFILTER_INGRESS */
+
 /* This needs to be compiled in any case to avoid dependencies between the
  * nfnetlink_queue code and nf_conntrack.
  */
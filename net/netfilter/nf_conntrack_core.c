@@ -63,16 +63,36 @@ EXPORT_SYMBOL_GPL(nf_conntrack_expect_lock);
 struct hlist_nulls_head *nf_conntrack_hash __read_mostly;
 EXPORT_SYMBOL_GPL(nf_conntrack_hash);
 
+/* The hash table is split in GC_SHARDS bucket ranges, each one scanned
+ * by its own work item with its own rescheduling interval.
+ */
 struct conntrack_gc_work {
 	struct delayed_work	dwork;
-	u32			next_bucket;
+	u32			shard;
+	u32			next_bucket;	/* relative to shard start */
 	u32			avg_timeout;
 	u32			count;
 	u32			start_time;
 	bool			exiting;
 	bool			early_drop;
+
+	/* Only written by this shard worker */
+	u64			stat_passes;
+	u64			stat_scanned;
+	u64			stat_expired;
+	u64			stat_time_ns;
+};
+
+/* Per cpu stash of free conntrack objects, refilled in bulk. */
+#define NF_CT_PCPU_CACHE_SIZE	16
+
+struct nf_conntrack_pcpu_cache {
+	unsigned int		count;
+	struct nf_conn		*objs[NF_CT_PCPU_CACHE_SIZE];
 };
 
+static DEFINE_PER_CPU(struct nf_conntrack_pcpu_cache, nf_conntrack_pcpu_cache);
+
 static __read_mostly struct kmem_cache *nf_conntrack_cachep;
 static DEFINE_SPINLOCK(nf_conntrack_locks_all_lock);
 static __read_mostly bool nf_conntrack_locks_all;
@@ -99,7 +119,9 @@ static DEFINE_MUTEX(nf_conntrack_mutex);
 #define MIN_CHAINLEN	50u
 #define MAX_CHAINLEN	(80u - MIN_CHAINLEN)
 
-static struct conntrack_gc_work conntrack_gc_work;
+#define GC_SHARDS	8
+
+static struct conntrack_gc_work conntrack_gc_work[GC_SHARDS];
 
 void nf_conntrack_lock(spinlock_t *lock) __acquires(lock)
 {
@@ -1450,13 +1472,24 @@ static bool gc_worker_can_early_drop(const struct nf_conn *ct)
 	return false;
 }
 
+/* Buckets [@start, @start + @size) of a @hashsz table belong to @gc_work */
+static void gc_shard_range(const struct conntrack_gc_work *gc_work,
+			   unsigned int hashsz, unsigned int *start,
+			   unsigned int *size)
+{
+	*start = (u64)hashsz * gc_work->shard / GC_SHARDS;
+	*size = (u64)hashsz * (gc_work->shard + 1) / GC_SHARDS - *start;
+}
+
 static void gc_worker(struct work_struct *work)
 {
-	unsigned int i, hashsz, nf_conntrack_max95 = 0;
+	unsigned int i, hashsz, start, size, nf_conntrack_max95 = 0;
 	u32 end_time, start_time = nfct_time_stamp;
 	struct conntrack_gc_work *gc_work;
 	unsigned int expired_count = 0;
+	unsigned int scanned = 0;
 	unsigned long next_run;
+	u64 t0 = ktime_get_ns();
 	s32 delta_time;
 	long count;
 
@@ -1486,17 +1519,19 @@ static void gc_worker(struct work_struct *work)
 		rcu_read_lock();
 
 		nf_conntrack_get_ht(&ct_hash, &hashsz);
-		if (i >= hashsz) {
+		gc_shard_range(gc_work, hashsz, &start, &size);
+		if (i >= size) {
 			rcu_read_unlock();
 			break;
 		}
 
-		hlist_nulls_for_each_entry_rcu(h, n, &ct_hash[i], hnnode) {
+		hlist_nulls_for_each_entry_rcu(h, n, &ct_hash[start + i], hnnode) {
 			struct nf_conntrack_net *cnet;
 			struct net *net;
 			long expires;
 
 			tmp = nf_ct_tuplehash_to_ctrack(h);
+			scanned++;
 
 			if (test_bit(IPS_OFFLOAD_BIT, &tmp->status)) {
 				nf_ct_offload_timeout(tmp);
@@ -1565,16 +1600,17 @@ static void gc_worker(struct work_struct *work)
 		i++;
 
 		delta_time = nfct_time_stamp - end_time;
-		if (delta_time > 0 && i < hashsz) {
+		if (delta_time > 0 && i < size) {
 			gc_work->avg_timeout = next_run;
 			gc_work->count = count;
 			gc_work->next_bucket = i;
 			next_run = 0;
 			goto early_exit;
 		}
-	} while (i < hashsz);
+	} while (i < size);
 
 	gc_work->next_bucket = 0;
+	WRITE_ONCE(gc_work->stat_passes, gc_work->stat_passes + 1);
 
 	next_run = clamp(next_run, GC_SCAN_INTERVAL_MIN, GC_SCAN_INTERVAL_MAX);
 
@@ -1585,6 +1621,11 @@ static void gc_worker(struct work_struct *work)
 		next_run = 1;
 
 early_exit:
+	WRITE_ONCE(gc_work->stat_scanned, gc_work->stat_scanned + scanned);
+	WRITE_ONCE(gc_work->stat_expired, gc_work->stat_expired + expired_count);
+	WRITE_ONCE(gc_work->stat_time_ns,
+		   gc_work->stat_time_ns + ktime_get_ns() - t0);
+
 	if (gc_work->exiting)
 		return;
 
@@ -1594,12 +1635,120 @@ static void gc_worker(struct work_struct *work)
 	queue_delayed_work(system_power_efficient_wq, &gc_work->dwork, next_run);
 }
 
-static void conntrack_gc_work_init(struct conntrack_gc_work *gc_work)
+static void conntrack_gc_work_init(struct conntrack_gc_work *gc_work,
+				   u32 shard)
 {
 	INIT_DELAYED_WORK(&gc_work->dwork, gc_worker);
+	gc_work->shard = shard;
 	gc_work->exiting = false;
 }
 
+static void conntrack_gc_start(void)
+{
+	int i;
+
+	for (i = 0; i < GC_SHARDS; i++) {
+		conntrack_gc_work_init(&conntrack_gc_work[i], i);
+		queue_delayed_work(system_power_efficient_wq,
+				   &conntrack_gc_work[i].dwork, HZ);
+	}
+}
+
+static void conntrack_gc_stop(void)
+{
+	int i;
+
+	for (i = 0; i < GC_SHARDS; i++)
+		cancel_delayed_work_sync(&conntrack_gc_work[i].dwork);
+}
+
+static void conntrack_gc_set_early_drop(void)
+{
+	int i;
+
+	for (i = 0; i < GC_SHARDS; i++) {
+		if (!conntrack_gc_work[i].early_drop)
+			conntrack_gc_work[i].early_drop = true;
+	}
+}
+
+void nf_conntrack_gc_stats(struct nf_conntrack_gc_stats *st)
+{
+	int i;
+
+	memset(st, 0, sizeof(*st));
+	for (i = 0; i < GC_SHARDS; i++) {
+		const struct conntrack_gc_work *gc_work = &conntrack_gc_work[i];
+
+		st->passes += READ_ONCE(gc_work->stat_passes);
+		st->scanned += READ_ONCE(gc_work->stat_scanned);
+		st->expired += READ_ONCE(gc_work->stat_expired);
+		st->time_ns += READ_ONCE(gc_work->stat_time_ns);
+	}
+	st->shards = GC_SHARDS;
+}
+EXPORT_SYMBOL_GPL(nf_conntrack_gc_stats);
+
+/* Objects in the stash are free as far as SLAB_TYPESAFE_BY_RCU readers
+ * are concerned: handing one out again is no different from the slab
+ * allocator reusing it.
+ */
+static struct nf_conn *nf_conntrack_cache_get(gfp_t gfp)
+{
+	struct nf_conntrack_pcpu_cache *c;
+	struct nf_conn *ct = NULL;
+
+	if (unlikely(in_hardirq() || irqs_disabled()))
+		return kmem_cache_alloc(nf_conntrack_cachep, gfp);
+
+	local_bh_disable();
+	c = this_cpu_ptr(&nf_conntrack_pcpu_cache);
+	if (!c->count)
+		c->count = kmem_cache_alloc_bulk(nf_conntrack_cachep, GFP_ATOMIC,
+						 NF_CT_PCPU_CACHE_SIZE / 2,
+						 (void **)c->objs);
+	if (c->count)
+		ct = c->objs[--c->count];
+	local_bh_enable();
+
+	return ct ?: kmem_cache_alloc(nf_conntrack_cachep, gfp);
+}
+
+static void nf_conntrack_cache_put(struct nf_conn *ct)
+{
+	struct nf_conntrack_pcpu_cache *c;
+
+	if (unlikely(in_hardirq() || irqs_disabled())) {
+		kmem_cache_free(nf_conntrack_cachep, ct);
+		return;
+	}
+
+	local_bh_disable();
+	c = this_cpu_ptr(&nf_conntrack_pcpu_cache);
+	if (c->count < NF_CT_PCPU_CACHE_SIZE) {
+		c->objs[c->count++] = ct;
+		ct = NULL;
+	}
+	local_bh_enable();
+
+	if (ct)
+		kmem_cache_free(nf_conntrack_cachep, ct);
+}
+
+static void nf_conntrack_cache_drain(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct nf_conntrack_pcpu_cache *c;
+
+		c = per_cpu_ptr(&nf_conntrack_pcpu_cache, cpu);
+		kmem_cache_free_bulk(nf_conntrack_cachep, c->count,
+				     (void **)c->objs);
+		c->count = 0;
+	}
+}
+
 static struct nf_conn *
 __nf_conntrack_alloc(struct net *net,
 		     const struct nf_conntrack_zone *zone,
@@ -1616,8 +1765,7 @@ __nf_conntrack_alloc(struct net *net,
 
 	if (nf_conntrack_max && unlikely(ct_count > nf_conntrack_max)) {
 		if (!early_drop(net, hash)) {
-			if (!conntrack_gc_work.early_drop)
-				conntrack_gc_work.early_drop = true;
+			conntrack_gc_set_early_drop();
 			atomic_dec(&cnet->count);
 			net_warn_ratelimited("nf_conntrack: table full, dropping packet\n");
 			return ERR_PTR(-ENOMEM);
@@ -1628,7 +1776,7 @@ __nf_conntrack_alloc(struct net *net,
 	 * Do not use kmem_cache_zalloc(), as this cache uses
 	 * SLAB_TYPESAFE_BY_RCU.
 	 */
-	ct = kmem_cache_alloc(nf_conntrack_cachep, gfp);
+	ct = nf_conntrack_cache_get(gfp);
 	if (ct == NULL)
 		goto out;
 
@@ -1686,7 +1834,7 @@ void nf_conntrack_free(struct nf_conn *ct)
 	}
 
 	kfree(ct->ext);
-	kmem_cache_free(nf_conntrack_cachep, ct);
+	nf_conntrack_cache_put(ct);
 	cnet = nf_ct_pernet(net);
 
 	smp_mb__before_atomic();
@@ -2488,20 +2636,24 @@ static int kill_all(struct nf_conn *i, void *data)
 
 void nf_conntrack_cleanup_start(void)
 {
+	int i;
+
 	cleanup_nf_conntrack_bpf();
-	conntrack_gc_work.exiting = true;
+	for (i = 0; i < GC_SHARDS; i++)
+		conntrack_gc_work[i].exiting = true;
 }
 
 void nf_conntrack_cleanup_end(void)
 {
 	RCU_INIT_POINTER(nf_ct_hook, NULL);
-	cancel_delayed_work_sync(&conntrack_gc_work.dwork);
+	conntrack_gc_stop();
 	kvfree(nf_conntrack_hash);
 
 	nf_conntrack_proto_fini();
 	nf_conntrack_helper_fini();
 	nf_conntrack_expect_fini();
 
+	nf_conntrack_cache_drain();
 	kmem_cache_destroy(nf_conntrack_cachep);
 }
 
@@ -2714,8 +2866,7 @@ int nf_conntrack_init_start(void)
 	if (ret < 0)
 		goto err_proto;
 
-	conntrack_gc_work_init(&conntrack_gc_work);
-	queue_delayed_work(system_power_efficient_wq, &conntrack_gc_work.dwork, HZ);
+	conntrack_gc_start();
 
 	ret = register_nf_conntrack_bpf();
 	if (ret < 0)
@@ -2724,7 +2875,7 @@ int nf_conntrack_init_start(void)
 	return 0;
 
 err_kfunc:
-	cancel_delayed_work_sync(&conntrack_gc_work.dwork);
+	conntrack_gc_stop();
 	nf_conntrack_proto_fini();
 err_proto:
 	nf_conntrack_helper_fini();
@@ -2576,6 +2576,7 @@ ctnetlink_stat_ct_fill_info(struct sk_buff *skb, u32 portid, u32 seq, u32 type,
 			    struct net *net)
 {
 	unsigned int flags = portid ? NLM_F_MULTI : 0, event;
+	struct nf_conntrack_gc_stats gc;
 	unsigned int nr_conntracks;
 	struct nlmsghdr *nlh;
 
@@ -2592,6 +2593,18 @@ ctnetlink_stat_ct_fill_info(struct sk_buff *skb, u32 portid, u32 seq, u32 type,
 	if (nla_put_be32(skb, CTA_STATS_GLOBAL_MAX_ENTRIES, htonl(nf_conntrack_max)))
 		goto nla_put_failure;
 
+	nf_conntrack_gc_stats(&gc);
+	if (nla_put_be32(skb, CTA_STATS_GLOBAL_GC_SHARDS, htonl(gc.shards)) ||
+	    nla_put_be64(skb, CTA_STATS_GLOBAL_GC_PASSES,
+			 cpu_to_be64(gc.passes), CTA_STATS_GLOBAL_PAD) ||
+	    nla_put_be64(skb, CTA_STATS_GLOBAL_GC_SCANNED,
+			 cpu_to_be64(gc.scanned), CTA_STATS_GLOBAL_PAD) ||
+	    nla_put_be64(skb, CTA_STATS_GLOBAL_GC_EXPIRED,
+			 cpu_to_be64(gc.expired), CTA_STATS_GLOBAL_PAD) ||
+	    nla_put_be64(skb, CTA_STATS_GLOBAL_GC_TIME,
+			 cpu_to_be64(gc.time_ns), CTA_STATS_GLOBAL_PAD))
+		goto nla_put_failure;
+
 	nlmsg_end(skb, nlh);
 	return skb->len;
 
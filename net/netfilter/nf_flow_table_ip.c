@@ -3,6 +3,7 @@
 #include <linux/init.h>
 #include <linux/module.h>
 #include <linux/netfilter.h>
+#include <linux/netfilter_netdev.h>
 #include <linux/rhashtable.h>
 #include <linux/ip.h>
 #include <linux/ipv6.h>
@@ -339,7 +340,7 @@ static unsigned int nf_flow_queue_xmit(struct net *net, struct sk_buff *skb,
 	skb->dev = outdev;
 	dev_hard_header(skb, skb->dev, type, tuplehash->tuple.out.h_dest,
 			tuplehash->tuple.out.h_source, skb->len);
-	dev_queue_xmit(skb);
+	nf_ingress_xmit(skb, -1, NULL);
 
 	return NF_STOLEN;
 }
@@ -451,7 +452,7 @@ nf_flow_offload_ip_hook(void *priv, struct sk_buff *skb,
 		skb->dev = outdev;
 		nexthop = rt_nexthop(rt, flow->tuplehash[!dir].tuple.src_v4.s_addr);
 		skb_dst_set_noref(skb, &rt->dst);
-		neigh_xmit(NEIGH_ARP_TABLE, outdev, &nexthop, skb);
+		nf_ingress_xmit(skb, NEIGH_ARP_TABLE, &nexthop);
 		ret = NF_STOLEN;
 		break;
 	case FLOW_OFFLOAD_XMIT_DIRECT:
@@ -746,7 +747,7 @@ nf_flow_offload_ipv6_hook(void *priv, struct sk_buff *skb,
 		skb->dev = outdev;
 		nexthop = rt6_nexthop(rt, &flow->tuplehash[!dir].tuple.src_v6);
 		skb_dst_set_noref(skb, &rt->dst);
-		neigh_xmit(NEIGH_ND_TABLE, outdev, nexthop, skb);
+		nf_ingress_xmit(skb, NEIGH_ND_TABLE, nexthop);
 		ret = NF_STOLEN;
 		break;
 	case FLOW_OFFLOAD_XMIT_DIRECT:
@@ -1718,6 +1718,9 @@ static int netlink_setsockopt(struct socket *sock, int level, int optname,
 	case NETLINK_GET_STRICT_CHK:
 		nr = NETLINK_F_STRICT_CHK;
 		break;
+	case NETLINK_DUMP_BATCH:
+		nr = NETLINK_F_DUMP_BATCH;
+		break;
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -1785,6 +1788,9 @@ static int netlink_getsockopt(struct socket *sock, int level, int optname,
 	case NETLINK_GET_STRICT_CHK:
 		flag = NETLINK_F_STRICT_CHK;
 		break;
+	case NETLINK_DUMP_BATCH:
+		flag = NETLINK_F_DUMP_BATCH;
+		break;
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -1909,6 +1915,62 @@ static int netlink_sendmsg(struct socket *sock, struct msghdr *msg, size_t len)
 	return err;
 }
 
+/* Only kernel unicast messages, such as dump replies, are batched: they
+ * share the source address and credentials reported for the first one.
+ */
+static bool netlink_skb_batchable(const struct sk_buff *skb)
+{
+	return !NETLINK_CB(skb).portid && !NETLINK_CB(skb).dst_group &&
+	       !skb_shinfo(skb)->frag_list;
+}
+
+/* NETLINK_DUMP_BATCH: append whole queued replies after the first one,
+ * running the dump again whenever the queue runs dry, until the next reply
+ * would not fit in the rest of the buffer. Returns the bytes copied.
+ */
+static size_t netlink_recv_batch(struct sock *sk, struct msghdr *msg,
+				 size_t room)
+{
+	struct netlink_sock *nlk = nlk_sk(sk);
+	struct sk_buff_head *queue = &sk->sk_receive_queue;
+	struct sk_buff *skb;
+	size_t copied = 0;
+	int ret;
+
+	for (;;) {
+		if (skb_queue_empty_lockless(queue)) {
+			if (!READ_ONCE(nlk->cb_running))
+				break;
+			ret = netlink_dump(sk, false);
+			if (ret) {
+				WRITE_ONCE(sk->sk_err, -ret);
+				sk_error_report(sk);
+				break;
+			}
+		}
+
+		spin_lock_bh(&queue->lock);
+		skb = skb_peek(queue);
+		if (!skb || skb->len > room - copied ||
+		    !netlink_skb_batchable(skb)) {
+			spin_unlock_bh(&queue->lock);
+			break;
+		}
+		__skb_unlink(skb, queue);
+		spin_unlock_bh(&queue->lock);
+
+		/* The reply is lost either way, as with a failing recvmsg() */
+		ret = skb_copy_datagram_msg(skb, 0, msg, skb->len);
+		if (!ret)
+			copied += skb->len;
+		skb_free_datagram(sk, skb);
+		if (ret)
+			break;
+	}
+
+	return copied;
+}
+
 static int netlink_recvmsg(struct socket *sock, struct msghdr *msg, size_t len,
 			   int flags)
 {
@@ -1917,6 +1979,7 @@ static int netlink_recvmsg(struct socket *sock, struct msghdr *msg, size_t len,
 	struct netlink_sock *nlk = nlk_sk(sk);
 	size_t copied, max_recvmsg_len;
 	struct sk_buff *skb, *data_skb;
+	bool batch;
 	int err, ret;
 
 	if (flags & MSG_OOB)
@@ -1977,6 +2040,9 @@ static int netlink_recvmsg(struct socket *sock, struct msghdr *msg, size_t len,
 
 	memset(&scm, 0, sizeof(scm));
 	scm.creds = *NETLINK_CREDS(skb);
+	batch = !err && copied == data_skb->len &&
+		nlk_test_bit(DUMP_BATCH, sk) && netlink_skb_batchable(skb) &&
+		!(flags & (MSG_PEEK | MSG_TRUNC | MSG_CMSG_COMPAT));
 	if (flags & MSG_TRUNC)
 		copied = data_skb->len;
 
@@ -1988,9 +2054,13 @@ static int netlink_recvmsg(struct socket *sock, struct msghdr *msg, size_t len,
 		if (ret) {
 			WRITE_ONCE(sk->sk_err, -ret);
 			sk_error_report(sk);
+			batch = false;
 		}
 	}
 
+	if (batch)
+		copied += netlink_recv_batch(sk, msg, len - copied);
+
 	scm_recv(sock, msg, &scm, flags);
 out:
 	netlink_rcv_wake(sk);
@@ -17,6 +17,7 @@ enum {
 	NETLINK_F_CAP_ACK,
 	NETLINK_F_EXT_ACK,
 	NETLINK_F_STRICT_CHK,
+	NETLINK_F_DUMP_BATCH,
 };
 
 #define NLGRPSZ(x)	(ALIGN(x, sizeof(unsigned long) * 8) / 8)
@@ -94,6 +94,18 @@ struct fl_flow_mask {
 	struct rcu_work rwork;
 	struct list_head list;
 	refcount_t refcnt;
+	u64 gen;
+};
+
+/* Union of the keys of all masks of a classifier instance, so that a packet
+ * only needs to be dissected once for all masks that it covers.
+ */
+struct fl_flow_mask_union {
+	struct fl_flow_key key;
+	struct fl_flow_mask_range range;
+	struct flow_dissector dissector;
+	u64 gen;	/* covers all masks up to this generation */
+	struct rcu_head rcu;
 };
 
 struct fl_flow_tmplt {
@@ -107,6 +119,8 @@ struct cls_fl_head {
 	struct rhashtable ht;
 	spinlock_t masks_lock; /* Protect masks list */
 	struct list_head masks;
+	u64 mask_gen;
+	struct fl_flow_mask_union __rcu *mask_union;
 	struct list_head hw_filters;
 	struct rcu_work rwork;
 	struct idr handle_idr;
@@ -147,10 +161,11 @@ static unsigned short int fl_mask_range(const struct fl_flow_mask *mask)
 	return mask->range.end - mask->range.start;
 }
 
-static void fl_mask_update_range(struct fl_flow_mask *mask)
+static void fl_key_update_range(const struct fl_flow_key *key,
+				struct fl_flow_mask_range *range)
 {
-	const u8 *bytes = (const u8 *) &mask->key;
-	size_t size = sizeof(mask->key);
+	const u8 *bytes = (const u8 *) key;
+	size_t size = sizeof(*key);
 	size_t i, first = 0, last;
 
 	for (i = 0; i < size; i++) {
@@ -166,8 +181,13 @@ static void fl_mask_update_range(struct fl_flow_mask *mask)
 			break;
 		}
 	}
-	mask->range.start = rounddown(first, sizeof(long));
-	mask->range.end = roundup(last + 1, sizeof(long));
+	range->start = rounddown(first, sizeof(long));
+	range->end = roundup(last + 1, sizeof(long));
+}
+
+static void fl_mask_update_range(struct fl_flow_mask *mask)
+{
+	fl_key_update_range(&mask->key, &mask->range);
 }
 
 static void *fl_key_get_start(struct fl_flow_key *key,
@@ -206,9 +226,9 @@ static bool fl_mask_fits_tmplt(struct fl_flow_tmplt *tmplt,
 }
 
 static void fl_clear_masked_range(struct fl_flow_key *key,
-				  struct fl_flow_mask *mask)
+				  const struct fl_flow_mask_range *range)
 {
-	memset(fl_key_get_start(key, mask), 0, fl_mask_range(mask));
+	memset((u8 *) key + range->start, 0, range->end - range->start);
 }
 
 static bool fl_range_port_dst_cmp(struct cls_fl_filter *filter,
@@ -311,34 +331,57 @@ static u16 fl_ct_info_to_flower_map[] = {
 					TCA_FLOWER_KEY_CT_FLAGS_NEW,
 };
 
+static void fl_dissect(struct sk_buff *skb, struct flow_dissector *dissector,
+		       const struct fl_flow_mask_range *range,
+		       struct fl_flow_key *skb_key)
+{
+	bool post_ct = tc_skb_cb(skb)->post_ct;
+	u16 zone = tc_skb_cb(skb)->zone;
+
+	flow_dissector_init_keys(&skb_key->control, &skb_key->basic);
+	fl_clear_masked_range(skb_key, range);
+
+	skb_flow_dissect_meta(skb, dissector, skb_key);
+	/* skb_flow_dissect() does not set n_proto in case an unknown
+	 * protocol, so do it rather here.
+	 */
+	skb_key->basic.n_proto = skb_protocol(skb, false);
+	skb_flow_dissect_tunnel_info(skb, dissector, skb_key);
+	skb_flow_dissect_ct(skb, dissector, skb_key,
+			    fl_ct_info_to_flower_map,
+			    ARRAY_SIZE(fl_ct_info_to_flower_map),
+			    post_ct, zone);
+	skb_flow_dissect_hash(skb, dissector, skb_key);
+	skb_flow_dissect(skb, dissector, skb_key,
+			 FLOW_DISSECTOR_F_STOP_BEFORE_ENCAP);
+}
+
 TC_INDIRECT_SCOPE int fl_classify(struct sk_buff *skb,
 				  const struct tcf_proto *tp,
 				  struct tcf_result *res)
 {
 	struct cls_fl_head *head = rcu_dereference_bh(tp->root);
-	bool post_ct = tc_skb_cb(skb)->post_ct;
-	u16 zone = tc_skb_cb(skb)->zone;
+	struct fl_flow_mask_union *mask_union;
 	struct fl_flow_key skb_key;
 	struct fl_flow_mask *mask;
 	struct cls_fl_filter *f;
+	bool dissected = false;
 
+	mask_union = rcu_dereference_bh(head->mask_union);
 	list_for_each_entry_rcu(mask, &head->masks, list) {
-		flow_dissector_init_keys(&skb_key.control, &skb_key.basic);
-		fl_clear_masked_range(&skb_key, mask);
-
-		skb_flow_dissect_meta(skb, &mask->dissector, &skb_key);
-		/* skb_flow_dissect() does not set n_proto in case an unknown
-		 * protocol, so do it rather here.
+		/* Masks added after the union was last rebuilt are not covered
+		 * by it and get to dissect the packet on their own.
 		 */
-		skb_key.basic.n_proto = skb_protocol(skb, false);
-		skb_flow_dissect_tunnel_info(skb, &mask->dissector, &skb_key);
-		skb_flow_dissect_ct(skb, &mask->dissector, &skb_key,
-				    fl_ct_info_to_flower_map,
-				    ARRAY_SIZE(fl_ct_info_to_flower_map),
-				    post_ct, zone);
-		skb_flow_dissect_hash(skb, &mask->dissector, &skb_key);
-		skb_flow_dissect(skb, &mask->dissector, &skb_key,
-				 FLOW_DISSECTOR_F_STOP_BEFORE_ENCAP);
+		if (mask_union && mask->gen <= mask_union->gen) {
+			if (!dissected)
+				fl_dissect(skb, &mask_union->dissector,
+					   &mask_union->range, &skb_key);
+			dissected = true;
+		} else {
+			fl_dissect(skb, &mask->dissector, &mask->range,
+				   &skb_key);
+			dissected = false;
+		}
 
 		f = fl_mask_lookup(mask, &skb_key);
 		if (f && !tc_skip_sw(f->flags)) {
@@ -392,6 +435,8 @@ static void fl_uninit_mask_free_work(struct work_struct *work)
 	fl_mask_free(mask, false);
 }
 
+static void fl_mask_union_update(struct cls_fl_head *head);
+
 static bool fl_mask_put(struct cls_fl_head *head, struct fl_flow_mask *mask)
 {
 	if (!refcount_dec_and_test(&mask->refcnt))
@@ -401,6 +446,7 @@ static bool fl_mask_put(struct cls_fl_head *head, struct fl_flow_mask *mask)
 
 	spin_lock(&head->masks_lock);
 	list_del_rcu(&mask->list);
+	fl_mask_union_update(head);
 	spin_unlock(&head->masks_lock);
 
 	tcf_queue_work(&mask->rwork, fl_mask_free_work);
@@ -582,6 +628,7 @@ static void fl_destroy_sleepable(struct work_struct *work)
 						rwork);
 
 	rhashtable_destroy(&head->ht);
+	kfree(rcu_dereference_protected(head->mask_union, 1));
 	kfree(head);
 	module_put(THIS_MODULE);
 }
@@ -2179,6 +2226,40 @@ static void fl_init_dissector(struct flow_dissector *dissector,
 	skb_flow_dissector_init(dissector, keys, cnt);
 }
 
+/* Called with masks_lock held whenever the masks list changes. A mask being
+ * removed has no filters left, so it doesn't matter that a reader still
+ * walking it may look it up with a key dissected for the new union.
+ */
+static void fl_mask_union_update(struct cls_fl_head *head)
+{
+	struct fl_flow_mask_union *mask_union, *old;
+	struct fl_flow_mask *mask;
+	int i;
+
+	/* On failure, the old union still covers all remaining masks up to
+	 * its generation and newer ones are dissected on their own.
+	 */
+	mask_union = kzalloc(sizeof(*mask_union), GFP_ATOMIC);
+	if (!mask_union)
+		return;
+
+	list_for_each_entry(mask, &head->masks, list) {
+		const long *lmask = (const long *) &mask->key;
+		long *lunion = (long *) &mask_union->key;
+
+		for (i = 0; i < sizeof(mask->key); i += sizeof(long))
+			*lunion++ |= *lmask++;
+	}
+	fl_key_update_range(&mask_union->key, &mask_union->range);
+	fl_init_dissector(&mask_union->dissector, &mask_union->key);
+	mask_union->gen = head->mask_gen;
+
+	old = rcu_replace_pointer(head->mask_union, mask_union,
+				  lockdep_is_held(&head->masks_lock));
+	if (old)
+		kfree_rcu(old, rcu);
+}
+
 static struct fl_flow_mask *fl_create_new_mask(struct cls_fl_head *head,
 					       struct fl_flow_mask *mask)
 {
@@ -2212,7 +2293,9 @@ static struct fl_flow_mask *fl_create_new_mask(struct cls_fl_head *head,
 		goto errout_destroy;
 
 	spin_lock(&head->masks_lock);
+	newmask->gen = ++head->mask_gen;
 	list_add_tail_rcu(&newmask->list, &head->masks);
+	fl_mask_union_update(head);
 	spin_unlock(&head->masks_lock);
 
 	return newmask;
@@ -28,6 +28,12 @@
  *  Note : When a flow becomes empty, we do not immediately remove it from
  *  rb trees, for performance reasons (its expected to send additional packets,
  *  or SLAB cache will reuse socket for another flow)
+ *
+ *  fq_lockless variant (TCQ_F_NOLOCK) :
+ *   - enqueue() only stores the skb in a per-cpu staging ring, so that
+ *     producers on many cpus never contend on the qdisc root lock.
+ *   - the single dequeuer (owner of qdisc seqlock) drains the staging
+ *     rings into the flow tables before running the usual dequeue().
  */
 
 #include <linux/module.h>
@@ -44,6 +50,9 @@
 #include <linux/hash.h>
 #include <linux/prefetch.h>
 #include <linux/vmalloc.h>
+#include <linux/ptr_ring.h>
+#include <linux/cpumask.h>
+#include <linux/percpu.h>
 #include <net/netlink.h>
 #include <net/pkt_sched.h>
 #include <net/sock.h>
@@ -108,6 +117,9 @@ struct fq_perband_flows {
 
 #define FQ_PRIO2BAND_CRUMB_SIZE ((TC_PRIO_MAX + 1) >> 2)
 
+/* Per cpu staging ring size, for fq_lockless */
+#define FQ_STAGE_SIZE 256
+
 struct fq_sched_data {
 /* Read mostly cache line */
 
@@ -126,6 +138,8 @@ struct fq_sched_data {
 	u8		horizon_drop;
 	u8		prio2band[FQ_PRIO2BAND_CRUMB_SIZE];
 	u32		timer_slack; /* hrtimer slack in ns */
+	struct ptr_ring __percpu *stage; /* fq_lockless staging rings */
+	cpumask_var_t	stage_mask;	/* cpus with staged packets */
 
 /* Read/Write fields. */
 
@@ -298,6 +312,39 @@ static void fq_gc(struct fq_sched_data *q,
 	kmem_cache_free_bulk(fq_flow_cachep, fcnt, tofree);
 }
 
+/* fq_lockless uses per cpu stats, unless it was grafted under a parent
+ * that does not support TCQ_F_NOLOCK (see qdisc_clear_nolock())
+ */
+static void fq_qstats_enqueue(struct Qdisc *sch, const struct sk_buff *skb)
+{
+	if (qdisc_is_percpu_stats(sch)) {
+		qdisc_qstats_cpu_backlog_inc(sch, skb);
+		qdisc_qstats_cpu_qlen_inc(sch);
+	} else {
+		qdisc_qstats_backlog_inc(sch, skb);
+	}
+	sch->q.qlen++;
+}
+
+static void fq_qstats_dequeue(struct Qdisc *sch, const struct sk_buff *skb)
+{
+	if (qdisc_is_percpu_stats(sch)) {
+		qdisc_qstats_cpu_backlog_dec(sch, skb);
+		qdisc_qstats_cpu_qlen_dec(sch);
+	} else {
+		qdisc_qstats_backlog_dec(sch, skb);
+	}
+	sch->q.qlen--;
+}
+
+static int fq_drop(struct sk_buff *skb, struct Qdisc *sch,
+		   struct sk_buff **to_free)
+{
+	if (qdisc_is_percpu_stats(sch))
+		return qdisc_drop_cpu(skb, sch, to_free);
+	return qdisc_drop(skb, sch, to_free);
+}
+
 /* Fast path can be used if :
  * 1) Packet tstamp is in the past.
  * 2) FQ qlen == 0   OR
@@ -487,8 +534,7 @@ static void fq_dequeue_skb(struct Qdisc *sch, struct fq_flow *flow,
 {
 	fq_erase_head(sch, flow, skb);
 	skb_mark_not_on_list(skb);
-	qdisc_qstats_backlog_dec(sch, skb);
-	sch->q.qlen--;
+	fq_qstats_dequeue(sch, skb);
 }
 
 static void flow_queue_add(struct fq_flow *flow, struct sk_buff *skb)
@@ -529,8 +575,8 @@ static bool fq_packet_beyond_horizon(const struct sk_buff *skb,
 	return unlikely((s64)skb->tstamp > (s64)(now + q->horizon));
 }
 
-static int fq_enqueue(struct sk_buff *skb, struct Qdisc *sch,
-		      struct sk_buff **to_free)
+static int __fq_enqueue(struct sk_buff *skb, struct Qdisc *sch,
+			struct sk_buff **to_free)
 {
 	struct fq_sched_data *q = qdisc_priv(sch);
 	struct fq_flow *f;
@@ -540,7 +586,7 @@ static int fq_enqueue(struct sk_buff *skb, struct Qdisc *sch,
 	band = fq_prio2band(q->prio2band, skb->priority & TC_PRIO_MAX);
 	if (unlikely(q->band_pkt_count[band] >= sch->limit)) {
 		q->stat_band_drops[band]++;
-		return qdisc_drop(skb, sch, to_free);
+		return fq_drop(skb, sch, to_free);
 	}
 
 	now = ktime_get_ns();
@@ -551,7 +597,7 @@ static int fq_enqueue(struct sk_buff *skb, struct Qdisc *sch,
 		if (fq_packet_beyond_horizon(skb, q, now)) {
 			if (q->horizon_drop) {
 					q->stat_horizon_drops++;
-					return qdisc_drop(skb, sch, to_free);
+					return fq_drop(skb, sch, to_free);
 			}
 			q->stat_horizon_caps++;
 			skb->tstamp = now + q->horizon;
@@ -564,7 +610,7 @@ static int fq_enqueue(struct sk_buff *skb, struct Qdisc *sch,
 	if (f != &q->internal) {
 		if (unlikely(f->qlen >= q->flow_plimit)) {
 			q->stat_flows_plimit++;
-			return qdisc_drop(skb, sch, to_free);
+			return fq_drop(skb, sch, to_free);
 		}
 
 		if (fq_flow_is_detached(f)) {
@@ -584,12 +630,136 @@ static int fq_enqueue(struct sk_buff *skb, struct Qdisc *sch,
 	/* Note: this overwrites f->age */
 	flow_queue_add(f, skb);
 
-	qdisc_qstats_backlog_inc(sch, skb);
-	sch->q.qlen++;
+	fq_qstats_enqueue(sch, skb);
 
 	return NET_XMIT_SUCCESS;
 }
 
+static int fq_enqueue(struct sk_buff *skb, struct Qdisc *sch,
+		      struct sk_buff **to_free)
+{
+	return __fq_enqueue(skb, sch, to_free);
+}
+
+/* fq_lockless enqueue() runs without qdisc lock, with BH disabled.
+ * Each cpu is the only producer of its staging ring.
+ * Limits are enforced later, when fq_stage_drain() feeds __fq_enqueue().
+ */
+static int fq_lockless_enqueue(struct sk_buff *skb, struct Qdisc *sch,
+			       struct sk_buff **to_free)
+{
+	struct fq_sched_data *q = qdisc_priv(sch);
+	int cpu;
+
+	if (!(sch->flags & TCQ_F_NOLOCK))
+		return __fq_enqueue(skb, sch, to_free);
+
+	if (unlikely(__ptr_ring_produce(this_cpu_ptr(q->stage), skb)))
+		return qdisc_drop_cpu(skb, sch, to_free);
+
+	/* Pairs with smp_mb__after_atomic() in fq_stage_drain() :
+	 * either the dequeuer sees our bit, or we see it was not cleared yet.
+	 */
+	smp_mb();
+	cpu = smp_processor_id();
+	if (!cpumask_test_cpu(cpu, q->stage_mask))
+		cpumask_set_cpu(cpu, q->stage_mask);
+
+	return NET_XMIT_SUCCESS;
+}
+
+/* Move staged packets into flow tables. Caller owns qdisc seqlock. */
+static void fq_stage_drain(struct Qdisc *sch)
+{
+	struct fq_sched_data *q = qdisc_priv(sch);
+	struct sk_buff *skb, *to_free = NULL;
+	int cpu;
+
+	for_each_cpu(cpu, q->stage_mask) {
+		struct ptr_ring *r = per_cpu_ptr(q->stage, cpu);
+
+		cpumask_clear_cpu(cpu, q->stage_mask);
+		smp_mb__after_atomic();
+		while ((skb = __ptr_ring_consume(r)) != NULL)
+			__fq_enqueue(skb, sch, &to_free);
+	}
+	if (unlikely(to_free))
+		kfree_skb_list_reason(to_free, SKB_DROP_REASON_QDISC_DROP);
+}
+
+static void fq_stage_purge(struct Qdisc *sch)
+{
+	struct fq_sched_data *q = qdisc_priv(sch);
+	struct sk_buff *skb;
+	int cpu;
+
+	if (!q->stage)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct ptr_ring *r = per_cpu_ptr(q->stage, cpu);
+
+		while ((skb = __ptr_ring_consume(r)) != NULL)
+			rtnl_kfree_skbs(skb, skb);
+	}
+	cpumask_clear(q->stage_mask);
+}
+
+static void fq_stage_free(struct Qdisc *sch)
+{
+	struct fq_sched_data *q = qdisc_priv(sch);
+	int cpu;
+
+	if (!q->stage)
+		return;
+
+	for_each_possible_cpu(cpu)
+		ptr_ring_cleanup(per_cpu_ptr(q->stage, cpu), NULL);
+	free_percpu(q->stage);
+	free_cpumask_var(q->stage_mask);
+	q->stage = NULL;
+}
+
+static int fq_stage_alloc(struct Qdisc *sch)
+{
+	struct fq_sched_data *q = qdisc_priv(sch);
+	int cpu, err;
+
+	q->stage = alloc_percpu(struct ptr_ring);
+	if (!q->stage)
+		return -ENOMEM;
+
+	if (!zalloc_cpumask_var(&q->stage_mask, GFP_KERNEL))
+		goto nomem;
+
+	for_each_possible_cpu(cpu) {
+		err = ptr_ring_init(per_cpu_ptr(q->stage, cpu), FQ_STAGE_SIZE,
+				    GFP_KERNEL);
+		if (err)
+			goto nomem;
+	}
+	return 0;
+
+nomem:
+	fq_stage_free(sch);
+	return -ENOMEM;
+}
+
+/* fq_lockless control path must also exclude the dequeuer */
+static void fq_tree_lock(struct Qdisc *sch)
+{
+	if (sch->flags & TCQ_F_NOLOCK)
+		spin_lock_bh(&sch->seqlock);
+	sch_tree_lock(sch);
+}
+
+static void fq_tree_unlock(struct Qdisc *sch)
+{
+	sch_tree_unlock(sch);
+	if (sch->flags & TCQ_F_NOLOCK)
+		spin_unlock_bh(&sch->seqlock);
+}
+
 static void fq_check_throttled(struct fq_sched_data *q, u64 now)
 {
 	unsigned long sample;
@@ -640,6 +810,9 @@ static struct sk_buff *fq_dequeue(struct Qdisc *sch)
 	u32 plen;
 	u64 now;
 
+	if (q->stage)
+		fq_stage_drain(sch);
+
 	if (!sch->q.qlen)
 		return NULL;
 
@@ -757,7 +930,10 @@ static struct sk_buff *fq_dequeue(struct Qdisc *sch)
 		f->time_next_packet = now + len;
 	}
 out:
-	qdisc_bstats_update(sch, skb);
+	if (qdisc_is_percpu_stats(sch))
+		qdisc_bstats_cpu_update(sch, skb);
+	else
+		qdisc_bstats_update(sch, skb);
 	return skb;
 }
 
@@ -787,7 +963,19 @@ static void fq_reset(struct Qdisc *sch)
 
 	sch->q.qlen = 0;
 	sch->qstats.backlog = 0;
+	if (qdisc_is_percpu_stats(sch)) {
+		int i;
 
+		for_each_possible_cpu(i) {
+			struct gnet_stats_queue *qs;
+
+			qs = per_cpu_ptr(sch->cpu_qstats, i);
+			qs->backlog = 0;
+			qs->qlen = 0;
+		}
+	}
+
+	fq_stage_purge(sch);
 	fq_flow_purge(&q->internal);
 
 	if (!q->fq_root)
@@ -883,7 +1071,7 @@ static int fq_resize(struct Qdisc *sch, u32 log)
 	for (idx = 0; idx < (1U << log); idx++)
 		array[idx] = RB_ROOT;
 
-	sch_tree_lock(sch);
+	fq_tree_lock(sch);
 
 	old_fq_root = q->fq_root;
 	if (old_fq_root)
@@ -892,7 +1080,7 @@ static int fq_resize(struct Qdisc *sch, u32 log)
 	q->fq_root = array;
 	WRITE_ONCE(q->fq_trees_log, log);
 
-	sch_tree_unlock(sch);
+	fq_tree_unlock(sch);
 
 	fq_free(old_fq_root);
 
@@ -1004,7 +1192,7 @@ static int fq_change(struct Qdisc *sch, struct nlattr *opt,
 	if (err < 0)
 		return err;
 
-	sch_tree_lock(sch);
+	fq_tree_lock(sch);
 
 	fq_log = q->fq_trees_log;
 
@@ -1100,9 +1288,9 @@ static int fq_change(struct Qdisc *sch, struct nlattr *opt,
 
 	if (!err) {
 
-		sch_tree_unlock(sch);
+		fq_tree_unlock(sch);
 		err = fq_resize(sch, fq_log);
-		sch_tree_lock(sch);
+		fq_tree_lock(sch);
 	}
 	while (sch->q.qlen > sch->limit) {
 		struct sk_buff *skb = fq_dequeue(sch);
@@ -1115,7 +1303,7 @@ static int fq_change(struct Qdisc *sch, struct nlattr *opt,
 	}
 	qdisc_tree_reduce_backlog(sch, drop_count, drop_len);
 
-	sch_tree_unlock(sch);
+	fq_tree_unlock(sch);
 	return err;
 }
 
@@ -1124,6 +1312,7 @@ static void fq_destroy(struct Qdisc *sch)
 	struct fq_sched_data *q = qdisc_priv(sch);
 
 	fq_reset(sch);
+	fq_stage_free(sch);
 	fq_free(q->fq_root);
 	qdisc_watchdog_cancel(&q->watchdog);
 }
@@ -1166,6 +1355,13 @@ static int fq_init(struct Qdisc *sch, struct nlattr *opt,
 	fq_prio2band_compress_crumb(sch_default_prio2band, q->prio2band);
 	qdisc_watchdog_init_clockid(&q->watchdog, sch, CLOCK_MONOTONIC);
 
+	q->stage = NULL;
+	if (sch->flags & TCQ_F_NOLOCK) {
+		err = fq_stage_alloc(sch);
+		if (err)
+			return err;
+	}
+
 	if (opt)
 		err = fq_change(sch, opt, extack);
 	else
@@ -1250,7 +1446,7 @@ static int fq_dump_stats(struct Qdisc *sch, struct gnet_dump *d)
 
 	st.pad = 0;
 
-	sch_tree_lock(sch);
+	fq_tree_lock(sch);
 
 	st.gc_flows		  = q->stat_gc_flows;
 	st.highprio_packets	  = 0;
@@ -1274,7 +1470,7 @@ static int fq_dump_stats(struct Qdisc *sch, struct gnet_dump *d)
 		st.band_drops[i]  = q->stat_band_drops[i];
 		st.band_pkt_count[i] = q->band_pkt_count[i];
 	}
-	sch_tree_unlock(sch);
+	fq_tree_unlock(sch);
 
 	return gnet_stats_copy_app(d, &st, sizeof(st));
 }
@@ -1296,6 +1492,24 @@ static struct Qdisc_ops fq_qdisc_ops __read_mostly = {
 };
 MODULE_ALIAS_NET_SCH("fq");
 
+static struct Qdisc_ops fq_lockless_qdisc_ops __read_mostly = {
+	.id		=	"fq_lockless",
+	.priv_size	=	sizeof(struct fq_sched_data),
+	.static_flags	=	TCQ_F_NOLOCK | TCQ_F_CPUSTATS,
+
+	.enqueue	=	fq_lockless_enqueue,
+	.dequeue	=	fq_dequeue,
+	.peek		=	qdisc_peek_dequeued,
+	.init		=	fq_init,
+	.reset		=	fq_reset,
+	.destroy	=	fq_destroy,
+	.change		=	fq_change,
+	.dump		=	fq_dump,
+	.dump_stats	=	fq_dump_stats,
+	.owner		=	THIS_MODULE,
+};
+MODULE_ALIAS_NET_SCH("fq_lockless");
+
 static int __init fq_module_init(void)
 {
 	int ret;
@@ -1308,12 +1522,23 @@ static int __init fq_module_init(void)
 
 	ret = register_qdisc(&fq_qdisc_ops);
 	if (ret)
-		kmem_cache_destroy(fq_flow_cachep);
+		goto err_cache;
+
+	ret = register_qdisc(&fq_lockless_qdisc_ops);
+	if (ret)
+		goto err_fq;
+	return 0;
+
+err_fq:
+	unregister_qdisc(&fq_qdisc_ops);
+err_cache:
+	kmem_cache_destroy(fq_flow_cachep);
 	return ret;
 }
 
 static void __exit fq_module_exit(void)
 {
+	unregister_qdisc(&fq_lockless_qdisc_ops);
 	unregister_qdisc(&fq_qdisc_ops);
 	kmem_cache_destroy(fq_flow_cachep);
 }
@@ -37,7 +37,7 @@
 
 static void svc_unregister(const struct svc_serv *serv, struct net *net);
 
-#define SVC_POOL_DEFAULT	SVC_POOL_GLOBAL
+#define SVC_POOL_DEFAULT	SVC_POOL_AUTO
 
 /*
  * Mode for mapping cpus to pools.
@@ -131,8 +131,6 @@ module_param_call(pool_mode, param_set_pool_mode, param_get_pool_mode,
 static int
 svc_pool_map_choose_mode(void)
 {
-	unsigned int node;
-
 	if (nr_online_nodes > 1) {
 		/*
 		 * Actually have multiple NUMA nodes,
@@ -141,18 +139,12 @@ svc_pool_map_choose_mode(void)
 		return SVC_POOL_PERNODE;
 	}
 
-	node = first_online_node;
-	if (nr_cpus_node(node) > 2) {
-		/*
-		 * Non-trivial SMP, or CONFIG_NUMA on
-		 * non-NUMA hardware, e.g. with a generic
-		 * x86_64 kernel on Xeons.  In this case we
-		 * want to divide the pools on cpu boundaries.
-		 */
-		return SVC_POOL_PERCPU;
-	}
-
-	/* default: one global pool */
+	/*
+	 * Per-cpu pools are not chosen automatically: with fewer
+	 * threads than cpus, most pools would have no thread to
+	 * serve the transports queued on them.  They can still be
+	 * requested with pool_mode=percpu.
+	 */
 	return SVC_POOL_GLOBAL;
 }
 
@@ -371,7 +363,8 @@ struct svc_pool *svc_pool_for_cpu(struct svc_serv *serv)
 {
 	struct svc_pool_map *m = &svc_pool_map;
 	int cpu = raw_smp_processor_id();
-	unsigned int pidx = 0;
+	unsigned int pidx = 0, i;
+	struct svc_pool *pool;
 
 	if (serv->sv_nrpools <= 1)
 		return serv->sv_pools;
@@ -385,6 +378,16 @@ struct svc_pool *svc_pool_for_cpu(struct svc_serv *serv)
 		break;
 	}
 
+	/*
+	 * Stay on the local pool whenever it has threads, so that the
+	 * request is processed on the node that received it. Otherwise
+	 * fall back to the next pool that can serve it.
+	 */
+	for (i = 0; i < serv->sv_nrpools; i++) {
+		pool = &serv->sv_pools[(pidx + i) % serv->sv_nrpools];
+		if (atomic_read(&pool->sp_nrthreads))
+			return pool;
+	}
 	return &serv->sv_pools[pidx % serv->sv_nrpools];
 }
 
@@ -721,6 +724,9 @@ void svc_pool_wake_idle_thread(struct svc_pool *pool)
 	}
 	rcu_read_unlock();
 
+	/* Every thread is busy; let the service grow the pool if it can */
+	if (!test_bit(SP_CONGESTED, &pool->sp_flags))
+		set_bit(SP_CONGESTED, &pool->sp_flags);
 }
 EXPORT_SYMBOL_GPL(svc_pool_wake_idle_thread);
 
@@ -1058,6 +1058,16 @@ static int tls_get_info(struct sock *sk, struct sk_buff *skb)
 		if (err)
 			goto nla_failure;
 	}
+	if (ctx->rx_conf == TLS_SW) {
+		err = nla_put_u32(skb, TLS_INFO_RX_ASYNC_RECORDS,
+				  READ_ONCE(ctx->rx_async_records));
+		if (err)
+			goto nla_failure;
+		err = nla_put_u32(skb, TLS_INFO_RX_ASYNC_INFLIGHT_MAX,
+				  READ_ONCE(ctx->rx_async_inflight_max));
+		if (err)
+			goto nla_failure;
+	}
 
 	rcu_read_unlock();
 	nla_nest_end(skb, start);
@@ -1080,6 +1090,8 @@ static size_t tls_get_info_size(const struct sock *sk)
 		nla_total_size(sizeof(u16)) +	/* TLS_INFO_TXCONF */
 		nla_total_size(0) +		/* TLS_INFO_ZC_RO_TX */
 		nla_total_size(0) +		/* TLS_INFO_RX_NO_PAD */
+		nla_total_size(sizeof(u32)) +	/* TLS_INFO_RX_ASYNC_RECORDS */
+		nla_total_size(sizeof(u32)) +	/* TLS_INFO_RX_ASYNC_INFLIGHT_MAX */
 		0;
 
 	return size;
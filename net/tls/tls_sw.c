@@ -287,8 +287,16 @@ static int tls_do_decryption(struct sock *sk,
 	}
 
 	ret = crypto_aead_decrypt(aead_req);
-	if (ret == -EINPROGRESS)
+	if (ret == -EINPROGRESS) {
+		/* decrypt_pending is biased by one while nothing is in flight */
+		u32 inflight = atomic_read(&ctx->decrypt_pending) - 1;
+
+		WRITE_ONCE(tls_ctx->rx_async_records,
+			   tls_ctx->rx_async_records + 1);
+		if (inflight > tls_ctx->rx_async_inflight_max)
+			WRITE_ONCE(tls_ctx->rx_async_inflight_max, inflight);
 		return 0;
+	}
 
 	if (ret == -EBUSY) {
 		ret = tls_decrypt_async_wait(ctx);
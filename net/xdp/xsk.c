@@ -34,6 +34,8 @@
 
 #define TX_BATCH_SIZE 32
 #define MAX_PER_SOCKET_BUDGET (TX_BATCH_SIZE)
+/* Complete packets the generic Tx path hands to the driver at once */
+#define TX_BULK_SIZE 16
 
 static DEFINE_PER_CPU(struct list_head, xskmap_flush_list);
 
@@ -331,7 +333,9 @@ static int xsk_rcv_check(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
 static void xsk_flush(struct xdp_sock *xs)
 {
 	xskq_prod_submit(xs->rx);
+	xp_fq_lock(xs->pool);
 	__xskq_cons_release(xs->pool->fq);
+	xp_fq_unlock(xs->pool);
 	sock_def_readable(&xs->sk);
 }
 
@@ -782,10 +786,51 @@ static struct sk_buff *xsk_build_skb(struct xdp_sock *xs,
 	return ERR_PTR(err);
 }
 
+static int xsk_generic_xmit_bulk(struct xdp_sock *xs, struct sk_buff **bulk,
+				 unsigned int *nr_bulk, bool *sent_frame)
+{
+	unsigned int i, n = *nr_bulk, sent;
+	int err;
+
+	*nr_bulk = 0;
+	err = __dev_direct_xmit_bulk(xs->dev, bulk, n, xs->queue_id, &sent);
+	if (sent)
+		*sent_frame = true;
+
+	if (err == NETDEV_TX_BUSY) {
+		/* The refused skbs after the last dropped one hold the most
+		 * recent descriptors taken off the Tx ring. Put those back and
+		 * tell user-space to retry the send.
+		 */
+		for (i = n; i > sent && bulk[i - 1]; i--) {
+			xskq_cons_cancel_n(xs->tx, xsk_get_num_desc(bulk[i - 1]));
+			xsk_consume_skb(bulk[i - 1]);
+		}
+		/* The ones before it cannot be returned, complete them */
+		for (; i > sent; i--) {
+			if (!bulk[i - 1])
+				continue;
+			dev_core_stats_tx_dropped_inc(xs->dev);
+			kfree_skb(bulk[i - 1]);
+		}
+		return -EAGAIN;
+	}
+
+	/* Ignore NET_XMIT_CN as packet might have been sent */
+	if (err == NET_XMIT_DROP) {
+		/* SKB completed but not sent */
+		return -EBUSY;
+	}
+
+	return 0;
+}
+
 static int __xsk_generic_xmit(struct sock *sk)
 {
+	struct sk_buff *bulk[TX_BULK_SIZE];
 	struct xdp_sock *xs = xdp_sk(sk);
 	u32 max_batch = TX_BATCH_SIZE;
+	unsigned int nr_bulk = 0;
 	bool sent_frame = false;
 	struct xdp_desc desc;
 	struct sk_buff *skb;
@@ -802,12 +847,35 @@ static int __xsk_generic_xmit(struct sock *sk)
 	if (xs->queue_id >= xs->dev->real_num_tx_queues)
 		goto out;
 
-	while (xskq_cons_peek_desc(xs->tx, &desc, xs->pool)) {
+	for (;;) {
+		/* Taking new descriptors off the ring publishes the consumer
+		 * pointer, after which held skbs could no longer be put back.
+		 */
+		if (nr_bulk && !xskq_has_descs(xs->tx)) {
+			err = xsk_generic_xmit_bulk(xs, bulk, &nr_bulk,
+						    &sent_frame);
+			if (err)
+				goto out;
+		}
+
+		if (!xskq_cons_peek_desc(xs->tx, &desc, xs->pool))
+			break;
+
 		if (max_batch-- == 0) {
 			err = -EAGAIN;
 			goto out;
 		}
 
+		/* Multi-buffer packets release descriptors while they are
+		 * built, so start them on an empty bulk.
+		 */
+		if (nr_bulk && !xs->skb && xp_mb_desc(&desc)) {
+			err = xsk_generic_xmit_bulk(xs, bulk, &nr_bulk,
+						    &sent_frame);
+			if (err)
+				goto out;
+		}
+
 		/* This is the backpressure mechanism for the Tx path.
 		 * Reserve space in the completion queue and only proceed
 		 * if there is space in it. This avoids having to implement
@@ -832,25 +900,20 @@ static int __xsk_generic_xmit(struct sock *sk)
 			continue;
 		}
 
-		err = __dev_direct_xmit(skb, xs->queue_id);
-		if  (err == NETDEV_TX_BUSY) {
-			/* Tell user-space to retry the send */
-			xskq_cons_cancel_n(xs->tx, xsk_get_num_desc(skb));
-			xsk_consume_skb(skb);
-			err = -EAGAIN;
-			goto out;
+		xs->skb = NULL;
+		bulk[nr_bulk++] = skb;
+		if (nr_bulk == TX_BULK_SIZE) {
+			err = xsk_generic_xmit_bulk(xs, bulk, &nr_bulk,
+						    &sent_frame);
+			if (err)
+				goto out;
 		}
+	}
 
-		/* Ignore NET_XMIT_CN as packet might have been sent */
-		if (err == NET_XMIT_DROP) {
-			/* SKB completed but not sent */
-			err = -EBUSY;
-			xs->skb = NULL;
+	if (nr_bulk) {
+		err = xsk_generic_xmit_bulk(xs, bulk, &nr_bulk, &sent_frame);
+		if (err)
 			goto out;
-		}
-
-		sent_frame = true;
-		xs->skb = NULL;
 	}
 
 	if (xskq_has_descs(xs->tx)) {
@@ -860,6 +923,13 @@ static int __xsk_generic_xmit(struct sock *sk)
 	}
 
 out:
+	if (nr_bulk) {
+		int ret = xsk_generic_xmit_bulk(xs, bulk, &nr_bulk, &sent_frame);
+
+		if (!err)
+			err = ret;
+	}
+
 	if (sent_frame)
 		if (xsk_tx_writeable(xs))
 			sk->sk_write_space(sk);
@@ -1172,7 +1242,10 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 
 	flags = sxdp->sxdp_flags;
 	if (flags & ~(XDP_SHARED_UMEM | XDP_COPY | XDP_ZEROCOPY |
-		      XDP_USE_NEED_WAKEUP | XDP_USE_SG))
+		      XDP_USE_NEED_WAKEUP | XDP_USE_SG | XDP_SHARED_FILL))
+		return -EINVAL;
+
+	if ((flags & XDP_SHARED_FILL) && !(flags & XDP_SHARED_UMEM))
 		return -EINVAL;
 
 	bound_dev_if = READ_ONCE(sk->sk_bound_dev_if);
@@ -1242,7 +1315,7 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 			}
 
 			err = xp_assign_dev_shared(xs->pool, umem_xs, dev,
-						   qid);
+						   qid, flags & XDP_SHARED_FILL);
 			if (err) {
 				xp_destroy(xs->pool);
 				xs->pool = NULL;
@@ -1251,7 +1324,8 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 			}
 		} else {
 			/* Share the buffer pool with the other socket. */
-			if (xs->fq_tmp || xs->cq_tmp) {
+			if (xs->fq_tmp || xs->cq_tmp ||
+			    (flags & XDP_SHARED_FILL)) {
 				/* Do not allow setting your own fq or cq. */
 				err = -EINVAL;
 				sockfd_put(sock);
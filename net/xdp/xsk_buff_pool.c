@@ -92,6 +92,7 @@ struct xsk_buff_pool *xp_create_and_assign_umem(struct xdp_sock *xs,
 	INIT_LIST_HEAD(&pool->xsk_tx_list);
 	spin_lock_init(&pool->xsk_tx_list_lock);
 	spin_lock_init(&pool->cq_lock);
+	spin_lock_init(&pool->fq_lock);
 	refcount_set(&pool->users, 1);
 
 	pool->fq = xs->fq_tmp;
@@ -239,21 +240,72 @@ int xp_assign_dev(struct xsk_buff_pool *pool,
 	return err;
 }
 
+static int xp_share_fq(struct xsk_buff_pool *pool, struct xsk_buff_pool *umem_pool)
+{
+	struct xsk_buff_pool *fq_pool = umem_pool->fq_pool ?: umem_pool;
+
+	if (pool->fq || !fq_pool->fq)
+		return -EINVAL;
+
+	if (!fq_pool->fq_pool) {
+		/* The owner has consumed its fill ring locklessly so far. Make
+		 * sure it sees fq_pool, and thus takes fq_lock, before a second
+		 * consumer can show up.
+		 */
+		WRITE_ONCE(fq_pool->fq_pool, fq_pool);
+		synchronize_net();
+	}
+
+	xp_get_pool(fq_pool);
+	pool->fq_pool = fq_pool;
+	pool->fq = fq_pool->fq;
+	return 0;
+}
+
+static void xp_unshare_fq(struct xsk_buff_pool *pool)
+{
+	if (!pool->fq_pool || pool->fq_pool == pool)
+		return;
+
+	xp_put_pool(pool->fq_pool);
+	pool->fq_pool = NULL;
+	pool->fq = NULL;
+}
+
 int xp_assign_dev_shared(struct xsk_buff_pool *pool, struct xdp_sock *umem_xs,
-			 struct net_device *dev, u16 queue_id)
+			 struct net_device *dev, u16 queue_id, bool share_fq)
 {
 	u16 flags;
 	struct xdp_umem *umem = umem_xs->umem;
+	int err;
 
-	/* One fill and completion ring required for each queue id. */
-	if (!pool->fq || !pool->cq)
-		return -EINVAL;
+	if (share_fq) {
+		err = xp_share_fq(pool, umem_xs->pool);
+		if (err)
+			return err;
+	}
+
+	/* One fill and completion ring required for each queue id, unless
+	 * the fill ring is shared.
+	 */
+	if (!pool->fq || !pool->cq) {
+		err = -EINVAL;
+		goto err_unshare;
+	}
 
 	flags = umem->zc ? XDP_ZEROCOPY : XDP_COPY;
 	if (umem_xs->pool->uses_need_wakeup)
 		flags |= XDP_USE_NEED_WAKEUP;
 
-	return xp_assign_dev(pool, dev, queue_id, flags);
+	err = xp_assign_dev(pool, dev, queue_id, flags);
+	if (err)
+		goto err_unshare;
+
+	return 0;
+
+err_unshare:
+	xp_unshare_fq(pool);
+	return err;
 }
 
 void xp_clear_dev(struct xsk_buff_pool *pool)
@@ -276,6 +328,9 @@ static void xp_release_deferred(struct work_struct *work)
 	xp_clear_dev(pool);
 	rtnl_unlock();
 
+	/* A borrowed fill ring stays with the pool that owns it. */
+	xp_unshare_fq(pool);
+
 	if (pool->fq) {
 		xskq_destroy(pool->fq);
 		pool->fq = NULL;
@@ -539,7 +594,9 @@ struct xdp_buff *xp_alloc(struct xsk_buff_pool *pool)
 	struct xdp_buff_xsk *xskb;
 
 	if (!pool->free_list_cnt) {
+		xp_fq_lock(pool);
 		xskb = __xp_alloc(pool);
+		xp_fq_unlock(pool);
 		if (!xskb)
 			return NULL;
 	} else {
@@ -646,9 +703,11 @@ u32 xp_alloc_batch(struct xsk_buff_pool *pool, struct xdp_buff **xdp, u32 max)
 		xdp += nb_entries1;
 	}
 
+	xp_fq_lock(pool);
 	nb_entries2 = xp_alloc_new_from_fq(pool, xdp, max);
 	if (!nb_entries2)
 		pool->fq->queue_empty_descs++;
+	xp_fq_unlock(pool);
 
 	return nb_entries1 + nb_entries2;
 }
@@ -656,9 +715,15 @@ EXPORT_SYMBOL(xp_alloc_batch);
 
 bool xp_can_alloc(struct xsk_buff_pool *pool, u32 count)
 {
+	bool ret;
+
 	if (pool->free_list_cnt >= count)
 		return true;
-	return xskq_cons_has_entries(pool->fq, count - pool->free_list_cnt);
+
+	xp_fq_lock(pool);
+	ret = xskq_cons_has_entries(pool->fq, count - pool->free_list_cnt);
+	xp_fq_unlock(pool);
+	return ret;
 }
 EXPORT_SYMBOL(xp_can_alloc);
 
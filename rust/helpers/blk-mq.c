@@ -29,3 +29,23 @@ void rust_helper_bio_advance_iter_single(const struct bio *bio,
 	bio_advance_iter_single(bio, iter, bytes);
 }
 EXPORT_SYMBOL_GPL(rust_helper_bio_advance_iter_single);
+
+bool rust_helper_blk_mq_add_to_batch(struct request *req,
+				     struct io_comp_batch *iob, int ioerror,
+				     void (*complete)(struct io_comp_batch *))
+{
+	return blk_mq_add_to_batch(req, iob, ioerror, complete);
+}
+EXPORT_SYMBOL_GPL(rust_helper_blk_mq_add_to_batch);
+
+struct request *rust_helper_rq_list_pop(struct request **list)
+{
+	return rq_list_pop(list);
+}
+EXPORT_SYMBOL_GPL(rust_helper_rq_list_pop);
+
+void rust_helper_rq_list_add(struct request **list, struct request *rq)
+{
+	rq_list_add(list, rq);
+}
+EXPORT_SYMBOL_GPL(rust_helper_rq_list_add);
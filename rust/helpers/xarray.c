@@ -36,3 +36,9 @@ int rust_helper_xa_err(void *entry)
 	return xa_err(entry);
 }
 EXPORT_SYMBOL_GPL(rust_helper_xa_err);
+
+bool rust_helper_xa_is_zero(const void *entry)
+{
+	return xa_is_zero(entry);
+}
+EXPORT_SYMBOL_GPL(rust_helper_xa_is_zero);
@@ -7,6 +7,7 @@
 
 #define SLAB_PANIC 2
 #define SLAB_RECLAIM_ACCOUNT    0x00020000UL            /* Objects are reclaimable */
+#define SLAB_SHEAVES 0
 
 #define kzalloc_node(size, flags, node) kmalloc(size, flags)
 
@@ -37,6 +37,12 @@ int bench_futex_requeue(int argc, const char **argv);
 int bench_futex_lock_pi(int argc, const char **argv);
 int bench_epoll_wait(int argc, const char **argv);
 int bench_epoll_ctl(int argc, const char **argv);
+int bench_io_uring(int argc, const char **argv);
+int bench_mm_pages(int argc, const char **argv);
+int bench_mm_pages_bulk(int argc, const char **argv);
+int bench_mm_slab(int argc, const char **argv);
+int bench_mm_slab_remote(int argc, const char **argv);
+int bench_mm_vmalloc(int argc, const char **argv);
 int bench_synthesize(int argc, const char **argv);
 int bench_kallsyms_parse(int argc, const char **argv);
 int bench_inject_build_id(int argc, const char **argv);
@@ -0,0 +1,561 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * io-uring.c
+ *
+ * uring: Benchmark for block device I/O through io_uring
+ *
+ * Keeps a fixed number of O_DIRECT reads or writes in flight against a
+ * block device (null_blk, rnull, brd, zram, ...) or file, and reports
+ * IOPS, completion latency percentiles and CPU cycles spent per I/O by
+ * the submitting task.
+ */
+#include <subcmd/parse-options.h>
+#include <linux/compiler.h>
+#include <linux/perf_event.h>
+#include <linux/time64.h>
+#include <linux/types.h>
+#include <linux/fs.h>
+#include <linux/io_uring.h>
+#include "bench.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#include <err.h>
+
+/* Log-linear latency histogram: 8 buckets per power of two of nsecs */
+#define LAT_SUB_BITS	3
+#define LAT_SUB		(1U << LAT_SUB_BITS)
+#define LAT_BUCKETS	(64 * LAT_SUB)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define read_barrier()	__asm__ __volatile__("":::"memory")
+#define write_barrier()	__asm__ __volatile__("":::"memory")
+#else
+#define read_barrier()	__sync_synchronize()
+#define write_barrier()	__sync_synchronize()
+#endif
+
+struct io_ring {
+	int			fd;
+	/* SQ ring */
+	unsigned int		*sq_head;
+	unsigned int		*sq_tail;
+	unsigned int		*sq_flags;
+	unsigned int		*sq_array;
+	unsigned int		sq_mask;
+	unsigned int		sq_pending;
+	struct io_uring_sqe	*sqes;
+	/* CQ ring */
+	unsigned int		*cq_head;
+	unsigned int		*cq_tail;
+	unsigned int		cq_mask;
+	struct io_uring_cqe	*cqes;
+	/* mappings */
+	void			*sq_ptr;
+	size_t			sq_len;
+	void			*cq_ptr;
+	size_t			cq_len;
+	size_t			sqes_len;
+};
+
+struct io_slot {
+	void			*buf;
+	u64			issued;
+};
+
+static const char		*filename = "/dev/nullb0";
+static unsigned int		block_size = 4096;
+static unsigned int		depth = 32;
+static unsigned int		runtime = 10;
+static bool			iopoll;
+static bool			sqpoll;
+static bool			fixed_buffers;
+static bool			fixed_files;
+static bool			random_io;
+static bool			write_io;
+
+static volatile bool		done;
+static u64			lat_hist[LAT_BUCKETS];
+
+static const struct option options[] = {
+	OPT_STRING('f', "filename", &filename, "PATH",
+		   "Block device or file to do I/O to (default: /dev/nullb0)"),
+	OPT_UINTEGER('b', "block-size", &block_size, "Specify I/O size in bytes"),
+	OPT_UINTEGER('d', "depth", &depth, "Specify number of I/Os in flight"),
+	OPT_UINTEGER('r', "runtime", &runtime, "Specify runtime (in seconds)"),
+	OPT_BOOLEAN('p', "iopoll", &iopoll, "Use a polled ring (IORING_SETUP_IOPOLL)"),
+	OPT_BOOLEAN('s', "sqpoll", &sqpoll, "Use a submission thread (IORING_SETUP_SQPOLL)"),
+	OPT_BOOLEAN('B', "fixed-buffers", &fixed_buffers, "Use registered buffers"),
+	OPT_BOOLEAN('F', "fixed-files", &fixed_files, "Use a registered file"),
+	OPT_BOOLEAN('R', "random", &random_io, "Use random instead of sequential offsets"),
+	OPT_BOOLEAN('w', "write", &write_io, "Write instead of read"),
+	OPT_END()
+};
+
+static const char * const bench_io_uring_usage[] = {
+	"perf bench io uring <options>",
+	NULL
+};
+
+static void toggle_done(int sig __maybe_unused,
+			siginfo_t *info __maybe_unused,
+			void *uc __maybe_unused)
+{
+	done = true;
+}
+
+static u64 now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static unsigned int lat_bucket(u64 ns)
+{
+	unsigned int msb;
+
+	if (ns < LAT_SUB)
+		return ns;
+
+	msb = 63 - __builtin_clzll(ns);
+	return (msb - LAT_SUB_BITS + 1) * LAT_SUB +
+	       ((ns >> (msb - LAT_SUB_BITS)) & (LAT_SUB - 1));
+}
+
+/* Lower bound of the latencies accounted to bucket @idx */
+static u64 lat_bucket_val(unsigned int idx)
+{
+	if (idx < LAT_SUB)
+		return idx;
+
+	return (u64)(LAT_SUB + idx % LAT_SUB) << (idx / LAT_SUB - 1);
+}
+
+static u64 lat_percentile(u64 nr, double pct)
+{
+	u64 target = nr * pct / 100.0, seen = 0;
+	unsigned int i;
+
+	for (i = 0; i < LAT_BUCKETS; i++) {
+		seen += lat_hist[i];
+		if (seen > target)
+			return lat_bucket_val(i);
+	}
+	return 0;
+}
+
+static int get_size(int fd, u64 *size)
+{
+	struct stat st;
+
+	if (fstat(fd, &st) < 0)
+		return -errno;
+
+	if (S_ISBLK(st.st_mode)) {
+		if (ioctl(fd, BLKGETSIZE64, size) < 0)
+			return -errno;
+	} else {
+		*size = st.st_size;
+	}
+	return 0;
+}
+
+/* Cycles spent by this task, user and kernel; -1 if unavailable */
+static int cycles_open(void)
+{
+	struct perf_event_attr attr = { .size = 0, };
+
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CPU_CYCLES;
+	attr.disabled = 1;
+	attr.exclude_hv = 1;
+
+	return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static u64 next_offset(u64 *pos, u64 nr_blocks, u64 *seed)
+{
+	u64 blk;
+
+	if (random_io) {
+		/* xorshift64 */
+		*seed ^= *seed << 13;
+		*seed ^= *seed >> 7;
+		*seed ^= *seed << 17;
+		blk = *seed % nr_blocks;
+	} else {
+		blk = (*pos)++;
+		if (*pos == nr_blocks)
+			*pos = 0;
+	}
+	return blk * block_size;
+}
+
+static int ring_setup(struct io_ring *ring, unsigned int entries,
+		      unsigned int flags)
+{
+	struct io_uring_params p;
+	int ret;
+
+	memset(ring, 0, sizeof(*ring));
+	memset(&p, 0, sizeof(p));
+	p.flags = flags;
+
+	ring->fd = syscall(__NR_io_uring_setup, entries, &p);
+	if (ring->fd < 0)
+		return -errno;
+
+	ring->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE,
+			    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (ring->sq_ptr == MAP_FAILED)
+		goto err;
+
+	ring->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE,
+			    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+	if (ring->cq_ptr == MAP_FAILED)
+		goto err_sq;
+
+	ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+			  MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED)
+		goto err_cq;
+
+	ring->sq_head = ring->sq_ptr + p.sq_off.head;
+	ring->sq_tail = ring->sq_ptr + p.sq_off.tail;
+	ring->sq_flags = ring->sq_ptr + p.sq_off.flags;
+	ring->sq_array = ring->sq_ptr + p.sq_off.array;
+	ring->sq_mask = *(unsigned int *)(ring->sq_ptr + p.sq_off.ring_mask);
+
+	ring->cq_head = ring->cq_ptr + p.cq_off.head;
+	ring->cq_tail = ring->cq_ptr + p.cq_off.tail;
+	ring->cq_mask = *(unsigned int *)(ring->cq_ptr + p.cq_off.ring_mask);
+	ring->cqes = ring->cq_ptr + p.cq_off.cqes;
+	return 0;
+
+err_cq:
+	ret = -errno;
+	munmap(ring->cq_ptr, ring->cq_len);
+	goto err_close;
+err_sq:
+	ret = -errno;
+	goto err_close;
+err:
+	ret = -errno;
+	close(ring->fd);
+	return ret;
+err_close:
+	munmap(ring->sq_ptr, ring->sq_len);
+	close(ring->fd);
+	return ret;
+}
+
+static void ring_exit(struct io_ring *ring)
+{
+	munmap(ring->sqes, ring->sqes_len);
+	munmap(ring->cq_ptr, ring->cq_len);
+	munmap(ring->sq_ptr, ring->sq_len);
+	close(ring->fd);
+}
+
+static int ring_register(struct io_ring *ring, unsigned int opcode,
+			 void *arg, unsigned int nr_args)
+{
+	int ret;
+
+	ret = syscall(__NR_io_uring_register, ring->fd, opcode, arg, nr_args);
+	return (ret < 0) ? -errno : ret;
+}
+
+static void prep_io(struct io_ring *ring, int fd, struct io_slot *slots,
+		    unsigned int idx, u64 off)
+{
+	unsigned int tail = *ring->sq_tail + ring->sq_pending++;
+	struct io_uring_sqe *sqe = &ring->sqes[tail & ring->sq_mask];
+
+	memset(sqe, 0, sizeof(*sqe));
+	if (fixed_buffers) {
+		sqe->opcode = write_io ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+		sqe->buf_index = idx;
+	} else {
+		sqe->opcode = write_io ? IORING_OP_WRITE : IORING_OP_READ;
+	}
+	if (fixed_files) {
+		sqe->fd = 0;
+		sqe->flags = IOSQE_FIXED_FILE;
+	} else {
+		sqe->fd = fd;
+	}
+	sqe->addr = (unsigned long)slots[idx].buf;
+	sqe->len = block_size;
+	sqe->off = off;
+	sqe->user_data = idx;
+	ring->sq_array[tail & ring->sq_mask] = tail & ring->sq_mask;
+
+	slots[idx].issued = now_ns();
+}
+
+/*
+ * Publish the prepared SQEs and, unless completions are already waiting,
+ * wait for at least one. With SQPOLL the kernel thread picks the SQEs up
+ * on its own and only needs a nudge once it went idle.
+ */
+static int submit_and_wait(struct io_ring *ring)
+{
+	unsigned int to_submit = ring->sq_pending;
+	unsigned int flags = 0, min_complete = 0;
+	int ret;
+
+	if (to_submit) {
+		write_barrier();
+		*ring->sq_tail += to_submit;
+		ring->sq_pending = 0;
+		write_barrier();
+	}
+
+	read_barrier();
+	if (*ring->cq_head == *ring->cq_tail) {
+		flags |= IORING_ENTER_GETEVENTS;
+		min_complete = 1;
+	}
+
+	if (sqpoll) {
+		to_submit = 0;
+		if (*ring->sq_flags & IORING_SQ_NEED_WAKEUP)
+			flags |= IORING_ENTER_SQ_WAKEUP;
+	}
+	if (!to_submit && !flags)
+		return 0;
+
+	ret = syscall(__NR_io_uring_enter, ring->fd, to_submit, min_complete,
+		      flags, NULL, 0);
+	if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+		return -errno;
+	return 0;
+}
+
+static const char *mode_str(void)
+{
+	if (iopoll && sqpoll)
+		return "iopoll+sqpoll";
+	if (iopoll)
+		return "iopoll";
+	if (sqpoll)
+		return "sqpoll";
+	return "irq";
+}
+
+int bench_io_uring(int argc, const char **argv)
+{
+	struct io_ring ring;
+	struct io_slot *slots;
+	struct iovec *iovecs = NULL;
+	struct sigaction act;
+	u64 size, nr_blocks, pos = 0, seed = 0x9e3779b97f4a7c15ULL;
+	u64 start, end, deadline, nr_ios = 0, lat_sum = 0, cycles = 0;
+	unsigned int i, setup_flags = 0;
+	int fd, cycles_fd, ret;
+	double secs;
+
+	argc = parse_options(argc, argv, options, bench_io_uring_usage, 0);
+	if (argc) {
+		usage_with_options(bench_io_uring_usage, options);
+		exit(EXIT_FAILURE);
+	}
+
+	if (!depth || !block_size || block_size % 512) {
+		fprintf(stderr, "depth must be non-zero and block size a multiple of 512\n");
+		return -1;
+	}
+
+	memset(&act, 0, sizeof(act));
+	sigfillset(&act.sa_mask);
+	act.sa_sigaction = toggle_done;
+	sigaction(SIGINT, &act, NULL);
+
+	fd = open(filename, (write_io ? O_WRONLY : O_RDONLY) | O_DIRECT);
+	if (fd < 0)
+		err(EXIT_FAILURE, "open %s", filename);
+
+	ret = get_size(fd, &size);
+	if (ret < 0) {
+		errno = -ret;
+		err(EXIT_FAILURE, "size of %s", filename);
+	}
+	nr_blocks = size / block_size;
+	if (!nr_blocks) {
+		fprintf(stderr, "%s is smaller than one block\n", filename);
+		return -1;
+	}
+
+	if (iopoll)
+		setup_flags |= IORING_SETUP_IOPOLL;
+	if (sqpoll)
+		setup_flags |= IORING_SETUP_SQPOLL;
+
+	ret = ring_setup(&ring, depth, setup_flags);
+	if (ret < 0) {
+		errno = -ret;
+		err(EXIT_FAILURE, "io_uring_setup");
+	}
+
+	slots = calloc(depth, sizeof(*slots));
+	if (fixed_buffers)
+		iovecs = calloc(depth, sizeof(*iovecs));
+	if (!slots || (fixed_buffers && !iovecs))
+		err(EXIT_FAILURE, "calloc");
+
+	for (i = 0; i < depth; i++) {
+		if (posix_memalign(&slots[i].buf, 4096, block_size))
+			err(EXIT_FAILURE, "posix_memalign");
+		memset(slots[i].buf, 0xaa, block_size);
+		if (iovecs) {
+			iovecs[i].iov_base = slots[i].buf;
+			iovecs[i].iov_len = block_size;
+		}
+	}
+
+	if (fixed_buffers) {
+		ret = ring_register(&ring, IORING_REGISTER_BUFFERS, iovecs, depth);
+		if (ret < 0) {
+			errno = -ret;
+			err(EXIT_FAILURE, "IORING_REGISTER_BUFFERS");
+		}
+	}
+	if (fixed_files) {
+		ret = ring_register(&ring, IORING_REGISTER_FILES, &fd, 1);
+		if (ret < 0) {
+			errno = -ret;
+			err(EXIT_FAILURE, "IORING_REGISTER_FILES");
+		}
+	}
+
+	cycles_fd = cycles_open();
+
+	printf("# %s %s of %u bytes to %s, depth %u, %s%s%s for %u secs\n\n",
+	       random_io ? "Random" : "Sequential", write_io ? "writes" : "reads",
+	       block_size, filename, depth, mode_str(),
+	       fixed_buffers ? ", fixed buffers" : "",
+	       fixed_files ? ", fixed files" : "", runtime);
+
+	if (cycles_fd >= 0)
+		ioctl(cycles_fd, PERF_EVENT_IOC_ENABLE, 0);
+
+	start = now_ns();
+	deadline = start + (u64)runtime * NSEC_PER_SEC;
+
+	for (i = 0; i < depth; i++)
+		prep_io(&ring, fd, slots, i, next_offset(&pos, nr_blocks, &seed));
+
+	while (!done) {
+		unsigned int head;
+		u64 now;
+
+		ret = submit_and_wait(&ring);
+		if (ret < 0) {
+			errno = -ret;
+			err(EXIT_FAILURE, "io_uring_enter");
+		}
+
+		read_barrier();
+		head = *ring.cq_head;
+		if (head == *ring.cq_tail)
+			continue;
+
+		now = now_ns();
+		do {
+			struct io_uring_cqe *cqe = &ring.cqes[head & ring.cq_mask];
+			unsigned int idx = cqe->user_data;
+			u64 lat = now - slots[idx].issued;
+
+			if (cqe->res != (int)block_size) {
+				errno = cqe->res < 0 ? -cqe->res : EIO;
+				err(EXIT_FAILURE, "I/O error");
+			}
+
+			lat_hist[lat_bucket(lat)]++;
+			lat_sum += lat;
+			nr_ios++;
+
+			if (now < deadline)
+				prep_io(&ring, fd, slots, idx,
+					next_offset(&pos, nr_blocks, &seed));
+			head++;
+		} while (head != *ring.cq_tail);
+
+		*ring.cq_head = head;
+		write_barrier();
+
+		if (now >= deadline)
+			done = true;
+	}
+
+	end = now_ns();
+	if (cycles_fd >= 0) {
+		ioctl(cycles_fd, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(cycles_fd, &cycles, sizeof(cycles)) != sizeof(cycles))
+			cycles = 0;
+		close(cycles_fd);
+	}
+
+	ring_exit(&ring);
+	close(fd);
+	for (i = 0; i < depth; i++)
+		free(slots[i].buf);
+	free(slots);
+	free(iovecs);
+
+	secs = (double)(end - start) / NSEC_PER_SEC;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf(" %14s: %.3f [sec]\n", "Total time", secs);
+		printf(" %14s: %llu\n\n", "Total I/Os", (unsigned long long)nr_ios);
+		printf(" %14.0f IOPS\n", nr_ios / secs);
+		printf(" %14.1f MiB/sec\n",
+		       (double)nr_ios * block_size / secs / (1024 * 1024));
+		printf(" %14.3f usecs/op (avg latency)\n",
+		       nr_ios ? (double)lat_sum / nr_ios / NSEC_PER_USEC : 0.0);
+		printf(" %14.3f usecs p50\n",
+		       (double)lat_percentile(nr_ios, 50.0) / NSEC_PER_USEC);
+		printf(" %14.3f usecs p99\n",
+		       (double)lat_percentile(nr_ios, 99.0) / NSEC_PER_USEC);
+		printf(" %14.3f usecs p99.9\n",
+		       (double)lat_percentile(nr_ios, 99.9) / NSEC_PER_USEC);
+		if (cycles && nr_ios)
+			printf(" %14.0f cycles/op%s\n", (double)cycles / nr_ios,
+			       sqpoll ? " (submitter only)" : "");
+		else
+			printf(" %14s cycles/op\n", "<not counted>");
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%.0f\n", nr_ios / secs);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+	}
+
+	return 0;
+}
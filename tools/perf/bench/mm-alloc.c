@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * mm-alloc.c
+ *
+ * Page, slab and vmalloc allocator throughput, measured in the kernel by
+ * the test_mm_bench module (CONFIG_TEST_MM_BENCH) and driven through its
+ * debugfs interface.
+ */
+#include <subcmd/parse-options.h>
+#include <api/fs/fs.h>
+#include <linux/kernel.h>
+#include <linux/time64.h>
+#include "bench.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static unsigned int	nr_threads = 1;
+static unsigned int	nr_ops = 100000;
+static unsigned int	order;
+static unsigned int	obj_size = 4096;
+static bool		scale;
+
+static const struct option options[] = {
+	OPT_UINTEGER('t', "threads", &nr_threads, "Specify number of CPUs to allocate on (0: all)"),
+	OPT_UINTEGER('n', "ops", &nr_ops, "Specify number of allocations per CPU"),
+	OPT_UINTEGER('o', "order", &order, "Specify page order (pages)"),
+	OPT_UINTEGER('s', "size", &obj_size, "Specify object size in bytes (slab, vmalloc)"),
+	OPT_BOOLEAN('S', "scale", &scale, "Run on 1, 2, 4, ... up to --threads CPUs"),
+	OPT_END()
+};
+
+static const char * const bench_mm_usage[] = {
+	"perf bench mm <pages|pages-bulk|slab|slab-remote|vmalloc> <options>",
+	NULL
+};
+
+static int mm_bench_open(void)
+{
+	const char *debugfs = debugfs__mountpoint();
+	char path[PATH_MAX];
+	int fd;
+
+	if (!debugfs) {
+		fprintf(stderr, "debugfs is not mounted\n");
+		return -1;
+	}
+
+	snprintf(path, sizeof(path), "%s/mm_bench/run", debugfs);
+	fd = open(path, O_RDWR);
+	if (fd < 0) {
+		if (errno == ENOENT)
+			fprintf(stderr, "%s not found, is the test_mm_bench module loaded?\n",
+				path);
+		else
+			perror(path);
+	}
+	return fd;
+}
+
+static int mm_bench_one(int fd, const char *test, unsigned int threads,
+			unsigned long long *ops, unsigned long long *nsecs)
+{
+	char buf[128];
+	ssize_t len;
+
+	len = snprintf(buf, sizeof(buf), "%s %u %u %u %u", test, threads,
+		       nr_ops, order, obj_size);
+	if (pwrite(fd, buf, len, 0) != len) {
+		fprintf(stderr, "%s on %u CPUs failed: %s\n", test, threads,
+			strerror(errno));
+		return -1;
+	}
+
+	len = pread(fd, buf, sizeof(buf) - 1, 0);
+	if (len <= 0)
+		return -1;
+	buf[len] = '\0';
+
+	if (sscanf(buf, "%llu %llu", ops, nsecs) != 2 || !*nsecs)
+		return -1;
+	return 0;
+}
+
+static void print_result(const char *test, unsigned int threads,
+			 unsigned long long ops, unsigned long long nsecs)
+{
+	double secs = (double)nsecs / NSEC_PER_SEC;
+	unsigned long long pages = 0;
+
+	if (!strcmp(test, "pages"))
+		pages = ops << order;
+	else if (!strcmp(test, "pages_bulk"))
+		pages = ops;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf(" %4u CPUs: %14.0f ops/sec %10.1f nsecs/op", threads,
+		       ops / secs, (double)nsecs * threads / ops);
+		if (pages)
+			printf(" %14.0f pages/sec", pages / secs);
+		printf("\n");
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%u %.0f\n", threads, ops / secs);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+	}
+}
+
+static int bench_mm(int argc, const char **argv, const char *test)
+{
+	unsigned long long ops, nsecs;
+	unsigned int threads;
+	int fd, ret = 0;
+
+	argc = parse_options(argc, argv, options, bench_mm_usage, 0);
+	if (argc) {
+		usage_with_options(bench_mm_usage, options);
+		exit(EXIT_FAILURE);
+	}
+
+	if (!nr_threads)
+		nr_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	fd = mm_bench_open();
+	if (fd < 0)
+		return -1;
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %s: %u allocations per CPU, order %u, size %u\n\n",
+		       test, nr_ops, order, obj_size);
+
+	threads = scale ? 1 : nr_threads;
+	for (;;) {
+		ret = mm_bench_one(fd, test, threads, &ops, &nsecs);
+		if (ret)
+			break;
+		print_result(test, threads, ops, nsecs);
+
+		if (threads == nr_threads)
+			break;
+		/* Always finish with the requested number of CPUs */
+		threads = min(threads * 2, nr_threads);
+	}
+
+	close(fd);
+	return ret;
+}
+
+int bench_mm_pages(int argc, const char **argv)
+{
+	return bench_mm(argc, argv, "pages");
+}
+
+int bench_mm_pages_bulk(int argc, const char **argv)
+{
+	return bench_mm(argc, argv, "pages_bulk");
+}
+
+int bench_mm_slab(int argc, const char **argv)
+{
+	return bench_mm(argc, argv, "slab");
+}
+
+int bench_mm_slab_remote(int argc, const char **argv)
+{
+	return bench_mm(argc, argv, "slab_remote");
+}
+
+int bench_mm_vmalloc(int argc, const char **argv)
+{
+	return bench_mm(argc, argv, "vmalloc");
+}
@@ -16,6 +16,8 @@
  *  numa  ... NUMA scheduling and MM performance
  *  futex ... Futex performance
  *  epoll ... Event poll performance
+ *  io    ... Block device I/O performance
+ *  mm    ... Kernel memory allocator performance
  */
 #include <subcmd/parse-options.h>
 #include "builtin.h"
@@ -89,6 +91,22 @@ static struct bench epoll_benchmarks[] = {
 };
 #endif // HAVE_EVENTFD_SUPPORT
 
+static struct bench io_benchmarks[] = {
+	{ "uring",	"Benchmark block device I/O through io_uring",	bench_io_uring		},
+	{ "all",	"Run all I/O benchmarks",			NULL			},
+	{ NULL,		NULL,						NULL			}
+};
+
+static struct bench mm_benchmarks[] = {
+	{ "pages",	"Benchmark alloc_pages() and __free_pages()",	bench_mm_pages		},
+	{ "pages-bulk",	"Benchmark alloc_pages_bulk_array()",		bench_mm_pages_bulk	},
+	{ "slab",	"Benchmark kmalloc() and kfree() on one CPU",	bench_mm_slab		},
+	{ "slab-remote", "Benchmark kmalloc() with kfree() on another CPU", bench_mm_slab_remote },
+	{ "vmalloc",	"Benchmark vmalloc() and vfree()",		bench_mm_vmalloc	},
+	{ "all",	"Run all kernel memory allocator benchmarks",	NULL			},
+	{ NULL,		NULL,						NULL			}
+};
+
 static struct bench internals_benchmarks[] = {
 	{ "synthesize", "Benchmark perf event synthesis",	bench_synthesize	},
 	{ "kallsyms-parse", "Benchmark kallsyms parsing",	bench_kallsyms_parse	},
@@ -131,6 +149,8 @@ static struct collection collections[] = {
 #ifdef HAVE_EVENTFD_SUPPORT
 	{"epoll",       "Epoll stressing benchmarks",                   epoll_benchmarks        },
 #endif
+	{ "io",		"Block device I/O benchmarks",			io_benchmarks		},
+	{ "mm",		"Kernel memory allocator benchmarks",		mm_benchmarks		},
 	{ "internals",	"Perf-internals benchmarks",			internals_benchmarks	},
 	{ "breakpoint",	"Breakpoint benchmarks",			breakpoint_benchmarks	},
 	{ "uprobe",	"uprobe benchmarks",				uprobe_benchmarks	},
@@ -0,0 +1,193 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Measure fork() latency of a process with a large populated anonymous
+ * mapping, once with small pages and once for every supported THP size.
+ *
+ * With PTE-mapped large folios copy_page_range() copies the PTEs and
+ * duplicates the rmap and references of a whole folio at once, so fork
+ * latency should drop with growing folio size.
+ *
+ * Usage: fork_latency [-s size_mib] [-n iterations]
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "../kselftest.h"
+#include "vm_util.h"
+#include "thp_settings.h"
+
+static size_t pagesize;
+static size_t pmdsize;
+static int nr_thpsizes;
+static size_t thpsizes[20];
+static size_t size = 512UL << 20;
+static int iterations = 10;
+
+static int sz2ord(size_t size)
+{
+	return __builtin_ctzll(size / pagesize);
+}
+
+static int detect_thp_sizes(size_t sizes[], int max)
+{
+	int count = 0;
+	unsigned long orders;
+	int i;
+
+	/* thp not supported at all. */
+	if (!pmdsize)
+		return 0;
+
+	orders = 1UL << sz2ord(pmdsize);
+	orders |= thp_supported_orders();
+
+	for (i = 0; orders && count < max; i++) {
+		if (!(orders & (1UL << i)))
+			continue;
+		orders &= ~(1UL << i);
+		sizes[count++] = pagesize << i;
+	}
+
+	return count;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void measure(const char *desc, size_t thpsize)
+{
+	uint64_t start, delta, min = UINT64_MAX, total = 0;
+	size_t mmap_size;
+	char *mmap_mem, *mem;
+	int i, status;
+	pid_t pid;
+
+	/* Align the area so that it can be fully backed by THPs. */
+	mmap_size = size + (thpsize ? thpsize : pagesize);
+	mmap_mem = mmap(NULL, mmap_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mmap_mem == MAP_FAILED) {
+		ksft_test_result_fail("%s: mmap() failed\n", desc);
+		return;
+	}
+	mem = mmap_mem;
+	if (thpsize) {
+		mem = (char *)(((uintptr_t)mmap_mem + thpsize) &
+			       ~(thpsize - 1));
+		if (madvise(mem, size, MADV_HUGEPAGE)) {
+			ksft_test_result_fail("%s: MADV_HUGEPAGE failed\n",
+					      desc);
+			goto munmap;
+		}
+	} else if (pmdsize) {
+		madvise(mem, size, MADV_NOHUGEPAGE);
+	}
+
+	/* Populate with distinct content, so nothing can be shared. */
+	for (i = 0; i < size / pagesize; i++)
+		memset(mem + (size_t)i * pagesize, i + 1, 1);
+
+	for (i = 0; i < iterations; i++) {
+		start = now_ns();
+		pid = fork();
+		if (pid < 0) {
+			ksft_test_result_fail("%s: fork() failed\n", desc);
+			goto munmap;
+		} else if (!pid) {
+			_exit(0);
+		}
+		delta = now_ns() - start;
+		if (waitpid(pid, &status, 0) < 0) {
+			ksft_test_result_fail("%s: waitpid() failed\n", desc);
+			goto munmap;
+		}
+
+		total += delta;
+		if (delta < min)
+			min = delta;
+	}
+
+	ksft_print_msg("[INFO] %s: fork of %zu MiB: avg %llu us, min %llu us\n",
+		       desc, size >> 20,
+		       (unsigned long long)(total / iterations / 1000),
+		       (unsigned long long)(min / 1000));
+	ksft_test_result_pass("%s\n", desc);
+munmap:
+	munmap(mmap_mem, mmap_size);
+}
+
+static void run_with_thp(size_t thpsize)
+{
+	struct thp_settings settings = *thp_current_settings();
+	char desc[64];
+	int i;
+
+	for (i = 0; i < NR_ORDERS; i++)
+		settings.hugepages[i].enabled = THP_NEVER;
+	settings.hugepages[sz2ord(thpsize)].enabled = THP_ALWAYS;
+	thp_push_settings(&settings);
+
+	snprintf(desc, sizeof(desc), "%zu KiB THP", thpsize >> 10);
+	measure(desc, thpsize);
+
+	thp_pop_settings();
+}
+
+int main(int argc, char **argv)
+{
+	struct thp_settings default_settings;
+	int i, opt;
+
+	while ((opt = getopt(argc, argv, "s:n:")) != -1) {
+		switch (opt) {
+		case 's':
+			size = strtoul(optarg, NULL, 0) << 20;
+			break;
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		default:
+			ksft_exit_fail_msg("usage: %s [-s size_mib] [-n iterations]\n",
+					   argv[0]);
+		}
+	}
+	if (!size || iterations <= 0)
+		ksft_exit_fail_msg("invalid size or iteration count\n");
+
+	ksft_print_header();
+
+	pagesize = getpagesize();
+	pmdsize = read_pmd_pagesize();
+	if (pmdsize) {
+		/* Only if THP is supported. */
+		thp_read_settings(&default_settings);
+		thp_save_settings();
+		thp_push_settings(&default_settings);
+		nr_thpsizes = detect_thp_sizes(thpsizes, ARRAY_SIZE(thpsizes));
+	}
+
+	ksft_set_plan(1 + nr_thpsizes);
+
+	measure("small pages", 0);
+	for (i = 0; i < nr_thpsizes; i++)
+		run_with_thp(thpsizes[i]);
+
+	if (pmdsize)
+		thp_restore_settings();
+
+	i = ksft_get_fail_cnt();
+	if (i)
+		ksft_exit_fail_msg("%d out of %d tests failed\n",
+				   i, ksft_test_num());
+	ksft_exit_pass();
+}
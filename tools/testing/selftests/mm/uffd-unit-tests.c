@@ -1259,6 +1259,46 @@ struct uffd_test_case_ops uffd_move_test_pmd_case_ops = {
 	.post_alloc = request_hugepages,
 };
 
+/*
+ * Resolve several missing ranges with one UFFDIO_COPY_VEC, in descending
+ * address order, and check the contents.
+ */
+static void uffd_copy_vec_test(uffd_test_args_t *args)
+{
+	struct uffdio_iovec iov[4];
+	struct uffdio_vec uffdio_vec = { 0 };
+	unsigned long i, off, nr = ARRAY_SIZE(iov);
+
+	if (nr > nr_pages)
+		nr = nr_pages;
+
+	if (uffd_register(uffd, area_dst, nr * page_size, true, false, false))
+		err("register failure");
+
+	for (i = 0; i < nr; i++) {
+		off = (nr - 1 - i) * page_size;
+		iov[i].dst = (unsigned long)area_dst + off;
+		iov[i].src = (unsigned long)area_src + off;
+		iov[i].len = page_size;
+	}
+
+	uffdio_vec.iov = (unsigned long)iov;
+	uffdio_vec.nr = nr;
+	if (ioctl(uffd, UFFDIO_COPY_VEC, &uffdio_vec))
+		err("UFFDIO_COPY_VEC error: %"PRId64, (int64_t)uffdio_vec.done);
+	if (uffdio_vec.done != nr * page_size)
+		err("UFFDIO_COPY_VEC unexpected size: %"PRId64,
+		    (int64_t)uffdio_vec.done);
+
+	if (memcmp(area_dst, area_src, nr * page_size))
+		err("UFFDIO_COPY_VEC data mismatch");
+
+	if (uffd_unregister(uffd, area_dst, nr * page_size))
+		err("unregister");
+
+	uffd_test_pass();
+}
+
 /*
  * Test the returned uffdio_register.ioctls with different register modes.
  * Note that _UFFDIO_ZEROPAGE is tested separately in the zeropage test.
@@ -1336,6 +1376,13 @@ uffd_test_case_t uffd_tests[] = {
 		.mem_targets = MEM_ALL,
 		.uffd_feature_required = 0,
 	},
+	{
+		.name = "copy-vec",
+		.uffd_fn = uffd_copy_vec_test,
+		.mem_targets = MEM_ALL,
+		.uffd_feature_required = UFFD_FEATURE_MISSING_HUGETLBFS |
+		UFFD_FEATURE_MISSING_SHMEM,
+	},
 	{
 		.name = "move",
 		.uffd_fn = uffd_move_test,
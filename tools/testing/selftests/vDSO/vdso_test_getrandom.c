@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * vdso_test_getrandom.c: Sanity checks for the vDSO getrandom()
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/auxv.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <linux/random.h>
+
+#include "../kselftest.h"
+#include "parse_vdso.h"
+
+#ifndef MAP_DROPPABLE
+#define MAP_DROPPABLE	0x08
+#endif
+
+typedef ssize_t (*vgetrandom_t)(void *, size_t, unsigned int, void *, size_t);
+
+static vgetrandom_t vgetrandom;
+static struct vgetrandom_opaque_params params;
+
+static void *alloc_state(void)
+{
+	void *state;
+
+	state = mmap(NULL, params.size_of_opaque_state, params.mmap_prot,
+		     params.mmap_flags, -1, 0);
+	if (state == MAP_FAILED)
+		ksft_exit_fail_perror("mmap");
+	return state;
+}
+
+static void test_fill(void *state)
+{
+	static const uint8_t zero[1000];
+	uint8_t buf[1000];
+	ssize_t ret;
+	size_t len;
+
+	for (len = 1; len <= sizeof(buf); len = len * 3 + 1) {
+		memset(buf, 0, sizeof(buf));
+		ret = vgetrandom(buf, len, 0, state, params.size_of_opaque_state);
+		if (ret != len)
+			ksft_exit_fail_msg("vgetrandom(%zu) returned %zd\n", len, ret);
+		/* A 16-byte all zero slice is astronomically unlikely */
+		if (len >= 16 && !memcmp(buf + len - 16, zero, 16))
+			ksft_exit_fail_msg("vgetrandom(%zu) left the buffer tail zeroed\n", len);
+	}
+	ksft_test_result_pass("fill\n");
+}
+
+static void test_fork(void *state)
+{
+	uint8_t parent[32], child[32];
+	int fds[2], status;
+	pid_t pid;
+
+	/* Make sure the state is seeded before forking */
+	if (vgetrandom(parent, sizeof(parent), 0, state, params.size_of_opaque_state) != sizeof(parent))
+		ksft_exit_fail_msg("vgetrandom failed\n");
+
+	if (pipe(fds))
+		ksft_exit_fail_perror("pipe");
+
+	pid = fork();
+	if (pid < 0)
+		ksft_exit_fail_perror("fork");
+	if (!pid) {
+		if (vgetrandom(child, sizeof(child), 0, state, params.size_of_opaque_state) != sizeof(child))
+			_exit(1);
+		_exit(write(fds[1], child, sizeof(child)) != sizeof(child));
+	}
+
+	if (vgetrandom(parent, sizeof(parent), 0, state, params.size_of_opaque_state) != sizeof(parent))
+		ksft_exit_fail_msg("vgetrandom failed\n");
+	if (read(fds[0], child, sizeof(child)) != sizeof(child))
+		ksft_exit_fail_msg("child did not report its bytes\n");
+	waitpid(pid, &status, 0);
+	if (!WIFEXITED(status) || WEXITSTATUS(status))
+		ksft_exit_fail_msg("child failed\n");
+
+	ksft_test_result(memcmp(parent, child, sizeof(child)), "fork\n");
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long sysinfo_ehdr;
+	void *state;
+
+	ksft_print_header();
+	ksft_set_plan(2);
+
+	sysinfo_ehdr = getauxval(AT_SYSINFO_EHDR);
+	if (!sysinfo_ehdr)
+		ksft_exit_skip("AT_SYSINFO_EHDR is not present!\n");
+	vdso_init_from_sysinfo_ehdr(sysinfo_ehdr);
+
+	vgetrandom = (vgetrandom_t)vdso_sym("LINUX_2.6", "__vdso_getrandom");
+	if (!vgetrandom)
+		ksft_exit_skip("__vdso_getrandom is missing\n");
+
+	if (vgetrandom(NULL, 0, 0, &params, ~0UL) != 0)
+		ksft_exit_skip("vgetrandom parameters are not available\n");
+
+	state = alloc_state();
+	test_fill(state);
+	test_fork(state);
+
+	ksft_finished();
+}
@@ -50,28 +50,71 @@ static bool kvm_dirty_ring_full(struct kvm_dirty_ring *ring)
 	return kvm_dirty_ring_used(ring) >= ring->size;
 }
 
-static void kvm_reset_dirty_gfn(struct kvm *kvm, u32 slot, u64 offset, u64 mask)
+/*
+ * Number of masks write-protected under one hold of mmu_lock before
+ * giving other users of the lock a chance.
+ */
+#define KVM_DIRTY_RING_RESET_MASKS	64
+
+static void kvm_reset_dirty_gfn(struct kvm *kvm,
+				struct kvm_dirty_ring_reset *reset)
 {
-	struct kvm_memory_slot *memslot;
+	u64 offset = reset->offset, mask = reset->mask;
+	u32 slot = reset->slot;
 	int as_id, id;
 
 	if (!mask)
 		return;
 
-	as_id = slot >> 16;
-	id = (u16)slot;
+	/* slots_lock is held, so the memslot can't go away under us. */
+	if (!reset->memslot || slot != reset->memslot_id) {
+		as_id = slot >> 16;
+		id = (u16)slot;
 
-	if (as_id >= kvm_arch_nr_memslot_as_ids(kvm) || id >= KVM_USER_MEM_SLOTS)
-		return;
+		if (as_id >= kvm_arch_nr_memslot_as_ids(kvm) ||
+		    id >= KVM_USER_MEM_SLOTS)
+			return;
 
-	memslot = id_to_memslot(__kvm_memslots(kvm, as_id), id);
+		reset->memslot = id_to_memslot(__kvm_memslots(kvm, as_id), id);
+		reset->memslot_id = slot;
+		if (!reset->memslot)
+			return;
+	}
 
-	if (!memslot || (offset + __fls(mask)) >= memslot->npages)
+	if ((offset + __fls(mask)) >= reset->memslot->npages)
 		return;
 
-	KVM_MMU_LOCK(kvm);
-	kvm_arch_mmu_enable_log_dirty_pt_masked(kvm, memslot, offset, mask);
-	KVM_MMU_UNLOCK(kvm);
+	if (!reset->locked) {
+		KVM_MMU_LOCK(kvm);
+		reset->locked = true;
+	}
+
+	kvm_arch_mmu_enable_log_dirty_pt_masked(kvm, reset->memslot, offset,
+						mask);
+
+	if (++reset->nr_masks % KVM_DIRTY_RING_RESET_MASKS == 0 ||
+	    need_resched()) {
+		KVM_MMU_UNLOCK(kvm);
+		reset->locked = false;
+		cond_resched();
+	}
+}
+
+void kvm_dirty_ring_reset_init(struct kvm_dirty_ring_reset *reset)
+{
+	memset(reset, 0, sizeof(*reset));
+}
+
+void kvm_dirty_ring_reset_finish(struct kvm *kvm,
+				 struct kvm_dirty_ring_reset *reset)
+{
+	kvm_reset_dirty_gfn(kvm, reset);
+	reset->mask = 0;
+
+	if (reset->locked) {
+		KVM_MMU_UNLOCK(kvm);
+		reset->locked = false;
+	}
 }
 
 int kvm_dirty_ring_alloc(struct kvm_dirty_ring *ring, int index, u32 size)
@@ -104,17 +147,13 @@ static inline bool kvm_dirty_gfn_harvested(struct kvm_dirty_gfn *gfn)
 	return smp_load_acquire(&gfn->flags) & KVM_DIRTY_GFN_F_RESET;
 }
 
-int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
+int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring,
+			 struct kvm_dirty_ring_reset *reset)
 {
-	u32 cur_slot, next_slot;
-	u64 cur_offset, next_offset;
-	unsigned long mask;
+	u32 next_slot;
+	u64 next_offset;
 	int count = 0;
 	struct kvm_dirty_gfn *entry;
-	bool first_round = true;
-
-	/* This is only needed to make compilers happy */
-	cur_slot = cur_offset = mask = 0;
 
 	while (true) {
 		entry = &ring->dirty_gfns[ring->reset_index & (ring->size - 1)];
@@ -132,33 +171,32 @@ int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
 		count++;
 		/*
 		 * Try to coalesce the reset operations when the guest is
-		 * scanning pages in the same slot.
+		 * scanning pages in the same slot.  The pending mask is
+		 * carried over from the previous ring, as vCPUs often dirty
+		 * neighbouring pages.
 		 */
-		if (!first_round && next_slot == cur_slot) {
-			s64 delta = next_offset - cur_offset;
+		if (reset->mask && next_slot == reset->slot) {
+			s64 delta = next_offset - reset->offset;
 
 			if (delta >= 0 && delta < BITS_PER_LONG) {
-				mask |= 1ull << delta;
+				reset->mask |= 1ull << delta;
 				continue;
 			}
 
 			/* Backwards visit, careful about overflows!  */
 			if (delta > -BITS_PER_LONG && delta < 0 &&
-			    (mask << -delta >> -delta) == mask) {
-				cur_offset = next_offset;
-				mask = (mask << -delta) | 1;
+			    (reset->mask << -delta >> -delta) == reset->mask) {
+				reset->offset = next_offset;
+				reset->mask = (reset->mask << -delta) | 1;
 				continue;
 			}
 		}
-		kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask);
-		cur_slot = next_slot;
-		cur_offset = next_offset;
-		mask = 1;
-		first_round = false;
+		kvm_reset_dirty_gfn(kvm, reset);
+		reset->slot = next_slot;
+		reset->offset = next_offset;
+		reset->mask = 1;
 	}
 
-	kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask);
-
 	/*
 	 * The request KVM_REQ_DIRTY_RING_SOFT_FULL will be cleared
 	 * by the VCPU thread next time when it enters the guest.
@@ -96,6 +96,15 @@ unsigned int halt_poll_ns_shrink;
 module_param(halt_poll_ns_shrink, uint, 0644);
 EXPORT_SYMBOL_GPL(halt_poll_ns_shrink);
 
+/*
+ * Share of the halted time, in percent, that may be spent polling in vain.
+ * When set, the per-vcpu poll window is picked from the histogram of its
+ * recent halts instead of being grown and shrunk.  Default is off.
+ */
+unsigned int halt_poll_ns_budget;
+module_param(halt_poll_ns_budget, uint, 0644);
+EXPORT_SYMBOL_GPL(halt_poll_ns_budget);
+
 /*
  * Ordering of locks:
  *
@@ -3693,6 +3702,65 @@ static void shrink_halt_poll_ns(struct kvm_vcpu *vcpu)
 	trace_kvm_halt_poll_ns_shrink(vcpu->vcpu_id, val, old);
 }
 
+/* Halve the recent halt histogram every this many halts */
+#define KVM_HALT_RECENT_DECAY	64
+
+static void kvm_vcpu_record_halt(struct kvm_vcpu *vcpu, u64 halt_ns)
+{
+	int i, bucket;
+
+	bucket = halt_ns >> 11 ? min(ilog2(halt_ns >> 11) + 1,
+				     KVM_HALT_RECENT_BUCKETS - 1) : 0;
+	vcpu->halt_recent[bucket]++;
+	vcpu->halt_recent_ns += halt_ns;
+
+	if (++vcpu->halt_recent_samples < KVM_HALT_RECENT_DECAY)
+		return;
+
+	for (i = 0; i < KVM_HALT_RECENT_BUCKETS; i++)
+		vcpu->halt_recent[i] >>= 1;
+	vcpu->halt_recent_ns >>= 1;
+	vcpu->halt_recent_samples = 0;
+}
+
+/*
+ * Pick the largest poll window, among the bucket limits of the recent halt
+ * histogram, for which the time wasted polling through the halts that end
+ * up blocking anyway stays within @budget percent of the time spent halted.
+ */
+static void adapt_halt_poll_ns(struct kvm_vcpu *vcpu, unsigned int max,
+			       unsigned int budget)
+{
+	unsigned int old = vcpu->halt_poll_ns, val = 0;
+	u64 allowed, window, longer = 0;
+	int i;
+
+	allowed = div_u64(vcpu->halt_recent_ns * budget, 100);
+
+	for (i = 0; i < KVM_HALT_RECENT_BUCKETS; i++)
+		longer += vcpu->halt_recent[i];
+
+	for (i = 0; i < KVM_HALT_RECENT_BUCKETS - 1; i++) {
+		window = 1ULL << (i + 11);
+		if (window > max)
+			break;
+
+		longer -= vcpu->halt_recent[i];
+		if (window * longer > allowed)
+			break;
+
+		/* Only poll as long as some halts actually end in time. */
+		if (vcpu->halt_recent[i])
+			val = window;
+	}
+
+	vcpu->halt_poll_ns = val;
+	if (val > old)
+		trace_kvm_halt_poll_ns_grow(vcpu->vcpu_id, val, old);
+	else if (val < old)
+		trace_kvm_halt_poll_ns_shrink(vcpu->vcpu_id, val, old);
+}
+
 static int kvm_vcpu_check_block(struct kvm_vcpu *vcpu)
 {
 	int ret = -EINTR;
@@ -3843,11 +3911,18 @@ void kvm_vcpu_halt(struct kvm_vcpu *vcpu)
 	if (do_halt_poll)
 		update_halt_poll_stats(vcpu, start, poll_end, !waited);
 
+	KVM_STATS_LOG_HIST_UPDATE(vcpu->stat.generic.halt_hist, halt_ns);
+
 	if (halt_poll_allowed) {
+		unsigned int budget = READ_ONCE(halt_poll_ns_budget);
+
 		/* Recompute the max halt poll time in case it changed. */
 		max_halt_poll_ns = kvm_vcpu_max_halt_poll_ns(vcpu);
 
-		if (!vcpu_valid_wakeup(vcpu)) {
+		if (budget && vcpu_valid_wakeup(vcpu)) {
+			kvm_vcpu_record_halt(vcpu, halt_ns);
+			adapt_halt_poll_ns(vcpu, max_halt_poll_ns, budget);
+		} else if (!vcpu_valid_wakeup(vcpu)) {
 			shrink_halt_poll_ns(vcpu);
 		} else if (max_halt_poll_ns) {
 			if (halt_ns <= vcpu->halt_poll_ns)
@@ -3863,6 +3938,7 @@ void kvm_vcpu_halt(struct kvm_vcpu *vcpu)
 		} else {
 			vcpu->halt_poll_ns = 0;
 		}
+		vcpu->stat.generic.halt_poll_window_ns = vcpu->halt_poll_ns;
 	}
 
 	trace_kvm_vcpu_wakeup(halt_ns, waited, vcpu_valid_wakeup(vcpu));
@@ -4907,6 +4983,7 @@ static int kvm_vm_ioctl_enable_dirty_log_ring(struct kvm *kvm, u32 size)
 
 static int kvm_vm_ioctl_reset_dirty_pages(struct kvm *kvm)
 {
+	struct kvm_dirty_ring_reset reset;
 	unsigned long i;
 	struct kvm_vcpu *vcpu;
 	int cleared = 0;
@@ -4916,8 +4993,11 @@ static int kvm_vm_ioctl_reset_dirty_pages(struct kvm *kvm)
 
 	mutex_lock(&kvm->slots_lock);
 
+	kvm_dirty_ring_reset_init(&reset);
 	kvm_for_each_vcpu(i, vcpu, kvm)
-		cleared += kvm_dirty_ring_reset(vcpu->kvm, &vcpu->dirty_ring);
+		cleared += kvm_dirty_ring_reset(vcpu->kvm, &vcpu->dirty_ring,
+						&reset);
+	kvm_dirty_ring_reset_finish(kvm, &reset);
 
 	mutex_unlock(&kvm->slots_lock);
 